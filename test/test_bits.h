@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Plain bit writer and reader for the tests, kept apart from the ones of
+ * the library so that the parsers and the packed header writer are
+ * checked against an independent implementation.
+ */
+
+#ifndef TEST_BITS_H
+#define TEST_BITS_H
+
+#include <stdint.h>
+#include <string.h>
+
+struct test_bitwriter {
+    uint8_t *data;
+    size_t size;            /* bytes stored */
+    uint32_t byte;          /* pending bits */
+    unsigned int bits;
+    int escaped;            /* insert H.264/HEVC emulation prevention bytes */
+    unsigned int zeros;
+    unsigned int num_epb;   /* emulation prevention bytes inserted */
+};
+
+static inline void test_BitWriterInit(struct test_bitwriter *bw, uint8_t *data, int escaped)
+{
+    memset(bw, 0, sizeof(*bw));
+    bw->data = data;
+    bw->escaped = escaped;
+}
+
+static inline void test_PutByte(struct test_bitwriter *bw, uint8_t b)
+{
+    if (bw->escaped && bw->zeros >= 2 && b <= 3) {
+        bw->data[bw->size++] = 3;
+        bw->zeros = 0;
+        bw->num_epb++;
+    }
+    bw->zeros = b ? 0 : bw->zeros + 1;
+    bw->data[bw->size++] = b;
+}
+
+static inline void test_PutBits(struct test_bitwriter *bw, unsigned int n, uint32_t v)
+{
+    while (n--) {
+        bw->byte = (bw->byte << 1) | ((v >> n) & 1);
+        if (++bw->bits == 8) {
+            test_PutByte(bw, bw->byte);
+            bw->byte = 0;
+            bw->bits = 0;
+        }
+    }
+}
+
+static inline void test_PutUE(struct test_bitwriter *bw, uint32_t v)
+{
+    unsigned int len = 0;
+
+    while ((v + 1) >> (len + 1))
+        len++;
+    test_PutBits(bw, len, 0);
+    test_PutBits(bw, len + 1, v + 1);
+}
+
+static inline void test_PutSE(struct test_bitwriter *bw, int32_t v)
+{
+    test_PutUE(bw, v > 0 ? 2 * v - 1 : -2 * v);
+}
+
+/* rbsp_trailing_bits() / byte_alignment() */
+static inline void test_PutTrailingBits(struct test_bitwriter *bw)
+{
+    test_PutBits(bw, 1, 1);
+    while (bw->bits)
+        test_PutBits(bw, 1, 0);
+}
+
+static inline void test_PutZeroPadding(struct test_bitwriter *bw)
+{
+    while (bw->bits)
+        test_PutBits(bw, 1, 0);
+}
+
+/* reads an escaped NAL unit, skipping the emulation prevention bytes */
+struct test_bitreader {
+    const uint8_t *data;
+    size_t size;
+    size_t pos;             /* byte position */
+    unsigned int bit;       /* bits read from data[pos] */
+    unsigned int zeros;
+};
+
+static inline void test_BitReaderInit(struct test_bitreader *br, const uint8_t *data, size_t size)
+{
+    memset(br, 0, sizeof(*br));
+    br->data = data;
+    br->size = size;
+}
+
+static inline uint32_t test_GetBits(struct test_bitreader *br, unsigned int n)
+{
+    uint32_t v = 0;
+
+    while (n--) {
+        if (br->bit == 0) {
+            if (br->pos < br->size && br->zeros >= 2 && br->data[br->pos] == 3) {
+                br->pos++;
+                br->zeros = 0;
+            }
+            if (br->pos < br->size)
+                br->zeros = br->data[br->pos] ? 0 : br->zeros + 1;
+        }
+        v = (v << 1) | (br->pos < br->size ? (br->data[br->pos] >> (7 - br->bit)) & 1 : 0);
+        if (++br->bit == 8) {
+            br->bit = 0;
+            br->pos++;
+        }
+    }
+    return v;
+}
+
+static inline uint32_t test_GetUE(struct test_bitreader *br)
+{
+    unsigned int len = 0;
+
+    while (!test_GetBits(br, 1) && len < 32)
+        len++;
+    return ((1u << len) - 1) + test_GetBits(br, len);
+}
+
+static inline int32_t test_GetSE(struct test_bitreader *br)
+{
+    uint32_t v = test_GetUE(br);
+
+    return v & 1 ? (int32_t)((v + 1) / 2) : -(int32_t)(v / 2);
+}
+
+#endif /* TEST_BITS_H */
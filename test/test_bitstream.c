@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Annex-B splitting: random streams rich in zero, 01 and 03 bytes are fed
+ * to vaSplitAnnexB() in chunks of random sizes, so that start codes and
+ * NAL unit headers straddle chunks, and the NAL units must match those
+ * found by a byte by byte reference. vaFindStartCode(), vaUnescapeNALUnit()
+ * and vaNALUnitBitOffset() are checked against references as well.
+ */
+
+#include <va/va.h>
+#include <va/va_bitstream.h>
+
+#include "test_common.h"
+
+#define MAX_STREAM  5000
+
+struct test_nal {
+    uint64_t offset;
+    uint32_t size;
+};
+
+/* NAL units between 00 00 01 start codes, trailing zero bytes excluded */
+static unsigned int test_SplitReference(const uint8_t *data, size_t size, struct test_nal *nals)
+{
+    unsigned int count = 0;
+    size_t i, start = 0, end;
+    int found = 0;
+
+    for (i = 0; i <= size; i++) {
+        int start_code = i + 2 < size && !data[i] && !data[i + 1] && data[i + 2] == 1;
+
+        if (!start_code && i < size)
+            continue;
+        if (found) {
+            for (end = i; end > start && !data[end - 1]; end--)
+                ;
+            if (end > start) {
+                nals[count].offset = start;
+                nals[count].size = end - start;
+                count++;
+            }
+        }
+        if (start_code) {
+            found = 1;
+            start = i + 3;
+            i += 2;
+        }
+    }
+
+    return count;
+}
+
+/* drops each 03 following two zero bytes, returns the payload size */
+static size_t test_UnescapeReference(const uint8_t *src, size_t size, uint8_t *dst,
+                                     size_t *escaped_offsets)
+{
+    size_t i, n = 0;
+    int zeros = 0;
+
+    for (i = 0; i < size; i++) {
+        if (zeros >= 2 && src[i] == 3) {
+            zeros = 0;
+            continue;
+        }
+        zeros = src[i] ? 0 : zeros + 1;
+        escaped_offsets[n] = i;
+        dst[n++] = src[i];
+    }
+
+    return n;
+}
+
+static void test_Split(uint32_t *rng, const uint8_t *data, size_t size, uint32_t codec)
+{
+    static struct test_nal expected[MAX_STREAM];
+    static VANALUnit units[MAX_STREAM];
+    unsigned int num_expected = test_SplitReference(data, size, expected);
+    unsigned int num_units = 0, i;
+    VAAnnexBSplitter splitter;
+    size_t pos = 0;
+
+    TEST_CHECK(vaCreateAnnexBSplitter(codec, &splitter) == VA_STATUS_SUCCESS);
+    for (;;) {
+        size_t chunk = test_Random(rng) % 4 ? test_Random(rng) % 300 : test_Random(rng) % 4;
+        unsigned int max_units = 1 + test_Random(rng) % 4, n;
+        size_t used;
+        int last;
+
+        if (chunk > size - pos)
+            chunk = size - pos;
+        last = pos + chunk == size;
+        TEST_CHECK(vaSplitAnnexB(splitter, data + pos, chunk,
+                                 last ? VA_BITSTREAM_END_OF_STREAM : 0,
+                                 units + num_units, max_units, &n, &used) == VA_STATUS_SUCCESS);
+        TEST_CHECK(used <= chunk && num_units + n <= num_expected);
+        num_units += n;
+        pos += used;
+        if (last && used == chunk && n < max_units)
+            break;
+    }
+    TEST_CHECK(vaDestroyAnnexBSplitter(splitter) == VA_STATUS_SUCCESS);
+
+    TEST_CHECK(num_units == num_expected);
+    for (i = 0; i < num_units; i++) {
+        const VANALUnit *u = &units[i];
+        const uint8_t *header = data + u->offset;
+
+        TEST_CHECK(u->offset == expected[i].offset && u->size == expected[i].size);
+        if (codec == VA_BITSTREAM_H264) {
+            TEST_CHECK(u->type == (header[0] & 0x1f));
+            TEST_CHECK(u->ref_idc_or_layer_id == ((header[0] >> 5) & 3));
+        } else {
+            TEST_CHECK(u->type == ((header[0] >> 1) & 0x3f));
+            if (u->size > 1) {
+                TEST_CHECK(u->ref_idc_or_layer_id == (((header[0] & 1) << 5) | (header[1] >> 3)));
+                /* nuh_temporal_id_plus1 == 0 is invalid, reported as 0 */
+                TEST_CHECK(u->temporal_id == ((header[1] & 7) ? (header[1] & 7) - 1 : 0));
+            }
+        }
+    }
+}
+
+static void test_Scan(uint32_t *rng, const uint8_t *data, size_t size)
+{
+    static uint8_t payload[MAX_STREAM], unescaped[MAX_STREAM];
+    static size_t escaped_offsets[MAX_STREAM];
+    const uint8_t *start_code = vaFindStartCode(data, size);
+    size_t i, n;
+
+    for (i = 0; i + 2 < size; i++) {
+        if (!data[i] && !data[i + 1] && data[i + 2] == 1)
+            break;
+    }
+    TEST_CHECK(start_code == (i + 2 < size ? data + i : NULL));
+
+    n = test_UnescapeReference(data, size, payload, escaped_offsets);
+    memcpy(unescaped, data, size);
+    TEST_CHECK(vaUnescapeNALUnit(unescaped, size, unescaped) == n);
+    TEST_CHECK(memcmp(unescaped, payload, n) == 0);
+
+    for (i = 0; i < n; i += 1 + test_Random(rng) % 50)
+        TEST_CHECK(vaNALUnitBitOffset(data, size, i * 8 + 3) == escaped_offsets[i] * 8 + 3);
+}
+
+static void test_SliceParams(void)
+{
+    VANALUnit units[3];
+    VASliceParameterBufferHEVC params[3];
+    unsigned int num_slices;
+
+    memset(units, 0, sizeof(units));
+    units[0].offset = 100;
+    units[0].size = 10;
+    units[1].offset = 120;
+    units[1].size = 50;
+    units[1].is_slice = 1;
+    units[2].offset = 180;
+    units[2].size = 5;
+    units[2].is_slice = 1;
+
+    TEST_CHECK(vaSetSliceDataParams(units, 3, 100, params, sizeof(params[0]), 3,
+                                    &num_slices) == VA_STATUS_SUCCESS);
+    TEST_CHECK(num_slices == 2);
+    TEST_CHECK(params[0].slice_data_offset == 20 && params[0].slice_data_size == 50);
+    TEST_CHECK(params[1].slice_data_offset == 80 && params[1].slice_data_size == 5);
+    TEST_CHECK(params[0].slice_data_flag == VA_SLICE_DATA_FLAG_ALL);
+    TEST_CHECK(vaSetSliceDataParams(units, 3, 100, params, sizeof(params[0]), 1,
+                                    &num_slices) == VA_STATUS_ERROR_NOT_ENOUGH_BUFFER);
+    TEST_CHECK(vaSetSliceDataParams(units, 3, 130, params, sizeof(params[0]), 3,
+                                    &num_slices) == VA_STATUS_ERROR_INVALID_PARAMETER);
+}
+
+int main(void)
+{
+    static uint8_t data[MAX_STREAM];
+    uint32_t rng = 1;
+    unsigned int iter;
+
+    for (iter = 0; iter < 2000; iter++) {
+        size_t size = test_Random(&rng) % MAX_STREAM, i;
+        int dense = iter % 3 != 0;
+
+        for (i = 0; i < size; i++) {
+            uint32_t r = test_Random(&rng) % 100;
+
+            if (!dense)
+                data[i] = test_Random(&rng) >> 8;
+            else
+                data[i] = r < 40 ? 0 : r < 55 ? 1 : r < 65 ? 3 : test_Random(&rng) >> 8;
+        }
+        test_Split(&rng, data, size, iter & 1 ? VA_BITSTREAM_HEVC : VA_BITSTREAM_H264);
+        test_Scan(&rng, data, size);
+    }
+    test_SliceParams();
+    return 0;
+}
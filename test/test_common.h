@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Helpers shared by the libva unit tests. The tests only use the public
+ * API and link against the library as built; they exit with a non-zero
+ * status on the first failed check.
+ */
+
+#ifndef TEST_COMMON_H
+#define TEST_COMMON_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define TEST_CHECK(cond) do {                                               \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n",                    \
+                    __FILE__, __LINE__, #cond);                             \
+            exit(1);                                                        \
+        }                                                                   \
+    } while (0)
+
+/* small deterministic generator, so that failures are reproducible */
+static inline uint32_t test_Random(uint32_t *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return *state ^ (*state >> 13);
+}
+
+static inline void test_FillRandom(uint32_t *state, void *data, size_t size)
+{
+    uint8_t *p = (uint8_t *)data;
+    size_t i;
+
+    for (i = 0; i < size; i++)
+        p[i] = test_Random(state) >> 8;
+}
+
+/*
+ * Runs func() in a child process with LIBVA_CPU_MASK=0, so that libva
+ * uses its scalar code, and returns the size bytes of output it produced.
+ * The CPU features are read once per process and inherited by the child:
+ * call it before the test makes any other libva call.
+ */
+static inline void test_RunScalar(void (*func)(void *out, size_t size), void *out, size_t size)
+{
+    size_t done = 0;
+    int fds[2], status;
+    pid_t pid;
+
+    TEST_CHECK(pipe(fds) == 0);
+    pid = fork();
+    TEST_CHECK(pid >= 0);
+    if (pid == 0) {
+        uint8_t *buf = (uint8_t *)calloc(1, size);
+
+        close(fds[0]);
+        setenv("LIBVA_CPU_MASK", "0", 1);
+        func(buf, size);
+        while (done < size) {
+            ssize_t n = write(fds[1], buf + done, size - done);
+
+            if (n <= 0)
+                _exit(1);
+            done += n;
+        }
+        _exit(0);
+    }
+
+    close(fds[1]);
+    while (done < size) {
+        ssize_t n = read(fds[0], (uint8_t *)out + done, size - done);
+
+        TEST_CHECK(n > 0);
+        done += n;
+    }
+    close(fds[0]);
+    TEST_CHECK(waitpid(pid, &status, 0) == pid);
+    TEST_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+#endif /* TEST_COMMON_H */
@@ -0,0 +1,200 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * vaConvertImageData() and vaScaleImageData(): the SIMD kernels must give
+ * the same bytes as the scalar reference code (VA_CONVERT_FLAG_NO_SIMD)
+ * for every pair of formats, and lossless conversions must round trip.
+ */
+
+#include <va/va.h>
+#include <va/va_convert.h>
+
+#include "test_common.h"
+
+static const uint32_t test_fourccs[] = {
+    VA_FOURCC_NV12, VA_FOURCC_NV21, VA_FOURCC_I420, VA_FOURCC_IYUV,
+    VA_FOURCC_YV12, VA_FOURCC_YUY2, VA_FOURCC_UYVY, VA_FOURCC_P010,
+    VA_FOURCC_P012, VA_FOURCC_P016, VA_FOURCC_Y210, VA_FOURCC_Y216,
+    VA_FOURCC_Y410, VA_FOURCC_AYUV, VA_FOURCC_RGBA, VA_FOURCC_RGBX,
+    VA_FOURCC_BGRA, VA_FOURCC_BGRX, VA_FOURCC_ARGB, VA_FOURCC_XRGB,
+    VA_FOURCC_ABGR, VA_FOURCC_XBGR, VA_FOURCC_A2R10G10B10,
+    VA_FOURCC_X2R10G10B10, VA_FOURCC_A2B10G10R10, VA_FOURCC_X2B10G10R10,
+};
+
+#define NUM_FOURCCS (sizeof(test_fourccs) / sizeof(test_fourccs[0]))
+
+/*
+ * odd sizes leave tails after the vector loops, and odd widths and heights
+ * a last chroma sample covering a single luma column or line; 200 lines
+ * cover several rows of threads. The last one is the source of test_Scale().
+ */
+static const struct {
+    unsigned int width, height, alignment;
+} test_sizes[] = {
+    { 1, 1, 0 },
+    { 2, 2, 0 },
+    { 70, 6, 0 },
+    { 71, 7, 0 },
+    { 130, 34, 64 },
+    { 257, 33, 16 },
+    { 258, 200, 16 },
+};
+
+#define NUM_SIZES (sizeof(test_sizes) / sizeof(test_sizes[0]))
+
+static uint8_t *test_AllocImage(uint32_t fourcc, unsigned int size_index, VAImage *image)
+{
+    uint8_t *data;
+
+    TEST_CHECK(vaInitImageLayout(fourcc, test_sizes[size_index].width,
+                                 test_sizes[size_index].height,
+                                 test_sizes[size_index].alignment,
+                                 image) == VA_STATUS_SUCCESS);
+    data = malloc(image->data_size);
+    TEST_CHECK(data != NULL);
+    return data;
+}
+
+static void test_Convert(uint32_t *rng)
+{
+    static const uint32_t flags[] = { 0, VA_CONVERT_FLAG_BT709 | VA_CONVERT_FLAG_FULL_RANGE };
+    unsigned int s, i, j, f;
+
+    for (s = 0; s < NUM_SIZES; s++) {
+        for (i = 0; i < NUM_FOURCCS; i++) {
+            VAImage src_image;
+            uint8_t *src = test_AllocImage(test_fourccs[i], s, &src_image);
+
+            test_FillRandom(rng, src, src_image.data_size);
+
+            for (j = 0; j < NUM_FOURCCS; j++) {
+                VAImage dst_image;
+                uint8_t *dst = test_AllocImage(test_fourccs[j], s, &dst_image);
+                uint8_t *ref = malloc(dst_image.data_size);
+
+                TEST_CHECK(ref != NULL);
+                TEST_CHECK(vaConvertIsSupported(test_fourccs[i], test_fourccs[j]));
+                for (f = 0; f < sizeof(flags) / sizeof(flags[0]); f++) {
+                    /* the row padding is not written, keep it equal */
+                    memset(dst, 0x5a, dst_image.data_size);
+                    memset(ref, 0x5a, dst_image.data_size);
+                    TEST_CHECK(vaConvertImageData(&src_image, src, &dst_image, dst,
+                                                  flags[f]) == VA_STATUS_SUCCESS);
+                    TEST_CHECK(vaConvertImageData(&src_image, src, &dst_image, ref,
+                                                  flags[f] | VA_CONVERT_FLAG_NO_SIMD) == VA_STATUS_SUCCESS);
+                    if (memcmp(dst, ref, dst_image.data_size) != 0) {
+                        fprintf(stderr, "%.4s -> %.4s %ux%u flags 0x%x: SIMD and scalar differ\n",
+                                (const char *)&test_fourccs[i], (const char *)&test_fourccs[j],
+                                test_sizes[s].width, test_sizes[s].height, flags[f]);
+                        exit(1);
+                    }
+                }
+                free(ref);
+                free(dst);
+            }
+            free(src);
+        }
+    }
+}
+
+/* conversions that only move the samples around */
+static void test_RoundTrip(uint32_t *rng)
+{
+    static const uint32_t pairs[][2] = {
+        { VA_FOURCC_NV12, VA_FOURCC_I420 },
+        { VA_FOURCC_NV12, VA_FOURCC_YV12 },
+        { VA_FOURCC_I420, VA_FOURCC_NV21 },
+        { VA_FOURCC_RGBA, VA_FOURCC_BGRA },
+        { VA_FOURCC_ARGB, VA_FOURCC_ABGR },
+    };
+    unsigned int s, p, f;
+
+    for (s = 0; s < NUM_SIZES; s++) {
+        for (p = 0; p < sizeof(pairs) / sizeof(pairs[0]); p++) {
+            for (f = 0; f < 2; f++) {
+                uint32_t flags = f ? VA_CONVERT_FLAG_NO_SIMD : 0;
+                VAImage a_image, b_image;
+                uint8_t *a = test_AllocImage(pairs[p][0], s, &a_image);
+                uint8_t *b = test_AllocImage(pairs[p][1], s, &b_image);
+                uint8_t *c = malloc(a_image.data_size);
+
+                TEST_CHECK(c != NULL);
+                test_FillRandom(rng, a, a_image.data_size);
+                memcpy(c, a, a_image.data_size);
+                TEST_CHECK(vaConvertImageData(&a_image, a, &b_image, b, flags) == VA_STATUS_SUCCESS);
+                TEST_CHECK(vaConvertImageData(&b_image, b, &a_image, c, flags) == VA_STATUS_SUCCESS);
+                TEST_CHECK(memcmp(a, c, a_image.data_size) == 0);
+                free(c);
+                free(b);
+                free(a);
+            }
+        }
+    }
+}
+
+static void test_Scale(uint32_t *rng)
+{
+    static const uint32_t fourccs[] = { VA_FOURCC_NV12, VA_FOURCC_P010, VA_FOURCC_RGBA };
+    static const uint32_t flags[] = { 0, VA_CONVERT_FLAG_SCALE_BILINEAR };
+    VARectangle rect = { 3, 5, 200, 150 };
+    unsigned int i, j, f;
+
+    for (i = 0; i < 3; i++) {
+        VAImage src_image;
+        uint8_t *src = test_AllocImage(fourccs[i], NUM_SIZES - 1, &src_image);
+
+        test_FillRandom(rng, src, src_image.data_size);
+        for (j = 0; j < 3 * 2; j++) {
+            for (f = 0; f < 2; f++) {
+                VAImage dst_image;
+                /* 130x34 and 257x33 */
+                uint8_t *dst = test_AllocImage(fourccs[j / 2], 4 + j % 2, &dst_image);
+                uint8_t *ref = malloc(dst_image.data_size);
+
+                TEST_CHECK(ref != NULL);
+                memset(dst, 0x5a, dst_image.data_size);
+                memset(ref, 0x5a, dst_image.data_size);
+                TEST_CHECK(vaScaleImageData(&src_image, src, f ? &rect : NULL, &dst_image, dst,
+                                            flags[f]) == VA_STATUS_SUCCESS);
+                TEST_CHECK(vaScaleImageData(&src_image, src, f ? &rect : NULL, &dst_image, ref,
+                                            flags[f] | VA_CONVERT_FLAG_NO_SIMD) == VA_STATUS_SUCCESS);
+                TEST_CHECK(memcmp(dst, ref, dst_image.data_size) == 0);
+                free(ref);
+                free(dst);
+            }
+        }
+        free(src);
+    }
+}
+
+int main(void)
+{
+    uint32_t rng = 1;
+
+    test_Convert(&rng);
+    test_RoundTrip(&rng);
+    test_Scale(&rng);
+    return 0;
+}
@@ -0,0 +1,488 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Decoded picture buffer: output order and timing for the bumping rules,
+ * H.264 reference picture marking (sliding window, gaps in frame_num and
+ * the memory management control operations) and show_existing_frame, on
+ * a display whose driver only creates and destroys surfaces.
+ */
+
+#include <va/va.h>
+#include <va/va_backend.h>
+#include <va/va_dpb.h>
+
+#include "test_common.h"
+
+#define TEST_MAX_SURFACES   64
+
+static struct VADisplayContext test_display;
+static struct VADriverContext test_driver;
+static struct VADriverVTable test_vtable;
+
+/* content of the surfaces: the POC, or the H.264 frame_num */
+static int test_alive[TEST_MAX_SURFACES];
+static int test_content[TEST_MAX_SURFACES];
+static unsigned int test_num_created;
+
+static VAStatus test_CreateSurfaces2(VADriverContextP ctx, unsigned int format, unsigned int width,
+                                     unsigned int height, VASurfaceID *surfaces, unsigned int num_surfaces,
+                                     VASurfaceAttrib *attrib_list, unsigned int num_attribs)
+{
+    unsigned int i, id = 0;
+
+    for (i = 0; i < num_surfaces; i++) {
+        while (++id < TEST_MAX_SURFACES && test_alive[id])
+            ;
+        if (id == TEST_MAX_SURFACES)
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+        test_alive[id] = 1;
+        test_num_created++;
+        surfaces[i] = id;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_DestroySurfaces(VADriverContextP ctx, VASurfaceID *surfaces, int num_surfaces)
+{
+    int i;
+
+    for (i = 0; i < num_surfaces; i++) {
+        TEST_CHECK(surfaces[i] < TEST_MAX_SURFACES && test_alive[surfaces[i]]);
+        test_alive[surfaces[i]] = 0;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+static int test_IsValid(VADisplayContextP dctx)
+{
+    return 1;
+}
+
+static VADisplay test_Display(void)
+{
+    test_vtable.vaCreateSurfaces2 = test_CreateSurfaces2;
+    test_vtable.vaDestroySurfaces = test_DestroySurfaces;
+    test_driver.vtable = &test_vtable;
+    test_driver.pDisplayContext = &test_display;
+    test_display.vadpy_magic = VA_DISPLAY_MAGIC;
+    test_display.pDriverContext = &test_driver;
+    test_display.vaIsValid = test_IsValid;
+    return &test_display;
+}
+
+static unsigned int test_NumAlive(void)
+{
+    unsigned int i, n = 0;
+
+    for (i = 0; i < TEST_MAX_SURFACES; i++)
+        n += test_alive[i];
+    return n;
+}
+
+/* appends the content of the pictures ready for output to out, and releases them */
+static void test_Drain(VADecodeDPB dpb, char *out)
+{
+    VASurfaceID surface;
+
+    for (;;) {
+        TEST_CHECK(vaGetDPBOutput(dpb, &surface) == VA_STATUS_SUCCESS);
+        if (surface == VA_INVALID_SURFACE)
+            break;
+        TEST_CHECK(surface < TEST_MAX_SURFACES && test_alive[surface]);
+        sprintf(out + strlen(out), "%d ", test_content[surface]);
+        TEST_CHECK(vaReleaseDPBSurface(dpb, surface) == VA_STATUS_SUCCESS);
+    }
+}
+
+/* decodes an HEVC picture that keeps refs[] for reference, and returns its surface */
+static VASurfaceID test_DecodeHEVC(VADecodeDPB dpb, int poc, int reference, const VASurfaceID *refs,
+                                   unsigned int num_refs, const VADecodeDPBPicture *params)
+{
+    VAPictureParameterBufferHEVC pic_param;
+    VADecodeDPBPicture picture = *params;
+    VASurfaceID surface;
+    unsigned int i;
+
+    TEST_CHECK(vaBeginDPBPicture(dpb, &surface) == VA_STATUS_SUCCESS);
+    TEST_CHECK(surface < TEST_MAX_SURFACES && test_alive[surface]);
+    test_content[surface] = poc;
+
+    memset(&pic_param, 0, sizeof(pic_param));
+    for (i = 0; i < 15; i++) {
+        pic_param.ReferenceFrames[i].picture_id = i < num_refs ? refs[i] : VA_INVALID_SURFACE;
+        pic_param.ReferenceFrames[i].flags = i < num_refs ? VA_PICTURE_HEVC_RPS_ST_CURR_BEFORE : VA_PICTURE_HEVC_INVALID;
+    }
+    TEST_CHECK(vaSetDPBReferences(dpb, &pic_param) == VA_STATUS_SUCCESS);
+
+    picture.poc = poc;
+    picture.reference = reference;
+    TEST_CHECK(vaEndDPBPicture(dpb, &picture) == VA_STATUS_SUCCESS);
+    return surface;
+}
+
+/* max_num_reorder 1: I0 P2 b1 P4 b3, each picture output as soon as it can be */
+static void test_Reorder(VADisplay dpy)
+{
+    VADecodeDPBPicture picture;
+    VADecodeDPB dpb;
+    VASurfaceID i0, p2, p4, refs[2];
+    char out[64] = "";
+
+    TEST_CHECK(vaCreateDecodeDPB(dpy, VAProfileHEVCMain, VA_RT_FORMAT_YUV420, 64, 64, NULL, 0,
+                                 &dpb) == VA_STATUS_SUCCESS);
+    memset(&picture, 0, sizeof(picture));
+    picture.output = 1;
+    picture.max_num_reorder = 1;
+    picture.max_dec_frame_buffering = 3;
+
+    picture.flush = 1;
+    i0 = test_DecodeHEVC(dpb, 0, 1, NULL, 0, &picture);
+    picture.flush = 0;
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, ""));
+
+    p2 = test_DecodeHEVC(dpb, 2, 1, &i0, 1, &picture);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 "));
+
+    refs[0] = i0;
+    refs[1] = p2;
+    test_DecodeHEVC(dpb, 1, 0, refs, 2, &picture);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 "));
+
+    /* I0 is not a reference any more, and its surface goes back to the pool */
+    p4 = test_DecodeHEVC(dpb, 4, 1, &p2, 1, &picture);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 2 "));
+
+    refs[0] = p2;
+    refs[1] = p4;
+    test_DecodeHEVC(dpb, 3, 0, refs, 2, &picture);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 2 3 "));
+
+    TEST_CHECK(vaFlushDPB(dpb) == VA_STATUS_SUCCESS);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 2 3 4 "));
+
+    /* two references, the current picture and one waiting for output */
+    TEST_CHECK(test_num_created <= 4);
+    TEST_CHECK(vaDestroyDecodeDPB(dpb) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+}
+
+/* unknown reordering: pictures are only output when the DPB is full, or flushed */
+static void test_Fullness(VADisplay dpy)
+{
+    VADecodeDPBPicture picture;
+    VADecodeDPB dpb;
+    VASurfaceID i0, p1, p2, refs[2];
+    char out[64] = "";
+
+    TEST_CHECK(vaCreateDecodeDPB(dpy, VAProfileHEVCMain, VA_RT_FORMAT_YUV420, 64, 64, NULL, 0,
+                                 &dpb) == VA_STATUS_SUCCESS);
+    memset(&picture, 0, sizeof(picture));
+    picture.output = 1;
+    picture.max_num_reorder = 0xff;
+    picture.max_dec_frame_buffering = 2;
+
+    i0 = test_DecodeHEVC(dpb, 0, 1, NULL, 0, &picture);
+    p1 = test_DecodeHEVC(dpb, 1, 1, &i0, 1, &picture);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, ""));
+
+    /* I0 waits for output only, P1 and P2 fill the DPB */
+    p2 = test_DecodeHEVC(dpb, 2, 1, &p1, 1, &picture);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 "));
+
+    /* all three kept for reference: outputting does not free a slot */
+    refs[0] = p1;
+    refs[1] = p2;
+    test_DecodeHEVC(dpb, 3, 1, refs, 2, &picture);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 2 3 "));
+
+    TEST_CHECK(vaFlushDPB(dpb) == VA_STATUS_SUCCESS);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 2 3 "));
+
+    /* unknown DPB size too: nothing is output before the next IRAP picture */
+    picture.max_dec_frame_buffering = 0;
+    picture.flush = 1;
+    i0 = test_DecodeHEVC(dpb, 0, 1, NULL, 0, &picture);
+    picture.flush = 0;
+    test_DecodeHEVC(dpb, 2, 0, &i0, 1, &picture);
+    test_DecodeHEVC(dpb, 1, 0, &i0, 1, &picture);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 2 3 "));
+
+    /* which discards them with no_output_of_prior_pics_flag */
+    picture.flush = 1;
+    picture.no_output_of_prior_pics = 1;
+    test_DecodeHEVC(dpb, 0, 1, NULL, 0, &picture);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 2 3 "));
+    TEST_CHECK(vaFlushDPB(dpb) == VA_STATUS_SUCCESS);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 2 3 0 "));
+
+    TEST_CHECK(vaDestroyDecodeDPB(dpb) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+}
+
+static VADecodeDPB test_h264_dpb;
+static VAPictureParameterBufferH264 test_h264_pic_param;
+
+/*
+ * Decodes an H.264 frame and prints the reference frames it sees as their
+ * frame_idx, with an L for the long-term ones.
+ */
+static void test_DecodeH264(uint32_t frame_num, int reference, int idr, int poc,
+                            const VADPBMarkingOpH264 *ops, unsigned int num_ops, char *refs)
+{
+    VAPictureParameterBufferH264 *pp = &test_h264_pic_param;
+    VADecodeDPBPictureH264 h264;
+    VADecodeDPBPicture picture;
+    VASurfaceID surface;
+    char out[16] = "", expected[16];
+    unsigned int i;
+
+    TEST_CHECK(vaBeginDPBPicture(test_h264_dpb, &surface) == VA_STATUS_SUCCESS);
+    test_content[surface] = frame_num;
+
+    memset(&h264, 0, sizeof(h264));
+    h264.frame_num = frame_num;
+    h264.log2_max_frame_num = 4;
+    h264.max_num_ref_frames = 3;
+    h264.idr = idr;
+    h264.top_field_order_cnt = poc;
+    h264.bottom_field_order_cnt = poc + 1;
+    h264.num_marking_ops = num_ops;
+    if (num_ops)
+        memcpy(h264.marking_ops, ops, num_ops * sizeof(*ops));
+    TEST_CHECK(vaSetDPBPictureH264(test_h264_dpb, &h264, pp) == VA_STATUS_SUCCESS);
+    TEST_CHECK(pp->CurrPic.picture_id == surface && pp->CurrPic.frame_idx == frame_num);
+    TEST_CHECK(pp->CurrPic.TopFieldOrderCnt == poc && pp->CurrPic.BottomFieldOrderCnt == poc + 1);
+
+    refs[0] = 0;
+    for (i = 0; i < 16; i++) {
+        const VAPictureH264 *r = &pp->ReferenceFrames[i];
+
+        if (r->flags & VA_PICTURE_H264_INVALID) {
+            TEST_CHECK(r->picture_id == VA_INVALID_SURFACE);
+            continue;
+        }
+        TEST_CHECK(r->picture_id != surface && r->picture_id < TEST_MAX_SURFACES && test_alive[r->picture_id]);
+        TEST_CHECK(r->BottomFieldOrderCnt == r->TopFieldOrderCnt + 1);
+        if (r->flags & VA_PICTURE_H264_LONG_TERM_REFERENCE) {
+            sprintf(refs + strlen(refs), "L%u ", r->frame_idx);
+        } else {
+            TEST_CHECK(r->flags == VA_PICTURE_H264_SHORT_TERM_REFERENCE);
+            TEST_CHECK(r->frame_idx == (uint32_t)test_content[r->picture_id]);
+            sprintf(refs + strlen(refs), "%u ", r->frame_idx);
+        }
+    }
+
+    memset(&picture, 0, sizeof(picture));
+    picture.poc = poc;
+    picture.reference = reference;
+    picture.output = 1;
+    picture.max_num_reorder = 0;
+    TEST_CHECK(vaEndDPBPicture(test_h264_dpb, &picture) == VA_STATUS_SUCCESS);
+
+    /* no reordering: output right away */
+    test_Drain(test_h264_dpb, out);
+    sprintf(expected, "%u ", frame_num);
+    TEST_CHECK(!strcmp(out, expected));
+}
+
+#define TEST_H264(frame_num, reference, idr, poc, ops, num_ops, expected) do {   \
+        char refs[128];                                                         \
+        test_DecodeH264(frame_num, reference, idr, poc, ops, num_ops, refs);    \
+        TEST_CHECK(!strcmp(refs, expected));                                    \
+    } while (0)
+
+/* max_num_ref_frames 3, MaxFrameNum 16 */
+static void test_MarkingH264(VADisplay dpy)
+{
+    static const VADPBMarkingOpH264 unmark_and_long_term[] = {
+        { 1, 1, 0, 0, 0 },      /* frame_num 3 unused */
+        { 3, 2, 0, 0, 0 },      /* frame_num 2 to LongTermFrameIdx 0 */
+    };
+    static const VADPBMarkingOpH264 current_long_term[] = {
+        { 2, 0, 0, 0, 0 },      /* LongTermPicNum 0 unused */
+        { 6, 0, 0, 1, 0 },      /* current picture to LongTermFrameIdx 1 */
+    };
+    static const VADPBMarkingOpH264 max_long_term[] = {
+        { 4, 0, 0, 0, 1 },      /* MaxLongTermFrameIdx 0 */
+    };
+    static const VADPBMarkingOpH264 reset[] = {
+        { 5, 0, 0, 0, 0 },
+    };
+    VADecodeDPBPictureH264 h264;
+    VASurfaceID surface;
+    uint32_t frame_num;
+    char refs[128];
+
+    TEST_CHECK(vaCreateDecodeDPB(dpy, VAProfileH264High, VA_RT_FORMAT_YUV420, 64, 64, NULL, 0,
+                                 &test_h264_dpb) == VA_STATUS_SUCCESS);
+
+    /* sliding window */
+    TEST_H264(0, 1, 1, 0, NULL, 0, "");
+    TEST_H264(1, 1, 0, 2, NULL, 0, "0 ");
+    TEST_H264(2, 1, 0, 4, NULL, 0, "0 1 ");
+    TEST_H264(3, 1, 0, 6, NULL, 0, "0 1 2 ");
+    TEST_H264(4, 1, 0, 8, NULL, 0, "1 2 3 ");
+    /* a non-reference picture does not move the window */
+    TEST_H264(5, 0, 0, 10, NULL, 0, "2 3 4 ");
+    /* FrameNumWrap across the wrap of frame_num */
+    for (frame_num = 5; frame_num < 20; frame_num++)
+        test_DecodeH264(frame_num % 16, 1, 0, 2 * frame_num, NULL, 0, refs);
+    TEST_H264(4, 1, 0, 40, NULL, 0, "1 2 3 ");
+
+    TEST_H264(5, 1, 0, 42, unmark_and_long_term, 2, "2 3 4 ");
+    TEST_H264(6, 1, 0, 44, NULL, 0, "L0 4 5 ");
+    /* the sliding window leaves long-term frames alone */
+    TEST_H264(7, 1, 0, 46, NULL, 0, "L0 5 6 ");
+    TEST_H264(8, 1, 0, 48, current_long_term, 2, "L0 6 7 ");
+    TEST_H264(9, 1, 0, 50, NULL, 0, "6 7 L1 ");
+    TEST_H264(10, 1, 0, 52, max_long_term, 1, "7 L1 9 ");
+    TEST_H264(11, 1, 0, 54, NULL, 0, "7 9 10 ");
+
+    /* frame_num 12 and 13 missing: the frames inferred in their place are not listed */
+    TEST_H264(14, 1, 0, 60, NULL, 0, "11 ");
+    TEST_H264(15, 1, 0, 62, NULL, 0, "14 ");
+
+    /* memory_management_control_operation 5: frame_num 0 and POC 0 from then on */
+    TEST_H264(0, 1, 0, 64, reset, 1, "14 15 ");
+    TEST_H264(1, 1, 0, 2, NULL, 0, "0 ");
+
+    /* errors */
+    TEST_CHECK(vaBeginDPBPicture(test_h264_dpb, &surface) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaBeginDPBPicture(test_h264_dpb, &surface) == VA_STATUS_ERROR_OPERATION_FAILED);
+    memset(&h264, 0, sizeof(h264));
+    h264.log2_max_frame_num = 4;
+    h264.frame_num = 16;
+    TEST_CHECK(vaSetDPBPictureH264(test_h264_dpb, &h264, &test_h264_pic_param) == VA_STATUS_ERROR_INVALID_PARAMETER);
+    h264.frame_num = 2;
+    h264.num_marking_ops = 1;
+    h264.marking_ops[0].memory_management_control_operation = 7;
+    TEST_CHECK(vaSetDPBPictureH264(test_h264_dpb, &h264, &test_h264_pic_param) == VA_STATUS_ERROR_INVALID_PARAMETER);
+    TEST_CHECK(vaFlushDPB(test_h264_dpb) == VA_STATUS_ERROR_OPERATION_FAILED);
+
+    TEST_CHECK(vaDestroyDecodeDPB(test_h264_dpb) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+}
+
+/* VP9: a hidden frame shown later with show_existing_frame, then replaced */
+static void test_ShowExisting(VADisplay dpy)
+{
+    VADecPictureParameterBufferVP9 pic_param;
+    VADecodeDPBPicture picture;
+    VADecodeDPB dpb;
+    VASurfaceID key, hidden, inter;
+    char out[64] = "";
+    unsigned int i, alive;
+
+    TEST_CHECK(vaCreateDecodeDPB(dpy, VAProfileVP9Profile0, VA_RT_FORMAT_YUV420, 64, 64, NULL, 0,
+                                 &dpb) == VA_STATUS_SUCCESS);
+    memset(&picture, 0, sizeof(picture));
+    memset(&pic_param, 0, sizeof(pic_param));
+    for (i = 0; i < 8; i++)
+        pic_param.reference_frames[i] = VA_INVALID_SURFACE;
+
+    /* key frame, refreshing every slot */
+    TEST_CHECK(vaBeginDPBPicture(dpb, &key) == VA_STATUS_SUCCESS);
+    test_content[key] = 0;
+    TEST_CHECK(vaSetDPBReferences(dpb, &pic_param) == VA_STATUS_SUCCESS);
+    picture.reference = 1;
+    picture.output = 1;
+    TEST_CHECK(vaEndDPBPicture(dpb, &picture) == VA_STATUS_SUCCESS);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 "));
+    for (i = 0; i < 8; i++)
+        pic_param.reference_frames[i] = key;
+
+    /* hidden frame, refreshing slot 1 */
+    TEST_CHECK(vaBeginDPBPicture(dpb, &hidden) == VA_STATUS_SUCCESS);
+    test_content[hidden] = 1;
+    TEST_CHECK(vaSetDPBReferences(dpb, &pic_param) == VA_STATUS_SUCCESS);
+    picture.output = 0;
+    TEST_CHECK(vaEndDPBPicture(dpb, &picture) == VA_STATUS_SUCCESS);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 "));
+    pic_param.reference_frames[1] = hidden;
+
+    /* only reference frames can be shown */
+    TEST_CHECK(vaShowDPBSurface(dpb, VA_INVALID_SURFACE) == VA_STATUS_ERROR_INVALID_SURFACE);
+    TEST_CHECK(vaShowDPBSurface(dpb, hidden) == VA_STATUS_SUCCESS);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 "));
+
+    /* an inter frame refreshing slot 1: the hidden frame is dropped by the next one */
+    TEST_CHECK(vaBeginDPBPicture(dpb, &inter) == VA_STATUS_SUCCESS);
+    test_content[inter] = 2;
+    TEST_CHECK(vaSetDPBReferences(dpb, &pic_param) == VA_STATUS_SUCCESS);
+    picture.output = 1;
+    TEST_CHECK(vaEndDPBPicture(dpb, &picture) == VA_STATUS_SUCCESS);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 2 "));
+    pic_param.reference_frames[1] = inter;
+
+    TEST_CHECK(vaBeginDPBPicture(dpb, &inter) == VA_STATUS_SUCCESS);
+    test_content[inter] = 3;
+    TEST_CHECK(vaSetDPBReferences(dpb, &pic_param) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaShowDPBSurface(dpb, hidden) == VA_STATUS_ERROR_INVALID_SURFACE);
+    TEST_CHECK(vaEndDPBPicture(dpb, &picture) == VA_STATUS_SUCCESS);
+    test_Drain(dpb, out);
+    TEST_CHECK(!strcmp(out, "0 1 2 3 "));
+
+    /* the surface of the hidden frame is reused rather than a new one created */
+    alive = test_NumAlive();
+    TEST_CHECK(vaBeginDPBPicture(dpb, &inter) == VA_STATUS_SUCCESS);
+    TEST_CHECK(inter == hidden && test_NumAlive() == alive);
+    picture.reference = 0;
+    picture.output = 0;
+    TEST_CHECK(vaEndDPBPicture(dpb, &picture) == VA_STATUS_SUCCESS);
+
+    TEST_CHECK(vaDestroyDecodeDPB(dpb) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+}
+
+int main(void)
+{
+    VADisplay dpy = test_Display();
+    VADecodeDPB dpb;
+
+    TEST_CHECK(vaCreateDecodeDPB(dpy, VAProfileNone, VA_RT_FORMAT_YUV420, 64, 64, NULL, 0,
+                                 &dpb) == VA_STATUS_ERROR_UNSUPPORTED_PROFILE);
+
+    test_Reorder(dpy);
+    test_Fullness(dpy);
+    test_MarkingH264(dpy);
+    test_ShowExisting(dpy);
+    return 0;
+}
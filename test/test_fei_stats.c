@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * FEI frame statistics: a small frame whose sums are worked out by hand,
+ * then random records, with every field at full range and intra motion
+ * vectors, summarized by the SIMD code and by the scalar code in a child
+ * process, which must agree exactly. The counts cover the tails of the
+ * vector loops and frames of several chunks.
+ */
+
+#include <va/va.h>
+#include <va/va_fei_stats.h>
+
+#include "test_common.h"
+
+#define TEST_NUM_FRAMES     40
+#define TEST_INTRA_MV       INT16_MIN
+
+static void test_HandWorked(void)
+{
+    VAStatsStatisticsH264 statistics[3];
+    VAEncFEIDistortionH264 distortion[3];
+    VAEncFEIMBCodeH264 mb_code[3];
+    VAMotionVector mv[48];
+    VAFEIFrameStatsH264 s;
+
+    memset(statistics, 0, sizeof(statistics));
+    statistics[0].best_inter_distortion0 = 100;
+    statistics[0].best_inter_distortion1 = 50;
+    statistics[0].best_intra_distortion = 80;
+    statistics[0].mb_is_flat = 1;
+    statistics[0].variance_16x16 = 7;
+    statistics[0].pixel_average_16x16 = 100;
+    statistics[1].best_inter_distortion0 = 10;
+    statistics[1].best_inter_distortion1 = 500;
+    statistics[1].best_intra_distortion = 5;
+    statistics[1].variance_16x16 = 0xffffffff;
+    statistics[1].pixel_average_16x16 = 0xffffffff;
+    statistics[2].best_inter_distortion0 = 65535;
+    statistics[2].best_inter_distortion1 = 65535;
+    statistics[2].best_intra_distortion = 65535;
+
+    memset(mv, 0, sizeof(mv));
+    mv[0].mv0[0] = -4;
+    mv[0].mv0[1] = 8;
+    mv[1].mv0[0] = TEST_INTRA_MV;
+    mv[1].mv0[1] = TEST_INTRA_MV;
+    mv[2].mv1[0] = 3;
+    mv[47].mv1[1] = -32767;
+
+    /* both references */
+    TEST_CHECK(vaSummarizeFEIFrameStatsH264(3, VA_FEI_FRAME_STATS_PAST_REFERENCE | VA_FEI_FRAME_STATS_FUTURE_REFERENCE,
+                                            statistics, NULL, mv, NULL, &s) == VA_STATUS_SUCCESS);
+    TEST_CHECK(s.num_mbs == 3);
+    TEST_CHECK(s.sources == (VA_FEI_FRAME_STATS_HAS_STATISTICS | VA_FEI_FRAME_STATS_HAS_MV));
+    TEST_CHECK(s.intra_distortion == 80 + 5 + 65535);
+    TEST_CHECK(s.inter_distortion == 50 + 10 + 65535);
+    TEST_CHECK(s.best_distortion == 50 + 5 + 65535);
+    TEST_CHECK(s.num_intra_mbs == 1);
+    TEST_CHECK(s.num_flat_mbs == 1);
+    TEST_CHECK(s.variance == 7 + 0xffffffffull);
+    TEST_CHECK(s.pixel_average == 100 + 0xffffffffull);
+    /* block 1 is intra for list 0 only */
+    TEST_CHECK(s.num_mv_blocks[0] == 47 && s.num_mv_blocks[1] == 48);
+    TEST_CHECK(s.mv_abs_sum[0][0] == 4 && s.mv_abs_sum[0][1] == 8);
+    TEST_CHECK(s.mv_sum[0][0] == -4 && s.mv_sum[0][1] == 8);
+    TEST_CHECK(s.mv_abs_sum[1][0] == 3 && s.mv_abs_sum[1][1] == 32767);
+    TEST_CHECK(s.mv_sum[1][0] == 3 && s.mv_sum[1][1] == -32767);
+
+    /* past reference only */
+    TEST_CHECK(vaSummarizeFEIFrameStatsH264(3, VA_FEI_FRAME_STATS_PAST_REFERENCE,
+                                            statistics, NULL, NULL, NULL, &s) == VA_STATUS_SUCCESS);
+    TEST_CHECK(s.sources == VA_FEI_FRAME_STATS_HAS_STATISTICS);
+    TEST_CHECK(s.inter_distortion == 100 + 10 + 65535);
+    TEST_CHECK(s.best_distortion == 80 + 5 + 65535);
+    TEST_CHECK(s.num_intra_mbs == 2);
+    TEST_CHECK(s.num_mv_blocks[0] == 0 && s.mv_abs_sum[0][0] == 0);
+
+    /* intra picture: every macroblock is intra and there is no inter distortion */
+    TEST_CHECK(vaSummarizeFEIFrameStatsH264(3, 0, statistics, NULL, NULL, NULL, &s) == VA_STATUS_SUCCESS);
+    TEST_CHECK(s.inter_distortion == 0);
+    TEST_CHECK(s.best_distortion == 80 + 5 + 65535);
+    TEST_CHECK(s.num_intra_mbs == 3);
+
+    memset(distortion, 0, sizeof(distortion));
+    distortion[0].best_inter_distortion = 20;
+    distortion[0].best_intra_distortion = 30;
+    distortion[0].colocated_mb_distortion = 40;
+    distortion[1].best_inter_distortion = 65535;
+    distortion[1].best_intra_distortion = 1;
+    distortion[1].colocated_mb_distortion = 65535;
+    distortion[2].best_inter_distortion = 7;
+    distortion[2].best_intra_distortion = 7;
+    memset(mb_code, 0, sizeof(mb_code));
+    mb_code[0].mb_skip_flag = 1;
+    mb_code[0].qp_prime_y = 51;
+    mb_code[1].intra_mb_flag = 1;
+    mb_code[1].qp_prime_y = 255;
+    mb_code[2].mb_skip_flag = 1;
+
+    TEST_CHECK(vaSummarizeFEIFrameStatsH264(3, VA_FEI_FRAME_STATS_FUTURE_REFERENCE,
+                                            NULL, distortion, NULL, mb_code, &s) == VA_STATUS_SUCCESS);
+    TEST_CHECK(s.sources == (VA_FEI_FRAME_STATS_HAS_DISTORTION | VA_FEI_FRAME_STATS_HAS_MB_CODE));
+    TEST_CHECK(s.intra_distortion == 30 + 1 + 7);
+    TEST_CHECK(s.inter_distortion == 20 + 65535 + 7);
+    TEST_CHECK(s.best_distortion == 20 + 1 + 7);
+    TEST_CHECK(s.num_intra_mbs == 1);
+    TEST_CHECK(s.colocated_distortion == 40 + 65535);
+    TEST_CHECK(s.num_flat_mbs == 0 && s.variance == 0);
+    TEST_CHECK(s.num_skip_mbs == 2 && s.num_intra_coded_mbs == 1);
+    TEST_CHECK(s.qp_sum == 51 + 255);
+
+    /* the statistics and the distortion buffers describe the same thing */
+    TEST_CHECK(vaSummarizeFEIFrameStatsH264(3, 0, statistics, distortion, NULL, NULL,
+                                            &s) == VA_STATUS_ERROR_INVALID_PARAMETER);
+    TEST_CHECK(vaSummarizeFEIFrameStatsH264(3, 0, statistics, NULL, NULL, NULL,
+                                            NULL) == VA_STATUS_ERROR_INVALID_PARAMETER);
+}
+
+static uint32_t test_NumMBs(uint32_t *rng, unsigned int frame)
+{
+    /* 0 to 19, then up to a few chunks of 1024 */
+    return frame < 20 ? frame : test_Random(rng) % 5000;
+}
+
+/* two summaries per frame: statistics, MVs and MB code, then distortion */
+static void test_Summarize(void *out, size_t size)
+{
+    VAFEIFrameStatsH264 *stats = out;
+    uint32_t rng = 1;
+    unsigned int frame;
+
+    TEST_CHECK(size == 2 * TEST_NUM_FRAMES * sizeof(*stats));
+    for (frame = 0; frame < TEST_NUM_FRAMES; frame++) {
+        uint32_t num_mbs = test_NumMBs(&rng, frame), flags = frame % 4, i;
+        VAStatsStatisticsH264 *statistics = malloc(sizeof(*statistics) * num_mbs + 1);
+        VAEncFEIDistortionH264 *distortion = malloc(sizeof(*distortion) * num_mbs + 1);
+        VAMotionVector *mv = malloc(sizeof(*mv) * 16 * num_mbs + 1);
+        VAEncFEIMBCodeH264 *mb_code = malloc(sizeof(*mb_code) * num_mbs + 1);
+
+        TEST_CHECK(statistics && distortion && mv && mb_code);
+        test_FillRandom(&rng, statistics, sizeof(*statistics) * num_mbs);
+        test_FillRandom(&rng, distortion, sizeof(*distortion) * num_mbs);
+        test_FillRandom(&rng, mv, sizeof(*mv) * 16 * num_mbs);
+        test_FillRandom(&rng, mb_code, sizeof(*mb_code) * num_mbs);
+        for (i = 0; i < 16 * num_mbs; i++) {
+            if (test_Random(&rng) % 4 == 0)
+                mv[i].mv0[0] = TEST_INTRA_MV;
+            if (test_Random(&rng) % 4 == 0)
+                mv[i].mv1[0] = TEST_INTRA_MV;
+            /* not an intra block: only the horizontal component flags it */
+            if (test_Random(&rng) % 8 == 0)
+                mv[i].mv0[1] = TEST_INTRA_MV;
+        }
+        /* realistic ranges for half of the frames, full range for the others */
+        if (!(frame & 4)) {
+            for (i = 0; i < num_mbs; i++) {
+                statistics[i].variance_16x16 %= 20000;
+                statistics[i].pixel_average_16x16 %= 256;
+            }
+        }
+
+        TEST_CHECK(vaSummarizeFEIFrameStatsH264(num_mbs, flags, statistics, NULL, mv, mb_code,
+                                                &stats[2 * frame]) == VA_STATUS_SUCCESS);
+        TEST_CHECK(vaSummarizeFEIFrameStatsH264(num_mbs, flags, NULL, distortion, NULL, NULL,
+                                                &stats[2 * frame + 1]) == VA_STATUS_SUCCESS);
+        free(statistics);
+        free(distortion);
+        free(mv);
+        free(mb_code);
+    }
+}
+
+int main(void)
+{
+    static VAFEIFrameStatsH264 scalar[2 * TEST_NUM_FRAMES], simd[2 * TEST_NUM_FRAMES];
+    unsigned int i;
+
+    /* first, as the child inherits the CPU features once read */
+    test_RunScalar(test_Summarize, scalar, sizeof(scalar));
+    test_Summarize(simd, sizeof(simd));
+    for (i = 0; i < 2 * TEST_NUM_FRAMES; i++)
+        TEST_CHECK(!memcmp(&scalar[i], &simd[i], sizeof(simd[i])));
+
+    test_HandWorked();
+    return 0;
+}
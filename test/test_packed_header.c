@@ -0,0 +1,734 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Packed header writer: the parameter sets it writes are read back with
+ * the bit reader of test_bits.h and compared with the parameter buffers,
+ * then the CHANGED flags and the reuse of the data are checked over a few
+ * calls with parameters that change, or only look like they do.
+ */
+
+#include <va/va.h>
+#include <va/va_packed_header.h>
+
+#include "test_common.h"
+#include "test_bits.h"
+
+#define H264_NAL_SPS    7
+#define H264_NAL_PPS    8
+#define HEVC_NAL_VPS    32
+#define HEVC_NAL_SPS    33
+#define HEVC_NAL_PPS    34
+
+/* finds the NAL unit after the 4 byte start code at *pos, up to the next one */
+static void test_NextNALUnit(const VAPackedHeader *header, size_t *pos, struct test_bitreader *br)
+{
+    const uint8_t *data = header->data;
+    size_t size = (header->param.bit_length + 7) / 8, end;
+
+    TEST_CHECK(*pos + 4 < size);
+    TEST_CHECK(!data[*pos] && !data[*pos + 1] && !data[*pos + 2] && data[*pos + 3] == 1);
+    *pos += 4;
+    for (end = *pos; end + 3 < size; end++) {
+        if (!data[end] && !data[end + 1] && !data[end + 2] && data[end + 3] == 1)
+            break;
+    }
+    if (end + 3 >= size)
+        end = size;
+    test_BitReaderInit(br, data + *pos, end - *pos);
+    *pos = end;
+}
+
+static void test_CheckHeader(const VAPackedHeader *header, uint32_t type)
+{
+    TEST_CHECK(header->param.type == type);
+    TEST_CHECK(header->param.has_emulation_bytes == 1);
+    TEST_CHECK(header->param.bit_length > 0 && header->param.bit_length % 8 == 0);
+    TEST_CHECK(header->data != NULL);
+}
+
+/* rbsp_trailing_bits() ending the NAL unit */
+static void test_CheckTrailingBits(struct test_bitreader *br)
+{
+    TEST_CHECK(test_GetBits(br, 1) == 1);
+    while (br->bit)
+        TEST_CHECK(test_GetBits(br, 1) == 0);
+    TEST_CHECK(br->pos == br->size);
+}
+
+static void test_InitH264(VAEncSequenceParameterBufferH264 *seq, VAEncPictureParameterBufferH264 *pic)
+{
+    memset(seq, 0, sizeof(*seq));
+    seq->seq_parameter_set_id = 1;
+    seq->level_idc = 41;
+    seq->intra_period = 30;
+    seq->ip_period = 3;
+    seq->bits_per_second = 4000000;
+    seq->max_num_ref_frames = 3;
+    seq->picture_width_in_mbs = 120;
+    seq->picture_height_in_mbs = 68;
+    seq->seq_fields.bits.chroma_format_idc = 1;
+    seq->seq_fields.bits.frame_mbs_only_flag = 1;
+    seq->seq_fields.bits.seq_scaling_matrix_present_flag = 1;
+    seq->seq_fields.bits.direct_8x8_inference_flag = 1;
+    seq->seq_fields.bits.log2_max_frame_num_minus4 = 4;
+    seq->seq_fields.bits.log2_max_pic_order_cnt_lsb_minus4 = 2;
+    seq->frame_cropping_flag = 1;
+    seq->frame_crop_bottom_offset = 4;
+    seq->vui_parameters_present_flag = 1;
+    seq->vui_fields.bits.aspect_ratio_info_present_flag = 1;
+    seq->vui_fields.bits.timing_info_present_flag = 1;
+    seq->vui_fields.bits.bitstream_restriction_flag = 1;
+    seq->vui_fields.bits.motion_vectors_over_pic_boundaries_flag = 1;
+    seq->vui_fields.bits.fixed_frame_rate_flag = 1;
+    seq->vui_fields.bits.log2_max_mv_length_horizontal = 15;
+    seq->vui_fields.bits.log2_max_mv_length_vertical = 14;
+    seq->aspect_ratio_idc = 255;
+    seq->sar_width = 4;
+    seq->sar_height = 3;
+    seq->num_units_in_tick = 1;
+    seq->time_scale = 50;
+
+    memset(pic, 0, sizeof(*pic));
+    pic->CurrPic.picture_id = 7;
+    pic->coded_buf = 9;
+    pic->pic_parameter_set_id = 2;
+    pic->seq_parameter_set_id = 1;
+    pic->frame_num = 1;
+    pic->pic_init_qp = 30;
+    pic->num_ref_idx_l0_active_minus1 = 2;
+    pic->chroma_qp_index_offset = -2;
+    pic->second_chroma_qp_index_offset = 3;
+    pic->pic_fields.bits.idr_pic_flag = 1;
+    pic->pic_fields.bits.entropy_coding_mode_flag = 1;
+    pic->pic_fields.bits.weighted_pred_flag = 1;
+    pic->pic_fields.bits.weighted_bipred_idc = 2;
+    pic->pic_fields.bits.transform_8x8_mode_flag = 1;
+    pic->pic_fields.bits.deblocking_filter_control_present_flag = 1;
+    pic->pic_fields.bits.pic_scaling_matrix_present_flag = 1;
+}
+
+static void test_CheckH264SPS(const VAPackedHeader *header, VAProfile profile,
+                              const VAEncSequenceParameterBufferH264 *seq, unsigned int max_num_reorder_frames)
+{
+    struct test_bitreader br;
+    size_t pos = 0;
+    unsigned int i;
+
+    test_CheckHeader(header, VAEncPackedHeaderSequence);
+    test_NextNALUnit(header, &pos, &br);
+    TEST_CHECK(pos == (header->param.bit_length + 7) / 8);
+
+    TEST_CHECK(test_GetBits(&br, 8) == (0x60 | H264_NAL_SPS));
+    if (profile == VAProfileH264ConstrainedBaseline) {
+        TEST_CHECK(test_GetBits(&br, 8) == 66);
+        TEST_CHECK(test_GetBits(&br, 8) == 0xc0);
+    } else if (profile == VAProfileH264Main) {
+        TEST_CHECK(test_GetBits(&br, 8) == 77);
+        TEST_CHECK(test_GetBits(&br, 8) == 0x40);
+    } else {
+        TEST_CHECK(test_GetBits(&br, 8) == 100);
+        TEST_CHECK(test_GetBits(&br, 8) == 0);
+    }
+    TEST_CHECK(test_GetBits(&br, 8) == seq->level_idc);
+    TEST_CHECK(test_GetUE(&br) == seq->seq_parameter_set_id);
+    if (profile == VAProfileH264High) {
+        TEST_CHECK(test_GetUE(&br) == seq->seq_fields.bits.chroma_format_idc);
+        TEST_CHECK(test_GetUE(&br) == seq->bit_depth_luma_minus8);
+        TEST_CHECK(test_GetUE(&br) == seq->bit_depth_chroma_minus8);
+        TEST_CHECK(test_GetBits(&br, 1) == 0);          /* qpprime_y_zero_transform_bypass_flag */
+        TEST_CHECK(test_GetBits(&br, 1) == seq->seq_fields.bits.seq_scaling_matrix_present_flag);
+        if (seq->seq_fields.bits.seq_scaling_matrix_present_flag)
+            TEST_CHECK(test_GetBits(&br, 8) == 0);      /* seq_scaling_list_present_flag[] */
+    }
+    TEST_CHECK(test_GetUE(&br) == seq->seq_fields.bits.log2_max_frame_num_minus4);
+    TEST_CHECK(test_GetUE(&br) == seq->seq_fields.bits.pic_order_cnt_type);
+    if (seq->seq_fields.bits.pic_order_cnt_type == 0) {
+        TEST_CHECK(test_GetUE(&br) == seq->seq_fields.bits.log2_max_pic_order_cnt_lsb_minus4);
+    } else {
+        TEST_CHECK(test_GetBits(&br, 1) == seq->seq_fields.bits.delta_pic_order_always_zero_flag);
+        TEST_CHECK(test_GetSE(&br) == seq->offset_for_non_ref_pic);
+        TEST_CHECK(test_GetSE(&br) == seq->offset_for_top_to_bottom_field);
+        TEST_CHECK(test_GetUE(&br) == seq->num_ref_frames_in_pic_order_cnt_cycle);
+        for (i = 0; i < seq->num_ref_frames_in_pic_order_cnt_cycle; i++)
+            TEST_CHECK(test_GetSE(&br) == seq->offset_for_ref_frame[i]);
+    }
+    TEST_CHECK(test_GetUE(&br) == seq->max_num_ref_frames);
+    TEST_CHECK(test_GetBits(&br, 1) == 0);              /* gaps_in_frame_num_value_allowed_flag */
+    TEST_CHECK(test_GetUE(&br) == seq->picture_width_in_mbs - 1u);
+    if (seq->seq_fields.bits.frame_mbs_only_flag) {
+        TEST_CHECK(test_GetUE(&br) == seq->picture_height_in_mbs - 1u);
+        TEST_CHECK(test_GetBits(&br, 1) == 1);
+    } else {
+        TEST_CHECK(test_GetUE(&br) == seq->picture_height_in_mbs / 2 - 1u);
+        TEST_CHECK(test_GetBits(&br, 1) == 0);
+        TEST_CHECK(test_GetBits(&br, 1) == seq->seq_fields.bits.mb_adaptive_frame_field_flag);
+    }
+    TEST_CHECK(test_GetBits(&br, 1) == seq->seq_fields.bits.direct_8x8_inference_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == seq->frame_cropping_flag);
+    if (seq->frame_cropping_flag) {
+        TEST_CHECK(test_GetUE(&br) == seq->frame_crop_left_offset);
+        TEST_CHECK(test_GetUE(&br) == seq->frame_crop_right_offset);
+        TEST_CHECK(test_GetUE(&br) == seq->frame_crop_top_offset);
+        TEST_CHECK(test_GetUE(&br) == seq->frame_crop_bottom_offset);
+    }
+
+    TEST_CHECK(test_GetBits(&br, 1) == seq->vui_parameters_present_flag);
+    if (seq->vui_parameters_present_flag) {
+        TEST_CHECK(test_GetBits(&br, 1) == seq->vui_fields.bits.aspect_ratio_info_present_flag);
+        if (seq->vui_fields.bits.aspect_ratio_info_present_flag) {
+            TEST_CHECK(test_GetBits(&br, 8) == seq->aspect_ratio_idc);
+            if (seq->aspect_ratio_idc == 255) {
+                TEST_CHECK(test_GetBits(&br, 16) == seq->sar_width);
+                TEST_CHECK(test_GetBits(&br, 16) == seq->sar_height);
+            }
+        }
+        TEST_CHECK(test_GetBits(&br, 3) == 0);          /* overscan, video signal, chroma location */
+        TEST_CHECK(test_GetBits(&br, 1) == seq->vui_fields.bits.timing_info_present_flag);
+        if (seq->vui_fields.bits.timing_info_present_flag) {
+            TEST_CHECK(test_GetBits(&br, 32) == seq->num_units_in_tick);
+            TEST_CHECK(test_GetBits(&br, 32) == seq->time_scale);
+            TEST_CHECK(test_GetBits(&br, 1) == seq->vui_fields.bits.fixed_frame_rate_flag);
+        }
+        TEST_CHECK(test_GetBits(&br, 3) == 0);          /* HRD parameters, pic_struct_present_flag */
+        TEST_CHECK(test_GetBits(&br, 1) == seq->vui_fields.bits.bitstream_restriction_flag);
+        if (seq->vui_fields.bits.bitstream_restriction_flag) {
+            TEST_CHECK(test_GetBits(&br, 1) == seq->vui_fields.bits.motion_vectors_over_pic_boundaries_flag);
+            TEST_CHECK(test_GetUE(&br) == 0);           /* max_bytes_per_pic_denom */
+            TEST_CHECK(test_GetUE(&br) == 0);           /* max_bits_per_mb_denom */
+            TEST_CHECK(test_GetUE(&br) == seq->vui_fields.bits.log2_max_mv_length_horizontal);
+            TEST_CHECK(test_GetUE(&br) == seq->vui_fields.bits.log2_max_mv_length_vertical);
+            TEST_CHECK(test_GetUE(&br) == max_num_reorder_frames);
+            TEST_CHECK(test_GetUE(&br) == seq->max_num_ref_frames);
+        }
+    }
+    test_CheckTrailingBits(&br);
+}
+
+static void test_CheckH264PPS(const VAPackedHeader *header, const VAEncPictureParameterBufferH264 *pic)
+{
+    struct test_bitreader br;
+    size_t pos = 0;
+    int more = pic->pic_fields.bits.transform_8x8_mode_flag || pic->pic_fields.bits.pic_scaling_matrix_present_flag ||
+               pic->second_chroma_qp_index_offset != pic->chroma_qp_index_offset;
+
+    test_CheckHeader(header, VAEncPackedHeaderPicture);
+    test_NextNALUnit(header, &pos, &br);
+
+    TEST_CHECK(test_GetBits(&br, 8) == (0x60 | H264_NAL_PPS));
+    TEST_CHECK(test_GetUE(&br) == pic->pic_parameter_set_id);
+    TEST_CHECK(test_GetUE(&br) == pic->seq_parameter_set_id);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.entropy_coding_mode_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.pic_order_present_flag);
+    TEST_CHECK(test_GetUE(&br) == 0);                   /* num_slice_groups_minus1 */
+    TEST_CHECK(test_GetUE(&br) == pic->num_ref_idx_l0_active_minus1);
+    TEST_CHECK(test_GetUE(&br) == pic->num_ref_idx_l1_active_minus1);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.weighted_pred_flag);
+    TEST_CHECK(test_GetBits(&br, 2) == pic->pic_fields.bits.weighted_bipred_idc);
+    TEST_CHECK(test_GetSE(&br) == pic->pic_init_qp - 26);
+    TEST_CHECK(test_GetSE(&br) == 0);                   /* pic_init_qs_minus26 */
+    TEST_CHECK(test_GetSE(&br) == pic->chroma_qp_index_offset);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.deblocking_filter_control_present_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.constrained_intra_pred_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.redundant_pic_cnt_present_flag);
+    if (more) {
+        TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.transform_8x8_mode_flag);
+        TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.pic_scaling_matrix_present_flag);
+        /* 4:2:0 with transform_8x8_mode_flag: 8 pic_scaling_list_present_flag[] */
+        if (pic->pic_fields.bits.pic_scaling_matrix_present_flag)
+            TEST_CHECK(test_GetBits(&br, 6 + 2 * pic->pic_fields.bits.transform_8x8_mode_flag) == 0);
+        TEST_CHECK(test_GetSE(&br) == pic->second_chroma_qp_index_offset);
+    }
+    test_CheckTrailingBits(&br);
+}
+
+static void test_H264(void)
+{
+    VAEncSequenceParameterBufferH264 seq;
+    VAEncPictureParameterBufferH264 pic;
+    VAPackedHeaderWriter writer;
+    VAPackedHeader seq_header, pic_header, prev_seq, prev_pic;
+    uint32_t result;
+
+    test_InitH264(&seq, &pic);
+    TEST_CHECK(vaCreatePackedHeaderWriter(VAProfileH264High, NULL, &writer) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == (VA_PACKED_HEADER_SEQUENCE_CHANGED | VA_PACKED_HEADER_PICTURE_CHANGED));
+    /* ip_period 3 and the default options: one reordered frame */
+    test_CheckH264SPS(&seq_header, VAProfileH264High, &seq, 1);
+    test_CheckH264PPS(&pic_header, &pic);
+    prev_seq = seq_header;
+    prev_pic = pic_header;
+
+    /* the next picture: nothing the parameter sets carry changed */
+    pic.CurrPic.picture_id = 8;
+    pic.coded_buf = 10;
+    pic.frame_num = 2;
+    pic.pic_fields.bits.idr_pic_flag = 0;
+    pic.pic_fields.bits.reference_pic_flag = 1;
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == 0);
+    TEST_CHECK(seq_header.data == prev_seq.data && seq_header.param.bit_length == prev_seq.param.bit_length);
+    TEST_CHECK(pic_header.data == prev_pic.data && pic_header.param.bit_length == prev_pic.param.bit_length);
+
+    /* a sequence field the SPS does not carry: rewritten to the same bytes */
+    seq.bits_per_second = 6000000;
+    seq.intra_period = 60;
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == 0);
+    TEST_CHECK(seq_header.data == prev_seq.data);
+    TEST_CHECK(pic_header.data == prev_pic.data);
+
+    /* a PPS field */
+    pic.pic_init_qp = 22;
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == VA_PACKED_HEADER_PICTURE_CHANGED);
+    TEST_CHECK(seq_header.data == prev_seq.data);
+    TEST_CHECK(pic_header.data != prev_pic.data);
+    test_CheckH264PPS(&pic_header, &pic);
+    prev_pic = pic_header;
+
+    /* an SPS field: the PPS is written again but does not change */
+    seq.level_idc = 42;
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &seq, &pic, &seq_header, NULL,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == VA_PACKED_HEADER_SEQUENCE_CHANGED);
+    TEST_CHECK(seq_header.data != prev_seq.data);
+    test_CheckH264SPS(&seq_header, VAProfileH264High, &seq, 1);
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &seq, &pic, NULL, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == 0);
+    TEST_CHECK(pic_header.data == prev_pic.data);
+    test_CheckH264PPS(&pic_header, &pic);
+
+    /* values that cannot be coded leave the headers alone */
+    pic.pic_init_qp = 52;
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_ERROR_INVALID_PARAMETER);
+    pic.pic_init_qp = 22;
+    pic.pic_fields.bits.weighted_bipred_idc = 3;
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_ERROR_INVALID_PARAMETER);
+    pic.pic_fields.bits.weighted_bipred_idc = 2;
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == 0);
+    TEST_CHECK(pic_header.data == prev_pic.data);
+    TEST_CHECK(vaDestroyPackedHeaderWriter(writer) == VA_STATUS_SUCCESS);
+}
+
+/* constrained baseline: no High fields, POC type 1, field coding */
+static void test_H264Baseline(void)
+{
+    VAPackedHeaderOptions options;
+    VAEncSequenceParameterBufferH264 seq;
+    VAEncPictureParameterBufferH264 pic;
+    VAEncSequenceParameterBufferHEVC hevc_seq;
+    VAEncPictureParameterBufferHEVC hevc_pic;
+    VAPackedHeaderWriter writer;
+    VAPackedHeader seq_header, pic_header;
+    uint32_t result;
+
+    test_InitH264(&seq, &pic);
+    seq.seq_fields.bits.seq_scaling_matrix_present_flag = 0;
+    seq.seq_fields.bits.frame_mbs_only_flag = 0;
+    seq.seq_fields.bits.mb_adaptive_frame_field_flag = 1;
+    seq.seq_fields.bits.pic_order_cnt_type = 1;
+    seq.offset_for_non_ref_pic = -3;
+    seq.offset_for_top_to_bottom_field = 1;
+    seq.num_ref_frames_in_pic_order_cnt_cycle = 3;
+    seq.offset_for_ref_frame[0] = 2;
+    seq.offset_for_ref_frame[1] = -4;
+    seq.offset_for_ref_frame[2] = 6;
+    seq.frame_cropping_flag = 0;
+    seq.vui_fields.bits.aspect_ratio_info_present_flag = 0;
+    seq.vui_fields.bits.timing_info_present_flag = 0;
+    pic.pic_fields.bits.entropy_coding_mode_flag = 0;
+    pic.pic_fields.bits.weighted_pred_flag = 0;
+    pic.pic_fields.bits.weighted_bipred_idc = 0;
+    pic.pic_fields.bits.transform_8x8_mode_flag = 0;
+    pic.pic_fields.bits.pic_scaling_matrix_present_flag = 0;
+    pic.pic_fields.bits.constrained_intra_pred_flag = 1;
+    pic.second_chroma_qp_index_offset = pic.chroma_qp_index_offset;
+
+    memset(&options, 0, sizeof(options));
+    options.max_num_reorder_frames = 0;
+    TEST_CHECK(vaCreatePackedHeaderWriter(VAProfileH264ConstrainedBaseline, &options, &writer) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == (VA_PACKED_HEADER_SEQUENCE_CHANGED | VA_PACKED_HEADER_PICTURE_CHANGED));
+    test_CheckH264SPS(&seq_header, VAProfileH264ConstrainedBaseline, &seq, 0);
+    test_CheckH264PPS(&pic_header, &pic);
+    memset(&hevc_seq, 0, sizeof(hevc_seq));
+    memset(&hevc_pic, 0, sizeof(hevc_pic));
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &hevc_seq, &hevc_pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_ERROR_INVALID_CONTEXT);
+    TEST_CHECK(vaDestroyPackedHeaderWriter(writer) == VA_STATUS_SUCCESS);
+}
+
+static void test_InitHEVC(VAEncSequenceParameterBufferHEVC *seq, VAEncPictureParameterBufferHEVC *pic)
+{
+    memset(seq, 0, sizeof(*seq));
+    seq->general_profile_idc = 4;
+    seq->general_level_idc = 120;
+    seq->general_tier_flag = 1;
+    seq->intra_period = 32;
+    seq->ip_period = 1;
+    seq->bits_per_second = 20000000;
+    seq->pic_width_in_luma_samples = 1920;
+    seq->pic_height_in_luma_samples = 1088;
+    seq->seq_fields.bits.chroma_format_idc = 3;
+    seq->seq_fields.bits.scaling_list_enabled_flag = 1;
+    seq->seq_fields.bits.sample_adaptive_offset_enabled_flag = 1;
+    seq->seq_fields.bits.pcm_enabled_flag = 1;
+    seq->seq_fields.bits.pcm_loop_filter_disabled_flag = 1;
+    seq->seq_fields.bits.sps_temporal_mvp_enabled_flag = 1;
+    seq->log2_min_luma_coding_block_size_minus3 = 0;
+    seq->log2_diff_max_min_luma_coding_block_size = 3;
+    seq->log2_min_transform_block_size_minus2 = 0;
+    seq->log2_diff_max_min_transform_block_size = 3;
+    seq->max_transform_hierarchy_depth_inter = 3;
+    seq->max_transform_hierarchy_depth_intra = 2;
+    seq->pcm_sample_bit_depth_luma_minus1 = 7;
+    seq->pcm_sample_bit_depth_chroma_minus1 = 6;
+    seq->log2_min_pcm_luma_coding_block_size_minus3 = 0;
+    seq->log2_max_pcm_luma_coding_block_size_minus3 = 2;
+    seq->vui_parameters_present_flag = 1;
+    seq->vui_fields.bits.aspect_ratio_info_present_flag = 1;
+    seq->vui_fields.bits.vui_timing_info_present_flag = 1;
+    seq->vui_fields.bits.bitstream_restriction_flag = 1;
+    seq->vui_fields.bits.tiles_fixed_structure_flag = 1;
+    seq->vui_fields.bits.motion_vectors_over_pic_boundaries_flag = 1;
+    seq->vui_fields.bits.log2_max_mv_length_horizontal = 15;
+    seq->vui_fields.bits.log2_max_mv_length_vertical = 14;
+    seq->aspect_ratio_idc = 1;
+    seq->vui_num_units_in_tick = 1001;
+    seq->vui_time_scale = 60000;
+    seq->max_bytes_per_pic_denom = 2;
+    seq->max_bits_per_min_cu_denom = 1;
+
+    memset(pic, 0, sizeof(*pic));
+    pic->decoded_curr_pic.picture_id = 5;
+    pic->coded_buf = 6;
+    pic->slice_pic_parameter_set_id = 3;
+    pic->pic_init_qp = 22;
+    pic->pps_cb_qp_offset = -1;
+    pic->pps_cr_qp_offset = 1;
+    pic->num_tile_columns_minus1 = 2;
+    pic->num_tile_rows_minus1 = 1;
+    pic->column_width_minus1[0] = 4;
+    pic->column_width_minus1[1] = 5;
+    pic->row_height_minus1[0] = 3;
+    pic->log2_parallel_merge_level_minus2 = 2;
+    pic->num_ref_idx_l0_default_active_minus1 = 3;
+    pic->num_ref_idx_l1_default_active_minus1 = 1;
+    pic->pic_fields.bits.idr_pic_flag = 1;
+    pic->pic_fields.bits.dependent_slice_segments_enabled_flag = 1;
+    pic->pic_fields.bits.constrained_intra_pred_flag = 1;
+    pic->pic_fields.bits.transform_skip_enabled_flag = 1;
+    pic->pic_fields.bits.weighted_pred_flag = 1;
+    pic->pic_fields.bits.weighted_bipred_flag = 1;
+    pic->pic_fields.bits.transquant_bypass_enabled_flag = 1;
+    pic->pic_fields.bits.tiles_enabled_flag = 1;
+    pic->pic_fields.bits.entropy_coding_sync_enabled_flag = 1;
+    pic->pic_fields.bits.pps_loop_filter_across_slices_enabled_flag = 1;
+}
+
+static void test_CheckHEVCNALHeader(struct test_bitreader *br, unsigned int type)
+{
+    TEST_CHECK(test_GetBits(br, 16) == ((type << 9) | 1));
+}
+
+/* profile_tier_level() of a Main 4:4:4 stream */
+static void test_CheckHEVCProfileTierLevel(struct test_bitreader *br, const VAEncSequenceParameterBufferHEVC *seq)
+{
+    TEST_CHECK(test_GetBits(br, 2) == 0);               /* general_profile_space */
+    TEST_CHECK(test_GetBits(br, 1) == seq->general_tier_flag);
+    TEST_CHECK(test_GetBits(br, 5) == 4);
+    TEST_CHECK(test_GetBits(br, 32) == 0x08000000);     /* general_profile_compatibility_flag[4] */
+    TEST_CHECK(test_GetBits(br, 4) == 0x9);             /* progressive, frame only */
+    TEST_CHECK(test_GetBits(br, 9) == 0x1c1);           /* max 8 bits, 4:4:4, lower bit rate */
+    TEST_CHECK(test_GetBits(br, 32) == 0);
+    TEST_CHECK(test_GetBits(br, 2) == 0);
+    TEST_CHECK(test_GetBits(br, 1) == 0);               /* general_inbld_flag */
+    TEST_CHECK(test_GetBits(br, 8) == seq->general_level_idc);
+}
+
+static void test_CheckHEVCSequence(const VAPackedHeader *header, const VAPackedHeaderOptions *options,
+                                   const VAEncSequenceParameterBufferHEVC *seq)
+{
+    struct test_bitreader br;
+    size_t pos = 0;
+
+    test_CheckHeader(header, VAEncPackedHeaderSequence);
+
+    /* VPS: ip_period 1 and the default options, no reordering */
+    test_NextNALUnit(header, &pos, &br);
+    test_CheckHEVCNALHeader(&br, HEVC_NAL_VPS);
+    TEST_CHECK(test_GetBits(&br, 4) == 0);              /* vps_video_parameter_set_id */
+    TEST_CHECK(test_GetBits(&br, 2) == 3);              /* base layer internal and available */
+    TEST_CHECK(test_GetBits(&br, 6) == 0);              /* vps_max_layers_minus1 */
+    TEST_CHECK(test_GetBits(&br, 3) == 0);              /* vps_max_sub_layers_minus1 */
+    TEST_CHECK(test_GetBits(&br, 1) == 1);              /* vps_temporal_id_nesting_flag */
+    TEST_CHECK(test_GetBits(&br, 16) == 0xffff);
+    test_CheckHEVCProfileTierLevel(&br, seq);
+    TEST_CHECK(test_GetBits(&br, 1) == 0);              /* vps_sub_layer_ordering_info_present_flag */
+    TEST_CHECK(test_GetUE(&br) == 1);                   /* vps_max_dec_pic_buffering_minus1 */
+    TEST_CHECK(test_GetUE(&br) == 0);                   /* vps_max_num_reorder_pics */
+    TEST_CHECK(test_GetUE(&br) == 0);                   /* vps_max_latency_increase_plus1 */
+    TEST_CHECK(test_GetBits(&br, 6) == 0);              /* vps_max_layer_id */
+    TEST_CHECK(test_GetUE(&br) == 0);                   /* vps_num_layer_sets_minus1 */
+    TEST_CHECK(test_GetBits(&br, 1) == 1);              /* vps_timing_info_present_flag */
+    TEST_CHECK(test_GetBits(&br, 32) == seq->vui_num_units_in_tick);
+    TEST_CHECK(test_GetBits(&br, 32) == seq->vui_time_scale);
+    TEST_CHECK(test_GetBits(&br, 1) == 0);              /* vps_poc_proportional_to_timing_flag */
+    TEST_CHECK(test_GetUE(&br) == 0);                   /* vps_num_hrd_parameters */
+    TEST_CHECK(test_GetBits(&br, 1) == 0);              /* vps_extension_flag */
+    test_CheckTrailingBits(&br);
+
+    /* SPS */
+    test_NextNALUnit(header, &pos, &br);
+    TEST_CHECK(pos == (header->param.bit_length + 7) / 8);
+    test_CheckHEVCNALHeader(&br, HEVC_NAL_SPS);
+    TEST_CHECK(test_GetBits(&br, 4) == 0);              /* sps_video_parameter_set_id */
+    TEST_CHECK(test_GetBits(&br, 3) == 0);              /* sps_max_sub_layers_minus1 */
+    TEST_CHECK(test_GetBits(&br, 1) == 1);              /* sps_temporal_id_nesting_flag */
+    test_CheckHEVCProfileTierLevel(&br, seq);
+    TEST_CHECK(test_GetUE(&br) == 0);                   /* sps_seq_parameter_set_id */
+    TEST_CHECK(test_GetUE(&br) == 3);
+    TEST_CHECK(test_GetBits(&br, 1) == 0);              /* separate_colour_plane_flag */
+    TEST_CHECK(test_GetUE(&br) == seq->pic_width_in_luma_samples);
+    TEST_CHECK(test_GetUE(&br) == seq->pic_height_in_luma_samples);
+    /* conformance window in 4:4:4 chroma samples, that is luma samples */
+    TEST_CHECK(test_GetBits(&br, 1) == 1);
+    TEST_CHECK(test_GetUE(&br) == 0);
+    TEST_CHECK(test_GetUE(&br) == (uint32_t)(seq->pic_width_in_luma_samples - options->display_width));
+    TEST_CHECK(test_GetUE(&br) == 0);
+    TEST_CHECK(test_GetUE(&br) == (uint32_t)(seq->pic_height_in_luma_samples - options->display_height));
+    TEST_CHECK(test_GetUE(&br) == 0);                   /* bit_depth_luma_minus8 */
+    TEST_CHECK(test_GetUE(&br) == 0);                   /* bit_depth_chroma_minus8 */
+    TEST_CHECK(test_GetUE(&br) == options->log2_max_pic_order_cnt_lsb_minus4);
+    TEST_CHECK(test_GetBits(&br, 1) == 0);              /* sps_sub_layer_ordering_info_present_flag */
+    TEST_CHECK(test_GetUE(&br) == 1);
+    TEST_CHECK(test_GetUE(&br) == 0);
+    TEST_CHECK(test_GetUE(&br) == 0);
+    TEST_CHECK(test_GetUE(&br) == seq->log2_min_luma_coding_block_size_minus3);
+    TEST_CHECK(test_GetUE(&br) == seq->log2_diff_max_min_luma_coding_block_size);
+    TEST_CHECK(test_GetUE(&br) == seq->log2_min_transform_block_size_minus2);
+    TEST_CHECK(test_GetUE(&br) == seq->log2_diff_max_min_transform_block_size);
+    TEST_CHECK(test_GetUE(&br) == seq->max_transform_hierarchy_depth_inter);
+    TEST_CHECK(test_GetUE(&br) == seq->max_transform_hierarchy_depth_intra);
+    TEST_CHECK(test_GetBits(&br, 2) == 2);              /* scaling lists enabled, default ones */
+    TEST_CHECK(test_GetBits(&br, 1) == seq->seq_fields.bits.amp_enabled_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == seq->seq_fields.bits.sample_adaptive_offset_enabled_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == 1);              /* pcm_enabled_flag */
+    TEST_CHECK(test_GetBits(&br, 4) == seq->pcm_sample_bit_depth_luma_minus1);
+    TEST_CHECK(test_GetBits(&br, 4) == seq->pcm_sample_bit_depth_chroma_minus1);
+    TEST_CHECK(test_GetUE(&br) == seq->log2_min_pcm_luma_coding_block_size_minus3);
+    TEST_CHECK(test_GetUE(&br) == 2u);                  /* log2_diff_max_min_pcm_luma_coding_block_size */
+    TEST_CHECK(test_GetBits(&br, 1) == seq->seq_fields.bits.pcm_loop_filter_disabled_flag);
+    TEST_CHECK(test_GetUE(&br) == 0);                   /* num_short_term_ref_pic_sets */
+    TEST_CHECK(test_GetBits(&br, 1) == 0);              /* long_term_ref_pics_present_flag */
+    TEST_CHECK(test_GetBits(&br, 1) == seq->seq_fields.bits.sps_temporal_mvp_enabled_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == seq->seq_fields.bits.strong_intra_smoothing_enabled_flag);
+
+    TEST_CHECK(test_GetBits(&br, 1) == 1);              /* vui_parameters_present_flag */
+    TEST_CHECK(test_GetBits(&br, 1) == 1);              /* aspect_ratio_info_present_flag */
+    TEST_CHECK(test_GetBits(&br, 8) == seq->aspect_ratio_idc);
+    TEST_CHECK(test_GetBits(&br, 3) == 0);              /* overscan, video signal, chroma location */
+    TEST_CHECK(test_GetBits(&br, 1) == seq->vui_fields.bits.neutral_chroma_indication_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == seq->vui_fields.bits.field_seq_flag);
+    TEST_CHECK(test_GetBits(&br, 2) == 0);              /* frame field info, default display window */
+    TEST_CHECK(test_GetBits(&br, 1) == 1);              /* vui_timing_info_present_flag */
+    TEST_CHECK(test_GetBits(&br, 32) == seq->vui_num_units_in_tick);
+    TEST_CHECK(test_GetBits(&br, 32) == seq->vui_time_scale);
+    TEST_CHECK(test_GetBits(&br, 2) == 0);              /* POC proportional to timing, HRD parameters */
+    TEST_CHECK(test_GetBits(&br, 1) == 1);              /* bitstream_restriction_flag */
+    TEST_CHECK(test_GetBits(&br, 1) == seq->vui_fields.bits.tiles_fixed_structure_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == seq->vui_fields.bits.motion_vectors_over_pic_boundaries_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == seq->vui_fields.bits.restricted_ref_pic_lists_flag);
+    TEST_CHECK(test_GetUE(&br) == seq->min_spatial_segmentation_idc);
+    TEST_CHECK(test_GetUE(&br) == seq->max_bytes_per_pic_denom);
+    TEST_CHECK(test_GetUE(&br) == seq->max_bits_per_min_cu_denom);
+    TEST_CHECK(test_GetUE(&br) == seq->vui_fields.bits.log2_max_mv_length_horizontal);
+    TEST_CHECK(test_GetUE(&br) == seq->vui_fields.bits.log2_max_mv_length_vertical);
+    TEST_CHECK(test_GetBits(&br, 1) == 0);              /* sps_extension_present_flag */
+    test_CheckTrailingBits(&br);
+}
+
+static void test_CheckHEVCPPS(const VAPackedHeader *header, const VAEncPictureParameterBufferHEVC *pic)
+{
+    struct test_bitreader br;
+    size_t pos = 0;
+    unsigned int i;
+
+    test_CheckHeader(header, VAEncPackedHeaderPicture);
+    test_NextNALUnit(header, &pos, &br);
+    test_CheckHEVCNALHeader(&br, HEVC_NAL_PPS);
+    TEST_CHECK(test_GetUE(&br) == pic->slice_pic_parameter_set_id);
+    TEST_CHECK(test_GetUE(&br) == 0);                   /* pps_seq_parameter_set_id */
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.dependent_slice_segments_enabled_flag);
+    TEST_CHECK(test_GetBits(&br, 4) == 0);              /* output_flag_present_flag, num_extra_slice_header_bits */
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.sign_data_hiding_enabled_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == 0);              /* cabac_init_present_flag */
+    TEST_CHECK(test_GetUE(&br) == pic->num_ref_idx_l0_default_active_minus1);
+    TEST_CHECK(test_GetUE(&br) == pic->num_ref_idx_l1_default_active_minus1);
+    TEST_CHECK(test_GetSE(&br) == pic->pic_init_qp - 26);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.constrained_intra_pred_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.transform_skip_enabled_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.cu_qp_delta_enabled_flag);
+    if (pic->pic_fields.bits.cu_qp_delta_enabled_flag)
+        TEST_CHECK(test_GetUE(&br) == pic->diff_cu_qp_delta_depth);
+    TEST_CHECK(test_GetSE(&br) == pic->pps_cb_qp_offset);
+    TEST_CHECK(test_GetSE(&br) == pic->pps_cr_qp_offset);
+    TEST_CHECK(test_GetBits(&br, 1) == 0);              /* pps_slice_chroma_qp_offsets_present_flag */
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.weighted_pred_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.weighted_bipred_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.transquant_bypass_enabled_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.tiles_enabled_flag);
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.entropy_coding_sync_enabled_flag);
+    if (pic->pic_fields.bits.tiles_enabled_flag) {
+        TEST_CHECK(test_GetUE(&br) == pic->num_tile_columns_minus1);
+        TEST_CHECK(test_GetUE(&br) == pic->num_tile_rows_minus1);
+        TEST_CHECK(test_GetBits(&br, 1) == 0);          /* uniform_spacing_flag */
+        for (i = 0; i < (unsigned int)pic->num_tile_columns_minus1; i++)
+            TEST_CHECK(test_GetUE(&br) == pic->column_width_minus1[i]);
+        for (i = 0; i < (unsigned int)pic->num_tile_rows_minus1; i++)
+            TEST_CHECK(test_GetUE(&br) == pic->row_height_minus1[i]);
+        TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.loop_filter_across_tiles_enabled_flag);
+    }
+    TEST_CHECK(test_GetBits(&br, 1) == pic->pic_fields.bits.pps_loop_filter_across_slices_enabled_flag);
+    TEST_CHECK(test_GetBits(&br, 3) == 0);              /* deblocking control, scaling lists, list modification */
+    TEST_CHECK(test_GetUE(&br) == pic->log2_parallel_merge_level_minus2);
+    TEST_CHECK(test_GetBits(&br, 2) == 0);              /* slice header extension, PPS extension */
+    test_CheckTrailingBits(&br);
+}
+
+static void test_HEVC(void)
+{
+    VAPackedHeaderOptions options;
+    VAEncSequenceParameterBufferHEVC seq;
+    VAEncPictureParameterBufferHEVC pic;
+    VAEncSequenceParameterBufferH264 h264_seq;
+    VAEncPictureParameterBufferH264 h264_pic;
+    VAPackedHeaderWriter writer;
+    VAPackedHeader seq_header, pic_header, prev_seq, prev_pic;
+    uint32_t result;
+
+    test_InitHEVC(&seq, &pic);
+    memset(&options, 0, sizeof(options));
+    options.max_num_reorder_frames = 0xff;
+    options.log2_max_pic_order_cnt_lsb_minus4 = 6;
+    options.display_width = 1916;
+    options.display_height = 1080;
+
+    TEST_CHECK(vaCreatePackedHeaderWriter(VAProfileHEVCMain444, &options, &writer) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == (VA_PACKED_HEADER_SEQUENCE_CHANGED | VA_PACKED_HEADER_PICTURE_CHANGED));
+    test_CheckHEVCSequence(&seq_header, &options, &seq);
+    test_CheckHEVCPPS(&pic_header, &pic);
+    prev_seq = seq_header;
+    prev_pic = pic_header;
+
+    /* the next picture: nothing the parameter sets carry changed */
+    pic.decoded_curr_pic.picture_id = 8;
+    pic.coded_buf = 9;
+    pic.pic_fields.bits.idr_pic_flag = 0;
+    pic.pic_fields.bits.coding_type = 2;
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == 0);
+    TEST_CHECK(seq_header.data == prev_seq.data && pic_header.data == prev_pic.data);
+
+    pic.pic_fields.bits.tiles_enabled_flag = 0;
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == VA_PACKED_HEADER_PICTURE_CHANGED);
+    TEST_CHECK(seq_header.data == prev_seq.data && pic_header.data != prev_pic.data);
+    test_CheckHEVCPPS(&pic_header, &pic);
+    prev_pic = pic_header;
+
+    /* the tile sizes do not count without tiles */
+    pic.column_width_minus1[1] = 9;
+    pic.row_height_minus1[0] = 1;
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == 0);
+    TEST_CHECK(pic_header.data == prev_pic.data);
+
+    pic.pic_fields.bits.cu_qp_delta_enabled_flag = 1;
+    pic.diff_cu_qp_delta_depth = 2;
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == VA_PACKED_HEADER_PICTURE_CHANGED);
+    test_CheckHEVCPPS(&pic_header, &pic);
+
+    /* the VPS carries the level too */
+    seq.general_level_idc = 123;
+    seq.bits_per_second = 10000000;
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == VA_PACKED_HEADER_SEQUENCE_CHANGED);
+    TEST_CHECK(seq_header.data != prev_seq.data);
+    test_CheckHEVCSequence(&seq_header, &options, &seq);
+
+    pic.pic_init_qp = 52;
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_ERROR_INVALID_PARAMETER);
+    pic.pic_init_qp = 22;
+    pic.pic_fields.bits.tiles_enabled_flag = 1;
+    pic.num_tile_columns_minus1 = 20;
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_ERROR_INVALID_PARAMETER);
+    seq.log2_max_pcm_luma_coding_block_size_minus3 = 0;
+    seq.log2_min_pcm_luma_coding_block_size_minus3 = 1;
+    pic.num_tile_columns_minus1 = 2;
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_ERROR_INVALID_PARAMETER);
+
+    memset(&h264_seq, 0, sizeof(h264_seq));
+    memset(&h264_pic, 0, sizeof(h264_pic));
+    TEST_CHECK(vaWritePackedHeadersH264(writer, &h264_seq, &h264_pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_ERROR_INVALID_CONTEXT);
+    TEST_CHECK(vaDestroyPackedHeaderWriter(writer) == VA_STATUS_SUCCESS);
+}
+
+int main(void)
+{
+    VAPackedHeaderWriter writer;
+
+    TEST_CHECK(vaCreatePackedHeaderWriter(VAProfileH264MultiviewHigh, NULL,
+                                          &writer) == VA_STATUS_ERROR_UNSUPPORTED_PROFILE);
+    TEST_CHECK(vaCreatePackedHeaderWriter(VAProfileVP9Profile0, NULL,
+                                          &writer) == VA_STATUS_ERROR_UNSUPPORTED_PROFILE);
+
+    test_H264();
+    test_H264Baseline();
+    test_HEVC();
+    return 0;
+}
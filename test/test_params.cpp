@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * va_params.hpp built as C++17: the layout checks of the header, the
+ * param<> wrappers of a decode picture, a slice array, a misc parameter
+ * and a VPP filter, and the buffers param_arena creates from them on a
+ * display whose driver keeps a copy of each buffer.
+ */
+
+#include <va/va.h>
+#include <va/va_backend.h>
+#include <va/va_params.hpp>
+
+#include "test_common.h"
+
+#define TEST_MAX_BUFFERS    16
+#define TEST_CONTEXT        1
+
+struct test_buffer {
+    int alive;
+    VABufferType type;
+    unsigned int size;
+    unsigned int num_elements;
+    uint8_t *data;
+};
+
+static struct VADisplayContext test_display;
+static struct VADriverContext test_driver;
+static struct VADriverVTable test_vtable;
+
+static struct test_buffer test_buffers[TEST_MAX_BUFFERS];
+static unsigned int test_num_created;
+static VABufferID test_rendered[TEST_MAX_BUFFERS];
+static int test_num_rendered;
+
+static VAStatus test_CreateBuffer(VADriverContextP ctx, VAContextID context, VABufferType type,
+                                  unsigned int size, unsigned int num_elements, void *data,
+                                  VABufferID *buf_id)
+{
+    VABufferID id = 0;
+
+    while (++id < TEST_MAX_BUFFERS && test_buffers[id].alive)
+        ;
+    if (id == TEST_MAX_BUFFERS)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    test_buffers[id].alive = 1;
+    test_buffers[id].type = type;
+    test_buffers[id].size = size;
+    test_buffers[id].num_elements = num_elements;
+    test_buffers[id].data = (uint8_t *)calloc(num_elements, size);
+    TEST_CHECK(test_buffers[id].data);
+    if (data)
+        memcpy(test_buffers[id].data, data, (size_t)size * num_elements);
+    test_num_created++;
+    *buf_id = id;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_MapBuffer(VADriverContextP ctx, VABufferID buf_id, void **pbuf)
+{
+    TEST_CHECK(buf_id < TEST_MAX_BUFFERS && test_buffers[buf_id].alive);
+    *pbuf = test_buffers[buf_id].data;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_UnmapBuffer(VADriverContextP ctx, VABufferID buf_id)
+{
+    TEST_CHECK(buf_id < TEST_MAX_BUFFERS && test_buffers[buf_id].alive);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_DestroyBuffer(VADriverContextP ctx, VABufferID buf_id)
+{
+    TEST_CHECK(buf_id < TEST_MAX_BUFFERS && test_buffers[buf_id].alive);
+    free(test_buffers[buf_id].data);
+    test_buffers[buf_id].alive = 0;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_RenderPicture(VADriverContextP ctx, VAContextID context, VABufferID *buffers,
+                                   int num_buffers)
+{
+    TEST_CHECK(context == TEST_CONTEXT && num_buffers <= TEST_MAX_BUFFERS);
+    memcpy(test_rendered, buffers, num_buffers * sizeof(*buffers));
+    test_num_rendered = num_buffers;
+    return VA_STATUS_SUCCESS;
+}
+
+static int test_IsValid(VADisplayContextP dctx)
+{
+    return 1;
+}
+
+static VADisplay test_Display(void)
+{
+    test_vtable.vaCreateBuffer = test_CreateBuffer;
+    test_vtable.vaMapBuffer = test_MapBuffer;
+    test_vtable.vaUnmapBuffer = test_UnmapBuffer;
+    test_vtable.vaDestroyBuffer = test_DestroyBuffer;
+    test_vtable.vaRenderPicture = test_RenderPicture;
+    test_driver.vtable = &test_vtable;
+    test_driver.pDisplayContext = &test_display;
+    test_display.vadpy_magic = VA_DISPLAY_MAGIC;
+    test_display.pDriverContext = &test_driver;
+    test_display.vaIsValid = test_IsValid;
+    return &test_display;
+}
+
+/* the buffer types and the filter type are known at compile time */
+static_assert(va::param<VAPictureParameterBufferHEVC>::buffer_type == VAPictureParameterBufferType, "");
+static_assert(va::param<VASliceParameterBufferHEVC>::buffer_type == VASliceParameterBufferType, "");
+static_assert(va::param<VAEncMiscParameterRateControl>::buffer_type == VAEncMiscParameterBufferType, "");
+static_assert(va::param<VAProcFilterParameterBufferColorBalance>::buffer_type ==
+              VAProcFilterParameterBufferType, "");
+static_assert(sizeof(va::param<VASliceParameterBufferHEVC>) == sizeof(VASliceParameterBufferHEVC), "");
+static_assert(!va::has_buffer_type<VAProcFilterCap>::value, "");
+
+constexpr auto test_rc = va::make_param<VAEncMiscParameterRateControl>([](auto &p) {
+    p.bits_per_second = 4000000;
+    p.target_percentage = 90;
+});
+static_assert(test_rc->bits_per_second == 4000000 && test_rc->window_size == 0, "");
+
+constexpr va::param<VAProcFilterParameterBufferColorBalance> test_filter;
+static_assert(test_filter->type == VAProcFilterColorBalance && test_filter->value == 0.0f, "");
+
+/* stages a frame: a picture, three slices, a rate control and a filter */
+static void test_AddFrame(va::param_arena &arena, va::param<VAPictureParameterBufferHEVC> &pic,
+                          va::param<VASliceParameterBufferHEVC> *slices)
+{
+    va::param<VAProcFilterParameterBufferColorBalance> filter;
+
+    filter->attrib = VAProcColorBalanceSaturation;
+    filter->value = 1.5f;
+
+    arena.clear();
+    arena.add(pic);
+    arena.add(slices, 3);
+    arena.add(test_rc);
+    arena.add(filter);
+    TEST_CHECK(arena.size() == 4);
+}
+
+static const struct test_buffer *test_Buffer(VABufferID id, VABufferType type, size_t size,
+        unsigned int num_elements)
+{
+    TEST_CHECK(id < TEST_MAX_BUFFERS && test_buffers[id].alive);
+    TEST_CHECK(test_buffers[id].type == type);
+    TEST_CHECK(test_buffers[id].size == size);
+    TEST_CHECK(test_buffers[id].num_elements == num_elements);
+    return &test_buffers[id];
+}
+
+static void test_Arena(VADisplay dpy)
+{
+    va::param_arena arena;
+    va::param<VAPictureParameterBufferHEVC> pic;
+    va::param<VASliceParameterBufferHEVC> slices[3];
+    const struct test_buffer *b;
+    VAEncMiscParameterBuffer misc;
+    VAProcFilterParameterBufferColorBalance filter;
+    VABufferID ids[4];
+    unsigned int i;
+
+    pic->pic_width_in_luma_samples = 1920;
+    pic->pic_height_in_luma_samples = 1080;
+    pic->pic_fields.bits.chroma_format_idc = 1;
+    for (i = 0; i < 3; i++) {
+        slices[i]->slice_data_size = 100 + i;
+        slices[i]->slice_data_offset = 1000 * i;
+        slices[i]->slice_qp_delta = -(int8_t)i;
+    }
+
+    test_AddFrame(arena, pic, slices);
+    TEST_CHECK(arena.create(dpy, TEST_CONTEXT) == VA_STATUS_SUCCESS);
+    TEST_CHECK(arena.num_ids() == 4 && test_num_created == 4);
+    memcpy(ids, arena.ids(), sizeof(ids));
+
+    b = test_Buffer(ids[0], VAPictureParameterBufferType, sizeof(VAPictureParameterBufferHEVC), 1);
+    TEST_CHECK(memcmp(b->data, &pic.get(), sizeof(pic.get())) == 0);
+
+    b = test_Buffer(ids[1], VASliceParameterBufferType, sizeof(VASliceParameterBufferHEVC), 3);
+    for (i = 0; i < 3; i++)
+        TEST_CHECK(memcmp(b->data + i * sizeof(VASliceParameterBufferHEVC), &slices[i].get(),
+                          sizeof(VASliceParameterBufferHEVC)) == 0);
+
+    /* the misc payload follows its VAEncMiscParameterBuffer header */
+    b = test_Buffer(ids[2], VAEncMiscParameterBufferType,
+                    sizeof(VAEncMiscParameterBuffer) + sizeof(VAEncMiscParameterRateControl), 1);
+    memcpy(&misc, b->data, sizeof(misc));
+    TEST_CHECK(misc.type == VAEncMiscParameterTypeRateControl);
+    TEST_CHECK(memcmp(b->data + sizeof(misc), &test_rc.get(), sizeof(test_rc.get())) == 0);
+
+    b = test_Buffer(ids[3], VAProcFilterParameterBufferType,
+                    sizeof(VAProcFilterParameterBufferColorBalance), 1);
+    memcpy(&filter, b->data, sizeof(filter));
+    TEST_CHECK(filter.type == VAProcFilterColorBalance);
+    TEST_CHECK(filter.attrib == VAProcColorBalanceSaturation && filter.value == 1.5f);
+
+    TEST_CHECK(arena.render(dpy, TEST_CONTEXT) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_num_rendered == 4 && memcmp(test_rendered, ids, sizeof(ids)) == 0);
+    TEST_CHECK(arena.release(dpy) == VA_STATUS_SUCCESS);
+    TEST_CHECK(arena.num_ids() == 0);
+
+    /* the next frame reuses the released buffers, with its own content */
+    pic->pic_width_in_luma_samples = 1280;
+    test_AddFrame(arena, pic, slices);
+    TEST_CHECK(arena.create(dpy, TEST_CONTEXT) == VA_STATUS_SUCCESS);
+    TEST_CHECK(arena.num_ids() == 4 && test_num_created == 4);
+    for (i = 0; i < 4; i++)
+        TEST_CHECK(arena.ids()[i] == ids[i]);
+    b = test_Buffer(ids[0], VAPictureParameterBufferType, sizeof(VAPictureParameterBufferHEVC), 1);
+    TEST_CHECK(memcmp(b->data, &pic.get(), sizeof(pic.get())) == 0);
+
+    /* create() twice without release() */
+    TEST_CHECK(arena.create(dpy, TEST_CONTEXT) == VA_STATUS_ERROR_OPERATION_FAILED);
+    TEST_CHECK(arena.release(dpy) == VA_STATUS_SUCCESS);
+}
+
+int main(void)
+{
+    VADisplay dpy = test_Display();
+
+    test_Arena(dpy);
+
+    printf("test_params: ok\n");
+    return 0;
+}
@@ -0,0 +1,723 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * AV1 parser: a sequence header, a key frame in one frame OBU with two
+ * tiles, an inter frame in a frame header and two tile group OBUs, and a
+ * show_existing_frame header, all written here so that every value the
+ * parser reports is known. The stream is parsed with and without
+ * VA_AV1_PARSER_BATCH_TILE_GROUPS.
+ */
+
+#include <va/va.h>
+#include <va/va_parse_av1.h>
+
+#include "test_common.h"
+#include "test_bits.h"
+
+#define OBU_SEQUENCE_HEADER         1
+#define OBU_TEMPORAL_DELIMITER      2
+#define OBU_FRAME_HEADER            3
+#define OBU_TILE_GROUP              4
+#define OBU_FRAME                   6
+#define OBU_REDUNDANT_FRAME_HEADER  7
+
+/* 352x288 in 64x64 superblocks: 6x5 superblocks */
+#define TEST_WIDTH                  352
+#define TEST_HEIGHT                 288
+#define TEST_ORDER_HINT_BITS        7
+
+#define TEST_KEY_SURFACE            100
+#define TEST_INTER_SURFACE          101
+
+struct test_tile {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct test_stream {
+    uint8_t data[4096];
+    uint32_t size;
+    /* tiles of the key frame, then of the inter frame */
+    struct test_tile tiles[4];
+};
+
+static void test_PutSU(struct test_bitwriter *bw, unsigned int n, int32_t v)
+{
+    test_PutBits(bw, n, (uint32_t)v & ((1u << n) - 1));
+}
+
+/* ns(n) */
+static void test_PutNS(struct test_bitwriter *bw, uint32_t n, uint32_t v)
+{
+    unsigned int w = 0;
+    uint32_t m;
+
+    while (n >> w)
+        w++;
+    m = (1u << w) - n;
+    if (v < m) {
+        test_PutBits(bw, w - 1, v);
+    } else {
+        test_PutBits(bw, w - 1, m + ((v - m) >> 1));
+        test_PutBits(bw, 1, (v - m) & 1);
+    }
+}
+
+static void test_PutTileData(struct test_bitwriter *bw, uint32_t *state, struct test_tile *tile,
+                             uint32_t size)
+{
+    uint32_t i;
+
+    tile->offset = bw->size;
+    tile->size = size;
+    for (i = 0; i < size; i++)
+        test_PutBits(bw, 8, test_Random(state) >> 8);
+}
+
+/* an OBU with obu_has_size_field, returns the offset of its payload */
+static uint32_t test_PutOBU(struct test_stream *s, unsigned int type, const uint8_t *payload,
+                            uint32_t size)
+{
+    uint32_t v = size;
+
+    s->data[s->size++] = type << 3 | 0x02;
+    do {
+        s->data[s->size++] = (v & 0x7f) | (v > 0x7f ? 0x80 : 0);
+        v >>= 7;
+    } while (v);
+    if (size)
+        memcpy(s->data + s->size, payload, size);
+    s->size += size;
+    return s->size - size;
+}
+
+static void test_WriteSequenceHeader(struct test_stream *s)
+{
+    struct test_bitwriter bw;
+    uint8_t payload[64];
+
+    test_BitWriterInit(&bw, payload, 0);
+    test_PutBits(&bw, 3, 0);                    /* seq_profile */
+    test_PutBits(&bw, 1, 0);                    /* still_picture */
+    test_PutBits(&bw, 1, 0);                    /* reduced_still_picture_header */
+    test_PutBits(&bw, 1, 0);                    /* timing_info_present_flag */
+    test_PutBits(&bw, 1, 0);                    /* initial_display_delay_present_flag */
+    test_PutBits(&bw, 5, 0);                    /* operating_points_cnt_minus_1 */
+    test_PutBits(&bw, 12, 0);                   /* operating_point_idc[0] */
+    test_PutBits(&bw, 5, 8);                    /* seq_level_idx[0] */
+    test_PutBits(&bw, 1, 0);                    /* seq_tier[0] */
+    test_PutBits(&bw, 4, 9);                    /* frame_width_bits_minus_1 */
+    test_PutBits(&bw, 4, 8);                    /* frame_height_bits_minus_1 */
+    test_PutBits(&bw, 10, TEST_WIDTH - 1);
+    test_PutBits(&bw, 9, TEST_HEIGHT - 1);
+    test_PutBits(&bw, 1, 0);                    /* frame_id_numbers_present_flag */
+    test_PutBits(&bw, 1, 0);                    /* use_128x128_superblock */
+    test_PutBits(&bw, 1, 1);                    /* enable_filter_intra */
+    test_PutBits(&bw, 1, 1);                    /* enable_intra_edge_filter */
+    test_PutBits(&bw, 1, 1);                    /* enable_interintra_compound */
+    test_PutBits(&bw, 1, 0);                    /* enable_masked_compound */
+    test_PutBits(&bw, 1, 1);                    /* enable_warped_motion */
+    test_PutBits(&bw, 1, 1);                    /* enable_dual_filter */
+    test_PutBits(&bw, 1, 1);                    /* enable_order_hint */
+    test_PutBits(&bw, 1, 1);                    /* enable_jnt_comp */
+    test_PutBits(&bw, 1, 1);                    /* enable_ref_frame_mvs */
+    test_PutBits(&bw, 1, 1);                    /* seq_choose_screen_content_tools */
+    test_PutBits(&bw, 1, 1);                    /* seq_choose_integer_mv */
+    test_PutBits(&bw, 3, TEST_ORDER_HINT_BITS - 1);
+    test_PutBits(&bw, 1, 0);                    /* enable_superres */
+    test_PutBits(&bw, 1, 1);                    /* enable_cdef */
+    test_PutBits(&bw, 1, 1);                    /* enable_restoration */
+    test_PutBits(&bw, 1, 0);                    /* high_bitdepth */
+    test_PutBits(&bw, 1, 0);                    /* mono_chrome */
+    test_PutBits(&bw, 1, 0);                    /* color_description_present_flag */
+    test_PutBits(&bw, 1, 1);                    /* color_range */
+    test_PutBits(&bw, 2, 0);                    /* chroma_sample_position */
+    test_PutBits(&bw, 1, 0);                    /* separate_uv_delta_q */
+    test_PutBits(&bw, 1, 0);                    /* film_grain_params_present */
+    test_PutTrailingBits(&bw);
+    test_PutOBU(s, OBU_SEQUENCE_HEADER, payload, bw.size);
+}
+
+static void test_WriteTemporalDelimiter(struct test_stream *s)
+{
+    test_PutOBU(s, OBU_TEMPORAL_DELIMITER, NULL, 0);
+}
+
+/* a shown key frame in a frame OBU, with two uniform tile columns */
+static void test_WriteKeyFrame(struct test_stream *s, uint32_t *state)
+{
+    struct test_bitwriter bw;
+    uint8_t payload[1024];
+    uint32_t offset;
+    int i;
+
+    test_BitWriterInit(&bw, payload, 0);
+    test_PutBits(&bw, 1, 0);                    /* show_existing_frame */
+    test_PutBits(&bw, 2, 0);                    /* frame_type, KEY_FRAME */
+    test_PutBits(&bw, 1, 1);                    /* show_frame */
+    test_PutBits(&bw, 1, 0);                    /* disable_cdf_update */
+    test_PutBits(&bw, 1, 0);                    /* allow_screen_content_tools */
+    test_PutBits(&bw, 1, 0);                    /* frame_size_override_flag */
+    test_PutBits(&bw, TEST_ORDER_HINT_BITS, 0); /* order_hint */
+    test_PutBits(&bw, 1, 0);                    /* render_and_frame_size_different */
+    test_PutBits(&bw, 1, 0);                    /* disable_frame_end_update_cdf */
+
+    /* tile_info() */
+    test_PutBits(&bw, 1, 1);                    /* uniform_tile_spacing_flag */
+    test_PutBits(&bw, 1, 1);                    /* increment_tile_cols_log2 */
+    test_PutBits(&bw, 1, 0);
+    test_PutBits(&bw, 1, 0);                    /* increment_tile_rows_log2 */
+    test_PutBits(&bw, 1, 1);                    /* context_update_tile_id */
+    test_PutBits(&bw, 2, 1);                    /* tile_size_bytes_minus_1 */
+
+    /* quantization_params() */
+    test_PutBits(&bw, 8, 120);                  /* base_q_idx */
+    test_PutBits(&bw, 1, 1);
+    test_PutSU(&bw, 7, -3);                     /* DeltaQYDc */
+    test_PutBits(&bw, 1, 0);                    /* DeltaQUDc */
+    test_PutBits(&bw, 1, 1);
+    test_PutSU(&bw, 7, 5);                      /* DeltaQUAc */
+    test_PutBits(&bw, 1, 1);                    /* using_qmatrix */
+    test_PutBits(&bw, 4, 5);                    /* qm_y */
+    test_PutBits(&bw, 4, 7);                    /* qm_u */
+
+    test_PutBits(&bw, 1, 0);                    /* segmentation_enabled */
+    test_PutBits(&bw, 1, 1);                    /* delta_q_present */
+    test_PutBits(&bw, 2, 2);                    /* delta_q_res */
+    test_PutBits(&bw, 1, 1);                    /* delta_lf_present */
+    test_PutBits(&bw, 2, 1);                    /* delta_lf_res */
+    test_PutBits(&bw, 1, 1);                    /* delta_lf_multi */
+
+    /* loop_filter_params() */
+    test_PutBits(&bw, 6, 10);
+    test_PutBits(&bw, 6, 12);
+    test_PutBits(&bw, 6, 3);
+    test_PutBits(&bw, 6, 4);
+    test_PutBits(&bw, 3, 2);                    /* loop_filter_sharpness */
+    test_PutBits(&bw, 1, 1);                    /* loop_filter_delta_enabled */
+    test_PutBits(&bw, 1, 1);                    /* loop_filter_delta_update */
+    for (i = 0; i < 8; i++) {
+        test_PutBits(&bw, 1, i == 0 || i == 5);
+        if (i == 0)
+            test_PutSU(&bw, 7, 2);
+        else if (i == 5)
+            test_PutSU(&bw, 7, -2);
+    }
+    test_PutBits(&bw, 1, 1);
+    test_PutSU(&bw, 7, -1);                     /* loop_filter_mode_deltas[0] */
+    test_PutBits(&bw, 1, 0);
+
+    /* cdef_params() */
+    test_PutBits(&bw, 2, 3);                    /* cdef_damping_minus_3 */
+    test_PutBits(&bw, 2, 1);                    /* cdef_bits */
+    test_PutBits(&bw, 6, 0x15);
+    test_PutBits(&bw, 6, 0x06);
+    test_PutBits(&bw, 6, 0x22);
+    test_PutBits(&bw, 6, 0x01);
+
+    /* lr_params(): WIENER, NONE, SGRPROJ */
+    test_PutBits(&bw, 2, 2);
+    test_PutBits(&bw, 2, 0);
+    test_PutBits(&bw, 2, 3);
+    test_PutBits(&bw, 1, 1);                    /* lr_unit_shift */
+    test_PutBits(&bw, 1, 0);                    /* lr_unit_extra_shift */
+    test_PutBits(&bw, 1, 1);                    /* lr_uv_shift */
+
+    test_PutBits(&bw, 1, 1);                    /* tx_mode_select */
+    test_PutBits(&bw, 1, 0);                    /* reduced_tx_set */
+    test_PutZeroPadding(&bw);                   /* byte_alignment() */
+
+    /* tile_group_obu() */
+    test_PutBits(&bw, 1, 0);                    /* tile_start_and_end_present_flag */
+    test_PutZeroPadding(&bw);
+    test_PutBits(&bw, 8, 36);                   /* tile_size_minus_1, le(2) */
+    test_PutBits(&bw, 8, 0);
+    test_PutTileData(&bw, state, &s->tiles[0], 37);
+    test_PutTileData(&bw, state, &s->tiles[1], 300);
+
+    offset = test_PutOBU(s, OBU_FRAME, payload, bw.size);
+    s->tiles[0].offset += offset;
+    s->tiles[1].offset += offset;
+}
+
+/*
+ * An inter frame using the key frame in slot 0 and loading its state,
+ * with segmentation and two tile columns of 2 and 4 superblocks.
+ */
+static void test_WriteInterFrame(struct test_stream *s, uint32_t *state)
+{
+    struct test_bitwriter bw;
+    uint8_t payload[1024];
+    uint32_t offset;
+    int i, j;
+
+    test_BitWriterInit(&bw, payload, 0);
+    test_PutBits(&bw, 1, 0);                    /* show_existing_frame */
+    test_PutBits(&bw, 2, 1);                    /* frame_type, INTER_FRAME */
+    test_PutBits(&bw, 1, 1);                    /* show_frame */
+    test_PutBits(&bw, 1, 0);                    /* error_resilient_mode */
+    test_PutBits(&bw, 1, 0);                    /* disable_cdf_update */
+    test_PutBits(&bw, 1, 1);                    /* allow_screen_content_tools */
+    test_PutBits(&bw, 1, 0);                    /* force_integer_mv */
+    test_PutBits(&bw, 1, 0);                    /* frame_size_override_flag */
+    test_PutBits(&bw, TEST_ORDER_HINT_BITS, 1); /* order_hint */
+    test_PutBits(&bw, 3, 0);                    /* primary_ref_frame */
+    test_PutBits(&bw, 8, 0x02);                 /* refresh_frame_flags */
+    test_PutBits(&bw, 1, 0);                    /* frame_refs_short_signaling */
+    for (i = 0; i < 7; i++)
+        test_PutBits(&bw, 3, i == 3 ? 4 : 0);   /* ref_frame_idx[] */
+    test_PutBits(&bw, 1, 0);                    /* render_and_frame_size_different */
+    test_PutBits(&bw, 1, 1);                    /* allow_high_precision_mv */
+    test_PutBits(&bw, 1, 0);                    /* is_filter_switchable */
+    test_PutBits(&bw, 2, 2);                    /* interpolation_filter */
+    test_PutBits(&bw, 1, 1);                    /* is_motion_mode_switchable */
+    test_PutBits(&bw, 1, 1);                    /* use_ref_frame_mvs */
+    test_PutBits(&bw, 1, 1);                    /* disable_frame_end_update_cdf */
+
+    /* tile_info() */
+    test_PutBits(&bw, 1, 0);                    /* uniform_tile_spacing_flag */
+    test_PutNS(&bw, 6, 1);                      /* width_in_sbs_minus_1 */
+    test_PutNS(&bw, 4, 3);
+    test_PutNS(&bw, 5, 4);                      /* height_in_sbs_minus_1 */
+    test_PutBits(&bw, 1, 0);                    /* context_update_tile_id */
+    test_PutBits(&bw, 2, 0);                    /* tile_size_bytes_minus_1 */
+
+    test_PutBits(&bw, 8, 80);                   /* base_q_idx */
+    test_PutBits(&bw, 3, 0);                    /* no DeltaQ */
+    test_PutBits(&bw, 1, 0);                    /* using_qmatrix */
+
+    /* segmentation_params() */
+    test_PutBits(&bw, 1, 1);                    /* segmentation_enabled */
+    test_PutBits(&bw, 1, 1);                    /* segmentation_update_map */
+    test_PutBits(&bw, 1, 0);                    /* segmentation_temporal_update */
+    test_PutBits(&bw, 1, 1);                    /* segmentation_update_data */
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 8; j++) {
+            if (i == 1 && j == 0) {
+                test_PutBits(&bw, 1, 1);
+                test_PutSU(&bw, 9, -20);        /* SEG_LVL_ALT_Q */
+            } else if (i == 3 && j == 5) {
+                test_PutBits(&bw, 1, 1);
+                test_PutBits(&bw, 3, 6);        /* SEG_LVL_REF_FRAME */
+            } else if (i == 3 && j == 6) {
+                test_PutBits(&bw, 1, 1);        /* SEG_LVL_SKIP */
+            } else {
+                test_PutBits(&bw, 1, 0);
+            }
+        }
+    }
+    test_PutBits(&bw, 1, 0);                    /* delta_q_present */
+
+    test_PutBits(&bw, 6, 0);                    /* loop_filter_level[0] */
+    test_PutBits(&bw, 6, 0);                    /* loop_filter_level[1] */
+    test_PutBits(&bw, 3, 0);                    /* loop_filter_sharpness */
+    test_PutBits(&bw, 1, 1);                    /* loop_filter_delta_enabled */
+    test_PutBits(&bw, 1, 0);                    /* loop_filter_delta_update */
+    test_PutBits(&bw, 4, 0);                    /* cdef damping and bits */
+    test_PutBits(&bw, 12, 0);                   /* cdef strengths */
+    test_PutBits(&bw, 6, 0);                    /* lr_type */
+
+    test_PutBits(&bw, 1, 0);                    /* tx_mode_select */
+    test_PutBits(&bw, 1, 1);                    /* reference_select */
+    test_PutBits(&bw, 1, 1);                    /* allow_warped_motion */
+    test_PutBits(&bw, 1, 1);                    /* reduced_tx_set */
+    test_PutBits(&bw, 7, 0);                    /* is_global */
+    test_PutTrailingBits(&bw);
+    test_PutOBU(s, OBU_FRAME_HEADER, payload, bw.size);
+
+    /* one tile group per tile */
+    for (i = 0; i < 2; i++) {
+        test_BitWriterInit(&bw, payload, 0);
+        test_PutBits(&bw, 1, 1);                /* tile_start_and_end_present_flag */
+        test_PutBits(&bw, 1, i);                /* tg_start */
+        test_PutBits(&bw, 1, i);                /* tg_end */
+        test_PutZeroPadding(&bw);
+        test_PutTileData(&bw, state, &s->tiles[2 + i], 20 + 150 * i);
+        offset = test_PutOBU(s, OBU_TILE_GROUP, payload, bw.size);
+        s->tiles[2 + i].offset += offset;
+    }
+}
+
+static void test_WriteShowExistingFrame(struct test_stream *s, unsigned int slot)
+{
+    struct test_bitwriter bw;
+    uint8_t payload[4];
+
+    test_BitWriterInit(&bw, payload, 0);
+    test_PutBits(&bw, 1, 1);                    /* show_existing_frame */
+    test_PutBits(&bw, 3, slot);                 /* frame_to_show_map_idx */
+    test_PutTrailingBits(&bw);
+    test_PutOBU(s, OBU_FRAME_HEADER, payload, bw.size);
+}
+
+static void test_CheckSequence(const VAAV1PictureParams *params)
+{
+    const VADecPictureParameterBufferAV1 *pp = &params->pic_param;
+
+    TEST_CHECK(params->profile == VAProfileAV1Profile0);
+    TEST_CHECK(pp->profile == 0 && pp->bit_depth_idx == 0);
+    TEST_CHECK(pp->order_hint_bits_minus_1 == TEST_ORDER_HINT_BITS - 1);
+    TEST_CHECK(pp->matrix_coefficients == 2);
+    TEST_CHECK(!pp->seq_info_fields.fields.still_picture);
+    TEST_CHECK(!pp->seq_info_fields.fields.use_128x128_superblock);
+    TEST_CHECK(pp->seq_info_fields.fields.enable_filter_intra);
+    TEST_CHECK(pp->seq_info_fields.fields.enable_intra_edge_filter);
+    TEST_CHECK(pp->seq_info_fields.fields.enable_interintra_compound);
+    TEST_CHECK(!pp->seq_info_fields.fields.enable_masked_compound);
+    TEST_CHECK(pp->seq_info_fields.fields.enable_dual_filter);
+    TEST_CHECK(pp->seq_info_fields.fields.enable_order_hint);
+    TEST_CHECK(pp->seq_info_fields.fields.enable_jnt_comp);
+    TEST_CHECK(pp->seq_info_fields.fields.enable_cdef);
+    TEST_CHECK(!pp->seq_info_fields.fields.mono_chrome);
+    TEST_CHECK(pp->seq_info_fields.fields.color_range);
+    TEST_CHECK(pp->seq_info_fields.fields.subsampling_x && pp->seq_info_fields.fields.subsampling_y);
+    TEST_CHECK(!pp->seq_info_fields.fields.film_grain_params_present);
+}
+
+static void test_CheckKeyFrame(const VAAV1PictureParams *params)
+{
+    const VADecPictureParameterBufferAV1 *pp = &params->pic_param;
+    int i;
+
+    test_CheckSequence(params);
+    TEST_CHECK(!params->show_existing_frame);
+    TEST_CHECK(pp->current_frame == TEST_KEY_SURFACE);
+    TEST_CHECK(pp->current_display_picture == TEST_KEY_SURFACE);
+    for (i = 0; i < 8; i++)
+        TEST_CHECK(pp->ref_frame_map[i] == VA_INVALID_SURFACE);
+    TEST_CHECK(pp->frame_width_minus1 == TEST_WIDTH - 1);
+    TEST_CHECK(pp->frame_height_minus1 == TEST_HEIGHT - 1);
+    TEST_CHECK(pp->pic_info_fields.bits.frame_type == 0);
+    TEST_CHECK(pp->pic_info_fields.bits.show_frame);
+    TEST_CHECK(!pp->pic_info_fields.bits.showable_frame);
+    TEST_CHECK(pp->pic_info_fields.bits.error_resilient_mode);
+    TEST_CHECK(!pp->pic_info_fields.bits.allow_screen_content_tools);
+    TEST_CHECK(pp->pic_info_fields.bits.force_integer_mv);
+    TEST_CHECK(!pp->pic_info_fields.bits.disable_frame_end_update_cdf);
+    TEST_CHECK(pp->order_hint == 0);
+    TEST_CHECK(pp->primary_ref_frame == 7);
+    TEST_CHECK(pp->superres_scale_denominator == 8);
+
+    TEST_CHECK(pp->pic_info_fields.bits.uniform_tile_spacing_flag);
+    TEST_CHECK(pp->tile_cols == 2 && pp->tile_rows == 1);
+    TEST_CHECK(pp->width_in_sbs_minus_1[0] == 2 && pp->width_in_sbs_minus_1[1] == 2);
+    TEST_CHECK(pp->height_in_sbs_minus_1[0] == 4);
+    TEST_CHECK(pp->context_update_tile_id == 1);
+
+    TEST_CHECK(pp->base_qindex == 120);
+    TEST_CHECK(pp->y_dc_delta_q == -3);
+    TEST_CHECK(pp->u_dc_delta_q == 0 && pp->u_ac_delta_q == 5);
+    TEST_CHECK(pp->v_dc_delta_q == 0 && pp->v_ac_delta_q == 5);
+    TEST_CHECK(pp->qmatrix_fields.bits.using_qmatrix);
+    TEST_CHECK(pp->qmatrix_fields.bits.qm_y == 5);
+    TEST_CHECK(pp->qmatrix_fields.bits.qm_u == 7 && pp->qmatrix_fields.bits.qm_v == 7);
+    TEST_CHECK(!pp->seg_info.segment_info_fields.bits.enabled);
+    TEST_CHECK(pp->mode_control_fields.bits.delta_q_present_flag);
+    TEST_CHECK(pp->mode_control_fields.bits.log2_delta_q_res == 2);
+    TEST_CHECK(pp->mode_control_fields.bits.delta_lf_present_flag);
+    TEST_CHECK(pp->mode_control_fields.bits.log2_delta_lf_res == 1);
+    TEST_CHECK(pp->mode_control_fields.bits.delta_lf_multi);
+
+    TEST_CHECK(pp->filter_level[0] == 10 && pp->filter_level[1] == 12);
+    TEST_CHECK(pp->filter_level_u == 3 && pp->filter_level_v == 4);
+    TEST_CHECK(pp->loop_filter_info_fields.bits.sharpness_level == 2);
+    TEST_CHECK(pp->loop_filter_info_fields.bits.mode_ref_delta_enabled);
+    TEST_CHECK(pp->loop_filter_info_fields.bits.mode_ref_delta_update);
+    /* the default deltas with two updates */
+    TEST_CHECK(pp->ref_deltas[0] == 2 && pp->ref_deltas[1] == 0 && pp->ref_deltas[4] == -1);
+    TEST_CHECK(pp->ref_deltas[5] == -2 && pp->ref_deltas[6] == -1 && pp->ref_deltas[7] == -1);
+    TEST_CHECK(pp->mode_deltas[0] == -1 && pp->mode_deltas[1] == 0);
+
+    TEST_CHECK(pp->cdef_damping_minus_3 == 3 && pp->cdef_bits == 1);
+    TEST_CHECK(pp->cdef_y_strengths[0] == 0x15 && pp->cdef_uv_strengths[0] == 0x06);
+    TEST_CHECK(pp->cdef_y_strengths[1] == 0x22 && pp->cdef_uv_strengths[1] == 0x01);
+    /* VA numbers the restoration types NONE, WIENER, SGRPROJ, SWITCHABLE */
+    TEST_CHECK(pp->loop_restoration_fields.bits.yframe_restoration_type == 1);
+    TEST_CHECK(pp->loop_restoration_fields.bits.cbframe_restoration_type == 0);
+    TEST_CHECK(pp->loop_restoration_fields.bits.crframe_restoration_type == 2);
+    TEST_CHECK(pp->loop_restoration_fields.bits.lr_unit_shift == 1);
+    TEST_CHECK(pp->loop_restoration_fields.bits.lr_uv_shift == 1);
+    TEST_CHECK(pp->mode_control_fields.bits.tx_mode == 2);
+    TEST_CHECK(!pp->mode_control_fields.bits.reference_select);
+    TEST_CHECK(!pp->mode_control_fields.bits.reduced_tx_set_used);
+    for (i = 0; i < 7; i++)
+        TEST_CHECK(pp->wm[i].wmtype == VAAV1TransformationIdentity);
+}
+
+static void test_CheckInterFrame(const VAAV1PictureParams *params)
+{
+    const VADecPictureParameterBufferAV1 *pp = &params->pic_param;
+    int i;
+
+    test_CheckSequence(params);
+    TEST_CHECK(pp->current_frame == TEST_INTER_SURFACE);
+    for (i = 0; i < 8; i++)
+        TEST_CHECK(pp->ref_frame_map[i] == TEST_KEY_SURFACE);
+    for (i = 0; i < 7; i++)
+        TEST_CHECK(pp->ref_frame_idx[i] == (i == 3 ? 4 : 0));
+    TEST_CHECK(pp->frame_width_minus1 == TEST_WIDTH - 1);
+    TEST_CHECK(pp->pic_info_fields.bits.frame_type == 1);
+    TEST_CHECK(pp->pic_info_fields.bits.show_frame && pp->pic_info_fields.bits.showable_frame);
+    TEST_CHECK(!pp->pic_info_fields.bits.error_resilient_mode);
+    TEST_CHECK(pp->pic_info_fields.bits.allow_screen_content_tools);
+    TEST_CHECK(!pp->pic_info_fields.bits.force_integer_mv);
+    TEST_CHECK(!pp->pic_info_fields.bits.allow_intrabc);
+    TEST_CHECK(pp->order_hint == 1 && pp->primary_ref_frame == 0);
+    TEST_CHECK(pp->pic_info_fields.bits.allow_high_precision_mv);
+    TEST_CHECK(pp->interp_filter == 2);
+    TEST_CHECK(pp->pic_info_fields.bits.is_motion_mode_switchable);
+    TEST_CHECK(pp->pic_info_fields.bits.use_ref_frame_mvs);
+    TEST_CHECK(pp->pic_info_fields.bits.disable_frame_end_update_cdf);
+
+    TEST_CHECK(!pp->pic_info_fields.bits.uniform_tile_spacing_flag);
+    TEST_CHECK(pp->tile_cols == 2 && pp->tile_rows == 1);
+    TEST_CHECK(pp->width_in_sbs_minus_1[0] == 1 && pp->width_in_sbs_minus_1[1] == 3);
+    TEST_CHECK(pp->height_in_sbs_minus_1[0] == 4);
+    TEST_CHECK(pp->context_update_tile_id == 0);
+
+    TEST_CHECK(pp->base_qindex == 80 && !pp->y_dc_delta_q && !pp->u_ac_delta_q);
+    TEST_CHECK(!pp->qmatrix_fields.bits.using_qmatrix);
+    TEST_CHECK(pp->seg_info.segment_info_fields.bits.enabled);
+    TEST_CHECK(pp->seg_info.segment_info_fields.bits.update_map);
+    TEST_CHECK(!pp->seg_info.segment_info_fields.bits.temporal_update);
+    TEST_CHECK(pp->seg_info.segment_info_fields.bits.update_data);
+    for (i = 0; i < 8; i++) {
+        TEST_CHECK(pp->seg_info.feature_mask[i] == (i == 1 ? 0x01 : i == 3 ? 0x60 : 0));
+        TEST_CHECK(pp->seg_info.feature_data[i][0] == (i == 1 ? -20 : 0));
+        TEST_CHECK(pp->seg_info.feature_data[i][5] == (i == 3 ? 6 : 0));
+    }
+    TEST_CHECK(!pp->mode_control_fields.bits.delta_q_present_flag);
+
+    TEST_CHECK(pp->filter_level[0] == 0 && pp->filter_level[1] == 0);
+    TEST_CHECK(pp->loop_filter_info_fields.bits.mode_ref_delta_enabled);
+    TEST_CHECK(!pp->loop_filter_info_fields.bits.mode_ref_delta_update);
+    /* loaded from the key frame through primary_ref_frame */
+    TEST_CHECK(pp->ref_deltas[0] == 2 && pp->ref_deltas[5] == -2);
+    TEST_CHECK(pp->mode_deltas[0] == -1);
+    TEST_CHECK(pp->cdef_bits == 0 && pp->cdef_y_strengths[0] == 0);
+    TEST_CHECK(pp->loop_restoration_fields.bits.yframe_restoration_type == 0);
+    TEST_CHECK(pp->mode_control_fields.bits.tx_mode == 1);
+    TEST_CHECK(pp->mode_control_fields.bits.reference_select);
+    TEST_CHECK(!pp->mode_control_fields.bits.skip_mode_present);
+    TEST_CHECK(pp->pic_info_fields.bits.allow_warped_motion);
+    TEST_CHECK(pp->mode_control_fields.bits.reduced_tx_set_used);
+}
+
+static void test_CheckTiles(const struct test_tile *expected, const VASliceParameterBufferAV1 *tiles,
+                            uint32_t num_tiles, unsigned int first)
+{
+    uint32_t i;
+
+    for (i = 0; i < num_tiles; i++) {
+        TEST_CHECK(tiles[i].slice_data_offset == expected[i].offset);
+        TEST_CHECK(tiles[i].slice_data_size == expected[i].size);
+        TEST_CHECK(tiles[i].slice_data_flag == VA_SLICE_DATA_FLAG_ALL);
+        TEST_CHECK(tiles[i].tile_row == 0 && tiles[i].tile_column == first + i);
+    }
+}
+
+static void test_Parse(const struct test_stream *s, uint32_t flags)
+{
+    int batch = !!(flags & VA_AV1_PARSER_BATCH_TILE_GROUPS);
+    unsigned int num_frames = 0, num_tile_groups = 0, num_shown = 0;
+    VAAV1PictureParams params;
+    VAAV1Parser parser;
+    uint32_t pos = 0;
+
+    TEST_CHECK(vaCreateAV1Parser(flags, &parser) == VA_STATUS_SUCCESS);
+    while (pos < s->size) {
+        const VASliceParameterBufferAV1 *tiles;
+        uint32_t obu_size, result, num_tiles;
+        unsigned int type = (s->data[pos] >> 3) & 0xf;
+
+        TEST_CHECK(vaParseAV1OBU(parser, s->data + pos, s->size - pos, pos, &obu_size, &result,
+                                 &tiles, &num_tiles) == VA_STATUS_SUCCESS);
+        TEST_CHECK(obu_size > 0 && pos + obu_size <= s->size);
+        TEST_CHECK(!(result & VA_AV1_PARSE_SKIPPED));
+
+        switch (type) {
+        case OBU_SEQUENCE_HEADER:
+            TEST_CHECK(result == VA_AV1_PARSE_SEQUENCE);
+            break;
+        case OBU_TEMPORAL_DELIMITER:
+            TEST_CHECK(result == 0);
+            break;
+        case OBU_FRAME:
+            TEST_CHECK(result == (VA_AV1_PARSE_PICTURE | VA_AV1_PARSE_TILES | VA_AV1_PARSE_FRAME_END));
+            TEST_CHECK(num_frames == 0);
+            TEST_CHECK(vaGetAV1PictureParams(parser, TEST_KEY_SURFACE, &params) == VA_STATUS_SUCCESS);
+            test_CheckKeyFrame(&params);
+            TEST_CHECK(num_tiles == 2);
+            test_CheckTiles(&s->tiles[0], tiles, num_tiles, 0);
+            num_frames++;
+            break;
+        case OBU_FRAME_HEADER:
+            if (num_frames == 1) {
+                TEST_CHECK(result == VA_AV1_PARSE_PICTURE);
+                TEST_CHECK(vaGetAV1PictureParams(parser, TEST_INTER_SURFACE, &params) == VA_STATUS_SUCCESS);
+                test_CheckInterFrame(&params);
+                num_frames++;
+                break;
+            }
+            /* slot 1 was refreshed by the inter frame */
+            TEST_CHECK(result == VA_AV1_PARSE_SHOW_EXISTING);
+            TEST_CHECK(vaGetAV1PictureParams(parser, VA_INVALID_SURFACE, &params) == VA_STATUS_SUCCESS);
+            TEST_CHECK(params.show_existing_frame);
+            TEST_CHECK(params.pic_param.current_display_picture == TEST_INTER_SURFACE);
+            num_shown++;
+            break;
+        case OBU_TILE_GROUP:
+            TEST_CHECK(num_frames == 2);
+            if (num_tile_groups == 0 && batch) {
+                TEST_CHECK(result == 0 && num_tiles == 0);
+            } else if (num_tile_groups == 0) {
+                TEST_CHECK(result == VA_AV1_PARSE_TILES && num_tiles == 1);
+                test_CheckTiles(&s->tiles[2], tiles, num_tiles, 0);
+            } else {
+                TEST_CHECK(result == (VA_AV1_PARSE_TILES | VA_AV1_PARSE_FRAME_END));
+                TEST_CHECK(num_tiles == (batch ? 2u : 1u));
+                test_CheckTiles(&s->tiles[batch ? 2 : 3], tiles, num_tiles, !batch);
+            }
+            num_tile_groups++;
+            break;
+        default:
+            TEST_CHECK(0);
+        }
+        pos += obu_size;
+    }
+    TEST_CHECK(num_frames == 2 && num_tile_groups == 2 && num_shown == 1);
+    TEST_CHECK(vaDestroyAV1Parser(parser) == VA_STATUS_SUCCESS);
+}
+
+/*
+ * A redundant frame header skipped for lack of references, then a frame
+ * header that fails after tile_info(): the tile group that follows has no
+ * frame header and must not be written to the tiles of any frame.
+ */
+static void test_ParseMalformed(void)
+{
+    static struct test_stream stream;
+    static const uint8_t tile_data[8] = { 0x00, 0x01, 0x00, 1, 2, 3, 4, 5 };
+    const VASliceParameterBufferAV1 *tiles;
+    uint32_t obu_size, result, num_tiles, pos = 0, state = 7;
+    struct test_bitwriter bw;
+    uint8_t payload[16];
+    VAAV1Parser parser;
+    int i;
+
+    test_WriteTemporalDelimiter(&stream);
+    test_WriteSequenceHeader(&stream);
+
+    /* an inter frame, up to its references */
+    test_BitWriterInit(&bw, payload, 0);
+    test_PutBits(&bw, 1, 0);                    /* show_existing_frame */
+    test_PutBits(&bw, 2, 1);                    /* frame_type, INTER_FRAME */
+    test_PutBits(&bw, 1, 1);                    /* show_frame */
+    test_PutBits(&bw, 1, 0);                    /* error_resilient_mode */
+    test_PutBits(&bw, 1, 0);                    /* disable_cdf_update */
+    test_PutBits(&bw, 1, 0);                    /* allow_screen_content_tools */
+    test_PutBits(&bw, 1, 0);                    /* frame_size_override_flag */
+    test_PutBits(&bw, TEST_ORDER_HINT_BITS, 1); /* order_hint */
+    test_PutBits(&bw, 3, 0);                    /* primary_ref_frame */
+    test_PutBits(&bw, 8, 0x02);                 /* refresh_frame_flags */
+    test_PutBits(&bw, 1, 0);                    /* frame_refs_short_signaling */
+    for (i = 0; i < 7; i++)
+        test_PutBits(&bw, 3, 0);                /* ref_frame_idx[] */
+    test_PutZeroPadding(&bw);
+    test_PutOBU(&stream, OBU_REDUNDANT_FRAME_HEADER, payload, bw.size);
+
+    /* a key frame header with two tile columns, cut after tile_info() */
+    test_BitWriterInit(&bw, payload, 0);
+    test_PutBits(&bw, 1, 0);                    /* show_existing_frame */
+    test_PutBits(&bw, 2, 0);                    /* frame_type, KEY_FRAME */
+    test_PutBits(&bw, 1, 1);                    /* show_frame */
+    test_PutBits(&bw, 1, 0);                    /* disable_cdf_update */
+    test_PutBits(&bw, 1, 0);                    /* allow_screen_content_tools */
+    test_PutBits(&bw, 1, 0);                    /* frame_size_override_flag */
+    test_PutBits(&bw, TEST_ORDER_HINT_BITS, 0); /* order_hint */
+    test_PutBits(&bw, 1, 0);                    /* render_and_frame_size_different */
+    test_PutBits(&bw, 1, 0);                    /* disable_frame_end_update_cdf */
+    test_PutBits(&bw, 1, 1);                    /* uniform_tile_spacing_flag */
+    test_PutBits(&bw, 1, 1);                    /* increment_tile_cols_log2 */
+    test_PutBits(&bw, 1, 0);
+    test_PutBits(&bw, 1, 0);                    /* increment_tile_rows_log2 */
+    test_PutBits(&bw, 1, 1);                    /* context_update_tile_id */
+    test_PutBits(&bw, 2, 1);                    /* tile_size_bytes_minus_1 */
+    test_PutZeroPadding(&bw);
+    test_PutOBU(&stream, OBU_FRAME_HEADER, payload, bw.size);
+
+    test_PutOBU(&stream, OBU_TILE_GROUP, tile_data, sizeof(tile_data));
+
+    TEST_CHECK(vaCreateAV1Parser(0, &parser) == VA_STATUS_SUCCESS);
+    for (i = 0; i < 2; i++) {
+        TEST_CHECK(vaParseAV1OBU(parser, stream.data + pos, stream.size - pos, pos, &obu_size, &result,
+                                 &tiles, &num_tiles) == VA_STATUS_SUCCESS);
+        pos += obu_size;
+    }
+    TEST_CHECK(vaParseAV1OBU(parser, stream.data + pos, stream.size - pos, pos, &obu_size, &result,
+                             &tiles, &num_tiles) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == VA_AV1_PARSE_SKIPPED);
+    pos += obu_size;
+    TEST_CHECK(vaParseAV1OBU(parser, stream.data + pos, stream.size - pos, pos, &obu_size, &result,
+                             &tiles, &num_tiles) == VA_STATUS_ERROR_INVALID_PARAMETER);
+    pos += obu_size;
+    TEST_CHECK(vaParseAV1OBU(parser, stream.data + pos, stream.size - pos, pos, &obu_size, &result,
+                             &tiles, &num_tiles) == VA_STATUS_ERROR_INVALID_PARAMETER);
+    pos += obu_size;
+    TEST_CHECK(pos == stream.size);
+
+    /* the parser goes on with the next frame */
+    stream.size = 0;
+    test_WriteTemporalDelimiter(&stream);
+    test_WriteKeyFrame(&stream, &state);
+    for (pos = 0; pos < stream.size; pos += obu_size)
+        TEST_CHECK(vaParseAV1OBU(parser, stream.data + pos, stream.size - pos, pos, &obu_size, &result,
+                                 &tiles, &num_tiles) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == (VA_AV1_PARSE_PICTURE | VA_AV1_PARSE_TILES | VA_AV1_PARSE_FRAME_END));
+    TEST_CHECK(num_tiles == 2);
+    test_CheckTiles(&stream.tiles[0], tiles, num_tiles, 0);
+    TEST_CHECK(vaDestroyAV1Parser(parser) == VA_STATUS_SUCCESS);
+}
+
+int main(void)
+{
+    static struct test_stream stream;
+    uint32_t state = 43;
+
+    test_WriteTemporalDelimiter(&stream);
+    test_WriteSequenceHeader(&stream);
+    test_WriteKeyFrame(&stream, &state);
+    /* the repeated sequence header is not parsed again */
+    test_WriteTemporalDelimiter(&stream);
+    test_WriteSequenceHeader(&stream);
+    test_WriteInterFrame(&stream, &state);
+    test_WriteTemporalDelimiter(&stream);
+    test_WriteShowExistingFrame(&stream, 1);
+
+    test_Parse(&stream, 0);
+    test_Parse(&stream, VA_AV1_PARSER_BATCH_TILE_GROUPS);
+    test_ParseMalformed();
+    return 0;
+}
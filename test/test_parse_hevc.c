@@ -0,0 +1,459 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * HEVC parser: the parameter sets come from the packed header writer and
+ * the slice segment headers are written here, so that every value the
+ * parser reports is known. The stream is an IDR picture in two slice
+ * segments, a P picture and a B picture referring to both, in decode
+ * order POC 0, 2, 1.
+ */
+
+#include <va/va.h>
+#include <va/va_bitstream.h>
+#include <va/va_packed_header.h>
+#include <va/va_parse_hevc.h>
+
+#include "test_common.h"
+#include "test_bits.h"
+
+#define NAL_TRAIL_N     0
+#define NAL_TRAIL_R     1
+#define NAL_IDR_W_RADL  19
+#define NAL_PPS         34
+
+/* 416x240 in 32x32 CTBs: 13x8 CTBs, in two tile columns of 7 and 6 */
+#define TEST_WIDTH          416
+#define TEST_HEIGHT         240
+#define TEST_ADDRESS_BITS   7
+#define TEST_POC_LSB_BITS   8
+
+struct test_slice {
+    unsigned int nal_type;
+    unsigned int slice_type;        /* 0 B, 1 P, 2 I */
+    unsigned int address;
+    int poc;
+    int num_negative, num_positive; /* used by the picture */
+    unsigned int delta_poc_s0_minus1, delta_poc_s1_minus1;
+    int qp_delta;
+    unsigned int five_minus_max_num_merge_cand;
+    int wide_entry_point;           /* 32 zero bits, forcing an emulation prevention byte */
+
+    /* filled by test_WriteSlice() */
+    unsigned int header_size;
+    unsigned int num_epb;
+    unsigned int st_rps_bits;
+};
+
+static void test_WriteParameterSets(uint8_t *stream, size_t *size)
+{
+    VAPackedHeaderOptions options;
+    VAEncSequenceParameterBufferHEVC seq;
+    VAEncPictureParameterBufferHEVC pic;
+    VAPackedHeaderWriter writer;
+    VAPackedHeader seq_header, pic_header;
+    uint32_t result;
+    size_t n;
+
+    memset(&options, 0, sizeof(options));
+    options.max_num_reorder_frames = 1;
+    options.log2_max_pic_order_cnt_lsb_minus4 = TEST_POC_LSB_BITS - 4;
+    options.display_height = 234;
+
+    memset(&seq, 0, sizeof(seq));
+    seq.general_profile_idc = 2;
+    seq.general_level_idc = 93;
+    seq.ip_period = 2;
+    seq.pic_width_in_luma_samples = TEST_WIDTH;
+    seq.pic_height_in_luma_samples = TEST_HEIGHT;
+    seq.seq_fields.bits.chroma_format_idc = 1;
+    seq.seq_fields.bits.bit_depth_luma_minus8 = 2;
+    seq.seq_fields.bits.bit_depth_chroma_minus8 = 2;
+    seq.seq_fields.bits.amp_enabled_flag = 1;
+    seq.seq_fields.bits.sample_adaptive_offset_enabled_flag = 1;
+    seq.seq_fields.bits.sps_temporal_mvp_enabled_flag = 1;
+    seq.seq_fields.bits.strong_intra_smoothing_enabled_flag = 1;
+    seq.log2_min_luma_coding_block_size_minus3 = 0;
+    seq.log2_diff_max_min_luma_coding_block_size = 2;
+    seq.log2_min_transform_block_size_minus2 = 0;
+    seq.log2_diff_max_min_transform_block_size = 3;
+    seq.max_transform_hierarchy_depth_inter = 2;
+    seq.max_transform_hierarchy_depth_intra = 1;
+
+    memset(&pic, 0, sizeof(pic));
+    pic.pic_init_qp = 30;
+    pic.diff_cu_qp_delta_depth = 1;
+    pic.pps_cb_qp_offset = -2;
+    pic.pps_cr_qp_offset = 3;
+    pic.num_tile_columns_minus1 = 1;
+    pic.column_width_minus1[0] = 6;
+    pic.pic_fields.bits.tiles_enabled_flag = 1;
+    pic.pic_fields.bits.loop_filter_across_tiles_enabled_flag = 1;
+    pic.pic_fields.bits.pps_loop_filter_across_slices_enabled_flag = 1;
+    pic.pic_fields.bits.sign_data_hiding_enabled_flag = 1;
+    pic.pic_fields.bits.transform_skip_enabled_flag = 1;
+    pic.pic_fields.bits.cu_qp_delta_enabled_flag = 1;
+
+    TEST_CHECK(vaCreatePackedHeaderWriter(VAProfileHEVCMain10, &options, &writer) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaWritePackedHeadersHEVC(writer, &seq, &pic, &seq_header, &pic_header,
+                                        &result) == VA_STATUS_SUCCESS);
+    n = (seq_header.param.bit_length + 7) / 8;
+    memcpy(stream, seq_header.data, n);
+    *size = n;
+    n = (pic_header.param.bit_length + 7) / 8;
+    memcpy(stream + *size, pic_header.data, n);
+    *size += n;
+    TEST_CHECK(vaDestroyPackedHeaderWriter(writer) == VA_STATUS_SUCCESS);
+}
+
+static size_t test_Bits(const struct test_bitwriter *bw)
+{
+    return (bw->size - bw->num_epb) * 8 + bw->bits;
+}
+
+/* slice_segment_layer_rbsp() with a few bytes of slice data, start code included */
+static void test_WriteSlice(struct test_slice *s, uint8_t *stream, size_t *size)
+{
+    static const uint8_t start_code[4] = { 0, 0, 0, 1 };
+    struct test_bitwriter bw;
+    size_t rps_start;
+    int i;
+
+    memcpy(stream + *size, start_code, 4);
+    *size += 4;
+
+    test_BitWriterInit(&bw, stream + *size, 1);
+    test_PutBits(&bw, 1, 0);                            /* forbidden_zero_bit */
+    test_PutBits(&bw, 6, s->nal_type);
+    test_PutBits(&bw, 6, 0);                            /* nuh_layer_id */
+    test_PutBits(&bw, 3, 1);                            /* nuh_temporal_id_plus1 */
+
+    test_PutBits(&bw, 1, s->address == 0);              /* first_slice_segment_in_pic_flag */
+    if (s->nal_type >= 16)
+        test_PutBits(&bw, 1, 0);                        /* no_output_of_prior_pics_flag */
+    test_PutUE(&bw, 0);                                 /* slice_pic_parameter_set_id */
+    if (s->address)
+        test_PutBits(&bw, TEST_ADDRESS_BITS, s->address);
+    test_PutUE(&bw, s->slice_type);
+    if (s->nal_type != NAL_IDR_W_RADL) {
+        test_PutBits(&bw, TEST_POC_LSB_BITS, s->poc);
+        test_PutBits(&bw, 1, 0);                        /* short_term_ref_pic_set_sps_flag */
+        rps_start = test_Bits(&bw);
+        test_PutUE(&bw, s->num_negative);
+        test_PutUE(&bw, s->num_positive);
+        if (s->num_negative) {
+            test_PutUE(&bw, s->delta_poc_s0_minus1);
+            test_PutBits(&bw, 1, 1);                    /* used_by_curr_pic_s0_flag */
+        }
+        if (s->num_positive) {
+            test_PutUE(&bw, s->delta_poc_s1_minus1);
+            test_PutBits(&bw, 1, 1);                    /* used_by_curr_pic_s1_flag */
+        }
+        s->st_rps_bits = test_Bits(&bw) - rps_start;
+        test_PutBits(&bw, 1, 1);                        /* slice_temporal_mvp_enabled_flag */
+    }
+    test_PutBits(&bw, 1, 1);                            /* slice_sao_luma_flag */
+    test_PutBits(&bw, 1, 0);                            /* slice_sao_chroma_flag */
+    if (s->slice_type != 2) {
+        test_PutBits(&bw, 1, 0);                        /* num_ref_idx_active_override_flag */
+        if (s->slice_type == 0) {
+            test_PutBits(&bw, 1, 1);                    /* mvd_l1_zero_flag */
+            test_PutBits(&bw, 1, 0);                    /* collocated_from_l0_flag */
+        }
+        test_PutUE(&bw, s->five_minus_max_num_merge_cand);
+    }
+    test_PutSE(&bw, s->qp_delta);
+    test_PutBits(&bw, 1, 1);                            /* slice_loop_filter_across_slices_enabled_flag */
+    test_PutUE(&bw, 1);                                 /* num_entry_point_offsets */
+    if (s->wide_entry_point) {
+        test_PutUE(&bw, 31);                            /* offset_len_minus1 */
+        test_PutBits(&bw, 32, 0);
+    } else {
+        test_PutUE(&bw, 7);
+        test_PutBits(&bw, 8, 99);
+    }
+    test_PutTrailingBits(&bw);                          /* byte_alignment() */
+    s->header_size = bw.size - bw.num_epb;
+    s->num_epb = bw.num_epb;
+
+    for (i = 0; i < 16; i++)
+        test_PutBits(&bw, 8, 0xa5);
+    *size += bw.size;
+}
+
+static int test_FindReference(const VAPictureParameterBufferHEVC *pp, VASurfaceID surface, int poc,
+                              uint32_t flags)
+{
+    int i;
+
+    for (i = 0; i < 15; i++) {
+        const VAPictureHEVC *r = &pp->ReferenceFrames[i];
+
+        if (!(r->flags & VA_PICTURE_HEVC_INVALID) && r->picture_id == surface) {
+            TEST_CHECK(r->pic_order_cnt == poc);
+            TEST_CHECK(r->flags == flags);
+            return i;
+        }
+    }
+    return -1;
+}
+
+static unsigned int test_NumReferences(const VAPictureParameterBufferHEVC *pp)
+{
+    unsigned int i, n = 0;
+
+    for (i = 0; i < 15; i++)
+        n += !(pp->ReferenceFrames[i].flags & VA_PICTURE_HEVC_INVALID);
+    return n;
+}
+
+static void test_CheckPictureParams(const VAHEVCPictureParams *params)
+{
+    const VAPictureParameterBufferHEVC *pp = &params->pic_param.base;
+
+    TEST_CHECK(params->profile == VAProfileHEVCMain10);
+    TEST_CHECK(params->max_num_reorder == 1);
+    TEST_CHECK(pp->pic_width_in_luma_samples == TEST_WIDTH);
+    TEST_CHECK(pp->pic_height_in_luma_samples == TEST_HEIGHT);
+    TEST_CHECK(pp->pic_fields.bits.chroma_format_idc == 1);
+    TEST_CHECK(pp->bit_depth_luma_minus8 == 2 && pp->bit_depth_chroma_minus8 == 2);
+    TEST_CHECK(pp->log2_min_luma_coding_block_size_minus3 == 0);
+    TEST_CHECK(pp->log2_diff_max_min_luma_coding_block_size == 2);
+    TEST_CHECK(pp->log2_min_transform_block_size_minus2 == 0);
+    TEST_CHECK(pp->log2_diff_max_min_transform_block_size == 3);
+    TEST_CHECK(pp->max_transform_hierarchy_depth_inter == 2);
+    TEST_CHECK(pp->max_transform_hierarchy_depth_intra == 1);
+    TEST_CHECK(pp->log2_max_pic_order_cnt_lsb_minus4 == TEST_POC_LSB_BITS - 4);
+    TEST_CHECK(pp->num_short_term_ref_pic_sets == 0);
+    TEST_CHECK(pp->init_qp_minus26 == 4);
+    TEST_CHECK(pp->diff_cu_qp_delta_depth == 1);
+    TEST_CHECK(pp->pps_cb_qp_offset == -2 && pp->pps_cr_qp_offset == 3);
+    TEST_CHECK(pp->num_tile_columns_minus1 == 1 && pp->num_tile_rows_minus1 == 0);
+    TEST_CHECK(pp->column_width_minus1[0] == 6);
+    TEST_CHECK(pp->pic_fields.bits.amp_enabled_flag);
+    TEST_CHECK(pp->pic_fields.bits.strong_intra_smoothing_enabled_flag);
+    TEST_CHECK(pp->pic_fields.bits.sign_data_hiding_enabled_flag);
+    TEST_CHECK(pp->pic_fields.bits.transform_skip_enabled_flag);
+    TEST_CHECK(pp->pic_fields.bits.cu_qp_delta_enabled_flag);
+    TEST_CHECK(pp->pic_fields.bits.tiles_enabled_flag);
+    TEST_CHECK(pp->pic_fields.bits.loop_filter_across_tiles_enabled_flag);
+    TEST_CHECK(pp->pic_fields.bits.pps_loop_filter_across_slices_enabled_flag);
+    TEST_CHECK(!pp->pic_fields.bits.entropy_coding_sync_enabled_flag);
+    TEST_CHECK(!pp->pic_fields.bits.scaling_list_enabled_flag);
+    TEST_CHECK(pp->slice_parsing_fields.bits.sample_adaptive_offset_enabled_flag);
+    TEST_CHECK(pp->slice_parsing_fields.bits.sps_temporal_mvp_enabled_flag);
+    TEST_CHECK(!pp->slice_parsing_fields.bits.long_term_ref_pics_present_flag);
+}
+
+static void test_CheckSlice(const struct test_slice *t, const VASliceParameterBufferHEVC *s,
+                            uint32_t offset)
+{
+    TEST_CHECK(s->slice_data_offset == offset);
+    TEST_CHECK(s->slice_data_byte_offset == t->header_size);
+    TEST_CHECK(s->slice_data_num_emu_prevn_bytes == t->num_epb);
+    TEST_CHECK(s->slice_segment_address == t->address);
+    TEST_CHECK(s->LongSliceFlags.fields.slice_type == t->slice_type);
+    TEST_CHECK(s->slice_qp_delta == t->qp_delta);
+    TEST_CHECK(s->LongSliceFlags.fields.slice_sao_luma_flag);
+    TEST_CHECK(!s->LongSliceFlags.fields.slice_sao_chroma_flag);
+    TEST_CHECK(s->LongSliceFlags.fields.slice_loop_filter_across_slices_enabled_flag);
+    TEST_CHECK(s->num_entry_point_offsets == 1);
+    if (t->slice_type != 2) {
+        TEST_CHECK(s->five_minus_max_num_merge_cand == t->five_minus_max_num_merge_cand);
+        TEST_CHECK(s->LongSliceFlags.fields.slice_temporal_mvp_enabled_flag);
+        TEST_CHECK(s->num_ref_idx_l0_active_minus1 == 0);
+    }
+    if (t->slice_type == 0) {
+        TEST_CHECK(s->LongSliceFlags.fields.mvd_l1_zero_flag);
+        TEST_CHECK(!s->LongSliceFlags.fields.collocated_from_l0_flag);
+        TEST_CHECK(s->num_ref_idx_l1_active_minus1 == 0);
+    }
+}
+
+/* a PPS whose first scaling list starts with the given scaling_list_delta_coef */
+static size_t test_WriteScalingListPPS(uint8_t *nal, int32_t delta_coef)
+{
+    struct test_bitwriter bw;
+    unsigned int size_id, matrix_id, i;
+
+    test_BitWriterInit(&bw, nal, 1);
+    test_PutBits(&bw, 1, 0);                            /* forbidden_zero_bit */
+    test_PutBits(&bw, 6, NAL_PPS);
+    test_PutBits(&bw, 6, 0);                            /* nuh_layer_id */
+    test_PutBits(&bw, 3, 1);                            /* nuh_temporal_id_plus1 */
+
+    test_PutUE(&bw, 1);                                 /* pps_pic_parameter_set_id */
+    test_PutUE(&bw, 0);                                 /* pps_seq_parameter_set_id */
+    test_PutBits(&bw, 1, 0);                            /* dependent_slice_segments_enabled_flag */
+    test_PutBits(&bw, 1, 0);                            /* output_flag_present_flag */
+    test_PutBits(&bw, 3, 0);                            /* num_extra_slice_header_bits */
+    test_PutBits(&bw, 1, 0);                            /* sign_data_hiding_enabled_flag */
+    test_PutBits(&bw, 1, 0);                            /* cabac_init_present_flag */
+    test_PutUE(&bw, 0);                                 /* num_ref_idx_l0_default_active_minus1 */
+    test_PutUE(&bw, 0);                                 /* num_ref_idx_l1_default_active_minus1 */
+    test_PutSE(&bw, 0);                                 /* init_qp_minus26 */
+    test_PutBits(&bw, 1, 0);                            /* constrained_intra_pred_flag */
+    test_PutBits(&bw, 1, 0);                            /* transform_skip_enabled_flag */
+    test_PutBits(&bw, 1, 0);                            /* cu_qp_delta_enabled_flag */
+    test_PutSE(&bw, 0);                                 /* pps_cb_qp_offset */
+    test_PutSE(&bw, 0);                                 /* pps_cr_qp_offset */
+    test_PutBits(&bw, 6, 0);                            /* slice_chroma_qp_offsets_present_flag .. */
+    test_PutBits(&bw, 1, 0);                            /* pps_loop_filter_across_slices_enabled_flag */
+    test_PutBits(&bw, 1, 0);                            /* deblocking_filter_control_present_flag */
+    test_PutBits(&bw, 1, 1);                            /* pps_scaling_list_data_present_flag */
+
+    /* scaling_list_data(): the first list coded, the others the default ones */
+    for (size_id = 0; size_id < 4; size_id++) {
+        for (matrix_id = 0; matrix_id < 6; matrix_id += size_id == 3 ? 3 : 1) {
+            test_PutBits(&bw, 1, size_id == 0 && matrix_id == 0);
+            if (size_id || matrix_id) {
+                test_PutUE(&bw, 0);                     /* scaling_list_pred_matrix_id_delta */
+                continue;
+            }
+            test_PutSE(&bw, delta_coef);
+            for (i = 1; i < 16; i++)
+                test_PutSE(&bw, i & 1 ? -127 : 127);
+        }
+    }
+
+    test_PutBits(&bw, 1, 0);                            /* lists_modification_present_flag */
+    test_PutUE(&bw, 0);                                 /* log2_parallel_merge_level_minus2 */
+    test_PutBits(&bw, 1, 0);                            /* slice_segment_header_extension_present_flag */
+    test_PutBits(&bw, 1, 0);                            /* pps_extension_present_flag */
+    test_PutTrailingBits(&bw);
+    return bw.size;
+}
+
+/* out of range values fail the parse */
+static void test_ParseRanges(void)
+{
+    static const int32_t delta_coefs[] = { -128, 127, -129, 128, -0x3fffffff };
+    VASliceParameterBufferHEVCExtension slice;
+    VAHEVCParser parser;
+    uint8_t nal[256];
+    uint32_t result;
+    unsigned int i;
+    size_t size;
+
+    TEST_CHECK(vaCreateHEVCParser(&parser) == VA_STATUS_SUCCESS);
+    for (i = 0; i < sizeof(delta_coefs) / sizeof(delta_coefs[0]); i++) {
+        size = test_WriteScalingListPPS(nal, delta_coefs[i]);
+        TEST_CHECK(vaParseHEVCNALUnit(parser, nal, size, 0, &result, &slice) ==
+                   (i < 2 ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_PARAMETER));
+    }
+    TEST_CHECK(vaDestroyHEVCParser(parser) == VA_STATUS_SUCCESS);
+}
+
+int main(void)
+{
+    static uint8_t stream[4096];
+    static VANALUnit units[16];
+    struct test_slice slices[] = {
+        {
+            .nal_type = NAL_IDR_W_RADL, .slice_type = 2, .qp_delta = -3, .wide_entry_point = 1,
+        }, {
+            .nal_type = NAL_IDR_W_RADL, .slice_type = 2, .address = 52, .qp_delta = 2,
+        }, {
+            .nal_type = NAL_TRAIL_R, .slice_type = 1, .poc = 2, .num_negative = 1,
+            .delta_poc_s0_minus1 = 1, .qp_delta = 1, .five_minus_max_num_merge_cand = 2,
+        }, {
+            .nal_type = NAL_TRAIL_N, .slice_type = 0, .poc = 1, .num_negative = 1, .num_positive = 1,
+            .five_minus_max_num_merge_cand = 4, .wide_entry_point = 1,
+        },
+    };
+    const unsigned int num_slices = sizeof(slices) / sizeof(slices[0]);
+    /* first NAL unit of each slice */
+    const VASurfaceID surfaces[] = { 100, 100, 102, 101 };
+    VAHEVCPictureParams params[3];
+    VASliceParameterBufferHEVCExtension slice;
+    VAAnnexBSplitter splitter;
+    VAHEVCParser parser;
+    unsigned int num_units, i, num_pictures = 0, slice_index = 0;
+    size_t size = 0;
+
+    test_WriteParameterSets(stream, &size);
+    for (i = 0; i < num_slices; i++)
+        test_WriteSlice(&slices[i], stream, &size);
+    TEST_CHECK(slices[0].num_epb > 0);
+
+    TEST_CHECK(vaCreateAnnexBSplitter(VA_BITSTREAM_HEVC, &splitter) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaSplitAnnexB(splitter, stream, size, VA_BITSTREAM_END_OF_STREAM, units, 16,
+                             &num_units, NULL) == VA_STATUS_SUCCESS);
+    TEST_CHECK(num_units == 3 + num_slices);
+    TEST_CHECK(vaDestroyAnnexBSplitter(splitter) == VA_STATUS_SUCCESS);
+
+    TEST_CHECK(vaCreateHEVCParser(&parser) == VA_STATUS_SUCCESS);
+    for (i = 0; i < num_units; i++) {
+        uint32_t result;
+
+        TEST_CHECK(vaParseHEVCNALUnit(parser, stream + units[i].offset, units[i].size,
+                                      units[i].offset, &result, &slice) == VA_STATUS_SUCCESS);
+        if (i < 3) {
+            TEST_CHECK(result == VA_HEVC_PARSE_PARAMETER_SET);
+            continue;
+        }
+        if (result & VA_HEVC_PARSE_PICTURE) {
+            TEST_CHECK(num_pictures < 3);
+            TEST_CHECK(vaGetHEVCPictureParams(parser, surfaces[slice_index],
+                                              &params[num_pictures]) == VA_STATUS_SUCCESS);
+            test_CheckPictureParams(&params[num_pictures]);
+            TEST_CHECK(params[num_pictures].poc == slices[slice_index].poc);
+            num_pictures++;
+        }
+        TEST_CHECK(result & VA_HEVC_PARSE_SLICE);
+        TEST_CHECK(!!(result & VA_HEVC_PARSE_PICTURE) == (slices[slice_index].address == 0));
+        test_CheckSlice(&slices[slice_index], &slice.base, units[i].offset);
+
+        /* the B picture refers to POC 0 before and POC 2 after it */
+        if (slices[slice_index].slice_type == 0) {
+            const VAPictureParameterBufferHEVC *pp = &params[2].pic_param.base;
+            int before = test_FindReference(pp, 100, 0, VA_PICTURE_HEVC_RPS_ST_CURR_BEFORE);
+            int after = test_FindReference(pp, 102, 2, VA_PICTURE_HEVC_RPS_ST_CURR_AFTER);
+
+            TEST_CHECK(before >= 0 && after >= 0 && test_NumReferences(pp) == 2);
+            TEST_CHECK(pp->st_rps_bits == slices[slice_index].st_rps_bits);
+            TEST_CHECK(slice.base.RefPicList[0][0] == before && slice.base.RefPicList[0][1] == 0xff);
+            TEST_CHECK(slice.base.RefPicList[1][0] == after && slice.base.RefPicList[1][1] == 0xff);
+        } else if (slices[slice_index].slice_type == 1) {
+            const VAPictureParameterBufferHEVC *pp = &params[1].pic_param.base;
+            int before = test_FindReference(pp, 100, 0, VA_PICTURE_HEVC_RPS_ST_CURR_BEFORE);
+
+            TEST_CHECK(before >= 0 && test_NumReferences(pp) == 1);
+            TEST_CHECK(pp->st_rps_bits == slices[slice_index].st_rps_bits);
+            TEST_CHECK(slice.base.RefPicList[0][0] == before && slice.base.RefPicList[0][1] == 0xff);
+        } else {
+            const VAPictureParameterBufferHEVC *pp = &params[0].pic_param.base;
+
+            TEST_CHECK(test_NumReferences(pp) == 0);
+            TEST_CHECK(pp->slice_parsing_fields.bits.IdrPicFlag);
+            TEST_CHECK(pp->slice_parsing_fields.bits.IntraPicFlag);
+        }
+        slice_index++;
+    }
+    TEST_CHECK(num_pictures == 3 && slice_index == num_slices);
+    TEST_CHECK(vaDestroyHEVCParser(parser) == VA_STATUS_SUCCESS);
+
+    test_ParseRanges();
+    return 0;
+}
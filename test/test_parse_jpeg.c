@@ -0,0 +1,402 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * JPEG parser: images written here with known tables and entropy coded
+ * data holding stuffed bytes and restart markers, so that the tables,
+ * the scans and the end of the entropy coded data can be checked
+ * exactly. The marker scan is run with the vector kernels and with the
+ * scalar code, for entropy coded data of many lengths.
+ */
+
+#include <va/va.h>
+#include <va/va_parse_jpeg.h>
+
+#include "test_common.h"
+
+#define TEST_WIDTH      100
+#define TEST_HEIGHT     60
+
+struct test_jpeg {
+    uint8_t data[8192];
+    uint32_t size;
+    /* the entropy coded data of the scans */
+    uint32_t scan_offsets[3];
+    uint32_t scan_sizes[3];
+    unsigned int num_scans;
+};
+
+static const uint8_t test_dc_counts[16] = { 0, 2, 4, 2, 1, 1, 1, 1 };
+static const uint8_t test_ac_counts[16] = { 0, 2, 1, 3 };
+static const uint8_t test_ac_values[6] = { 0x01, 0x02, 0x03, 0x00, 0x04, 0x11 };
+
+/* the annex K chrominance tables, which the parser loads for table 1 */
+static const uint8_t test_k_dc_counts[16] = { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1 };
+static const uint8_t test_k_ac_counts[16] = { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 };
+static const uint8_t test_k_ac_values[8] = { 0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21 };
+
+static void test_Put(struct test_jpeg *j, const void *data, uint32_t size)
+{
+    memcpy(j->data + j->size, data, size);
+    j->size += size;
+}
+
+static void test_PutByte(struct test_jpeg *j, uint8_t b)
+{
+    j->data[j->size++] = b;
+}
+
+static void test_PutSegment(struct test_jpeg *j, uint8_t marker, uint32_t length)
+{
+    test_PutByte(j, 0xff);
+    test_PutByte(j, marker);
+    test_PutByte(j, (length + 2) >> 8);
+    test_PutByte(j, (length + 2) & 0xff);
+}
+
+static void test_PutTables(struct test_jpeg *j, uint8_t q0_bias)
+{
+    uint8_t i, count = 0;
+
+    test_PutSegment(j, 0xdb, 2 * 65);           /* DQT, tables 0 and 1 */
+    test_PutByte(j, 0x00);
+    for (i = 0; i < 64; i++)
+        test_PutByte(j, 1 + i + q0_bias);
+    test_PutByte(j, 0x01);
+    for (i = 0; i < 64; i++)
+        test_PutByte(j, 64 - i);
+
+    /* DHT, DC and AC tables 0 */
+    test_PutSegment(j, 0xc4, 17 + 12 + 17 + sizeof(test_ac_values));
+    test_PutByte(j, 0x00);
+    test_Put(j, test_dc_counts, 16);
+    for (i = 0; i < 12; i++)
+        test_PutByte(j, 11 - i);
+    test_PutByte(j, 0x10);
+    test_Put(j, test_ac_counts, 16);
+    test_Put(j, test_ac_values, sizeof(test_ac_values));
+    for (i = 0; i < 16; i++)
+        count += test_ac_counts[i];
+    TEST_CHECK(count == sizeof(test_ac_values));
+}
+
+static void test_PutFrameHeader(struct test_jpeg *j, const uint8_t ids[3], const uint8_t sampling[3],
+                                const uint8_t tables[3])
+{
+    int i;
+
+    test_PutSegment(j, 0xc0, 6 + 3 * 3);
+    test_PutByte(j, 8);
+    test_PutByte(j, TEST_HEIGHT >> 8);
+    test_PutByte(j, TEST_HEIGHT & 0xff);
+    test_PutByte(j, TEST_WIDTH >> 8);
+    test_PutByte(j, TEST_WIDTH & 0xff);
+    test_PutByte(j, 3);
+    for (i = 0; i < 3; i++) {
+        test_PutByte(j, ids[i]);
+        test_PutByte(j, sampling[i]);
+        test_PutByte(j, tables[i]);
+    }
+}
+
+/*
+ * size bytes of entropy coded data, with plenty of stuffed 0xFF00 pairs
+ * and a restart marker every restart_bytes
+ */
+static void test_PutEntropyData(struct test_jpeg *j, uint32_t *state, uint32_t size, uint32_t restart_bytes)
+{
+    uint32_t end = j->size + size, next_restart = j->size + restart_bytes;
+    unsigned int rst = 0;
+
+    j->scan_offsets[j->num_scans] = j->size;
+    j->scan_sizes[j->num_scans] = size;
+    j->num_scans++;
+
+    while (j->size < end) {
+        uint32_t r = test_Random(state);
+        uint8_t b = r >> 8;
+
+        if (restart_bytes && j->size >= next_restart && end - j->size >= 2) {
+            test_PutByte(j, 0xff);
+            test_PutByte(j, 0xd0 + (rst++ & 7));
+            next_restart = j->size + restart_bytes;
+            continue;
+        }
+        if ((r & 7) == 0)
+            b = 0xff;
+        if (b == 0xff && end - j->size < 2)
+            b = 0xfe;
+        test_PutByte(j, b);
+        if (b == 0xff)
+            test_PutByte(j, 0x00);
+    }
+}
+
+static void test_PutScanHeader(struct test_jpeg *j, unsigned int num_components, const uint8_t *ids,
+                               const uint8_t *tables)
+{
+    unsigned int i;
+
+    test_PutSegment(j, 0xda, 4 + 2 * num_components);
+    test_PutByte(j, num_components);
+    for (i = 0; i < num_components; i++) {
+        test_PutByte(j, ids[i]);
+        test_PutByte(j, tables[i]);
+    }
+    test_PutByte(j, 0);                         /* Ss */
+    test_PutByte(j, 63);                        /* Se */
+    test_PutByte(j, 0);                         /* Ah, Al */
+}
+
+/* a 4:2:0 YCbCr image with one interleaved scan and restart intervals */
+static void test_WriteYCbCrImage(struct test_jpeg *j, uint32_t *state, uint32_t scan_size,
+                                 uint8_t q0_bias, unsigned int fill_bytes)
+{
+    static const uint8_t app0[] = { 'J', 'F', 'I', 'F', 0, 1, 2, 0, 0, 1, 0, 1, 0, 0 };
+    static const uint8_t ids[3] = { 1, 2, 3 }, sampling[3] = { 0x22, 0x11, 0x11 };
+    static const uint8_t qtables[3] = { 0, 1, 1 }, htables[3] = { 0x00, 0x11, 0x11 };
+    unsigned int i;
+
+    memset(j, 0, sizeof(*j));
+    test_PutByte(j, 0xff);
+    test_PutByte(j, 0xd8);                      /* SOI */
+    test_PutSegment(j, 0xe0, sizeof(app0));
+    test_Put(j, app0, sizeof(app0));
+    test_PutTables(j, q0_bias);
+    test_PutFrameHeader(j, ids, sampling, qtables);
+    test_PutSegment(j, 0xdd, 2);                /* DRI */
+    test_PutByte(j, 0);
+    test_PutByte(j, 4);
+    test_PutScanHeader(j, 3, ids, htables);
+    test_PutEntropyData(j, state, scan_size, 50);
+    for (i = 0; i < fill_bytes; i++)
+        test_PutByte(j, 0xff);
+    test_PutByte(j, 0xff);
+    test_PutByte(j, 0xd9);                      /* EOI */
+}
+
+/* an RGB image with one scan per component */
+static void test_WriteRGBImage(struct test_jpeg *j, uint32_t *state)
+{
+    static const uint8_t ids[3] = { 'R', 'G', 'B' }, sampling[3] = { 0x11, 0x11, 0x11 };
+    static const uint8_t qtables[3] = { 0, 1, 1 }, htables[3] = { 0x00, 0x11, 0x11 };
+    unsigned int i;
+
+    memset(j, 0, sizeof(*j));
+    test_PutByte(j, 0xff);
+    test_PutByte(j, 0xd8);
+    test_PutTables(j, 0);
+    test_PutFrameHeader(j, ids, sampling, qtables);
+    for (i = 0; i < 3; i++) {
+        test_PutScanHeader(j, 1, &ids[i], &htables[i]);
+        test_PutEntropyData(j, state, 200 + 33 * i, 0);
+    }
+    test_PutByte(j, 0xff);
+    test_PutByte(j, 0xd9);
+}
+
+static void test_CheckScans(const struct test_jpeg *j, uint32_t base, const VASliceParameterBufferJPEGBaseline *scans,
+                            uint32_t num_scans)
+{
+    uint32_t i;
+
+    TEST_CHECK(num_scans == j->num_scans);
+    for (i = 0; i < num_scans; i++) {
+        TEST_CHECK(scans[i].slice_data_offset == base + j->scan_offsets[i]);
+        TEST_CHECK(scans[i].slice_data_size == j->scan_sizes[i]);
+        TEST_CHECK(scans[i].slice_data_flag == VA_SLICE_DATA_FLAG_ALL);
+    }
+}
+
+static void test_CheckTables(const VAJPEGPictureParams *params, uint8_t q0_bias, int huffman_table_1)
+{
+    const VAHuffmanTableBufferJPEGBaseline *ht = &params->huffman_table;
+    int i;
+
+    TEST_CHECK(params->iq_matrix.load_quantiser_table[0] && params->iq_matrix.load_quantiser_table[1]);
+    TEST_CHECK(!params->iq_matrix.load_quantiser_table[2] && !params->iq_matrix.load_quantiser_table[3]);
+    for (i = 0; i < 64; i++) {
+        TEST_CHECK(params->iq_matrix.quantiser_table[0][i] == 1 + i + q0_bias);
+        TEST_CHECK(params->iq_matrix.quantiser_table[1][i] == 64 - i);
+    }
+
+    TEST_CHECK(ht->load_huffman_table[0]);
+    TEST_CHECK(!memcmp(ht->huffman_table[0].num_dc_codes, test_dc_counts, 16));
+    for (i = 0; i < 12; i++)
+        TEST_CHECK(ht->huffman_table[0].dc_values[i] == 11 - i);
+    TEST_CHECK(!memcmp(ht->huffman_table[0].num_ac_codes, test_ac_counts, 16));
+    TEST_CHECK(!memcmp(ht->huffman_table[0].ac_values, test_ac_values, sizeof(test_ac_values)));
+    TEST_CHECK(ht->huffman_table[0].ac_values[sizeof(test_ac_values)] == 0);
+
+    TEST_CHECK(ht->load_huffman_table[1] == huffman_table_1);
+    if (huffman_table_1) {
+        TEST_CHECK(!memcmp(ht->huffman_table[1].num_dc_codes, test_k_dc_counts, 16));
+        for (i = 0; i < 12; i++)
+            TEST_CHECK(ht->huffman_table[1].dc_values[i] == i);
+        TEST_CHECK(!memcmp(ht->huffman_table[1].num_ac_codes, test_k_ac_counts, 16));
+        TEST_CHECK(!memcmp(ht->huffman_table[1].ac_values, test_k_ac_values, sizeof(test_k_ac_values)));
+    }
+}
+
+static void test_CheckPicture(const VAPictureParameterBufferJPEGBaseline *pp, const uint8_t *ids,
+                              const uint8_t *sampling, int color_space)
+{
+    int i;
+
+    TEST_CHECK(pp->picture_width == TEST_WIDTH && pp->picture_height == TEST_HEIGHT);
+    TEST_CHECK(pp->num_components == 3 && pp->color_space == color_space);
+    for (i = 0; i < 3; i++) {
+        TEST_CHECK(pp->components[i].component_id == ids[i]);
+        TEST_CHECK(pp->components[i].h_sampling_factor == sampling[i] >> 4);
+        TEST_CHECK(pp->components[i].v_sampling_factor == (sampling[i] & 0xf));
+        TEST_CHECK(pp->components[i].quantiser_table_selector == (i > 0));
+    }
+}
+
+/* the scan data lengths around the vector widths, with and without fill bytes before EOI */
+static const uint32_t test_scan_sizes[] = {
+    0, 1, 2, 3, 15, 16, 17, 18, 31, 32, 33, 34, 47, 63, 64, 65, 66, 127, 128, 129, 1000, 4099,
+};
+#define TEST_NUM_SCAN_SIZES (sizeof(test_scan_sizes) / sizeof(test_scan_sizes[0]))
+
+struct test_scan_result {
+    uint32_t image_size;
+    uint32_t offset;
+    uint32_t size;
+};
+
+static void test_MarkerScan(void *out, size_t size)
+{
+    static struct test_jpeg j;
+    struct test_scan_result *results = out;
+    const VASliceParameterBufferJPEGBaseline *scans;
+    VAJPEGPictureParams params;
+    uint32_t state = 45, result, image_size, num_scans;
+    VAJPEGParser parser;
+    unsigned int i;
+
+    TEST_CHECK(size == TEST_NUM_SCAN_SIZES * 2 * sizeof(*results));
+    TEST_CHECK(vaCreateJPEGParser(&parser) == VA_STATUS_SUCCESS);
+    for (i = 0; i < 2 * TEST_NUM_SCAN_SIZES; i++) {
+        test_WriteYCbCrImage(&j, &state, test_scan_sizes[i / 2], 0, (i & 1) * 3);
+        TEST_CHECK(vaParseJPEGImage(parser, j.data, j.size, 7, &image_size, &result, &params,
+                                    &scans, &num_scans) == VA_STATUS_SUCCESS);
+        TEST_CHECK(image_size == j.size);
+        test_CheckScans(&j, 7, scans, num_scans);
+        results[i].image_size = image_size;
+        results[i].offset = scans[0].slice_data_offset;
+        results[i].size = scans[0].slice_data_size;
+    }
+    TEST_CHECK(vaDestroyJPEGParser(parser) == VA_STATUS_SUCCESS);
+}
+
+int main(void)
+{
+    static struct test_scan_result scalar[2 * TEST_NUM_SCAN_SIZES], simd[2 * TEST_NUM_SCAN_SIZES];
+    static const uint8_t ycbcr_ids[3] = { 1, 2, 3 }, ycbcr_sampling[3] = { 0x22, 0x11, 0x11 };
+    static const uint8_t rgb_ids[3] = { 'R', 'G', 'B' }, rgb_sampling[3] = { 0x11, 0x11, 0x11 };
+    static struct test_jpeg images[3];
+    static uint8_t stream[3 * sizeof(images[0].data)];
+    const VASliceParameterBufferJPEGBaseline *scans;
+    VAJPEGPictureParams params, first;
+    uint32_t state = 46, result, image_size, num_scans, size = 0, pos;
+    VAJPEGParser parser;
+    unsigned int i;
+
+    /* first, as the child inherits the CPU features once read */
+    test_RunScalar(test_MarkerScan, scalar, sizeof(scalar));
+    test_MarkerScan(simd, sizeof(simd));
+    TEST_CHECK(!memcmp(scalar, simd, sizeof(simd)));
+
+    /* concatenated images: YCbCr, RGB with the same tables, YCbCr with another quantization table */
+    test_WriteYCbCrImage(&images[0], &state, 700, 0, 0);
+    test_WriteRGBImage(&images[1], &state);
+    test_WriteYCbCrImage(&images[2], &state, 300, 9, 1);
+    for (i = 0; i < 3; i++) {
+        memcpy(stream + size, images[i].data, images[i].size);
+        size += images[i].size;
+    }
+
+    TEST_CHECK(vaCreateJPEGParser(&parser) == VA_STATUS_SUCCESS);
+    pos = 0;
+    TEST_CHECK(vaParseJPEGImage(parser, stream + pos, size - pos, pos, &image_size, &result, &first,
+                                &scans, &num_scans) == VA_STATUS_SUCCESS);
+    TEST_CHECK(image_size == images[0].size);
+    TEST_CHECK(result == (VA_JPEG_PARSE_IQ_MATRIX_CHANGED | VA_JPEG_PARSE_HUFFMAN_TABLE_CHANGED));
+    test_CheckPicture(&first.pic_param, ycbcr_ids, ycbcr_sampling, 0);
+    test_CheckTables(&first, 0, 1);
+    test_CheckScans(&images[0], pos, scans, num_scans);
+    TEST_CHECK(scans[0].restart_interval == 4);
+    TEST_CHECK(scans[0].num_components == 3);
+    TEST_CHECK(scans[0].components[0].component_selector == 1);
+    TEST_CHECK(scans[0].components[0].dc_table_selector == 0 && scans[0].components[0].ac_table_selector == 0);
+    TEST_CHECK(scans[0].components[2].component_selector == 3);
+    TEST_CHECK(scans[0].components[2].dc_table_selector == 1 && scans[0].components[2].ac_table_selector == 1);
+    /* 16x16 MCUs */
+    TEST_CHECK(scans[0].num_mcus == 7 * 4);
+
+    pos += image_size;
+    TEST_CHECK(vaParseJPEGImage(parser, stream + pos, size - pos, pos, &image_size, &result, &params,
+                                &scans, &num_scans) == VA_STATUS_SUCCESS);
+    TEST_CHECK(image_size == images[1].size);
+    TEST_CHECK(result == 0);
+    TEST_CHECK(params.iq_matrix_hash == first.iq_matrix_hash);
+    TEST_CHECK(params.huffman_table_hash == first.huffman_table_hash);
+    test_CheckPicture(&params.pic_param, rgb_ids, rgb_sampling, 1);
+    test_CheckTables(&params, 0, 1);
+    test_CheckScans(&images[1], pos, scans, num_scans);
+    for (i = 0; i < 3; i++) {
+        TEST_CHECK(scans[i].num_components == 1);
+        TEST_CHECK(scans[i].components[0].component_selector == rgb_ids[i]);
+        TEST_CHECK(scans[i].restart_interval == 0);
+        /* one 8x8 data unit per MCU */
+        TEST_CHECK(scans[i].num_mcus == 13 * 8);
+    }
+
+    pos += image_size;
+    TEST_CHECK(vaParseJPEGImage(parser, stream + pos, size - pos, pos, &image_size, &result, &params,
+                                &scans, &num_scans) == VA_STATUS_SUCCESS);
+    TEST_CHECK(image_size == images[2].size && pos + image_size == size);
+    TEST_CHECK(result == VA_JPEG_PARSE_IQ_MATRIX_CHANGED);
+    TEST_CHECK(params.iq_matrix_hash != first.iq_matrix_hash);
+    TEST_CHECK(params.huffman_table_hash == first.huffman_table_hash);
+    test_CheckTables(&params, 9, 1);
+    test_CheckScans(&images[2], pos, scans, num_scans);
+
+    /* a truncated image ends its last scan at the end of the data, even on a lone 0xFF */
+    for (i = 0; i < 2; i++) {
+        struct test_jpeg *j = &images[0];
+        uint32_t end = j->scan_offsets[0] + 300;
+
+        while ((j->data[end - 1] == 0xff) != (i == 1))
+            end++;
+        TEST_CHECK(vaParseJPEGImage(parser, j->data, end, 0, &image_size, &result, &params, &scans,
+                                    &num_scans) == VA_STATUS_SUCCESS);
+        TEST_CHECK(image_size == end && num_scans == 1);
+        TEST_CHECK(scans[0].slice_data_size == end - j->scan_offsets[0]);
+    }
+
+    TEST_CHECK(vaDestroyJPEGParser(parser) == VA_STATUS_SUCCESS);
+    return 0;
+}
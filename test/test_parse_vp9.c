@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * VP9 parser: superframe splitting, and the uncompressed headers of a key
+ * frame, a hidden inter frame and a show_existing_frame frame written
+ * here, so that every value the parser reports is known. The inter frame
+ * and the frame showing it are packed in a superframe.
+ */
+
+#include <va/va.h>
+#include <va/va_parse_vp9.h>
+
+#include "test_common.h"
+#include "test_bits.h"
+
+#define TEST_WIDTH              352
+#define TEST_HEIGHT             288
+#define TEST_KEY_SURFACE        100
+#define TEST_INTER_SURFACE      101
+
+/* su(n) of the VP9 specification: magnitude then sign */
+static void test_PutSU(struct test_bitwriter *bw, unsigned int n, int v)
+{
+    test_PutBits(bw, n, v < 0 ? -v : v);
+    test_PutBits(bw, 1, v < 0);
+}
+
+/* the compressed header and the tiles, which the parser does not read */
+static uint32_t test_PutPayload(struct test_bitwriter *bw, uint32_t *state, uint32_t size)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++)
+        test_PutBits(bw, 8, test_Random(state) >> 8);
+    return bw->size;
+}
+
+static uint32_t test_WriteKeyFrame(uint8_t *data, uint32_t *state, uint32_t *header_size)
+{
+    struct test_bitwriter bw;
+    int i, j;
+
+    test_BitWriterInit(&bw, data, 0);
+    test_PutBits(&bw, 2, 2);                    /* frame_marker */
+    test_PutBits(&bw, 2, 0);                    /* profile */
+    test_PutBits(&bw, 1, 0);                    /* show_existing_frame */
+    test_PutBits(&bw, 1, 0);                    /* frame_type, KEY_FRAME */
+    test_PutBits(&bw, 1, 1);                    /* show_frame */
+    test_PutBits(&bw, 1, 0);                    /* error_resilient_mode */
+    test_PutBits(&bw, 24, 0x498342);            /* frame_sync_code */
+    test_PutBits(&bw, 3, 2);                    /* color_space, CS_BT_709 */
+    test_PutBits(&bw, 1, 0);                    /* color_range */
+    test_PutBits(&bw, 16, TEST_WIDTH - 1);
+    test_PutBits(&bw, 16, TEST_HEIGHT - 1);
+    test_PutBits(&bw, 1, 0);                    /* render_and_frame_size_different */
+    test_PutBits(&bw, 1, 1);                    /* refresh_frame_context */
+    test_PutBits(&bw, 1, 0);                    /* frame_parallel_decoding_mode */
+    test_PutBits(&bw, 2, 1);                    /* frame_context_idx */
+
+    /* loop_filter_params() */
+    test_PutBits(&bw, 6, 20);                   /* loop_filter_level */
+    test_PutBits(&bw, 3, 3);                    /* loop_filter_sharpness */
+    test_PutBits(&bw, 1, 1);                    /* loop_filter_delta_enabled */
+    test_PutBits(&bw, 1, 1);                    /* loop_filter_delta_update */
+    test_PutBits(&bw, 1, 1);
+    test_PutSU(&bw, 6, 2);                      /* loop_filter_ref_deltas[0] */
+    test_PutBits(&bw, 3, 0);
+    test_PutBits(&bw, 1, 0);
+    test_PutBits(&bw, 1, 1);
+    test_PutSU(&bw, 6, -1);                     /* loop_filter_mode_deltas[1] */
+
+    /* quantization_params() */
+    test_PutBits(&bw, 8, 60);                   /* base_q_idx */
+    test_PutBits(&bw, 1, 1);
+    test_PutSU(&bw, 4, -2);                     /* delta_q_y_dc */
+    test_PutBits(&bw, 1, 0);                    /* delta_q_uv_dc */
+    test_PutBits(&bw, 1, 1);
+    test_PutSU(&bw, 4, 3);                      /* delta_q_uv_ac */
+
+    /* segmentation_params() */
+    test_PutBits(&bw, 1, 1);                    /* segmentation_enabled */
+    test_PutBits(&bw, 1, 1);                    /* segmentation_update_map */
+    for (i = 0; i < 7; i++) {
+        test_PutBits(&bw, 1, i != 4);           /* prob_coded */
+        if (i != 4)
+            test_PutBits(&bw, 8, 10 + i);
+    }
+    test_PutBits(&bw, 1, 0);                    /* segmentation_temporal_update */
+    test_PutBits(&bw, 1, 1);                    /* segmentation_update_data */
+    test_PutBits(&bw, 1, 0);                    /* segmentation_abs_or_delta_update */
+    for (i = 0; i < 8; i++) {
+        for (j = 0; j < 4; j++) {
+            if (i == 2 && j == 0) {
+                test_PutBits(&bw, 1, 1);
+                test_PutSU(&bw, 8, -10);        /* SEG_LVL_ALT_Q */
+            } else if (i == 2 && j == 1) {
+                test_PutBits(&bw, 1, 1);
+                test_PutSU(&bw, 6, 5);          /* SEG_LVL_ALT_L */
+            } else if (i == 5 && j == 2) {
+                test_PutBits(&bw, 1, 1);
+                test_PutBits(&bw, 2, 1);        /* SEG_LVL_REF_FRAME */
+            } else {
+                test_PutBits(&bw, 1, i == 5 && j == 3);
+            }
+        }
+    }
+
+    /* tile_info(): 6 superblock columns allow a single tile column */
+    test_PutBits(&bw, 1, 1);                    /* tile_rows_log2 */
+    test_PutBits(&bw, 1, 0);                    /* increment_tile_rows_log2 */
+    test_PutBits(&bw, 16, 25);                  /* header_size_in_bytes */
+    test_PutZeroPadding(&bw);
+    *header_size = bw.size;
+    return test_PutPayload(&bw, state, 25 + 200);
+}
+
+/* a hidden inter frame refreshing slot 2, with the state of the key frame */
+static uint32_t test_WriteInterFrame(uint8_t *data, uint32_t *state, uint32_t *header_size)
+{
+    struct test_bitwriter bw;
+
+    test_BitWriterInit(&bw, data, 0);
+    test_PutBits(&bw, 2, 2);                    /* frame_marker */
+    test_PutBits(&bw, 2, 0);                    /* profile */
+    test_PutBits(&bw, 1, 0);                    /* show_existing_frame */
+    test_PutBits(&bw, 1, 1);                    /* frame_type, NON_KEY_FRAME */
+    test_PutBits(&bw, 1, 0);                    /* show_frame */
+    test_PutBits(&bw, 1, 0);                    /* error_resilient_mode */
+    test_PutBits(&bw, 1, 0);                    /* intra_only */
+    test_PutBits(&bw, 2, 0);                    /* reset_frame_context */
+    test_PutBits(&bw, 8, 0x04);                 /* refresh_frame_flags */
+    test_PutBits(&bw, 3, 0);                    /* LAST */
+    test_PutBits(&bw, 1, 0);
+    test_PutBits(&bw, 3, 1);                    /* GOLDEN */
+    test_PutBits(&bw, 1, 0);
+    test_PutBits(&bw, 3, 6);                    /* ALTREF */
+    test_PutBits(&bw, 1, 1);                    /* ref_frame_sign_bias */
+    test_PutBits(&bw, 1, 1);                    /* found_ref */
+    test_PutBits(&bw, 1, 0);                    /* render_and_frame_size_different */
+    test_PutBits(&bw, 1, 1);                    /* allow_high_precision_mv */
+    test_PutBits(&bw, 1, 0);                    /* is_filter_switchable */
+    test_PutBits(&bw, 2, 1);                    /* raw_interpolation_filter, EIGHTTAP */
+    test_PutBits(&bw, 1, 0);                    /* refresh_frame_context */
+    test_PutBits(&bw, 1, 1);                    /* frame_parallel_decoding_mode */
+    test_PutBits(&bw, 2, 3);                    /* frame_context_idx */
+
+    test_PutBits(&bw, 6, 36);                   /* loop_filter_level */
+    test_PutBits(&bw, 3, 0);                    /* loop_filter_sharpness */
+    test_PutBits(&bw, 1, 1);                    /* loop_filter_delta_enabled */
+    test_PutBits(&bw, 1, 0);                    /* loop_filter_delta_update */
+    test_PutBits(&bw, 8, 100);                  /* base_q_idx */
+    test_PutBits(&bw, 3, 0);                    /* no delta_q */
+    test_PutBits(&bw, 1, 1);                    /* segmentation_enabled */
+    test_PutBits(&bw, 1, 0);                    /* segmentation_update_map */
+    test_PutBits(&bw, 1, 0);                    /* segmentation_update_data */
+    test_PutBits(&bw, 1, 0);                    /* tile_rows_log2 */
+    test_PutBits(&bw, 16, 10);                  /* header_size_in_bytes */
+    test_PutZeroPadding(&bw);
+    *header_size = bw.size;
+    return test_PutPayload(&bw, state, 10 + 60);
+}
+
+static uint32_t test_WriteShowExistingFrame(uint8_t *data, unsigned int slot)
+{
+    struct test_bitwriter bw;
+
+    test_BitWriterInit(&bw, data, 0);
+    test_PutBits(&bw, 2, 2);                    /* frame_marker */
+    test_PutBits(&bw, 2, 0);                    /* profile */
+    test_PutBits(&bw, 1, 1);                    /* show_existing_frame */
+    test_PutBits(&bw, 3, slot);                 /* frame_to_show_map_idx */
+    return bw.size;
+}
+
+/* superframe_index() with 2 byte sizes */
+static uint32_t test_PutSuperframeIndex(uint8_t *data, const uint32_t *sizes, unsigned int num_frames)
+{
+    uint8_t marker = 0xc0 | 1 << 3 | (num_frames - 1);
+    uint32_t n = 0;
+    unsigned int i;
+
+    data[n++] = marker;
+    for (i = 0; i < num_frames; i++) {
+        data[n++] = sizes[i] & 0xff;
+        data[n++] = sizes[i] >> 8;
+    }
+    data[n++] = marker;
+    return n;
+}
+
+static void test_Superframe(void)
+{
+    uint32_t offsets[VA_VP9_MAX_SUPERFRAME_FRAMES], sizes[VA_VP9_MAX_SUPERFRAME_FRAMES];
+    uint32_t frame_sizes[3] = { 300, 2, 0x1234 }, num_frames, size;
+    uint8_t data[0x1400];
+
+    memset(data, 0x11, sizeof(data));
+    size = 302 + test_PutSuperframeIndex(data + 302, frame_sizes, 2);
+    TEST_CHECK(vaSplitVP9Superframe(data, size, offsets, sizes, &num_frames) == VA_STATUS_SUCCESS);
+    TEST_CHECK(num_frames == 2);
+    TEST_CHECK(offsets[0] == 0 && sizes[0] == 300);
+    TEST_CHECK(offsets[1] == 300 && sizes[1] == 2);
+
+    /* a frame that does not fit in the payload */
+    size = 302 + 0x1234 - 1;
+    size += test_PutSuperframeIndex(data + size, frame_sizes, 3);
+    TEST_CHECK(vaSplitVP9Superframe(data, size, offsets, sizes, &num_frames) ==
+               VA_STATUS_ERROR_INVALID_PARAMETER);
+
+    /* without a matching first marker byte, the payload is a single frame */
+    size = 302 + test_PutSuperframeIndex(data + 302, frame_sizes, 2);
+    data[302] = 0;
+    TEST_CHECK(vaSplitVP9Superframe(data, size, offsets, sizes, &num_frames) == VA_STATUS_SUCCESS);
+    TEST_CHECK(num_frames == 1 && offsets[0] == 0 && sizes[0] == size);
+}
+
+static void test_CheckFilterLevels(const VASegmentParameterVP9 *seg, int level, int shift)
+{
+    static const int ref_deltas[4] = { 2, 0, -1, -1 };
+    static const int mode_deltas[2] = { 0, -1 };
+    int ref, mode;
+
+    for (ref = 0; ref < 4; ref++) {
+        for (mode = 0; mode < 2; mode++) {
+            int l = level + ref_deltas[ref] * (1 << shift);
+
+            if (ref)
+                l += mode_deltas[mode] * (1 << shift);
+            TEST_CHECK(seg->filter_level[ref][mode] == l);
+        }
+    }
+}
+
+static void test_CheckQuant(const VASegmentParameterVP9 *seg, int luma_dc, int luma_ac, int chroma_dc,
+                            int chroma_ac)
+{
+    TEST_CHECK(seg->luma_dc_quant_scale == luma_dc);
+    TEST_CHECK(seg->luma_ac_quant_scale == luma_ac);
+    TEST_CHECK(seg->chroma_dc_quant_scale == chroma_dc);
+    TEST_CHECK(seg->chroma_ac_quant_scale == chroma_ac);
+}
+
+static void test_CheckKeyFrame(const VAVP9PictureParams *params, uint32_t offset, uint32_t size,
+                               uint32_t header_size)
+{
+    const VADecPictureParameterBufferVP9 *pp = &params->pic_param;
+    const VASliceParameterBufferVP9 *sp = &params->slice_param;
+    int i;
+
+    TEST_CHECK(params->profile == VAProfileVP9Profile0 && !params->show_existing_frame);
+    TEST_CHECK(pp->profile == 0 && pp->bit_depth == 8);
+    TEST_CHECK(pp->frame_width == TEST_WIDTH && pp->frame_height == TEST_HEIGHT);
+    TEST_CHECK(pp->pic_fields.bits.subsampling_x && pp->pic_fields.bits.subsampling_y);
+    TEST_CHECK(pp->pic_fields.bits.frame_type == 0);
+    TEST_CHECK(pp->pic_fields.bits.show_frame && !pp->pic_fields.bits.error_resilient_mode);
+    TEST_CHECK(pp->pic_fields.bits.refresh_frame_context);
+    TEST_CHECK(!pp->pic_fields.bits.frame_parallel_decoding_mode);
+    TEST_CHECK(pp->pic_fields.bits.frame_context_idx == 0);
+    for (i = 0; i < 8; i++)
+        TEST_CHECK(pp->reference_frames[i] == VA_INVALID_SURFACE);
+    TEST_CHECK(pp->filter_level == 20 && pp->sharpness_level == 3);
+    TEST_CHECK(!pp->pic_fields.bits.lossless_flag);
+    TEST_CHECK(pp->pic_fields.bits.segmentation_enabled);
+    TEST_CHECK(pp->pic_fields.bits.segmentation_update_map);
+    TEST_CHECK(!pp->pic_fields.bits.segmentation_temporal_update);
+    for (i = 0; i < 7; i++)
+        TEST_CHECK(pp->mb_segment_tree_probs[i] == (i == 4 ? 255 : 10 + i));
+    for (i = 0; i < 3; i++)
+        TEST_CHECK(pp->segment_pred_probs[i] == 255);
+    TEST_CHECK(pp->log2_tile_columns == 0 && pp->log2_tile_rows == 1);
+    TEST_CHECK(pp->first_partition_size == 25);
+    TEST_CHECK(pp->frame_header_length_in_bytes == header_size);
+
+    TEST_CHECK(sp->slice_data_offset == offset && sp->slice_data_size == size);
+    TEST_CHECK(sp->slice_data_flag == VA_SLICE_DATA_FLAG_ALL);
+    /* qindex 60 with deltas -2, 0 and 3; 50 for segment 2 */
+    for (i = 0; i < 8; i++) {
+        const VASegmentParameterVP9 *seg = &sp->seg_param[i];
+
+        if (i == 2) {
+            test_CheckQuant(seg, 48, 57, 49, 60);
+            test_CheckFilterLevels(seg, 25, 0);
+        } else {
+            test_CheckQuant(seg, 56, 67, 57, 70);
+            test_CheckFilterLevels(seg, 20, 0);
+        }
+        TEST_CHECK(seg->segment_flags.fields.segment_reference_enabled == (i == 5));
+        TEST_CHECK(seg->segment_flags.fields.segment_reference == (i == 5));
+        TEST_CHECK(seg->segment_flags.fields.segment_reference_skipped == (i == 5));
+    }
+}
+
+static void test_CheckInterFrame(const VAVP9PictureParams *params, uint32_t offset, uint32_t size,
+                                 uint32_t header_size)
+{
+    const VADecPictureParameterBufferVP9 *pp = &params->pic_param;
+    const VASliceParameterBufferVP9 *sp = &params->slice_param;
+    int i;
+
+    TEST_CHECK(!params->show_existing_frame);
+    TEST_CHECK(pp->frame_width == TEST_WIDTH && pp->frame_height == TEST_HEIGHT);
+    TEST_CHECK(pp->pic_fields.bits.frame_type == 1);
+    TEST_CHECK(!pp->pic_fields.bits.show_frame && !pp->pic_fields.bits.intra_only);
+    TEST_CHECK(pp->pic_fields.bits.reset_frame_context == 0);
+    for (i = 0; i < 8; i++)
+        TEST_CHECK(pp->reference_frames[i] == TEST_KEY_SURFACE);
+    TEST_CHECK(pp->pic_fields.bits.last_ref_frame == 0 && !pp->pic_fields.bits.last_ref_frame_sign_bias);
+    TEST_CHECK(pp->pic_fields.bits.golden_ref_frame == 1 && !pp->pic_fields.bits.golden_ref_frame_sign_bias);
+    TEST_CHECK(pp->pic_fields.bits.alt_ref_frame == 6 && pp->pic_fields.bits.alt_ref_frame_sign_bias);
+    TEST_CHECK(pp->pic_fields.bits.allow_high_precision_mv);
+    TEST_CHECK(pp->pic_fields.bits.mcomp_filter_type == 0);
+    TEST_CHECK(!pp->pic_fields.bits.refresh_frame_context);
+    TEST_CHECK(pp->pic_fields.bits.frame_parallel_decoding_mode);
+    TEST_CHECK(pp->pic_fields.bits.frame_context_idx == 3);
+    TEST_CHECK(pp->filter_level == 36 && pp->sharpness_level == 0);
+    TEST_CHECK(pp->pic_fields.bits.segmentation_enabled);
+    TEST_CHECK(!pp->pic_fields.bits.segmentation_update_map);
+    TEST_CHECK(pp->log2_tile_rows == 0);
+    TEST_CHECK(pp->first_partition_size == 10);
+    TEST_CHECK(pp->frame_header_length_in_bytes == header_size);
+    TEST_CHECK(sp->slice_data_offset == offset && sp->slice_data_size == size);
+
+    /* the segment features and the loop filter deltas of the key frame */
+    for (i = 0; i < 8; i++) {
+        const VASegmentParameterVP9 *seg = &sp->seg_param[i];
+
+        if (i == 2) {
+            test_CheckQuant(seg, 81, 97, 81, 97);
+            test_CheckFilterLevels(seg, 41, 1);
+        } else {
+            test_CheckQuant(seg, 93, 112, 93, 112);
+            test_CheckFilterLevels(seg, 36, 1);
+        }
+        TEST_CHECK(seg->segment_flags.fields.segment_reference_skipped == (i == 5));
+    }
+}
+
+int main(void)
+{
+    static uint8_t stream[4096];
+    uint32_t offsets[VA_VP9_MAX_SUPERFRAME_FRAMES], sizes[VA_VP9_MAX_SUPERFRAME_FRAMES];
+    uint32_t state = 44, key_size, key_header, inter_header, payload_size, num_frames, result;
+    uint32_t frame_sizes[2];
+    uint8_t *payload;
+    VAVP9PictureParams params;
+    VAVP9Parser parser;
+
+    test_Superframe();
+
+    key_size = test_WriteKeyFrame(stream, &state, &key_header);
+    payload = stream + key_size;
+    frame_sizes[0] = test_WriteInterFrame(payload, &state, &inter_header);
+    frame_sizes[1] = test_WriteShowExistingFrame(payload + frame_sizes[0], 2);
+    payload_size = frame_sizes[0] + frame_sizes[1];
+    payload_size += test_PutSuperframeIndex(payload + payload_size, frame_sizes, 2);
+
+    TEST_CHECK(vaCreateVP9Parser(&parser) == VA_STATUS_SUCCESS);
+
+    TEST_CHECK(vaSplitVP9Superframe(stream, key_size, offsets, sizes, &num_frames) == VA_STATUS_SUCCESS);
+    TEST_CHECK(num_frames == 1 && offsets[0] == 0 && sizes[0] == key_size);
+    TEST_CHECK(vaParseVP9Frame(parser, stream, key_size, 0, &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == VA_VP9_PARSE_PICTURE);
+    TEST_CHECK(vaGetVP9PictureParams(parser, TEST_KEY_SURFACE, &params) == VA_STATUS_SUCCESS);
+    test_CheckKeyFrame(&params, 0, key_size, key_header);
+
+    TEST_CHECK(vaSplitVP9Superframe(payload, payload_size, offsets, sizes, &num_frames) == VA_STATUS_SUCCESS);
+    TEST_CHECK(num_frames == 2);
+    TEST_CHECK(offsets[0] == 0 && sizes[0] == frame_sizes[0]);
+    TEST_CHECK(offsets[1] == frame_sizes[0] && sizes[1] == frame_sizes[1]);
+
+    TEST_CHECK(vaParseVP9Frame(parser, payload + offsets[0], sizes[0], key_size + offsets[0],
+                               &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == (VA_VP9_PARSE_PICTURE | VA_VP9_PARSE_HIDDEN));
+    TEST_CHECK(vaGetVP9PictureParams(parser, TEST_INTER_SURFACE, &params) == VA_STATUS_SUCCESS);
+    test_CheckInterFrame(&params, key_size, sizes[0], inter_header);
+
+    TEST_CHECK(vaParseVP9Frame(parser, payload + offsets[1], sizes[1], key_size + offsets[1],
+                               &result) == VA_STATUS_SUCCESS);
+    TEST_CHECK(result == VA_VP9_PARSE_SHOW_EXISTING);
+    TEST_CHECK(vaGetVP9PictureParams(parser, VA_INVALID_SURFACE, &params) == VA_STATUS_SUCCESS);
+    TEST_CHECK(params.show_existing_frame && params.frame_to_show == TEST_INTER_SURFACE);
+
+    TEST_CHECK(vaDestroyVP9Parser(parser) == VA_STATUS_SUCCESS);
+    return 0;
+}
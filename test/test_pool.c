@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Parameter buffer pool on a display whose driver keeps the buffers in a
+ * table: reuse of released buffers with new content, the size classes
+ * of the data buffers, buffers destroyed by vaDestroyBuffer() while in
+ * use or idle, vaTrimBufferPool(), the LIBVA_BUFFER_POOL_SIZE bound and
+ * vaDestroyContext(); and the buffers of vaCreateBufferFromMemory(), kept
+ * by the driver or copied into pooled buffers.
+ */
+
+#include <va/va.h>
+#include <va/va_backend.h>
+#include <va/va_pool.h>
+
+#include "test_common.h"
+
+#define TEST_MAX_BUFFERS    16
+
+struct test_buffer {
+    int alive;
+    VAContextID context;
+    unsigned int size;
+    uint8_t *data;
+    void (*release)(void *release_data);    /* set by vaCreateBufferFromMemory() */
+    void *release_data;
+};
+
+static struct VADisplayContext test_display;
+static struct VADriverContext test_driver;
+static struct VADriverVTable test_vtable;
+
+static struct test_buffer test_buffers[TEST_MAX_BUFFERS];
+static unsigned int test_num_created;
+
+/* ids are reused as soon as they are free, like most drivers do */
+static VAStatus test_CreateBuffer(VADriverContextP ctx, VAContextID context, VABufferType type,
+                                  unsigned int size, unsigned int num_elements, void *data,
+                                  VABufferID *buf_id)
+{
+    VABufferID id = 0;
+
+    while (++id < TEST_MAX_BUFFERS && test_buffers[id].alive)
+        ;
+    if (id == TEST_MAX_BUFFERS)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    test_buffers[id].alive = 1;
+    test_buffers[id].context = context;
+    test_buffers[id].size = size * num_elements;
+    test_buffers[id].data = calloc(num_elements, size);
+    TEST_CHECK(test_buffers[id].data);
+    if (data)
+        memcpy(test_buffers[id].data, data, test_buffers[id].size);
+    test_num_created++;
+    *buf_id = id;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_MapBuffer(VADriverContextP ctx, VABufferID buf_id, void **pbuf)
+{
+    TEST_CHECK(buf_id < TEST_MAX_BUFFERS && test_buffers[buf_id].alive);
+    *pbuf = test_buffers[buf_id].data;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_UnmapBuffer(VADriverContextP ctx, VABufferID buf_id)
+{
+    TEST_CHECK(buf_id < TEST_MAX_BUFFERS && test_buffers[buf_id].alive);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_DestroyBuffer(VADriverContextP ctx, VABufferID buf_id)
+{
+    struct test_buffer *b;
+
+    TEST_CHECK(buf_id < TEST_MAX_BUFFERS && test_buffers[buf_id].alive);
+    b = &test_buffers[buf_id];
+    if (b->release)
+        b->release(b->release_data);
+    else
+        free(b->data);
+    memset(b, 0, sizeof(*b));
+    return VA_STATUS_SUCCESS;
+}
+
+/* only slice data buffers reference the application memory */
+static VAStatus test_CreateBufferFromMemory(VADriverContextP ctx, VAContextID context,
+        VABufferType type, unsigned int size, void *data,
+        void (*release)(void *release_data), void *release_data,
+        VABufferID *buf_id)
+{
+    VABufferID id = 0;
+
+    if (type != VASliceDataBufferType)
+        return VA_STATUS_ERROR_UNSUPPORTED_BUFFERTYPE;
+    while (++id < TEST_MAX_BUFFERS && test_buffers[id].alive)
+        ;
+    if (id == TEST_MAX_BUFFERS)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    test_buffers[id].alive = 1;
+    test_buffers[id].context = context;
+    test_buffers[id].size = size;
+    test_buffers[id].data = data;
+    test_buffers[id].release = release;
+    test_buffers[id].release_data = release_data;
+    *buf_id = id;
+    return VA_STATUS_SUCCESS;
+}
+
+/* the buffers of the context must have been destroyed before */
+static VAStatus test_DestroyContext(VADriverContextP ctx, VAContextID context)
+{
+    unsigned int i;
+
+    for (i = 0; i < TEST_MAX_BUFFERS; i++)
+        TEST_CHECK(!test_buffers[i].alive || test_buffers[i].context != context);
+    return VA_STATUS_SUCCESS;
+}
+
+static int test_IsValid(VADisplayContextP dctx)
+{
+    return 1;
+}
+
+static VADisplay test_Display(void)
+{
+    test_vtable.vaCreateBuffer = test_CreateBuffer;
+    test_vtable.vaMapBuffer = test_MapBuffer;
+    test_vtable.vaUnmapBuffer = test_UnmapBuffer;
+    test_vtable.vaDestroyBuffer = test_DestroyBuffer;
+    test_vtable.vaDestroyContext = test_DestroyContext;
+    test_driver.vtable = &test_vtable;
+    test_driver.pDisplayContext = &test_display;
+    test_display.vadpy_magic = VA_DISPLAY_MAGIC;
+    test_display.pDriverContext = &test_driver;
+    test_display.vaIsValid = test_IsValid;
+    return &test_display;
+}
+
+static unsigned int test_NumAlive(void)
+{
+    unsigned int i, n = 0;
+
+    for (i = 0; i < TEST_MAX_BUFFERS; i++)
+        n += test_buffers[i].alive;
+    return n;
+}
+
+static VABufferID test_Create(VADisplay dpy, VAContextID context, VABufferType type,
+                              unsigned int size, unsigned int num_elements, int value)
+{
+    uint8_t data[1024];
+    VABufferID id;
+
+    TEST_CHECK(size * num_elements <= sizeof(data));
+    memset(data, value, size * num_elements);
+    TEST_CHECK(vaCreatePooledBuffer(dpy, context, type, size, num_elements, data, &id) ==
+               VA_STATUS_SUCCESS);
+    TEST_CHECK(id < TEST_MAX_BUFFERS && test_buffers[id].alive);
+    TEST_CHECK(test_buffers[id].context == context);
+    TEST_CHECK(test_buffers[id].size >= size * num_elements);
+    TEST_CHECK(test_buffers[id].data[0] == value);
+    TEST_CHECK(test_buffers[id].data[size * num_elements - 1] == value);
+    return id;
+}
+
+static void test_Reuse(VADisplay dpy)
+{
+    VABufferID a, b, c, d;
+
+    a = test_Create(dpy, 1, VAPictureParameterBufferType, 100, 1, 1);
+    b = test_Create(dpy, 1, VASliceParameterBufferType, 100, 2, 2);
+    TEST_CHECK(a != b && test_num_created == 2);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, a) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, a) == VA_STATUS_ERROR_INVALID_BUFFER);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, b) == VA_STATUS_SUCCESS);
+
+    /* same parameters: the released buffers, with the new content */
+    TEST_CHECK(test_Create(dpy, 1, VAPictureParameterBufferType, 100, 1, 3) == a);
+    TEST_CHECK(test_Create(dpy, 1, VASliceParameterBufferType, 100, 2, 4) == b);
+    TEST_CHECK(test_num_created == 2);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, a) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, b) == VA_STATUS_SUCCESS);
+
+    /* any other context, type, size or number of elements: new buffers */
+    c = test_Create(dpy, 2, VAPictureParameterBufferType, 100, 1, 5);
+    d = test_Create(dpy, 1, VAIQMatrixBufferType, 100, 1, 6);
+    TEST_CHECK(c != a && d != a && test_num_created == 4);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, c) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, d) == VA_STATUS_SUCCESS);
+    c = test_Create(dpy, 1, VAPictureParameterBufferType, 101, 1, 7);
+    d = test_Create(dpy, 1, VASliceParameterBufferType, 100, 3, 8);
+    TEST_CHECK(test_num_created == 6);
+
+    /* data buffers of the same size class are interchangeable */
+    TEST_CHECK(vaReleasePooledBuffer(dpy, c) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, d) == VA_STATUS_SUCCESS);
+    c = test_Create(dpy, 1, VASliceDataBufferType, 10, 1, 9);
+    TEST_CHECK(test_buffers[c].size == 4096 && test_num_created == 7);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, c) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_Create(dpy, 1, VASliceDataBufferType, 1000, 1, 10) == c);
+    TEST_CHECK(test_num_created == 7);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, c) == VA_STATUS_SUCCESS);
+
+    /* idle buffers are destroyed by vaTrimBufferPool(), in use ones are kept */
+    a = test_Create(dpy, 1, VAPictureParameterBufferType, 100, 1, 11);
+    TEST_CHECK(vaTrimBufferPool(dpy, 0) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 1 && test_buffers[a].alive);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, a) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaTrimBufferPool(dpy, 0) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+}
+
+static void test_Destroy(VADisplay dpy)
+{
+    VABufferID a, b, c;
+    uint8_t data[100];
+
+    /*
+     * a pooled buffer destroyed while in use: the driver reuses its id
+     * for a buffer the pool does not own, which must not be released or
+     * handed out by the pool
+     */
+    test_num_created = 0;
+    a = test_Create(dpy, 1, VAPictureParameterBufferType, 100, 1, 1);
+    TEST_CHECK(vaDestroyBuffer(dpy, a) == VA_STATUS_SUCCESS);
+    TEST_CHECK(!test_buffers[a].alive);
+    memset(data, 2, sizeof(data));
+    TEST_CHECK(vaCreateBuffer(dpy, 1, VAPictureParameterBufferType, sizeof(data), 1, data, &b) ==
+               VA_STATUS_SUCCESS);
+    TEST_CHECK(b == a);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, b) == VA_STATUS_ERROR_INVALID_BUFFER);
+    c = test_Create(dpy, 1, VAPictureParameterBufferType, 100, 1, 3);
+    TEST_CHECK(c != b && test_buffers[b].data[0] == 2);
+    TEST_CHECK(vaDestroyBuffer(dpy, b) == VA_STATUS_SUCCESS);
+
+    /* an idle one: the next request creates a new buffer */
+    TEST_CHECK(vaReleasePooledBuffer(dpy, c) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaDestroyBuffer(dpy, c) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+    a = test_Create(dpy, 1, VAPictureParameterBufferType, 100, 1, 4);
+    TEST_CHECK(test_num_created == 4);
+    TEST_CHECK(vaDestroyBuffer(dpy, a) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaTrimBufferPool(dpy, 0) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+}
+
+static VABufferID test_released_id;
+static void *test_released_data;
+static unsigned int test_num_released;
+
+static void test_Release(VADisplay dpy, VABufferID buf_id, void *data, void *user_data)
+{
+    TEST_CHECK(user_data == &test_num_released);
+    test_released_id = buf_id;
+    test_released_data = data;
+    test_num_released++;
+}
+
+static VABufferID test_CreateFromMemory(VADisplay dpy, VABufferType type, uint8_t *data,
+                                        unsigned int size, int value)
+{
+    VABufferID id;
+
+    memset(data, value, size);
+    TEST_CHECK(vaCreateBufferFromMemory(dpy, 1, type, size, data, test_Release,
+                                        &test_num_released, &id) == VA_STATUS_SUCCESS);
+    TEST_CHECK(id < TEST_MAX_BUFFERS && test_buffers[id].alive);
+    TEST_CHECK(test_buffers[id].size >= size);
+    TEST_CHECK(test_buffers[id].data[0] == value && test_buffers[id].data[size - 1] == value);
+    return id;
+}
+
+static void test_FromMemory(VADisplay dpy)
+{
+    static uint8_t data[3000];
+    VABufferID a, b;
+
+    /* without the driver hook: copied, released at once, recycled by vaDestroyBuffer() */
+    test_num_created = 0;
+    a = test_CreateFromMemory(dpy, VASliceDataBufferType, data, 3000, 1);
+    TEST_CHECK(test_buffers[a].data != data && test_num_created == 1);
+    TEST_CHECK(test_num_released == 1 && test_released_id == a && test_released_data == data);
+    TEST_CHECK(vaDestroyBuffer(dpy, a) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_buffers[a].alive);
+    TEST_CHECK(test_CreateFromMemory(dpy, VASliceDataBufferType, data, 2000, 2) == a);
+    TEST_CHECK(test_num_created == 1 && test_num_released == 2);
+    TEST_CHECK(vaDestroyBuffer(dpy, a) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaTrimBufferPool(dpy, 0) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+
+    /* with it: the driver references the memory and releases it on destruction */
+    test_vtable.vaCreateBufferFromMemory = test_CreateBufferFromMemory;
+    a = test_CreateFromMemory(dpy, VASliceDataBufferType, data, 3000, 3);
+    TEST_CHECK(test_buffers[a].data == data && test_num_created == 1);
+    TEST_CHECK(test_num_released == 2);
+    TEST_CHECK(vaDestroyBuffer(dpy, a) == VA_STATUS_SUCCESS);
+    TEST_CHECK(!test_buffers[a].alive);
+    TEST_CHECK(test_num_released == 3 && test_released_id == a && test_released_data == data);
+
+    /* a type the driver does not support falls back to a pooled copy */
+    b = test_CreateFromMemory(dpy, VAPictureParameterBufferType, data, 100, 4);
+    TEST_CHECK(test_buffers[b].data != data && test_num_created == 2);
+    TEST_CHECK(test_num_released == 4 && test_released_id == b);
+    TEST_CHECK(vaDestroyBuffer(dpy, b) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaTrimBufferPool(dpy, 0) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+    test_vtable.vaCreateBufferFromMemory = NULL;
+}
+
+/* LIBVA_BUFFER_POOL_SIZE is 1 MiB: the least recently released go first */
+static void test_Bound(VADisplay dpy)
+{
+    VABufferID ids[3];
+    unsigned int i;
+
+    for (i = 0; i < 3; i++)
+        TEST_CHECK(vaCreatePooledBuffer(dpy, 1, VASliceDataBufferType, 400 << 10, 1, NULL,
+                                        &ids[i]) == VA_STATUS_SUCCESS);
+    for (i = 0; i < 3; i++)
+        TEST_CHECK(vaReleasePooledBuffer(dpy, ids[i]) == VA_STATUS_SUCCESS);
+    TEST_CHECK(!test_buffers[ids[0]].alive);
+    TEST_CHECK(test_buffers[ids[1]].alive && test_buffers[ids[2]].alive);
+    TEST_CHECK(vaTrimBufferPool(dpy, 0) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+}
+
+static void test_DestroyContextBuffers(VADisplay dpy)
+{
+    VABufferID a, b, c;
+
+    a = test_Create(dpy, 1, VAPictureParameterBufferType, 100, 1, 1);
+    b = test_Create(dpy, 1, VASliceParameterBufferType, 100, 1, 2);
+    c = test_Create(dpy, 2, VAPictureParameterBufferType, 100, 1, 3);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, b) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaDestroyContext(dpy, 1) == VA_STATUS_SUCCESS);
+    TEST_CHECK(!test_buffers[a].alive && !test_buffers[b].alive);
+    TEST_CHECK(test_buffers[c].alive);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, a) == VA_STATUS_ERROR_INVALID_BUFFER);
+    TEST_CHECK(vaReleasePooledBuffer(dpy, c) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaDestroyContext(dpy, 2) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+}
+
+int main(void)
+{
+    VADisplay dpy = test_Display();
+
+    setenv("LIBVA_BUFFER_POOL_SIZE", "1", 1);
+
+    test_Reuse(dpy);
+    test_Destroy(dpy);
+    test_Bound(dpy);
+    test_DestroyContextBuffers(dpy);
+    test_FromMemory(dpy);
+
+    printf("test_pool: ok\n");
+    return 0;
+}
@@ -0,0 +1,273 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * Slice data packer on a display whose driver keeps the buffers in a
+ * table: rebasing of the slice offsets while the data buffer grows, the
+ * rejected slices, and the reuse of the buffers of a picture by the next
+ * one through the buffer pool.
+ */
+
+#include <va/va.h>
+#include <va/va_backend.h>
+#include <va/va_pool.h>
+#include <va/va_slicedata.h>
+
+#include "test_common.h"
+
+#define TEST_MAX_BUFFERS    16
+#define TEST_CONTEXT        1
+
+struct test_buffer {
+    int alive;
+    int mapped;
+    VABufferType type;
+    unsigned int size;
+    unsigned int num_elements;
+    uint8_t *data;
+};
+
+static struct VADisplayContext test_display;
+static struct VADriverContext test_driver;
+static struct VADriverVTable test_vtable;
+
+static struct test_buffer test_buffers[TEST_MAX_BUFFERS];
+static unsigned int test_num_created;
+
+static VAStatus test_CreateBuffer(VADriverContextP ctx, VAContextID context, VABufferType type,
+                                  unsigned int size, unsigned int num_elements, void *data,
+                                  VABufferID *buf_id)
+{
+    VABufferID id = 0;
+
+    TEST_CHECK(context == TEST_CONTEXT);
+    while (++id < TEST_MAX_BUFFERS && test_buffers[id].alive)
+        ;
+    if (id == TEST_MAX_BUFFERS)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    test_buffers[id].alive = 1;
+    test_buffers[id].type = type;
+    test_buffers[id].size = size;
+    test_buffers[id].num_elements = num_elements;
+    test_buffers[id].data = calloc(num_elements, size);
+    TEST_CHECK(test_buffers[id].data);
+    if (data)
+        memcpy(test_buffers[id].data, data, (size_t)size * num_elements);
+    test_num_created++;
+    *buf_id = id;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_MapBuffer(VADriverContextP ctx, VABufferID buf_id, void **pbuf)
+{
+    TEST_CHECK(buf_id < TEST_MAX_BUFFERS && test_buffers[buf_id].alive);
+    TEST_CHECK(!test_buffers[buf_id].mapped);
+    test_buffers[buf_id].mapped = 1;
+    *pbuf = test_buffers[buf_id].data;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_UnmapBuffer(VADriverContextP ctx, VABufferID buf_id)
+{
+    TEST_CHECK(buf_id < TEST_MAX_BUFFERS && test_buffers[buf_id].mapped);
+    test_buffers[buf_id].mapped = 0;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_DestroyBuffer(VADriverContextP ctx, VABufferID buf_id)
+{
+    TEST_CHECK(buf_id < TEST_MAX_BUFFERS && test_buffers[buf_id].alive);
+    TEST_CHECK(!test_buffers[buf_id].mapped);
+    free(test_buffers[buf_id].data);
+    test_buffers[buf_id].alive = 0;
+    return VA_STATUS_SUCCESS;
+}
+
+static int test_IsValid(VADisplayContextP dctx)
+{
+    return 1;
+}
+
+static VADisplay test_Display(void)
+{
+    test_vtable.vaCreateBuffer = test_CreateBuffer;
+    test_vtable.vaMapBuffer = test_MapBuffer;
+    test_vtable.vaUnmapBuffer = test_UnmapBuffer;
+    test_vtable.vaDestroyBuffer = test_DestroyBuffer;
+    test_driver.vtable = &test_vtable;
+    test_driver.pDisplayContext = &test_display;
+    test_display.vadpy_magic = VA_DISPLAY_MAGIC;
+    test_display.pDriverContext = &test_driver;
+    test_display.vaIsValid = test_IsValid;
+    return &test_display;
+}
+
+static unsigned int test_NumAlive(void)
+{
+    unsigned int i, n = 0;
+
+    for (i = 0; i < TEST_MAX_BUFFERS; i++)
+        n += test_buffers[i].alive;
+    return n;
+}
+
+static void test_Slice(VASliceParameterBufferHEVC *slice, uint32_t offset, uint32_t size,
+                       int qp_delta)
+{
+    memset(slice, 0, sizeof(*slice));
+    slice->slice_data_offset = offset;
+    slice->slice_data_size = size;
+    slice->slice_data_flag = VA_SLICE_DATA_FLAG_BEGIN;
+    slice->slice_data_byte_offset = 5;
+    slice->slice_qp_delta = qp_delta;
+}
+
+/*
+ * appends chunks of 2000, 3000 and 10000 bytes, the second and third
+ * moving the slices already appended to a larger data buffer
+ */
+static void test_AppendPicture(VASliceDataPacker packer, uint8_t *stream, uint32_t seed)
+{
+    VASliceParameterBufferHEVC slices[2];
+    uint32_t state = seed;
+
+    test_FillRandom(&state, stream, 15000);
+
+    test_Slice(&slices[0], 0, 1200, 1);
+    test_Slice(&slices[1], 1200, 800, 2);
+    TEST_CHECK(vaAppendSliceData(packer, stream, 2000, slices, 2) == VA_STATUS_SUCCESS);
+
+    /* a size of 0 stands for the whole chunk */
+    test_Slice(&slices[0], 0, 0, 3);
+    TEST_CHECK(vaAppendSliceData(packer, stream + 2000, 3000, slices, 1) == VA_STATUS_SUCCESS);
+
+    /* slices that do not start at the beginning of the chunk */
+    test_Slice(&slices[0], 100, 4900, 4);
+    test_Slice(&slices[1], 5000, 5000, 5);
+    TEST_CHECK(vaAppendSliceData(packer, stream + 5000, 10000, slices, 2) == VA_STATUS_SUCCESS);
+}
+
+static void test_CheckPicture(VABufferID param_buf, VABufferID data_buf, unsigned int num_slices,
+                              const uint8_t *stream)
+{
+    static const uint32_t offsets[5] = { 0, 1200, 2000, 5100, 10000 };
+    static const uint32_t sizes[5] = { 1200, 800, 3000, 4900, 5000 };
+    const VASliceParameterBufferHEVC *slices;
+    const struct test_buffer *b;
+    unsigned int i;
+
+    TEST_CHECK(num_slices == 5);
+
+    TEST_CHECK(data_buf < TEST_MAX_BUFFERS && test_buffers[data_buf].alive);
+    b = &test_buffers[data_buf];
+    TEST_CHECK(b->type == VASliceDataBufferType && !b->mapped);
+    TEST_CHECK(b->size * b->num_elements >= 15000);
+    TEST_CHECK(memcmp(b->data, stream, 15000) == 0);
+
+    TEST_CHECK(param_buf < TEST_MAX_BUFFERS && test_buffers[param_buf].alive);
+    b = &test_buffers[param_buf];
+    TEST_CHECK(b->type == VASliceParameterBufferType && !b->mapped);
+    TEST_CHECK(b->size == sizeof(VASliceParameterBufferHEVC) && b->num_elements == 5);
+    slices = (const VASliceParameterBufferHEVC *)b->data;
+    for (i = 0; i < 5; i++) {
+        TEST_CHECK(slices[i].slice_data_offset == offsets[i]);
+        TEST_CHECK(slices[i].slice_data_size == sizes[i]);
+        TEST_CHECK(slices[i].slice_data_flag == VA_SLICE_DATA_FLAG_ALL);
+        TEST_CHECK(slices[i].slice_data_byte_offset == 5);
+        TEST_CHECK(slices[i].slice_qp_delta == (int)i + 1);
+    }
+}
+
+static void test_Pack(VADisplay dpy)
+{
+    static uint8_t stream[15000];
+    VASliceParameterBufferHEVC slice;
+    VASliceDataPacker packer;
+    VABufferID param_buf, data_buf;
+    unsigned int num_slices;
+
+    TEST_CHECK(vaCreateSliceDataPacker(dpy, TEST_CONTEXT, VAProfileHEVCMain, &packer) ==
+               VA_STATUS_SUCCESS);
+    TEST_CHECK(vaFinishSliceData(packer, &param_buf, &data_buf, &num_slices) ==
+               VA_STATUS_ERROR_INVALID_PARAMETER);
+
+    /* 4 KiB, then 8 and 16 KiB data buffers, the smaller ones going back to the pool */
+    test_AppendPicture(packer, stream, 1);
+    TEST_CHECK(test_num_created == 3 && test_NumAlive() == 3);
+    TEST_CHECK(vaFinishSliceData(packer, &param_buf, &data_buf, &num_slices) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_buffers[data_buf].size == 16384);
+    test_CheckPicture(param_buf, data_buf, num_slices, stream);
+    TEST_CHECK(vaDestroyBuffer(dpy, param_buf) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaDestroyBuffer(dpy, data_buf) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 4);
+
+    /* the next picture starts with the 16 KiB buffer and reuses both */
+    test_AppendPicture(packer, stream, 2);
+    TEST_CHECK(vaFinishSliceData(packer, &param_buf, &data_buf, &num_slices) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_num_created == 4);
+    test_CheckPicture(param_buf, data_buf, num_slices, stream);
+    TEST_CHECK(vaDestroyBuffer(dpy, param_buf) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaDestroyBuffer(dpy, data_buf) == VA_STATUS_SUCCESS);
+
+    /* slices outside of their chunk are rejected, without changing the picture */
+    test_Slice(&slice, 0, 100, 0);
+    TEST_CHECK(vaAppendSliceData(packer, stream, 100, &slice, 1) == VA_STATUS_SUCCESS);
+    test_Slice(&slice, 50, 51, 0);
+    TEST_CHECK(vaAppendSliceData(packer, stream, 100, &slice, 1) ==
+               VA_STATUS_ERROR_INVALID_PARAMETER);
+    test_Slice(&slice, 101, 1, 0);
+    TEST_CHECK(vaAppendSliceData(packer, stream, 100, &slice, 1) ==
+               VA_STATUS_ERROR_INVALID_PARAMETER);
+    TEST_CHECK(vaAppendSliceData(packer, NULL, 100, &slice, 1) ==
+               VA_STATUS_ERROR_INVALID_PARAMETER);
+    TEST_CHECK(vaFinishSliceData(packer, &param_buf, &data_buf, &num_slices) == VA_STATUS_SUCCESS);
+    TEST_CHECK(num_slices == 1);
+    /* the data buffer is reused, a parameter buffer of one element is new */
+    TEST_CHECK(test_num_created == 5);
+    TEST_CHECK(((VASliceParameterBufferHEVC *)test_buffers[param_buf].data)->slice_data_size == 100);
+    TEST_CHECK(vaDestroyBuffer(dpy, param_buf) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaDestroyBuffer(dpy, data_buf) == VA_STATUS_SUCCESS);
+
+    /* a picture in progress goes back to the pool, unmapped */
+    TEST_CHECK(vaAppendSliceData(packer, stream, 100, &slice, 0) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaDestroySliceDataPacker(packer) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaTrimBufferPool(dpy, 0) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_NumAlive() == 0);
+}
+
+int main(void)
+{
+    VADisplay dpy = test_Display();
+    VASliceDataPacker packer;
+
+    TEST_CHECK(vaCreateSliceDataPacker(dpy, TEST_CONTEXT, VAProfileVP9Profile0, &packer) ==
+               VA_STATUS_SUCCESS);
+    TEST_CHECK(vaDestroySliceDataPacker(packer) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaCreateSliceDataPacker(dpy, TEST_CONTEXT, VAProfileNone, &packer) ==
+               VA_STATUS_ERROR_UNSUPPORTED_PROFILE);
+
+    test_Pack(dpy);
+
+    printf("test_slicedata: ok\n");
+    return 0;
+}
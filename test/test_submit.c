@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * vaSubmitPictures() on a display whose driver logs the calls it gets:
+ * batches over several contexts, with and without the driver batch hook,
+ * and the multi-frame aggregation of the pictures of one batch.
+ */
+
+#include <va/va.h>
+#include <va/va_backend.h>
+
+#include "test_common.h"
+
+#define TEST_MF_CONTEXT     50
+#define TEST_BAD_BUFFER     99
+
+static struct VADisplayContext test_display;
+static struct VADriverContext test_driver;
+static struct VADriverVTable test_vtable;
+
+static char test_log[1024];
+
+static void test_Log(const char *format, unsigned int a, unsigned int b)
+{
+    size_t len = strlen(test_log);
+
+    snprintf(test_log + len, sizeof(test_log) - len, format, a, b);
+}
+
+static VAStatus test_BeginPicture(VADriverContextP ctx, VAContextID context, VASurfaceID render_target)
+{
+    test_Log("b%u:%u ", context, render_target);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_RenderPicture(VADriverContextP ctx, VAContextID context, VABufferID *buffers,
+                                   int num_buffers)
+{
+    int i;
+
+    for (i = 0; i < num_buffers; i++) {
+        test_Log("r%u:%u ", context, buffers[i]);
+        if (buffers[i] == TEST_BAD_BUFFER)
+            return VA_STATUS_ERROR_INVALID_BUFFER;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_EndPicture(VADriverContextP ctx, VAContextID context)
+{
+    test_Log("e%u ", context, 0);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_SubmitPictures(VADriverContextP ctx, VAPictureSubmission *pictures,
+                                    uint32_t num_pictures)
+{
+    uint32_t i;
+
+    for (i = 0; i < num_pictures; i++) {
+        test_Log("s%u:%u ", pictures[i].context, pictures[i].render_target);
+        pictures[i].status = VA_STATUS_SUCCESS;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_MFAddContext(VADriverContextP ctx, VAMFContextID mf_context, VAContextID context)
+{
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_MFSubmit(VADriverContextP ctx, VAMFContextID mf_context, VAContextID *contexts,
+                              int num_contexts)
+{
+    int i;
+
+    test_Log("m%u", mf_context, 0);
+    for (i = 0; i < num_contexts; i++)
+        test_Log(i ? ",%u" : ":%u", contexts[i], 0);
+    test_Log(" ", 0, 0);
+    return VA_STATUS_SUCCESS;
+}
+
+static int test_IsValid(VADisplayContextP dctx)
+{
+    return 1;
+}
+
+static VADisplay test_Display(void)
+{
+    test_vtable.vaBeginPicture = test_BeginPicture;
+    test_vtable.vaRenderPicture = test_RenderPicture;
+    test_vtable.vaEndPicture = test_EndPicture;
+    test_vtable.vaMFAddContext = test_MFAddContext;
+    test_vtable.vaMFSubmit = test_MFSubmit;
+    test_driver.vtable = &test_vtable;
+    test_driver.pDisplayContext = &test_display;
+    test_display.vadpy_magic = VA_DISPLAY_MAGIC;
+    test_display.pDriverContext = &test_driver;
+    test_display.vaIsValid = test_IsValid;
+    return &test_display;
+}
+
+/* submits the pictures of the given contexts, each rendering one buffer, and returns the status */
+static VAStatus test_Submit(VADisplay dpy, const VAContextID *contexts, const VABufferID *buffers,
+                            VAStatus *statuses, uint32_t num_pictures)
+{
+    VAPictureSubmission pictures[8];
+    VABufferID picture_buffers[8];
+    VAStatus va_status;
+    uint32_t i;
+
+    memset(pictures, 0, sizeof(pictures));
+    for (i = 0; i < num_pictures; i++) {
+        picture_buffers[i] = buffers[i];
+        pictures[i].context = contexts[i];
+        pictures[i].render_target = 10 + i;
+        pictures[i].buffers = &picture_buffers[i];
+        pictures[i].num_buffers = 1;
+        pictures[i].status = VA_STATUS_ERROR_UNKNOWN;
+    }
+    test_log[0] = 0;
+    va_status = vaSubmitPictures(dpy, pictures, num_pictures);
+    for (i = 0; i < num_pictures; i++)
+        statuses[i] = pictures[i].status;
+    return va_status;
+}
+
+int main(void)
+{
+    static const VAContextID contexts[4] = { 1, 2, 1, 2 };
+    static const VABufferID buffers[4] = { 20, 21, 22, 23 };
+    static const VABufferID bad_buffers[3] = { 20, TEST_BAD_BUFFER, 22 };
+    static const VAContextID three_contexts[3] = { 1, 2, 3 };
+    VADisplay dpy = test_Display();
+    VAPictureSubmission pictures[2];
+    VAStatus statuses[4];
+
+    /* a picture that cannot be waited for fails the test rather than hanging it */
+    alarm(10);
+
+    TEST_CHECK(vaSubmitPictures(dpy, NULL, 0) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaSubmitPictures(dpy, NULL, 1) == VA_STATUS_ERROR_INVALID_PARAMETER);
+
+    /* nothing is submitted when one of the pictures has no buffer array */
+    memset(pictures, 0, sizeof(pictures));
+    pictures[0].context = 1;
+    pictures[0].render_target = 10;
+    pictures[1].context = 2;
+    pictures[1].render_target = 11;
+    pictures[1].num_buffers = 1;
+    test_log[0] = 0;
+    TEST_CHECK(vaSubmitPictures(dpy, pictures, 2) == VA_STATUS_ERROR_INVALID_PARAMETER);
+    TEST_CHECK(!strcmp(test_log, ""));
+
+    /* one picture per context, the failing one does not stop the others */
+    TEST_CHECK(test_Submit(dpy, three_contexts, bad_buffers, statuses, 3) == VA_STATUS_ERROR_INVALID_BUFFER);
+    TEST_CHECK(!strcmp(test_log, "b1:10 r1:20 e1 b2:11 r2:99 e2 b3:12 r3:22 e3 "));
+    TEST_CHECK(statuses[0] == VA_STATUS_SUCCESS);
+    TEST_CHECK(statuses[1] == VA_STATUS_ERROR_INVALID_BUFFER);
+    TEST_CHECK(statuses[2] == VA_STATUS_SUCCESS);
+
+    /* both contexts of an aggregated group in one batch make one submission */
+    TEST_CHECK(vaMFAddContext(dpy, TEST_MF_CONTEXT, 1) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaMFAddContext(dpy, TEST_MF_CONTEXT, 2) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaMFSetAggregation(dpy, TEST_MF_CONTEXT, VA_MF_AGGREGATE, VA_TIMEOUT_INFINITE) ==
+               VA_STATUS_SUCCESS);
+    TEST_CHECK(test_Submit(dpy, contexts, buffers, statuses, 2) == VA_STATUS_SUCCESS);
+    TEST_CHECK(!strcmp(test_log, "b1:10 r1:20 e1 b2:11 r2:21 e2 m50:1,2 "));
+    TEST_CHECK(statuses[0] == VA_STATUS_SUCCESS && statuses[1] == VA_STATUS_SUCCESS);
+
+    /* two pictures per context, one submission each */
+    TEST_CHECK(test_Submit(dpy, contexts, buffers, statuses, 4) == VA_STATUS_SUCCESS);
+    TEST_CHECK(!strcmp(test_log, "b1:10 r1:20 e1 b2:11 r2:21 e2 b1:12 r1:22 e1 b2:13 r2:23 e2 "
+                       "m50:1,2 m50:1,2 "));
+
+    /* an incomplete batch is submitted once the timeout expired */
+    TEST_CHECK(vaMFSetAggregation(dpy, TEST_MF_CONTEXT, VA_MF_AGGREGATE, 1000000) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_Submit(dpy, contexts, buffers, statuses, 1) == VA_STATUS_SUCCESS);
+    TEST_CHECK(!strcmp(test_log, "b1:10 r1:20 e1 m50:1 "));
+
+    /* a picture whose render failed is not part of the submission */
+    TEST_CHECK(test_Submit(dpy, three_contexts, bad_buffers, statuses, 3) == VA_STATUS_ERROR_INVALID_BUFFER);
+    TEST_CHECK(!strcmp(test_log, "b1:10 r1:20 e1 b2:11 r2:99 e2 b3:12 r3:22 e3 m50:1 "));
+    TEST_CHECK(statuses[0] == VA_STATUS_SUCCESS);
+    TEST_CHECK(statuses[1] == VA_STATUS_ERROR_INVALID_BUFFER);
+    TEST_CHECK(statuses[2] == VA_STATUS_SUCCESS);
+
+    /* the driver batch hook, still aggregated */
+    test_vtable.vaSubmitPictures = test_SubmitPictures;
+    TEST_CHECK(vaMFSetAggregation(dpy, TEST_MF_CONTEXT, VA_MF_AGGREGATE, VA_TIMEOUT_INFINITE) ==
+               VA_STATUS_SUCCESS);
+    TEST_CHECK(test_Submit(dpy, contexts, buffers, statuses, 4) == VA_STATUS_SUCCESS);
+    TEST_CHECK(!strcmp(test_log, "s1:10 s2:11 s1:12 s2:13 m50:1,2 m50:1,2 "));
+    TEST_CHECK(statuses[0] == VA_STATUS_SUCCESS && statuses[3] == VA_STATUS_SUCCESS);
+
+    /* and without aggregation */
+    TEST_CHECK(vaMFSetAggregation(dpy, TEST_MF_CONTEXT, 0, 0) == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_Submit(dpy, contexts, buffers, statuses, 2) == VA_STATUS_SUCCESS);
+    TEST_CHECK(!strcmp(test_log, "s1:10 s2:11 "));
+
+    return 0;
+}
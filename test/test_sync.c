@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*
+ * vaSyncObjects() emulation and the completion callbacks on a display
+ * whose driver only has vaSyncSurface2(): surfaces complete after a given
+ * number of waits on them, VA_SYNC_WAIT_ANY and VA_SYNC_WAIT_ALL are
+ * checked with and without timeouts, and objects the driver cannot wait
+ * for fail the wait instead of completing it. Destroying an object
+ * completes its registered waits without asking the driver about it again.
+ */
+
+#include <va/va.h>
+#include <va/va_backend.h>
+
+#include "test_common.h"
+
+#include <poll.h>
+
+#define TEST_MAX_SURFACES   8
+#define TEST_BUFFER         20
+
+static struct VADisplayContext test_display;
+static struct VADriverContext test_driver;
+static struct VADriverVTable test_vtable;
+
+/* number of vaSyncSurface2() calls left before each surface completes, -1 never */
+static int test_pending[TEST_MAX_SURFACES];
+static int test_destroyed[TEST_MAX_SURFACES];
+static int test_callbacks;
+static VAStatus test_callback_status;
+
+static VAStatus test_SyncSurface(VADriverContextP ctx, VASurfaceID surface)
+{
+    return VA_STATUS_ERROR_UNIMPLEMENTED;
+}
+
+static VAStatus test_SyncSurface2(VADriverContextP ctx, VASurfaceID surface, uint64_t timeout_ns)
+{
+    int pending;
+
+    if (surface >= TEST_MAX_SURFACES)
+        return VA_STATUS_ERROR_INVALID_SURFACE;
+    TEST_CHECK(!__atomic_load_n(&test_destroyed[surface], __ATOMIC_ACQUIRE));
+    pending = __atomic_load_n(&test_pending[surface], __ATOMIC_ACQUIRE);
+    /* an infinite wait returns once the surface completed */
+    if (pending == 0 || (pending > 0 && timeout_ns == VA_TIMEOUT_INFINITE)) {
+        __atomic_store_n(&test_pending[surface], 0, __ATOMIC_RELEASE);
+        return VA_STATUS_SUCCESS;
+    }
+    if (pending > 0)
+        __atomic_store_n(&test_pending[surface], pending - 1, __ATOMIC_RELEASE);
+    return VA_STATUS_ERROR_TIMEDOUT;
+}
+
+static VAStatus test_SyncBuffer(VADriverContextP ctx, VABufferID buf_id, uint64_t timeout_ns)
+{
+    TEST_CHECK(buf_id == TEST_BUFFER);
+    return VA_STATUS_ERROR_TIMEDOUT;
+}
+
+static VAStatus test_DestroySurfaces(VADriverContextP ctx, VASurfaceID *surfaces, int num_surfaces)
+{
+    int i;
+
+    for (i = 0; i < num_surfaces; i++)
+        __atomic_store_n(&test_destroyed[surfaces[i]], 1, __ATOMIC_RELEASE);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus test_DestroyBuffer(VADriverContextP ctx, VABufferID buf_id)
+{
+    return VA_STATUS_SUCCESS;
+}
+
+static int test_IsValid(VADisplayContextP dctx)
+{
+    return 1;
+}
+
+static VADisplay test_Display(void)
+{
+    test_vtable.vaSyncSurface = test_SyncSurface;
+    test_vtable.vaSyncSurface2 = test_SyncSurface2;
+    test_vtable.vaDestroySurfaces = test_DestroySurfaces;
+    test_vtable.vaDestroyBuffer = test_DestroyBuffer;
+    test_driver.vtable = &test_vtable;
+    test_driver.pDisplayContext = &test_display;
+    test_display.vadpy_magic = VA_DISPLAY_MAGIC;
+    test_display.pDriverContext = &test_driver;
+    test_display.vaIsValid = test_IsValid;
+    return &test_display;
+}
+
+static void test_Callback(VADisplay dpy, VASyncObjectType obj_type, VAGenericID id, VAStatus status,
+                          void *user_data)
+{
+    TEST_CHECK(id == (obj_type == VASyncObjectSurface ? 3 : TEST_BUFFER));
+    TEST_CHECK(user_data == &test_callbacks);
+    test_callback_status = status;
+    __atomic_add_fetch(&test_callbacks, 1, __ATOMIC_RELEASE);
+}
+
+static void test_WaitCallbacks(int num_callbacks)
+{
+    while (__atomic_load_n(&test_callbacks, __ATOMIC_ACQUIRE) < num_callbacks)
+        usleep(1000);
+    usleep(10000);
+    TEST_CHECK(test_callbacks == num_callbacks);
+}
+
+static void test_SetObjects(VASyncObject *objects, const VASurfaceID *surfaces, uint32_t num_objects)
+{
+    uint32_t i;
+
+    memset(objects, 0, num_objects * sizeof(*objects));
+    for (i = 0; i < num_objects; i++) {
+        objects[i].obj_type = VASyncObjectSurface;
+        objects[i].object.surface_id = surfaces[i];
+        objects[i].status = VA_STATUS_ERROR_UNKNOWN;
+    }
+}
+
+int main(void)
+{
+    static const VASurfaceID surfaces[3] = { 1, 2, 3 };
+    VADisplay dpy = test_Display();
+    VASurfaceID surface = 3;
+    VASyncObject objects[4];
+    uint32_t num_completed;
+    struct pollfd pfd;
+    int fd;
+
+    alarm(10);
+
+    /* all done */
+    test_SetObjects(objects, surfaces, 3);
+    TEST_CHECK(vaSyncObjects(dpy, objects, 3, VA_SYNC_WAIT_ALL, 0, &num_completed) == VA_STATUS_SUCCESS);
+    TEST_CHECK(num_completed == 3);
+    TEST_CHECK(objects[0].status == VA_STATUS_SUCCESS && objects[2].status == VA_STATUS_SUCCESS);
+
+    /* one of them never completes */
+    test_pending[2] = -1;
+    test_SetObjects(objects, surfaces, 3);
+    TEST_CHECK(vaSyncObjects(dpy, objects, 3, VA_SYNC_WAIT_ALL, 1000000, &num_completed) ==
+               VA_STATUS_ERROR_TIMEDOUT);
+    TEST_CHECK(num_completed == 2);
+    TEST_CHECK(objects[1].status == VA_STATUS_ERROR_TIMEDOUT);
+    test_SetObjects(objects, surfaces, 3);
+    TEST_CHECK(vaSyncObjects(dpy, objects, 3, VA_SYNC_WAIT_ANY, 0, &num_completed) == VA_STATUS_SUCCESS);
+    TEST_CHECK(num_completed == 2);
+    test_SetObjects(objects, &surfaces[1], 1);
+    TEST_CHECK(vaSyncObjects(dpy, objects, 1, VA_SYNC_WAIT_ANY, 1000000, &num_completed) ==
+               VA_STATUS_ERROR_TIMEDOUT);
+    TEST_CHECK(num_completed == 0);
+
+    /* ANY returns once one completed, ALL waits for the last one */
+    test_pending[2] = -1;
+    test_pending[3] = 5;
+    test_SetObjects(objects, &surfaces[1], 2);
+    TEST_CHECK(vaSyncObjects(dpy, objects, 2, VA_SYNC_WAIT_ANY, VA_TIMEOUT_INFINITE, &num_completed) ==
+               VA_STATUS_SUCCESS);
+    TEST_CHECK(num_completed == 1);
+    TEST_CHECK(objects[0].status == VA_STATUS_ERROR_TIMEDOUT && objects[1].status == VA_STATUS_SUCCESS);
+    test_pending[2] = 3;
+    test_pending[3] = 7;
+    test_SetObjects(objects, &surfaces[1], 2);
+    TEST_CHECK(vaSyncObjects(dpy, objects, 2, VA_SYNC_WAIT_ALL, VA_TIMEOUT_INFINITE, &num_completed) ==
+               VA_STATUS_SUCCESS);
+    TEST_CHECK(num_completed == 2);
+    TEST_CHECK(test_pending[2] == 0 && test_pending[3] == 0);
+
+    /* a failed synchronization is not a completion, for ANY either */
+    test_pending[2] = -1;
+    test_SetObjects(objects, surfaces, 3);
+    objects[0].object.surface_id = TEST_MAX_SURFACES;
+    TEST_CHECK(vaSyncObjects(dpy, objects, 3, VA_SYNC_WAIT_ALL, VA_TIMEOUT_INFINITE, &num_completed) ==
+               VA_STATUS_ERROR_INVALID_SURFACE);
+    TEST_CHECK(num_completed == 1);
+    TEST_CHECK(objects[0].status == VA_STATUS_ERROR_INVALID_SURFACE);
+
+    /* the driver has no vaSyncBuffer() */
+    test_SetObjects(objects, &surfaces[1], 1);
+    objects[1] = objects[0];
+    objects[1].obj_type = VASyncObjectBuffer;
+    objects[1].object.buffer_id = TEST_BUFFER;
+    TEST_CHECK(vaSyncObjects(dpy, objects, 2, VA_SYNC_WAIT_ANY, 1000000, &num_completed) ==
+               VA_STATUS_ERROR_UNIMPLEMENTED);
+    TEST_CHECK(num_completed == 0);
+    TEST_CHECK(objects[1].status == VA_STATUS_ERROR_UNIMPLEMENTED);
+    TEST_CHECK(vaGetCompletionFd(dpy, VASyncObjectBuffer, TEST_BUFFER, 0, &fd) ==
+               VA_STATUS_ERROR_UNIMPLEMENTED);
+    TEST_CHECK(fd == -1);
+    TEST_CHECK(vaRegisterCompletionCallback(dpy, VASyncObjectBuffer, TEST_BUFFER, test_Callback,
+                                            &test_callbacks) == VA_STATUS_ERROR_UNIMPLEMENTED);
+
+    /* a callback runs once the surface completed */
+    test_pending[3] = 20;
+    TEST_CHECK(vaRegisterCompletionCallback(dpy, VASyncObjectSurface, 3, test_Callback,
+                                            &test_callbacks) == VA_STATUS_SUCCESS);
+    test_WaitCallbacks(1);
+    TEST_CHECK(test_callback_status == VA_STATUS_SUCCESS);
+    TEST_CHECK(test_pending[3] == 0);
+
+    /* destroying the objects completes their waits, the driver is not asked about them again */
+    test_pending[3] = -1;
+    TEST_CHECK(vaRegisterCompletionCallback(dpy, VASyncObjectSurface, 3, test_Callback,
+                                            &test_callbacks) == VA_STATUS_SUCCESS);
+    TEST_CHECK(vaGetCompletionFd(dpy, VASyncObjectSurface, 3, 0, &fd) == VA_STATUS_SUCCESS);
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    TEST_CHECK(poll(&pfd, 1, 20) == 0);
+    TEST_CHECK(vaDestroySurfaces(dpy, &surface, 1) == VA_STATUS_SUCCESS);
+    test_WaitCallbacks(2);
+    TEST_CHECK(test_callback_status == VA_STATUS_ERROR_INVALID_SURFACE);
+    TEST_CHECK(poll(&pfd, 1, 1000) == 1);
+    close(fd);
+    usleep(10000);
+
+    test_vtable.vaSyncBuffer = test_SyncBuffer;
+    TEST_CHECK(vaRegisterCompletionCallback(dpy, VASyncObjectBuffer, TEST_BUFFER, test_Callback,
+                                            &test_callbacks) == VA_STATUS_SUCCESS);
+    usleep(10000);
+    TEST_CHECK(vaDestroyBuffer(dpy, TEST_BUFFER) == VA_STATUS_SUCCESS);
+    test_WaitCallbacks(3);
+    TEST_CHECK(test_callback_status == VA_STATUS_ERROR_INVALID_BUFFER);
+
+    return 0;
+}
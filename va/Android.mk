@@ -42,7 +42,25 @@ LOCAL_SRC_FILES := \
 	va.c \
 	va_trace.c \
 	va_fool.c  \
-	va_str.c
+	va_str.c \
+	va_convert.c \
+	va_readback.c \
+	va_thread.c \
+	va_copy.c \
+	va_pool.c \
+	va_sync.c \
+	va_mf.c \
+	va_dmabuf.c \
+	va_hostmem.c \
+	va_bitstream.c \
+	va_parse_hevc.c \
+	va_parse_av1.c \
+	va_parse_vp9.c \
+	va_parse_jpeg.c \
+	va_packed_header.c \
+	va_slicedata.c \
+	va_dpb.c \
+	va_fei_stats.c
 
 LOCAL_CFLAGS_32 += \
 	-DVA_DRIVERS_PATH="\"$(LIBVA_DRIVERS_PATH_32)\"" \
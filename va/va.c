@@ -31,6 +31,7 @@
 #include "va_internal.h"
 #include "va_trace.h"
 #include "va_fool.h"
+#include "va_copy.h"
 
 #include <assert.h>
 #include <stdarg.h>
@@ -525,6 +526,14 @@ static VAStatus va_openDriver(VADisplay dpy, char *driver_name)
                 if (init_func && VA_STATUS_SUCCESS == vaStatus)
                     vaStatus = (*init_func)(ctx);
 
+                /* drivers built against VA-API < 1.14 do not know these hooks */
+                if (VA_STATUS_SUCCESS == vaStatus && compatible_versions[i].minor < 14) {
+                    ctx->vtable->vaSubmitPictures = NULL;
+                    ctx->vtable->vaSyncObjects = NULL;
+                    ctx->vtable->vaGetCompletionFd = NULL;
+                    ctx->vtable->vaCreateBufferFromMemory = NULL;
+                }
+
                 if (VA_STATUS_SUCCESS == vaStatus) {
                     CHECK_MAXIMUM(vaStatus, ctx, profiles);
                     CHECK_MAXIMUM(vaStatus, ctx, entrypoints);
@@ -778,11 +787,19 @@ VAStatus vaTerminate(
     CHECK_DISPLAY(dpy);
     old_ctx = CTX(dpy);
 
+    va_SyncEnd(dpy);
+    va_MFEnd(dpy);
+    va_CopyEnd(dpy);
+    va_DmaBufEnd(dpy);
+    va_ReadbackEnd(dpy);
+    va_BufferPoolEnd(dpy);
+
     if (old_ctx->handle) {
         vaStatus = old_ctx->vtable->vaTerminate(old_ctx);
         dlclose(old_ctx->handle);
         old_ctx->handle = NULL;
     }
+    va_HostMemEnd(dpy);
     free(old_ctx->vtable);
     old_ctx->vtable = NULL;
     free(old_ctx->vtable_vpp);
@@ -1204,6 +1221,7 @@ VAStatus vaDestroySurfaces(
 {
     VADriverContextP ctx;
     VAStatus vaStatus;
+    int i;
 
     CHECK_DISPLAY(dpy);
     ctx = CTX(dpy);
@@ -1211,7 +1229,16 @@ VAStatus vaDestroySurfaces(
     VA_TRACE_LOG(va_TraceDestroySurfaces,
                  dpy, surface_list, num_surfaces);
 
+    for (i = 0; surface_list && i < num_surfaces; i++) {
+        va_CopyForget(dpy, VACopyObjectSurface, surface_list[i]);
+        va_SyncForget(dpy, VASyncObjectSurface, surface_list[i]);
+    }
+    va_DmaBufForgetSurfaces(dpy, surface_list, num_surfaces);
+
     vaStatus = ctx->vtable->vaDestroySurfaces(ctx, surface_list, num_surfaces);
+    /* the driver is done with the memory of host memory surfaces */
+    if (vaStatus == VA_STATUS_SUCCESS)
+        va_HostMemForgetSurfaces(dpy, surface_list, num_surfaces);
     VA_TRACE_RET(dpy, vaStatus);
 
     return vaStatus;
@@ -1255,6 +1282,9 @@ VAStatus vaDestroyContext(
     CHECK_DISPLAY(dpy);
     ctx = CTX(dpy);
 
+    va_BufferPoolDestroyContext(dpy, context);
+    va_MFDestroyContext(dpy, context);
+
     vaStatus = ctx->vtable->vaDestroyContext(ctx, context);
 
     VA_TRACE_ALL(va_TraceDestroyContext, dpy, context);
@@ -1301,6 +1331,8 @@ VAStatus vaMFAddContext(
     else {
         vaStatus = ctx->vtable->vaMFAddContext(ctx, context, mf_context);
         VA_TRACE_ALL(va_TraceMFAddContext, dpy, context, mf_context);
+        if (vaStatus == VA_STATUS_SUCCESS)
+            va_MFAddContext(dpy, mf_context, context);
     }
 
     VA_TRACE_RET(dpy, vaStatus);
@@ -1321,6 +1353,7 @@ VAStatus vaMFReleaseContext(
     if (ctx->vtable->vaMFReleaseContext == NULL)
         vaStatus = VA_STATUS_ERROR_UNIMPLEMENTED;
     else {
+        va_MFReleaseContext(dpy, mf_context, context);
         vaStatus = ctx->vtable->vaMFReleaseContext(ctx, context, mf_context);
         VA_TRACE_ALL(va_TraceMFReleaseContext, dpy, context, mf_context);
     }
@@ -1408,6 +1441,76 @@ VAStatus vaCreateBuffer2(
     return vaStatus;
 }
 
+struct va_memory_release {
+    VADisplay dpy;
+    VABufferID buf_id;
+    void *data;
+    VABufferReleaseCallback release;
+    void *user_data;
+};
+
+static void va_ReleaseMemory(void *release_data)
+{
+    struct va_memory_release *r = release_data;
+
+    if (r->release)
+        r->release(r->dpy, r->buf_id, r->data, r->user_data);
+    free(r);
+}
+
+VAStatus vaCreateBufferFromMemory(
+    VADisplay dpy,
+    VAContextID context,
+    VABufferType type,
+    unsigned int size,
+    void *data,
+    VABufferReleaseCallback release,
+    void *user_data,
+    VABufferID *buf_id
+)
+{
+    VADriverContextP ctx;
+    VAStatus vaStatus = VA_STATUS_ERROR_UNIMPLEMENTED;
+
+    CHECK_DISPLAY(dpy);
+    ctx = CTX(dpy);
+
+    if (!data || !size || !buf_id)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    if (ctx->vtable->vaCreateBufferFromMemory && !va_fool_codec) {
+        struct va_memory_release *r = calloc(1, sizeof(*r));
+
+        if (!r)
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+        r->dpy = dpy;
+        r->data = data;
+        r->release = release;
+        r->user_data = user_data;
+        /* the driver only releases the memory once the buffer is destroyed */
+        vaStatus = ctx->vtable->vaCreateBufferFromMemory(ctx, context, type, size, data,
+                   va_ReleaseMemory, r, &r->buf_id);
+        if (vaStatus == VA_STATUS_SUCCESS) {
+            *buf_id = r->buf_id;
+            VA_TRACE_LOG(va_TraceCreateBuffer,
+                         dpy, context, type, size, 1, data, buf_id);
+        } else {
+            free(r);
+        }
+    }
+
+    if (vaStatus == VA_STATUS_ERROR_UNIMPLEMENTED ||
+        vaStatus == VA_STATUS_ERROR_UNSUPPORTED_BUFFERTYPE) {
+        vaStatus = va_BufferPoolCreate(dpy, context, type, size, 1, data, 1, buf_id);
+        /* the data was copied */
+        if (vaStatus == VA_STATUS_SUCCESS && release)
+            release(dpy, *buf_id, data, user_data);
+    }
+    VA_TRACE_RET(dpy, vaStatus);
+
+    return vaStatus;
+}
+
 VAStatus vaBufferSetNumElements(
     VADisplay dpy,
     VABufferID buf_id,  /* in */
@@ -1481,6 +1584,15 @@ VAStatus vaDestroyBuffer(
     VA_TRACE_LOG(va_TraceDestroyBuffer,
                  dpy, buffer_id);
 
+    va_CopyForget(dpy, VACopyObjectBuffer, buffer_id);
+    va_SyncForget(dpy, VASyncObjectBuffer, buffer_id);
+    /* buffers staging vaCreateBufferFromMemory() go back to the pool */
+    if (va_BufferPoolRecycle(dpy, buffer_id)) {
+        VA_TRACE_RET(dpy, VA_STATUS_SUCCESS);
+        return VA_STATUS_SUCCESS;
+    }
+    va_BufferPoolForget(dpy, buffer_id);
+
     vaStatus = ctx->vtable->vaDestroyBuffer(ctx, buffer_id);
     VA_TRACE_RET(dpy, vaStatus);
     return vaStatus;
@@ -1565,22 +1677,60 @@ vaExportSurfaceHandle(VADisplay dpy, VASurfaceID surface_id,
     return vaStatus;
 }
 
+/* driver vaBeginPicture() with the libva side bookkeeping, shared by vaSubmitPictures() */
+static VAStatus va_BeginPicture(VADisplay dpy, VAContextID context, VASurfaceID render_target)
+{
+    VADriverContextP ctx = CTX(dpy);
+
+    /* the surface is written again, its software copies are no longer the last operation on it */
+    va_CopyForget(dpy, VACopyObjectSurface, render_target);
+    return ctx->vtable->vaBeginPicture(ctx, context, render_target);
+}
+
+/*
+ * driver vaEndPicture() with the libva side post-processing, vaSubmitPictures()
+ * leaves the aggregation to va_MFEndPictures() once the whole batch is ended
+ */
+static VAStatus va_EndPicture(VADisplay dpy, VAContextID context, int aggregate)
+{
+    VADriverContextP ctx = CTX(dpy);
+    VAStatus va_status;
+
+    va_status = ctx->vtable->vaEndPicture(ctx, context);
+    /* with aggregation enabled, the picture is only submitted by vaMFSubmit() */
+    if (va_status == VA_STATUS_SUCCESS && aggregate)
+        va_MFEndPicture(dpy, context, &va_status);
+    return va_status;
+}
+
+static VAStatus va_EndPictureTraced(VADisplay dpy, VAContextID context, int aggregate)
+{
+    VAStatus va_status;
+
+    VA_FOOL_FUNC(va_FoolCheckContinuity, dpy);
+    VA_TRACE_ALL(va_TraceEndPicture, dpy, context, 0);
+    va_status = va_EndPicture(dpy, context, aggregate);
+    VA_TRACE_RET(dpy, va_status);
+    /* dump surface content */
+    VA_TRACE_ALL(va_TraceEndPictureExt, dpy, context, 1);
+
+    return va_status;
+}
+
 VAStatus vaBeginPicture(
     VADisplay dpy,
     VAContextID context,
     VASurfaceID render_target
 )
 {
-    VADriverContextP ctx;
     VAStatus va_status;
 
     CHECK_DISPLAY(dpy);
-    ctx = CTX(dpy);
 
     VA_TRACE_ALL(va_TraceBeginPicture, dpy, context, render_target);
     VA_FOOL_FUNC(va_FoolCheckContinuity, dpy);
 
-    va_status = ctx->vtable->vaBeginPicture(ctx, context, render_target);
+    va_status = va_BeginPicture(dpy, context, render_target);
     VA_TRACE_RET(dpy, va_status);
 
     return va_status;
@@ -1612,18 +1762,97 @@ VAStatus vaEndPicture(
     VAContextID context
 )
 {
-    VAStatus va_status = VA_STATUS_SUCCESS;
+    CHECK_DISPLAY(dpy);
+
+    return va_EndPictureTraced(dpy, context, 1);
+}
+
+VAStatus vaMFSetAggregation(
+    VADisplay dpy,
+    VAMFContextID mf_context,
+    uint32_t flags,
+    uint64_t timeout_ns
+)
+{
+    VAStatus vaStatus;
+
+    CHECK_DISPLAY(dpy);
+
+    if (flags & ~VA_MF_AGGREGATE)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    vaStatus = va_MFEnableAggregation(dpy, mf_context, !!(flags & VA_MF_AGGREGATE), timeout_ns);
+    VA_TRACE_RET(dpy, vaStatus);
+
+    return vaStatus;
+}
+
+VAStatus vaSubmitPictures(
+    VADisplay dpy,
+    VAPictureSubmission *pictures,
+    uint32_t num_pictures
+)
+{
     VADriverContextP ctx;
+    VAStatus va_status = VA_STATUS_SUCCESS;
+    uint32_t i;
 
     CHECK_DISPLAY(dpy);
     ctx = CTX(dpy);
 
-    VA_FOOL_FUNC(va_FoolCheckContinuity, dpy);
-    VA_TRACE_ALL(va_TraceEndPicture, dpy, context, 0);
-    va_status = ctx->vtable->vaEndPicture(ctx, context);
-    VA_TRACE_RET(dpy, va_status);
-    /* dump surface content */
-    VA_TRACE_ALL(va_TraceEndPictureExt, dpy, context, 1);
+    if (num_pictures && !pictures)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    for (i = 0; i < num_pictures; i++) {
+        if (pictures[i].num_buffers && !pictures[i].buffers)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+
+    /* tracing and fool mode want to see every picture, go through the public entry points */
+    if (va_trace_flag || va_fool_codec) {
+        for (i = 0; i < num_pictures; i++) {
+            VAPictureSubmission *p = &pictures[i];
+
+            p->status = vaBeginPicture(dpy, p->context, p->render_target);
+            if (p->status == VA_STATUS_SUCCESS) {
+                if (p->num_buffers)
+                    p->status = vaRenderPicture(dpy, p->context, p->buffers, p->num_buffers);
+                if (p->status == VA_STATUS_SUCCESS)
+                    p->status = va_EndPictureTraced(dpy, p->context, 0);
+                else
+                    va_EndPictureTraced(dpy, p->context, 0);
+            }
+        }
+    } else if (ctx->vtable->vaSubmitPictures) {
+        for (i = 0; i < num_pictures; i++)
+            va_CopyForget(dpy, VACopyObjectSurface, pictures[i].render_target);
+
+        va_status = ctx->vtable->vaSubmitPictures(ctx, pictures, num_pictures);
+    } else {
+        for (i = 0; i < num_pictures; i++) {
+            VAPictureSubmission *p = &pictures[i];
+
+            p->status = va_BeginPicture(dpy, p->context, p->render_target);
+            if (p->status == VA_STATUS_SUCCESS) {
+                if (p->num_buffers)
+                    p->status = ctx->vtable->vaRenderPicture(ctx, p->context, p->buffers, p->num_buffers);
+                /* always close the picture so that the context stays usable */
+                if (p->status == VA_STATUS_SUCCESS)
+                    p->status = va_EndPicture(dpy, p->context, 0);
+                else
+                    ctx->vtable->vaEndPicture(ctx, p->context);
+            }
+        }
+    }
+
+    /*
+     * the pictures of an aggregated multi-frame context are all ended before
+     * waiting for its submission, which would otherwise wait for the pictures
+     * that follow in the batch
+     */
+    va_MFEndPictures(dpy, pictures, num_pictures);
+
+    for (i = 0; i < num_pictures && va_status == VA_STATUS_SUCCESS; i++)
+        va_status = pictures[i].status;
 
     return va_status;
 }
@@ -1639,7 +1868,9 @@ VAStatus vaSyncSurface(
     CHECK_DISPLAY(dpy);
     ctx = CTX(dpy);
 
-    va_status = ctx->vtable->vaSyncSurface(ctx, render_target);
+    va_status = va_CopySync(dpy, VACopyObjectSurface, render_target, VA_TIMEOUT_INFINITE, NULL);
+    if (va_status == VA_STATUS_SUCCESS)
+        va_status = ctx->vtable->vaSyncSurface(ctx, render_target);
     VA_TRACE_LOG(va_TraceSyncSurface, dpy, render_target);
     VA_TRACE_RET(dpy, va_status);
 
@@ -1654,14 +1885,19 @@ VAStatus vaSyncSurface2(
 {
     VAStatus va_status;
     VADriverContextP ctx;
+    int copied;
 
     CHECK_DISPLAY(dpy);
     ctx = CTX(dpy);
 
-    if (ctx->vtable->vaSyncSurface2)
-        va_status = ctx->vtable->vaSyncSurface2(ctx, surface, timeout_ns);
-    else
-        va_status = VA_STATUS_ERROR_UNIMPLEMENTED;
+    /* pending software copies are waited for by libva */
+    va_status = va_CopySync(dpy, VACopyObjectSurface, surface, timeout_ns, &copied);
+    if (va_status == VA_STATUS_SUCCESS) {
+        if (ctx->vtable->vaSyncSurface2)
+            va_status = ctx->vtable->vaSyncSurface2(ctx, surface, timeout_ns);
+        else if (!copied)
+            va_status = VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
     VA_TRACE_LOG(va_TraceSyncSurface2, dpy, surface, timeout_ns);
     VA_TRACE_RET(dpy, va_status);
 
@@ -1680,6 +1916,9 @@ VAStatus vaQuerySurfaceStatus(
     ctx = CTX(dpy);
 
     va_status = ctx->vtable->vaQuerySurfaceStatus(ctx, render_target, status);
+    if (va_status == VA_STATUS_SUCCESS && status &&
+        va_CopyIsPending(dpy, VACopyObjectSurface, render_target))
+        *status = VASurfaceRendering;
 
     VA_TRACE_LOG(va_TraceQuerySurfaceStatus, dpy, render_target, status);
     VA_TRACE_RET(dpy, va_status);
@@ -1715,16 +1954,112 @@ VAStatus vaSyncBuffer(
 {
     VAStatus va_status;
     VADriverContextP ctx;
+    int copied;
 
     CHECK_DISPLAY(dpy);
     ctx = CTX(dpy);
 
     VA_TRACE_LOG(va_TraceSyncBuffer, dpy, buf_id, timeout_ns);
 
-    if (ctx->vtable->vaSyncBuffer)
-        va_status = ctx->vtable->vaSyncBuffer(ctx, buf_id, timeout_ns);
+    /* pending software copies are waited for by libva */
+    va_status = va_CopySync(dpy, VACopyObjectBuffer, buf_id, timeout_ns, &copied);
+    if (va_status == VA_STATUS_SUCCESS) {
+        if (ctx->vtable->vaSyncBuffer)
+            va_status = ctx->vtable->vaSyncBuffer(ctx, buf_id, timeout_ns);
+        else if (!copied)
+            va_status = VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
+    VA_TRACE_RET(dpy, va_status);
+
+    return va_status;
+}
+
+VAStatus vaSyncObjects(
+    VADisplay dpy,
+    VASyncObject *objects,
+    uint32_t num_objects,
+    uint32_t flags,
+    uint64_t timeout_ns,
+    uint32_t *num_completed
+)
+{
+    VAStatus va_status;
+    VADriverContextP ctx;
+
+    CHECK_DISPLAY(dpy);
+    ctx = CTX(dpy);
+
+    if (num_completed)
+        *num_completed = 0;
+    if (!objects && num_objects)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (flags & ~VA_SYNC_WAIT_ANY)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    /* the driver cannot see the software copies, libva waits for those itself */
+    if (ctx->vtable->vaSyncObjects && !va_SyncCopyPending(dpy, objects, num_objects))
+        va_status = ctx->vtable->vaSyncObjects(ctx, objects, num_objects, flags,
+                                               timeout_ns, num_completed);
     else
-        va_status = VA_STATUS_ERROR_UNIMPLEMENTED;
+        va_status = va_SyncObjects(dpy, objects, num_objects, flags,
+                                   timeout_ns, num_completed);
+    VA_TRACE_RET(dpy, va_status);
+
+    return va_status;
+}
+
+VAStatus vaGetCompletionFd(
+    VADisplay dpy,
+    VASyncObjectType obj_type,
+    VAGenericID id,
+    uint32_t flags,
+    int *fd
+)
+{
+    VAStatus va_status = VA_STATUS_ERROR_UNIMPLEMENTED;
+    VADriverContextP ctx;
+
+    CHECK_DISPLAY(dpy);
+    ctx = CTX(dpy);
+
+    if (!fd)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    *fd = -1;
+    if (flags)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (obj_type != VASyncObjectSurface && obj_type != VASyncObjectBuffer)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    /* the driver fence does not cover the software copies */
+    if (ctx->vtable->vaGetCompletionFd && !va_fool_codec &&
+        !va_CopyIsPending(dpy, obj_type == VASyncObjectSurface ?
+                          VACopyObjectSurface : VACopyObjectBuffer, id))
+        va_status = ctx->vtable->vaGetCompletionFd(ctx, obj_type, id, flags, fd);
+    if (va_status == VA_STATUS_ERROR_UNIMPLEMENTED)
+        va_status = va_SyncGetCompletionFd(dpy, obj_type, id, fd);
+    VA_TRACE_RET(dpy, va_status);
+
+    return va_status;
+}
+
+VAStatus vaRegisterCompletionCallback(
+    VADisplay dpy,
+    VASyncObjectType obj_type,
+    VAGenericID id,
+    VACompletionCallback callback,
+    void *user_data
+)
+{
+    VAStatus va_status;
+
+    CHECK_DISPLAY(dpy);
+
+    if (!callback)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (obj_type != VASyncObjectSurface && obj_type != VASyncObjectBuffer)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    va_status = va_SyncRegisterCallback(dpy, obj_type, id, callback, user_data);
     VA_TRACE_RET(dpy, va_status);
 
     return va_status;
@@ -2308,7 +2643,7 @@ vaCopy(
     ctx = CTX(dpy);
 
     if (ctx->vtable->vaCopy  == NULL)
-        va_status = VA_STATUS_ERROR_UNIMPLEMENTED;
+        va_status = va_CopySoftware(dpy, dst, src, option);
     else
         va_status = ctx->vtable->vaCopy(ctx, dst, src, option);
     return va_status;
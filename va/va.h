@@ -1628,6 +1628,13 @@ typedef enum {
      * when importing an existing buffer.
      */
     VASurfaceAttribDRMFormatModifiers,
+    /** \brief Alignment of the surface width and height (int, read-only).
+     *
+     * The value is a VASurfaceAttribAlignmentStruct. Drivers return it from
+     * vaQuerySurfaceAttributes() when the surfaces they create, or the
+     * memory imported as surfaces, need their dimensions padded.
+     */
+    VASurfaceAttribAlignmentSize,
     /** \brief Number of surface attributes. */
     VASurfaceAttribCount
 } VASurfaceAttribType;
@@ -1642,6 +1649,18 @@ typedef struct _VASurfaceAttrib {
     VAGenericValue      value;
 } VASurfaceAttrib;
 
+/** \brief Value of the VASurfaceAttribAlignmentSize attribute. */
+typedef union _VASurfaceAttribAlignmentStruct {
+    struct {
+        /** \brief log2 of the alignment of the width in pixels. */
+        uint32_t log2_x_alignment : 4;
+        /** \brief log2 of the alignment of the height in pixels. */
+        uint32_t log2_y_alignment : 4;
+        uint32_t reserved : 24;
+    } bits;
+    uint32_t value;
+} VASurfaceAttribAlignmentStruct;
+
 /**
  * @name VASurfaceAttribMemoryType values in bit fields.
  * Bit 0:7 are reserved for generic types, Bit 31:28 are reserved for
@@ -3700,6 +3719,58 @@ VAStatus vaCreateBuffer2(
     VABufferID *buf_id
 );
 
+/**
+ * \brief Called once the memory passed to vaCreateBufferFromMemory() is
+ * not referenced anymore.
+ *
+ * @param[in] dpy       the VA display
+ * @param[in] buf_id    the buffer created over the memory
+ * @param[in] data      the memory
+ * @param[in] user_data the pointer passed to vaCreateBufferFromMemory()
+ */
+typedef void (*VABufferReleaseCallback)(
+    VADisplay dpy,
+    VABufferID buf_id,
+    void *data,
+    void *user_data
+);
+
+/**
+ * \brief Creates a buffer over application memory, without copying it.
+ *
+ * Typically used for VASliceDataBufferType with high bitrate streams,
+ * where copying the bitstream into the buffer is measurable. Drivers able
+ * to read the memory directly reference it until they are done with the
+ * buffer, usually once the picture using it completed and the buffer is
+ * destroyed, and then invoke \c release. The memory must stay valid and
+ * unmodified until then; page aligned, locked memory gives the drivers
+ * the most latitude.
+ *
+ * Otherwise libva copies the data into a pooled buffer (see
+ * vaCreatePooledBuffer()) and invokes \c release before returning.
+ * vaDestroyBuffer() then returns the buffer to the pool for the next call,
+ * so the fallback does not allocate in steady state either.
+ *
+ * @param[in] dpy           the VA display
+ * @param[in] context       the context the buffer is used with
+ * @param[in] type          the buffer type
+ * @param[in] size          size of \c data in bytes
+ * @param[in] data          the memory
+ * @param[in] release       called once the memory is released, may be NULL
+ * @param[in] user_data     passed to \c release
+ * @param[out] buf_id       the buffer, destroyed with vaDestroyBuffer()
+ */
+VAStatus vaCreateBufferFromMemory(
+    VADisplay dpy,
+    VAContextID context,
+    VABufferType type,
+    unsigned int size,
+    void *data,
+    VABufferReleaseCallback release,
+    void *user_data,
+    VABufferID *buf_id
+);
+
 /**
  * Convey to the server how many valid elements are in the buffer.
  * e.g. if multiple slice parameters are being held in a single buffer,
@@ -4047,6 +4118,50 @@ VAStatus vaEndPicture(
     VAContextID context
 );
 
+/** \brief One picture of a vaSubmitPictures() batch. */
+typedef struct _VAPictureSubmission {
+    /** \brief Context the picture is submitted to. */
+    VAContextID context;
+    /** \brief Target surface, as for vaBeginPicture(). */
+    VASurfaceID render_target;
+    /** \brief Buffers of the picture, as for vaRenderPicture(). */
+    VABufferID *buffers;
+    /** \brief Number of elements in \c buffers. */
+    uint32_t num_buffers;
+    /** \brief Result of the submission of this picture, set by vaSubmitPictures(). */
+    VAStatus status;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VAPictureSubmission;
+
+/**
+ * \brief Submits several pictures in one call.
+ *
+ * Equivalent to a vaBeginPicture(), vaRenderPicture(), vaEndPicture()
+ * sequence for each element of \c pictures, in order. The pictures may
+ * target different contexts, for instance one per stream when decoding
+ * many small streams, which saves most of the per call overhead. Drivers
+ * may submit the whole batch to the hardware at once; otherwise libva
+ * runs the sequence for each picture.
+ *
+ * A failing picture does not prevent the submission of the following
+ * ones. The status of each picture is returned in its \c status field.
+ * A picture with \c num_buffers but no \c buffers array fails the whole
+ * call with VA_STATUS_ERROR_INVALID_PARAMETER before anything is submitted.
+ *
+ * @param[in] dpy               the VA display
+ * @param[in,out] pictures      array of pictures to submit
+ * @param[in] num_pictures      number of elements in \c pictures
+ * @return VA_STATUS_SUCCESS if all pictures were submitted, the status of
+ *         the first failing picture otherwise
+ */
+VAStatus vaSubmitPictures(
+    VADisplay dpy,
+    VAPictureSubmission *pictures,
+    uint32_t num_pictures
+);
+
 /**
  * Make the end of rendering for a pictures in contexts passed with submission.
  * The server should start processing all pending operations for contexts.
@@ -4073,6 +4188,41 @@ VAStatus vaMFSubmit(
     int num_contexts
 );
 
+/** \brief vaMFSetAggregation() flag enabling the aggregation. */
+#define VA_MF_AGGREGATE             0x00000001
+
+/**
+ * \brief Lets libva batch the pictures of a multi-frame context.
+ *
+ * With VA_MF_AGGREGATE set, vaEndPicture() on a context associated with
+ * \c mf_context through vaMFAddContext() blocks until every associated
+ * context ended a picture, or until \c timeout_ns elapsed since the first
+ * of them did. The pictures ready at that point are then submitted with
+ * a single vaMFSubmit(), whose status each of the vaEndPicture() calls
+ * returns. This lets applications keep one thread per stream, e.g. per
+ * rendition of an ABR ladder, and still get multi-frame submissions.
+ *
+ * A thread ending the next picture of a context whose previous one is
+ * still waiting blocks until that batch is submitted. vaSubmitPictures()
+ * ends all the pictures of its batch before waiting, so one call may hold
+ * the pictures of several contexts of the group. Clearing the flag
+ * submits the batch being formed and restores the default behaviour,
+ * where the application calls vaMFSubmit() itself.
+ *
+ * @param[in] dpy           the VA display
+ * @param[in] mf_context    the multi-frame context
+ * @param[in] flags         VA_MF_AGGREGATE or 0
+ * @param[in] timeout_ns    how long the first ready context waits for the
+ *                          others, VA_TIMEOUT_INFINITE to always wait
+ *                          for all of them
+ */
+VAStatus vaMFSetAggregation(
+    VADisplay dpy,
+    VAMFContextID mf_context,
+    uint32_t flags,
+    uint64_t timeout_ns
+);
+
 /*
 
 Synchronization
@@ -4208,8 +4358,165 @@ VAStatus vaSyncBuffer(
  * vaSyncBuffer:
  * 1. Allows to synchronize output buffer (e.g. bitstream from encoding).
  *    Comparing to vaSyncSurface this function synchronizes given bitstream only.
+ *
+ * vaSyncObjects:
+ * 1. Waits for any or all of a set of surfaces and buffers with one timeout.
  */
 
+/** \brief Type of the objects waited for by vaSyncObjects(). */
+typedef enum {
+    VASyncObjectSurface = 0,
+    VASyncObjectBuffer  = 1,
+} VASyncObjectType;
+
+/** \brief A surface or buffer waited for by vaSyncObjects(). */
+typedef struct _VASyncObject {
+    /** \brief Type of the object. */
+    VASyncObjectType obj_type;
+    union {
+        VASurfaceID surface_id;
+        VABufferID  buffer_id;
+    } object;
+    /**
+     * \brief Set by vaSyncObjects(): VA_STATUS_SUCCESS if the object
+     * completed, VA_STATUS_ERROR_TIMEDOUT if it is still pending, or the
+     * error returned by the synchronization.
+     */
+    VAStatus status;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VASyncObject;
+
+/** \brief vaSyncObjects() returns once all the objects completed. */
+#define VA_SYNC_WAIT_ALL            0x00000000
+/** \brief vaSyncObjects() returns as soon as one object completed. */
+#define VA_SYNC_WAIT_ANY            0x00000001
+
+/**
+ * \brief Synchronizes a set of surfaces and buffers.
+ *
+ * Blocks up to \c timeout_ns nanoseconds until all (VA_SYNC_WAIT_ALL) or
+ * at least one (VA_SYNC_WAIT_ANY) of \c objects completed, then reports
+ * the state of every object in its \c status field. A zero timeout polls
+ * the objects. An object whose synchronization fails, for instance a
+ * buffer the driver cannot wait for, ends the wait: it is not counted as
+ * completed, and vaSyncObjects() returns its error.
+ *
+ * Drivers able to wait on several fences at once implement this
+ * directly. Otherwise libva waits on the objects one at a time with
+ * vaSyncSurface2()/vaSyncBuffer() and short timeouts, falling back to
+ * vaQuerySurfaceStatus() polling if the driver has no vaSyncSurface2().
+ *
+ * @param[in] dpy               the VA display
+ * @param[in,out] objects       objects to wait for
+ * @param[in] num_objects       number of elements in \c objects
+ * @param[in] flags             VA_SYNC_WAIT_ALL or VA_SYNC_WAIT_ANY
+ * @param[in] timeout_ns        the timeout in nanoseconds
+ * @param[out] num_completed    number of completed objects, may be NULL
+ * @return VA_STATUS_SUCCESS if the wait condition is met, the error of
+ *         the first failed object if any, VA_STATUS_ERROR_TIMEDOUT
+ *         otherwise
+ */
+VAStatus vaSyncObjects(
+    VADisplay dpy,
+    VASyncObject *objects,
+    uint32_t num_objects,
+    uint32_t flags,
+    uint64_t timeout_ns,
+    uint32_t *num_completed
+);
+
+/**
+ * \brief Returns a file descriptor signaling the completion of an object.
+ *
+ * The returned descriptor becomes readable (POLLIN) once the surface or
+ * buffer completed, so that it can be waited for from an event loop
+ * (poll, epoll, ...) instead of a blocking vaSyncSurface2()/vaSyncBuffer()
+ * call. The outcome is then retrieved with vaSyncSurface2()/vaSyncBuffer()
+ * and a zero timeout, which do not block at this point.
+ *
+ * Depending on the driver this is a sync_file exported from the hardware
+ * fence or an eventfd signaled by a libva thread, which waits for all the
+ * objects registered on the display with the driver's vaSyncSurface2()/
+ * vaSyncBuffer(). A sync_file only covers the operations submitted on
+ * the object before this call. The libva thread cannot tell them apart
+ * from later ones: it waits for whatever is pending on the object when
+ * it polls it, so work submitted on the object after this call may delay
+ * the signal. Either way the descriptor is owned by the caller and has
+ * to be closed with close() once no longer needed, it stays valid after
+ * the object is destroyed. Objects which are destroyed or whose display is
+ * terminated before completing signal their descriptor as well. An object
+ * which cannot be waited for, e.g. a buffer on a driver without
+ * vaSyncBuffer(), is rejected with the error of its synchronization.
+ *
+ * @param[in] dpy       the VA display
+ * @param[in] obj_type  VASyncObjectSurface or VASyncObjectBuffer
+ * @param[in] id        the surface or buffer
+ * @param[in] flags     reserved, must be zero
+ * @param[out] fd       the file descriptor
+ */
+VAStatus vaGetCompletionFd(
+    VADisplay dpy,
+    VASyncObjectType obj_type,
+    VAGenericID id,
+    uint32_t flags,
+    int *fd
+);
+
+/**
+ * \brief Completion callback registered with vaRegisterCompletionCallback().
+ *
+ * @param[in] dpy       the VA display
+ * @param[in] obj_type  type of the completed object
+ * @param[in] id        the completed surface or buffer
+ * @param[in] status    what vaSyncSurface2()/vaSyncBuffer() would return
+ *                      for the object, VA_STATUS_ERROR_INVALID_SURFACE or
+ *                      VA_STATUS_ERROR_INVALID_BUFFER if it was destroyed
+ *                      and VA_STATUS_ERROR_OPERATION_FAILED if the display
+ *                      was terminated before it completed
+ * @param[in] user_data the pointer passed at registration
+ */
+typedef void (*VACompletionCallback)(
+    VADisplay dpy,
+    VASyncObjectType obj_type,
+    VAGenericID id,
+    VAStatus status,
+    void *user_data
+);
+
+/**
+ * \brief Invokes a callback once a surface or buffer completed.
+ *
+ * libva waits for the registered objects of the display on a worker
+ * thread and runs the callbacks on another one, in the order the objects
+ * completed. Callbacks may use any VA function except vaTerminate(),
+ * e.g. to map the coded buffer of the completed frame, but should return
+ * quickly since they delay the following ones. The callback is invoked
+ * exactly once, also if the object is destroyed or the display terminated
+ * (vaTerminate() waits for the callbacks) before it completed. As for
+ * vaGetCompletionFd(), objects which cannot be waited for are rejected.
+ *
+ * The wait goes through the driver's vaSyncSurface2()/vaSyncBuffer(),
+ * which cover everything pending on the object when libva polls it: work
+ * submitted on the object after this call may delay the callback. Submit
+ * the next operation on an object once its callback ran, or register
+ * the callback on another object, to be notified of each one.
+ *
+ * @param[in] dpy       the VA display
+ * @param[in] obj_type  VASyncObjectSurface or VASyncObjectBuffer
+ * @param[in] id        the surface or buffer
+ * @param[in] callback  the function to call
+ * @param[in] user_data passed to the callback
+ */
+VAStatus vaRegisterCompletionCallback(
+    VADisplay dpy,
+    VASyncObjectType obj_type,
+    VAGenericID id,
+    VACompletionCallback callback,
+    void *user_data
+);
+
 /**
  * Images and Subpictures
  * VAImage is used to either get the surface data to client memory, or
@@ -5171,6 +5478,14 @@ typedef union _VACopyOption {
  * is requested (VA_COPY_NONBLOCK), then need vaSyncBuffer or vaSyncSurface/vaSyncSurface2
  * to sync the destination object.
  *
+ * If the driver does not implement vaCopy, libva copies the object on the
+ * CPU: surfaces through derived images, split in bands of lines processed
+ * by a pool of worker threads, buffers in linear chunks. Both objects must
+ * be of the same type. Asynchronous copies run on a libva worker thread and
+ * are waited for by vaSyncSurface/vaSyncSurface2/vaSyncBuffer, and before
+ * the objects are destroyed. The size of the pool defaults to the number of
+ * CPUs, capped to 8, and can be set with LIBVA_THREADS.
+ *
  * @param[in] dpy               the VA display
  * @param[in] dst               Destination object to copy to
  * @param[in] src               Source object to copy from
@@ -502,8 +502,80 @@ struct VADriverVTable {
         VACopyObject        *src,           /* in */
         VACopyOption        option          /* in */
     );
+
+    /*
+     * The hooks below were added in VA-API 1.14: libva clears them for
+     * drivers initialized through an older __vaDriverInit_1_N().
+     */
+
+    /**
+     * \brief Submits a batch of pictures, see vaSubmitPictures().
+     *
+     * Optional. The driver sets the status of every picture and returns
+     * the status of the first failing one. When not implemented, libva
+     * calls vaBeginPicture/vaRenderPicture/vaEndPicture for each picture.
+     */
+    VAStatus
+    (*vaSubmitPictures)(
+        VADriverContextP    ctx,            /* in */
+        VAPictureSubmission *pictures,      /* in/out */
+        uint32_t            num_pictures    /* in */
+    );
+
+    /**
+     * \brief Waits for any or all of a set of objects, see vaSyncObjects().
+     *
+     * Optional. When not implemented, libva waits on the objects one at
+     * a time.
+     */
+    VAStatus
+    (*vaSyncObjects)(
+        VADriverContextP    ctx,            /* in */
+        VASyncObject        *objects,       /* in/out */
+        uint32_t            num_objects,    /* in */
+        uint32_t            flags,          /* in */
+        uint64_t            timeout_ns,     /* in */
+        uint32_t            *num_completed  /* out */
+    );
+
+    /**
+     * \brief Exports a sync_file fd signaled on completion of the object,
+     * see vaGetCompletionFd().
+     *
+     * Optional. When not implemented or returning
+     * VA_STATUS_ERROR_UNIMPLEMENTED, libva emulates it with an eventfd.
+     */
+    VAStatus
+    (*vaGetCompletionFd)(
+        VADriverContextP    ctx,            /* in */
+        VASyncObjectType    obj_type,       /* in */
+        VAGenericID         id,             /* in */
+        uint32_t            flags,          /* in */
+        int                 *fd             /* out */
+    );
+
+    /**
+     * \brief Creates a buffer referencing application memory, see
+     * vaCreateBufferFromMemory().
+     *
+     * Optional. The driver calls release(release_data) once it does not
+     * access the memory anymore. When not implemented or failing with
+     * VA_STATUS_ERROR_UNIMPLEMENTED or VA_STATUS_ERROR_UNSUPPORTED_BUFFERTYPE,
+     * libva copies the memory into a regular buffer instead.
+     */
+    VAStatus
+    (*vaCreateBufferFromMemory)(
+        VADriverContextP    ctx,            /* in */
+        VAContextID         context,        /* in */
+        VABufferType        type,           /* in */
+        unsigned int        size,           /* in */
+        void                *data,          /* in */
+        void (*release)(void *release_data),   /* in */
+        void                *release_data,  /* in */
+        VABufferID          *buf_id         /* out */
+    );
     /** \brief Reserved bytes for future use, must be zero */
-    unsigned long reserved[54];
+    unsigned long reserved[50];
 };
 
 struct VADriverContext {
@@ -684,8 +756,16 @@ struct VADisplayContext {
         int  candidate_index
     );
 
+    void *vacopy; /* opaque for VA software copy context */
+    void *vareadback; /* opaque for VA readback context */
+    void *vapool; /* opaque for VA buffer pool context */
+    void *vasync; /* opaque for VA completion fd context */
+    void *vamf; /* opaque for VA multi-frame aggregation context */
+    void *vadmabuf; /* opaque for VA DMA-BUF cache context */
+    void *vahostmem; /* opaque for VA host memory surfaces context */
+
     /** \brief Reserved bytes for future use, must be zero */
-    unsigned long reserved[30];
+    unsigned long reserved[23];
 };
 
 typedef VAStatus(*VADriverInit)(
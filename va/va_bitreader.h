@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * MSB-first bit reader for the bitstream parsers. The reader optionally
+ * drops the emulation prevention bytes of H.264/HEVC NAL units while it
+ * loads bytes, so that headers are parsed in place without unescaping
+ * them first. Reads past the end return zero bits and set \c overrun,
+ * which the parsers check once per header rather than after each field.
+ */
+
+#ifndef VA_BITREADER_H
+#define VA_BITREADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct va_bitreader {
+    const uint8_t *start;
+    const uint8_t *p;
+    const uint8_t *end;
+    /* unread bits, left aligned */
+    uint64_t cache;
+    unsigned int bits;
+    /* emulation prevention: zero bytes loaded in a row, -1 if disabled */
+    int zeros;
+    /* emulation prevention bytes dropped so far */
+    unsigned int epb;
+    int overrun;
+} va_bitreader;
+
+static inline void va_BitReaderInit(va_bitreader *br, const uint8_t *data, size_t size, int escaped)
+{
+    br->start = br->p = data;
+    br->end = data + size;
+    br->cache = 0;
+    br->bits = 0;
+    br->zeros = escaped ? 0 : -1;
+    br->epb = 0;
+    br->overrun = 0;
+}
+
+static inline void va_BitReaderRefill(va_bitreader *br)
+{
+    while (br->bits <= 56 && br->p < br->end) {
+        uint8_t b = *br->p++;
+
+        if (br->zeros >= 0) {
+            if (br->zeros >= 2 && b == 3) {
+                br->zeros = 0;
+                br->epb++;
+                continue;
+            }
+            br->zeros = b ? 0 : br->zeros + 1;
+        }
+        br->cache |= (uint64_t)b << (56 - br->bits);
+        br->bits += 8;
+    }
+}
+
+/* n <= 32 */
+static inline uint32_t va_BitReaderRead(va_bitreader *br, unsigned int n)
+{
+    uint32_t v;
+
+    if (!n)
+        return 0;
+    if (br->bits < n) {
+        va_BitReaderRefill(br);
+        if (br->bits < n) {
+            br->overrun = 1;
+            br->bits = n;
+        }
+    }
+    v = (uint32_t)(br->cache >> (64 - n));
+    br->cache <<= n;
+    br->bits -= n;
+    return v;
+}
+
+static inline uint32_t va_BitReaderReadBit(va_bitreader *br)
+{
+    return va_BitReaderRead(br, 1);
+}
+
+static inline void va_BitReaderSkip(va_bitreader *br, size_t n)
+{
+    while (n > 32) {
+        va_BitReaderRead(br, 32);
+        n -= 32;
+    }
+    va_BitReaderRead(br, (unsigned int)n);
+}
+
+/* ue(v), values above 2^32 - 2 are treated as an overrun */
+static inline uint32_t va_BitReaderReadUE(va_bitreader *br)
+{
+    unsigned int lz;
+
+    va_BitReaderRefill(br);
+    lz = br->cache ? __builtin_clzll(br->cache) : 64;
+    if (lz > 31 || lz >= br->bits) {
+        br->overrun = 1;
+        return 0;
+    }
+    br->cache <<= lz;
+    br->bits -= lz;
+    return va_BitReaderRead(br, lz + 1) - 1;
+}
+
+/* se(v) */
+static inline int32_t va_BitReaderReadSE(va_bitreader *br)
+{
+    uint32_t v = va_BitReaderReadUE(br);
+
+    return (v & 1) ? (int32_t)((v >> 1) + 1) : -(int32_t)(v >> 1);
+}
+
+/* bits read so far, emulation prevention bytes excluded */
+static inline size_t va_BitReaderPosition(const va_bitreader *br)
+{
+    return (size_t)(br->p - br->start - br->epb) * 8 - br->bits;
+}
+
+static inline size_t va_BitReaderBitsLeft(const va_bitreader *br)
+{
+    size_t left = (size_t)(br->end - br->p) * 8 + br->bits;
+
+    return br->overrun ? 0 : left;
+}
+
+static inline int va_BitReaderAligned(const va_bitreader *br)
+{
+    return (br->bits & 7) == 0;
+}
+
+static inline void va_BitReaderAlign(va_bitreader *br)
+{
+    va_BitReaderRead(br, br->bits & 7);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_BITREADER_H */
@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Annex-B start code scanning and NAL unit splitting.
+ *
+ * The kernels look for the three byte pattern 00 00 xx, with xx = 01 for
+ * start codes and 03 for emulation prevention bytes, comparing 16 or 32
+ * positions at once from three overlapping unaligned loads. Streams have
+ * few start codes, so the vector loop runs almost always to completion.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_bitstream.h"
+#include "va_cpu.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NO_NAL UINT64_MAX
+
+struct _VAAnnexBSplitter {
+    uint32_t codec;
+    /* stream position of the next chunk */
+    uint64_t pos;
+    /* zero bytes at the end of the data seen so far */
+    uint64_t tail_zeros;
+    /* current NAL unit: position, header bytes seen so far */
+    uint64_t nal_start;
+    uint8_t header[2];
+    unsigned int header_size;
+};
+
+typedef size_t (*va_find_func)(const uint8_t *p, size_t n, uint8_t last);
+
+/* index of the first 00 00 <last> in p[0..n), n if none */
+static size_t find_c(const uint8_t *p, size_t n, uint8_t last)
+{
+    size_t i = 0;
+
+    while (i + 2 < n) {
+        if (p[i + 2] > last)
+            i += 3;
+        else if (p[i + 2] != last)
+            i += 1 + (p[i + 2] != 0) * 2;
+        else if (p[i] || p[i + 1])
+            i += 3;
+        else
+            return i;
+    }
+    return n;
+}
+
+#if defined(VA_CPU_X86)
+VA_TARGET("sse2")
+static size_t find_sse2(const uint8_t *p, size_t n, uint8_t last)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i l = _mm_set1_epi8(last);
+    size_t i;
+
+    for (i = 0; i + 18 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + i + 1));
+        __m128i c = _mm_loadu_si128((const __m128i *)(p + i + 2));
+        __m128i m = _mm_and_si128(_mm_cmpeq_epi8(_mm_or_si128(a, b), zero),
+                                  _mm_cmpeq_epi8(c, l));
+        int mask = _mm_movemask_epi8(m);
+
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i + find_c(p + i, n - i, last);
+}
+
+VA_TARGET("avx2")
+static size_t find_avx2(const uint8_t *p, size_t n, uint8_t last)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i l = _mm256_set1_epi8(last);
+    size_t i;
+
+    for (i = 0; i + 34 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + i + 1));
+        __m256i c = _mm256_loadu_si256((const __m256i *)(p + i + 2));
+        __m256i m = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_or_si256(a, b), zero),
+                                     _mm256_cmpeq_epi8(c, l));
+        unsigned int mask = _mm256_movemask_epi8(m);
+
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i + find_sse2(p + i, n - i, last);
+}
+#endif
+
+#if defined(VA_CPU_NEON)
+static size_t find_neon(const uint8_t *p, size_t n, uint8_t last)
+{
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t l = vdupq_n_u8(last);
+    size_t i;
+
+    for (i = 0; i + 18 <= n; i += 16) {
+        uint8x16_t a = vld1q_u8(p + i);
+        uint8x16_t b = vld1q_u8(p + i + 1);
+        uint8x16_t c = vld1q_u8(p + i + 2);
+        uint64x2_t m = vreinterpretq_u64_u8(vandq_u8(vceqq_u8(vorrq_u8(a, b), zero),
+                                                     vceqq_u8(c, l)));
+
+        if (vgetq_lane_u64(m, 0) | vgetq_lane_u64(m, 1))
+            return i + find_c(p + i, 18, last);
+    }
+    return i + find_c(p + i, n - i, last);
+}
+#endif
+
+static va_find_func va_GetFindFunc(void)
+{
+    unsigned int cpu = va_CpuFeatures();
+
+#if defined(VA_CPU_X86)
+    if (cpu & VA_CPU_FLAG_AVX2)
+        return find_avx2;
+    if (cpu & VA_CPU_FLAG_SSE2)
+        return find_sse2;
+#elif defined(VA_CPU_NEON)
+    if (cpu & VA_CPU_FLAG_NEON)
+        return find_neon;
+#else
+    (void)cpu;
+#endif
+    return find_c;
+}
+
+const uint8_t *vaFindStartCode(const uint8_t *data, size_t size)
+{
+    size_t i;
+
+    if (!data)
+        return NULL;
+
+    i = va_GetFindFunc()(data, size, 1);
+    return i < size ? data + i : NULL;
+}
+
+VAStatus vaCreateAnnexBSplitter(uint32_t codec, VAAnnexBSplitter *splitter)
+{
+    struct _VAAnnexBSplitter *s;
+
+    if (!splitter)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (codec != VA_BITSTREAM_H264 && codec != VA_BITSTREAM_HEVC)
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+
+    s = calloc(1, sizeof(*s));
+    if (!s)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    s->codec = codec;
+    s->nal_start = NO_NAL;
+
+    *splitter = s;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyAnnexBSplitter(VAAnnexBSplitter splitter)
+{
+    free(splitter);
+    return VA_STATUS_SUCCESS;
+}
+
+/* copies the header bytes of the current NAL unit found in the chunk */
+static void va_SplitterFillHeader(struct _VAAnnexBSplitter *s, const uint8_t *data, size_t size)
+{
+    while (s->nal_start != NO_NAL && s->header_size < sizeof(s->header)) {
+        uint64_t i = s->nal_start + s->header_size - s->pos;
+
+        if (i >= size)
+            break;
+        s->header[s->header_size++] = data[i];
+    }
+}
+
+static void va_SplitterEmit(struct _VAAnnexBSplitter *s, uint64_t end, VANALUnit *unit)
+{
+    uint8_t h0 = s->header[0], h1 = s->header[1];
+
+    memset(unit, 0, sizeof(*unit));
+    unit->offset = s->nal_start;
+    unit->size = (uint32_t)(end - s->nal_start);
+
+    if (s->codec == VA_BITSTREAM_H264) {
+        unit->type = h0 & 0x1f;
+        unit->ref_idc_or_layer_id = (h0 >> 5) & 0x3;
+        /* coded slices, IDR slices and MVC slice extensions */
+        unit->is_slice = (unit->type >= 1 && unit->type <= 5) || unit->type == 20;
+    } else {
+        unit->type = (h0 >> 1) & 0x3f;
+        if (s->header_size > 1) {
+            unit->ref_idc_or_layer_id = ((h0 & 0x1) << 5) | (h1 >> 3);
+            unit->temporal_id = (h1 & 0x7) ? (h1 & 0x7) - 1 : 0;
+        }
+        /* TRAIL_N .. RASL_R and BLA_W_LP .. CRA_NUT, the others are reserved */
+        unit->is_slice = unit->type <= 9 || (unit->type >= 16 && unit->type <= 21);
+    }
+}
+
+VAStatus vaSplitAnnexB(
+    VAAnnexBSplitter splitter,
+    const uint8_t *data,
+    size_t size,
+    uint32_t flags,
+    VANALUnit *units,
+    unsigned int max_units,
+    unsigned int *num_units,
+    size_t *bytes_consumed
+)
+{
+    struct _VAAnnexBSplitter *s = splitter;
+    va_find_func find;
+    unsigned int n = 0;
+    size_t i, next, end = size;
+    int stopped = 0;
+
+    if (!s || (!data && size) || (!units && max_units) || !num_units)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    find = va_GetFindFunc();
+    va_SplitterFillHeader(s, data, size);
+
+    /*
+     * i is the index of the 01 of each start code. The first two may
+     * complete zero bytes of the previous chunks.
+     */
+    if (size && data[0] == 1 && s->tail_zeros >= 2)
+        i = 0;
+    else if (size > 1 && data[0] == 0 && data[1] == 1 && s->tail_zeros >= 1)
+        i = 1;
+    else
+        i = find(data, size, 1) + 2;
+
+    for (next = 0; i < size; i = find(data + next, size - next, 1) + next + 2) {
+        uint64_t zeros_start;
+        size_t z = (i < 2) ? 0 : i - 2;
+
+        /* the zero bytes preceding a start code are trailing_zero_8bits */
+        while (z > 0 && data[z - 1] == 0)
+            z--;
+        if (z == 0)
+            zeros_start = s->pos - s->tail_zeros;
+        else
+            zeros_start = s->pos + z;
+
+        if (s->nal_start != NO_NAL && zeros_start > s->nal_start) {
+            if (n == max_units) {
+                /* resume at the zero bytes, or with the chunk if they started before */
+                end = z;
+                stopped = 1;
+                break;
+            }
+            va_SplitterEmit(s, zeros_start, &units[n++]);
+        }
+
+        s->nal_start = s->pos + i + 1;
+        s->header_size = 0;
+        va_SplitterFillHeader(s, data, size);
+        next = i + 1;
+    }
+
+    if (stopped) {
+        if (end)
+            s->tail_zeros = 0;
+    } else {
+        size_t z = size;
+
+        while (z > 0 && data[z - 1] == 0)
+            z--;
+        s->tail_zeros = (z == 0) ? s->tail_zeros + size : size - z;
+    }
+    s->pos += end;
+
+    if (!stopped && (flags & VA_BITSTREAM_END_OF_STREAM)) {
+        if (s->nal_start != NO_NAL && s->pos - s->tail_zeros > s->nal_start) {
+            if (n == max_units)
+                stopped = 1;
+            else
+                va_SplitterEmit(s, s->pos - s->tail_zeros, &units[n++]);
+        }
+        if (!stopped) {
+            s->nal_start = NO_NAL;
+            s->header_size = 0;
+            s->tail_zeros = 0;
+        }
+    }
+
+    *num_units = n;
+    if (bytes_consumed)
+        *bytes_consumed = end;
+    else if (stopped)
+        return VA_STATUS_ERROR_NOT_ENOUGH_BUFFER;
+
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaSetSliceDataParams(
+    const VANALUnit *units,
+    unsigned int num_units,
+    uint64_t buffer_offset,
+    void *slice_params,
+    size_t param_size,
+    unsigned int max_slices,
+    unsigned int *num_slices
+)
+{
+    uint8_t *p = slice_params;
+    unsigned int i, n = 0;
+
+    if ((!units && num_units) || !slice_params || !num_slices ||
+        param_size < sizeof(VASliceParameterBufferBase))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < num_units; i++) {
+        VASliceParameterBufferBase *base;
+
+        if (!units[i].is_slice)
+            continue;
+        if (units[i].offset < buffer_offset ||
+            units[i].offset - buffer_offset + units[i].size > UINT32_MAX)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        if (n == max_slices)
+            return VA_STATUS_ERROR_NOT_ENOUGH_BUFFER;
+
+        base = (VASliceParameterBufferBase *)(p + n * param_size);
+        base->slice_data_size = units[i].size;
+        base->slice_data_offset = (uint32_t)(units[i].offset - buffer_offset);
+        base->slice_data_flag = VA_SLICE_DATA_FLAG_ALL;
+        n++;
+    }
+
+    *num_slices = n;
+    return VA_STATUS_SUCCESS;
+}
+
+size_t vaUnescapeNALUnit(const uint8_t *src, size_t size, uint8_t *dst)
+{
+    va_find_func find = va_GetFindFunc();
+    size_t i = 0, out = 0;
+
+    if (!src || !dst)
+        return 0;
+
+    /* emulation_prevention_three_byte follows 00 00 and resets the zero count */
+    while (i < size) {
+        size_t j = i + find(src + i, size - i, 3);
+        size_t len = (j < size) ? j + 2 - i : size - i;
+
+        if (dst + out != src + i)
+            memmove(dst + out, src + i, len);
+        out += len;
+        i += len + (j < size);
+    }
+    return out;
+}
+
+uint32_t vaNALUnitBitOffset(const uint8_t *nal, size_t size, uint32_t payload_bit_offset)
+{
+    va_find_func find = va_GetFindFunc();
+    size_t byte = payload_bit_offset / 8, i = 0;
+    uint32_t epb = 0;
+
+    if (!nal)
+        return payload_bit_offset;
+
+    while (i < size) {
+        size_t j = i + find(nal + i, size - i, 3);
+
+        /* payload bytes preceding the 03 at j + 2 */
+        if (j >= size || byte < j + 2 - epb)
+            break;
+        epb++;
+        i = j + 3;
+    }
+    return payload_bit_offset + 8 * epb;
+}
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_bitstream.h
+ * \brief Elementary stream helpers for decode
+ *
+ * Splitting an H.264 or HEVC Annex-B elementary stream into the slice data
+ * that VASliceParameterBufferH264 and VASliceParameterBufferHEVC describe
+ * is needed by every decoder. The helpers in this file find start codes
+ * with SIMD where available, split streamed input into NAL units without
+ * copying it and fill the slice data fields of the VA slice parameters.
+ */
+
+#ifndef _VA_BITSTREAM_H_
+#define _VA_BITSTREAM_H_
+
+#include <stddef.h>
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_bitstream Elementary stream helpers
+ *
+ * @{
+ */
+
+/** \brief H.264 Annex-B stream (1 byte NAL unit header). */
+#define VA_BITSTREAM_H264               1
+/** \brief HEVC Annex-B stream (2 bytes NAL unit header). */
+#define VA_BITSTREAM_HEVC               2
+
+/**
+ * \brief Finds the first start code (0x000001) in a buffer.
+ *
+ * @return a pointer to the first byte of the start code, NULL if none is
+ *         entirely contained in the \c size bytes at \c data
+ */
+const uint8_t *vaFindStartCode(const uint8_t *data, size_t size);
+
+/** \brief A NAL unit found by vaSplitAnnexB(). */
+typedef struct _VANALUnit {
+    /**
+     * \brief Position in the stream of the first byte of the NAL unit
+     * header, i.e. the byte following the start code.
+     *
+     * Positions count the bytes passed to vaSplitAnnexB() since the
+     * splitter was created.
+     */
+    uint64_t offset;
+    /**
+     * \brief Size of the NAL unit in bytes, header included, start code
+     * and trailing zero bytes excluded.
+     */
+    uint32_t size;
+    /** \brief nal_unit_type. */
+    uint8_t type;
+    /** \brief nal_ref_idc for H.264, nuh_layer_id for HEVC. */
+    uint8_t ref_idc_or_layer_id;
+    /** \brief TemporalId for HEVC, 0 for H.264. */
+    uint8_t temporal_id;
+    /** \brief 1 if the NAL unit contains slice data (VCL NAL unit). */
+    uint8_t is_slice;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VANALUnit;
+
+/** \brief Opaque Annex-B splitter state. */
+typedef struct _VAAnnexBSplitter *VAAnnexBSplitter;
+
+/**
+ * \brief Creates a splitter for an Annex-B stream.
+ *
+ * @param[in] codec     VA_BITSTREAM_H264 or VA_BITSTREAM_HEVC
+ */
+VAStatus vaCreateAnnexBSplitter(uint32_t codec, VAAnnexBSplitter *splitter);
+
+/** \brief Destroys a splitter. */
+VAStatus vaDestroyAnnexBSplitter(VAAnnexBSplitter splitter);
+
+/** \brief No more data follows, the last NAL unit ends with this chunk. */
+#define VA_BITSTREAM_END_OF_STREAM      0x00000001
+
+/**
+ * \brief Splits the next chunk of an Annex-B stream into NAL units.
+ *
+ * The stream may be passed in chunks of any size, start codes and NAL
+ * unit headers can straddle chunks. The splitter does not copy the data:
+ * it returns the position and size of each NAL unit in the stream, and
+ * the application keeps the chunks (typically appended to a mapped
+ * VASliceDataBufferType buffer) for as long as it needs them. A NAL unit
+ * is returned once the start code following it has been seen, or with
+ * VA_BITSTREAM_END_OF_STREAM. Data preceding the first start code is
+ * skipped.
+ *
+ * When \c units fills up before the end of the chunk, the splitter stops
+ * there and \c bytes_consumed tells the application where to resume.
+ *
+ * @param[in] flags             0 or VA_BITSTREAM_END_OF_STREAM
+ * @param[out] units            NAL units completed by this chunk
+ * @param[out] num_units        number of entries written to \c units
+ * @param[out] bytes_consumed   bytes of \c data processed, may be NULL if
+ *                              \c max_units is large enough for all units
+ */
+VAStatus vaSplitAnnexB(
+    VAAnnexBSplitter splitter,
+    const uint8_t *data,
+    size_t size,
+    uint32_t flags,
+    VANALUnit *units,               /* out */
+    unsigned int max_units,
+    unsigned int *num_units,        /* out */
+    size_t *bytes_consumed          /* out */
+);
+
+/**
+ * \brief Fills the slice data fields of VA slice parameters.
+ *
+ * Every VASliceParameterBufferXXX starts with the fields of
+ * VASliceParameterBufferBase. For each slice NAL unit of \c units, sets
+ * slice_data_offset relative to the stream position \c buffer_offset at
+ * which the slice data buffer starts, slice_data_size and slice_data_flag
+ * (VA_SLICE_DATA_FLAG_ALL) of the next element of \c slice_params, which
+ * is an array of elements of \c param_size bytes, e.g.
+ * sizeof(VASliceParameterBufferHEVC). Other NAL units are skipped.
+ *
+ * @param[out] num_slices   number of slice parameters filled
+ * @return VA_STATUS_ERROR_INVALID_PARAMETER if a slice is not contained
+ *         in the first 4GB following \c buffer_offset,
+ *         VA_STATUS_ERROR_NOT_ENOUGH_BUFFER if there are more than
+ *         \c max_slices slices
+ */
+VAStatus vaSetSliceDataParams(
+    const VANALUnit *units,
+    unsigned int num_units,
+    uint64_t buffer_offset,
+    void *slice_params,             /* out */
+    size_t param_size,
+    unsigned int max_slices,
+    unsigned int *num_slices        /* out */
+);
+
+/**
+ * \brief Removes the emulation prevention bytes of a NAL unit.
+ *
+ * Copies the NAL unit at \c src to the raw byte sequence payload at
+ * \c dst, which may be \c src itself, dropping each 0x03 byte that
+ * follows two zero bytes.
+ *
+ * @return the size of the payload written to \c dst
+ */
+size_t vaUnescapeNALUnit(const uint8_t *src, size_t size, uint8_t *dst);
+
+/**
+ * \brief Maps a bit position of the payload to the escaped NAL unit.
+ *
+ * Parsers work on the unescaped payload (see vaUnescapeNALUnit()) while
+ * fields such as slice_data_bit_offset count the bits of the NAL unit as
+ * it is in the slice data buffer. Returns the position in the NAL unit at
+ * \c nal of the bit at \c payload_bit_offset of its payload, that is
+ * the payload position plus 8 bits per emulation prevention byte
+ * preceding it.
+ */
+uint32_t vaNALUnitBitOffset(const uint8_t *nal, size_t size, uint32_t payload_bit_offset);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_BITSTREAM_H_ */
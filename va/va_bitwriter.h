@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * MSB-first bit writer for the packed header generators, the counterpart
+ * of va_bitreader.h. Bits are gathered in a 64-bit accumulator and stored
+ * 32 at a time; in escaped mode the bytes go through the emulation
+ * prevention check of H.264/HEVC NAL units as they are stored, so that
+ * headers are written once, directly in their final form. Writes past
+ * the end of the buffer are dropped and set \c overflow, which the
+ * generators check once per header.
+ */
+
+#ifndef VA_BITWRITER_H
+#define VA_BITWRITER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct va_bitwriter {
+    uint8_t *start;
+    uint8_t *p;
+    uint8_t *end;
+    /* pending bits, left aligned */
+    uint64_t cache;
+    unsigned int bits;
+    /* emulation prevention: zero bytes stored in a row, -1 if disabled */
+    int zeros;
+    int overflow;
+} va_bitwriter;
+
+static inline void va_BitWriterInit(va_bitwriter *bw, uint8_t *data, size_t size, int escaped)
+{
+    bw->start = bw->p = data;
+    bw->end = data + size;
+    bw->cache = 0;
+    bw->bits = 0;
+    bw->zeros = escaped ? 0 : -1;
+    bw->overflow = 0;
+}
+
+static inline void va_BitWriterStoreByte(va_bitwriter *bw, uint8_t b)
+{
+    if (bw->zeros >= 0) {
+        if (bw->zeros >= 2 && b <= 3) {
+            if (bw->p == bw->end) {
+                bw->overflow = 1;
+                return;
+            }
+            *bw->p++ = 3;
+            bw->zeros = 0;
+        }
+        bw->zeros = b ? 0 : bw->zeros + 1;
+    }
+    if (bw->p == bw->end) {
+        bw->overflow = 1;
+        return;
+    }
+    *bw->p++ = b;
+}
+
+/* stores the complete bytes of the accumulator */
+static inline void va_BitWriterFlush(va_bitwriter *bw)
+{
+    /* no two zero bytes in a row: nothing to escape, store 4 bytes at once */
+    if (bw->bits >= 32 && bw->zeros <= 0 && bw->end - bw->p >= 4) {
+        uint32_t w = (uint32_t)(bw->cache >> 32);
+
+        if (bw->zeros < 0 || ((w & 0xffff0000) && (w & 0x00ffff00) && (w & 0x0000ffff))) {
+            bw->p[0] = w >> 24;
+            bw->p[1] = w >> 16;
+            bw->p[2] = w >> 8;
+            bw->p[3] = w;
+            bw->p += 4;
+            if (bw->zeros >= 0)
+                bw->zeros = (w & 0xff) ? 0 : 1;
+            bw->cache <<= 32;
+            bw->bits -= 32;
+        }
+    }
+    while (bw->bits >= 8) {
+        va_BitWriterStoreByte(bw, (uint8_t)(bw->cache >> 56));
+        bw->cache <<= 8;
+        bw->bits -= 8;
+    }
+}
+
+/* n <= 32, v < 2^n */
+static inline void va_BitWriterPut(va_bitwriter *bw, unsigned int n, uint32_t v)
+{
+    if (!n)
+        return;
+    if (bw->bits + n > 64)
+        va_BitWriterFlush(bw);
+    bw->cache |= (uint64_t)v << (64 - bw->bits - n);
+    bw->bits += n;
+}
+
+static inline void va_BitWriterPutBit(va_bitwriter *bw, uint32_t v)
+{
+    va_BitWriterPut(bw, 1, v & 1);
+}
+
+/* ue(v), v <= 2^32 - 2 */
+static inline void va_BitWriterPutUE(va_bitwriter *bw, uint32_t v)
+{
+    uint64_t code = (uint64_t)v + 1;
+    unsigned int len = 64 - __builtin_clzll(code);
+
+    /* len - 1 leading zeros, then the len bits of v + 1 */
+    if (len > 16) {
+        va_BitWriterPut(bw, len - 1, 0);
+        va_BitWriterPut(bw, len, (uint32_t)code);
+    } else {
+        va_BitWriterPut(bw, 2 * len - 1, (uint32_t)code);
+    }
+}
+
+/* se(v) */
+static inline void va_BitWriterPutSE(va_bitwriter *bw, int32_t v)
+{
+    va_BitWriterPutUE(bw, v > 0 ? 2 * (uint32_t)v - 1 : -2 * (uint32_t)v);
+}
+
+/* rbsp_trailing_bits(), the accumulator is flushed */
+static inline void va_BitWriterTrailingBits(va_bitwriter *bw)
+{
+    va_BitWriterPut(bw, 1, 1);
+    va_BitWriterPut(bw, (8 - (bw->bits & 7)) & 7, 0);
+    va_BitWriterFlush(bw);
+}
+
+/* writes a 4 bytes start code, the writer must be byte aligned */
+static inline void va_BitWriterStartCode(va_bitwriter *bw)
+{
+    static const uint8_t start_code[4] = { 0, 0, 0, 1 };
+    unsigned int i;
+
+    va_BitWriterFlush(bw);
+    if (bw->end - bw->p < 4) {
+        bw->overflow = 1;
+        return;
+    }
+    for (i = 0; i < 4; i++)
+        *bw->p++ = start_code[i];
+    if (bw->zeros >= 0)
+        bw->zeros = 0;
+}
+
+/* bits written so far, emulation prevention bytes included */
+static inline size_t va_BitWriterPosition(const va_bitwriter *bw)
+{
+    return (size_t)(bw->p - bw->start) * 8 + bw->bits;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_BITWRITER_H */
@@ -0,0 +1,1748 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE 1
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_convert.h"
+#include "va_readback.h"
+#include "va_cpu.h"
+#include "va_thread.h"
+#include "va_copy.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Generic conversions go through an intermediate row of 16-bit samples,
+ * four per pixel (Y, U, V, A or R, G, B, A), MSB aligned so that 8, 10,
+ * 12 and 16-bit formats share the same representation.  Rows are handled
+ * in pairs so that 4:2:0 destinations can average the chroma of both
+ * lines.  The most common conversions bypass this and use the plane level
+ * kernels in va_ConvertFast().
+ */
+
+#define EXPAND8(v)      ((uint16_t)((v) * 257))
+#define EXPAND10(v)     ((uint16_t)(((v) << 6) | ((v) >> 4)))
+#define EXPAND2(v)      ((uint16_t)((v) * 0x5555))
+#define NARROW8(v)      ((uint8_t)((v) >> 8))
+#define NARROW10(v)     ((uint32_t)(v) >> 6)
+#define NARROW2(v)      ((uint32_t)(v) >> 14)
+#define AVG2(a, b)      ((uint16_t)(((a) + (b) + 1) >> 1))
+#define AVG4(a, b, c, d) ((uint16_t)(((a) + (b) + (c) + (d) + 2) >> 2))
+
+typedef void (*va_unpack_func)(const uint8_t *const plane[3], const uint32_t pitch[3],
+                               unsigned int y, unsigned int width, uint16_t *out);
+typedef void (*va_pack_func)(uint8_t *const plane[3], const uint32_t pitch[3],
+                             unsigned int y, unsigned int rows, unsigned int width,
+                             const uint16_t *in0, const uint16_t *in1);
+
+struct va_plane_desc {
+    uint8_t shift_x;    /* horizontal subsampling (log2) */
+    uint8_t shift_y;    /* vertical subsampling (log2) */
+    uint8_t bytes;      /* bytes per (subsampled) sample group */
+};
+
+struct va_format_desc {
+    uint32_t fourcc;
+    uint32_t bits_per_pixel;
+    int is_rgb;
+    unsigned int num_planes;
+    struct va_plane_desc planes[3];
+    va_unpack_func unpack;
+    va_pack_func pack;
+};
+
+static inline uint16_t expand_msb(uint16_t v, uint16_t mask, unsigned int bits)
+{
+    v &= mask;
+    return bits < 16 ? (uint16_t)(v | (v >> bits)) : v;
+}
+
+/* NV12/NV21 and P010/P012/P016 */
+static inline void unpack_semi_planar(const uint8_t *const plane[3], const uint32_t pitch[3],
+                                      unsigned int y, unsigned int width, uint16_t *out,
+                                      int swap, unsigned int bits)
+{
+    unsigned int x;
+
+    if (bits == 8) {
+        const uint8_t *luma = plane[0] + y * pitch[0];
+        const uint8_t *uv = plane[1] + (y >> 1) * pitch[1];
+
+        for (x = 0; x < width; x++, out += 4) {
+            out[0] = EXPAND8(luma[x]);
+            out[1] = EXPAND8(uv[(x & ~1) + swap]);
+            out[2] = EXPAND8(uv[(x & ~1) + !swap]);
+            out[3] = 0xffff;
+        }
+    } else {
+        const uint16_t *luma = (const uint16_t *)(plane[0] + y * pitch[0]);
+        const uint16_t *uv = (const uint16_t *)(plane[1] + (y >> 1) * pitch[1]);
+        uint16_t mask = (uint16_t)(0xffff << (16 - bits));
+
+        for (x = 0; x < width; x++, out += 4) {
+            out[0] = expand_msb(luma[x], mask, bits);
+            out[1] = expand_msb(uv[x & ~1], mask, bits);
+            out[2] = expand_msb(uv[x | 1], mask, bits);
+            out[3] = 0xffff;
+        }
+    }
+}
+
+static inline void pack_semi_planar(uint8_t *const plane[3], const uint32_t pitch[3],
+                                    unsigned int y, unsigned int rows, unsigned int width,
+                                    const uint16_t *in0, const uint16_t *in1,
+                                    int swap, unsigned int bits)
+{
+    const uint16_t *in[2] = { in0, in1 };
+    uint16_t mask = (uint16_t)(0xffff << (16 - bits));
+    unsigned int r, x;
+
+    for (r = 0; r < rows; r++) {
+        const uint16_t *s = in[r];
+
+        if (bits == 8) {
+            uint8_t *luma = plane[0] + (y + r) * pitch[0];
+            for (x = 0; x < width; x++)
+                luma[x] = NARROW8(s[4 * x]);
+        } else {
+            uint16_t *luma = (uint16_t *)(plane[0] + (y + r) * pitch[0]);
+            for (x = 0; x < width; x++)
+                luma[x] = s[4 * x] & mask;
+        }
+    }
+
+    for (x = 0; x < width; x += 2) {
+        unsigned int x1 = (x + 1 < width) ? x + 1 : x;
+        uint16_t u = AVG4(in0[4 * x + 1], in0[4 * x1 + 1], in1[4 * x + 1], in1[4 * x1 + 1]);
+        uint16_t v = AVG4(in0[4 * x + 2], in0[4 * x1 + 2], in1[4 * x + 2], in1[4 * x1 + 2]);
+
+        if (bits == 8) {
+            uint8_t *uv = plane[1] + (y >> 1) * pitch[1];
+            uv[x + swap] = NARROW8(u);
+            uv[x + !swap] = NARROW8(v);
+        } else {
+            uint16_t *uv = (uint16_t *)(plane[1] + (y >> 1) * pitch[1]);
+            uv[x] = u & mask;
+            uv[x + 1] = v & mask;
+        }
+    }
+}
+
+#define SEMI_PLANAR_FUNCS(name, swap, bits)                                       \
+    static void unpack_##name(const uint8_t *const plane[3], const uint32_t pitch[3], \
+                              unsigned int y, unsigned int width, uint16_t *out)  \
+    {                                                                             \
+        unpack_semi_planar(plane, pitch, y, width, out, swap, bits);              \
+    }                                                                             \
+    static void pack_##name(uint8_t *const plane[3], const uint32_t pitch[3],     \
+                            unsigned int y, unsigned int rows, unsigned int width, \
+                            const uint16_t *in0, const uint16_t *in1)             \
+    {                                                                             \
+        pack_semi_planar(plane, pitch, y, rows, width, in0, in1, swap, bits);     \
+    }
+
+SEMI_PLANAR_FUNCS(nv12, 0, 8)
+SEMI_PLANAR_FUNCS(nv21, 1, 8)
+SEMI_PLANAR_FUNCS(p010, 0, 10)
+SEMI_PLANAR_FUNCS(p012, 0, 12)
+SEMI_PLANAR_FUNCS(p016, 0, 16)
+
+/* I420/IYUV (U before V) and YV12 (V before U) */
+static inline void unpack_planar420(const uint8_t *const plane[3], const uint32_t pitch[3],
+                                    unsigned int y, unsigned int width, uint16_t *out,
+                                    unsigned int u_plane, unsigned int v_plane)
+{
+    const uint8_t *luma = plane[0] + y * pitch[0];
+    const uint8_t *u = plane[u_plane] + (y >> 1) * pitch[u_plane];
+    const uint8_t *v = plane[v_plane] + (y >> 1) * pitch[v_plane];
+    unsigned int x;
+
+    for (x = 0; x < width; x++, out += 4) {
+        out[0] = EXPAND8(luma[x]);
+        out[1] = EXPAND8(u[x >> 1]);
+        out[2] = EXPAND8(v[x >> 1]);
+        out[3] = 0xffff;
+    }
+}
+
+static inline void pack_planar420(uint8_t *const plane[3], const uint32_t pitch[3],
+                                  unsigned int y, unsigned int rows, unsigned int width,
+                                  const uint16_t *in0, const uint16_t *in1,
+                                  unsigned int u_plane, unsigned int v_plane)
+{
+    uint8_t *u = plane[u_plane] + (y >> 1) * pitch[u_plane];
+    uint8_t *v = plane[v_plane] + (y >> 1) * pitch[v_plane];
+    unsigned int x;
+
+    for (x = 0; x < width; x++)
+        plane[0][y * pitch[0] + x] = NARROW8(in0[4 * x]);
+    if (rows > 1) {
+        for (x = 0; x < width; x++)
+            plane[0][(y + 1) * pitch[0] + x] = NARROW8(in1[4 * x]);
+    }
+
+    for (x = 0; x < width; x += 2) {
+        unsigned int x1 = (x + 1 < width) ? x + 1 : x;
+        u[x >> 1] = NARROW8(AVG4(in0[4 * x + 1], in0[4 * x1 + 1], in1[4 * x + 1], in1[4 * x1 + 1]));
+        v[x >> 1] = NARROW8(AVG4(in0[4 * x + 2], in0[4 * x1 + 2], in1[4 * x + 2], in1[4 * x1 + 2]));
+    }
+}
+
+#define PLANAR420_FUNCS(name, u_plane, v_plane)                                   \
+    static void unpack_##name(const uint8_t *const plane[3], const uint32_t pitch[3], \
+                              unsigned int y, unsigned int width, uint16_t *out)  \
+    {                                                                             \
+        unpack_planar420(plane, pitch, y, width, out, u_plane, v_plane);          \
+    }                                                                             \
+    static void pack_##name(uint8_t *const plane[3], const uint32_t pitch[3],     \
+                            unsigned int y, unsigned int rows, unsigned int width, \
+                            const uint16_t *in0, const uint16_t *in1)             \
+    {                                                                             \
+        pack_planar420(plane, pitch, y, rows, width, in0, in1, u_plane, v_plane); \
+    }
+
+PLANAR420_FUNCS(i420, 1, 2)
+PLANAR420_FUNCS(yv12, 2, 1)
+
+/*
+ * Packed 4:2:2, described by the position of Y0, U, Y1 and V within each
+ * group of four samples. Samples are either bytes or 16-bit words.
+ */
+static inline void unpack_packed422(const uint8_t *const plane[3], const uint32_t pitch[3],
+                                    unsigned int y, unsigned int width, uint16_t *out,
+                                    int y0, int u, int y1, int v, unsigned int bits)
+{
+    unsigned int x;
+
+    if (bits == 8) {
+        const uint8_t *s = plane[0] + y * pitch[0];
+
+        for (x = 0; x < width; x++, out += 4) {
+            const uint8_t *g = s + 4 * (x >> 1);
+            out[0] = EXPAND8(g[(x & 1) ? y1 : y0]);
+            out[1] = EXPAND8(g[u]);
+            out[2] = EXPAND8(g[v]);
+            out[3] = 0xffff;
+        }
+    } else {
+        const uint16_t *s = (const uint16_t *)(plane[0] + y * pitch[0]);
+        uint16_t mask = (uint16_t)(0xffff << (16 - bits));
+
+        for (x = 0; x < width; x++, out += 4) {
+            const uint16_t *g = s + 4 * (x >> 1);
+            out[0] = expand_msb(g[(x & 1) ? y1 : y0], mask, bits);
+            out[1] = expand_msb(g[u], mask, bits);
+            out[2] = expand_msb(g[v], mask, bits);
+            out[3] = 0xffff;
+        }
+    }
+}
+
+static inline void pack_packed422(uint8_t *const plane[3], const uint32_t pitch[3],
+                                  unsigned int y, unsigned int rows, unsigned int width,
+                                  const uint16_t *in0, const uint16_t *in1,
+                                  int y0, int u, int y1, int v, unsigned int bits)
+{
+    const uint16_t *in[2] = { in0, in1 };
+    uint16_t mask = (uint16_t)(0xffff << (16 - bits));
+    unsigned int r, x;
+
+    for (r = 0; r < rows; r++) {
+        const uint16_t *s = in[r];
+
+        for (x = 0; x < width; x += 2) {
+            unsigned int x1 = (x + 1 < width) ? x + 1 : x;
+            uint16_t c[4];
+
+            c[y0] = s[4 * x];
+            c[y1] = s[4 * x1];
+            c[u] = AVG2(s[4 * x + 1], s[4 * x1 + 1]);
+            c[v] = AVG2(s[4 * x + 2], s[4 * x1 + 2]);
+
+            if (bits == 8) {
+                uint8_t *d = plane[0] + (y + r) * pitch[0] + 2 * x;
+                d[0] = NARROW8(c[0]);
+                d[1] = NARROW8(c[1]);
+                d[2] = NARROW8(c[2]);
+                d[3] = NARROW8(c[3]);
+            } else {
+                uint16_t *d = (uint16_t *)(plane[0] + (y + r) * pitch[0]) + 2 * x;
+                d[0] = c[0] & mask;
+                d[1] = c[1] & mask;
+                d[2] = c[2] & mask;
+                d[3] = c[3] & mask;
+            }
+        }
+    }
+}
+
+#define PACKED422_FUNCS(name, y0, u, y1, v, bits)                                 \
+    static void unpack_##name(const uint8_t *const plane[3], const uint32_t pitch[3], \
+                              unsigned int y, unsigned int width, uint16_t *out)  \
+    {                                                                             \
+        unpack_packed422(plane, pitch, y, width, out, y0, u, y1, v, bits);        \
+    }                                                                             \
+    static void pack_##name(uint8_t *const plane[3], const uint32_t pitch[3],     \
+                            unsigned int y, unsigned int rows, unsigned int width, \
+                            const uint16_t *in0, const uint16_t *in1)             \
+    {                                                                             \
+        pack_packed422(plane, pitch, y, rows, width, in0, in1, y0, u, y1, v, bits); \
+    }
+
+PACKED422_FUNCS(yuy2, 0, 1, 2, 3, 8)
+PACKED422_FUNCS(uyvy, 1, 0, 3, 2, 8)
+PACKED422_FUNCS(y210, 0, 1, 2, 3, 10)
+PACKED422_FUNCS(y216, 0, 1, 2, 3, 16)
+
+/* Y410: A, V, Y, U in bits 31:30, 29:20, 19:10, 9:0 */
+static void unpack_y410(const uint8_t *const plane[3], const uint32_t pitch[3],
+                        unsigned int y, unsigned int width, uint16_t *out)
+{
+    const uint32_t *s = (const uint32_t *)(plane[0] + y * pitch[0]);
+    unsigned int x;
+
+    for (x = 0; x < width; x++, out += 4) {
+        uint32_t p = s[x];
+        out[0] = EXPAND10((p >> 10) & 0x3ff);
+        out[1] = EXPAND10(p & 0x3ff);
+        out[2] = EXPAND10((p >> 20) & 0x3ff);
+        out[3] = EXPAND2(p >> 30);
+    }
+}
+
+static void pack_y410(uint8_t *const plane[3], const uint32_t pitch[3],
+                      unsigned int y, unsigned int rows, unsigned int width,
+                      const uint16_t *in0, const uint16_t *in1)
+{
+    const uint16_t *in[2] = { in0, in1 };
+    unsigned int r, x;
+
+    for (r = 0; r < rows; r++) {
+        uint32_t *d = (uint32_t *)(plane[0] + (y + r) * pitch[0]);
+        const uint16_t *s = in[r];
+
+        for (x = 0; x < width; x++, s += 4)
+            d[x] = (NARROW2(s[3]) << 30) | (NARROW10(s[2]) << 20) |
+                   (NARROW10(s[0]) << 10) | NARROW10(s[1]);
+    }
+}
+
+/*
+ * AYUV is stored as a little-endian 32-bit value with A, Y, U, V from the
+ * most to the least significant byte (i.e. V, U, Y, A in memory), which is
+ * the layout used by the drivers and by DRM_FORMAT_AYUV.
+ */
+static void unpack_ayuv(const uint8_t *const plane[3], const uint32_t pitch[3],
+                        unsigned int y, unsigned int width, uint16_t *out)
+{
+    const uint8_t *s = plane[0] + y * pitch[0];
+    unsigned int x;
+
+    for (x = 0; x < width; x++, s += 4, out += 4) {
+        out[0] = EXPAND8(s[2]);
+        out[1] = EXPAND8(s[1]);
+        out[2] = EXPAND8(s[0]);
+        out[3] = EXPAND8(s[3]);
+    }
+}
+
+static void pack_ayuv(uint8_t *const plane[3], const uint32_t pitch[3],
+                      unsigned int y, unsigned int rows, unsigned int width,
+                      const uint16_t *in0, const uint16_t *in1)
+{
+    const uint16_t *in[2] = { in0, in1 };
+    unsigned int r, x;
+
+    for (r = 0; r < rows; r++) {
+        uint8_t *d = plane[0] + (y + r) * pitch[0];
+        const uint16_t *s = in[r];
+
+        for (x = 0; x < width; x++, d += 4, s += 4) {
+            d[0] = NARROW8(s[2]);
+            d[1] = NARROW8(s[1]);
+            d[2] = NARROW8(s[0]);
+            d[3] = NARROW8(s[3]);
+        }
+    }
+}
+
+/* 32-bit RGB, described by the byte position of R, G, B and A (-1: none) */
+static inline void unpack_rgb32(const uint8_t *const plane[3], const uint32_t pitch[3],
+                                unsigned int y, unsigned int width, uint16_t *out,
+                                int r, int g, int b, int a)
+{
+    const uint8_t *s = plane[0] + y * pitch[0];
+    unsigned int x;
+
+    for (x = 0; x < width; x++, s += 4, out += 4) {
+        out[0] = EXPAND8(s[r]);
+        out[1] = EXPAND8(s[g]);
+        out[2] = EXPAND8(s[b]);
+        out[3] = a >= 0 ? EXPAND8(s[a]) : 0xffff;
+    }
+}
+
+static inline void pack_rgb32(uint8_t *const plane[3], const uint32_t pitch[3],
+                              unsigned int y, unsigned int rows, unsigned int width,
+                              const uint16_t *in0, const uint16_t *in1,
+                              int r, int g, int b, int x_pos)
+{
+    const uint16_t *in[2] = { in0, in1 };
+    unsigned int i, x;
+
+    for (i = 0; i < rows; i++) {
+        uint8_t *d = plane[0] + (y + i) * pitch[0];
+        const uint16_t *s = in[i];
+
+        for (x = 0; x < width; x++, d += 4, s += 4) {
+            d[r] = NARROW8(s[0]);
+            d[g] = NARROW8(s[1]);
+            d[b] = NARROW8(s[2]);
+            d[x_pos] = NARROW8(s[3]);
+        }
+    }
+}
+
+/* the X byte of RGBX-like formats is written from the (opaque) alpha sample */
+#define RGB32_FUNCS(name, r, g, b, a, x_pos)                                      \
+    static void unpack_##name(const uint8_t *const plane[3], const uint32_t pitch[3], \
+                              unsigned int y, unsigned int width, uint16_t *out)  \
+    {                                                                             \
+        unpack_rgb32(plane, pitch, y, width, out, r, g, b, a);                    \
+    }                                                                             \
+    static void pack_##name(uint8_t *const plane[3], const uint32_t pitch[3],     \
+                            unsigned int y, unsigned int rows, unsigned int width, \
+                            const uint16_t *in0, const uint16_t *in1)             \
+    {                                                                             \
+        pack_rgb32(plane, pitch, y, rows, width, in0, in1, r, g, b, x_pos);       \
+    }
+
+RGB32_FUNCS(rgba, 0, 1, 2, 3, 3)
+RGB32_FUNCS(rgbx, 0, 1, 2, -1, 3)
+RGB32_FUNCS(bgra, 2, 1, 0, 3, 3)
+RGB32_FUNCS(bgrx, 2, 1, 0, -1, 3)
+RGB32_FUNCS(argb, 1, 2, 3, 0, 0)
+RGB32_FUNCS(xrgb, 1, 2, 3, -1, 0)
+RGB32_FUNCS(abgr, 3, 2, 1, 0, 0)
+RGB32_FUNCS(xbgr, 3, 2, 1, -1, 0)
+
+/* 2:10:10:10 RGB as a little-endian 32-bit value, alpha in bits 31:30 */
+static inline void unpack_rgb10(const uint8_t *const plane[3], const uint32_t pitch[3],
+                                unsigned int y, unsigned int width, uint16_t *out,
+                                int r_shift, int b_shift, int has_alpha)
+{
+    const uint32_t *s = (const uint32_t *)(plane[0] + y * pitch[0]);
+    unsigned int x;
+
+    for (x = 0; x < width; x++, out += 4) {
+        uint32_t p = s[x];
+        out[0] = EXPAND10((p >> r_shift) & 0x3ff);
+        out[1] = EXPAND10((p >> 10) & 0x3ff);
+        out[2] = EXPAND10((p >> b_shift) & 0x3ff);
+        out[3] = has_alpha ? EXPAND2(p >> 30) : 0xffff;
+    }
+}
+
+static inline void pack_rgb10(uint8_t *const plane[3], const uint32_t pitch[3],
+                              unsigned int y, unsigned int rows, unsigned int width,
+                              const uint16_t *in0, const uint16_t *in1,
+                              int r_shift, int b_shift)
+{
+    const uint16_t *in[2] = { in0, in1 };
+    unsigned int i, x;
+
+    for (i = 0; i < rows; i++) {
+        uint32_t *d = (uint32_t *)(plane[0] + (y + i) * pitch[0]);
+        const uint16_t *s = in[i];
+
+        for (x = 0; x < width; x++, s += 4)
+            d[x] = (NARROW2(s[3]) << 30) | (NARROW10(s[0]) << r_shift) |
+                   (NARROW10(s[1]) << 10) | (NARROW10(s[2]) << b_shift);
+    }
+}
+
+#define RGB10_FUNCS(name, r_shift, b_shift, has_alpha)                            \
+    static void unpack_##name(const uint8_t *const plane[3], const uint32_t pitch[3], \
+                              unsigned int y, unsigned int width, uint16_t *out)  \
+    {                                                                             \
+        unpack_rgb10(plane, pitch, y, width, out, r_shift, b_shift, has_alpha);   \
+    }                                                                             \
+    static void pack_##name(uint8_t *const plane[3], const uint32_t pitch[3],     \
+                            unsigned int y, unsigned int rows, unsigned int width, \
+                            const uint16_t *in0, const uint16_t *in1)             \
+    {                                                                             \
+        pack_rgb10(plane, pitch, y, rows, width, in0, in1, r_shift, b_shift);     \
+    }
+
+RGB10_FUNCS(a2r10g10b10, 20, 0, 1)
+RGB10_FUNCS(x2r10g10b10, 20, 0, 0)
+RGB10_FUNCS(a2b10g10r10, 0, 20, 1)
+RGB10_FUNCS(x2b10g10r10, 0, 20, 0)
+
+#define YUV420_PLANES(b0, b1)   { { 0, 0, b0 }, { 1, 1, b1 }, { 1, 1, b1 } }
+#define PACKED_PLANE(b, sx)     { { sx, 0, b }, { 0, 0, 0 }, { 0, 0, 0 } }
+
+static const struct va_format_desc va_convert_formats[] = {
+    { VA_FOURCC_NV12, 12, 0, 2, YUV420_PLANES(1, 2), unpack_nv12, pack_nv12 },
+    { VA_FOURCC_NV21, 12, 0, 2, YUV420_PLANES(1, 2), unpack_nv21, pack_nv21 },
+    { VA_FOURCC_I420, 12, 0, 3, YUV420_PLANES(1, 1), unpack_i420, pack_i420 },
+    { VA_FOURCC_IYUV, 12, 0, 3, YUV420_PLANES(1, 1), unpack_i420, pack_i420 },
+    { VA_FOURCC_YV12, 12, 0, 3, YUV420_PLANES(1, 1), unpack_yv12, pack_yv12 },
+    { VA_FOURCC_P010, 24, 0, 2, YUV420_PLANES(2, 4), unpack_p010, pack_p010 },
+    { VA_FOURCC_P012, 24, 0, 2, YUV420_PLANES(2, 4), unpack_p012, pack_p012 },
+    { VA_FOURCC_P016, 24, 0, 2, YUV420_PLANES(2, 4), unpack_p016, pack_p016 },
+    { VA_FOURCC_YUY2, 16, 0, 1, PACKED_PLANE(4, 1), unpack_yuy2, pack_yuy2 },
+    { VA_FOURCC_UYVY, 16, 0, 1, PACKED_PLANE(4, 1), unpack_uyvy, pack_uyvy },
+    { VA_FOURCC_Y210, 32, 0, 1, PACKED_PLANE(8, 1), unpack_y210, pack_y210 },
+    { VA_FOURCC_Y216, 32, 0, 1, PACKED_PLANE(8, 1), unpack_y216, pack_y216 },
+    { VA_FOURCC_Y410, 32, 0, 1, PACKED_PLANE(4, 0), unpack_y410, pack_y410 },
+    { VA_FOURCC_AYUV, 32, 0, 1, PACKED_PLANE(4, 0), unpack_ayuv, pack_ayuv },
+    { VA_FOURCC_RGBA, 32, 1, 1, PACKED_PLANE(4, 0), unpack_rgba, pack_rgba },
+    { VA_FOURCC_RGBX, 32, 1, 1, PACKED_PLANE(4, 0), unpack_rgbx, pack_rgbx },
+    { VA_FOURCC_BGRA, 32, 1, 1, PACKED_PLANE(4, 0), unpack_bgra, pack_bgra },
+    { VA_FOURCC_BGRX, 32, 1, 1, PACKED_PLANE(4, 0), unpack_bgrx, pack_bgrx },
+    { VA_FOURCC_ARGB, 32, 1, 1, PACKED_PLANE(4, 0), unpack_argb, pack_argb },
+    { VA_FOURCC_XRGB, 32, 1, 1, PACKED_PLANE(4, 0), unpack_xrgb, pack_xrgb },
+    { VA_FOURCC_ABGR, 32, 1, 1, PACKED_PLANE(4, 0), unpack_abgr, pack_abgr },
+    { VA_FOURCC_XBGR, 32, 1, 1, PACKED_PLANE(4, 0), unpack_xbgr, pack_xbgr },
+    { VA_FOURCC_A2R10G10B10, 32, 1, 1, PACKED_PLANE(4, 0), unpack_a2r10g10b10, pack_a2r10g10b10 },
+    { VA_FOURCC_X2R10G10B10, 32, 1, 1, PACKED_PLANE(4, 0), unpack_x2r10g10b10, pack_x2r10g10b10 },
+    { VA_FOURCC_A2B10G10R10, 32, 1, 1, PACKED_PLANE(4, 0), unpack_a2b10g10r10, pack_a2b10g10r10 },
+    { VA_FOURCC_X2B10G10R10, 32, 1, 1, PACKED_PLANE(4, 0), unpack_x2b10g10r10, pack_x2b10g10r10 },
+};
+
+static const struct va_format_desc *va_ConvertFindFormat(uint32_t fourcc)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(va_convert_formats) / sizeof(va_convert_formats[0]); i++) {
+        if (va_convert_formats[i].fourcc == fourcc)
+            return &va_convert_formats[i];
+    }
+    return NULL;
+}
+
+static inline unsigned int va_PlaneRowBytes(const struct va_format_desc *desc,
+        unsigned int plane, unsigned int width)
+{
+    const struct va_plane_desc *p = &desc->planes[plane];
+    return ((width + (1 << p->shift_x) - 1) >> p->shift_x) * p->bytes;
+}
+
+static inline unsigned int va_PlaneRows(const struct va_format_desc *desc,
+                                        unsigned int plane, unsigned int height)
+{
+    const struct va_plane_desc *p = &desc->planes[plane];
+    return (height + (1 << p->shift_y) - 1) >> p->shift_y;
+}
+
+unsigned int va_ConvertPlaneGeometry(uint32_t fourcc, unsigned int width, unsigned int height,
+                                     unsigned int row_bytes[3], unsigned int rows[3])
+{
+    const struct va_format_desc *desc = va_ConvertFindFormat(fourcc);
+    unsigned int i;
+
+    if (!desc)
+        return 0;
+
+    for (i = 0; i < desc->num_planes; i++) {
+        row_bytes[i] = va_PlaneRowBytes(desc, i, width);
+        rows[i] = va_PlaneRows(desc, i, height);
+    }
+    return desc->num_planes;
+}
+
+unsigned int va_ConvertRTFormat(uint32_t fourcc)
+{
+    switch (fourcc) {
+    case VA_FOURCC_P010:
+        return VA_RT_FORMAT_YUV420_10;
+    case VA_FOURCC_P012:
+    case VA_FOURCC_P016:
+        return VA_RT_FORMAT_YUV420_12;
+    case VA_FOURCC_YUY2:
+    case VA_FOURCC_UYVY:
+        return VA_RT_FORMAT_YUV422;
+    case VA_FOURCC_Y210:
+        return VA_RT_FORMAT_YUV422_10;
+    case VA_FOURCC_Y216:
+        return VA_RT_FORMAT_YUV422_12;
+    case VA_FOURCC_AYUV:
+        return VA_RT_FORMAT_YUV444;
+    case VA_FOURCC_Y410:
+        return VA_RT_FORMAT_YUV444_10;
+    case VA_FOURCC_RGBA:
+    case VA_FOURCC_RGBX:
+    case VA_FOURCC_BGRA:
+    case VA_FOURCC_BGRX:
+    case VA_FOURCC_ARGB:
+    case VA_FOURCC_XRGB:
+    case VA_FOURCC_ABGR:
+    case VA_FOURCC_XBGR:
+        return VA_RT_FORMAT_RGB32;
+    case VA_FOURCC_A2R10G10B10:
+    case VA_FOURCC_X2R10G10B10:
+    case VA_FOURCC_A2B10G10R10:
+    case VA_FOURCC_X2B10G10R10:
+        return VA_RT_FORMAT_RGB32_10;
+    default:
+        return VA_RT_FORMAT_YUV420;
+    }
+}
+
+/*
+ * YUV <-> RGB matrices in 4.12 fixed point, applied to the MSB aligned
+ * 16-bit samples: out = M * (in - in_offset) + out_offset
+ */
+#define FIX(x)          ((int32_t)((x) * 4096 + ((x) < 0 ? -0.5 : 0.5)))
+#define Y_OFFSET        (16 * 257)
+#define C_OFFSET        (128 * 257)
+
+struct va_color_matrix {
+    int32_t m[3][3];
+    int32_t in_offset[3];
+    int32_t out_offset[3];
+};
+
+static const struct va_color_matrix va_yuv_to_rgb[4] = {
+    /* BT.601, video range */
+    { { { FIX(1.164), FIX(0.0), FIX(1.596) },
+        { FIX(1.164), FIX(-0.392), FIX(-0.813) },
+        { FIX(1.164), FIX(2.017), FIX(0.0) } },
+      { Y_OFFSET, C_OFFSET, C_OFFSET }, { 0, 0, 0 } },
+    /* BT.709, video range */
+    { { { FIX(1.164), FIX(0.0), FIX(1.793) },
+        { FIX(1.164), FIX(-0.213), FIX(-0.533) },
+        { FIX(1.164), FIX(2.112), FIX(0.0) } },
+      { Y_OFFSET, C_OFFSET, C_OFFSET }, { 0, 0, 0 } },
+    /* BT.601, full range */
+    { { { FIX(1.0), FIX(0.0), FIX(1.402) },
+        { FIX(1.0), FIX(-0.344), FIX(-0.714) },
+        { FIX(1.0), FIX(1.772), FIX(0.0) } },
+      { 0, C_OFFSET, C_OFFSET }, { 0, 0, 0 } },
+    /* BT.709, full range */
+    { { { FIX(1.0), FIX(0.0), FIX(1.5748) },
+        { FIX(1.0), FIX(-0.1873), FIX(-0.4681) },
+        { FIX(1.0), FIX(1.8556), FIX(0.0) } },
+      { 0, C_OFFSET, C_OFFSET }, { 0, 0, 0 } },
+};
+
+static const struct va_color_matrix va_rgb_to_yuv[4] = {
+    /* BT.601, video range */
+    { { { FIX(0.257), FIX(0.504), FIX(0.098) },
+        { FIX(-0.148), FIX(-0.291), FIX(0.439) },
+        { FIX(0.439), FIX(-0.368), FIX(-0.071) } },
+      { 0, 0, 0 }, { Y_OFFSET, C_OFFSET, C_OFFSET } },
+    /* BT.709, video range */
+    { { { FIX(0.183), FIX(0.614), FIX(0.062) },
+        { FIX(-0.101), FIX(-0.339), FIX(0.439) },
+        { FIX(0.439), FIX(-0.399), FIX(-0.040) } },
+      { 0, 0, 0 }, { Y_OFFSET, C_OFFSET, C_OFFSET } },
+    /* BT.601, full range */
+    { { { FIX(0.299), FIX(0.587), FIX(0.114) },
+        { FIX(-0.169), FIX(-0.331), FIX(0.5) },
+        { FIX(0.5), FIX(-0.419), FIX(-0.081) } },
+      { 0, 0, 0 }, { 0, C_OFFSET, C_OFFSET } },
+    /* BT.709, full range */
+    { { { FIX(0.2126), FIX(0.7152), FIX(0.0722) },
+        { FIX(-0.1146), FIX(-0.3854), FIX(0.5) },
+        { FIX(0.5), FIX(-0.4542), FIX(-0.0458) } },
+      { 0, 0, 0 }, { 0, C_OFFSET, C_OFFSET } },
+};
+
+static inline uint16_t clamp16(int32_t v)
+{
+    return v < 0 ? 0 : (v > 0xffff ? 0xffff : (uint16_t)v);
+}
+
+static void va_ConvertColorRow(uint16_t *row, unsigned int width,
+                               const struct va_color_matrix *cm)
+{
+    unsigned int x, i;
+
+    for (x = 0; x < width; x++, row += 4) {
+        int32_t in[3], out[3];
+
+        for (i = 0; i < 3; i++)
+            in[i] = (int32_t)row[i] - cm->in_offset[i];
+        for (i = 0; i < 3; i++)
+            out[i] = ((cm->m[i][0] * in[0] + cm->m[i][1] * in[1] +
+                       cm->m[i][2] * in[2] + 2048) >> 12) + cm->out_offset[i];
+        for (i = 0; i < 3; i++)
+            row[i] = clamp16(out[i]);
+    }
+}
+
+/*
+ * Row kernels used by the fast paths. Each SIMD version handles the bulk
+ * of the row and leaves the tail to the C version.
+ */
+typedef void (*va_deinterleave_func)(const uint8_t *src, uint8_t *u, uint8_t *v, unsigned int n);
+typedef void (*va_interleave_func)(const uint8_t *u, const uint8_t *v, uint8_t *dst, unsigned int n);
+typedef void (*va_narrow_func)(const uint16_t *src, uint8_t *dst, unsigned int n);
+typedef void (*va_swizzle_func)(const uint8_t *src, uint8_t *dst, unsigned int n,
+                                int swap_rb, uint32_t alpha);
+
+static void deinterleave_c(const uint8_t *src, uint8_t *u, uint8_t *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        u[i] = src[2 * i];
+        v[i] = src[2 * i + 1];
+    }
+}
+
+static void interleave_c(const uint8_t *u, const uint8_t *v, uint8_t *dst, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        dst[2 * i] = u[i];
+        dst[2 * i + 1] = v[i];
+    }
+}
+
+static void narrow_c(const uint16_t *src, uint8_t *dst, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i < n; i++)
+        dst[i] = NARROW8(src[i]);
+}
+
+static void swizzle_c(const uint8_t *src, uint8_t *dst, unsigned int n,
+                      int swap_rb, uint32_t alpha)
+{
+    const uint32_t *s = (const uint32_t *)src;
+    uint32_t *d = (uint32_t *)dst;
+    unsigned int i;
+
+    for (i = 0; i < n; i++) {
+        uint32_t p = s[i];
+        if (swap_rb)
+            p = (p & 0xff00ff00) | ((p >> 16) & 0xff) | ((p & 0xff) << 16);
+        d[i] = p | alpha;
+    }
+}
+
+#if defined(VA_CPU_X86)
+VA_TARGET("sse2")
+static void deinterleave_sse2(const uint8_t *src, uint8_t *u, uint8_t *v, unsigned int n)
+{
+    const __m128i mask = _mm_set1_epi16(0x00ff);
+    unsigned int i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(src + 2 * i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(src + 2 * i + 16));
+        _mm_storeu_si128((__m128i *)(u + i),
+                         _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+        _mm_storeu_si128((__m128i *)(v + i),
+                         _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+    deinterleave_c(src + 2 * i, u + i, v + i, n - i);
+}
+
+VA_TARGET("avx2")
+static void deinterleave_avx2(const uint8_t *src, uint8_t *u, uint8_t *v, unsigned int n)
+{
+    const __m256i mask = _mm256_set1_epi16(0x00ff);
+    unsigned int i;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(src + 2 * i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(src + 2 * i + 32));
+        __m256i pu = _mm256_packus_epi16(_mm256_and_si256(a, mask), _mm256_and_si256(b, mask));
+        __m256i pv = _mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8));
+        _mm256_storeu_si256((__m256i *)(u + i), _mm256_permute4x64_epi64(pu, 0xd8));
+        _mm256_storeu_si256((__m256i *)(v + i), _mm256_permute4x64_epi64(pv, 0xd8));
+    }
+    deinterleave_c(src + 2 * i, u + i, v + i, n - i);
+}
+
+VA_TARGET("sse2")
+static void interleave_sse2(const uint8_t *u, const uint8_t *v, uint8_t *dst, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(u + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(v + i));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i), _mm_unpacklo_epi8(a, b));
+        _mm_storeu_si128((__m128i *)(dst + 2 * i + 16), _mm_unpackhi_epi8(a, b));
+    }
+    interleave_c(u + i, v + i, dst + 2 * i, n - i);
+}
+
+VA_TARGET("avx2")
+static void interleave_avx2(const uint8_t *u, const uint8_t *v, uint8_t *dst, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(u + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(v + i));
+        __m256i lo = _mm256_unpacklo_epi8(a, b);
+        __m256i hi = _mm256_unpackhi_epi8(a, b);
+        _mm256_storeu_si256((__m256i *)(dst + 2 * i), _mm256_permute2x128_si256(lo, hi, 0x20));
+        _mm256_storeu_si256((__m256i *)(dst + 2 * i + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+    }
+    interleave_c(u + i, v + i, dst + 2 * i, n - i);
+}
+
+VA_TARGET("sse2")
+static void narrow_sse2(const uint16_t *src, uint8_t *dst, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        __m128i a = _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(src + i)), 8);
+        __m128i b = _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(src + i + 8)), 8);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(a, b));
+    }
+    narrow_c(src + i, dst + i, n - i);
+}
+
+VA_TARGET("avx2")
+static void narrow_avx2(const uint16_t *src, uint8_t *dst, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+        __m256i a = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i *)(src + i)), 8);
+        __m256i b = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i *)(src + i + 16)), 8);
+        _mm256_storeu_si256((__m256i *)(dst + i),
+                            _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8));
+    }
+    narrow_c(src + i, dst + i, n - i);
+}
+
+VA_TARGET("ssse3")
+static void swizzle_ssse3(const uint8_t *src, uint8_t *dst, unsigned int n,
+                          int swap_rb, uint32_t alpha)
+{
+    const __m128i shuf = swap_rb ?
+                         _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15) :
+                         _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i a = _mm_set1_epi32((int)alpha);
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        __m128i p = _mm_loadu_si128((const __m128i *)(src + 4 * i));
+        _mm_storeu_si128((__m128i *)(dst + 4 * i), _mm_or_si128(_mm_shuffle_epi8(p, shuf), a));
+    }
+    swizzle_c(src + 4 * i, dst + 4 * i, n - i, swap_rb, alpha);
+}
+
+VA_TARGET("avx2")
+static void swizzle_avx2(const uint8_t *src, uint8_t *dst, unsigned int n,
+                         int swap_rb, uint32_t alpha)
+{
+    const __m256i shuf = swap_rb ?
+                         _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                          2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15) :
+                         _mm256_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                          0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m256i a = _mm256_set1_epi32((int)alpha);
+    unsigned int i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        __m256i p = _mm256_loadu_si256((const __m256i *)(src + 4 * i));
+        _mm256_storeu_si256((__m256i *)(dst + 4 * i),
+                            _mm256_or_si256(_mm256_shuffle_epi8(p, shuf), a));
+    }
+    swizzle_c(src + 4 * i, dst + 4 * i, n - i, swap_rb, alpha);
+}
+#endif
+
+#if defined(VA_CPU_NEON)
+static void deinterleave_neon(const uint8_t *src, uint8_t *u, uint8_t *v, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        uint8x16x2_t p = vld2q_u8(src + 2 * i);
+        vst1q_u8(u + i, p.val[0]);
+        vst1q_u8(v + i, p.val[1]);
+    }
+    deinterleave_c(src + 2 * i, u + i, v + i, n - i);
+}
+
+static void interleave_neon(const uint8_t *u, const uint8_t *v, uint8_t *dst, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        uint8x16x2_t p;
+        p.val[0] = vld1q_u8(u + i);
+        p.val[1] = vld1q_u8(v + i);
+        vst2q_u8(dst + 2 * i, p);
+    }
+    interleave_c(u + i, v + i, dst + 2 * i, n - i);
+}
+
+static void narrow_neon(const uint16_t *src, uint8_t *dst, unsigned int n)
+{
+    unsigned int i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        uint8x16x2_t p = vld2q_u8((const uint8_t *)(src + i));
+        vst1q_u8(dst + i, p.val[1]);
+    }
+    narrow_c(src + i, dst + i, n - i);
+}
+
+static void swizzle_neon(const uint8_t *src, uint8_t *dst, unsigned int n,
+                         int swap_rb, uint32_t alpha)
+{
+    unsigned int i;
+
+    for (i = 0; i + 16 <= n; i += 16) {
+        uint8x16x4_t p = vld4q_u8(src + 4 * i);
+        if (swap_rb) {
+            uint8x16_t t = p.val[0];
+            p.val[0] = p.val[2];
+            p.val[2] = t;
+        }
+        if (alpha)
+            p.val[3] = vdupq_n_u8(0xff);
+        vst4q_u8(dst + 4 * i, p);
+    }
+    swizzle_c(src + 4 * i, dst + 4 * i, n - i, swap_rb, alpha);
+}
+#endif
+
+static int va_IsPlanar420(uint32_t fourcc)
+{
+    return fourcc == VA_FOURCC_I420 || fourcc == VA_FOURCC_IYUV || fourcc == VA_FOURCC_YV12;
+}
+
+static int va_IsP01x(uint32_t fourcc)
+{
+    return fourcc == VA_FOURCC_P010 || fourcc == VA_FOURCC_P012 || fourcc == VA_FOURCC_P016;
+}
+
+/* RGBA, RGBX, BGRA and BGRX only differ by the position of R/B and alpha */
+static int va_IsRGB32Swizzle(uint32_t fourcc, int *r_first, int *has_alpha)
+{
+    switch (fourcc) {
+    case VA_FOURCC_RGBA:
+        *r_first = 1;
+        *has_alpha = 1;
+        return 1;
+    case VA_FOURCC_RGBX:
+        *r_first = 1;
+        *has_alpha = 0;
+        return 1;
+    case VA_FOURCC_BGRA:
+        *r_first = 0;
+        *has_alpha = 1;
+        return 1;
+    case VA_FOURCC_BGRX:
+        *r_first = 0;
+        *has_alpha = 0;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static void va_CopyPlane(const uint8_t *src, uint32_t src_pitch, uint8_t *dst,
+                         uint32_t dst_pitch, unsigned int row_bytes, unsigned int rows,
+                         int uncached)
+{
+    unsigned int y;
+
+    if (uncached) {
+        vaStreamCopy2D(dst, dst_pitch, src, src_pitch, row_bytes, rows);
+        return;
+    }
+    if (src_pitch == dst_pitch && src_pitch == row_bytes) {
+        memcpy(dst, src, (size_t)row_bytes * rows);
+        return;
+    }
+    for (y = 0; y < rows; y++)
+        memcpy(dst + y * dst_pitch, src + y * src_pitch, row_bytes);
+}
+
+/*
+ * Plane level fast paths.
+ * Returns 1 if the conversion was handled, 0 if the generic path is needed.
+ */
+static int va_ConvertFast(const struct va_format_desc *sd, const uint8_t *const sp[3],
+                          const uint32_t spitch[3], const struct va_format_desc *dd,
+                          uint8_t *const dp[3], const uint32_t dpitch[3],
+                          unsigned int width, unsigned int height, unsigned int cpu,
+                          int uncached)
+{
+    va_deinterleave_func deinterleave = deinterleave_c;
+    va_interleave_func interleave = interleave_c;
+    va_narrow_func narrow = narrow_c;
+    va_swizzle_func swizzle = swizzle_c;
+    unsigned int chroma_w = (width + 1) >> 1, chroma_h = (height + 1) >> 1;
+    unsigned int i, y;
+    int src_r_first, src_alpha, dst_r_first, dst_alpha;
+
+#if defined(VA_CPU_X86)
+    if (cpu & VA_CPU_FLAG_SSE2) {
+        deinterleave = deinterleave_sse2;
+        interleave = interleave_sse2;
+        narrow = narrow_sse2;
+    }
+    if (cpu & VA_CPU_FLAG_SSSE3)
+        swizzle = swizzle_ssse3;
+    if (cpu & VA_CPU_FLAG_AVX2) {
+        deinterleave = deinterleave_avx2;
+        interleave = interleave_avx2;
+        narrow = narrow_avx2;
+        swizzle = swizzle_avx2;
+    }
+#elif defined(VA_CPU_NEON)
+    if (cpu & VA_CPU_FLAG_NEON) {
+        deinterleave = deinterleave_neon;
+        interleave = interleave_neon;
+        narrow = narrow_neon;
+        swizzle = swizzle_neon;
+    }
+#endif
+
+    if (sd->fourcc == dd->fourcc ||
+        (va_IsPlanar420(sd->fourcc) && va_IsPlanar420(dd->fourcc) &&
+         (sd->fourcc == VA_FOURCC_YV12) == (dd->fourcc == VA_FOURCC_YV12))) {
+        for (i = 0; i < sd->num_planes; i++)
+            va_CopyPlane(sp[i], spitch[i], dp[i], dpitch[i],
+                         va_PlaneRowBytes(sd, i, width), va_PlaneRows(sd, i, height), uncached);
+        return 1;
+    }
+
+    /* the remaining kernels read the source directly, stage it instead */
+    if (uncached)
+        return 0;
+
+    if (sd->fourcc == VA_FOURCC_NV12 && va_IsPlanar420(dd->fourcc)) {
+        unsigned int u = dd->fourcc == VA_FOURCC_YV12 ? 2 : 1;
+
+        va_CopyPlane(sp[0], spitch[0], dp[0], dpitch[0], width, height, 0);
+        for (y = 0; y < chroma_h; y++)
+            deinterleave(sp[1] + y * spitch[1], dp[u] + y * dpitch[u],
+                         dp[3 - u] + y * dpitch[3 - u], chroma_w);
+        return 1;
+    }
+
+    if (va_IsPlanar420(sd->fourcc) && dd->fourcc == VA_FOURCC_NV12) {
+        unsigned int u = sd->fourcc == VA_FOURCC_YV12 ? 2 : 1;
+
+        va_CopyPlane(sp[0], spitch[0], dp[0], dpitch[0], width, height, 0);
+        for (y = 0; y < chroma_h; y++)
+            interleave(sp[u] + y * spitch[u], sp[3 - u] + y * spitch[3 - u],
+                       dp[1] + y * dpitch[1], chroma_w);
+        return 1;
+    }
+
+    if (va_IsP01x(sd->fourcc) && dd->fourcc == VA_FOURCC_NV12) {
+        for (y = 0; y < height; y++)
+            narrow((const uint16_t *)(sp[0] + y * spitch[0]), dp[0] + y * dpitch[0], width);
+        for (y = 0; y < chroma_h; y++)
+            narrow((const uint16_t *)(sp[1] + y * spitch[1]), dp[1] + y * dpitch[1], 2 * chroma_w);
+        return 1;
+    }
+
+    if (va_IsRGB32Swizzle(sd->fourcc, &src_r_first, &src_alpha) &&
+        va_IsRGB32Swizzle(dd->fourcc, &dst_r_first, &dst_alpha)) {
+        int swap_rb = src_r_first != dst_r_first;
+        uint32_t alpha = (!src_alpha && dst_alpha) ? 0xff000000 : 0;
+
+        for (y = 0; y < height; y++)
+            swizzle(sp[0] + y * spitch[0], dp[0] + y * dpitch[0], width, swap_rb, alpha);
+        return 1;
+    }
+
+    return 0;
+}
+
+int vaConvertIsSupported(uint32_t src_fourcc, uint32_t dst_fourcc)
+{
+    return va_ConvertFindFormat(src_fourcc) && va_ConvertFindFormat(dst_fourcc);
+}
+
+VAStatus vaInitImageLayout(
+    uint32_t fourcc,
+    unsigned int width,
+    unsigned int height,
+    unsigned int pitch_alignment,
+    VAImage *image      /* out */
+)
+{
+    const struct va_format_desc *desc = va_ConvertFindFormat(fourcc);
+    uint32_t offset = 0;
+    unsigned int i;
+
+    if (!desc)
+        return VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
+    if (!image || width == 0 || height == 0 || width > 0xffff || height > 0xffff ||
+        (pitch_alignment & (pitch_alignment - 1)))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (pitch_alignment == 0)
+        pitch_alignment = 1;
+
+    memset(image, 0, sizeof(*image));
+    image->image_id = VA_INVALID_ID;
+    image->buf = VA_INVALID_ID;
+    image->format.fourcc = fourcc;
+    image->format.byte_order = VA_LSB_FIRST;
+    image->format.bits_per_pixel = desc->bits_per_pixel;
+    image->width = width;
+    image->height = height;
+    image->num_planes = desc->num_planes;
+
+    for (i = 0; i < desc->num_planes; i++) {
+        uint32_t pitch = va_PlaneRowBytes(desc, i, width);
+
+        pitch = (pitch + pitch_alignment - 1) & ~(pitch_alignment - 1);
+        image->pitches[i] = pitch;
+        image->offsets[i] = offset;
+        offset += pitch * va_PlaneRows(desc, i, height);
+    }
+    image->data_size = offset;
+
+    return VA_STATUS_SUCCESS;
+}
+
+/*
+ * Convert the lines [y0, y1) only, y0 must be even so that the band starts
+ * on a chroma line for the vertically subsampled formats. This lets callers
+ * split a conversion into bands handled by different threads.
+ */
+VAStatus va_ConvertImageRows(
+    const VAImage *src_image,
+    const void *src_data,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags,
+    unsigned int y0,
+    unsigned int y1
+)
+{
+    const struct va_format_desc *sd, *dd;
+    const struct va_color_matrix *cm = NULL;
+    const uint8_t *sp[3];
+    uint8_t *dp[3], *stage_plane[3] = { NULL, NULL, NULL };
+    uint32_t stage_pitch[3] = { 0, 0, 0 };
+    uint16_t *rows;
+    unsigned int width, height, i, y;
+    size_t size;
+    int uncached;
+
+    if (!src_image || !dst_image || !src_data || !dst_data)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    sd = va_ConvertFindFormat(src_image->format.fourcc);
+    dd = va_ConvertFindFormat(dst_image->format.fourcc);
+    if (!sd || !dd)
+        return VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
+    if (src_image->num_planes < sd->num_planes || dst_image->num_planes < dd->num_planes)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    width = src_image->width < dst_image->width ? src_image->width : dst_image->width;
+    height = src_image->height < dst_image->height ? src_image->height : dst_image->height;
+    if (y0 & 1)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (y1 > height)
+        y1 = height;
+    if (width == 0 || y0 >= y1)
+        return VA_STATUS_SUCCESS;
+    height = y1 - y0;
+
+    for (i = 0; i < 3; i++) {
+        sp[i] = (const uint8_t *)src_data;
+        if (i < sd->num_planes)
+            sp[i] += src_image->offsets[i] + (size_t)(y0 >> sd->planes[i].shift_y) * src_image->pitches[i];
+        dp[i] = (uint8_t *)dst_data;
+        if (i < dd->num_planes)
+            dp[i] += dst_image->offsets[i] + (size_t)(y0 >> dd->planes[i].shift_y) * dst_image->pitches[i];
+    }
+
+    uncached = !!(flags & VA_CONVERT_FLAG_UNCACHED_SOURCE);
+    if (va_ConvertFast(sd, sp, src_image->pitches, dd, dp, dst_image->pitches, width, height,
+                       (flags & VA_CONVERT_FLAG_NO_SIMD) ? 0 : va_CpuFeatures(), uncached))
+        return VA_STATUS_SUCCESS;
+
+    if (sd->is_rgb != dd->is_rgb) {
+        unsigned int index = (flags & (VA_CONVERT_FLAG_BT709 | VA_CONVERT_FLAG_FULL_RANGE));
+        cm = sd->is_rgb ? &va_rgb_to_yuv[index] : &va_yuv_to_rgb[index];
+    }
+
+    /*
+     * Uncached sources are staged two lines at a time with streaming loads,
+     * the unpackers then address the staged lines as rows 0 and 1.
+     */
+    size = 2 * 4 * sizeof(uint16_t) * width;
+    if (uncached) {
+        for (i = 0; i < sd->num_planes; i++) {
+            stage_pitch[i] = va_PlaneRowBytes(sd, i, width);
+            size += 2 * stage_pitch[i];
+        }
+    }
+
+    rows = malloc(size);
+    if (!rows)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    if (uncached) {
+        uint8_t *stage = (uint8_t *)(rows + 2 * 4 * width);
+
+        for (i = 0; i < sd->num_planes; i++) {
+            stage_plane[i] = stage;
+            stage += 2 * stage_pitch[i];
+        }
+    }
+
+    for (y = 0; y < height; y += 2) {
+        unsigned int n = (height - y) >= 2 ? 2 : 1;
+        uint16_t *row0 = rows, *row1 = n > 1 ? rows + 4 * width : rows;
+
+        if (uncached) {
+            for (i = 0; i < sd->num_planes; i++) {
+                unsigned int shift = sd->planes[i].shift_y;
+                unsigned int first = y >> shift, last = (y + n - 1) >> shift;
+
+                vaStreamCopy2D(stage_plane[i], stage_pitch[i],
+                               sp[i] + first * src_image->pitches[i], src_image->pitches[i],
+                               stage_pitch[i], last - first + 1);
+            }
+            sd->unpack((const uint8_t * const *)stage_plane, stage_pitch, 0, width, row0);
+            if (n > 1)
+                sd->unpack((const uint8_t * const *)stage_plane, stage_pitch, 1, width, row1);
+        } else {
+            sd->unpack(sp, src_image->pitches, y, width, row0);
+            if (n > 1)
+                sd->unpack(sp, src_image->pitches, y + 1, width, row1);
+        }
+        if (cm) {
+            va_ConvertColorRow(row0, width, cm);
+            if (n > 1)
+                va_ConvertColorRow(row1, width, cm);
+        }
+        dd->pack(dp, dst_image->pitches, y, n, width, row0, row1);
+    }
+
+    free(rows);
+    return VA_STATUS_SUCCESS;
+}
+
+/* amount of data handled by one band, sized to stay within the L2 cache */
+#define VA_CONVERT_BAND_SIZE    (256 * 1024)
+
+struct va_convert_band {
+    const VAImage *src_image;
+    const void *src_data;
+    const VAImage *dst_image;
+    void *dst_data;
+    uint32_t flags;
+    unsigned int y0;
+    unsigned int y1;
+    VAStatus status;
+};
+
+static void va_ConvertBand(void *arg)
+{
+    struct va_convert_band *band = arg;
+
+    band->status = va_ConvertImageRows(band->src_image, band->src_data,
+                                       band->dst_image, band->dst_data,
+                                       band->flags, band->y0, band->y1);
+}
+
+/*
+ * Split the image in bands of an even number of lines, all planes
+ * included, and convert them on the worker pool. The bands follow the
+ * pitches/offsets of the images so that each worker touches a contiguous
+ * range of every plane.
+ */
+VAStatus va_ConvertImageParallel(
+    struct va_thread_pool *pool,
+    const VAImage *src_image,
+    const void *src_data,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+)
+{
+    struct va_convert_band *bands;
+    unsigned int i, height, band_rows, num_bands;
+    size_t row_size;
+    VAStatus va_status = VA_STATUS_SUCCESS;
+
+    if (!src_image || !dst_image || !src_data || !dst_data)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    flags &= ~VA_CONVERT_FLAG_MULTITHREADED;
+
+    height = src_image->height < dst_image->height ? src_image->height : dst_image->height;
+    if (!pool || height <= 2)
+        return va_ConvertImageRows(src_image, src_data, dst_image, dst_data, flags, 0, height);
+
+    row_size = src_image->data_size / src_image->height;
+    band_rows = row_size ? VA_CONVERT_BAND_SIZE / row_size : height;
+    band_rows = (band_rows < 2 ? 2 : band_rows) & ~1U;
+    num_bands = (height + band_rows - 1) / band_rows;
+
+    bands = calloc(num_bands, sizeof(*bands));
+    if (!bands)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    for (i = 0; i < num_bands; i++) {
+        bands[i].src_image = src_image;
+        bands[i].src_data = src_data;
+        bands[i].dst_image = dst_image;
+        bands[i].dst_data = dst_data;
+        bands[i].flags = flags;
+        bands[i].y0 = i * band_rows;
+        bands[i].y1 = i == num_bands - 1 ? height : (i + 1) * band_rows;
+    }
+    va_ThreadPoolRun(pool, va_ConvertBand, bands, sizeof(*bands), num_bands);
+
+    for (i = 0; i < num_bands && va_status == VA_STATUS_SUCCESS; i++)
+        va_status = bands[i].status;
+
+    free(bands);
+    return va_status;
+}
+
+VAStatus vaConvertImageData(
+    const VAImage *src_image,
+    const void *src_data,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+)
+{
+    return va_ConvertImageRows(src_image, src_data, dst_image, dst_data, flags, 0, UINT_MAX);
+}
+
+/*
+ * Scaling works on the same 16-bit intermediate rows: source rows are
+ * unpacked once, reduced horizontally into per output pixel sums (box) or
+ * interpolated (bilinear), then combined vertically and packed.
+ */
+typedef void (*va_box_row_func)(const uint16_t *row, const uint32_t *x_start,
+                                const uint32_t *x_end, unsigned int width, uint32_t *acc);
+
+static void box_row_c(const uint16_t *row, const uint32_t *x_start,
+                      const uint32_t *x_end, unsigned int width, uint32_t *acc)
+{
+    unsigned int x, i;
+
+    for (x = 0; x < width; x++, acc += 4) {
+        for (i = x_start[x]; i < x_end[x]; i++) {
+            acc[0] += row[4 * i];
+            acc[1] += row[4 * i + 1];
+            acc[2] += row[4 * i + 2];
+            acc[3] += row[4 * i + 3];
+        }
+    }
+}
+
+#if defined(VA_CPU_X86)
+VA_TARGET("sse2")
+static void box_row_sse2(const uint16_t *row, const uint32_t *x_start,
+                         const uint32_t *x_end, unsigned int width, uint32_t *acc)
+{
+    const __m128i zero = _mm_setzero_si128();
+    unsigned int x, i;
+
+    for (x = 0; x < width; x++, acc += 4) {
+        __m128i sum = _mm_loadu_si128((const __m128i *)acc);
+        __m128i sum2 = zero;
+
+        /* two pixels per iteration, folded at the end */
+        for (i = x_start[x]; i + 2 <= x_end[x]; i += 2) {
+            __m128i p = _mm_loadu_si128((const __m128i *)(row + 4 * i));
+            sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(p, zero));
+            sum2 = _mm_add_epi32(sum2, _mm_unpackhi_epi16(p, zero));
+        }
+        if (i < x_end[x])
+            sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(row + 4 * i)), zero));
+        _mm_storeu_si128((__m128i *)acc, _mm_add_epi32(sum, sum2));
+    }
+}
+#endif
+
+#if defined(VA_CPU_NEON)
+static void box_row_neon(const uint16_t *row, const uint32_t *x_start,
+                         const uint32_t *x_end, unsigned int width, uint32_t *acc)
+{
+    unsigned int x, i;
+
+    for (x = 0; x < width; x++, acc += 4) {
+        uint32x4_t sum = vld1q_u32(acc);
+
+        for (i = x_start[x]; i < x_end[x]; i++)
+            sum = vaddw_u16(sum, vld1_u16(row + 4 * i));
+        vst1q_u32(acc, sum);
+    }
+}
+#endif
+
+static void bilinear_row_c(const uint16_t *row, const uint32_t *x_index,
+                           const uint16_t *x_weight, unsigned int width, uint32_t *out)
+{
+    unsigned int x, i;
+
+    for (x = 0; x < width; x++) {
+        const uint16_t *a = row + 4 * x_index[x];
+        uint32_t w = x_weight[x];
+
+        for (i = 0; i < 4; i++)
+            out[4 * x + i] = (a[i] * (256 - w) + a[4 + i] * w);
+    }
+}
+
+struct va_scale_source {
+    const struct va_format_desc *desc;
+    const uint8_t *plane[3];
+    const uint32_t *pitch;
+    uint8_t *stage[3];
+    uint32_t stage_pitch[3];
+    unsigned int width;
+    int uncached;
+};
+
+static void va_ScaleUnpackRow(const struct va_scale_source *src, unsigned int y, uint16_t *out)
+{
+    const struct va_format_desc *sd = src->desc;
+    unsigned int i;
+
+    if (!src->uncached) {
+        sd->unpack(src->plane, src->pitch, y, src->width, out);
+        return;
+    }
+
+    /* stage the lines of every plane covering y, then unpack them as line 0 */
+    for (i = 0; i < sd->num_planes; i++)
+        vaStreamCopy2D(src->stage[i], src->stage_pitch[i],
+                       src->plane[i] + (size_t)(y >> sd->planes[i].shift_y) * src->pitch[i],
+                       src->pitch[i], src->stage_pitch[i], 1);
+    sd->unpack((const uint8_t * const *)src->stage, src->stage_pitch, 0, src->width, out);
+}
+
+VAStatus vaScaleImageData(
+    const VAImage *src_image,
+    const void *src_data,
+    const VARectangle *src_rect,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+)
+{
+    const struct va_format_desc *sd, *dd;
+    const struct va_color_matrix *cm = NULL;
+    struct va_scale_source src;
+    va_box_row_func box_row = box_row_c;
+    uint8_t *dp[3], *stage;
+    unsigned int rx, ry, rw, rh, x0, dx, width, height, x, y, i;
+    uint32_t *x_start, *x_end, *acc;
+    uint64_t *acc64 = NULL;
+    uint16_t *x_weight, *row, *row_a, *row_b, *out[2];
+    int cached_a = -1, cached_b = -1;
+    size_t size;
+    int bilinear = !!(flags & VA_CONVERT_FLAG_SCALE_BILINEAR);
+    unsigned int cpu = (flags & VA_CONVERT_FLAG_NO_SIMD) ? 0 : va_CpuFeatures();
+
+    if (!src_image || !dst_image || !src_data || !dst_data)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    sd = va_ConvertFindFormat(src_image->format.fourcc);
+    dd = va_ConvertFindFormat(dst_image->format.fourcc);
+    if (!sd || !dd)
+        return VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
+    if (src_image->num_planes < sd->num_planes || dst_image->num_planes < dd->num_planes)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    rx = src_rect ? src_rect->x : 0;
+    ry = src_rect ? src_rect->y : 0;
+    rw = src_rect ? src_rect->width : src_image->width;
+    rh = src_rect ? src_rect->height : src_image->height;
+    if ((src_rect && (src_rect->x < 0 || src_rect->y < 0)) ||
+        rx + rw > src_image->width || ry + rh > src_image->height)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    width = dst_image->width;
+    height = dst_image->height;
+    if (rw == 0 || rh == 0 || width == 0 || height == 0)
+        return VA_STATUS_SUCCESS;
+
+    if (rw == width && rh == height && rx == 0 && ry == 0)
+        return vaConvertImageData(src_image, src_data, dst_image, dst_data, flags);
+
+#if defined(VA_CPU_X86)
+    if (cpu & VA_CPU_FLAG_SSE2)
+        box_row = box_row_sse2;
+#elif defined(VA_CPU_NEON)
+    if (cpu & VA_CPU_FLAG_NEON)
+        box_row = box_row_neon;
+#endif
+
+    if (sd->is_rgb != dd->is_rgb) {
+        unsigned int index = (flags & (VA_CONVERT_FLAG_BT709 | VA_CONVERT_FLAG_FULL_RANGE));
+        cm = sd->is_rgb ? &va_rgb_to_yuv[index] : &va_yuv_to_rgb[index];
+    }
+
+    /* unpack from an even column so that subsampled chroma stays aligned */
+    x0 = rx & ~1U;
+    dx = rx - x0;
+
+    memset(&src, 0, sizeof(src));
+    src.desc = sd;
+    src.pitch = src_image->pitches;
+    src.width = rw + dx;
+    src.uncached = !!(flags & VA_CONVERT_FLAG_UNCACHED_SOURCE);
+    for (i = 0; i < 3; i++) {
+        src.plane[i] = (const uint8_t *)src_data;
+        if (i < sd->num_planes)
+            src.plane[i] += src_image->offsets[i] + (x0 >> sd->planes[i].shift_x) * sd->planes[i].bytes;
+        dp[i] = (uint8_t *)dst_data + (i < dd->num_planes ? dst_image->offsets[i] : 0);
+    }
+
+    /* +1 pixel so that bilinear can always read the right neighbour */
+    /*
+     * The box sums fit in 32 bits up to 65536 source pixels per output
+     * pixel, beyond that every line is reduced separately and summed in
+     * 64 bits.
+     */
+    if (!bilinear && (uint64_t)(rw / width + 1) * (rh / height + 1) > 65536) {
+        acc64 = calloc(4 * width, sizeof(*acc64));
+        if (!acc64)
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    size = 3 * 4 * sizeof(uint16_t) * (src.width + 1) +
+           2 * 4 * sizeof(uint16_t) * width +
+           4 * sizeof(uint32_t) * width +
+           2 * sizeof(uint32_t) * width + sizeof(uint16_t) * width;
+    if (src.uncached) {
+        for (i = 0; i < sd->num_planes; i++) {
+            src.stage_pitch[i] = va_PlaneRowBytes(sd, i, src.width);
+            size += src.stage_pitch[i];
+        }
+    }
+
+    row = malloc(size);
+    if (!row) {
+        free(acc64);
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+    row_a = row + 4 * (src.width + 1);
+    row_b = row_a + 4 * (src.width + 1);
+    out[0] = row_b + 4 * (src.width + 1);
+    out[1] = out[0] + 4 * width;
+    acc = (uint32_t *)(out[1] + 4 * width);
+    x_start = acc + 4 * width;
+    x_end = x_start + width;
+    x_weight = (uint16_t *)(x_end + width);
+    stage = (uint8_t *)(x_weight + width);
+    for (i = 0; i < sd->num_planes; i++) {
+        src.stage[i] = stage;
+        stage += src.stage_pitch[i];
+    }
+
+    for (x = 0; x < width; x++) {
+        if (bilinear) {
+            /* source position of the pixel center in 24.8 fixed point */
+            int64_t pos = (((int64_t)2 * x + 1) * rw * 256) / (2 * width) - 128;
+            pos = pos < 0 ? 0 : pos;
+            x_start[x] = dx + (pos >> 8);
+            x_weight[x] = pos & 0xff;
+            if (x_start[x] >= dx + rw - 1) {
+                x_start[x] = dx + rw - 1;
+                x_weight[x] = 0;
+            }
+        } else {
+            x_start[x] = dx + (uint64_t)x * rw / width;
+            x_end[x] = dx + (uint64_t)(x + 1) * rw / width;
+            if (x_end[x] <= x_start[x])
+                x_end[x] = x_start[x] + 1;
+        }
+    }
+
+    for (y = 0; y < height; y += 2) {
+        unsigned int n = (height - y) >= 2 ? 2 : 1, r;
+
+        for (r = 0; r < n; r++) {
+            uint16_t *o = out[r];
+
+            if (bilinear) {
+                int64_t pos = (((int64_t)2 * (y + r) + 1) * rh * 256) / (2 * height) - 128;
+                unsigned int sy, wy;
+
+                pos = pos < 0 ? 0 : pos;
+                sy = pos >> 8;
+                wy = pos & 0xff;
+                if (sy >= rh - 1) {
+                    sy = rh - 1;
+                    wy = 0;
+                }
+
+                /* keep the last two unpacked lines, consecutive output lines share them */
+                if (cached_a != (int)sy) {
+                    uint16_t *t = row_a;
+
+                    if (cached_b == (int)sy) {
+                        row_a = row_b;
+                        row_b = t;
+                        cached_b = cached_a;
+                    } else {
+                        va_ScaleUnpackRow(&src, ry + sy, row_a);
+                    }
+                    cached_a = sy;
+                }
+                if (wy && cached_b != (int)sy + 1) {
+                    va_ScaleUnpackRow(&src, ry + sy + 1, row_b);
+                    cached_b = sy + 1;
+                }
+
+                /* duplicate the last pixel for the right neighbour */
+                memcpy(row_a + 4 * src.width, row_a + 4 * (src.width - 1), 4 * sizeof(uint16_t));
+                bilinear_row_c(row_a, x_start, x_weight, width, acc);
+                if (wy) {
+                    memcpy(row_b + 4 * src.width, row_b + 4 * (src.width - 1), 4 * sizeof(uint16_t));
+                    for (x = 0; x < width; x++) {
+                        const uint16_t *b = row_b + 4 * x_start[x];
+                        uint32_t w = x_weight[x];
+
+                        for (i = 0; i < 4; i++) {
+                            uint32_t vb = b[i] * (256 - w) + b[4 + i] * w;
+                            o[4 * x + i] = (uint16_t)(((uint64_t)acc[4 * x + i] * (256 - wy) +
+                                                       (uint64_t)vb * wy + 32768) >> 16);
+                        }
+                    }
+                } else {
+                    for (i = 0; i < 4 * width; i++)
+                        o[i] = (uint16_t)((acc[i] + 128) >> 8);
+                }
+            } else {
+                unsigned int sy0 = (uint64_t)(y + r) * rh / height;
+                unsigned int sy1 = (uint64_t)(y + r + 1) * rh / height;
+                unsigned int sy;
+
+                if (sy1 <= sy0)
+                    sy1 = sy0 + 1;
+
+                memset(acc, 0, 4 * sizeof(uint32_t) * width);
+                if (acc64)
+                    memset(acc64, 0, 4 * sizeof(uint64_t) * width);
+                for (sy = sy0; sy < sy1; sy++) {
+                    va_ScaleUnpackRow(&src, ry + sy, row);
+                    box_row(row, x_start, x_end, width, acc);
+                    if (acc64) {
+                        for (i = 0; i < 4 * width; i++)
+                            acc64[i] += acc[i];
+                        memset(acc, 0, 4 * sizeof(uint32_t) * width);
+                    }
+                }
+                for (x = 0; x < width; x++) {
+                    uint64_t count = (uint64_t)(x_end[x] - x_start[x]) * (sy1 - sy0);
+
+                    for (i = 0; i < 4; i++) {
+                        uint64_t sum = acc64 ? acc64[4 * x + i] : acc[4 * x + i];
+                        o[4 * x + i] = (uint16_t)((sum + count / 2) / count);
+                    }
+                }
+            }
+
+            if (cm)
+                va_ConvertColorRow(o, width, cm);
+        }
+        dd->pack(dp, dst_image->pitches, y, n, width, out[0], n > 1 ? out[1] : out[0]);
+    }
+
+    free(acc64);
+    free(row);
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaGetImageData(
+    VADisplay dpy,
+    VAImage *image,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+)
+{
+    VAStatus va_status, unmap_status;
+    void *data = NULL;
+
+    CHECK_DISPLAY(dpy);
+    if (!image)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    va_status = vaMapBuffer(dpy, image->buf, &data);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    flags |= VA_CONVERT_FLAG_UNCACHED_SOURCE;
+    if (flags & VA_CONVERT_FLAG_MULTITHREADED)
+        va_status = va_ConvertImageParallel(va_CopyGetThreadPool(dpy), image, data,
+                                            dst_image, dst_data, flags);
+    else
+        va_status = vaConvertImageData(image, data, dst_image, dst_data, flags);
+
+    unmap_status = vaUnmapBuffer(dpy, image->buf);
+    return va_status != VA_STATUS_SUCCESS ? va_status : unmap_status;
+}
+
+VAStatus vaPutImageData(
+    VADisplay dpy,
+    const VAImage *src_image,
+    const void *src_data,
+    VAImage *image,
+    uint32_t flags
+)
+{
+    VAStatus va_status, unmap_status;
+    void *data = NULL;
+
+    CHECK_DISPLAY(dpy);
+    if (!image)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    va_status = vaMapBuffer(dpy, image->buf, &data);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    if (flags & VA_CONVERT_FLAG_MULTITHREADED)
+        va_status = va_ConvertImageParallel(va_CopyGetThreadPool(dpy), src_image, src_data,
+                                            image, data, flags);
+    else
+        va_status = vaConvertImageData(src_image, src_data, image, data, flags);
+
+    unmap_status = vaUnmapBuffer(dpy, image->buf);
+    return va_status != VA_STATUS_SUCCESS ? va_status : unmap_status;
+}
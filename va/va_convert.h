@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_convert.h
+ * \brief CPU-side image format conversion helpers
+ *
+ * This file contains helpers to convert image data between the fourcc
+ * layouts defined in va.h, e.g. to turn the planes returned by
+ * vaDeriveImage()/vaGetImage() into the layout an application expects
+ * or to prepare user data for vaPutImage().
+ *
+ * Source and destination layouts are both described with a VAImage:
+ * only the format.fourcc, width, height, num_planes, pitches[] and
+ * offsets[] fields are used.  For application memory the layout can be
+ * computed with vaInitImageLayout().
+ *
+ * Supported fourccs: NV12, NV21, I420, IYUV, YV12, YUY2, UYVY, P010,
+ * P012, P016, Y210, Y216, Y410, AYUV, RGBA, RGBX, BGRA, BGRX, ARGB,
+ * XRGB, ABGR, XBGR, A2R10G10B10, X2R10G10B10, A2B10G10R10 and
+ * X2B10G10R10.  Any source can be converted to any destination; YUV to
+ * RGB conversions (and the reverse) use the matrix selected by the
+ * VA_CONVERT_FLAG_xxx flags.
+ *
+ * Common conversions (plain copies, NV12 <-> I420/YV12, P01x -> NV12
+ * and 32-bit RGB swizzles) use AVX2, SSE2/SSSE3 or NEON kernels when the
+ * CPU supports them.
+ */
+
+#ifndef _VA_CONVERT_H_
+#define _VA_CONVERT_H_
+
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_convert Image conversion helpers
+ *
+ * @{
+ */
+
+/** \brief Use the ITU-R BT.601 matrix for YUV <-> RGB conversions (default). */
+#define VA_CONVERT_FLAG_BT601           0x00000000
+/** \brief Use the ITU-R BT.709 matrix for YUV <-> RGB conversions. */
+#define VA_CONVERT_FLAG_BT709           0x00000001
+/** \brief YUV samples use the full range instead of the video range. */
+#define VA_CONVERT_FLAG_FULL_RANGE      0x00000002
+/** \brief Only use the scalar reference code, mainly for debugging. */
+#define VA_CONVERT_FLAG_NO_SIMD         0x00000100
+/**
+ * \brief The source is an uncached/write-combined mapping.
+ *
+ * Source rows are read with streaming loads, see va_readback.h. This is
+ * implied by vaGetImageData().
+ */
+#define VA_CONVERT_FLAG_UNCACHED_SOURCE 0x00000200
+/**
+ * \brief Split the transfer over the libva worker threads of the display.
+ *
+ * The image is cut in bands of lines, all planes included, processed in
+ * parallel. Only honoured by the calls taking a VADisplay: vaGetImageData(),
+ * vaPutImageData(), vaDownloadSurface() and vaUploadSurface(). The number
+ * of threads defaults to the number of CPUs of the NUMA node of the first
+ * caller, capped to 8, and can be set with LIBVA_THREADS.
+ */
+#define VA_CONVERT_FLAG_MULTITHREADED   0x00000400
+/**
+ * \brief Scale with bilinear interpolation instead of the default box filter.
+ *
+ * The box filter averages all the source pixels covered by a destination
+ * pixel and is the better choice for large downscaling ratios. Bilinear is
+ * cheaper and smoother for ratios close to 1 or upscaling.
+ */
+#define VA_CONVERT_FLAG_SCALE_BILINEAR  0x00000800
+/** \brief Always scale on the CPU, do not try video processing first. */
+#define VA_CONVERT_FLAG_SCALE_CPU       0x00001000
+
+/**
+ * \brief Checks whether a conversion between two fourccs is supported.
+ *
+ * @return 1 if vaConvertImageData() can convert from \c src_fourcc to
+ *         \c dst_fourcc, 0 otherwise.
+ */
+int vaConvertIsSupported(uint32_t src_fourcc, uint32_t dst_fourcc);
+
+/**
+ * \brief Computes a packed layout for an image in application memory.
+ *
+ * Fills in format.fourcc, format.bits_per_pixel, width, height,
+ * num_planes, pitches[], offsets[] and data_size of \c image for a
+ * buffer holding \c width x \c height pixels in the given \c fourcc.
+ * Every pitch is aligned to \c pitch_alignment bytes (a power of two,
+ * 0 or 1 meaning no alignment). image_id and buf are set to
+ * VA_INVALID_ID.
+ */
+VAStatus vaInitImageLayout(
+    uint32_t fourcc,
+    unsigned int width,
+    unsigned int height,
+    unsigned int pitch_alignment,
+    VAImage *image      /* out */
+);
+
+/**
+ * \brief Converts image data between two layouts.
+ *
+ * Converts the region common to both images (the minimum of both widths
+ * and heights) from \c src_data laid out as \c src_image into
+ * \c dst_data laid out as \c dst_image.
+ *
+ * @param[in] src_image     layout of the source data
+ * @param[in] src_data      base address of the source data
+ * @param[in] dst_image     layout of the destination data
+ * @param[out] dst_data     base address of the destination data
+ * @param[in] flags         combination of VA_CONVERT_FLAG_xxx
+ * @return VA_STATUS_SUCCESS on success, or
+ *         VA_STATUS_ERROR_INVALID_IMAGE_FORMAT if a fourcc is not supported
+ */
+VAStatus vaConvertImageData(
+    const VAImage *src_image,
+    const void *src_data,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+);
+
+/**
+ * \brief Crops and scales image data on the CPU.
+ *
+ * Scales the \c src_rect region of \c src_data laid out as \c src_image
+ * (the whole image if \c src_rect is NULL) to the full size of
+ * \c dst_image, converting the format on the way. Source lines are
+ * unpacked once, so the cost is proportional to the source region and the
+ * destination is written only once.
+ *
+ * @param[in] src_image     layout of the source data
+ * @param[in] src_data      base address of the source data
+ * @param[in] src_rect      region of the source to scale, or NULL
+ * @param[in] dst_image     layout and size of the destination data
+ * @param[out] dst_data     base address of the destination data
+ * @param[in] flags         combination of VA_CONVERT_FLAG_xxx, notably
+ *                          VA_CONVERT_FLAG_SCALE_BILINEAR
+ */
+VAStatus vaScaleImageData(
+    const VAImage *src_image,
+    const void *src_data,
+    const VARectangle *src_rect,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+);
+
+/**
+ * \brief Downloads a VAImage into application memory in one pass.
+ *
+ * Maps the buffer of \c image (obtained from vaDeriveImage() or filled by
+ * vaGetImage()), converts its content straight into \c dst_data laid out
+ * as \c dst_image and unmaps the buffer again, without any intermediate
+ * copy. The buffer is read with streaming loads
+ * (VA_CONVERT_FLAG_UNCACHED_SOURCE).
+ */
+VAStatus vaGetImageData(
+    VADisplay dpy,
+    VAImage *image,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+);
+
+/**
+ * \brief Uploads application memory into a VAImage in one pass.
+ *
+ * The reverse of vaGetImageData(): converts \c src_data laid out as
+ * \c src_image directly into the mapped buffer of \c image, which can
+ * then be used with vaPutImage() (or is already the surface content if
+ * \c image was obtained from vaDeriveImage()).
+ */
+VAStatus vaPutImageData(
+    VADisplay dpy,
+    const VAImage *src_image,
+    const void *src_data,
+    VAImage *image,
+    uint32_t flags
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_CONVERT_H_ */
@@ -0,0 +1,520 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE 1
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_convert.h"
+#include "va_readback.h"
+#include "va_thread.h"
+#include "va_copy.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VA_COPY_CHUNK_SIZE  (1024 * 1024)
+
+struct va_copy_pending {
+    VACopyObject dst;
+    VACopyObject src;
+    VADisplay dpy;
+    struct va_copy_pending *next;
+};
+
+struct va_copy_context {
+    struct va_thread_pool *pool;        /* band/chunk workers */
+    struct va_thread_pool *async_pool;  /* single worker running the async copies in order */
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct va_copy_pending *pending;
+    unsigned int num_pending;
+    /* completed copies, by destination, until the destination is synced */
+    struct va_copy_pending *done;
+    unsigned int num_done;
+};
+
+struct va_copy_job {
+    const void *src;
+    void *dst;
+    size_t size;
+};
+
+static pthread_mutex_t va_copy_init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define DPY2COPYCTX(dpy) \
+    ((struct va_copy_context *)__atomic_load_n(&((VADisplayContextP)dpy)->vacopy, __ATOMIC_ACQUIRE))
+
+static struct va_copy_context *va_CopyGetContext(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_copy_context *cc = DPY2COPYCTX(dpy);
+
+    if (cc)
+        return cc;
+
+    pthread_mutex_lock(&va_copy_init_lock);
+    cc = pDisplayContext->vacopy;
+    if (!cc) {
+        cc = calloc(1, sizeof(*cc));
+        if (cc) {
+            cc->pool = va_ThreadPoolCreate(0);
+            cc->async_pool = va_ThreadPoolCreate(1);
+            if (!cc->pool || !cc->async_pool) {
+                va_ThreadPoolDestroy(cc->pool);
+                va_ThreadPoolDestroy(cc->async_pool);
+                free(cc);
+                cc = NULL;
+            } else {
+                pthread_mutex_init(&cc->lock, NULL);
+                pthread_cond_init(&cc->cond, NULL);
+                __atomic_store_n(&pDisplayContext->vacopy, cc, __ATOMIC_RELEASE);
+            }
+        }
+    }
+    pthread_mutex_unlock(&va_copy_init_lock);
+
+    if (!cc)
+        va_errorMessage(dpy, "Failed to create the software copy context\n");
+
+    return cc;
+}
+
+struct va_thread_pool *va_CopyGetThreadPool(VADisplay dpy)
+{
+    struct va_copy_context *cc = va_CopyGetContext(dpy);
+
+    return cc ? cc->pool : NULL;
+}
+
+static VAGenericID va_CopyObjectID(const VACopyObject *obj)
+{
+    return obj->obj_type == VACopyObjectSurface ? obj->object.surface_id : obj->object.buffer_id;
+}
+
+static int va_CopyObjectMatch(const VACopyObject *obj, VACopyObjectType obj_type, VAGenericID id)
+{
+    if (obj->obj_type != obj_type)
+        return 0;
+
+    return obj_type == VACopyObjectSurface ? obj->object.surface_id == id : obj->object.buffer_id == id;
+}
+
+/* must be called with cc->lock held */
+static int va_CopyFindPending(struct va_copy_context *cc, VACopyObjectType obj_type, VAGenericID id)
+{
+    struct va_copy_pending *p;
+
+    for (p = cc->pending; p; p = p->next) {
+        if (va_CopyObjectMatch(&p->dst, obj_type, id) || va_CopyObjectMatch(&p->src, obj_type, id))
+            return 1;
+    }
+
+    return 0;
+}
+
+/* must be called with cc->lock held, other threads may have queued jobs after this one */
+static void va_CopyUnlinkPending(struct va_copy_context *cc, struct va_copy_pending *job)
+{
+    struct va_copy_pending **p;
+
+    for (p = &cc->pending; *p; p = &(*p)->next) {
+        if (*p == job) {
+            *p = job->next;
+            break;
+        }
+    }
+    __atomic_store_n(&cc->num_pending, cc->num_pending - 1, __ATOMIC_RELEASE);
+}
+
+/* must be called with cc->lock held, takes ownership of job */
+static void va_CopyRecordDone(struct va_copy_context *cc, struct va_copy_pending *job)
+{
+    struct va_copy_pending *p;
+
+    for (p = cc->done; p; p = p->next) {
+        if (va_CopyObjectMatch(&p->dst, job->dst.obj_type, va_CopyObjectID(&job->dst))) {
+            free(job);
+            return;
+        }
+    }
+
+    job->next = cc->done;
+    cc->done = job;
+    __atomic_store_n(&cc->num_done, cc->num_done + 1, __ATOMIC_RELEASE);
+}
+
+/* must be called with cc->lock held */
+static int va_CopyFindDone(struct va_copy_context *cc, VACopyObjectType obj_type, VAGenericID id)
+{
+    struct va_copy_pending *p;
+
+    for (p = cc->done; p; p = p->next) {
+        if (va_CopyObjectMatch(&p->dst, obj_type, id))
+            return 1;
+    }
+
+    return 0;
+}
+
+/* must be called with cc->lock held */
+static void va_CopyForgetDone(struct va_copy_context *cc, VACopyObjectType obj_type, VAGenericID id)
+{
+    struct va_copy_pending **p;
+
+    for (p = &cc->done; *p; p = &(*p)->next) {
+        if (va_CopyObjectMatch(&(*p)->dst, obj_type, id)) {
+            struct va_copy_pending *job = *p;
+
+            *p = job->next;
+            __atomic_store_n(&cc->num_done, cc->num_done - 1, __ATOMIC_RELEASE);
+            free(job);
+            return;
+        }
+    }
+}
+
+static void va_CopyBandLinear(void *arg)
+{
+    struct va_copy_job *job = arg;
+
+    vaStreamCopy(job->dst, job->src, job->size);
+}
+
+static VAStatus va_CopyLinear(struct va_copy_context *cc, void *dst, const void *src, size_t size)
+{
+    struct va_copy_job *jobs;
+    unsigned int i, num_jobs;
+
+    num_jobs = (size + VA_COPY_CHUNK_SIZE - 1) / VA_COPY_CHUNK_SIZE;
+    if (num_jobs <= 1) {
+        vaStreamCopy(dst, src, size);
+        return VA_STATUS_SUCCESS;
+    }
+
+    jobs = calloc(num_jobs, sizeof(*jobs));
+    if (!jobs)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    for (i = 0; i < num_jobs; i++) {
+        size_t offset = (size_t)i * VA_COPY_CHUNK_SIZE;
+
+        jobs[i].src = (const uint8_t *)src + offset;
+        jobs[i].dst = (uint8_t *)dst + offset;
+        jobs[i].size = size - offset < VA_COPY_CHUNK_SIZE ? size - offset : VA_COPY_CHUNK_SIZE;
+    }
+    va_ThreadPoolRun(cc->pool, va_CopyBandLinear, jobs, sizeof(*jobs), num_jobs);
+
+    free(jobs);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus va_CopyImage(struct va_copy_context *cc,
+                             const VAImage *src_image, const void *src_data,
+                             const VAImage *dst_image, void *dst_data)
+{
+    if (!vaConvertIsSupported(src_image->format.fourcc, dst_image->format.fourcc)) {
+        /* unknown layout: only a verbatim copy of identical images can be done */
+        if (src_image->format.fourcc != dst_image->format.fourcc ||
+            src_image->data_size != dst_image->data_size ||
+            memcmp(src_image->pitches, dst_image->pitches, sizeof(src_image->pitches)) ||
+            memcmp(src_image->offsets, dst_image->offsets, sizeof(src_image->offsets)))
+            return VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
+
+        return va_CopyLinear(cc, dst_data, src_data, src_image->data_size);
+    }
+
+    return va_ConvertImageParallel(cc->pool, src_image, src_data, dst_image, dst_data,
+                                   VA_CONVERT_FLAG_UNCACHED_SOURCE);
+}
+
+static VAStatus va_CopySurface(VADisplay dpy, struct va_copy_context *cc,
+                               VASurfaceID dst, VASurfaceID src)
+{
+    VADriverContextP ctx = CTX(dpy);
+    VAImage src_image, dst_image;
+    void *src_data = NULL, *dst_data = NULL;
+    VAStatus va_status, src_derive, dst_derive;
+
+    va_status = ctx->vtable->vaSyncSurface(ctx, src);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+    /* the GPU may still write or read the destination, the CPU copy must not race with it */
+    va_status = ctx->vtable->vaSyncSurface(ctx, dst);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    src_image.image_id = dst_image.image_id = VA_INVALID_ID;
+    src_derive = vaDeriveImage(dpy, src, &src_image);
+    dst_derive = vaDeriveImage(dpy, dst, &dst_image);
+
+    if (src_derive == VA_STATUS_SUCCESS && dst_derive == VA_STATUS_SUCCESS) {
+        va_status = vaMapBuffer(dpy, src_image.buf, &src_data);
+        if (va_status == VA_STATUS_SUCCESS) {
+            va_status = vaMapBuffer(dpy, dst_image.buf, &dst_data);
+            if (va_status == VA_STATUS_SUCCESS) {
+                va_status = va_CopyImage(cc, &src_image, src_data, &dst_image, dst_data);
+                vaUnmapBuffer(dpy, dst_image.buf);
+            }
+            vaUnmapBuffer(dpy, src_image.buf);
+        }
+    } else if (dst_derive == VA_STATUS_SUCCESS) {
+        /* read the source through the driver into the destination pixels */
+        va_status = vaGetImage(dpy, src, 0, 0, dst_image.width, dst_image.height, dst_image.image_id);
+    } else if (src_derive == VA_STATUS_SUCCESS) {
+        va_status = vaPutImage(dpy, dst, src_image.image_id, 0, 0, src_image.width, src_image.height,
+                               0, 0, src_image.width, src_image.height);
+    } else {
+        va_status = VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
+
+    if (src_derive == VA_STATUS_SUCCESS)
+        vaDestroyImage(dpy, src_image.image_id);
+    if (dst_derive == VA_STATUS_SUCCESS)
+        vaDestroyImage(dpy, dst_image.image_id);
+
+    return va_status;
+}
+
+static VAStatus va_CopyBuffer(VADisplay dpy, struct va_copy_context *cc,
+                              VABufferID dst, VABufferID src)
+{
+    VADriverContextP ctx = CTX(dpy);
+    VABufferType type;
+    unsigned int src_size, src_num, dst_size, dst_num;
+    size_t size;
+    void *src_data = NULL, *dst_data = NULL;
+    VAStatus va_status;
+
+    if (ctx->vtable->vaSyncBuffer)
+        ctx->vtable->vaSyncBuffer(ctx, src, VA_TIMEOUT_INFINITE);
+
+    if (!ctx->vtable->vaBufferInfo)
+        return VA_STATUS_ERROR_UNIMPLEMENTED;
+
+    va_status = ctx->vtable->vaBufferInfo(ctx, src, &type, &src_size, &src_num);
+    if (va_status == VA_STATUS_SUCCESS)
+        va_status = ctx->vtable->vaBufferInfo(ctx, dst, &type, &dst_size, &dst_num);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    size = (size_t)src_size * src_num;
+    if ((size_t)dst_size * dst_num < size)
+        size = (size_t)dst_size * dst_num;
+
+    va_status = vaMapBuffer(dpy, src, &src_data);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    va_status = vaMapBuffer(dpy, dst, &dst_data);
+    if (va_status == VA_STATUS_SUCCESS) {
+        va_status = va_CopyLinear(cc, dst_data, src_data, size);
+        vaUnmapBuffer(dpy, dst);
+    }
+    vaUnmapBuffer(dpy, src);
+
+    return va_status;
+}
+
+static VAStatus va_CopyObject(VADisplay dpy, struct va_copy_context *cc,
+                              const VACopyObject *dst, const VACopyObject *src)
+{
+    if (dst->obj_type == VACopyObjectSurface)
+        return va_CopySurface(dpy, cc, dst->object.surface_id, src->object.surface_id);
+
+    return va_CopyBuffer(dpy, cc, dst->object.buffer_id, src->object.buffer_id);
+}
+
+static void va_CopyAsyncTask(void *arg)
+{
+    struct va_copy_pending *job = arg;
+    struct va_copy_context *cc = DPY2COPYCTX(job->dpy);
+    VAStatus va_status;
+
+    va_status = va_CopyObject(job->dpy, cc, &job->dst, &job->src);
+    if (va_status != VA_STATUS_SUCCESS)
+        va_errorMessage(job->dpy, "Asynchronous software copy failed: %s\n", vaErrorStr(va_status));
+
+    pthread_mutex_lock(&cc->lock);
+    va_CopyUnlinkPending(cc, job);
+    if (va_status == VA_STATUS_SUCCESS)
+        va_CopyRecordDone(cc, job);
+    else
+        free(job);
+    pthread_cond_broadcast(&cc->cond);
+    pthread_mutex_unlock(&cc->lock);
+}
+
+VAStatus va_CopySoftware(VADisplay dpy, VACopyObject *dst, VACopyObject *src, VACopyOption option)
+{
+    struct va_copy_context *cc;
+    struct va_copy_pending *job;
+    VAStatus va_status;
+
+    if (!dst || !src || dst->obj_type != src->obj_type)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (dst->obj_type != VACopyObjectSurface && dst->obj_type != VACopyObjectBuffer)
+        return VA_STATUS_ERROR_UNSUPPORTED_MEMORY_TYPE;
+
+    cc = va_CopyGetContext(dpy);
+    if (!cc)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    if (option.bits.va_copy_sync == VA_EXEC_SYNC) {
+        /* keep the order with the asynchronous copies still in flight */
+        va_status = va_CopySync(dpy, src->obj_type, va_CopyObjectID(src), VA_TIMEOUT_INFINITE, NULL);
+        if (va_status == VA_STATUS_SUCCESS)
+            va_status = va_CopySync(dpy, dst->obj_type, va_CopyObjectID(dst), VA_TIMEOUT_INFINITE, NULL);
+        if (va_status != VA_STATUS_SUCCESS)
+            return va_status;
+    }
+
+    job = calloc(1, sizeof(*job));
+    if (!job)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    job->dst = *dst;
+    job->src = *src;
+    job->dpy = dpy;
+
+    if (option.bits.va_copy_sync == VA_EXEC_SYNC) {
+        va_status = va_CopyObject(dpy, cc, dst, src);
+        pthread_mutex_lock(&cc->lock);
+        if (va_status == VA_STATUS_SUCCESS)
+            va_CopyRecordDone(cc, job);
+        else
+            free(job);
+        pthread_mutex_unlock(&cc->lock);
+        return va_status;
+    }
+
+    pthread_mutex_lock(&cc->lock);
+    job->next = cc->pending;
+    cc->pending = job;
+    __atomic_store_n(&cc->num_pending, cc->num_pending + 1, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&cc->lock);
+
+    if (va_ThreadPoolSubmit(cc->async_pool, va_CopyAsyncTask, job) != 0) {
+        pthread_mutex_lock(&cc->lock);
+        va_CopyUnlinkPending(cc, job);
+        pthread_mutex_unlock(&cc->lock);
+        free(job);
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus va_CopySync(VADisplay dpy, VACopyObjectType obj_type, VAGenericID id, uint64_t timeout_ns,
+                     int *copied)
+{
+    struct va_copy_context *cc = DPY2COPYCTX(dpy);
+    struct timespec deadline;
+    VAStatus va_status = VA_STATUS_SUCCESS;
+    int waited = 0;
+
+    if (copied)
+        *copied = 0;
+    if (!cc || (!__atomic_load_n(&cc->num_pending, __ATOMIC_ACQUIRE) &&
+                !__atomic_load_n(&cc->num_done, __ATOMIC_ACQUIRE)))
+        return VA_STATUS_SUCCESS;
+
+    if (timeout_ns != VA_TIMEOUT_INFINITE)
+        va_DeadlineFromTimeout(&deadline, timeout_ns);
+
+    pthread_mutex_lock(&cc->lock);
+    while (va_CopyFindPending(cc, obj_type, id)) {
+        waited = 1;
+        if (timeout_ns == VA_TIMEOUT_INFINITE) {
+            pthread_cond_wait(&cc->cond, &cc->lock);
+        } else if (pthread_cond_timedwait(&cc->cond, &cc->lock, &deadline) == ETIMEDOUT) {
+            if (va_CopyFindPending(cc, obj_type, id))
+                va_status = VA_STATUS_ERROR_TIMEDOUT;
+            break;
+        }
+    }
+    if (va_status == VA_STATUS_SUCCESS && copied)
+        *copied = waited || va_CopyFindDone(cc, obj_type, id);
+    pthread_mutex_unlock(&cc->lock);
+
+    return va_status;
+}
+
+void va_CopyForget(VADisplay dpy, VACopyObjectType obj_type, VAGenericID id)
+{
+    struct va_copy_context *cc = DPY2COPYCTX(dpy);
+
+    va_CopySync(dpy, obj_type, id, VA_TIMEOUT_INFINITE, NULL);
+    if (!cc || !__atomic_load_n(&cc->num_done, __ATOMIC_ACQUIRE))
+        return;
+
+    pthread_mutex_lock(&cc->lock);
+    va_CopyForgetDone(cc, obj_type, id);
+    pthread_mutex_unlock(&cc->lock);
+}
+
+int va_CopyIsPending(VADisplay dpy, VACopyObjectType obj_type, VAGenericID id)
+{
+    struct va_copy_context *cc = DPY2COPYCTX(dpy);
+    int pending;
+
+    if (!cc || !__atomic_load_n(&cc->num_pending, __ATOMIC_ACQUIRE))
+        return 0;
+
+    pthread_mutex_lock(&cc->lock);
+    pending = va_CopyFindPending(cc, obj_type, id);
+    pthread_mutex_unlock(&cc->lock);
+
+    return pending;
+}
+
+void va_CopyEnd(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_copy_context *cc = DPY2COPYCTX(dpy);
+
+    if (!cc)
+        return;
+
+    /* the async worker drains its queue before exiting */
+    va_ThreadPoolDestroy(cc->async_pool);
+    va_ThreadPoolDestroy(cc->pool);
+
+    while (cc->done) {
+        struct va_copy_pending *job = cc->done;
+
+        cc->done = job->next;
+        free(job);
+    }
+
+    pthread_cond_destroy(&cc->cond);
+    pthread_mutex_destroy(&cc->lock);
+    free(cc);
+
+    __atomic_store_n(&pDisplayContext->vacopy, NULL, __ATOMIC_RELEASE);
+}
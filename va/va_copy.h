@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VA_COPY_H
+#define VA_COPY_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct va_thread_pool;
+
+/*
+ * Software implementation of vaCopy() used when the driver does not
+ * provide one. Surfaces are copied through derived images in bands of
+ * lines spread over a worker pool, buffers in linear chunks.
+ * VA_EXEC_ASYNC copies are queued to a dedicated worker and are waited
+ * for by vaSyncSurface/vaSyncSurface2/vaSyncBuffer and before the
+ * objects are destroyed.
+ */
+DLL_HIDDEN
+VAStatus va_CopySoftware(VADisplay dpy, VACopyObject *dst, VACopyObject *src, VACopyOption option);
+
+/*
+ * Wait for the pending software copies reading or writing the object.
+ * *copied, if not NULL, tells whether the object was part of such a copy
+ * or is the destination of a completed one: the copy was then the last
+ * operation on it known to libva, which the sync functions report as
+ * complete when the driver cannot sync the object itself.
+ */
+DLL_HIDDEN
+VAStatus va_CopySync(VADisplay dpy, VACopyObjectType obj_type, VAGenericID id, uint64_t timeout_ns,
+                     int *copied);
+
+/*
+ * Wait for the pending software copies of the object and drop the record
+ * of the completed ones, the object is destroyed or rendered to again.
+ */
+DLL_HIDDEN
+void va_CopyForget(VADisplay dpy, VACopyObjectType obj_type, VAGenericID id);
+
+/* Whether a software copy involving the object is still pending */
+DLL_HIDDEN
+int va_CopyIsPending(VADisplay dpy, VACopyObjectType obj_type, VAGenericID id);
+
+/* Worker pool shared by the libva side helpers of the display, created on first use */
+DLL_HIDDEN
+struct va_thread_pool *va_CopyGetThreadPool(VADisplay dpy);
+
+/* Wait for the pending copies and release the copy context */
+DLL_HIDDEN
+void va_CopyEnd(VADisplay dpy);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_COPY_H */
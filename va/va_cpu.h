@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Runtime CPU feature detection for the SIMD helpers (image conversion,
+ * readback, bitstream scanning).  The kernels themselves are compiled with
+ * per-function target attributes so that the library as a whole keeps the
+ * baseline ABI of the toolchain.
+ */
+
+#ifndef VA_CPU_H
+#define VA_CPU_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VA_CPU_X86 1
+#define VA_TARGET(isa) __attribute__((target(isa)))
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || (defined(__ARM_NEON) && defined(__arm__))
+#define VA_CPU_NEON 1
+#include <arm_neon.h>
+#endif
+
+#define VA_CPU_FLAG_SSE2    0x1
+#define VA_CPU_FLAG_SSSE3   0x2
+#define VA_CPU_FLAG_SSE41   0x4
+#define VA_CPU_FLAG_AVX2    0x8
+#define VA_CPU_FLAG_NEON    0x10
+
+/*
+ * Return the set of VA_CPU_FLAG_xxx supported by the running CPU.
+ * LIBVA_CPU_MASK=<hex>, in the environment or libva.conf, masks out
+ * features, which is handy to compare SIMD output against the scalar
+ * reference paths. Users include va_internal.h first.
+ */
+static inline unsigned int va_CpuFeatures(void)
+{
+    /* bit 31 marks the detection done, the helpers may run on several threads */
+    static unsigned int cached;
+    unsigned int flags = __atomic_load_n(&cached, __ATOMIC_ACQUIRE);
+
+    if (flags)
+        return flags & ~0x80000000U;
+
+#if defined(VA_CPU_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        flags |= VA_CPU_FLAG_SSE2;
+    if (__builtin_cpu_supports("ssse3"))
+        flags |= VA_CPU_FLAG_SSSE3;
+    if (__builtin_cpu_supports("sse4.1"))
+        flags |= VA_CPU_FLAG_SSE41;
+    if (__builtin_cpu_supports("avx2"))
+        flags |= VA_CPU_FLAG_AVX2;
+#elif defined(VA_CPU_NEON)
+    flags |= VA_CPU_FLAG_NEON;
+#endif
+
+    {
+        char env_value[1024];
+
+        if (va_parseConfig("LIBVA_CPU_MASK", &env_value[0]) == 0)
+            flags &= strtoul(env_value, NULL, 16);
+    }
+
+    __atomic_store_n(&cached, flags | 0x80000000U, __ATOMIC_RELEASE);
+    return flags;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_CPU_H */
@@ -0,0 +1,536 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_drmcommon.h"
+#include "va_dmabuf.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* enough for a full PRIME_2 descriptor plus a few other attributes */
+#define VA_DMABUF_MAX_KEY       160
+
+struct va_dmabuf_key {
+    unsigned int len;           /* 0: not shareable, never matched */
+    uint64_t hash;
+    uint64_t words[VA_DMABUF_MAX_KEY];
+};
+
+struct va_dmabuf_import {
+    struct va_dmabuf_key key;
+    VASurfaceID surface;
+    unsigned int refs;
+    struct va_dmabuf_import *next;      /* all the imports */
+    struct va_dmabuf_import *lru_prev;  /* unreferenced imports, most recently released first */
+    struct va_dmabuf_import *lru_next;
+};
+
+struct va_dmabuf_export {
+    VASurfaceID surface;
+    uint32_t flags;
+    VADRMPRIMESurfaceDescriptor desc;   /* the fds are owned by the cache */
+    struct va_dmabuf_export *next;
+};
+
+/*
+ * Pipelines import a few dozen dma-bufs at most, the lists are searched
+ * linearly.
+ */
+struct va_dmabuf_cache {
+    pthread_mutex_t lock;
+    struct va_dmabuf_import *imports;
+    struct va_dmabuf_import *lru_head;
+    struct va_dmabuf_import *lru_tail;
+    unsigned int num_idle;
+    unsigned int max_idle;
+    struct va_dmabuf_export *exports;
+};
+
+static pthread_mutex_t va_dmabuf_init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define DPY2DMABUF(dpy) \
+    ((struct va_dmabuf_cache *)__atomic_load_n(&((VADisplayContextP)dpy)->vadmabuf, __ATOMIC_ACQUIRE))
+
+static struct va_dmabuf_cache *va_DmaBufGetCache(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_dmabuf_cache *cache = DPY2DMABUF(dpy);
+    char env_value[1024];
+
+    if (cache)
+        return cache;
+
+    pthread_mutex_lock(&va_dmabuf_init_lock);
+    cache = pDisplayContext->vadmabuf;
+    if (!cache) {
+        cache = calloc(1, sizeof(*cache));
+        if (cache) {
+            pthread_mutex_init(&cache->lock, NULL);
+            cache->max_idle = 16;
+            if (va_parseConfig("LIBVA_DMABUF_CACHE_SIZE", &env_value[0]) == 0)
+                cache->max_idle = strtoul(env_value, NULL, 10);
+            __atomic_store_n(&pDisplayContext->vadmabuf, cache, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&va_dmabuf_init_lock);
+
+    return cache;
+}
+
+static int va_DmaBufKeyAdd(struct va_dmabuf_key *key, uint64_t word)
+{
+    if (key->len == VA_DMABUF_MAX_KEY)
+        return -1;
+    key->words[key->len++] = word;
+    return 0;
+}
+
+/* a dma-buf is identified by its inode, whatever the fd it is imported through */
+static int va_DmaBufKeyAddFd(struct va_dmabuf_key *key, int fd)
+{
+    struct stat st;
+
+    if (fstat(fd, &st) != 0)
+        return -1;
+    if (va_DmaBufKeyAdd(key, st.st_dev) || va_DmaBufKeyAdd(key, st.st_ino))
+        return -1;
+    return 0;
+}
+
+static int va_DmaBufKeyAddPrime2(struct va_dmabuf_key *key, const VADRMPRIMESurfaceDescriptor *desc)
+{
+    uint32_t i, j;
+    int ret = 0;
+
+    if (desc->num_objects > 4 || desc->num_layers > 4)
+        return -1;
+
+    ret |= va_DmaBufKeyAdd(key, desc->fourcc);
+    ret |= va_DmaBufKeyAdd(key, ((uint64_t)desc->width << 32) | desc->height);
+    ret |= va_DmaBufKeyAdd(key, ((uint64_t)desc->num_objects << 32) | desc->num_layers);
+    for (i = 0; i < desc->num_objects; i++) {
+        ret |= va_DmaBufKeyAddFd(key, desc->objects[i].fd);
+        ret |= va_DmaBufKeyAdd(key, desc->objects[i].size);
+        ret |= va_DmaBufKeyAdd(key, desc->objects[i].drm_format_modifier);
+    }
+    for (i = 0; i < desc->num_layers; i++) {
+        if (desc->layers[i].num_planes > 4)
+            return -1;
+        ret |= va_DmaBufKeyAdd(key, ((uint64_t)desc->layers[i].drm_format << 32) |
+                               desc->layers[i].num_planes);
+        for (j = 0; j < desc->layers[i].num_planes; j++) {
+            ret |= va_DmaBufKeyAdd(key, desc->layers[i].object_index[j]);
+            ret |= va_DmaBufKeyAdd(key, ((uint64_t)desc->layers[i].offset[j] << 32) |
+                                   desc->layers[i].pitch[j]);
+        }
+    }
+    return ret;
+}
+
+static int va_DmaBufKeyAddPrime(struct va_dmabuf_key *key, const VASurfaceAttribExternalBuffers *desc)
+{
+    uint32_t i;
+    int ret = 0;
+
+    if (desc->num_planes > 4 || !desc->buffers)
+        return -1;
+
+    ret |= va_DmaBufKeyAdd(key, desc->pixel_format);
+    ret |= va_DmaBufKeyAdd(key, ((uint64_t)desc->width << 32) | desc->height);
+    ret |= va_DmaBufKeyAdd(key, ((uint64_t)desc->data_size << 32) | desc->num_planes);
+    ret |= va_DmaBufKeyAdd(key, ((uint64_t)desc->num_buffers << 32) | desc->flags);
+    for (i = 0; i < desc->num_planes; i++)
+        ret |= va_DmaBufKeyAdd(key, ((uint64_t)desc->offsets[i] << 32) | desc->pitches[i]);
+    for (i = 0; i < desc->num_buffers; i++)
+        ret |= va_DmaBufKeyAddFd(key, (int)desc->buffers[i]);
+    return ret;
+}
+
+/* build the identity of an import, returns the memory type or 0 if not a DRM PRIME import */
+static uint32_t va_DmaBufMakeKey(struct va_dmabuf_key *key, unsigned int format,
+                                 unsigned int width, unsigned int height,
+                                 const VASurfaceAttrib *attrib_list, unsigned int num_attribs)
+{
+    const void *desc = NULL;
+    uint32_t mem_type = 0;
+    unsigned int i;
+    int ret = 0;
+
+    for (i = 0; i < num_attribs; i++) {
+        if (attrib_list[i].type == VASurfaceAttribMemoryType)
+            mem_type = attrib_list[i].value.value.i;
+        else if (attrib_list[i].type == VASurfaceAttribExternalBufferDescriptor)
+            desc = attrib_list[i].value.value.p;
+    }
+    if ((mem_type != VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME &&
+         mem_type != VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2) || !desc)
+        return 0;
+
+    key->len = 0;
+    ret |= va_DmaBufKeyAdd(key, format);
+    ret |= va_DmaBufKeyAdd(key, ((uint64_t)width << 32) | height);
+    for (i = 0; i < num_attribs; i++) {
+        if (attrib_list[i].type == VASurfaceAttribExternalBufferDescriptor)
+            continue;
+        ret |= va_DmaBufKeyAdd(key, ((uint64_t)attrib_list[i].type << 32) |
+                               attrib_list[i].value.type);
+        ret |= va_DmaBufKeyAdd(key, attrib_list[i].value.type == VAGenericValueTypePointer ?
+                               (uint64_t)(uintptr_t)attrib_list[i].value.value.p :
+                               (uint64_t)(uint32_t)attrib_list[i].value.value.i);
+    }
+    if (mem_type == VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2)
+        ret |= va_DmaBufKeyAddPrime2(key, desc);
+    else
+        ret |= va_DmaBufKeyAddPrime(key, desc);
+
+    if (ret) {
+        /* too complex or unreadable fds: the import works, but is not shared */
+        key->len = 0;
+        return mem_type;
+    }
+
+    /* FNV-1a */
+    key->hash = 0xcbf29ce484222325ULL;
+    for (i = 0; i < key->len; i++) {
+        key->hash ^= key->words[i];
+        key->hash *= 0x100000001b3ULL;
+    }
+    return mem_type;
+}
+
+static void va_DmaBufLruRemove(struct va_dmabuf_cache *cache, struct va_dmabuf_import *import)
+{
+    if (import->lru_prev)
+        import->lru_prev->lru_next = import->lru_next;
+    else
+        cache->lru_head = import->lru_next;
+    if (import->lru_next)
+        import->lru_next->lru_prev = import->lru_prev;
+    else
+        cache->lru_tail = import->lru_prev;
+    import->lru_prev = import->lru_next = NULL;
+    cache->num_idle--;
+}
+
+static void va_DmaBufUnlink(struct va_dmabuf_cache *cache, struct va_dmabuf_import *import)
+{
+    struct va_dmabuf_import **prev;
+
+    for (prev = &cache->imports; *prev != import; prev = &(*prev)->next)
+        ;
+    *prev = import->next;
+    if (import->refs == 0)
+        va_DmaBufLruRemove(cache, import);
+}
+
+static struct va_dmabuf_import *va_DmaBufFindSurface(struct va_dmabuf_cache *cache, VASurfaceID surface)
+{
+    struct va_dmabuf_import *import;
+
+    for (import = cache->imports; import; import = import->next) {
+        if (import->surface == surface)
+            return import;
+    }
+    return NULL;
+}
+
+/* destroy the least recently released imports beyond max_idle, called with cache->lock held */
+static void va_DmaBufEvict(VADisplay dpy, struct va_dmabuf_cache *cache, unsigned int max_idle)
+{
+    while (cache->num_idle > max_idle) {
+        struct va_dmabuf_import *import = cache->lru_tail;
+        VASurfaceID surface = import->surface;
+
+        va_DmaBufUnlink(cache, import);
+        free(import);
+
+        /* vaDestroySurfaces() comes back for the exports of the surface */
+        pthread_mutex_unlock(&cache->lock);
+        vaDestroySurfaces(dpy, &surface, 1);
+        pthread_mutex_lock(&cache->lock);
+    }
+}
+
+VAStatus vaImportDmaBufSurface(
+    VADisplay dpy,
+    unsigned int format,
+    unsigned int width,
+    unsigned int height,
+    VASurfaceAttrib *attrib_list,
+    unsigned int num_attribs,
+    VASurfaceID *surface     /* out */
+)
+{
+    struct va_dmabuf_cache *cache;
+    struct va_dmabuf_import *import;
+    VAStatus va_status;
+
+    CHECK_DISPLAY(dpy);
+
+    if (!surface || (!attrib_list && num_attribs))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    cache = va_DmaBufGetCache(dpy);
+    import = calloc(1, sizeof(*import));
+    if (!cache || !import) {
+        free(import);
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+    if (!va_DmaBufMakeKey(&import->key, format, width, height, attrib_list, num_attribs)) {
+        free(import);
+        return VA_STATUS_ERROR_UNSUPPORTED_MEMORY_TYPE;
+    }
+
+    if (import->key.len) {
+        struct va_dmabuf_import *cached;
+
+        pthread_mutex_lock(&cache->lock);
+        for (cached = cache->imports; cached; cached = cached->next) {
+            if (cached->key.hash == import->key.hash && cached->key.len == import->key.len &&
+                !memcmp(cached->key.words, import->key.words, import->key.len * sizeof(uint64_t)))
+                break;
+        }
+        if (cached) {
+            if (cached->refs++ == 0)
+                va_DmaBufLruRemove(cache, cached);
+            *surface = cached->surface;
+            pthread_mutex_unlock(&cache->lock);
+            free(import);
+            return VA_STATUS_SUCCESS;
+        }
+        pthread_mutex_unlock(&cache->lock);
+    }
+
+    /* a concurrent import of the same dma-buf may create a second surface, which is harmless */
+    va_status = vaCreateSurfaces(dpy, format, width, height, surface, 1, attrib_list, num_attribs);
+    if (va_status != VA_STATUS_SUCCESS) {
+        free(import);
+        return va_status;
+    }
+
+    import->surface = *surface;
+    import->refs = 1;
+    pthread_mutex_lock(&cache->lock);
+    import->next = cache->imports;
+    cache->imports = import;
+    pthread_mutex_unlock(&cache->lock);
+
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaReleaseDmaBufSurface(
+    VADisplay dpy,
+    VASurfaceID surface
+)
+{
+    struct va_dmabuf_cache *cache;
+    struct va_dmabuf_import *import;
+
+    CHECK_DISPLAY(dpy);
+
+    cache = DPY2DMABUF(dpy);
+    if (!cache)
+        return VA_STATUS_ERROR_INVALID_SURFACE;
+
+    pthread_mutex_lock(&cache->lock);
+    import = va_DmaBufFindSurface(cache, surface);
+    if (!import || import->refs == 0) {
+        pthread_mutex_unlock(&cache->lock);
+        return VA_STATUS_ERROR_INVALID_SURFACE;
+    }
+
+    if (--import->refs == 0) {
+        if (!import->key.len) {
+            /* nothing to share it with */
+            va_DmaBufUnlink(cache, import);
+            free(import);
+            pthread_mutex_unlock(&cache->lock);
+            return vaDestroySurfaces(dpy, &surface, 1);
+        }
+        import->lru_next = cache->lru_head;
+        if (cache->lru_head)
+            cache->lru_head->lru_prev = import;
+        else
+            cache->lru_tail = import;
+        cache->lru_head = import;
+        cache->num_idle++;
+        va_DmaBufEvict(dpy, cache, cache->max_idle);
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    return VA_STATUS_SUCCESS;
+}
+
+static void va_DmaBufCloseExport(struct va_dmabuf_export *export)
+{
+    uint32_t i;
+
+    for (i = 0; i < export->desc.num_objects && i < 4; i++)
+        close(export->desc.objects[i].fd);
+    free(export);
+}
+
+VAStatus vaExportDmaBufSurface(
+    VADisplay dpy,
+    VASurfaceID surface,
+    uint32_t flags,
+    VADRMPRIMESurfaceDescriptor *descriptor     /* out */
+)
+{
+    struct va_dmabuf_cache *cache;
+    struct va_dmabuf_export *export, *cached;
+    VAStatus va_status;
+
+    CHECK_DISPLAY(dpy);
+
+    if (!descriptor)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    cache = va_DmaBufGetCache(dpy);
+    if (!cache)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    pthread_mutex_lock(&cache->lock);
+    for (cached = cache->exports; cached; cached = cached->next) {
+        if (cached->surface == surface && cached->flags == flags) {
+            *descriptor = cached->desc;
+            pthread_mutex_unlock(&cache->lock);
+            return VA_STATUS_SUCCESS;
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    export = calloc(1, sizeof(*export));
+    if (!export)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    va_status = vaExportSurfaceHandle(dpy, surface, VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
+                                      flags, &export->desc);
+    if (va_status != VA_STATUS_SUCCESS) {
+        free(export);
+        return va_status;
+    }
+    export->surface = surface;
+    export->flags = flags;
+
+    pthread_mutex_lock(&cache->lock);
+    /* keep the first export if another thread raced with this one */
+    for (cached = cache->exports; cached; cached = cached->next) {
+        if (cached->surface == surface && cached->flags == flags)
+            break;
+    }
+    if (cached) {
+        va_DmaBufCloseExport(export);
+        export = cached;
+    } else {
+        export->next = cache->exports;
+        cache->exports = export;
+    }
+    *descriptor = export->desc;
+    pthread_mutex_unlock(&cache->lock);
+
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaTrimDmaBufCache(
+    VADisplay dpy,
+    unsigned int max_idle
+)
+{
+    struct va_dmabuf_cache *cache;
+
+    CHECK_DISPLAY(dpy);
+
+    cache = DPY2DMABUF(dpy);
+    if (!cache)
+        return VA_STATUS_SUCCESS;
+
+    pthread_mutex_lock(&cache->lock);
+    va_DmaBufEvict(dpy, cache, max_idle);
+    pthread_mutex_unlock(&cache->lock);
+
+    return VA_STATUS_SUCCESS;
+}
+
+void va_DmaBufForgetSurfaces(VADisplay dpy, const VASurfaceID *surfaces, int num_surfaces)
+{
+    struct va_dmabuf_cache *cache = DPY2DMABUF(dpy);
+    struct va_dmabuf_export **prev, *export;
+    struct va_dmabuf_import *import;
+    int i;
+
+    if (!cache || !surfaces)
+        return;
+
+    pthread_mutex_lock(&cache->lock);
+    for (i = 0; i < num_surfaces; i++) {
+        import = va_DmaBufFindSurface(cache, surfaces[i]);
+        if (import) {
+            va_DmaBufUnlink(cache, import);
+            free(import);
+        }
+        for (prev = &cache->exports; (export = *prev);) {
+            if (export->surface == surfaces[i]) {
+                *prev = export->next;
+                va_DmaBufCloseExport(export);
+            } else {
+                prev = &export->next;
+            }
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void va_DmaBufEnd(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_dmabuf_cache *cache = DPY2DMABUF(dpy);
+
+    if (!cache)
+        return;
+
+    /* the imported surfaces go away with the driver context */
+    while (cache->imports) {
+        struct va_dmabuf_import *import = cache->imports;
+
+        cache->imports = import->next;
+        free(import);
+    }
+    while (cache->exports) {
+        struct va_dmabuf_export *export = cache->exports;
+
+        cache->exports = export->next;
+        va_DmaBufCloseExport(export);
+    }
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+    __atomic_store_n(&pDisplayContext->vadmabuf, NULL, __ATOMIC_RELEASE);
+}
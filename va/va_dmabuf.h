@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_dmabuf.h
+ * \brief Caching of DMA-BUF surface imports and exports
+ *
+ * Zero-copy pipelines usually cycle through a fixed set of dma-bufs, and
+ * importing one of them with vaCreateSurfaces() on every frame costs a
+ * PRIME fd to handle conversion and a surface creation in the driver.
+ * The import cache hands out the surface created for the same dma-buf
+ * and layout the previous time instead. Likewise, the export cache keeps
+ * the result of vaExportSurfaceHandle() for each surface.
+ */
+
+#ifndef _VA_DMABUF_H_
+#define _VA_DMABUF_H_
+
+#include <va/va.h>
+#include <va/va_drmcommon.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_dmabuf DMA-BUF import and export cache
+ *
+ * @{
+ */
+
+/**
+ * \brief Imports dma-bufs as a surface, reusing a cached import.
+ *
+ * Takes the same arguments as vaCreateSurfaces() for a single surface,
+ * and \c attrib_list must contain a VASurfaceAttribMemoryType of
+ * VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME or
+ * VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2 along with the matching
+ * VASurfaceAttribExternalBufferDescriptor.
+ *
+ * Imports are identified by the dma-bufs themselves (device and inode of
+ * the file descriptors, not the descriptor numbers), the format modifiers,
+ * the plane layout and the other attributes. If a surface was imported
+ * with the same identity before, it is returned and its reference count
+ * incremented instead of creating a new one. The file descriptors remain
+ * owned by the caller in both cases.
+ *
+ * Surfaces obtained this way are released with vaReleaseDmaBufSurface().
+ * Up to LIBVA_DMABUF_CACHE_SIZE (16 by default) released surfaces are
+ * kept for reuse, the least recently released ones are destroyed first.
+ *
+ * @return VA_STATUS_ERROR_UNSUPPORTED_MEMORY_TYPE if the attributes do not
+ *         describe a DRM PRIME import, else the result of the import
+ */
+VAStatus vaImportDmaBufSurface(
+    VADisplay dpy,
+    unsigned int format,
+    unsigned int width,
+    unsigned int height,
+    VASurfaceAttrib *attrib_list,
+    unsigned int num_attribs,
+    VASurfaceID *surface     /* out */
+);
+
+/**
+ * \brief Releases a reference on a surface from vaImportDmaBufSurface().
+ *
+ * The surface stays valid for the other references. Once unreferenced it
+ * is kept in the cache, and destroyed on eviction, by vaTrimDmaBufCache()
+ * or by vaTerminate(). Destroying it with vaDestroySurfaces() removes it
+ * from the cache.
+ */
+VAStatus vaReleaseDmaBufSurface(
+    VADisplay dpy,
+    VASurfaceID surface
+);
+
+/**
+ * \brief Exports a surface as dma-bufs, reusing a cached export.
+ *
+ * Same as vaExportSurfaceHandle() with VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
+ * but the descriptor returned for a given surface and \c flags is cached:
+ * further calls return a copy of it without exporting again.
+ *
+ * The file descriptors in \c descriptor are owned by libva. They must not
+ * be closed by the application, which has to dup() them if it needs them
+ * beyond the lifetime of the surface: they are closed when the surface is
+ * destroyed (including through the eviction of an unreferenced import) or
+ * when the display is terminated.
+ */
+VAStatus vaExportDmaBufSurface(
+    VADisplay dpy,
+    VASurfaceID surface,
+    uint32_t flags,
+    VADRMPRIMESurfaceDescriptor *descriptor     /* out */
+);
+
+/**
+ * \brief Destroys unreferenced cached imports until at most \c max_idle remain.
+ *
+ * \c max_idle == 0 destroys all of them. Surfaces still referenced are
+ * not affected.
+ */
+VAStatus vaTrimDmaBufCache(
+    VADisplay dpy,
+    unsigned int max_idle
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_DMABUF_H_ */
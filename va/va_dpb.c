@@ -0,0 +1,829 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_dpb.h"
+#include "va_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* 16 reference frames, as many pictures waiting for output, and margin */
+#define VA_DPB_MAX_ENTRIES      40
+#define VA_DPB_MAX_OUTPUT       64
+#define VA_DPB_MAX_FRAMES       16
+
+#define VA_DPB_SHORT_TERM       1
+#define VA_DPB_LONG_TERM        2
+
+enum {
+    VA_DPB_CODEC_NONE,
+    /* pictures only list the references they use */
+    VA_DPB_CODEC_ANCHORS,
+    VA_DPB_CODEC_H264,
+    VA_DPB_CODEC_HEVC,
+    VA_DPB_CODEC_VP8,
+    VA_DPB_CODEC_VP9,
+    VA_DPB_CODEC_AV1,
+    /* intra only */
+    VA_DPB_CODEC_JPEG,
+};
+
+typedef struct va_dpb_entry {
+    /* VA_INVALID_SURFACE for the frames inferred from gaps in frame_num */
+    VASurfaceID surface;
+    /* 0, VA_DPB_SHORT_TERM or VA_DPB_LONG_TERM, each holds the surface */
+    uint8_t ref;
+    /* waiting for output, holds the surface */
+    uint8_t pending;
+    int32_t poc;
+
+    /* H.264 */
+    uint32_t frame_num;
+    uint32_t long_term_frame_idx;
+    int32_t top_poc;
+    int32_t bottom_poc;
+} va_dpb_entry;
+
+struct _VADecodeDPB {
+    VADisplay dpy;
+    VASurfacePool pool;
+    int codec;
+    unsigned int format;
+    unsigned int width;
+    unsigned int height;
+    VASurfaceAttrib *attribs;
+    unsigned int num_attribs;
+
+    /* in decode order */
+    va_dpb_entry entries[VA_DPB_MAX_ENTRIES];
+    unsigned int num_entries;
+
+    /* picture between vaBeginDPBPicture() and vaEndDPBPicture() */
+    VASurfaceID current;
+
+    /* H.264 marking of the current picture, when h264_valid */
+    int h264_valid;
+    VADecodeDPBPictureH264 h264;
+    uint32_t prev_ref_frame_num;
+
+    /* surfaces output and not returned by vaGetDPBOutput() yet */
+    VASurfaceID output[VA_DPB_MAX_OUTPUT];
+    unsigned int output_head;
+    unsigned int num_output;
+};
+
+static int va_DPBCodec(VAProfile profile)
+{
+    switch (profile) {
+    case VAProfileMPEG2Simple:
+    case VAProfileMPEG2Main:
+    case VAProfileMPEG4Simple:
+    case VAProfileMPEG4AdvancedSimple:
+    case VAProfileMPEG4Main:
+    case VAProfileVC1Simple:
+    case VAProfileVC1Main:
+    case VAProfileVC1Advanced:
+        return VA_DPB_CODEC_ANCHORS;
+    case VAProfileH264ConstrainedBaseline:
+    case VAProfileH264Main:
+    case VAProfileH264High:
+    case VAProfileH264MultiviewHigh:
+    case VAProfileH264StereoHigh:
+        return VA_DPB_CODEC_H264;
+    case VAProfileHEVCMain:
+    case VAProfileHEVCMain10:
+    case VAProfileHEVCMain12:
+    case VAProfileHEVCMain422_10:
+    case VAProfileHEVCMain422_12:
+    case VAProfileHEVCMain444:
+    case VAProfileHEVCMain444_10:
+    case VAProfileHEVCMain444_12:
+    case VAProfileHEVCSccMain:
+    case VAProfileHEVCSccMain10:
+    case VAProfileHEVCSccMain444:
+    case VAProfileHEVCSccMain444_10:
+        return VA_DPB_CODEC_HEVC;
+    case VAProfileVP8Version0_3:
+        return VA_DPB_CODEC_VP8;
+    case VAProfileVP9Profile0:
+    case VAProfileVP9Profile1:
+    case VAProfileVP9Profile2:
+    case VAProfileVP9Profile3:
+        return VA_DPB_CODEC_VP9;
+    case VAProfileAV1Profile0:
+    case VAProfileAV1Profile1:
+        return VA_DPB_CODEC_AV1;
+    case VAProfileJPEGBaseline:
+        return VA_DPB_CODEC_JPEG;
+    default:
+        return VA_DPB_CODEC_NONE;
+    }
+}
+
+VAStatus vaCreateDecodeDPB(
+    VADisplay dpy,
+    VAProfile profile,
+    unsigned int format,
+    unsigned int width,
+    unsigned int height,
+    VASurfaceAttrib *attrib_list,
+    unsigned int num_attribs,
+    VADecodeDPB *dpb
+)
+{
+    struct _VADecodeDPB *p;
+    VAStatus status;
+    int codec;
+
+    CHECK_DISPLAY(dpy);
+    if (!dpb || (num_attribs && !attrib_list))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    codec = va_DPBCodec(profile);
+    if (codec == VA_DPB_CODEC_NONE)
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+
+    p = calloc(1, sizeof(*p));
+    if (!p)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    if (num_attribs) {
+        p->attribs = malloc(num_attribs * sizeof(*attrib_list));
+        if (!p->attribs) {
+            free(p);
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+        }
+        memcpy(p->attribs, attrib_list, num_attribs * sizeof(*attrib_list));
+    }
+
+    status = vaCreateSurfacePool(dpy, 0, &p->pool);
+    if (status != VA_STATUS_SUCCESS) {
+        free(p->attribs);
+        free(p);
+        return status;
+    }
+
+    p->dpy = dpy;
+    p->codec = codec;
+    p->format = format;
+    p->width = width;
+    p->height = height;
+    p->num_attribs = num_attribs;
+    p->current = VA_INVALID_SURFACE;
+
+    *dpb = p;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyDecodeDPB(VADecodeDPB dpb)
+{
+    struct _VADecodeDPB *p = dpb;
+
+    if (!p)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    /* the pool destroys the surfaces still held */
+    vaDestroySurfacePool(p->dpy, p->pool);
+    free(p->attribs);
+    free(p);
+    return VA_STATUS_SUCCESS;
+}
+
+static void va_DPBRelease(struct _VADecodeDPB *p, VASurfaceID surface)
+{
+    if (surface != VA_INVALID_SURFACE)
+        vaReleasePoolSurfaces(p->dpy, p->pool, &surface, 1);
+}
+
+static void va_DPBUnref(struct _VADecodeDPB *p, va_dpb_entry *e)
+{
+    if (e->ref) {
+        e->ref = 0;
+        va_DPBRelease(p, e->surface);
+    }
+}
+
+/* drops the entries that are neither references nor waiting for output */
+static void va_DPBCompact(struct _VADecodeDPB *p)
+{
+    unsigned int i, n = 0;
+
+    for (i = 0; i < p->num_entries; i++) {
+        if (p->entries[i].ref || p->entries[i].pending)
+            p->entries[n++] = p->entries[i];
+    }
+    p->num_entries = n;
+}
+
+/* hands a held surface over to the output queue */
+static VAStatus va_DPBQueueOutput(struct _VADecodeDPB *p, VASurfaceID surface)
+{
+    if (p->num_output == VA_DPB_MAX_OUTPUT)
+        return VA_STATUS_ERROR_MAX_NUM_EXCEEDED;
+
+    p->output[(p->output_head + p->num_output) % VA_DPB_MAX_OUTPUT] = surface;
+    p->num_output++;
+    return VA_STATUS_SUCCESS;
+}
+
+/* outputs the waiting picture first in output order */
+static VAStatus va_DPBBump(struct _VADecodeDPB *p)
+{
+    va_dpb_entry *first = NULL;
+    unsigned int i;
+    VAStatus status;
+
+    for (i = 0; i < p->num_entries; i++) {
+        va_dpb_entry *e = &p->entries[i];
+
+        if (e->pending && (!first || e->poc < first->poc))
+            first = e;
+    }
+    if (!first)
+        return VA_STATUS_SUCCESS;
+
+    status = va_DPBQueueOutput(p, first->surface);
+    if (status == VA_STATUS_SUCCESS)
+        first->pending = 0;
+    return status;
+}
+
+/* outputs or discards all the waiting pictures */
+static VAStatus va_DPBFlushOutput(struct _VADecodeDPB *p, int discard)
+{
+    VAStatus status = VA_STATUS_SUCCESS;
+    unsigned int i;
+
+    if (discard) {
+        for (i = 0; i < p->num_entries; i++) {
+            if (p->entries[i].pending) {
+                p->entries[i].pending = 0;
+                va_DPBRelease(p, p->entries[i].surface);
+            }
+        }
+    } else {
+        for (i = 0; i < p->num_entries && status == VA_STATUS_SUCCESS; i++)
+            status = va_DPBBump(p);
+    }
+    va_DPBCompact(p);
+    return status;
+}
+
+VAStatus vaBeginDPBPicture(
+    VADecodeDPB dpb,
+    VASurfaceID *surface
+)
+{
+    struct _VADecodeDPB *p = dpb;
+    VAStatus status;
+
+    if (!p || !surface)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (p->current != VA_INVALID_SURFACE)
+        return VA_STATUS_ERROR_OPERATION_FAILED;
+
+    status = vaAcquirePoolSurfaces(p->dpy, p->pool, p->format, p->width, p->height,
+                                   &p->current, 1, p->attribs, p->num_attribs);
+    if (status != VA_STATUS_SUCCESS) {
+        p->current = VA_INVALID_SURFACE;
+        return status;
+    }
+    p->h264_valid = 0;
+    *surface = p->current;
+    return VA_STATUS_SUCCESS;
+}
+
+static unsigned int va_DPBListReferences(
+    int codec,
+    const void *pic_param,
+    VASurfaceID *refs
+)
+{
+    unsigned int i, n = 0;
+
+    switch (codec) {
+    case VA_DPB_CODEC_H264: {
+        const VAPictureParameterBufferH264 *pp = pic_param;
+
+        for (i = 0; i < 16; i++) {
+            if (!(pp->ReferenceFrames[i].flags & VA_PICTURE_H264_INVALID))
+                refs[n++] = pp->ReferenceFrames[i].picture_id;
+        }
+        break;
+    }
+    case VA_DPB_CODEC_HEVC: {
+        /* VAPictureParameterBufferHEVCExtension starts with it */
+        const VAPictureParameterBufferHEVC *pp = pic_param;
+
+        for (i = 0; i < 15; i++) {
+            if (!(pp->ReferenceFrames[i].flags & VA_PICTURE_HEVC_INVALID))
+                refs[n++] = pp->ReferenceFrames[i].picture_id;
+        }
+        break;
+    }
+    case VA_DPB_CODEC_VP8: {
+        const VAPictureParameterBufferVP8 *pp = pic_param;
+
+        refs[n++] = pp->last_ref_frame;
+        refs[n++] = pp->golden_ref_frame;
+        refs[n++] = pp->alt_ref_frame;
+        break;
+    }
+    case VA_DPB_CODEC_VP9: {
+        const VADecPictureParameterBufferVP9 *pp = pic_param;
+
+        for (i = 0; i < 8; i++)
+            refs[n++] = pp->reference_frames[i];
+        break;
+    }
+    case VA_DPB_CODEC_AV1: {
+        const VADecPictureParameterBufferAV1 *pp = pic_param;
+
+        for (i = 0; i < 8; i++)
+            refs[n++] = pp->ref_frame_map[i];
+        break;
+    }
+    }
+    return n;
+}
+
+VAStatus vaSetDPBReferences(
+    VADecodeDPB dpb,
+    const void *pic_param
+)
+{
+    struct _VADecodeDPB *p = dpb;
+    VASurfaceID refs[16];
+    unsigned int i, j, num_refs;
+
+    if (!p || !pic_param)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (p->current == VA_INVALID_SURFACE)
+        return VA_STATUS_ERROR_OPERATION_FAILED;
+    if (p->codec == VA_DPB_CODEC_ANCHORS || p->codec == VA_DPB_CODEC_JPEG)
+        return VA_STATUS_SUCCESS;
+
+    num_refs = va_DPBListReferences(p->codec, pic_param, refs);
+    for (i = 0; i < p->num_entries; i++) {
+        va_dpb_entry *e = &p->entries[i];
+
+        if (!e->ref)
+            continue;
+        for (j = 0; j < num_refs; j++) {
+            if (refs[j] == e->surface && refs[j] != VA_INVALID_SURFACE)
+                break;
+        }
+        if (j == num_refs)
+            va_DPBUnref(p, e);
+    }
+    va_DPBCompact(p);
+    return VA_STATUS_SUCCESS;
+}
+
+/* FrameNumWrap, which is also PicNum for frames (8.2.4.1) */
+static int32_t va_DPBFrameNumWrapH264(
+    const struct _VADecodeDPB *p,
+    const va_dpb_entry *e,
+    uint32_t frame_num
+)
+{
+    if (e->frame_num > frame_num)
+        return (int32_t)e->frame_num - (1 << p->h264.log2_max_frame_num);
+    return (int32_t)e->frame_num;
+}
+
+static va_dpb_entry *va_DPBFindShortTermH264(
+    struct _VADecodeDPB *p,
+    int32_t pic_num,
+    uint32_t frame_num
+)
+{
+    unsigned int i;
+
+    for (i = 0; i < p->num_entries; i++) {
+        va_dpb_entry *e = &p->entries[i];
+
+        if (e->ref == VA_DPB_SHORT_TERM && va_DPBFrameNumWrapH264(p, e, frame_num) == pic_num)
+            return e;
+    }
+    return NULL;
+}
+
+/* drops the long-term frames using a LongTermFrameIdx from min_idx on, or min_idx only */
+static void va_DPBUnrefLongTermH264(
+    struct _VADecodeDPB *p,
+    uint32_t min_idx,
+    int above,
+    const va_dpb_entry *keep
+)
+{
+    unsigned int i;
+
+    for (i = 0; i < p->num_entries; i++) {
+        va_dpb_entry *e = &p->entries[i];
+
+        if (e != keep && e->ref == VA_DPB_LONG_TERM &&
+            (e->long_term_frame_idx == min_idx || (above && e->long_term_frame_idx > min_idx)))
+            va_DPBUnref(p, e);
+    }
+}
+
+/*
+ * Sliding window marking (8.2.5.3): drops the short-term frames with the
+ * smallest FrameNumWrap until at most max_refs frames are left.
+ */
+static void va_DPBSlidingWindowH264(
+    struct _VADecodeDPB *p,
+    uint32_t frame_num,
+    unsigned int max_refs
+)
+{
+    for (;;) {
+        va_dpb_entry *oldest = NULL;
+        unsigned int i, num_refs = 0;
+
+        for (i = 0; i < p->num_entries; i++) {
+            va_dpb_entry *e = &p->entries[i];
+
+            if (!e->ref)
+                continue;
+            num_refs++;
+            if (e->ref == VA_DPB_SHORT_TERM &&
+                (!oldest || va_DPBFrameNumWrapH264(p, e, frame_num) <
+                 va_DPBFrameNumWrapH264(p, oldest, frame_num)))
+                oldest = e;
+        }
+        if (num_refs <= max_refs || !oldest)
+            break;
+        va_DPBUnref(p, oldest);
+    }
+    va_DPBCompact(p);
+}
+
+static unsigned int va_DPBMaxRefsH264(const struct _VADecodeDPB *p)
+{
+    unsigned int max_refs = p->h264.max_num_ref_frames;
+
+    return max_refs < 1 ? 1 : max_refs > VA_DPB_MAX_FRAMES ? VA_DPB_MAX_FRAMES : max_refs;
+}
+
+static void va_DPBFillPictureH264(
+    VAPictureH264 *pic,
+    VASurfaceID surface,
+    uint32_t frame_idx,
+    uint32_t flags,
+    int32_t top_poc,
+    int32_t bottom_poc
+)
+{
+    pic->picture_id = surface;
+    pic->frame_idx = frame_idx;
+    pic->flags = flags;
+    pic->TopFieldOrderCnt = top_poc;
+    pic->BottomFieldOrderCnt = bottom_poc;
+}
+
+VAStatus vaSetDPBPictureH264(
+    VADecodeDPB dpb,
+    const VADecodeDPBPictureH264 *picture,
+    VAPictureParameterBufferH264 *pic_param
+)
+{
+    struct _VADecodeDPB *p = dpb;
+    uint32_t max_frame_num, frame_num;
+    unsigned int i, n = 0;
+
+    if (!p || !picture || !pic_param)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (p->codec != VA_DPB_CODEC_H264)
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+    if (p->current == VA_INVALID_SURFACE)
+        return VA_STATUS_ERROR_OPERATION_FAILED;
+    if (picture->log2_max_frame_num < 4 || picture->log2_max_frame_num > 16 ||
+        picture->num_marking_ops > VA_DPB_MAX_MARKING_OPS_H264)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    max_frame_num = 1U << picture->log2_max_frame_num;
+    if (picture->frame_num >= max_frame_num)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    for (i = 0; i < picture->num_marking_ops; i++) {
+        if (picture->marking_ops[i].memory_management_control_operation > 6)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+
+    p->h264 = *picture;
+    p->h264_valid = 1;
+
+    if (picture->idr) {
+        for (i = 0; i < p->num_entries; i++)
+            va_DPBUnref(p, &p->entries[i]);
+        va_DPBCompact(p);
+    } else if (picture->frame_num != p->prev_ref_frame_num &&
+               picture->frame_num != (p->prev_ref_frame_num + 1) % max_frame_num) {
+        /* gaps in frame_num (8.2.5.2): frames without content take the missing numbers */
+        for (frame_num = (p->prev_ref_frame_num + 1) % max_frame_num;
+             frame_num != picture->frame_num;
+             frame_num = (frame_num + 1) % max_frame_num) {
+            va_dpb_entry *e;
+
+            va_DPBSlidingWindowH264(p, frame_num, va_DPBMaxRefsH264(p) - 1);
+            if (p->num_entries == VA_DPB_MAX_ENTRIES)
+                return VA_STATUS_ERROR_MAX_NUM_EXCEEDED;
+            e = &p->entries[p->num_entries++];
+            memset(e, 0, sizeof(*e));
+            e->surface = VA_INVALID_SURFACE;
+            e->ref = VA_DPB_SHORT_TERM;
+            e->frame_num = frame_num;
+            p->prev_ref_frame_num = frame_num;
+        }
+    }
+
+    va_DPBFillPictureH264(&pic_param->CurrPic, p->current, picture->frame_num, 0,
+                          picture->top_field_order_cnt, picture->bottom_field_order_cnt);
+    for (i = 0; i < p->num_entries; i++) {
+        const va_dpb_entry *e = &p->entries[i];
+
+        /* only broken streams keep more than 16 long-term frames */
+        if (!e->ref || e->surface == VA_INVALID_SURFACE || n == 16)
+            continue;
+        if (e->ref == VA_DPB_LONG_TERM)
+            va_DPBFillPictureH264(&pic_param->ReferenceFrames[n++], e->surface,
+                                  e->long_term_frame_idx, VA_PICTURE_H264_LONG_TERM_REFERENCE,
+                                  e->top_poc, e->bottom_poc);
+        else
+            va_DPBFillPictureH264(&pic_param->ReferenceFrames[n++], e->surface,
+                                  e->frame_num, VA_PICTURE_H264_SHORT_TERM_REFERENCE,
+                                  e->top_poc, e->bottom_poc);
+    }
+    for (; n < 16; n++)
+        va_DPBFillPictureH264(&pic_param->ReferenceFrames[n], VA_INVALID_SURFACE, 0,
+                              VA_PICTURE_H264_INVALID, 0, 0);
+    return VA_STATUS_SUCCESS;
+}
+
+/*
+ * Marking of the current reference picture (8.2.5.1): updates the
+ * references and fills the entry of the current picture. Returns whether
+ * memory_management_control_operation 5 was found.
+ */
+static int va_DPBMarkH264(struct _VADecodeDPB *p, va_dpb_entry *cur)
+{
+    const VADecodeDPBPictureH264 *h = &p->h264;
+    uint32_t frame_num = h->frame_num;
+    int mmco5 = 0;
+    unsigned int i;
+
+    cur->ref = VA_DPB_SHORT_TERM;
+    if (h->idr) {
+        if (h->long_term_reference_flag) {
+            cur->ref = VA_DPB_LONG_TERM;
+            cur->long_term_frame_idx = 0;
+        }
+    } else if (h->num_marking_ops) {
+        for (i = 0; i < h->num_marking_ops; i++) {
+            const VADPBMarkingOpH264 *op = &h->marking_ops[i];
+            int32_t pic_num = (int32_t)frame_num - (int32_t)op->difference_of_pic_nums_minus1 - 1;
+            va_dpb_entry *e;
+
+            switch (op->memory_management_control_operation) {
+            case 1:
+                e = va_DPBFindShortTermH264(p, pic_num, frame_num);
+                if (e)
+                    va_DPBUnref(p, e);
+                break;
+            case 2:
+                /* LongTermPicNum is LongTermFrameIdx for frames */
+                for (e = p->entries; e < p->entries + p->num_entries; e++) {
+                    if (e->ref == VA_DPB_LONG_TERM && e->long_term_frame_idx == op->long_term_pic_num)
+                        va_DPBUnref(p, e);
+                }
+                break;
+            case 3:
+                e = va_DPBFindShortTermH264(p, pic_num, frame_num);
+                if (e) {
+                    va_DPBUnrefLongTermH264(p, op->long_term_frame_idx, 0, e);
+                    e->ref = VA_DPB_LONG_TERM;
+                    e->long_term_frame_idx = op->long_term_frame_idx;
+                }
+                break;
+            case 4:
+                /* MaxLongTermFrameIdx = max_long_term_frame_idx_plus1 - 1 */
+                va_DPBUnrefLongTermH264(p, op->max_long_term_frame_idx_plus1, 1, NULL);
+                break;
+            case 5:
+                for (e = p->entries; e < p->entries + p->num_entries; e++)
+                    va_DPBUnref(p, e);
+                mmco5 = 1;
+                break;
+            case 6:
+                va_DPBUnrefLongTermH264(p, op->long_term_frame_idx, 0, NULL);
+                cur->ref = VA_DPB_LONG_TERM;
+                cur->long_term_frame_idx = op->long_term_frame_idx;
+                break;
+            }
+        }
+    }
+    /*
+     * Sliding window without marking operations; with them, the stream
+     * must not exceed max_num_ref_frames, which then only bounds broken
+     * streams.
+     */
+    if (!h->idr)
+        va_DPBSlidingWindowH264(p, frame_num, va_DPBMaxRefsH264(p) - 1);
+    va_DPBCompact(p);
+
+    if (mmco5) {
+        int32_t poc = h->top_field_order_cnt < h->bottom_field_order_cnt ?
+                      h->top_field_order_cnt : h->bottom_field_order_cnt;
+
+        frame_num = 0;
+        cur->top_poc -= poc;
+        cur->bottom_poc -= poc;
+        cur->poc = 0;
+    }
+    cur->frame_num = frame_num;
+    p->prev_ref_frame_num = frame_num;
+    return mmco5;
+}
+
+static VAStatus va_DPBHold(struct _VADecodeDPB *p, VASurfaceID surface)
+{
+    return vaAddRefPoolSurface(p->dpy, p->pool, surface);
+}
+
+VAStatus vaEndDPBPicture(
+    VADecodeDPB dpb,
+    const VADecodeDPBPicture *picture
+)
+{
+    struct _VADecodeDPB *p = dpb;
+    va_dpb_entry cur;
+    unsigned int i, max_reorder, max_frames;
+    int flush, no_output;
+    VAStatus status = VA_STATUS_SUCCESS;
+
+    if (!p || !picture)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (p->current == VA_INVALID_SURFACE)
+        return VA_STATUS_ERROR_OPERATION_FAILED;
+
+    memset(&cur, 0, sizeof(cur));
+    cur.surface = p->current;
+    cur.poc = picture->poc;
+    flush = picture->flush;
+    no_output = picture->no_output_of_prior_pics;
+
+    if (p->h264_valid) {
+        cur.top_poc = p->h264.top_field_order_cnt;
+        cur.bottom_poc = p->h264.bottom_field_order_cnt;
+        flush |= p->h264.idr;
+        if (picture->reference && va_DPBMarkH264(p, &cur)) {
+            /* memory_management_control_operation 5 acts as an IDR picture (C.4.4) */
+            flush = 1;
+        }
+    } else if (picture->reference) {
+        cur.ref = VA_DPB_SHORT_TERM;
+        if (p->codec == VA_DPB_CODEC_ANCHORS) {
+            /* the oldest of the previous two anchors is not needed any more */
+            unsigned int num_refs = 0;
+
+            for (i = p->num_entries; i-- > 0;) {
+                if (p->entries[i].ref && ++num_refs >= 2)
+                    va_DPBUnref(p, &p->entries[i]);
+            }
+        }
+    }
+
+    if (flush)
+        status = va_DPBFlushOutput(p, no_output);
+    if (status == VA_STATUS_SUCCESS && (cur.ref || picture->output)) {
+        if (p->num_entries == VA_DPB_MAX_ENTRIES) {
+            status = VA_STATUS_ERROR_MAX_NUM_EXCEEDED;
+        } else {
+            cur.pending = picture->output;
+            if (cur.ref)
+                va_DPBHold(p, cur.surface);
+            if (cur.pending)
+                va_DPBHold(p, cur.surface);
+            p->entries[p->num_entries++] = cur;
+        }
+    }
+    /* the surface is now only held by the DPB entry, if any */
+    va_DPBRelease(p, p->current);
+    p->current = VA_INVALID_SURFACE;
+    p->h264_valid = 0;
+
+    max_reorder = picture->max_num_reorder;
+    max_frames = picture->max_dec_frame_buffering ? picture->max_dec_frame_buffering : VA_DPB_MAX_FRAMES;
+    while (status == VA_STATUS_SUCCESS) {
+        unsigned int num_pending = 0;
+
+        for (i = 0; i < p->num_entries; i++)
+            num_pending += p->entries[i].pending;
+        /* C.4.5.3 and C.5.2.2: too many pictures waiting, or a full DPB */
+        if (!num_pending ||
+            ((max_reorder == 0xff || num_pending <= max_reorder) && p->num_entries <= max_frames))
+            break;
+        status = va_DPBBump(p);
+        va_DPBCompact(p);
+    }
+    va_DPBCompact(p);
+    return status;
+}
+
+VAStatus vaShowDPBSurface(
+    VADecodeDPB dpb,
+    VASurfaceID surface
+)
+{
+    struct _VADecodeDPB *p = dpb;
+    unsigned int i;
+    VAStatus status;
+
+    if (!p)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < p->num_entries; i++) {
+        if (p->entries[i].ref && p->entries[i].surface == surface)
+            break;
+    }
+    if (i == p->num_entries || surface == VA_INVALID_SURFACE)
+        return VA_STATUS_ERROR_INVALID_SURFACE;
+
+    status = va_DPBQueueOutput(p, surface);
+    if (status == VA_STATUS_SUCCESS)
+        va_DPBHold(p, surface);
+    return status;
+}
+
+VAStatus vaFlushDPB(VADecodeDPB dpb)
+{
+    struct _VADecodeDPB *p = dpb;
+    unsigned int i;
+
+    if (!p)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (p->current != VA_INVALID_SURFACE)
+        return VA_STATUS_ERROR_OPERATION_FAILED;
+
+    for (i = 0; i < p->num_entries; i++)
+        va_DPBUnref(p, &p->entries[i]);
+    p->prev_ref_frame_num = 0;
+    return va_DPBFlushOutput(p, 0);
+}
+
+VAStatus vaGetDPBOutput(
+    VADecodeDPB dpb,
+    VASurfaceID *surface
+)
+{
+    struct _VADecodeDPB *p = dpb;
+
+    if (!p || !surface)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    if (!p->num_output) {
+        *surface = VA_INVALID_SURFACE;
+        return VA_STATUS_SUCCESS;
+    }
+    *surface = p->output[p->output_head];
+    p->output_head = (p->output_head + 1) % VA_DPB_MAX_OUTPUT;
+    p->num_output--;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaReleaseDPBSurface(
+    VADecodeDPB dpb,
+    VASurfaceID surface
+)
+{
+    struct _VADecodeDPB *p = dpb;
+
+    if (!p)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    return vaReleasePoolSurfaces(p->dpy, p->pool, &surface, 1);
+}
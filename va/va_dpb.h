@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_dpb.h
+ * \brief Decoded picture buffer management for decode
+ *
+ * Tracks which decoded surfaces are still needed, as reference frames or
+ * because they have not been output yet, so that each surface goes back
+ * to the surface pool of va_pool.h as soon as it is neither. A stream
+ * then only uses as many surfaces as its DPB actually holds, instead of
+ * the worst case number that clients usually allocate up front.
+ *
+ * The DPB owns a surface pool. The render targets of the pictures come
+ * from it, so the decode context should be created without render
+ * targets, or with an empty list where the driver requires one.
+ *
+ * Usage, for each picture:
+ * - vaBeginDPBPicture() returns the surface to decode into;
+ * - the reference frames are given with vaSetDPBReferences(), from the
+ *   picture parameters filled by the application or by the parsers of
+ *   va_parse_hevc.h, va_parse_vp9.h and va_parse_av1.h. For H.264, vaSetDPBPictureH264() instead performs the
+ *   reference picture marking and fills CurrPic and ReferenceFrames[];
+ * - after vaEndPicture(), vaEndDPBPicture() tells whether the picture is
+ *   a reference frame and when it is to be output;
+ * - vaGetDPBOutput() returns the pictures ready for output, in output
+ *   order. Each one is held until vaReleaseDPBSurface().
+ *
+ * vaFlushDPB() outputs the remaining pictures at the end of the stream.
+ */
+
+#ifndef _VA_DPB_H_
+#define _VA_DPB_H_
+
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_dpb Decoded picture buffer
+ *
+ * @{
+ */
+
+/** \brief Opaque decoded picture buffer. */
+typedef struct _VADecodeDPB *VADecodeDPB;
+
+/** \brief Output characteristics of a decoded picture. */
+typedef struct _VADecodeDPBPicture {
+    /**
+     * \brief Output order of the picture: PicOrderCnt for H.264,
+     * PicOrderCntVal for HEVC, the temporal reference for MPEG-2. It is
+     * only compared with those of the pictures since the last flush.
+     */
+    int32_t poc;
+    /**
+     * \brief The picture may be referenced by the following pictures.
+     * VP9 and AV1 frames can be marked as references whatever their
+     * refresh_frame_flags: the next vaSetDPBReferences() drops them when
+     * no reference frame slot kept them.
+     */
+    uint8_t reference;
+    /** \brief The picture is to be output (pic_output_flag, show_frame). */
+    uint8_t output;
+    /**
+     * \brief All the pictures decoded before this one are output first:
+     * IDR pictures and IRAP pictures with NoRaslOutputFlag set.
+     */
+    uint8_t flush;
+    /**
+     * \brief With \c flush, the pictures not output yet are discarded
+     * instead (no_output_of_prior_pics_flag).
+     */
+    uint8_t no_output_of_prior_pics;
+    /**
+     * \brief Maximum number of pictures that can precede a picture in
+     * decode order and follow it in output order: max_num_reorder_frames
+     * for H.264, sps_max_num_reorder_pics for HEVC, 0 for the codecs
+     * that output pictures in decode order. 0xff if unknown.
+     */
+    uint8_t max_num_reorder;
+    /**
+     * \brief Size of the DPB in frames, references and pictures waiting
+     * for output: max_dec_frame_buffering for H.264,
+     * sps_max_dec_pic_buffering_minus1 + 1 for HEVC. 0 if unknown.
+     */
+    uint8_t max_dec_frame_buffering;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VADecodeDPBPicture;
+
+/** \brief A memory_management_control_operation of an H.264 slice header. */
+typedef struct _VADPBMarkingOpH264 {
+    uint32_t memory_management_control_operation;
+    uint32_t difference_of_pic_nums_minus1;
+    uint32_t long_term_pic_num;
+    uint32_t long_term_frame_idx;
+    uint32_t max_long_term_frame_idx_plus1;
+} VADPBMarkingOpH264;
+
+/** \brief Maximum number of marking operations of an H.264 picture. */
+#define VA_DPB_MAX_MARKING_OPS_H264     32
+
+/** \brief Reference picture marking syntax of an H.264 picture. */
+typedef struct _VADecodeDPBPictureH264 {
+    /** \brief frame_num of the picture. */
+    uint32_t frame_num;
+    /** \brief log2_max_frame_num_minus4 + 4. */
+    uint8_t log2_max_frame_num;
+    /** \brief max_num_ref_frames of the sequence parameter set. */
+    uint8_t max_num_ref_frames;
+    /** \brief The picture is an IDR picture. */
+    uint8_t idr;
+    /** \brief long_term_reference_flag of an IDR picture. */
+    uint8_t long_term_reference_flag;
+    /** \brief TopFieldOrderCnt of the picture. */
+    int32_t top_field_order_cnt;
+    /** \brief BottomFieldOrderCnt of the picture. */
+    int32_t bottom_field_order_cnt;
+    /**
+     * \brief Number of marking operations, 0 when
+     * adaptive_ref_pic_marking_mode_flag is not set.
+     */
+    uint32_t num_marking_ops;
+    /** \brief Marking operations, in bitstream order. */
+    VADPBMarkingOpH264 marking_ops[VA_DPB_MAX_MARKING_OPS_H264];
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VADecodeDPBPictureH264;
+
+/**
+ * \brief Creates a decoded picture buffer.
+ *
+ * The surfaces are allocated with vaCreateSurfaces() arguments \c format,
+ * \c width, \c height and \c attrib_list. \c profile selects the picture
+ * parameters vaSetDPBReferences() reads.
+ */
+VAStatus vaCreateDecodeDPB(
+    VADisplay dpy,
+    VAProfile profile,
+    unsigned int format,
+    unsigned int width,
+    unsigned int height,
+    VASurfaceAttrib *attrib_list,
+    unsigned int num_attribs,
+    VADecodeDPB *dpb                /* out */
+);
+
+/**
+ * \brief Destroys a decoded picture buffer and its surfaces, including
+ * those returned by vaGetDPBOutput() and not released yet.
+ */
+VAStatus vaDestroyDecodeDPB(VADecodeDPB dpb);
+
+/** \brief Starts a picture and returns the surface to decode it into. */
+VAStatus vaBeginDPBPicture(
+    VADecodeDPB dpb,
+    VASurfaceID *surface            /* out */
+);
+
+/**
+ * \brief Updates the reference frames from the picture parameters.
+ *
+ * \c pic_param is the picture parameter buffer of the current picture
+ * for the profile of the DPB: ReferenceFrames[] for H.264 and HEVC,
+ * reference_frames[] for VP9, ref_frame_map[] for AV1, the last, golden
+ * and alternate references for VP8. The reference pictures of the DPB
+ * that it does not list are not references any more, so it must list
+ * all the pictures kept for reference, not only those the current
+ * picture uses.
+ *
+ * MPEG-2, MPEG-4 and VC-1 pictures only list the references they use;
+ * the DPB keeps the last two reference pictures for them instead and
+ * this call does nothing.
+ */
+VAStatus vaSetDPBReferences(
+    VADecodeDPB dpb,
+    const void *pic_param
+);
+
+/**
+ * \brief Performs the H.264 reference picture marking of the current
+ * picture and fills the references of its picture parameters.
+ *
+ * Fills \c CurrPic and \c ReferenceFrames[] of \c pic_param with the
+ * state of the DPB after the marking of the previous reference picture,
+ * including the frames inferred for gaps in frame_num. The marking of
+ * the current picture itself is applied by vaEndDPBPicture(), when it is
+ * a reference picture. IDR pictures and memory_management_control_operation
+ * 5 flush the DPB.
+ *
+ * Frame pictures are supported, progressive or MBAFF.
+ */
+VAStatus vaSetDPBPictureH264(
+    VADecodeDPB dpb,
+    const VADecodeDPBPictureH264 *picture,
+    VAPictureParameterBufferH264 *pic_param     /* in/out */
+);
+
+/**
+ * \brief Ends the current picture.
+ *
+ * Called once the picture has been submitted with vaEndPicture(). The
+ * picture is kept as a reference frame and queued for output as
+ * described by \c picture; pictures are moved to the output queue when
+ * max_num_reorder or max_dec_frame_buffering require it.
+ */
+VAStatus vaEndDPBPicture(
+    VADecodeDPB dpb,
+    const VADecodeDPBPicture *picture
+);
+
+/**
+ * \brief Queues a picture of the DPB for output again, for the
+ * show_existing_frame feature of VP9 and AV1.
+ */
+VAStatus vaShowDPBSurface(
+    VADecodeDPB dpb,
+    VASurfaceID surface
+);
+
+/**
+ * \brief Outputs all the pictures waiting for output and forgets the
+ * reference frames, at the end of the stream.
+ */
+VAStatus vaFlushDPB(VADecodeDPB dpb);
+
+/**
+ * \brief Returns the next picture to output.
+ *
+ * \c surface is VA_INVALID_SURFACE when no picture is ready. The surface
+ * is held, and its content preserved, until vaReleaseDPBSurface().
+ */
+VAStatus vaGetDPBOutput(
+    VADecodeDPB dpb,
+    VASurfaceID *surface            /* out */
+);
+
+/** \brief Releases a surface returned by vaGetDPBOutput(). */
+VAStatus vaReleaseDPBSurface(
+    VADecodeDPB dpb,
+    VASurfaceID surface
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_DPB_H_ */
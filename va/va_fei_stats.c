@@ -0,0 +1,869 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Frame level summaries of the H.264 statistics and FEI outputs.
+ *
+ * The per macroblock records are loaded four (SSE4.1, NEON) or eight
+ * (AVX2) at a time, four dwords of each, and transposed so that every
+ * vector holds one dword of consecutive macroblocks; the fields are then
+ * masked out and summed in their own vector. The kernels rely on the
+ * bit-field layout of GCC and Clang on little endian targets, which is
+ * the layout the drivers write. The records are summarized in chunks
+ * short enough for the sums of the 16 bit fields and of the flags to fit
+ * in 32 bit lanes; the full dword fields are summed in 64 bit lanes.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_fei_stats.h"
+#include "va_cpu.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VA_FEI_STATS_CHUNK          1024
+
+/* inter distortion of a missing reference, above any 16 bit distortion */
+#define VA_FEI_NO_INTER             0x10000
+
+/* record sizes, the vector kernels hard-code the dword offsets */
+#define VA_FEI_STATISTICS_SIZE      64
+#define VA_FEI_DISTORTION_SIZE      48
+#define VA_FEI_MV_SIZE              128
+#define VA_FEI_MB_CODE_SIZE         64
+
+struct va_fei_stats_funcs {
+    void (*statistics)(const uint8_t *p, unsigned int n, uint32_t no_past, uint32_t no_future,
+                       VAFEIFrameStatsH264 *s);
+    void (*distortion)(const uint8_t *p, unsigned int n, uint32_t no_inter, VAFEIFrameStatsH264 *s);
+    void (*mv)(const uint8_t *p, unsigned int n, VAFEIFrameStatsH264 *s);
+    void (*mb_code)(const uint8_t *p, unsigned int n, VAFEIFrameStatsH264 *s);
+};
+
+static inline uint32_t va_Min32(uint32_t a, uint32_t b)
+{
+    return a < b ? a : b;
+}
+
+static void statistics_c(const uint8_t *p, unsigned int n, uint32_t no_past, uint32_t no_future,
+                         VAFEIFrameStatsH264 *s)
+{
+    const VAStatsStatisticsH264 *r = (const VAStatsStatisticsH264 *)p;
+    unsigned int i;
+
+    for (i = 0; i < n; i++, r++) {
+        uint32_t intra = r->best_intra_distortion;
+        uint32_t inter = va_Min32(r->best_inter_distortion0 | no_past,
+                                  r->best_inter_distortion1 | no_future);
+
+        s->intra_distortion += intra;
+        s->inter_distortion += inter;
+        s->best_distortion += va_Min32(intra, inter);
+        s->num_intra_mbs += intra < inter;
+        s->num_flat_mbs += r->mb_is_flat;
+        s->variance += r->variance_16x16;
+        s->pixel_average += r->pixel_average_16x16;
+    }
+}
+
+static void distortion_c(const uint8_t *p, unsigned int n, uint32_t no_inter, VAFEIFrameStatsH264 *s)
+{
+    const VAEncFEIDistortionH264 *r = (const VAEncFEIDistortionH264 *)p;
+    unsigned int i;
+
+    for (i = 0; i < n; i++, r++) {
+        uint32_t intra = r->best_intra_distortion;
+        uint32_t inter = r->best_inter_distortion | no_inter;
+
+        s->intra_distortion += intra;
+        s->inter_distortion += inter;
+        s->best_distortion += va_Min32(intra, inter);
+        s->num_intra_mbs += intra < inter;
+        s->colocated_distortion += r->colocated_mb_distortion;
+    }
+}
+
+static void mv_c(const uint8_t *p, unsigned int n, VAFEIFrameStatsH264 *s)
+{
+    const VAMotionVector *mv = (const VAMotionVector *)p;
+    unsigned int i, l;
+
+    for (i = 0; i < 16 * n; i++) {
+        for (l = 0; l < 2; l++) {
+            const int16_t *v = l ? mv[i].mv1 : mv[i].mv0;
+
+            if (v[0] == INT16_MIN)
+                continue;
+            s->mv_abs_sum[l][0] += abs(v[0]);
+            s->mv_abs_sum[l][1] += abs(v[1]);
+            s->mv_sum[l][0] += v[0];
+            s->mv_sum[l][1] += v[1];
+            s->num_mv_blocks[l]++;
+        }
+    }
+}
+
+static void mb_code_c(const uint8_t *p, unsigned int n, VAFEIFrameStatsH264 *s)
+{
+    const VAEncFEIMBCodeH264 *r = (const VAEncFEIMBCodeH264 *)p;
+    unsigned int i;
+
+    for (i = 0; i < n; i++, r++) {
+        s->num_skip_mbs += r->mb_skip_flag;
+        s->num_intra_coded_mbs += r->intra_mb_flag;
+        s->qp_sum += r->qp_prime_y;
+    }
+}
+
+static const struct va_fei_stats_funcs va_fei_stats_c = {
+    statistics_c, distortion_c, mv_c, mb_code_c
+};
+
+/* adds the four 32 bit lanes of a vector */
+static inline uint64_t va_Sum4(const uint32_t *lanes)
+{
+    return (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+#if defined(VA_CPU_X86)
+/* dwords 0-3 of four records of stride bytes, transposed */
+VA_TARGET("sse4.1")
+static inline void columns_sse41(const uint8_t *r, size_t stride, __m128i c[4])
+{
+    __m128i a = _mm_loadu_si128((const __m128i *)r);
+    __m128i b = _mm_loadu_si128((const __m128i *)(r + stride));
+    __m128i d = _mm_loadu_si128((const __m128i *)(r + 2 * stride));
+    __m128i e = _mm_loadu_si128((const __m128i *)(r + 3 * stride));
+    __m128i t0 = _mm_unpacklo_epi32(a, b);
+    __m128i t1 = _mm_unpacklo_epi32(d, e);
+    __m128i t2 = _mm_unpackhi_epi32(a, b);
+    __m128i t3 = _mm_unpackhi_epi32(d, e);
+
+    c[0] = _mm_unpacklo_epi64(t0, t1);
+    c[1] = _mm_unpackhi_epi64(t0, t1);
+    c[2] = _mm_unpacklo_epi64(t2, t3);
+    c[3] = _mm_unpackhi_epi64(t2, t3);
+}
+
+VA_TARGET("sse4.1")
+static inline uint64_t sum_sse41(__m128i v)
+{
+    uint32_t lanes[4];
+
+    _mm_storeu_si128((__m128i *)lanes, v);
+    return va_Sum4(lanes);
+}
+
+VA_TARGET("sse4.1")
+static void statistics_sse41(const uint8_t *p, unsigned int n, uint32_t no_past, uint32_t no_future,
+                             VAFEIFrameStatsH264 *s)
+{
+    const __m128i lo16 = _mm_set1_epi32(0xffff);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i np = _mm_set1_epi32(no_past);
+    const __m128i nf = _mm_set1_epi32(no_future);
+    __m128i intra_sum = _mm_setzero_si128(), inter_sum = _mm_setzero_si128();
+    __m128i best_sum = _mm_setzero_si128(), num_intra = _mm_setzero_si128();
+    __m128i num_flat = _mm_setzero_si128(), average = _mm_setzero_si128();
+    __m128i variance = _mm_setzero_si128();
+    __m128i c[4];
+    uint64_t lanes[4];
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        const uint8_t *r = p + VA_FEI_STATISTICS_SIZE * i;
+        __m128i intra, inter;
+
+        /* DW 0-3: best_inter_distortion0/1, best_intra_distortion */
+        columns_sse41(r, VA_FEI_STATISTICS_SIZE, c);
+        intra = _mm_and_si128(c[2], lo16);
+        inter = _mm_min_epu32(_mm_or_si128(_mm_and_si128(c[0], lo16), np),
+                              _mm_or_si128(_mm_and_si128(c[1], lo16), nf));
+        intra_sum = _mm_add_epi32(intra_sum, intra);
+        inter_sum = _mm_add_epi32(inter_sum, inter);
+        best_sum = _mm_add_epi32(best_sum, _mm_min_epu32(intra, inter));
+        num_intra = _mm_sub_epi32(num_intra, _mm_cmpgt_epi32(inter, intra));
+
+        /* DW 4-7: mb_is_flat, variance_16x16 */
+        columns_sse41(r + 16, VA_FEI_STATISTICS_SIZE, c);
+        num_flat = _mm_add_epi32(num_flat, _mm_and_si128(c[1], one));
+        variance = _mm_add_epi64(variance, _mm_cvtepu32_epi64(c[2]));
+        variance = _mm_add_epi64(variance, _mm_cvtepu32_epi64(_mm_srli_si128(c[2], 8)));
+
+        /* DW 8-11: pixel_average_16x16 */
+        columns_sse41(r + 32, VA_FEI_STATISTICS_SIZE, c);
+        average = _mm_add_epi64(average, _mm_cvtepu32_epi64(c[3]));
+        average = _mm_add_epi64(average, _mm_cvtepu32_epi64(_mm_srli_si128(c[3], 8)));
+    }
+
+    s->intra_distortion += sum_sse41(intra_sum);
+    s->inter_distortion += sum_sse41(inter_sum);
+    s->best_distortion += sum_sse41(best_sum);
+    s->num_intra_mbs += sum_sse41(num_intra);
+    s->num_flat_mbs += sum_sse41(num_flat);
+    _mm_storeu_si128((__m128i *)lanes, average);
+    _mm_storeu_si128((__m128i *)lanes + 1, variance);
+    s->pixel_average += lanes[0] + lanes[1];
+    s->variance += lanes[2] + lanes[3];
+
+    statistics_c(p + VA_FEI_STATISTICS_SIZE * i, n - i, no_past, no_future, s);
+}
+
+VA_TARGET("sse4.1")
+static void distortion_sse41(const uint8_t *p, unsigned int n, uint32_t no_inter, VAFEIFrameStatsH264 *s)
+{
+    const __m128i lo16 = _mm_set1_epi32(0xffff);
+    const __m128i ni = _mm_set1_epi32(no_inter);
+    __m128i intra_sum = _mm_setzero_si128(), inter_sum = _mm_setzero_si128();
+    __m128i best_sum = _mm_setzero_si128(), num_intra = _mm_setzero_si128();
+    __m128i colocated = _mm_setzero_si128();
+    __m128i c[4];
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        /* DW 8: best_inter_distortion, best_intra_distortion, DW 9: colocated_mb_distortion */
+        __m128i intra, inter;
+
+        columns_sse41(p + VA_FEI_DISTORTION_SIZE * i + 32, VA_FEI_DISTORTION_SIZE, c);
+        intra = _mm_srli_epi32(c[0], 16);
+        inter = _mm_or_si128(_mm_and_si128(c[0], lo16), ni);
+        intra_sum = _mm_add_epi32(intra_sum, intra);
+        inter_sum = _mm_add_epi32(inter_sum, inter);
+        best_sum = _mm_add_epi32(best_sum, _mm_min_epu32(intra, inter));
+        num_intra = _mm_sub_epi32(num_intra, _mm_cmpgt_epi32(inter, intra));
+        colocated = _mm_add_epi32(colocated, _mm_and_si128(c[1], lo16));
+    }
+
+    s->intra_distortion += sum_sse41(intra_sum);
+    s->inter_distortion += sum_sse41(inter_sum);
+    s->best_distortion += sum_sse41(best_sum);
+    s->num_intra_mbs += sum_sse41(num_intra);
+    s->colocated_distortion += sum_sse41(colocated);
+
+    distortion_c(p + VA_FEI_DISTORTION_SIZE * i, n - i, no_inter, s);
+}
+
+/*
+ * Folds the lanes of the motion vector sums: the 32 bit lanes alternate
+ * between the past and future reference of consecutive 4x4 blocks.
+ */
+static void va_FoldMVSums(const uint32_t *abs_x, const uint32_t *abs_y,
+                          const int32_t *sum_x, const int32_t *sum_y,
+                          const uint32_t *num_intra, unsigned int num_lanes,
+                          unsigned int num_blocks, VAFEIFrameStatsH264 *s)
+{
+    unsigned int i;
+
+    for (i = 0; i < num_lanes; i++) {
+        unsigned int l = i & 1;
+
+        s->mv_abs_sum[l][0] += abs_x[i];
+        s->mv_abs_sum[l][1] += abs_y[i];
+        s->mv_sum[l][0] += sum_x[i];
+        s->mv_sum[l][1] += sum_y[i];
+        s->num_mv_blocks[l] -= num_intra[i];
+    }
+    s->num_mv_blocks[0] += num_blocks;
+    s->num_mv_blocks[1] += num_blocks;
+}
+
+VA_TARGET("sse4.1")
+static void mv_sse41(const uint8_t *p, unsigned int n, VAFEIFrameStatsH264 *s)
+{
+    const __m128i intra_mv = _mm_set1_epi16(INT16_MIN);
+    const __m128i x_lanes = _mm_set1_epi32(0x0000ffff);
+    const __m128i wx = _mm_set1_epi32(0x00000001);
+    const __m128i wy = _mm_set1_epi32(0x00010000);
+    __m128i abs_x = _mm_setzero_si128(), abs_y = _mm_setzero_si128();
+    __m128i sum_x = _mm_setzero_si128(), sum_y = _mm_setzero_si128();
+    __m128i num_intra = _mm_setzero_si128();
+    uint32_t lanes[5][4];
+    size_t i;
+
+    for (i = 0; i < (size_t)VA_FEI_MV_SIZE * n; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i intra = _mm_and_si128(_mm_cmpeq_epi16(v, intra_mv), x_lanes);
+        __m128i a;
+
+        /* intra blocks are flagged by the horizontal component, clear both */
+        intra = _mm_or_si128(intra, _mm_slli_epi32(intra, 16));
+        v = _mm_andnot_si128(intra, v);
+        /* |-32768| is 0x8000, zero extended rather than multiplied by madd */
+        a = _mm_abs_epi16(v);
+        abs_x = _mm_add_epi32(abs_x, _mm_and_si128(a, x_lanes));
+        abs_y = _mm_add_epi32(abs_y, _mm_srli_epi32(a, 16));
+        sum_x = _mm_add_epi32(sum_x, _mm_madd_epi16(v, wx));
+        sum_y = _mm_add_epi32(sum_y, _mm_madd_epi16(v, wy));
+        num_intra = _mm_sub_epi32(num_intra, _mm_madd_epi16(intra, wx));
+    }
+
+    _mm_storeu_si128((__m128i *)lanes[0], abs_x);
+    _mm_storeu_si128((__m128i *)lanes[1], abs_y);
+    _mm_storeu_si128((__m128i *)lanes[2], sum_x);
+    _mm_storeu_si128((__m128i *)lanes[3], sum_y);
+    _mm_storeu_si128((__m128i *)lanes[4], num_intra);
+    va_FoldMVSums(lanes[0], lanes[1], (const int32_t *)lanes[2], (const int32_t *)lanes[3],
+                  lanes[4], 4, 16 * n, s);
+}
+
+VA_TARGET("sse4.1")
+static void mb_code_sse41(const uint8_t *p, unsigned int n, VAFEIFrameStatsH264 *s)
+{
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i lo8 = _mm_set1_epi32(0xff);
+    __m128i num_skip = _mm_setzero_si128(), num_intra = _mm_setzero_si128();
+    __m128i qp = _mm_setzero_si128();
+    __m128i c[4];
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        const uint8_t *r = p + VA_FEI_MB_CODE_SIZE * i;
+
+        /* DW 3: mb_skip_flag (bit 2), intra_mb_flag (bit 13) */
+        columns_sse41(r, VA_FEI_MB_CODE_SIZE, c);
+        num_skip = _mm_add_epi32(num_skip, _mm_and_si128(_mm_srli_epi32(c[3], 2), one));
+        num_intra = _mm_add_epi32(num_intra, _mm_and_si128(_mm_srli_epi32(c[3], 13), one));
+
+        /* DW 6: qp_prime_y */
+        columns_sse41(r + 16, VA_FEI_MB_CODE_SIZE, c);
+        qp = _mm_add_epi32(qp, _mm_and_si128(c[2], lo8));
+    }
+
+    s->num_skip_mbs += sum_sse41(num_skip);
+    s->num_intra_coded_mbs += sum_sse41(num_intra);
+    s->qp_sum += sum_sse41(qp);
+
+    mb_code_c(p + VA_FEI_MB_CODE_SIZE * i, n - i, s);
+}
+
+static const struct va_fei_stats_funcs va_fei_stats_sse41 = {
+    statistics_sse41, distortion_sse41, mv_sse41, mb_code_sse41
+};
+
+/* dwords 0-3 of eight records of stride bytes, transposed */
+VA_TARGET("avx2")
+static inline void columns_avx2(const uint8_t *r, size_t stride, __m256i c[4])
+{
+#define LOAD2(i) _mm256_inserti128_si256(                                           \
+        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(r + (i) * stride))), \
+        _mm_loadu_si128((const __m128i *)(r + ((i) + 4) * stride)), 1)
+    __m256i a = LOAD2(0);
+    __m256i b = LOAD2(1);
+    __m256i d = LOAD2(2);
+    __m256i e = LOAD2(3);
+#undef LOAD2
+    __m256i t0 = _mm256_unpacklo_epi32(a, b);
+    __m256i t1 = _mm256_unpacklo_epi32(d, e);
+    __m256i t2 = _mm256_unpackhi_epi32(a, b);
+    __m256i t3 = _mm256_unpackhi_epi32(d, e);
+
+    c[0] = _mm256_unpacklo_epi64(t0, t1);
+    c[1] = _mm256_unpackhi_epi64(t0, t1);
+    c[2] = _mm256_unpacklo_epi64(t2, t3);
+    c[3] = _mm256_unpackhi_epi64(t2, t3);
+}
+
+VA_TARGET("avx2")
+static inline uint64_t sum_avx2(__m256i v)
+{
+    uint32_t lanes[8];
+
+    _mm256_storeu_si256((__m256i *)lanes, v);
+    return va_Sum4(lanes) + va_Sum4(lanes + 4);
+}
+
+VA_TARGET("avx2")
+static void statistics_avx2(const uint8_t *p, unsigned int n, uint32_t no_past, uint32_t no_future,
+                            VAFEIFrameStatsH264 *s)
+{
+    const __m256i lo16 = _mm256_set1_epi32(0xffff);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i np = _mm256_set1_epi32(no_past);
+    const __m256i nf = _mm256_set1_epi32(no_future);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i intra_sum = zero, inter_sum = zero, best_sum = zero, num_intra = zero;
+    __m256i num_flat = zero, average = zero, variance = zero;
+    __m256i c[4];
+    uint64_t lanes[8];
+    unsigned int i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        const uint8_t *r = p + VA_FEI_STATISTICS_SIZE * i;
+        __m256i intra, inter;
+
+        /* DW 0-3: best_inter_distortion0/1, best_intra_distortion */
+        columns_avx2(r, VA_FEI_STATISTICS_SIZE, c);
+        intra = _mm256_and_si256(c[2], lo16);
+        inter = _mm256_min_epu32(_mm256_or_si256(_mm256_and_si256(c[0], lo16), np),
+                                 _mm256_or_si256(_mm256_and_si256(c[1], lo16), nf));
+        intra_sum = _mm256_add_epi32(intra_sum, intra);
+        inter_sum = _mm256_add_epi32(inter_sum, inter);
+        best_sum = _mm256_add_epi32(best_sum, _mm256_min_epu32(intra, inter));
+        num_intra = _mm256_sub_epi32(num_intra, _mm256_cmpgt_epi32(inter, intra));
+
+        /* DW 4-7: mb_is_flat, variance_16x16 */
+        columns_avx2(r + 16, VA_FEI_STATISTICS_SIZE, c);
+        num_flat = _mm256_add_epi32(num_flat, _mm256_and_si256(c[1], one));
+        variance = _mm256_add_epi64(variance, _mm256_unpacklo_epi32(c[2], zero));
+        variance = _mm256_add_epi64(variance, _mm256_unpackhi_epi32(c[2], zero));
+
+        /* DW 8-11: pixel_average_16x16 */
+        columns_avx2(r + 32, VA_FEI_STATISTICS_SIZE, c);
+        average = _mm256_add_epi64(average, _mm256_unpacklo_epi32(c[3], zero));
+        average = _mm256_add_epi64(average, _mm256_unpackhi_epi32(c[3], zero));
+    }
+
+    s->intra_distortion += sum_avx2(intra_sum);
+    s->inter_distortion += sum_avx2(inter_sum);
+    s->best_distortion += sum_avx2(best_sum);
+    s->num_intra_mbs += sum_avx2(num_intra);
+    s->num_flat_mbs += sum_avx2(num_flat);
+    _mm256_storeu_si256((__m256i *)lanes, average);
+    _mm256_storeu_si256((__m256i *)lanes + 1, variance);
+    s->pixel_average += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    s->variance += lanes[4] + lanes[5] + lanes[6] + lanes[7];
+
+    statistics_sse41(p + VA_FEI_STATISTICS_SIZE * i, n - i, no_past, no_future, s);
+}
+
+VA_TARGET("avx2")
+static void distortion_avx2(const uint8_t *p, unsigned int n, uint32_t no_inter, VAFEIFrameStatsH264 *s)
+{
+    const __m256i lo16 = _mm256_set1_epi32(0xffff);
+    const __m256i ni = _mm256_set1_epi32(no_inter);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i intra_sum = zero, inter_sum = zero, best_sum = zero, num_intra = zero;
+    __m256i colocated = zero;
+    __m256i c[4];
+    unsigned int i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        /* DW 8: best_inter_distortion, best_intra_distortion, DW 9: colocated_mb_distortion */
+        __m256i intra, inter;
+
+        columns_avx2(p + VA_FEI_DISTORTION_SIZE * i + 32, VA_FEI_DISTORTION_SIZE, c);
+        intra = _mm256_srli_epi32(c[0], 16);
+        inter = _mm256_or_si256(_mm256_and_si256(c[0], lo16), ni);
+        intra_sum = _mm256_add_epi32(intra_sum, intra);
+        inter_sum = _mm256_add_epi32(inter_sum, inter);
+        best_sum = _mm256_add_epi32(best_sum, _mm256_min_epu32(intra, inter));
+        num_intra = _mm256_sub_epi32(num_intra, _mm256_cmpgt_epi32(inter, intra));
+        colocated = _mm256_add_epi32(colocated, _mm256_and_si256(c[1], lo16));
+    }
+
+    s->intra_distortion += sum_avx2(intra_sum);
+    s->inter_distortion += sum_avx2(inter_sum);
+    s->best_distortion += sum_avx2(best_sum);
+    s->num_intra_mbs += sum_avx2(num_intra);
+    s->colocated_distortion += sum_avx2(colocated);
+
+    distortion_sse41(p + VA_FEI_DISTORTION_SIZE * i, n - i, no_inter, s);
+}
+
+VA_TARGET("avx2")
+static void mv_avx2(const uint8_t *p, unsigned int n, VAFEIFrameStatsH264 *s)
+{
+    const __m256i intra_mv = _mm256_set1_epi16(INT16_MIN);
+    const __m256i x_lanes = _mm256_set1_epi32(0x0000ffff);
+    const __m256i wx = _mm256_set1_epi32(0x00000001);
+    const __m256i wy = _mm256_set1_epi32(0x00010000);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i abs_x = zero, abs_y = zero, sum_x = zero, sum_y = zero, num_intra = zero;
+    uint32_t lanes[5][8];
+    size_t i;
+
+    for (i = 0; i < (size_t)VA_FEI_MV_SIZE * n; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i intra = _mm256_and_si256(_mm256_cmpeq_epi16(v, intra_mv), x_lanes);
+        __m256i a;
+
+        intra = _mm256_or_si256(intra, _mm256_slli_epi32(intra, 16));
+        v = _mm256_andnot_si256(intra, v);
+        a = _mm256_abs_epi16(v);
+        abs_x = _mm256_add_epi32(abs_x, _mm256_and_si256(a, x_lanes));
+        abs_y = _mm256_add_epi32(abs_y, _mm256_srli_epi32(a, 16));
+        sum_x = _mm256_add_epi32(sum_x, _mm256_madd_epi16(v, wx));
+        sum_y = _mm256_add_epi32(sum_y, _mm256_madd_epi16(v, wy));
+        num_intra = _mm256_sub_epi32(num_intra, _mm256_madd_epi16(intra, wx));
+    }
+
+    _mm256_storeu_si256((__m256i *)lanes[0], abs_x);
+    _mm256_storeu_si256((__m256i *)lanes[1], abs_y);
+    _mm256_storeu_si256((__m256i *)lanes[2], sum_x);
+    _mm256_storeu_si256((__m256i *)lanes[3], sum_y);
+    _mm256_storeu_si256((__m256i *)lanes[4], num_intra);
+    va_FoldMVSums(lanes[0], lanes[1], (const int32_t *)lanes[2], (const int32_t *)lanes[3],
+                  lanes[4], 8, 16 * n, s);
+}
+
+VA_TARGET("avx2")
+static void mb_code_avx2(const uint8_t *p, unsigned int n, VAFEIFrameStatsH264 *s)
+{
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i lo8 = _mm256_set1_epi32(0xff);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i num_skip = zero, num_intra = zero, qp = zero;
+    __m256i c[4];
+    unsigned int i;
+
+    for (i = 0; i + 8 <= n; i += 8) {
+        const uint8_t *r = p + VA_FEI_MB_CODE_SIZE * i;
+
+        /* DW 3: mb_skip_flag (bit 2), intra_mb_flag (bit 13) */
+        columns_avx2(r, VA_FEI_MB_CODE_SIZE, c);
+        num_skip = _mm256_add_epi32(num_skip, _mm256_and_si256(_mm256_srli_epi32(c[3], 2), one));
+        num_intra = _mm256_add_epi32(num_intra, _mm256_and_si256(_mm256_srli_epi32(c[3], 13), one));
+
+        /* DW 6: qp_prime_y */
+        columns_avx2(r + 16, VA_FEI_MB_CODE_SIZE, c);
+        qp = _mm256_add_epi32(qp, _mm256_and_si256(c[2], lo8));
+    }
+
+    s->num_skip_mbs += sum_avx2(num_skip);
+    s->num_intra_coded_mbs += sum_avx2(num_intra);
+    s->qp_sum += sum_avx2(qp);
+
+    mb_code_sse41(p + VA_FEI_MB_CODE_SIZE * i, n - i, s);
+}
+
+static const struct va_fei_stats_funcs va_fei_stats_avx2 = {
+    statistics_avx2, distortion_avx2, mv_avx2, mb_code_avx2
+};
+#endif
+
+#if defined(VA_CPU_NEON)
+/* dwords 0-3 of four records of stride bytes, transposed */
+static inline void columns_neon(const uint8_t *r, size_t stride, uint32x4_t c[4])
+{
+    uint32x4x2_t ab = vtrnq_u32(vld1q_u32((const uint32_t *)r),
+                                vld1q_u32((const uint32_t *)(r + stride)));
+    uint32x4x2_t de = vtrnq_u32(vld1q_u32((const uint32_t *)(r + 2 * stride)),
+                                vld1q_u32((const uint32_t *)(r + 3 * stride)));
+
+    c[0] = vcombine_u32(vget_low_u32(ab.val[0]), vget_low_u32(de.val[0]));
+    c[1] = vcombine_u32(vget_low_u32(ab.val[1]), vget_low_u32(de.val[1]));
+    c[2] = vcombine_u32(vget_high_u32(ab.val[0]), vget_high_u32(de.val[0]));
+    c[3] = vcombine_u32(vget_high_u32(ab.val[1]), vget_high_u32(de.val[1]));
+}
+
+static inline uint64_t sum_neon(uint32x4_t v)
+{
+    uint32_t lanes[4];
+
+    vst1q_u32(lanes, v);
+    return va_Sum4(lanes);
+}
+
+static void statistics_neon(const uint8_t *p, unsigned int n, uint32_t no_past, uint32_t no_future,
+                            VAFEIFrameStatsH264 *s)
+{
+    const uint32x4_t lo16 = vdupq_n_u32(0xffff);
+    const uint32x4_t one = vdupq_n_u32(1);
+    const uint32x4_t np = vdupq_n_u32(no_past);
+    const uint32x4_t nf = vdupq_n_u32(no_future);
+    uint32x4_t intra_sum = vdupq_n_u32(0), inter_sum = vdupq_n_u32(0);
+    uint32x4_t best_sum = vdupq_n_u32(0), num_intra = vdupq_n_u32(0);
+    uint32x4_t num_flat = vdupq_n_u32(0);
+    uint64x2_t average = vdupq_n_u64(0), variance = vdupq_n_u64(0);
+    uint32x4_t c[4];
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        const uint8_t *r = p + VA_FEI_STATISTICS_SIZE * i;
+        uint32x4_t intra, inter;
+
+        /* DW 0-3: best_inter_distortion0/1, best_intra_distortion */
+        columns_neon(r, VA_FEI_STATISTICS_SIZE, c);
+        intra = vandq_u32(c[2], lo16);
+        inter = vminq_u32(vorrq_u32(vandq_u32(c[0], lo16), np),
+                          vorrq_u32(vandq_u32(c[1], lo16), nf));
+        intra_sum = vaddq_u32(intra_sum, intra);
+        inter_sum = vaddq_u32(inter_sum, inter);
+        best_sum = vaddq_u32(best_sum, vminq_u32(intra, inter));
+        num_intra = vsubq_u32(num_intra, vcltq_u32(intra, inter));
+
+        /* DW 4-7: mb_is_flat, variance_16x16 */
+        columns_neon(r + 16, VA_FEI_STATISTICS_SIZE, c);
+        num_flat = vaddq_u32(num_flat, vandq_u32(c[1], one));
+        variance = vpadalq_u32(variance, c[2]);
+
+        /* DW 8-11: pixel_average_16x16 */
+        columns_neon(r + 32, VA_FEI_STATISTICS_SIZE, c);
+        average = vpadalq_u32(average, c[3]);
+    }
+
+    s->intra_distortion += sum_neon(intra_sum);
+    s->inter_distortion += sum_neon(inter_sum);
+    s->best_distortion += sum_neon(best_sum);
+    s->num_intra_mbs += sum_neon(num_intra);
+    s->num_flat_mbs += sum_neon(num_flat);
+    s->pixel_average += vgetq_lane_u64(average, 0) + vgetq_lane_u64(average, 1);
+    s->variance += vgetq_lane_u64(variance, 0) + vgetq_lane_u64(variance, 1);
+
+    statistics_c(p + VA_FEI_STATISTICS_SIZE * i, n - i, no_past, no_future, s);
+}
+
+static void distortion_neon(const uint8_t *p, unsigned int n, uint32_t no_inter, VAFEIFrameStatsH264 *s)
+{
+    const uint32x4_t lo16 = vdupq_n_u32(0xffff);
+    const uint32x4_t ni = vdupq_n_u32(no_inter);
+    uint32x4_t intra_sum = vdupq_n_u32(0), inter_sum = vdupq_n_u32(0);
+    uint32x4_t best_sum = vdupq_n_u32(0), num_intra = vdupq_n_u32(0);
+    uint32x4_t colocated = vdupq_n_u32(0);
+    uint32x4_t c[4];
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        /* DW 8: best_inter_distortion, best_intra_distortion, DW 9: colocated_mb_distortion */
+        uint32x4_t intra, inter;
+
+        columns_neon(p + VA_FEI_DISTORTION_SIZE * i + 32, VA_FEI_DISTORTION_SIZE, c);
+        intra = vshrq_n_u32(c[0], 16);
+        inter = vorrq_u32(vandq_u32(c[0], lo16), ni);
+        intra_sum = vaddq_u32(intra_sum, intra);
+        inter_sum = vaddq_u32(inter_sum, inter);
+        best_sum = vaddq_u32(best_sum, vminq_u32(intra, inter));
+        num_intra = vsubq_u32(num_intra, vcltq_u32(intra, inter));
+        colocated = vaddq_u32(colocated, vandq_u32(c[1], lo16));
+    }
+
+    s->intra_distortion += sum_neon(intra_sum);
+    s->inter_distortion += sum_neon(inter_sum);
+    s->best_distortion += sum_neon(best_sum);
+    s->num_intra_mbs += sum_neon(num_intra);
+    s->colocated_distortion += sum_neon(colocated);
+
+    distortion_c(p + VA_FEI_DISTORTION_SIZE * i, n - i, no_inter, s);
+}
+
+static void mv_neon(const uint8_t *p, unsigned int n, VAFEIFrameStatsH264 *s)
+{
+    const int16x8_t intra_mv = vdupq_n_s16(INT16_MIN);
+    uint32x4_t abs_sum[2][2];
+    int32x4_t sum[2][2];
+    uint16x8_t num_intra[2];
+    size_t i;
+    unsigned int l, k;
+
+    for (l = 0; l < 2; l++) {
+        num_intra[l] = vdupq_n_u16(0);
+        for (k = 0; k < 2; k++) {
+            abs_sum[l][k] = vdupq_n_u32(0);
+            sum[l][k] = vdupq_n_s32(0);
+        }
+    }
+
+    /* 8 VAMotionVector per iteration, split into mv0[0], mv0[1], mv1[0], mv1[1] */
+    for (i = 0; i < (size_t)VA_FEI_MV_SIZE * n; i += 64) {
+        int16x8x4_t v = vld4q_s16((const int16_t *)(p + i));
+
+        for (l = 0; l < 2; l++) {
+            uint16x8_t intra = vceqq_s16(v.val[2 * l], intra_mv);
+
+            num_intra[l] = vsubq_u16(num_intra[l], intra);
+            for (k = 0; k < 2; k++) {
+                int16x8_t m = vbicq_s16(v.val[2 * l + k], vreinterpretq_s16_u16(intra));
+
+                abs_sum[l][k] = vpadalq_u16(abs_sum[l][k], vreinterpretq_u16_s16(vabsq_s16(m)));
+                sum[l][k] = vpadalq_s16(sum[l][k], m);
+            }
+        }
+    }
+
+    for (l = 0; l < 2; l++) {
+        uint32_t lanes[4];
+        int32_t slanes[4];
+
+        for (k = 0; k < 2; k++) {
+            s->mv_abs_sum[l][k] += sum_neon(abs_sum[l][k]);
+            vst1q_s32(slanes, sum[l][k]);
+            s->mv_sum[l][k] += (int64_t)slanes[0] + slanes[1] + slanes[2] + slanes[3];
+        }
+        vst1q_u32(lanes, vpaddlq_u16(num_intra[l]));
+        s->num_mv_blocks[l] += 16 * n - va_Sum4(lanes);
+    }
+}
+
+static void mb_code_neon(const uint8_t *p, unsigned int n, VAFEIFrameStatsH264 *s)
+{
+    const uint32x4_t one = vdupq_n_u32(1);
+    const uint32x4_t lo8 = vdupq_n_u32(0xff);
+    uint32x4_t num_skip = vdupq_n_u32(0), num_intra = vdupq_n_u32(0), qp = vdupq_n_u32(0);
+    uint32x4_t c[4];
+    unsigned int i;
+
+    for (i = 0; i + 4 <= n; i += 4) {
+        const uint8_t *r = p + VA_FEI_MB_CODE_SIZE * i;
+
+        /* DW 3: mb_skip_flag (bit 2), intra_mb_flag (bit 13) */
+        columns_neon(r, VA_FEI_MB_CODE_SIZE, c);
+        num_skip = vaddq_u32(num_skip, vandq_u32(vshrq_n_u32(c[3], 2), one));
+        num_intra = vaddq_u32(num_intra, vandq_u32(vshrq_n_u32(c[3], 13), one));
+
+        /* DW 6: qp_prime_y */
+        columns_neon(r + 16, VA_FEI_MB_CODE_SIZE, c);
+        qp = vaddq_u32(qp, vandq_u32(c[2], lo8));
+    }
+
+    s->num_skip_mbs += sum_neon(num_skip);
+    s->num_intra_coded_mbs += sum_neon(num_intra);
+    s->qp_sum += sum_neon(qp);
+
+    mb_code_c(p + VA_FEI_MB_CODE_SIZE * i, n - i, s);
+}
+
+static const struct va_fei_stats_funcs va_fei_stats_neon = {
+    statistics_neon, distortion_neon, mv_neon, mb_code_neon
+};
+#endif
+
+static const struct va_fei_stats_funcs *va_GetFEIStatsFuncs(void)
+{
+    unsigned int cpu = va_CpuFeatures();
+
+#if defined(VA_CPU_X86)
+    if (cpu & VA_CPU_FLAG_AVX2)
+        return &va_fei_stats_avx2;
+    if (cpu & VA_CPU_FLAG_SSE41)
+        return &va_fei_stats_sse41;
+#elif defined(VA_CPU_NEON)
+    if (cpu & VA_CPU_FLAG_NEON)
+        return &va_fei_stats_neon;
+#else
+    (void)cpu;
+#endif
+    return &va_fei_stats_c;
+}
+
+VAStatus vaSummarizeFEIFrameStatsH264(
+    uint32_t num_mbs,
+    uint32_t flags,
+    const VAStatsStatisticsH264 *statistics,
+    const VAEncFEIDistortionH264 *distortion,
+    const VAMotionVector *mv,
+    const VAEncFEIMBCodeH264 *mb_code,
+    VAFEIFrameStatsH264 *stats
+)
+{
+    const struct va_fei_stats_funcs *funcs;
+    uint32_t no_past, no_future, i, n;
+
+    if (!stats || (statistics && distortion))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->num_mbs = num_mbs;
+    if (statistics)
+        stats->sources |= VA_FEI_FRAME_STATS_HAS_STATISTICS;
+    if (distortion)
+        stats->sources |= VA_FEI_FRAME_STATS_HAS_DISTORTION;
+    if (mv)
+        stats->sources |= VA_FEI_FRAME_STATS_HAS_MV;
+    if (mb_code)
+        stats->sources |= VA_FEI_FRAME_STATS_HAS_MB_CODE;
+
+    funcs = va_GetFEIStatsFuncs();
+    no_past = (flags & VA_FEI_FRAME_STATS_PAST_REFERENCE) ? 0 : VA_FEI_NO_INTER;
+    no_future = (flags & VA_FEI_FRAME_STATS_FUTURE_REFERENCE) ? 0 : VA_FEI_NO_INTER;
+
+    for (i = 0; i < num_mbs; i += n) {
+        n = va_Min32(num_mbs - i, VA_FEI_STATS_CHUNK);
+        if (statistics)
+            funcs->statistics((const uint8_t *)(statistics + i), n, no_past, no_future, stats);
+        if (distortion)
+            funcs->distortion((const uint8_t *)(distortion + i), n, no_past & no_future, stats);
+        if (mv)
+            funcs->mv((const uint8_t *)(mv + 16 * (size_t)i), n, stats);
+        if (mb_code)
+            funcs->mb_code((const uint8_t *)(mb_code + i), n, stats);
+    }
+
+    /* intra pictures: the kernels summed VA_FEI_NO_INTER */
+    if (no_past && no_future)
+        stats->inter_distortion = 0;
+
+    return VA_STATUS_SUCCESS;
+}
+
+/* fails if the driver reports a buffer smaller than size */
+static VAStatus va_FEIStatsCheckBuffer(VADriverContextP ctx, VABufferID buf_id, size_t size)
+{
+    VABufferType type;
+    unsigned int buf_size, num_elements;
+
+    if (!ctx->vtable->vaBufferInfo ||
+        ctx->vtable->vaBufferInfo(ctx, buf_id, &type, &buf_size, &num_elements) != VA_STATUS_SUCCESS)
+        return VA_STATUS_SUCCESS;
+
+    return (size_t)buf_size * num_elements < size ? VA_STATUS_ERROR_INVALID_PARAMETER : VA_STATUS_SUCCESS;
+}
+
+VAStatus vaGetFEIFrameStatsH264(
+    VADisplay dpy,
+    uint32_t num_mbs,
+    uint32_t flags,
+    VABufferID statistics,
+    VABufferID distortion,
+    VABufferID mv,
+    VABufferID mb_code,
+    VAFEIFrameStatsH264 *stats
+)
+{
+    static const size_t record_size[4] = {
+        VA_FEI_STATISTICS_SIZE, VA_FEI_DISTORTION_SIZE, VA_FEI_MV_SIZE, VA_FEI_MB_CODE_SIZE
+    };
+    const VABufferID buffers[4] = { statistics, distortion, mv, mb_code };
+    void *data[4] = { NULL, NULL, NULL, NULL };
+    VADriverContextP ctx;
+    VAStatus va_status = VA_STATUS_SUCCESS;
+    unsigned int i;
+
+    CHECK_DISPLAY(dpy);
+    ctx = CTX(dpy);
+
+    if (!stats || (statistics != VA_INVALID_ID && distortion != VA_INVALID_ID))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < 4 && va_status == VA_STATUS_SUCCESS; i++) {
+        if (buffers[i] == VA_INVALID_ID)
+            continue;
+        va_status = va_FEIStatsCheckBuffer(ctx, buffers[i], record_size[i] * num_mbs);
+        if (va_status == VA_STATUS_SUCCESS)
+            va_status = vaMapBuffer(dpy, buffers[i], &data[i]);
+    }
+
+    if (va_status == VA_STATUS_SUCCESS)
+        va_status = vaSummarizeFEIFrameStatsH264(num_mbs, flags, data[0], data[1], data[2], data[3], stats);
+
+    for (i = 0; i < 4; i++) {
+        if (data[i])
+            vaUnmapBuffer(dpy, buffers[i]);
+    }
+
+    return va_status;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_fei_stats.h
+ * \brief Frame level summaries of the H.264 statistics and FEI outputs
+ *
+ * VAEntrypointStats and the FEI ENC entrypoint return per macroblock
+ * records: VAStatsStatisticsH264 and VAEncFEIMBCodeH264 are 64 bytes per
+ * macroblock, VAEncFEIDistortionH264 48 bytes and the motion vectors 128
+ * bytes. Rate control and scene change detection usually only need a few
+ * sums over the frame, and walking these records field by field costs more
+ * than the encoding work they describe.
+ *
+ * The helpers in this file reduce the records of a frame into a
+ * VAFEIFrameStatsH264 with SIMD where available: the records are loaded
+ * four or eight at a time and transposed so that each field is summed
+ * in its own vector.
+ *
+ * For instance, the ratio of best_distortion to intra_distortion jumps
+ * from well below 1 to about 1 on the first frame of a new scene. Dividing
+ * best_distortion by num_mbs gives the usual complexity estimate for
+ * bit allocation.
+ */
+
+#ifndef _VA_FEI_STATS_H_
+#define _VA_FEI_STATS_H_
+
+#include <va/va.h>
+#include <va/va_fei_h264.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_fei_stats Frame statistics summaries
+ *
+ * @{
+ */
+
+/** \brief Frame level summary of the per macroblock statistics. */
+typedef struct _VAFEIFrameStatsH264 {
+    /** \brief Number of macroblocks summarized. */
+    uint32_t num_mbs;
+    /** \brief Buffers that contributed, combination of VA_FEI_FRAME_STATS_HAS_xxx. */
+    uint32_t sources;
+
+    /** \brief Sum of the best intra distortion of the macroblocks. */
+    uint64_t intra_distortion;
+    /**
+     * \brief Sum of the best inter distortion of the macroblocks.
+     *
+     * For VAStatsStatisticsH264, the lower of the distortions for the past
+     * and future references used. 0 if no reference was used.
+     */
+    uint64_t inter_distortion;
+    /** \brief Sum of the lower of the intra and inter distortion of each macroblock. */
+    uint64_t best_distortion;
+    /** \brief Sum of colocated_mb_distortion, VAEncFEIDistortionH264 only. */
+    uint64_t colocated_distortion;
+    /** \brief Macroblocks whose intra distortion is below their inter distortion. */
+    uint32_t num_intra_mbs;
+    /** \brief Macroblocks with mb_is_flat set, VAStatsStatisticsH264 only. */
+    uint32_t num_flat_mbs;
+    /** \brief Sum of variance_16x16, VAStatsStatisticsH264 only. */
+    uint64_t variance;
+    /** \brief Sum of pixel_average_16x16, VAStatsStatisticsH264 only. */
+    uint64_t pixel_average;
+
+    /**
+     * \brief Sums of the absolute motion vector components.
+     *
+     * Indexed by the reference list (0 for mv0, past reference, 1 for mv1,
+     * future reference) then by the component (0 horizontal, 1 vertical),
+     * in quarter pixels over the 16 4x4 blocks of each macroblock. The
+     * blocks flagged intra (0x8000) are not counted.
+     */
+    uint64_t mv_abs_sum[2][2];
+    /** \brief Sums of the motion vector components, same layout as \c mv_abs_sum. */
+    int64_t mv_sum[2][2];
+    /** \brief Number of 4x4 blocks counted in the sums above, per reference list. */
+    uint32_t num_mv_blocks[2];
+
+    /** \brief Macroblocks with mb_skip_flag set, VAEncFEIMBCodeH264 only. */
+    uint32_t num_skip_mbs;
+    /** \brief Macroblocks with intra_mb_flag set, VAEncFEIMBCodeH264 only. */
+    uint32_t num_intra_coded_mbs;
+    /** \brief Sum of qp_prime_y, VAEncFEIMBCodeH264 only. */
+    uint64_t qp_sum;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VAFEIFrameStatsH264;
+
+/** \brief \c sources bit: VAStatsStatisticsH264 records were summarized. */
+#define VA_FEI_FRAME_STATS_HAS_STATISTICS       0x00000001
+/** \brief \c sources bit: VAEncFEIDistortionH264 records were summarized. */
+#define VA_FEI_FRAME_STATS_HAS_DISTORTION       0x00000002
+/** \brief \c sources bit: motion vectors were summarized. */
+#define VA_FEI_FRAME_STATS_HAS_MV               0x00000004
+/** \brief \c sources bit: VAEncFEIMBCodeH264 records were summarized. */
+#define VA_FEI_FRAME_STATS_HAS_MB_CODE          0x00000008
+
+/**
+ * \brief The past reference distortion is valid.
+ *
+ * Without any VA_FEI_FRAME_STATS_xxx_REFERENCE flag, the inter distortions
+ * are ignored, as for an intra picture. For VAEncFEIDistortionH264, which
+ * has a single best_inter_distortion, any of the two flags validates it.
+ */
+#define VA_FEI_FRAME_STATS_PAST_REFERENCE       0x00000001
+/** \brief The future reference distortion is valid. */
+#define VA_FEI_FRAME_STATS_FUTURE_REFERENCE     0x00000002
+
+/**
+ * \brief Summarizes the statistics outputs of a frame in memory.
+ *
+ * Each of \c statistics, \c distortion, \c mv and \c mb_code may be NULL,
+ * the others hold \c num_mbs records in raster scan order. The motion
+ * vectors are 16 VAMotionVector per macroblock, laid out as described for
+ * VAEncFEIMVBufferType; the VAStatsMVBufferType output of
+ * VAEntrypointStats uses the same layout.
+ *
+ * @param[in] flags     combination of VA_FEI_FRAME_STATS_xxx_REFERENCE
+ * @param[out] stats    the summary, fields without source are 0
+ * @return VA_STATUS_ERROR_INVALID_PARAMETER if both \c statistics and
+ *         \c distortion are given
+ */
+VAStatus vaSummarizeFEIFrameStatsH264(
+    uint32_t num_mbs,
+    uint32_t flags,
+    const VAStatsStatisticsH264 *statistics,
+    const VAEncFEIDistortionH264 *distortion,
+    const VAMotionVector *mv,
+    const VAEncFEIMBCodeH264 *mb_code,
+    VAFEIFrameStatsH264 *stats      /* out */
+);
+
+/**
+ * \brief Summarizes the statistics output buffers of a frame.
+ *
+ * Maps the buffers, waiting for the statistics or ENC operation to
+ * complete, and calls vaSummarizeFEIFrameStatsH264() on them. Any buffer
+ * may be VA_INVALID_ID: \c statistics is a VAStatsStatisticsBufferType
+ * or VAStatsStatisticsBottomFieldBufferType buffer, \c distortion a
+ * VAEncFEIDistortionBufferType buffer, \c mv a VAStatsMVBufferType or
+ * VAEncFEIMVBufferType buffer and \c mb_code a VAEncFEIMBCodeBufferType
+ * buffer.
+ *
+ * @return VA_STATUS_ERROR_INVALID_PARAMETER if a buffer is smaller than
+ *         \c num_mbs records
+ */
+VAStatus vaGetFEIFrameStatsH264(
+    VADisplay dpy,
+    uint32_t num_mbs,
+    uint32_t flags,
+    VABufferID statistics,
+    VABufferID distortion,
+    VABufferID mv,
+    VABufferID mb_code,
+    VAFEIFrameStatsH264 *stats      /* out */
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_FEI_STATS_H_ */
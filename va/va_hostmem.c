@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE 1
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_hostmem.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define VA_HOSTMEM_DEFAULT_LOG2_ALIGN   4
+#define VA_HOSTMEM_PITCH_ALIGN          64
+#define VA_HOSTMEM_HUGE_PAGE_SIZE       (2 * 1024 * 1024)
+
+#define VA_ALIGN(x, a)  (((x) + (a) - 1) / (a) * (a))
+
+#ifndef MAP_POPULATE
+#define MAP_POPULATE    0
+#endif
+
+struct va_hostmem_surface {
+    VASurfaceID surface;
+    void *data;
+    size_t map_size;
+    VAHostSurfaceLayout layout;
+    struct va_hostmem_surface *next;
+};
+
+struct va_hostmem_context {
+    pthread_mutex_t lock;
+    struct va_hostmem_surface *surfaces;
+};
+
+static pthread_mutex_t va_hostmem_init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define DPY2HOSTMEM(dpy) \
+    ((struct va_hostmem_context *)__atomic_load_n(&((VADisplayContextP)dpy)->vahostmem, __ATOMIC_ACQUIRE))
+
+static struct va_hostmem_context *va_HostMemGetContext(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_hostmem_context *hc = DPY2HOSTMEM(dpy);
+
+    if (hc)
+        return hc;
+
+    pthread_mutex_lock(&va_hostmem_init_lock);
+    hc = pDisplayContext->vahostmem;
+    if (!hc) {
+        hc = calloc(1, sizeof(*hc));
+        if (hc) {
+            pthread_mutex_init(&hc->lock, NULL);
+            __atomic_store_n(&pDisplayContext->vahostmem, hc, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&va_hostmem_init_lock);
+
+    return hc;
+}
+
+VAStatus vaQueryHostSurfaceLayout(
+    VADisplay dpy,
+    VAConfigID config,
+    uint32_t fourcc,
+    uint32_t width,
+    uint32_t height,
+    VAHostSurfaceLayout *layout     /* out */
+)
+{
+    VASurfaceAttribAlignmentStruct alignment;
+    VASurfaceAttrib *attribs;
+    unsigned int i, num_attribs = 0, num_formats = 0, row_bytes[3], rows[3];
+    unsigned int x_align, y_align;
+    uint32_t mem_types = 0;
+    int format_found = 0;
+    uint64_t size = 0;
+    VAStatus va_status;
+
+    CHECK_DISPLAY(dpy);
+
+    if (!layout || !width || !height)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    va_status = vaQuerySurfaceAttributes(dpy, config, NULL, &num_attribs);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+    attribs = calloc(num_attribs ? num_attribs : 1, sizeof(*attribs));
+    if (!attribs)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    va_status = vaQuerySurfaceAttributes(dpy, config, attribs, &num_attribs);
+    if (va_status != VA_STATUS_SUCCESS) {
+        free(attribs);
+        return va_status;
+    }
+
+    alignment.value = 0;
+    alignment.bits.log2_x_alignment = VA_HOSTMEM_DEFAULT_LOG2_ALIGN;
+    alignment.bits.log2_y_alignment = VA_HOSTMEM_DEFAULT_LOG2_ALIGN;
+    for (i = 0; i < num_attribs; i++) {
+        int value = attribs[i].value.value.i;
+
+        switch (attribs[i].type) {
+        case VASurfaceAttribMemoryType:
+            mem_types = value;
+            break;
+        case VASurfaceAttribPixelFormat:
+            num_formats++;
+            if ((uint32_t)value == fourcc)
+                format_found = 1;
+            break;
+        case VASurfaceAttribMinWidth:
+            if (width < (uint32_t)value)
+                va_status = VA_STATUS_ERROR_RESOLUTION_NOT_SUPPORTED;
+            break;
+        case VASurfaceAttribMaxWidth:
+            if (width > (uint32_t)value)
+                va_status = VA_STATUS_ERROR_RESOLUTION_NOT_SUPPORTED;
+            break;
+        case VASurfaceAttribMinHeight:
+            if (height < (uint32_t)value)
+                va_status = VA_STATUS_ERROR_RESOLUTION_NOT_SUPPORTED;
+            break;
+        case VASurfaceAttribMaxHeight:
+            if (height > (uint32_t)value)
+                va_status = VA_STATUS_ERROR_RESOLUTION_NOT_SUPPORTED;
+            break;
+        case VASurfaceAttribAlignmentSize:
+            alignment.value = value;
+            break;
+        default:
+            break;
+        }
+    }
+    free(attribs);
+
+    if (!(mem_types & VA_SURFACE_ATTRIB_MEM_TYPE_USER_PTR))
+        return VA_STATUS_ERROR_UNSUPPORTED_MEMORY_TYPE;
+    /* drivers listing no pixel format at all do not restrict them */
+    if (num_formats && !format_found)
+        return VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    x_align = 1 << alignment.bits.log2_x_alignment;
+    y_align = 1 << alignment.bits.log2_y_alignment;
+
+    memset(layout, 0, sizeof(*layout));
+    layout->fourcc = fourcc;
+    layout->width = width;
+    layout->height = height;
+    layout->num_planes = va_ConvertPlaneGeometry(fourcc, VA_ALIGN(width, x_align),
+                         VA_ALIGN(height, y_align), row_bytes, rows);
+    if (!layout->num_planes)
+        return VA_STATUS_ERROR_INVALID_IMAGE_FORMAT;
+
+    for (i = 0; i < layout->num_planes; i++) {
+        layout->pitches[i] = VA_ALIGN(row_bytes[i], VA_HOSTMEM_PITCH_ALIGN);
+        layout->offsets[i] = (uint32_t)size;
+        size += (uint64_t)layout->pitches[i] * rows[i];
+    }
+    layout->alignment = sysconf(_SC_PAGESIZE);
+    size = VA_ALIGN(size, layout->alignment);
+    if (size > UINT32_MAX)
+        return VA_STATUS_ERROR_RESOLUTION_NOT_SUPPORTED;
+    layout->size = (uint32_t)size;
+
+    return VA_STATUS_SUCCESS;
+}
+
+static void *va_HostMemAlloc(size_t size, uint32_t flags, size_t *map_size)
+{
+    /* populated here, so that first touch places the pages on the node of the caller */
+    int map_flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE;
+    void *data = MAP_FAILED;
+
+    *map_size = size;
+    if (flags & VA_HOST_MEMORY_HUGE_PAGES) {
+        *map_size = VA_ALIGN(size, VA_HOSTMEM_HUGE_PAGE_SIZE);
+#ifdef MAP_HUGETLB
+        /* explicit huge pages if some are reserved, else transparent ones */
+        data = mmap(NULL, *map_size, PROT_READ | PROT_WRITE, map_flags | MAP_HUGETLB, -1, 0);
+#endif
+        if (data == MAP_FAILED) {
+#ifdef MADV_HUGEPAGE
+            data = mmap(NULL, *map_size, PROT_READ | PROT_WRITE, map_flags & ~MAP_POPULATE, -1, 0);
+            if (data != MAP_FAILED) {
+                madvise(data, *map_size, MADV_HUGEPAGE);
+                memset(data, 0, *map_size);
+            }
+#endif
+        }
+    }
+    if (data == MAP_FAILED) {
+        *map_size = size;
+        data = mmap(NULL, size, PROT_READ | PROT_WRITE, map_flags, -1, 0);
+    }
+    if (data == MAP_FAILED)
+        return NULL;
+
+    if (flags & VA_HOST_MEMORY_LOCKED)
+        mlock(data, *map_size);
+
+    return data;
+}
+
+VAStatus vaCreateHostSurfaces(
+    VADisplay dpy,
+    VAConfigID config,
+    uint32_t fourcc,
+    uint32_t width,
+    uint32_t height,
+    uint32_t flags,
+    VASurfaceID *surfaces,      /* out */
+    unsigned int num_surfaces
+)
+{
+    struct va_hostmem_context *hc;
+    VAHostSurfaceLayout layout;
+    VAStatus va_status;
+    unsigned int i;
+
+    CHECK_DISPLAY(dpy);
+
+    if (!surfaces || (flags & ~(VA_HOST_MEMORY_HUGE_PAGES | VA_HOST_MEMORY_LOCKED)))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    hc = va_HostMemGetContext(dpy);
+    if (!hc)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    va_status = vaQueryHostSurfaceLayout(dpy, config, fourcc, width, height, &layout);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    for (i = 0; i < num_surfaces; i++) {
+        struct va_hostmem_surface *hs = calloc(1, sizeof(*hs));
+        VASurfaceAttribExternalBuffers ext;
+        VASurfaceAttrib attribs[3];
+        uintptr_t buffer;
+
+        if (!hs) {
+            va_status = VA_STATUS_ERROR_ALLOCATION_FAILED;
+            break;
+        }
+        hs->layout = layout;
+        hs->data = va_HostMemAlloc(layout.size, flags, &hs->map_size);
+        if (!hs->data) {
+            free(hs);
+            va_status = VA_STATUS_ERROR_ALLOCATION_FAILED;
+            break;
+        }
+
+        memset(&ext, 0, sizeof(ext));
+        ext.pixel_format = fourcc;
+        ext.width = width;
+        ext.height = height;
+        ext.data_size = layout.size;
+        ext.num_planes = layout.num_planes;
+        memcpy(ext.pitches, layout.pitches, sizeof(layout.pitches));
+        memcpy(ext.offsets, layout.offsets, sizeof(layout.offsets));
+        buffer = (uintptr_t)hs->data;
+        ext.buffers = &buffer;
+        ext.num_buffers = 1;
+
+        memset(attribs, 0, sizeof(attribs));
+        attribs[0].type = VASurfaceAttribMemoryType;
+        attribs[0].flags = VA_SURFACE_ATTRIB_SETTABLE;
+        attribs[0].value.type = VAGenericValueTypeInteger;
+        attribs[0].value.value.i = VA_SURFACE_ATTRIB_MEM_TYPE_USER_PTR;
+        attribs[1].type = VASurfaceAttribExternalBufferDescriptor;
+        attribs[1].flags = VA_SURFACE_ATTRIB_SETTABLE;
+        attribs[1].value.type = VAGenericValueTypePointer;
+        attribs[1].value.value.p = &ext;
+        attribs[2].type = VASurfaceAttribPixelFormat;
+        attribs[2].flags = VA_SURFACE_ATTRIB_SETTABLE;
+        attribs[2].value.type = VAGenericValueTypeInteger;
+        attribs[2].value.value.i = fourcc;
+
+        va_status = vaCreateSurfaces(dpy, va_ConvertRTFormat(fourcc), width, height,
+                                     &surfaces[i], 1, attribs, 3);
+        if (va_status != VA_STATUS_SUCCESS) {
+            munmap(hs->data, hs->map_size);
+            free(hs);
+            break;
+        }
+
+        hs->surface = surfaces[i];
+        pthread_mutex_lock(&hc->lock);
+        hs->next = hc->surfaces;
+        hc->surfaces = hs;
+        pthread_mutex_unlock(&hc->lock);
+    }
+
+    if (va_status != VA_STATUS_SUCCESS && i > 0)
+        vaDestroySurfaces(dpy, surfaces, i);
+
+    return va_status;
+}
+
+VAStatus vaGetHostSurfaceData(
+    VADisplay dpy,
+    VASurfaceID surface,
+    void **data,                    /* out */
+    VAHostSurfaceLayout *layout     /* out */
+)
+{
+    struct va_hostmem_context *hc;
+    struct va_hostmem_surface *hs;
+
+    CHECK_DISPLAY(dpy);
+
+    if (!data)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    hc = DPY2HOSTMEM(dpy);
+    if (!hc)
+        return VA_STATUS_ERROR_INVALID_SURFACE;
+
+    pthread_mutex_lock(&hc->lock);
+    for (hs = hc->surfaces; hs; hs = hs->next) {
+        if (hs->surface == surface)
+            break;
+    }
+    if (hs) {
+        *data = hs->data;
+        if (layout)
+            *layout = hs->layout;
+    }
+    pthread_mutex_unlock(&hc->lock);
+
+    return hs ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_SURFACE;
+}
+
+void va_HostMemForgetSurfaces(VADisplay dpy, const VASurfaceID *surfaces, int num_surfaces)
+{
+    struct va_hostmem_context *hc = DPY2HOSTMEM(dpy);
+    struct va_hostmem_surface **prev, *hs;
+    int i;
+
+    if (!hc || !surfaces)
+        return;
+
+    pthread_mutex_lock(&hc->lock);
+    for (i = 0; i < num_surfaces; i++) {
+        for (prev = &hc->surfaces; (hs = *prev); prev = &hs->next) {
+            if (hs->surface == surfaces[i]) {
+                *prev = hs->next;
+                munmap(hs->data, hs->map_size);
+                free(hs);
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&hc->lock);
+}
+
+void va_HostMemEnd(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_hostmem_context *hc = DPY2HOSTMEM(dpy);
+
+    if (!hc)
+        return;
+
+    while (hc->surfaces) {
+        struct va_hostmem_surface *hs = hc->surfaces;
+
+        hc->surfaces = hs->next;
+        munmap(hs->data, hs->map_size);
+        free(hs);
+    }
+
+    pthread_mutex_destroy(&hc->lock);
+    free(hc);
+    __atomic_store_n(&pDisplayContext->vahostmem, NULL, __ATOMIC_RELEASE);
+}
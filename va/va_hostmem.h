@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_hostmem.h
+ * \brief Surfaces over host memory allocated by libva
+ *
+ * VA_SURFACE_ATTRIB_MEM_TYPE_USER_PTR surfaces let CPU producers such as
+ * software decoders or capture write straight into the memory the driver
+ * reads, without an upload. The memory has to match the driver's
+ * alignment and pitch requirements though. The functions in this file
+ * derive the layout from vaQuerySurfaceAttributes(), allocate suitable
+ * memory and create the surfaces over it.
+ */
+
+#ifndef _VA_HOSTMEM_H_
+#define _VA_HOSTMEM_H_
+
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_hostmem Host memory surfaces
+ *
+ * @{
+ */
+
+/** \brief Memory layout of a host memory surface. */
+typedef struct _VAHostSurfaceLayout {
+    /** \brief Pixel format (VA_FOURCC_*). */
+    uint32_t fourcc;
+    /** \brief Dimensions of the surface in pixels. */
+    uint32_t width;
+    uint32_t height;
+    /** \brief Number of planes. */
+    uint32_t num_planes;
+    /** \brief Pitch of each plane in bytes. */
+    uint32_t pitches[3];
+    /** \brief Offset of each plane from the start of the memory. */
+    uint32_t offsets[3];
+    /** \brief Size of the memory in bytes. */
+    uint32_t size;
+    /** \brief Required alignment of the start of the memory in bytes. */
+    uint32_t alignment;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VAHostSurfaceLayout;
+
+/** \brief Back the memory with huge pages when possible. */
+#define VA_HOST_MEMORY_HUGE_PAGES       0x00000001
+/** \brief Lock the memory in RAM (best effort, see RLIMIT_MEMLOCK). */
+#define VA_HOST_MEMORY_LOCKED           0x00000002
+
+/**
+ * \brief Computes the layout of a host memory surface.
+ *
+ * Queries the surface attributes of \c config for the support of
+ * VA_SURFACE_ATTRIB_MEM_TYPE_USER_PTR, the pixel format, the size limits
+ * and the VASurfaceAttribAlignmentSize of the driver, and lays the planes
+ * out accordingly: dimensions padded to the alignment (16 pixels if the
+ * driver does not report one), pitches aligned to 64 bytes and page
+ * aligned memory. Only the formats supported by vaConvertImageData() can
+ * be laid out.
+ *
+ * @return VA_STATUS_ERROR_UNSUPPORTED_MEMORY_TYPE if the driver cannot
+ *         create user pointer surfaces, VA_STATUS_ERROR_INVALID_IMAGE_FORMAT
+ *         or VA_STATUS_ERROR_RESOLUTION_NOT_SUPPORTED if it cannot create
+ *         them with this format or size
+ */
+VAStatus vaQueryHostSurfaceLayout(
+    VADisplay dpy,
+    VAConfigID config,
+    uint32_t fourcc,
+    uint32_t width,
+    uint32_t height,
+    VAHostSurfaceLayout *layout     /* out */
+);
+
+/**
+ * \brief Creates surfaces over host memory allocated by libva.
+ *
+ * Allocates memory laid out as returned by vaQueryHostSurfaceLayout() for
+ * each surface and creates a user pointer surface over it. The memory is
+ * populated by the calling thread, so that on NUMA systems it is local to
+ * the node of that thread. \c flags is a combination of
+ * VA_HOST_MEMORY_xxx.
+ *
+ * The memory is accessed with vaGetHostSurfaceData() and freed once the
+ * surface is destroyed with vaDestroySurfaces() or the display terminated.
+ */
+VAStatus vaCreateHostSurfaces(
+    VADisplay dpy,
+    VAConfigID config,
+    uint32_t fourcc,
+    uint32_t width,
+    uint32_t height,
+    uint32_t flags,
+    VASurfaceID *surfaces,      /* out */
+    unsigned int num_surfaces
+);
+
+/**
+ * \brief Returns the memory of a surface created by vaCreateHostSurfaces().
+ *
+ * As for any surface, the application synchronizes the accesses of the CPU
+ * with the processing of the surface, e.g. with vaSyncSurface().
+ *
+ * @param[out] data     the start of the memory
+ * @param[out] layout   its layout, may be NULL
+ */
+VAStatus vaGetHostSurfaceData(
+    VADisplay dpy,
+    VASurfaceID surface,
+    void **data,                    /* out */
+    VAHostSurfaceLayout *layout     /* out */
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_HOSTMEM_H_ */
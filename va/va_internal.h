@@ -41,6 +41,68 @@ VADisplayContextP va_newDisplayContext(void);
 
 VADriverContextP va_newDriverContext(VADisplayContextP dctx);
 
+/* vaConvertImageData() restricted to the lines [y0, y1), y0 must be even */
+VAStatus va_ConvertImageRows(const VAImage *src_image, const void *src_data,
+                             const VAImage *dst_image, void *dst_data,
+                             uint32_t flags, unsigned int y0, unsigned int y1);
+
+/*
+ * Plane sizes of a fourcc supported by the converters, returns the number
+ * of planes or 0 for other fourccs
+ */
+unsigned int va_ConvertPlaneGeometry(uint32_t fourcc, unsigned int width, unsigned int height,
+                                     unsigned int row_bytes[3], unsigned int rows[3]);
+
+/* VA_RT_FORMAT_xxx of the surfaces holding images of the given fourcc */
+unsigned int va_ConvertRTFormat(uint32_t fourcc);
+
+/* release the VPP objects kept by vaDownloadSurfaceScaled() */
+void va_ReadbackEnd(VADisplay dpy);
+
+/* pooled buffer bookkeeping, see va_pool.c */
+VAStatus va_BufferPoolCreate(VADisplay dpy, VAContextID context, VABufferType type,
+                             unsigned int size, unsigned int num_elements, const void *data,
+                             int recycle, VABufferID *buf_id);
+int va_BufferPoolRecycle(VADisplay dpy, VABufferID buf_id);
+void va_BufferPoolForget(VADisplay dpy, VABufferID buf_id);
+void va_BufferPoolDestroyContext(VADisplay dpy, VAContextID context);
+void va_BufferPoolEnd(VADisplay dpy);
+
+/* vaSyncObjects() emulation and completion notifications, see va_sync.c */
+VAStatus va_SyncObjects(VADisplay dpy, VASyncObject *objects, uint32_t num_objects,
+                        uint32_t flags, uint64_t timeout_ns, uint32_t *num_completed);
+int va_SyncCopyPending(VADisplay dpy, const VASyncObject *objects, uint32_t num_objects);
+VAStatus va_SyncGetCompletionFd(VADisplay dpy, VASyncObjectType obj_type, VAGenericID id, int *fd);
+VAStatus va_SyncRegisterCallback(VADisplay dpy, VASyncObjectType obj_type, VAGenericID id,
+                                 VACompletionCallback callback, void *user_data);
+void va_SyncForget(VADisplay dpy, VASyncObjectType obj_type, VAGenericID id);
+void va_SyncEnd(VADisplay dpy);
+
+/* multi-frame submission aggregation, see va_mf.c */
+int va_MFEndPicture(VADisplay dpy, VAContextID context, VAStatus *status);
+void va_MFEndPictures(VADisplay dpy, VAPictureSubmission *pictures, uint32_t num_pictures);
+VAStatus va_MFEnableAggregation(VADisplay dpy, VAMFContextID mf_context, int enable, uint64_t timeout_ns);
+void va_MFAddContext(VADisplay dpy, VAMFContextID mf_context, VAContextID context);
+void va_MFReleaseContext(VADisplay dpy, VAMFContextID mf_context, VAContextID context);
+void va_MFDestroyContext(VADisplay dpy, VAContextID context);
+void va_MFEnd(VADisplay dpy);
+
+/* DMA-BUF import/export cache bookkeeping, see va_dmabuf.c */
+void va_DmaBufForgetSurfaces(VADisplay dpy, const VASurfaceID *surfaces, int num_surfaces);
+void va_DmaBufEnd(VADisplay dpy);
+
+/* memory of the vaCreateHostSurfaces() surfaces, see va_hostmem.c */
+void va_HostMemForgetSurfaces(VADisplay dpy, const VASurfaceID *surfaces, int num_surfaces);
+void va_HostMemEnd(VADisplay dpy);
+
+struct va_thread_pool;
+
+/* vaConvertImageData() split in bands of lines run on the worker pool */
+VAStatus va_ConvertImageParallel(struct va_thread_pool *pool,
+                                 const VAImage *src_image, const void *src_data,
+                                 const VAImage *dst_image, void *dst_data,
+                                 uint32_t flags);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Multi-frame submission aggregation.
+ *
+ * libva records the contexts associated with each multi-frame context.
+ * Once aggregation is enabled on a multi-frame context, vaEndPicture() on
+ * any of its contexts blocks until either all of them ended a picture or
+ * the timeout measured from the first one expired, and the ready contexts
+ * are then submitted with a single vaMFSubmit() by one of the waiting
+ * threads. Applications keep one encoding thread per stream, or submit
+ * the pictures of several streams at once with vaSubmitPictures().
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_thread.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct va_mf_member {
+    VAContextID context;
+    int ready;                  /* picture ended, waiting for the submission */
+    VAStatus result;            /* vaMFSubmit() status of the last submission */
+};
+
+struct va_mf_group {
+    VAMFContextID mf_context;
+    int enabled;
+    uint64_t timeout_ns;
+    struct va_mf_member *members;
+    unsigned int num_members;
+    unsigned int max_members;
+    unsigned int num_ready;
+    int submitting;
+    unsigned int generation;    /* incremented by every submission */
+    struct timespec deadline;   /* of the current batch, set by its first member */
+    struct va_mf_group *next;
+};
+
+struct va_mf_context {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        /* signaled on submissions and group changes */
+    struct va_mf_group *groups;
+    int num_enabled;
+};
+
+static pthread_mutex_t va_mf_init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define DPY2MFCTX(dpy) \
+    ((struct va_mf_context *)__atomic_load_n(&((VADisplayContextP)dpy)->vamf, __ATOMIC_ACQUIRE))
+
+static struct va_mf_context *va_MFGetContext(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_mf_context *mc = DPY2MFCTX(dpy);
+
+    if (mc)
+        return mc;
+
+    pthread_mutex_lock(&va_mf_init_lock);
+    mc = pDisplayContext->vamf;
+    if (!mc) {
+        mc = calloc(1, sizeof(*mc));
+        if (mc) {
+            pthread_mutex_init(&mc->lock, NULL);
+            pthread_cond_init(&mc->cond, NULL);
+            __atomic_store_n(&pDisplayContext->vamf, mc, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&va_mf_init_lock);
+
+    return mc;
+}
+
+static struct va_mf_group *va_MFFindGroup(struct va_mf_context *mc, VAMFContextID mf_context)
+{
+    struct va_mf_group *group;
+
+    for (group = mc->groups; group; group = group->next) {
+        if (group->mf_context == mf_context)
+            return group;
+    }
+    return NULL;
+}
+
+static struct va_mf_group *va_MFGetGroup(struct va_mf_context *mc, VAMFContextID mf_context)
+{
+    struct va_mf_group *group = va_MFFindGroup(mc, mf_context);
+
+    if (group)
+        return group;
+
+    group = calloc(1, sizeof(*group));
+    if (group) {
+        group->mf_context = mf_context;
+        group->next = mc->groups;
+        mc->groups = group;
+    }
+    return group;
+}
+
+static struct va_mf_member *va_MFFindMember(struct va_mf_group *group, VAContextID context)
+{
+    unsigned int i;
+
+    for (i = 0; i < group->num_members; i++) {
+        if (group->members[i].context == context)
+            return &group->members[i];
+    }
+    return NULL;
+}
+
+/* the enabled group a context belongs to, if any */
+static struct va_mf_group *va_MFFindEnabledGroup(struct va_mf_context *mc, VAContextID context,
+                                                 struct va_mf_member **member)
+{
+    struct va_mf_group *group;
+
+    for (group = mc->groups; group; group = group->next) {
+        if (group->enabled && (*member = va_MFFindMember(group, context)))
+            return group;
+    }
+    return NULL;
+}
+
+static void va_MFRemoveMember(struct va_mf_context *mc, struct va_mf_group *group,
+                              struct va_mf_member *member)
+{
+    if (member->ready)
+        group->num_ready--;
+    *member = group->members[--group->num_members];
+    /* the remaining members may complete the batch now */
+    pthread_cond_broadcast(&mc->cond);
+}
+
+static void va_MFFreeGroup(struct va_mf_context *mc, struct va_mf_group *group)
+{
+    struct va_mf_group **prev;
+
+    for (prev = &mc->groups; *prev != group; prev = &(*prev)->next)
+        ;
+    *prev = group->next;
+    if (group->enabled)
+        __atomic_store_n(&mc->num_enabled, mc->num_enabled - 1, __ATOMIC_RELAXED);
+    free(group->members);
+    free(group);
+}
+
+static int va_MFDeadlinePassed(const struct timespec *deadline)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec > deadline->tv_sec ||
+           (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+/* submit the ready members of the group, called and returns with mc->lock held */
+static void va_MFSubmitGroup(VADisplay dpy, struct va_mf_context *mc, struct va_mf_group *group)
+{
+    VAMFContextID mf_context = group->mf_context;
+    VAContextID *contexts;
+    VAStatus va_status;
+    unsigned int i, n = 0;
+
+    group->submitting = 1;
+    contexts = malloc(group->num_ready * sizeof(*contexts));
+    if (contexts) {
+        for (i = 0; i < group->num_members; i++) {
+            if (group->members[i].ready)
+                contexts[n++] = group->members[i].context;
+        }
+    }
+    pthread_mutex_unlock(&mc->lock);
+
+    va_status = contexts ? vaMFSubmit(dpy, mf_context, contexts, n) :
+                VA_STATUS_ERROR_ALLOCATION_FAILED;
+    free(contexts);
+
+    pthread_mutex_lock(&mc->lock);
+    /* the group cannot go away while submitting, see va_MFWaitIdle() */
+    for (i = 0; i < group->num_members; i++) {
+        if (group->members[i].ready) {
+            group->members[i].ready = 0;
+            group->members[i].result = va_status;
+        }
+    }
+    group->num_ready = 0;
+    group->submitting = 0;
+    group->generation++;
+    pthread_cond_broadcast(&mc->cond);
+}
+
+/* wait until the group is not being submitted, so that it can be modified or freed */
+static struct va_mf_group *va_MFWaitIdle(struct va_mf_context *mc, VAMFContextID mf_context)
+{
+    struct va_mf_group *group;
+
+    while ((group = va_MFFindGroup(mc, mf_context)) && group->submitting)
+        pthread_cond_wait(&mc->cond, &mc->lock);
+    return group;
+}
+
+/* add the ended picture of a context to the batch of its group, called with mc->lock held */
+static int va_MFMarkReady(struct va_mf_context *mc, VAContextID context,
+                          VAMFContextID *mf_context, unsigned int *generation)
+{
+    struct va_mf_member *member;
+    struct va_mf_group *group;
+
+    /* a member still part of a batch being formed waits for it first */
+    while ((group = va_MFFindEnabledGroup(mc, context, &member)) &&
+           (member->ready || group->submitting))
+        pthread_cond_wait(&mc->cond, &mc->lock);
+    if (!group)
+        return 0;
+
+    if (group->num_ready++ == 0)
+        va_DeadlineFromTimeout(&group->deadline, group->timeout_ns);
+    member->ready = 1;
+    *mf_context = group->mf_context;
+    *generation = group->generation;
+    return 1;
+}
+
+/* wait for the submission of the batch a context was added to, called with mc->lock held */
+static VAStatus va_MFWaitSubmitted(VADisplay dpy, struct va_mf_context *mc, VAMFContextID mf_context,
+                                   VAContextID context, unsigned int generation)
+{
+    struct va_mf_member *member;
+    struct va_mf_group *group;
+
+    for (;;) {
+        /* the group may have been disabled meanwhile, its batch is still submitted */
+        group = va_MFFindGroup(mc, mf_context);
+        member = group ? va_MFFindMember(group, context) : NULL;
+        if (!member) {
+            /* removed from the group, or the group destroyed */
+            return VA_STATUS_ERROR_INVALID_CONTEXT;
+        }
+        if (group->generation != generation)
+            return member->result;
+        if (!group->submitting &&
+            (!group->enabled || group->num_ready == group->num_members ||
+             va_MFDeadlinePassed(&group->deadline))) {
+            va_MFSubmitGroup(dpy, mc, group);
+            continue;
+        }
+        if (group->submitting)
+            pthread_cond_wait(&mc->cond, &mc->lock);
+        else
+            pthread_cond_timedwait(&mc->cond, &mc->lock, &group->deadline);
+    }
+}
+
+int va_MFEndPicture(VADisplay dpy, VAContextID context, VAStatus *status)
+{
+    struct va_mf_context *mc = DPY2MFCTX(dpy);
+    VAMFContextID mf_context;
+    unsigned int generation;
+    int aggregated;
+
+    if (!mc || !__atomic_load_n(&mc->num_enabled, __ATOMIC_RELAXED))
+        return 0;
+
+    pthread_mutex_lock(&mc->lock);
+    aggregated = va_MFMarkReady(mc, context, &mf_context, &generation);
+    if (aggregated)
+        *status = va_MFWaitSubmitted(dpy, mc, mf_context, context, generation);
+    pthread_mutex_unlock(&mc->lock);
+
+    return aggregated;
+}
+
+struct va_mf_pending {
+    int ready;
+    VAMFContextID mf_context;
+    unsigned int generation;
+};
+
+/*
+ * va_MFEndPicture() for the ended pictures of a vaSubmitPictures() batch.
+ * The pictures are added to the batches of their groups before waiting for
+ * any of them, up to the next picture of a context already added.
+ */
+void va_MFEndPictures(VADisplay dpy, VAPictureSubmission *pictures, uint32_t num_pictures)
+{
+    struct va_mf_context *mc = DPY2MFCTX(dpy);
+    struct va_mf_pending *pending;
+    uint32_t start, end, i;
+
+    if (!mc || !__atomic_load_n(&mc->num_enabled, __ATOMIC_RELAXED) || !num_pictures)
+        return;
+
+    pending = calloc(num_pictures, sizeof(*pending));
+    if (!pending) {
+        for (i = 0; i < num_pictures; i++) {
+            if (pictures[i].status == VA_STATUS_SUCCESS)
+                pictures[i].status = VA_STATUS_ERROR_ALLOCATION_FAILED;
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&mc->lock);
+    for (start = 0; start < num_pictures; start = end) {
+        for (end = start; end < num_pictures; end++) {
+            VAPictureSubmission *p = &pictures[end];
+
+            if (p->status != VA_STATUS_SUCCESS)
+                continue;
+            for (i = start; i < end; i++) {
+                if (pending[i].ready && pictures[i].context == p->context)
+                    break;
+            }
+            if (i < end)
+                break;
+            pending[end].ready = va_MFMarkReady(mc, p->context, &pending[end].mf_context,
+                                                &pending[end].generation);
+        }
+        for (i = start; i < end; i++) {
+            if (pending[i].ready)
+                pictures[i].status = va_MFWaitSubmitted(dpy, mc, pending[i].mf_context,
+                                                        pictures[i].context, pending[i].generation);
+        }
+    }
+    pthread_mutex_unlock(&mc->lock);
+
+    free(pending);
+}
+
+VAStatus va_MFEnableAggregation(VADisplay dpy, VAMFContextID mf_context, int enable, uint64_t timeout_ns)
+{
+    struct va_mf_context *mc = va_MFGetContext(dpy);
+    struct va_mf_group *group;
+
+    if (!mc)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    pthread_mutex_lock(&mc->lock);
+    group = va_MFWaitIdle(mc, mf_context);
+    if (!group)
+        group = va_MFGetGroup(mc, mf_context);
+    if (!group) {
+        pthread_mutex_unlock(&mc->lock);
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    if (enable) {
+        group->timeout_ns = timeout_ns;
+        if (!group->enabled)
+            __atomic_store_n(&mc->num_enabled, mc->num_enabled + 1, __ATOMIC_RELAXED);
+    } else {
+        if (group->enabled)
+            __atomic_store_n(&mc->num_enabled, mc->num_enabled - 1, __ATOMIC_RELAXED);
+        /* the members of the batch being formed submit it right away */
+        pthread_cond_broadcast(&mc->cond);
+    }
+    group->enabled = enable;
+    pthread_mutex_unlock(&mc->lock);
+
+    return VA_STATUS_SUCCESS;
+}
+
+void va_MFAddContext(VADisplay dpy, VAMFContextID mf_context, VAContextID context)
+{
+    struct va_mf_context *mc = va_MFGetContext(dpy);
+    struct va_mf_group *group;
+
+    if (!mc)
+        return;
+
+    pthread_mutex_lock(&mc->lock);
+    group = va_MFWaitIdle(mc, mf_context);
+    if (!group)
+        group = va_MFGetGroup(mc, mf_context);
+    if (group && !va_MFFindMember(group, context)) {
+        if (group->num_members == group->max_members) {
+            unsigned int max_members = group->max_members ? group->max_members * 2 : 8;
+            struct va_mf_member *members;
+
+            members = realloc(group->members, max_members * sizeof(*members));
+            if (!members)
+                goto out;
+            group->members = members;
+            group->max_members = max_members;
+        }
+        group->members[group->num_members].context = context;
+        group->members[group->num_members].ready = 0;
+        group->members[group->num_members].result = VA_STATUS_SUCCESS;
+        group->num_members++;
+    }
+out:
+    pthread_mutex_unlock(&mc->lock);
+}
+
+void va_MFReleaseContext(VADisplay dpy, VAMFContextID mf_context, VAContextID context)
+{
+    struct va_mf_context *mc = DPY2MFCTX(dpy);
+    struct va_mf_member *member;
+    struct va_mf_group *group;
+
+    if (!mc)
+        return;
+
+    pthread_mutex_lock(&mc->lock);
+    group = va_MFWaitIdle(mc, mf_context);
+    if (group && (member = va_MFFindMember(group, context)))
+        va_MFRemoveMember(mc, group, member);
+    pthread_mutex_unlock(&mc->lock);
+}
+
+void va_MFDestroyContext(VADisplay dpy, VAContextID context)
+{
+    struct va_mf_context *mc = DPY2MFCTX(dpy);
+    struct va_mf_member *member;
+    struct va_mf_group *group, *next;
+
+    if (!mc)
+        return;
+
+    pthread_mutex_lock(&mc->lock);
+    for (group = mc->groups; group; group = next) {
+        next = group->next;
+        if (group->mf_context != context && !va_MFFindMember(group, context))
+            continue;
+        group = va_MFWaitIdle(mc, group->mf_context);
+        if (group && group->mf_context == context) {
+            /* vaDestroyContext() is also used on multi-frame contexts */
+            va_MFFreeGroup(mc, group);
+            pthread_cond_broadcast(&mc->cond);
+        } else if (group && (member = va_MFFindMember(group, context))) {
+            va_MFRemoveMember(mc, group, member);
+        }
+        /* the list may have changed while waiting, start over */
+        next = mc->groups;
+    }
+    pthread_mutex_unlock(&mc->lock);
+}
+
+void va_MFEnd(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_mf_context *mc = DPY2MFCTX(dpy);
+
+    if (!mc)
+        return;
+
+    while (mc->groups)
+        va_MFFreeGroup(mc, mc->groups);
+    pthread_cond_destroy(&mc->cond);
+    pthread_mutex_destroy(&mc->lock);
+    free(mc);
+    __atomic_store_n(&pDisplayContext->vamf, NULL, __ATOMIC_RELEASE);
+}
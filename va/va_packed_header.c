@@ -0,0 +1,773 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Packed parameter set writer (ITU-T H.264 7.3.2, H.265 7.3.2).
+ *
+ * Each header is written into the spare one of two buffers and compared
+ * with the current one, so that the data handed out stays valid and the
+ * CHANGED flags only report actual changes. Before writing, the fields a
+ * header depends on are compared with those of the previous call; in the
+ * steady state of a stream no bit is written at all.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_packed_header.h"
+#include "va_bitwriter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* an H.264 SPS with 255 offset_for_ref_frame values fits with its escaping */
+#define VA_PACKED_SEQUENCE_MAX  4096
+#define VA_PACKED_PICTURE_MAX   512
+
+#define H264_NAL_SPS            7
+#define H264_NAL_PPS            8
+#define HEVC_NAL_VPS            32
+#define HEVC_NAL_SPS            33
+#define HEVC_NAL_PPS            34
+
+typedef struct va_packed_buffer {
+    uint8_t data[2][VA_PACKED_SEQUENCE_MAX];
+    uint32_t bits[2];
+    /* buffer holding the current header, -1 if none */
+    int current;
+} va_packed_buffer;
+
+/* fields of VAEncPictureParameterBufferH264 written to the PPS */
+typedef struct va_h264_pps_key {
+    uint8_t pic_parameter_set_id;
+    uint8_t seq_parameter_set_id;
+    uint8_t pic_init_qp;
+    uint8_t num_ref_idx_l0_active_minus1;
+    uint8_t num_ref_idx_l1_active_minus1;
+    int8_t chroma_qp_index_offset;
+    int8_t second_chroma_qp_index_offset;
+    uint8_t entropy_coding_mode_flag;
+    uint8_t weighted_pred_flag;
+    uint8_t weighted_bipred_idc;
+    uint8_t constrained_intra_pred_flag;
+    uint8_t transform_8x8_mode_flag;
+    uint8_t deblocking_filter_control_present_flag;
+    uint8_t redundant_pic_cnt_present_flag;
+    uint8_t pic_order_present_flag;
+    uint8_t pic_scaling_matrix_present_flag;
+} va_h264_pps_key;
+
+/* fields of VAEncPictureParameterBufferHEVC written to the PPS */
+typedef struct va_hevc_pps_key {
+    uint8_t slice_pic_parameter_set_id;
+    uint8_t pic_init_qp;
+    uint8_t diff_cu_qp_delta_depth;
+    int8_t pps_cb_qp_offset;
+    int8_t pps_cr_qp_offset;
+    uint8_t num_tile_columns_minus1;
+    uint8_t num_tile_rows_minus1;
+    uint8_t column_width_minus1[19];
+    uint8_t row_height_minus1[21];
+    uint8_t log2_parallel_merge_level_minus2;
+    uint8_t num_ref_idx_l0_default_active_minus1;
+    uint8_t num_ref_idx_l1_default_active_minus1;
+    uint8_t dependent_slice_segments_enabled_flag;
+    uint8_t sign_data_hiding_enabled_flag;
+    uint8_t constrained_intra_pred_flag;
+    uint8_t transform_skip_enabled_flag;
+    uint8_t cu_qp_delta_enabled_flag;
+    uint8_t weighted_pred_flag;
+    uint8_t weighted_bipred_flag;
+    uint8_t transquant_bypass_enabled_flag;
+    uint8_t tiles_enabled_flag;
+    uint8_t entropy_coding_sync_enabled_flag;
+    uint8_t loop_filter_across_tiles_enabled_flag;
+    uint8_t pps_loop_filter_across_slices_enabled_flag;
+} va_hevc_pps_key;
+
+struct _VAPackedHeaderWriter {
+    VAProfile profile;
+    int hevc;
+    VAPackedHeaderOptions options;
+
+    /* parameters of the current headers */
+    int have_seq;
+    int have_pic;
+    union {
+        VAEncSequenceParameterBufferH264 h264;
+        VAEncSequenceParameterBufferHEVC hevc;
+    } seq;
+    union {
+        va_h264_pps_key h264;
+        va_hevc_pps_key hevc;
+    } pic;
+
+    va_packed_buffer sequence;
+    va_packed_buffer picture;
+};
+
+VAStatus vaCreatePackedHeaderWriter(
+    VAProfile profile,
+    const VAPackedHeaderOptions *options,
+    VAPackedHeaderWriter *writer
+)
+{
+    struct _VAPackedHeaderWriter *w;
+    int hevc;
+
+    if (!writer)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    switch (profile) {
+    case VAProfileH264ConstrainedBaseline:
+    case VAProfileH264Main:
+    case VAProfileH264High:
+        hevc = 0;
+        break;
+    case VAProfileHEVCMain:
+    case VAProfileHEVCMain10:
+    case VAProfileHEVCMain12:
+    case VAProfileHEVCMain422_10:
+    case VAProfileHEVCMain422_12:
+    case VAProfileHEVCMain444:
+    case VAProfileHEVCMain444_10:
+    case VAProfileHEVCMain444_12:
+        hevc = 1;
+        break;
+    default:
+        /* MVC needs subset SPS, SCC the SPS and PPS extensions */
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+    }
+
+    w = calloc(1, sizeof(*w));
+    if (!w)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    w->profile = profile;
+    w->hevc = hevc;
+    if (options) {
+        w->options = *options;
+    } else {
+        w->options.max_num_reorder_frames = 0xff;
+        w->options.log2_max_pic_order_cnt_lsb_minus4 = 4;
+    }
+    w->sequence.current = -1;
+    w->picture.current = -1;
+
+    *writer = w;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyPackedHeaderWriter(VAPackedHeaderWriter writer)
+{
+    if (!writer)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    free(writer);
+    return VA_STATUS_SUCCESS;
+}
+
+static inline uint8_t *va_PackedSpare(va_packed_buffer *buf)
+{
+    return buf->data[buf->current != 0 ? 0 : 1];
+}
+
+/* makes the header just written to the spare buffer current if it differs */
+static uint32_t va_PackedCommit(va_packed_buffer *buf, const va_bitwriter *bw, uint32_t changed)
+{
+    int spare = buf->current != 0 ? 0 : 1;
+    uint32_t bits = (uint32_t)va_BitWriterPosition(bw);
+
+    if (buf->current >= 0 && buf->bits[buf->current] == bits &&
+        !memcmp(buf->data[buf->current], buf->data[spare], (bits + 7) / 8))
+        return 0;
+
+    buf->bits[spare] = bits;
+    buf->current = spare;
+    return changed;
+}
+
+static void va_PackedOutput(const va_packed_buffer *buf, uint32_t type, VAPackedHeader *header)
+{
+    if (!header)
+        return;
+    memset(header, 0, sizeof(*header));
+    header->param.type = type;
+    header->param.bit_length = buf->bits[buf->current];
+    header->param.has_emulation_bytes = 1;
+    header->data = buf->data[buf->current];
+}
+
+static inline unsigned int va_PackedReorderFrames(const VAPackedHeaderOptions *options, uint32_t ip_period)
+{
+    if (options->max_num_reorder_frames != 0xff)
+        return options->max_num_reorder_frames;
+    return ip_period > 1;
+}
+
+static void va_H264WriteSPS(
+    const struct _VAPackedHeaderWriter *w,
+    const VAEncSequenceParameterBufferH264 *seq,
+    va_bitwriter *bw
+)
+{
+    unsigned int profile_idc, constraint_flags = 0, i;
+
+    switch (w->profile) {
+    case VAProfileH264ConstrainedBaseline:
+        profile_idc = 66;
+        constraint_flags = 0xc0;
+        break;
+    case VAProfileH264Main:
+        profile_idc = 77;
+        constraint_flags = 0x40;
+        break;
+    default:
+        if (seq->seq_fields.bits.chroma_format_idc == 3)
+            profile_idc = 244;
+        else if (seq->seq_fields.bits.chroma_format_idc == 2)
+            profile_idc = 122;
+        else if (seq->bit_depth_luma_minus8 || seq->bit_depth_chroma_minus8)
+            profile_idc = 110;
+        else
+            profile_idc = 100;
+        break;
+    }
+
+    va_BitWriterStartCode(bw);
+    va_BitWriterPut(bw, 8, 0x60 | H264_NAL_SPS);
+    va_BitWriterPut(bw, 8, profile_idc);
+    va_BitWriterPut(bw, 8, constraint_flags);
+    va_BitWriterPut(bw, 8, seq->level_idc);
+    va_BitWriterPutUE(bw, seq->seq_parameter_set_id);
+    if (profile_idc >= 100) {
+        va_BitWriterPutUE(bw, seq->seq_fields.bits.chroma_format_idc);
+        if (seq->seq_fields.bits.chroma_format_idc == 3)
+            va_BitWriterPutBit(bw, 0);                  /* separate_colour_plane_flag */
+        va_BitWriterPutUE(bw, seq->bit_depth_luma_minus8);
+        va_BitWriterPutUE(bw, seq->bit_depth_chroma_minus8);
+        va_BitWriterPutBit(bw, 0);                      /* qpprime_y_zero_transform_bypass_flag */
+        va_BitWriterPutBit(bw, seq->seq_fields.bits.seq_scaling_matrix_present_flag);
+        if (seq->seq_fields.bits.seq_scaling_matrix_present_flag)
+            va_BitWriterPut(bw, seq->seq_fields.bits.chroma_format_idc == 3 ? 12 : 8, 0);
+    }
+    va_BitWriterPutUE(bw, seq->seq_fields.bits.log2_max_frame_num_minus4);
+    va_BitWriterPutUE(bw, seq->seq_fields.bits.pic_order_cnt_type);
+    if (seq->seq_fields.bits.pic_order_cnt_type == 0) {
+        va_BitWriterPutUE(bw, seq->seq_fields.bits.log2_max_pic_order_cnt_lsb_minus4);
+    } else if (seq->seq_fields.bits.pic_order_cnt_type == 1) {
+        va_BitWriterPutBit(bw, seq->seq_fields.bits.delta_pic_order_always_zero_flag);
+        va_BitWriterPutSE(bw, seq->offset_for_non_ref_pic);
+        va_BitWriterPutSE(bw, seq->offset_for_top_to_bottom_field);
+        va_BitWriterPutUE(bw, seq->num_ref_frames_in_pic_order_cnt_cycle);
+        for (i = 0; i < seq->num_ref_frames_in_pic_order_cnt_cycle; i++)
+            va_BitWriterPutSE(bw, seq->offset_for_ref_frame[i]);
+    }
+    va_BitWriterPutUE(bw, seq->max_num_ref_frames);
+    va_BitWriterPutBit(bw, 0);                          /* gaps_in_frame_num_value_allowed_flag */
+    va_BitWriterPutUE(bw, seq->picture_width_in_mbs - 1);
+    /* picture_height_in_mbs counts the macroblocks of a frame */
+    if (seq->seq_fields.bits.frame_mbs_only_flag)
+        va_BitWriterPutUE(bw, seq->picture_height_in_mbs - 1);
+    else
+        va_BitWriterPutUE(bw, seq->picture_height_in_mbs / 2 - 1);
+    va_BitWriterPutBit(bw, seq->seq_fields.bits.frame_mbs_only_flag);
+    if (!seq->seq_fields.bits.frame_mbs_only_flag)
+        va_BitWriterPutBit(bw, seq->seq_fields.bits.mb_adaptive_frame_field_flag);
+    va_BitWriterPutBit(bw, seq->seq_fields.bits.direct_8x8_inference_flag);
+    va_BitWriterPutBit(bw, seq->frame_cropping_flag);
+    if (seq->frame_cropping_flag) {
+        va_BitWriterPutUE(bw, seq->frame_crop_left_offset);
+        va_BitWriterPutUE(bw, seq->frame_crop_right_offset);
+        va_BitWriterPutUE(bw, seq->frame_crop_top_offset);
+        va_BitWriterPutUE(bw, seq->frame_crop_bottom_offset);
+    }
+
+    va_BitWriterPutBit(bw, seq->vui_parameters_present_flag);
+    if (seq->vui_parameters_present_flag) {
+        va_BitWriterPutBit(bw, seq->vui_fields.bits.aspect_ratio_info_present_flag);
+        if (seq->vui_fields.bits.aspect_ratio_info_present_flag) {
+            va_BitWriterPut(bw, 8, seq->aspect_ratio_idc);
+            if (seq->aspect_ratio_idc == 255) {
+                va_BitWriterPut(bw, 16, seq->sar_width);
+                va_BitWriterPut(bw, 16, seq->sar_height);
+            }
+        }
+        va_BitWriterPutBit(bw, 0);                      /* overscan_info_present_flag */
+        va_BitWriterPutBit(bw, 0);                      /* video_signal_type_present_flag */
+        va_BitWriterPutBit(bw, 0);                      /* chroma_loc_info_present_flag */
+        va_BitWriterPutBit(bw, seq->vui_fields.bits.timing_info_present_flag);
+        if (seq->vui_fields.bits.timing_info_present_flag) {
+            va_BitWriterPut(bw, 32, seq->num_units_in_tick);
+            va_BitWriterPut(bw, 32, seq->time_scale);
+            va_BitWriterPutBit(bw, seq->vui_fields.bits.fixed_frame_rate_flag);
+        }
+        va_BitWriterPutBit(bw, 0);                      /* nal_hrd_parameters_present_flag */
+        va_BitWriterPutBit(bw, 0);                      /* vcl_hrd_parameters_present_flag */
+        va_BitWriterPutBit(bw, 0);                      /* pic_struct_present_flag */
+        va_BitWriterPutBit(bw, seq->vui_fields.bits.bitstream_restriction_flag);
+        if (seq->vui_fields.bits.bitstream_restriction_flag) {
+            va_BitWriterPutBit(bw, seq->vui_fields.bits.motion_vectors_over_pic_boundaries_flag);
+            va_BitWriterPutUE(bw, 0);                   /* max_bytes_per_pic_denom */
+            va_BitWriterPutUE(bw, 0);                   /* max_bits_per_mb_denom */
+            va_BitWriterPutUE(bw, seq->vui_fields.bits.log2_max_mv_length_horizontal);
+            va_BitWriterPutUE(bw, seq->vui_fields.bits.log2_max_mv_length_vertical);
+            va_BitWriterPutUE(bw, va_PackedReorderFrames(&w->options, seq->ip_period));
+            va_BitWriterPutUE(bw, seq->max_num_ref_frames);
+        }
+    }
+    va_BitWriterTrailingBits(bw);
+}
+
+static void va_H264PPSKey(const VAEncPictureParameterBufferH264 *pic, va_h264_pps_key *key)
+{
+    memset(key, 0, sizeof(*key));
+    key->pic_parameter_set_id = pic->pic_parameter_set_id;
+    key->seq_parameter_set_id = pic->seq_parameter_set_id;
+    key->pic_init_qp = pic->pic_init_qp;
+    key->num_ref_idx_l0_active_minus1 = pic->num_ref_idx_l0_active_minus1;
+    key->num_ref_idx_l1_active_minus1 = pic->num_ref_idx_l1_active_minus1;
+    key->chroma_qp_index_offset = pic->chroma_qp_index_offset;
+    key->second_chroma_qp_index_offset = pic->second_chroma_qp_index_offset;
+    key->entropy_coding_mode_flag = pic->pic_fields.bits.entropy_coding_mode_flag;
+    key->weighted_pred_flag = pic->pic_fields.bits.weighted_pred_flag;
+    key->weighted_bipred_idc = pic->pic_fields.bits.weighted_bipred_idc;
+    key->constrained_intra_pred_flag = pic->pic_fields.bits.constrained_intra_pred_flag;
+    key->transform_8x8_mode_flag = pic->pic_fields.bits.transform_8x8_mode_flag;
+    key->deblocking_filter_control_present_flag = pic->pic_fields.bits.deblocking_filter_control_present_flag;
+    key->redundant_pic_cnt_present_flag = pic->pic_fields.bits.redundant_pic_cnt_present_flag;
+    key->pic_order_present_flag = pic->pic_fields.bits.pic_order_present_flag;
+    key->pic_scaling_matrix_present_flag = pic->pic_fields.bits.pic_scaling_matrix_present_flag;
+}
+
+static void va_H264WritePPS(const va_h264_pps_key *pps, unsigned int chroma_format_idc, va_bitwriter *bw)
+{
+    va_BitWriterStartCode(bw);
+    va_BitWriterPut(bw, 8, 0x60 | H264_NAL_PPS);
+    va_BitWriterPutUE(bw, pps->pic_parameter_set_id);
+    va_BitWriterPutUE(bw, pps->seq_parameter_set_id);
+    va_BitWriterPutBit(bw, pps->entropy_coding_mode_flag);
+    va_BitWriterPutBit(bw, pps->pic_order_present_flag);
+    va_BitWriterPutUE(bw, 0);                           /* num_slice_groups_minus1 */
+    va_BitWriterPutUE(bw, pps->num_ref_idx_l0_active_minus1);
+    va_BitWriterPutUE(bw, pps->num_ref_idx_l1_active_minus1);
+    va_BitWriterPutBit(bw, pps->weighted_pred_flag);
+    va_BitWriterPut(bw, 2, pps->weighted_bipred_idc);
+    va_BitWriterPutSE(bw, (int)pps->pic_init_qp - 26);
+    va_BitWriterPutSE(bw, 0);                           /* pic_init_qs_minus26 */
+    va_BitWriterPutSE(bw, pps->chroma_qp_index_offset);
+    va_BitWriterPutBit(bw, pps->deblocking_filter_control_present_flag);
+    va_BitWriterPutBit(bw, pps->constrained_intra_pred_flag);
+    va_BitWriterPutBit(bw, pps->redundant_pic_cnt_present_flag);
+    if (pps->transform_8x8_mode_flag || pps->pic_scaling_matrix_present_flag ||
+        pps->second_chroma_qp_index_offset != pps->chroma_qp_index_offset) {
+        va_BitWriterPutBit(bw, pps->transform_8x8_mode_flag);
+        va_BitWriterPutBit(bw, pps->pic_scaling_matrix_present_flag);
+        if (pps->pic_scaling_matrix_present_flag)
+            va_BitWriterPut(bw, 6 + (chroma_format_idc != 3 ? 2 : 6) * pps->transform_8x8_mode_flag, 0);
+        va_BitWriterPutSE(bw, pps->second_chroma_qp_index_offset);
+    }
+    va_BitWriterTrailingBits(bw);
+}
+
+VAStatus vaWritePackedHeadersH264(
+    VAPackedHeaderWriter writer,
+    const VAEncSequenceParameterBufferH264 *seq_param,
+    const VAEncPictureParameterBufferH264 *pic_param,
+    VAPackedHeader *sequence_header,
+    VAPackedHeader *picture_header,
+    uint32_t *result
+)
+{
+    struct _VAPackedHeaderWriter *w = writer;
+    va_h264_pps_key key;
+    va_bitwriter bw;
+    uint32_t changed = 0;
+
+    if (!w || !seq_param || !pic_param || !result)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (w->hevc)
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+    *result = 0;
+
+    if (!seq_param->picture_width_in_mbs || !seq_param->picture_height_in_mbs ||
+        pic_param->pic_init_qp > 51 || pic_param->pic_fields.bits.weighted_bipred_idc > 2)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    if (!w->have_seq || memcmp(seq_param, &w->seq.h264, sizeof(*seq_param))) {
+        va_BitWriterInit(&bw, va_PackedSpare(&w->sequence), VA_PACKED_SEQUENCE_MAX, 1);
+        va_H264WriteSPS(w, seq_param, &bw);
+        if (bw.overflow)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        changed |= va_PackedCommit(&w->sequence, &bw, VA_PACKED_HEADER_SEQUENCE_CHANGED);
+        w->seq.h264 = *seq_param;
+        w->have_seq = 1;
+        /* the scaling lists signalled by the PPS depend on the chroma format */
+        w->have_pic = 0;
+    }
+
+    va_H264PPSKey(pic_param, &key);
+    if (!w->have_pic || memcmp(&key, &w->pic.h264, sizeof(key))) {
+        va_BitWriterInit(&bw, va_PackedSpare(&w->picture), VA_PACKED_PICTURE_MAX, 1);
+        va_H264WritePPS(&key, seq_param->seq_fields.bits.chroma_format_idc, &bw);
+        if (bw.overflow)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        changed |= va_PackedCommit(&w->picture, &bw, VA_PACKED_HEADER_PICTURE_CHANGED);
+        w->pic.h264 = key;
+        w->have_pic = 1;
+    }
+
+    va_PackedOutput(&w->sequence, VAEncPackedHeaderSequence, sequence_header);
+    va_PackedOutput(&w->picture, VAEncPackedHeaderPicture, picture_header);
+    *result = changed;
+    return VA_STATUS_SUCCESS;
+}
+
+static void va_HEVCWriteNALHeader(va_bitwriter *bw, unsigned int type)
+{
+    va_BitWriterStartCode(bw);
+    /* nuh_layer_id 0, nuh_temporal_id_plus1 1 */
+    va_BitWriterPut(bw, 16, (type << 9) | 1);
+}
+
+static void va_HEVCWriteProfileTierLevel(const VAEncSequenceParameterBufferHEVC *seq, va_bitwriter *bw)
+{
+    unsigned int profile_idc = seq->general_profile_idc;
+    unsigned int chroma_format_idc = seq->seq_fields.bits.chroma_format_idc;
+    unsigned int bit_depth = seq->seq_fields.bits.bit_depth_luma_minus8 > seq->seq_fields.bits.bit_depth_chroma_minus8 ?
+                             seq->seq_fields.bits.bit_depth_luma_minus8 + 8 : seq->seq_fields.bits.bit_depth_chroma_minus8 + 8;
+    uint32_t compatibility = 0x80000000U >> profile_idc;
+
+    /* a Main stream is also a Main 10 one */
+    if (profile_idc == 1)
+        compatibility |= 0x80000000U >> 2;
+
+    va_BitWriterPut(bw, 2, 0);                          /* general_profile_space */
+    va_BitWriterPutBit(bw, seq->general_tier_flag);
+    va_BitWriterPut(bw, 5, profile_idc);
+    va_BitWriterPut(bw, 32, compatibility);
+    va_BitWriterPutBit(bw, 1);                          /* general_progressive_source_flag */
+    va_BitWriterPutBit(bw, 0);                          /* general_interlaced_source_flag */
+    va_BitWriterPutBit(bw, 0);                          /* general_non_packed_constraint_flag */
+    va_BitWriterPutBit(bw, 1);                          /* general_frame_only_constraint_flag */
+    if (profile_idc >= 4) {
+        /* format range extensions constraint flags (A.3.5) */
+        va_BitWriterPutBit(bw, bit_depth <= 12);
+        va_BitWriterPutBit(bw, bit_depth <= 10);
+        va_BitWriterPutBit(bw, bit_depth <= 8);
+        va_BitWriterPutBit(bw, chroma_format_idc <= 2);
+        va_BitWriterPutBit(bw, chroma_format_idc <= 1);
+        va_BitWriterPutBit(bw, chroma_format_idc == 0);
+        va_BitWriterPutBit(bw, 0);                      /* general_intra_constraint_flag */
+        va_BitWriterPutBit(bw, 0);                      /* general_one_picture_only_constraint_flag */
+        va_BitWriterPutBit(bw, 1);                      /* general_lower_bit_rate_constraint_flag */
+        va_BitWriterPut(bw, 32, 0);
+        va_BitWriterPut(bw, 2, 0);
+    } else {
+        va_BitWriterPut(bw, 32, 0);
+        va_BitWriterPut(bw, 11, 0);
+    }
+    va_BitWriterPutBit(bw, 0);                          /* general_inbld_flag */
+    va_BitWriterPut(bw, 8, seq->general_level_idc);
+}
+
+static void va_HEVCWriteVPS(
+    const VAEncSequenceParameterBufferHEVC *seq,
+    unsigned int max_dec_pic_buffering_minus1,
+    unsigned int max_num_reorder_pics,
+    va_bitwriter *bw
+)
+{
+    va_HEVCWriteNALHeader(bw, HEVC_NAL_VPS);
+    va_BitWriterPut(bw, 4, 0);                          /* vps_video_parameter_set_id */
+    va_BitWriterPutBit(bw, 1);                          /* vps_base_layer_internal_flag */
+    va_BitWriterPutBit(bw, 1);                          /* vps_base_layer_available_flag */
+    va_BitWriterPut(bw, 6, 0);                          /* vps_max_layers_minus1 */
+    va_BitWriterPut(bw, 3, 0);                          /* vps_max_sub_layers_minus1 */
+    va_BitWriterPutBit(bw, 1);                          /* vps_temporal_id_nesting_flag */
+    va_BitWriterPut(bw, 16, 0xffff);                    /* vps_reserved_0xffff_16bits */
+    va_HEVCWriteProfileTierLevel(seq, bw);
+    va_BitWriterPutBit(bw, 0);                          /* vps_sub_layer_ordering_info_present_flag */
+    va_BitWriterPutUE(bw, max_dec_pic_buffering_minus1);
+    va_BitWriterPutUE(bw, max_num_reorder_pics);
+    va_BitWriterPutUE(bw, 0);                           /* vps_max_latency_increase_plus1 */
+    va_BitWriterPut(bw, 6, 0);                          /* vps_max_layer_id */
+    va_BitWriterPutUE(bw, 0);                           /* vps_num_layer_sets_minus1 */
+    va_BitWriterPutBit(bw, seq->vui_parameters_present_flag && seq->vui_fields.bits.vui_timing_info_present_flag);
+    if (seq->vui_parameters_present_flag && seq->vui_fields.bits.vui_timing_info_present_flag) {
+        va_BitWriterPut(bw, 32, seq->vui_num_units_in_tick);
+        va_BitWriterPut(bw, 32, seq->vui_time_scale);
+        va_BitWriterPutBit(bw, 0);                      /* vps_poc_proportional_to_timing_flag */
+        va_BitWriterPutUE(bw, 0);                       /* vps_num_hrd_parameters */
+    }
+    va_BitWriterPutBit(bw, 0);                          /* vps_extension_flag */
+    va_BitWriterTrailingBits(bw);
+}
+
+static void va_HEVCWriteSPS(
+    const struct _VAPackedHeaderWriter *w,
+    const VAEncSequenceParameterBufferHEVC *seq,
+    unsigned int max_dec_pic_buffering_minus1,
+    unsigned int max_num_reorder_pics,
+    va_bitwriter *bw
+)
+{
+    unsigned int chroma_format_idc = seq->seq_fields.bits.chroma_format_idc;
+    unsigned int sub_width = chroma_format_idc == 1 || chroma_format_idc == 2 ? 2 : 1;
+    unsigned int sub_height = chroma_format_idc == 1 ? 2 : 1;
+    unsigned int crop_right = 0, crop_bottom = 0;
+
+    if (w->options.display_width && w->options.display_width < seq->pic_width_in_luma_samples)
+        crop_right = (seq->pic_width_in_luma_samples - w->options.display_width) / sub_width;
+    if (w->options.display_height && w->options.display_height < seq->pic_height_in_luma_samples)
+        crop_bottom = (seq->pic_height_in_luma_samples - w->options.display_height) / sub_height;
+
+    va_HEVCWriteNALHeader(bw, HEVC_NAL_SPS);
+    va_BitWriterPut(bw, 4, 0);                          /* sps_video_parameter_set_id */
+    va_BitWriterPut(bw, 3, 0);                          /* sps_max_sub_layers_minus1 */
+    va_BitWriterPutBit(bw, 1);                          /* sps_temporal_id_nesting_flag */
+    va_HEVCWriteProfileTierLevel(seq, bw);
+    va_BitWriterPutUE(bw, 0);                           /* sps_seq_parameter_set_id */
+    va_BitWriterPutUE(bw, chroma_format_idc);
+    if (chroma_format_idc == 3)
+        va_BitWriterPutBit(bw, seq->seq_fields.bits.separate_colour_plane_flag);
+    va_BitWriterPutUE(bw, seq->pic_width_in_luma_samples);
+    va_BitWriterPutUE(bw, seq->pic_height_in_luma_samples);
+    va_BitWriterPutBit(bw, crop_right || crop_bottom);
+    if (crop_right || crop_bottom) {
+        va_BitWriterPutUE(bw, 0);
+        va_BitWriterPutUE(bw, crop_right);
+        va_BitWriterPutUE(bw, 0);
+        va_BitWriterPutUE(bw, crop_bottom);
+    }
+    va_BitWriterPutUE(bw, seq->seq_fields.bits.bit_depth_luma_minus8);
+    va_BitWriterPutUE(bw, seq->seq_fields.bits.bit_depth_chroma_minus8);
+    va_BitWriterPutUE(bw, w->options.log2_max_pic_order_cnt_lsb_minus4);
+    va_BitWriterPutBit(bw, 0);                          /* sps_sub_layer_ordering_info_present_flag */
+    va_BitWriterPutUE(bw, max_dec_pic_buffering_minus1);
+    va_BitWriterPutUE(bw, max_num_reorder_pics);
+    va_BitWriterPutUE(bw, 0);                           /* sps_max_latency_increase_plus1 */
+    va_BitWriterPutUE(bw, seq->log2_min_luma_coding_block_size_minus3);
+    va_BitWriterPutUE(bw, seq->log2_diff_max_min_luma_coding_block_size);
+    va_BitWriterPutUE(bw, seq->log2_min_transform_block_size_minus2);
+    va_BitWriterPutUE(bw, seq->log2_diff_max_min_transform_block_size);
+    va_BitWriterPutUE(bw, seq->max_transform_hierarchy_depth_inter);
+    va_BitWriterPutUE(bw, seq->max_transform_hierarchy_depth_intra);
+    va_BitWriterPutBit(bw, seq->seq_fields.bits.scaling_list_enabled_flag);
+    if (seq->seq_fields.bits.scaling_list_enabled_flag)
+        va_BitWriterPutBit(bw, 0);                      /* sps_scaling_list_data_present_flag */
+    va_BitWriterPutBit(bw, seq->seq_fields.bits.amp_enabled_flag);
+    va_BitWriterPutBit(bw, seq->seq_fields.bits.sample_adaptive_offset_enabled_flag);
+    va_BitWriterPutBit(bw, seq->seq_fields.bits.pcm_enabled_flag);
+    if (seq->seq_fields.bits.pcm_enabled_flag) {
+        va_BitWriterPut(bw, 4, seq->pcm_sample_bit_depth_luma_minus1);
+        va_BitWriterPut(bw, 4, seq->pcm_sample_bit_depth_chroma_minus1);
+        va_BitWriterPutUE(bw, seq->log2_min_pcm_luma_coding_block_size_minus3);
+        va_BitWriterPutUE(bw, seq->log2_max_pcm_luma_coding_block_size_minus3 -
+                          seq->log2_min_pcm_luma_coding_block_size_minus3);
+        va_BitWriterPutBit(bw, seq->seq_fields.bits.pcm_loop_filter_disabled_flag);
+    }
+    va_BitWriterPutUE(bw, 0);                           /* num_short_term_ref_pic_sets */
+    va_BitWriterPutBit(bw, 0);                          /* long_term_ref_pics_present_flag */
+    va_BitWriterPutBit(bw, seq->seq_fields.bits.sps_temporal_mvp_enabled_flag);
+    va_BitWriterPutBit(bw, seq->seq_fields.bits.strong_intra_smoothing_enabled_flag);
+
+    va_BitWriterPutBit(bw, seq->vui_parameters_present_flag);
+    if (seq->vui_parameters_present_flag) {
+        va_BitWriterPutBit(bw, seq->vui_fields.bits.aspect_ratio_info_present_flag);
+        if (seq->vui_fields.bits.aspect_ratio_info_present_flag) {
+            va_BitWriterPut(bw, 8, seq->aspect_ratio_idc);
+            if (seq->aspect_ratio_idc == 255) {
+                va_BitWriterPut(bw, 16, seq->sar_width);
+                va_BitWriterPut(bw, 16, seq->sar_height);
+            }
+        }
+        va_BitWriterPutBit(bw, 0);                      /* overscan_info_present_flag */
+        va_BitWriterPutBit(bw, 0);                      /* video_signal_type_present_flag */
+        va_BitWriterPutBit(bw, 0);                      /* chroma_loc_info_present_flag */
+        va_BitWriterPutBit(bw, seq->vui_fields.bits.neutral_chroma_indication_flag);
+        va_BitWriterPutBit(bw, seq->vui_fields.bits.field_seq_flag);
+        va_BitWriterPutBit(bw, 0);                      /* frame_field_info_present_flag */
+        va_BitWriterPutBit(bw, 0);                      /* default_display_window_flag */
+        va_BitWriterPutBit(bw, seq->vui_fields.bits.vui_timing_info_present_flag);
+        if (seq->vui_fields.bits.vui_timing_info_present_flag) {
+            va_BitWriterPut(bw, 32, seq->vui_num_units_in_tick);
+            va_BitWriterPut(bw, 32, seq->vui_time_scale);
+            va_BitWriterPutBit(bw, 0);                  /* vui_poc_proportional_to_timing_flag */
+            va_BitWriterPutBit(bw, 0);                  /* vui_hrd_parameters_present_flag */
+        }
+        va_BitWriterPutBit(bw, seq->vui_fields.bits.bitstream_restriction_flag);
+        if (seq->vui_fields.bits.bitstream_restriction_flag) {
+            va_BitWriterPutBit(bw, seq->vui_fields.bits.tiles_fixed_structure_flag);
+            va_BitWriterPutBit(bw, seq->vui_fields.bits.motion_vectors_over_pic_boundaries_flag);
+            va_BitWriterPutBit(bw, seq->vui_fields.bits.restricted_ref_pic_lists_flag);
+            va_BitWriterPutUE(bw, seq->min_spatial_segmentation_idc);
+            va_BitWriterPutUE(bw, seq->max_bytes_per_pic_denom);
+            va_BitWriterPutUE(bw, seq->max_bits_per_min_cu_denom);
+            va_BitWriterPutUE(bw, seq->vui_fields.bits.log2_max_mv_length_horizontal);
+            va_BitWriterPutUE(bw, seq->vui_fields.bits.log2_max_mv_length_vertical);
+        }
+    }
+    va_BitWriterPutBit(bw, 0);                          /* sps_extension_present_flag */
+    va_BitWriterTrailingBits(bw);
+}
+
+static void va_HEVCPPSKey(const VAEncPictureParameterBufferHEVC *pic, va_hevc_pps_key *key)
+{
+    memset(key, 0, sizeof(*key));
+    key->slice_pic_parameter_set_id = pic->slice_pic_parameter_set_id;
+    key->pic_init_qp = pic->pic_init_qp;
+    key->diff_cu_qp_delta_depth = pic->diff_cu_qp_delta_depth;
+    key->pps_cb_qp_offset = pic->pps_cb_qp_offset;
+    key->pps_cr_qp_offset = pic->pps_cr_qp_offset;
+    if (pic->pic_fields.bits.tiles_enabled_flag) {
+        key->num_tile_columns_minus1 = pic->num_tile_columns_minus1;
+        key->num_tile_rows_minus1 = pic->num_tile_rows_minus1;
+        memcpy(key->column_width_minus1, pic->column_width_minus1, sizeof(key->column_width_minus1));
+        memcpy(key->row_height_minus1, pic->row_height_minus1, sizeof(key->row_height_minus1));
+    }
+    key->log2_parallel_merge_level_minus2 = pic->log2_parallel_merge_level_minus2;
+    key->num_ref_idx_l0_default_active_minus1 = pic->num_ref_idx_l0_default_active_minus1;
+    key->num_ref_idx_l1_default_active_minus1 = pic->num_ref_idx_l1_default_active_minus1;
+    key->dependent_slice_segments_enabled_flag = pic->pic_fields.bits.dependent_slice_segments_enabled_flag;
+    key->sign_data_hiding_enabled_flag = pic->pic_fields.bits.sign_data_hiding_enabled_flag;
+    key->constrained_intra_pred_flag = pic->pic_fields.bits.constrained_intra_pred_flag;
+    key->transform_skip_enabled_flag = pic->pic_fields.bits.transform_skip_enabled_flag;
+    key->cu_qp_delta_enabled_flag = pic->pic_fields.bits.cu_qp_delta_enabled_flag;
+    key->weighted_pred_flag = pic->pic_fields.bits.weighted_pred_flag;
+    key->weighted_bipred_flag = pic->pic_fields.bits.weighted_bipred_flag;
+    key->transquant_bypass_enabled_flag = pic->pic_fields.bits.transquant_bypass_enabled_flag;
+    key->tiles_enabled_flag = pic->pic_fields.bits.tiles_enabled_flag;
+    key->entropy_coding_sync_enabled_flag = pic->pic_fields.bits.entropy_coding_sync_enabled_flag;
+    key->loop_filter_across_tiles_enabled_flag = pic->pic_fields.bits.loop_filter_across_tiles_enabled_flag;
+    key->pps_loop_filter_across_slices_enabled_flag = pic->pic_fields.bits.pps_loop_filter_across_slices_enabled_flag;
+}
+
+static void va_HEVCWritePPS(const va_hevc_pps_key *pps, va_bitwriter *bw)
+{
+    unsigned int i;
+
+    va_HEVCWriteNALHeader(bw, HEVC_NAL_PPS);
+    va_BitWriterPutUE(bw, pps->slice_pic_parameter_set_id);
+    va_BitWriterPutUE(bw, 0);                           /* pps_seq_parameter_set_id */
+    va_BitWriterPutBit(bw, pps->dependent_slice_segments_enabled_flag);
+    va_BitWriterPutBit(bw, 0);                          /* output_flag_present_flag */
+    va_BitWriterPut(bw, 3, 0);                          /* num_extra_slice_header_bits */
+    va_BitWriterPutBit(bw, pps->sign_data_hiding_enabled_flag);
+    va_BitWriterPutBit(bw, 0);                          /* cabac_init_present_flag */
+    va_BitWriterPutUE(bw, pps->num_ref_idx_l0_default_active_minus1);
+    va_BitWriterPutUE(bw, pps->num_ref_idx_l1_default_active_minus1);
+    va_BitWriterPutSE(bw, (int)pps->pic_init_qp - 26);
+    va_BitWriterPutBit(bw, pps->constrained_intra_pred_flag);
+    va_BitWriterPutBit(bw, pps->transform_skip_enabled_flag);
+    va_BitWriterPutBit(bw, pps->cu_qp_delta_enabled_flag);
+    if (pps->cu_qp_delta_enabled_flag)
+        va_BitWriterPutUE(bw, pps->diff_cu_qp_delta_depth);
+    va_BitWriterPutSE(bw, pps->pps_cb_qp_offset);
+    va_BitWriterPutSE(bw, pps->pps_cr_qp_offset);
+    va_BitWriterPutBit(bw, 0);                          /* pps_slice_chroma_qp_offsets_present_flag */
+    va_BitWriterPutBit(bw, pps->weighted_pred_flag);
+    va_BitWriterPutBit(bw, pps->weighted_bipred_flag);
+    va_BitWriterPutBit(bw, pps->transquant_bypass_enabled_flag);
+    va_BitWriterPutBit(bw, pps->tiles_enabled_flag);
+    va_BitWriterPutBit(bw, pps->entropy_coding_sync_enabled_flag);
+    if (pps->tiles_enabled_flag) {
+        va_BitWriterPutUE(bw, pps->num_tile_columns_minus1);
+        va_BitWriterPutUE(bw, pps->num_tile_rows_minus1);
+        va_BitWriterPutBit(bw, 0);                      /* uniform_spacing_flag */
+        for (i = 0; i < pps->num_tile_columns_minus1; i++)
+            va_BitWriterPutUE(bw, pps->column_width_minus1[i]);
+        for (i = 0; i < pps->num_tile_rows_minus1; i++)
+            va_BitWriterPutUE(bw, pps->row_height_minus1[i]);
+        va_BitWriterPutBit(bw, pps->loop_filter_across_tiles_enabled_flag);
+    }
+    va_BitWriterPutBit(bw, pps->pps_loop_filter_across_slices_enabled_flag);
+    va_BitWriterPutBit(bw, 0);                          /* deblocking_filter_control_present_flag */
+    va_BitWriterPutBit(bw, 0);                          /* pps_scaling_list_data_present_flag */
+    va_BitWriterPutBit(bw, 0);                          /* lists_modification_present_flag */
+    va_BitWriterPutUE(bw, pps->log2_parallel_merge_level_minus2);
+    va_BitWriterPutBit(bw, 0);                          /* slice_segment_header_extension_present_flag */
+    va_BitWriterPutBit(bw, 0);                          /* pps_extension_present_flag */
+    va_BitWriterTrailingBits(bw);
+}
+
+VAStatus vaWritePackedHeadersHEVC(
+    VAPackedHeaderWriter writer,
+    const VAEncSequenceParameterBufferHEVC *seq_param,
+    const VAEncPictureParameterBufferHEVC *pic_param,
+    VAPackedHeader *sequence_header,
+    VAPackedHeader *picture_header,
+    uint32_t *result
+)
+{
+    struct _VAPackedHeaderWriter *w = writer;
+    va_hevc_pps_key key;
+    va_bitwriter bw;
+    uint32_t changed = 0;
+
+    if (!w || !seq_param || !pic_param || !result)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (!w->hevc)
+        return VA_STATUS_ERROR_INVALID_CONTEXT;
+    *result = 0;
+
+    if (!seq_param->general_profile_idc || seq_param->general_profile_idc > 31 ||
+        !seq_param->pic_width_in_luma_samples || !seq_param->pic_height_in_luma_samples ||
+        seq_param->log2_max_pcm_luma_coding_block_size_minus3 < seq_param->log2_min_pcm_luma_coding_block_size_minus3 ||
+        pic_param->pic_init_qp > 51 ||
+        (pic_param->pic_fields.bits.tiles_enabled_flag &&
+         (pic_param->num_tile_columns_minus1 > 19 || pic_param->num_tile_rows_minus1 > 21)))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (seq_param->scc_fields.bits.palette_mode_enabled_flag || pic_param->scc_fields.bits.pps_curr_pic_ref_enabled_flag)
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+
+    if (!w->have_seq || memcmp(seq_param, &w->seq.hevc, sizeof(*seq_param))) {
+        unsigned int reorder = va_PackedReorderFrames(&w->options, seq_param->ip_period);
+        unsigned int dpb = w->options.max_dec_pic_buffering_minus1 ? w->options.max_dec_pic_buffering_minus1 : reorder + 1;
+
+        va_BitWriterInit(&bw, va_PackedSpare(&w->sequence), VA_PACKED_SEQUENCE_MAX, 1);
+        va_HEVCWriteVPS(seq_param, dpb, reorder, &bw);
+        va_HEVCWriteSPS(w, seq_param, dpb, reorder, &bw);
+        if (bw.overflow)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        changed |= va_PackedCommit(&w->sequence, &bw, VA_PACKED_HEADER_SEQUENCE_CHANGED);
+        w->seq.hevc = *seq_param;
+        w->have_seq = 1;
+    }
+
+    va_HEVCPPSKey(pic_param, &key);
+    if (!w->have_pic || memcmp(&key, &w->pic.hevc, sizeof(key))) {
+        va_BitWriterInit(&bw, va_PackedSpare(&w->picture), VA_PACKED_PICTURE_MAX, 1);
+        va_HEVCWritePPS(&key, &bw);
+        if (bw.overflow)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        changed |= va_PackedCommit(&w->picture, &bw, VA_PACKED_HEADER_PICTURE_CHANGED);
+        w->pic.hevc = key;
+        w->have_pic = 1;
+    }
+
+    va_PackedOutput(&w->sequence, VAEncPackedHeaderSequence, sequence_header);
+    va_PackedOutput(&w->picture, VAEncPackedHeaderPicture, picture_header);
+    *result = changed;
+    return VA_STATUS_SUCCESS;
+}
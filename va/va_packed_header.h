@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_packed_header.h
+ * \brief Packed header generation for H.264 and HEVC encode
+ *
+ * Drivers that do not write the parameter sets themselves (see
+ * VAConfigAttribEncPackedHeaders) expect the application to pass them as
+ * a VAEncPackedHeaderParameterBufferType buffer and a
+ * VAEncPackedHeaderDataBufferType buffer. The functions in this file
+ * write the H.264 SPS and PPS, and the HEVC VPS, SPS and PPS, from the
+ * sequence and picture parameter buffers that the application renders
+ * anyway, so the two always agree.
+ *
+ * The headers are only written again when the parameters they depend on
+ * change. The picture parameters change with every picture but the
+ * picture parameter set usually does not: the writer compares the fields
+ * that go into each header with those of the previous call and, when
+ * they are the same, returns the bytes it already has. The application
+ * can also keep its VA buffers for the headers while the
+ * VA_PACKED_HEADER_xxx_CHANGED flags are not set.
+ *
+ * The choices that slice headers depend on are fixed:
+ * - H.264: no slice groups, pic_init_qs equal to 26, no VUI HRD
+ *   parameters;
+ * - HEVC: VPS, SPS and PPS with identifier 0 (except
+ *   slice_pic_parameter_set_id for the PPS), a single temporal layer,
+ *   short term reference picture sets in the slice headers only, no long
+ *   term reference pictures, no extra slice header bits, no slice level
+ *   chroma QP offsets, deblocking and cabac_init_flag controls or list
+ *   modifications, and no VUI HRD parameters.
+ *
+ * Scaling matrices that are enabled are signalled as not present in the
+ * parameter sets, that is the default matrices of the H.264 and HEVC
+ * specifications (or, for the H.264 PPS, the ones of the SPS).
+ */
+
+#ifndef _VA_PACKED_HEADER_H_
+#define _VA_PACKED_HEADER_H_
+
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_packed_header Packed header generation
+ *
+ * @{
+ */
+
+/** \brief Opaque packed header writer state. */
+typedef struct _VAPackedHeaderWriter *VAPackedHeaderWriter;
+
+/** \brief Settings of the stream that the VA parameter buffers lack. */
+typedef struct _VAPackedHeaderOptions {
+    /**
+     * \brief max_num_reorder_frames (H.264 VUI bitstream restriction) or
+     * sps_max_num_reorder_pics (HEVC), 0xff for the default of 1 if
+     * ip_period is above 1 and 0 otherwise, which holds for B frames
+     * that are not used as references.
+     */
+    uint8_t max_num_reorder_frames;
+    /**
+     * \brief HEVC sps_max_dec_pic_buffering_minus1, 0 for
+     * max_num_reorder_frames + 1 (the reference frames of a P or B
+     * frame).
+     */
+    uint8_t max_dec_pic_buffering_minus1;
+    /** \brief HEVC log2_max_pic_order_cnt_lsb_minus4. */
+    uint8_t log2_max_pic_order_cnt_lsb_minus4;
+    /**
+     * \brief HEVC size of the output pictures, signalled as a conformance
+     * window when smaller than the coded size, 0 for the coded size.
+     */
+    uint16_t display_width;
+    uint16_t display_height;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VAPackedHeaderOptions;
+
+/** \brief A packed header. */
+typedef struct _VAPackedHeader {
+    /**
+     * \brief Content of the VAEncPackedHeaderParameterBufferType buffer:
+     * type, bit_length and has_emulation_bytes (always 1).
+     */
+    VAEncPackedHeaderParameterBuffer param;
+    /**
+     * \brief Content of the VAEncPackedHeaderDataBufferType buffer: the
+     * NAL units with their start codes, (bit_length + 7) / 8 bytes. The
+     * data belongs to the writer and stays valid until the header
+     * changes.
+     */
+    const uint8_t *data;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VAPackedHeader;
+
+/**
+ * \brief Creates a packed header writer.
+ *
+ * @param[in] profile   an H.264 profile, or an HEVC profile other than the
+ *                      screen content coding ones
+ * @param[in] options   stream settings, may be NULL for the defaults
+ */
+VAStatus vaCreatePackedHeaderWriter(
+    VAProfile profile,
+    const VAPackedHeaderOptions *options,
+    VAPackedHeaderWriter *writer            /* out */
+);
+
+/** \brief Destroys a packed header writer. */
+VAStatus vaDestroyPackedHeaderWriter(VAPackedHeaderWriter writer);
+
+/** \brief The sequence header differs from the one of the previous call. */
+#define VA_PACKED_HEADER_SEQUENCE_CHANGED       0x00000001
+/** \brief The picture header differs from the one of the previous call. */
+#define VA_PACKED_HEADER_PICTURE_CHANGED        0x00000002
+
+/**
+ * \brief Writes the H.264 parameter sets of a picture.
+ *
+ * The sequence header (VAEncPackedHeaderSequence) holds the SPS and the
+ * picture header (VAEncPackedHeaderPicture) the PPS. Either may be NULL
+ * when only the other one is wanted.
+ *
+ * @param[out] result   combination of VA_PACKED_HEADER_xxx_CHANGED
+ * @return VA_STATUS_ERROR_INVALID_CONTEXT if the writer was created for
+ *         an HEVC profile, VA_STATUS_ERROR_INVALID_PARAMETER if a value
+ *         cannot be coded
+ */
+VAStatus vaWritePackedHeadersH264(
+    VAPackedHeaderWriter writer,
+    const VAEncSequenceParameterBufferH264 *seq_param,
+    const VAEncPictureParameterBufferH264 *pic_param,
+    VAPackedHeader *sequence_header,        /* out */
+    VAPackedHeader *picture_header,         /* out */
+    uint32_t *result                        /* out */
+);
+
+/**
+ * \brief Writes the HEVC parameter sets of a picture.
+ *
+ * The sequence header (VAEncPackedHeaderSequence) holds the VPS and the
+ * SPS, and the picture header (VAEncPackedHeaderPicture) the PPS. Either
+ * may be NULL when only the other one is wanted.
+ *
+ * @param[out] result   combination of VA_PACKED_HEADER_xxx_CHANGED
+ * @return VA_STATUS_ERROR_INVALID_CONTEXT if the writer was created for
+ *         an H.264 profile, VA_STATUS_ERROR_INVALID_PARAMETER if a value
+ *         cannot be coded
+ */
+VAStatus vaWritePackedHeadersHEVC(
+    VAPackedHeaderWriter writer,
+    const VAEncSequenceParameterBufferHEVC *seq_param,
+    const VAEncPictureParameterBufferHEVC *pic_param,
+    VAPackedHeader *sequence_header,        /* out */
+    VAPackedHeader *picture_header,         /* out */
+    uint32_t *result                        /* out */
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_PACKED_HEADER_H_ */
@@ -0,0 +1,586 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_params.hpp
+ * \brief C++17 builders for the VA parameter buffers
+ *
+ * Header-only helpers for C++ applications filling the parameter
+ * structures of va.h, va_enc_*.h, va_dec_*.h and va_vpp.h:
+ *
+ * - every supported structure is tied at compile time to the buffer type
+ *   it is created with, so that a VAEncPictureParameterBufferHEVC cannot
+ *   be sent as a sequence parameter buffer, nor a rate control misc
+ *   parameter with the wrong VAEncMiscParameterType;
+ * - the layout of these structures is checked with static_assert: they
+ *   must stay plain C structures, slice parameters must start with the
+ *   VASliceParameterBufferBase fields, the bit field unions must not be
+ *   wider than their \c value member, and on LP64 targets the size of
+ *   each structure is pinned to the ABI, so that a header change or an
+ *   unusual packing option is caught at build time rather than by the
+ *   driver;
+ * - va::param builds a zero-initialized structure, possibly as a
+ *   constant expression;
+ * - va::param_arena stages all the parameter buffers of a frame in one
+ *   contiguous block of memory and creates them in one call, through the
+ *   buffer pool of va_pool.h.
+ *
+ * All the checks are done by the compiler; at run time the arena only
+ * copies bytes.
+ *
+ * Usage:
+ * \code
+ * constexpr auto rc = va::make_param<VAEncMiscParameterRateControl>([](auto &p) {
+ *     p.bits_per_second = 4000000;
+ *     p.target_percentage = 90;
+ * });
+ *
+ * va::param<VAEncPictureParameterBufferHEVC> pic;
+ * pic->pic_init_qp = 26;
+ * pic->pic_fields.bits.coding_type = 1;
+ *
+ * arena.clear();
+ * arena.add(rc);
+ * arena.add(pic);
+ * arena.add(slices, num_slices);
+ * arena.create(dpy, context);
+ * vaBeginPicture(dpy, context, surface);
+ * arena.render(dpy, context);
+ * vaEndPicture(dpy, context);
+ * arena.release(dpy);
+ * \endcode
+ */
+
+#ifndef _VA_PARAMS_HPP_
+#define _VA_PARAMS_HPP_
+
+#if defined(_MSVC_LANG)
+#define VA_PARAMS_CPLUSPLUS _MSVC_LANG
+#elif defined(__cplusplus)
+#define VA_PARAMS_CPLUSPLUS __cplusplus
+#else
+#define VA_PARAMS_CPLUSPLUS 0L
+#endif
+
+#if VA_PARAMS_CPLUSPLUS < 201703L
+#error "va_params.hpp requires C++17"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <va/va.h>
+#include <va/va_pool.h>
+#include <va/va_packed_header.h>
+
+/* the reference sizes below are those of the LP64 ABI */
+#if defined(__LP64__) || defined(_LP64)
+#define VA_PARAMS_LP64 1
+#else
+#define VA_PARAMS_LP64 0
+#endif
+
+namespace va
+{
+
+/**
+ * \defgroup api_params C++ parameter buffers
+ *
+ * @{
+ */
+
+/** \brief Buffer type of a parameter structure, \c type is the VABufferType. */
+template <typename T>
+struct buffer_traits {};
+
+/** \brief Sub-type of a VAEncMiscParameterBufferType payload. */
+template <typename T>
+struct misc_traits {};
+
+/** \brief Filter of a VAProcFilterParameterBufferType structure. */
+template <typename T>
+struct filter_traits {};
+
+/** \brief Whether \c T has a known buffer type. */
+template <typename T, typename = void>
+struct has_buffer_type : std::false_type {};
+
+template <typename T>
+struct has_buffer_type<T, std::void_t<decltype(buffer_traits<T>::type)>> : std::true_type {};
+
+/** \brief Whether \c T is the payload of a misc parameter buffer. */
+template <typename T, typename = void>
+struct is_misc_param : std::false_type {};
+
+template <typename T>
+struct is_misc_param<T, std::void_t<decltype(misc_traits<T>::type)>> : std::true_type {};
+
+/** \brief Whether \c T is a filter parameter structure with a known filter. */
+template <typename T, typename = void>
+struct is_filter_param : std::false_type {};
+
+template <typename T>
+struct is_filter_param<T, std::void_t<decltype(filter_traits<T>::type)>> : std::true_type {};
+
+#define VA_PARAMS_BUFFER(T, buffer_type, lp64_size)                         \
+    template <>                                                             \
+    struct buffer_traits<T> {                                               \
+        static constexpr VABufferType type = buffer_type;                   \
+    };                                                                      \
+    static_assert(std::is_standard_layout<T>::value &&                      \
+                  std::is_trivially_copyable<T>::value,                     \
+                  #T " is not a plain C structure");                        \
+    static_assert(!VA_PARAMS_LP64 || sizeof(T) == (lp64_size),              \
+                  "the size of " #T " differs from the ABI")
+
+#define VA_PARAMS_SLICE(T, buffer_type, lp64_size)                          \
+    VA_PARAMS_BUFFER(T, buffer_type, lp64_size);                            \
+    static_assert(offsetof(T, slice_data_size) ==                           \
+                  offsetof(VASliceParameterBufferBase, slice_data_size) &&  \
+                  offsetof(T, slice_data_offset) ==                         \
+                  offsetof(VASliceParameterBufferBase, slice_data_offset) && \
+                  offsetof(T, slice_data_flag) ==                           \
+                  offsetof(VASliceParameterBufferBase, slice_data_flag),    \
+                  #T " does not start with VASliceParameterBufferBase")
+
+#define VA_PARAMS_MISC(T, misc_type, lp64_size)                             \
+    VA_PARAMS_BUFFER(T, VAEncMiscParameterBufferType, lp64_size);           \
+    template <>                                                             \
+    struct misc_traits<T> {                                                 \
+        static constexpr VAEncMiscParameterType type = misc_type;           \
+    }
+
+#define VA_PARAMS_FILTER(T, filter_type, lp64_size)                         \
+    VA_PARAMS_BUFFER(T, VAProcFilterParameterBufferType, lp64_size);        \
+    static_assert(offsetof(T, type) == 0, #T " does not start with its type"); \
+    template <>                                                             \
+    struct filter_traits<T> {                                               \
+        static constexpr VAProcFilterType type = filter_type;               \
+    }
+
+#define VA_PARAMS_FLAGS(T, member)                                          \
+    static_assert(sizeof(((T *)nullptr)->member) ==                         \
+                  sizeof(((T *)nullptr)->member.value),                     \
+                  "the bit fields of " #T "::" #member " overflow its value")
+
+/* decode */
+VA_PARAMS_BUFFER(VAPictureParameterBufferMPEG2, VAPictureParameterBufferType, 40);
+VA_PARAMS_BUFFER(VAIQMatrixBufferMPEG2, VAIQMatrixBufferType, 288);
+VA_PARAMS_SLICE(VASliceParameterBufferMPEG2, VASliceParameterBufferType, 48);
+VA_PARAMS_BUFFER(VAPictureParameterBufferMPEG4, VAPictureParameterBufferType, 64);
+VA_PARAMS_BUFFER(VAIQMatrixBufferMPEG4, VAIQMatrixBufferType, 152);
+VA_PARAMS_SLICE(VASliceParameterBufferMPEG4, VASliceParameterBufferType, 40);
+VA_PARAMS_BUFFER(VAPictureParameterBufferVC1, VAPictureParameterBufferType, 104);
+VA_PARAMS_SLICE(VASliceParameterBufferVC1, VASliceParameterBufferType, 36);
+VA_PARAMS_BUFFER(VAPictureParameterBufferH264, VAPictureParameterBufferType, 672);
+VA_PARAMS_BUFFER(VAIQMatrixBufferH264, VAIQMatrixBufferType, 240);
+VA_PARAMS_SLICE(VASliceParameterBufferH264, VASliceParameterBufferType, 3128);
+VA_PARAMS_BUFFER(VAPictureParameterBufferHEVC, VAPictureParameterBufferType, 604);
+VA_PARAMS_BUFFER(VAPictureParameterBufferHEVCExtension, VAPictureParameterBufferType, 1408);
+VA_PARAMS_BUFFER(VAIQMatrixBufferHEVC, VAIQMatrixBufferType, 1016);
+VA_PARAMS_SLICE(VASliceParameterBufferHEVC, VASliceParameterBufferType, 264);
+VA_PARAMS_BUFFER(VASliceParameterBufferHEVCExtension, VASliceParameterBufferType, 452);
+VA_PARAMS_BUFFER(VAPictureParameterBufferJPEGBaseline, VAPictureParameterBufferType, 1060);
+VA_PARAMS_BUFFER(VAIQMatrixBufferJPEGBaseline, VAIQMatrixBufferType, 276);
+VA_PARAMS_BUFFER(VAHuffmanTableBufferJPEGBaseline, VAHuffmanTableBufferType, 436);
+VA_PARAMS_SLICE(VASliceParameterBufferJPEGBaseline, VASliceParameterBufferType, 56);
+VA_PARAMS_BUFFER(VAPictureParameterBufferVP8, VAPictureParameterBufferType, 112);
+VA_PARAMS_BUFFER(VAIQMatrixBufferVP8, VAIQMatrixBufferType, 64);
+VA_PARAMS_BUFFER(VAProbabilityDataBufferVP8, VAProbabilityBufferType, 1072);
+VA_PARAMS_SLICE(VASliceParameterBufferVP8, VASliceParameterBufferType, 72);
+VA_PARAMS_BUFFER(VADecPictureParameterBufferVP9, VAPictureParameterBufferType, 92);
+VA_PARAMS_SLICE(VASliceParameterBufferVP9, VASliceParameterBufferType, 316);
+VA_PARAMS_BUFFER(VADecPictureParameterBufferAV1, VAPictureParameterBufferType, 1160);
+VA_PARAMS_SLICE(VASliceParameterBufferAV1, VASliceParameterBufferType, 40);
+
+static_assert(offsetof(VASliceParameterBufferHEVCExtension, base) == 0,
+              "VASliceParameterBufferHEVCExtension does not start with VASliceParameterBufferHEVC");
+VA_PARAMS_FLAGS(VAPictureParameterBufferHEVC, pic_fields);
+VA_PARAMS_FLAGS(VAPictureParameterBufferHEVC, slice_parsing_fields);
+VA_PARAMS_FLAGS(VAPictureParameterBufferHEVCRext, range_extension_pic_fields);
+VA_PARAMS_FLAGS(VAPictureParameterBufferHEVCScc, screen_content_pic_fields);
+VA_PARAMS_FLAGS(VASliceParameterBufferHEVCRext, slice_ext_flags);
+VA_PARAMS_FLAGS(VADecPictureParameterBufferVP9, pic_fields);
+VA_PARAMS_FLAGS(VADecPictureParameterBufferAV1, seq_info_fields);
+VA_PARAMS_FLAGS(VADecPictureParameterBufferAV1, pic_info_fields);
+VA_PARAMS_FLAGS(VADecPictureParameterBufferAV1, loop_filter_info_fields);
+VA_PARAMS_FLAGS(VADecPictureParameterBufferAV1, qmatrix_fields);
+VA_PARAMS_FLAGS(VADecPictureParameterBufferAV1, mode_control_fields);
+VA_PARAMS_FLAGS(VADecPictureParameterBufferAV1, loop_restoration_fields);
+
+/* encode */
+VA_PARAMS_BUFFER(VAEncSequenceParameterBufferH264, VAEncSequenceParameterBufferType, 1132);
+VA_PARAMS_BUFFER(VAEncPictureParameterBufferH264, VAEncPictureParameterBufferType, 648);
+VA_PARAMS_BUFFER(VAEncSliceParameterBufferH264, VAEncSliceParameterBufferType, 3140);
+VA_PARAMS_BUFFER(VAEncQPBufferH264, VAEncQPBufferType, 1);
+VA_PARAMS_BUFFER(VAEncMacroblockParameterBufferH264, VAEncMacroblockParameterBufferType, 24);
+VA_PARAMS_BUFFER(VAEncSequenceParameterBufferHEVC, VAEncSequenceParameterBufferType, 116);
+VA_PARAMS_BUFFER(VAEncPictureParameterBufferHEVC, VAEncPictureParameterBufferType, 576);
+VA_PARAMS_BUFFER(VAEncSliceParameterBufferHEVC, VAEncSliceParameterBufferType, 1076);
+VA_PARAMS_BUFFER(VAQMatrixBufferHEVC, VAQMatrixBufferType, 1016);
+VA_PARAMS_BUFFER(VAEncPictureParameterBufferJPEG, VAEncPictureParameterBufferType, 48);
+VA_PARAMS_BUFFER(VAEncSliceParameterBufferJPEG, VAEncSliceParameterBufferType, 32);
+VA_PARAMS_BUFFER(VAQMatrixBufferJPEG, VAQMatrixBufferType, 152);
+VA_PARAMS_BUFFER(VAEncSequenceParameterBufferMPEG2, VAEncSequenceParameterBufferType, 56);
+VA_PARAMS_BUFFER(VAEncPictureParameterBufferMPEG2, VAEncPictureParameterBufferType, 60);
+VA_PARAMS_BUFFER(VAEncSliceParameterBufferMPEG2, VAEncSliceParameterBufferType, 32);
+VA_PARAMS_BUFFER(VAEncSequenceParameterBufferVP8, VAEncSequenceParameterBufferType, 72);
+VA_PARAMS_BUFFER(VAEncPictureParameterBufferVP8, VAEncPictureParameterBufferType, 60);
+VA_PARAMS_BUFFER(VAQMatrixBufferVP8, VAQMatrixBufferType, 36);
+VA_PARAMS_BUFFER(VAEncMBMapBufferVP8, VAEncMacroblockMapBufferType, 32);
+VA_PARAMS_BUFFER(VAEncSequenceParameterBufferVP9, VAEncSequenceParameterBufferType, 44);
+VA_PARAMS_BUFFER(VAEncPictureParameterBufferVP9, VAEncPictureParameterBufferType, 132);
+VA_PARAMS_BUFFER(VAEncMiscParameterTypeVP9PerSegmantParam, VAQMatrixBufferType, 176);
+VA_PARAMS_BUFFER(VAEncPackedHeaderParameterBuffer, VAEncPackedHeaderParameterBufferType, 28);
+
+VA_PARAMS_FLAGS(VAEncSequenceParameterBufferH264, seq_fields);
+VA_PARAMS_FLAGS(VAEncSequenceParameterBufferH264, vui_fields);
+VA_PARAMS_FLAGS(VAEncPictureParameterBufferH264, pic_fields);
+VA_PARAMS_FLAGS(VAEncSequenceParameterBufferHEVC, seq_fields);
+VA_PARAMS_FLAGS(VAEncSequenceParameterBufferHEVC, vui_fields);
+VA_PARAMS_FLAGS(VAEncSequenceParameterBufferHEVC, scc_fields);
+VA_PARAMS_FLAGS(VAEncPictureParameterBufferHEVC, pic_fields);
+VA_PARAMS_FLAGS(VAEncPictureParameterBufferHEVC, scc_fields);
+VA_PARAMS_FLAGS(VAEncSliceParameterBufferHEVC, slice_fields);
+VA_PARAMS_FLAGS(VAEncPictureParameterBufferVP9, ref_flags);
+VA_PARAMS_FLAGS(VAEncPictureParameterBufferVP9, pic_flags);
+
+/* misc parameters */
+VA_PARAMS_MISC(VAEncMiscParameterFrameRate, VAEncMiscParameterTypeFrameRate, 24);
+VA_PARAMS_MISC(VAEncMiscParameterRateControl, VAEncMiscParameterTypeRateControl, 60);
+VA_PARAMS_MISC(VAEncMiscParameterMaxSliceSize, VAEncMiscParameterTypeMaxSliceSize, 20);
+VA_PARAMS_MISC(VAEncMiscParameterAIR, VAEncMiscParameterTypeAIR, 28);
+VA_PARAMS_MISC(VAEncMiscParameterBufferMaxFrameSize, VAEncMiscParameterTypeMaxFrameSize, 24);
+VA_PARAMS_MISC(VAEncMiscParameterHRD, VAEncMiscParameterTypeHRD, 24);
+VA_PARAMS_MISC(VAEncMiscParameterBufferQualityLevel, VAEncMiscParameterTypeQualityLevel, 20);
+VA_PARAMS_MISC(VAEncMiscParameterRIR, VAEncMiscParameterTypeRIR, 28);
+VA_PARAMS_MISC(VAEncMiscParameterQuantization, VAEncMiscParameterTypeQuantization, 8);
+VA_PARAMS_MISC(VAEncMiscParameterSkipFrame, VAEncMiscParameterTypeSkipFrame, 24);
+VA_PARAMS_MISC(VAEncMiscParameterBufferROI, VAEncMiscParameterTypeROI, 40);
+VA_PARAMS_MISC(VAEncMiscParameterBufferMultiPassFrameSize, VAEncMiscParameterTypeMultiPassFrameSize, 56);
+VA_PARAMS_MISC(VAEncMiscParameterTemporalLayerStructure, VAEncMiscParameterTypeTemporalLayerStructure, 152);
+VA_PARAMS_MISC(VAEncMiscParameterBufferDirtyRect, VAEncMiscParameterTypeDirtyRect, 16);
+VA_PARAMS_MISC(VAEncMiscParameterParallelRateControl, VAEncMiscParameterTypeParallelBRC, 16);
+VA_PARAMS_MISC(VAEncMiscParameterSubMbPartPelH264, VAEncMiscParameterTypeSubMbPartPel, 16);
+VA_PARAMS_MISC(VAEncMiscParameterEncQuality, VAEncMiscParameterTypeEncQuality, 224);
+VA_PARAMS_MISC(VAEncMiscParameterCustomRoundingControl, VAEncMiscParameterTypeCustomRoundingControl, 4);
+VA_PARAMS_MISC(VAEncMiscParameterExtensionDataSeqDisplayMPEG2, VAEncMiscParameterTypeExtensionData, 10);
+
+/* video processing; VAProcFilterParameterBuffer serves several filters */
+VA_PARAMS_BUFFER(VAProcPipelineParameterBuffer, VAProcPipelineParameterBufferType, 224);
+VA_PARAMS_BUFFER(VAProcFilterParameterBuffer, VAProcFilterParameterBufferType, 24);
+VA_PARAMS_FILTER(VAProcFilterParameterBufferDeinterlacing, VAProcFilterDeinterlacing, 28);
+VA_PARAMS_FILTER(VAProcFilterParameterBufferColorBalance, VAProcFilterColorBalance, 28);
+VA_PARAMS_FILTER(VAProcFilterParameterBufferTotalColorCorrection, VAProcFilterTotalColorCorrection, 12);
+VA_PARAMS_FILTER(VAProcFilterParameterBufferHVSNoiseReduction, VAProcFilterHVSNoiseReduction, 40);
+VA_PARAMS_FILTER(VAProcFilterParameterBufferHDRToneMapping, VAProcFilterHighDynamicRangeToneMapping, 112);
+VA_PARAMS_FILTER(VAProcFilterParameterBuffer3DLUT, VAProcFilter3DLUT, 88);
+
+/* other */
+VA_PARAMS_BUFFER(VAContextParameterUpdateBuffer, VAContextParameterUpdateBufferType, 40);
+VA_PARAMS_BUFFER(VAEncryptionParameters, VAEncryptionParameterBufferType, 200);
+
+#undef VA_PARAMS_BUFFER
+#undef VA_PARAMS_SLICE
+#undef VA_PARAMS_MISC
+#undef VA_PARAMS_FILTER
+#undef VA_PARAMS_FLAGS
+
+/**
+ * \brief A parameter structure tied to its buffer type.
+ *
+ * The structure is zero-initialized, reserved fields included, and the
+ * \c type of the VPP filter structures is set. The members are reached
+ * with \c -> or get(), or through set() which can chain changes in a
+ * constant expression. A param<T> has the size and layout of \c T.
+ */
+template <typename T>
+class param
+{
+    static_assert(has_buffer_type<T>::value,
+                  "no buffer type is known for this structure, "
+                  "use param_arena::add() with an explicit buffer type");
+
+public:
+    typedef T value_type;
+
+    /** \brief Buffer type of the structure. */
+    static constexpr VABufferType buffer_type = buffer_traits<T>::type;
+
+    constexpr param() noexcept : value_()
+    {
+        set_filter_type();
+    }
+
+    constexpr explicit param(const T &value) noexcept : value_(value)
+    {
+        set_filter_type();
+    }
+
+    /** \brief Calls \c f with a reference to the structure. */
+    template <typename F>
+    constexpr param &set(F &&f) &
+    {
+        std::forward<F>(f)(value_);
+        return *this;
+    }
+
+    template <typename F>
+    constexpr param set(F &&f) &&
+    {
+        std::forward<F>(f)(value_);
+        return std::move(*this);
+    }
+
+    constexpr T &get() noexcept
+    {
+        return value_;
+    }
+
+    constexpr const T &get() const noexcept
+    {
+        return value_;
+    }
+
+    constexpr T *operator->() noexcept
+    {
+        return &value_;
+    }
+
+    constexpr const T *operator->() const noexcept
+    {
+        return &value_;
+    }
+
+private:
+    constexpr void set_filter_type() noexcept
+    {
+        if constexpr (is_filter_param<T>::value)
+            value_.type = filter_traits<T>::type;
+    }
+
+    T value_;
+};
+
+/** \brief Builds a param<T> with \c f, in a constant expression if \c f allows it. */
+template <typename T, typename F>
+constexpr param<T> make_param(F &&f)
+{
+    param<T> p;
+    p.set(std::forward<F>(f));
+    return p;
+}
+
+/**
+ * \brief Staging area for the parameter buffers of a frame.
+ *
+ * The buffers added are copied one after the other into a single block
+ * of memory, which keeps its capacity across clear(), so that a steady
+ * state of frames does not allocate. create() then creates all of them
+ * with vaCreatePooledBuffer(), and release() hands them back to the pool
+ * once vaEndPicture() has been called.
+ *
+ * Pointers held by the structures, such as the regions and references of
+ * VAProcPipelineParameterBuffer, are copied as they are: what they point
+ * to must stay valid until vaEndPicture().
+ *
+ * Like the standard containers, add() throws std::bad_alloc when memory
+ * runs out; the VA calls return their status.
+ */
+class param_arena
+{
+public:
+    param_arena() = default;
+    param_arena(const param_arena &) = delete;
+    param_arena &operator=(const param_arena &) = delete;
+
+    /** \brief Adds one parameter buffer. */
+    template <typename T>
+    void add(const param<T> &p)
+    {
+        if constexpr (is_misc_param<T>::value) {
+            VAEncMiscParameterType type = misc_traits<T>::type;
+            uint8_t *dst = alloc(param<T>::buffer_type,
+                                 sizeof(VAEncMiscParameterBuffer) + sizeof(T), 1);
+
+            std::memcpy(dst, &type, sizeof(type));
+            std::memcpy(dst + sizeof(VAEncMiscParameterBuffer), &p.get(), sizeof(T));
+        } else {
+            std::memcpy(alloc(param<T>::buffer_type, sizeof(T), 1), &p.get(), sizeof(T));
+        }
+    }
+
+    /**
+     * \brief Adds one buffer of \c num_elements structures, such as the
+     * slice parameters of a picture.
+     */
+    template <typename T>
+    void add(const T *values, unsigned int num_elements)
+    {
+        static_assert(has_buffer_type<T>::value && !is_misc_param<T>::value,
+                      "no buffer type is known for this structure");
+        uint8_t *dst = alloc(buffer_traits<T>::type, sizeof(T), num_elements);
+
+        if (num_elements)
+            std::memcpy(dst, values, sizeof(T) * num_elements);
+    }
+
+    /** \copydoc add(const T *, unsigned int) */
+    template <typename T>
+    void add(const param<T> *values, unsigned int num_elements)
+    {
+        static_assert(sizeof(param<T>) == sizeof(T), "param<T> must wrap T only");
+        add(&values->get(), num_elements);
+    }
+
+    /** \brief Adds the parameter and data buffers of a packed header. */
+    void add(const VAPackedHeader &header)
+    {
+        add(param<VAEncPackedHeaderParameterBuffer>(header.param));
+        add(VAEncPackedHeaderDataBufferType, header.data,
+            (header.param.bit_length + 7) / 8);
+    }
+
+    /**
+     * \brief Adds a buffer of any type, \c data holding \c num_elements
+     * elements of \c size bytes.
+     */
+    void add(VABufferType type, const void *data, unsigned int size,
+             unsigned int num_elements = 1)
+    {
+        uint8_t *dst = alloc(type, size, num_elements);
+
+        if (size && num_elements)
+            std::memcpy(dst, data, static_cast<size_t>(size) * num_elements);
+    }
+
+    /** \brief Number of buffers added since the last clear(). */
+    size_t size() const noexcept
+    {
+        return entries_.size();
+    }
+
+    /** \brief Forgets the buffers added, keeping the memory for the next frame. */
+    void clear() noexcept
+    {
+        entries_.clear();
+        data_.clear();
+    }
+
+    /**
+     * \brief Creates all the buffers added.
+     *
+     * On failure, the buffers already created are released and none is
+     * left in ids().
+     */
+    VAStatus create(VADisplay dpy, VAContextID context)
+    {
+        VAStatus status = VA_STATUS_SUCCESS;
+
+        if (!ids_.empty())
+            return VA_STATUS_ERROR_OPERATION_FAILED;
+
+        ids_.reserve(entries_.size());
+        for (const entry &e : entries_) {
+            VABufferID id;
+
+            status = vaCreatePooledBuffer(dpy, context, e.type, e.size, e.num_elements,
+                                          data_.data() + e.offset, &id);
+            if (status != VA_STATUS_SUCCESS) {
+                release(dpy);
+                return status;
+            }
+            ids_.push_back(id);
+        }
+        return status;
+    }
+
+    /** \brief Buffers created by create(), in the order they were added. */
+    const VABufferID *ids() const noexcept
+    {
+        return ids_.data();
+    }
+
+    /** \brief Number of buffers created by create(). */
+    size_t num_ids() const noexcept
+    {
+        return ids_.size();
+    }
+
+    /** \brief Renders all the buffers created by create(). */
+    VAStatus render(VADisplay dpy, VAContextID context)
+    {
+        return vaRenderPicture(dpy, context, ids_.data(), static_cast<int>(ids_.size()));
+    }
+
+    /** \brief Returns the buffers created by create() to the pool. */
+    VAStatus release(VADisplay dpy)
+    {
+        VAStatus status = VA_STATUS_SUCCESS;
+
+        for (VABufferID id : ids_) {
+            VAStatus s = vaReleasePooledBuffer(dpy, id);
+            if (status == VA_STATUS_SUCCESS)
+                status = s;
+        }
+        ids_.clear();
+        return status;
+    }
+
+private:
+    struct entry {
+        VABufferType type;
+        unsigned int size;
+        unsigned int num_elements;
+        size_t offset;
+    };
+
+    uint8_t *alloc(VABufferType type, unsigned int size, unsigned int num_elements)
+    {
+        /* keep each buffer aligned for the structures holding pointers or 64 bit values */
+        const size_t align = alignof(std::max_align_t);
+        size_t offset = (data_.size() + align - 1) & ~(align - 1);
+
+        data_.resize(offset + static_cast<size_t>(size) * num_elements);
+        entries_.push_back(entry{type, size, num_elements, offset});
+        return data_.data() + offset;
+    }
+
+    std::vector<entry> entries_;
+    std::vector<uint8_t> data_;
+    std::vector<VABufferID> ids_;
+};
+
+/**@}*/
+
+} /* namespace va */
+
+#undef VA_PARAMS_LP64
+#undef VA_PARAMS_CPLUSPLUS
+
+#endif /* _VA_PARAMS_HPP_ */
@@ -0,0 +1,1739 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * AV1 sequence header, frame header and tile group parser (AV1 bitstream
+ * and decoding process specification, sections 5 and 7.20/7.21).
+ *
+ * The sequence header is kept raw next to its parsed form, so that the
+ * copies repeated in front of every key frame are not parsed again. The
+ * frame header is parsed straight into the VA picture parameters; the
+ * state that later frames are predicted from (loop filter deltas,
+ * segmentation features, global motion, film grain) is collected next to
+ * it and saved into the refreshed reference slots when the frame is
+ * complete. That update is deferred until the next frame header, so that
+ * the surface of the frame may still be set after its last tile group.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_parse_av1.h"
+#include "va_bitreader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    AV1_OBU_SEQUENCE_HEADER         = 1,
+    AV1_OBU_TEMPORAL_DELIMITER      = 2,
+    AV1_OBU_FRAME_HEADER            = 3,
+    AV1_OBU_TILE_GROUP              = 4,
+    AV1_OBU_FRAME                   = 6,
+    AV1_OBU_REDUNDANT_FRAME_HEADER  = 7,
+    AV1_OBU_TILE_LIST               = 8,
+};
+
+enum {
+    AV1_KEY_FRAME           = 0,
+    AV1_INTER_FRAME         = 1,
+    AV1_INTRA_ONLY_FRAME    = 2,
+    AV1_SWITCH_FRAME        = 3,
+};
+
+/* reference frame names, LAST..ALTREF are ref_frame_idx[0..6] */
+enum {
+    AV1_INTRA_FRAME = 0,
+    AV1_LAST_FRAME  = 1,
+    AV1_LAST2_FRAME = 2,
+    AV1_LAST3_FRAME = 3,
+    AV1_GOLDEN_FRAME = 4,
+    AV1_BWDREF_FRAME = 5,
+    AV1_ALTREF2_FRAME = 6,
+    AV1_ALTREF_FRAME = 7,
+};
+
+#define AV1_NUM_REF_FRAMES          8
+#define AV1_REFS_PER_FRAME          7
+#define AV1_PRIMARY_REF_NONE        7
+#define AV1_ALL_FRAMES              0xff
+#define AV1_SELECT                  2
+#define AV1_MAX_OPERATING_POINTS    32
+#define AV1_MAX_SEGMENTS            8
+#define AV1_SEG_LVL_MAX             8
+#define AV1_SEG_LVL_ALT_Q           0
+#define AV1_MAX_TILE_COLS           64
+#define AV1_MAX_TILE_ROWS           64
+#define AV1_MAX_TILE_WIDTH          4096
+#define AV1_MAX_TILE_AREA           (4096 * 2304)
+#define AV1_SUPERRES_NUM            8
+#define AV1_SUPERRES_DENOM_MIN      9
+#define AV1_WARPEDMODEL_PREC_BITS   16
+
+#define AV1_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define AV1_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+typedef struct va_av1_seq {
+    uint8_t profile;
+    uint8_t still_picture;
+    uint8_t reduced_still_picture_header;
+    uint8_t decoder_model_info_present;
+    uint8_t equal_picture_interval;
+    uint8_t buffer_removal_time_length;
+    uint8_t frame_presentation_time_length;
+    uint8_t operating_points_cnt;
+    uint16_t operating_point_idc[AV1_MAX_OPERATING_POINTS];
+    uint8_t decoder_model_present_for_this_op[AV1_MAX_OPERATING_POINTS];
+    uint8_t frame_width_bits;
+    uint8_t frame_height_bits;
+    uint32_t max_frame_width;
+    uint32_t max_frame_height;
+    uint8_t frame_id_numbers_present;
+    uint8_t delta_frame_id_length;
+    uint8_t frame_id_length;
+    uint8_t use_128x128_superblock;
+    uint8_t enable_filter_intra;
+    uint8_t enable_intra_edge_filter;
+    uint8_t enable_interintra_compound;
+    uint8_t enable_masked_compound;
+    uint8_t enable_warped_motion;
+    uint8_t enable_dual_filter;
+    uint8_t enable_order_hint;
+    uint8_t enable_jnt_comp;
+    uint8_t enable_ref_frame_mvs;
+    uint8_t seq_force_screen_content_tools;
+    uint8_t seq_force_integer_mv;
+    uint8_t order_hint_bits;
+    uint8_t enable_superres;
+    uint8_t enable_cdef;
+    uint8_t enable_restoration;
+    uint8_t bit_depth;
+    uint8_t mono_chrome;
+    uint8_t color_range;
+    uint8_t subsampling_x;
+    uint8_t subsampling_y;
+    uint8_t matrix_coefficients;
+    uint8_t separate_uv_delta_q;
+    uint8_t film_grain_params_present;
+} va_av1_seq;
+
+/* the state of a frame that later frames refer to */
+typedef struct va_av1_ref {
+    VASurfaceID surface;
+    uint8_t valid;
+    uint8_t frame_type;
+    uint8_t order_hint;
+    uint32_t upscaled_width;
+    uint32_t frame_width;
+    uint32_t frame_height;
+    uint32_t render_width;
+    uint32_t render_height;
+    int32_t gm_params[AV1_NUM_REF_FRAMES][6];
+    int8_t loop_filter_ref_deltas[AV1_NUM_REF_FRAMES];
+    int8_t loop_filter_mode_deltas[2];
+    uint8_t feature_mask[AV1_MAX_SEGMENTS];
+    int16_t feature_data[AV1_MAX_SEGMENTS][AV1_SEG_LVL_MAX];
+    VAFilmGrainStructAV1 film_grain;
+} va_av1_ref;
+
+struct _VAAV1Parser {
+    uint32_t flags;
+
+    uint8_t *seq_data;
+    uint32_t seq_size;
+    uint32_t seq_capacity;
+    int seq_valid;
+    va_av1_seq seq;
+
+    va_av1_ref ref[AV1_NUM_REF_FRAMES];
+
+    /* current frame */
+    VAAV1PictureParams pic;
+    va_av1_ref cur;
+    uint8_t refresh_frame_flags;
+    /* the frame is complete, ref[] is updated with the next frame header */
+    int refresh_pending;
+    int seen_frame_header;
+    int skip_frame;
+    unsigned int mi_cols;
+    unsigned int mi_rows;
+
+    /* tile layout of the current frame */
+    unsigned int tile_cols;
+    unsigned int tile_rows;
+    unsigned int tile_cols_log2;
+    unsigned int tile_rows_log2;
+    unsigned int tile_size_bytes;
+    unsigned int next_tile;
+
+    VASliceParameterBufferAV1 *tiles;
+    unsigned int tiles_capacity;
+    unsigned int num_batched;
+};
+
+static const uint8_t va_av1_seg_feature_bits[AV1_SEG_LVL_MAX] = { 8, 6, 6, 6, 6, 3, 0, 0 };
+static const uint8_t va_av1_seg_feature_signed[AV1_SEG_LVL_MAX] = { 1, 1, 1, 1, 1, 0, 0, 0 };
+static const uint8_t va_av1_seg_feature_max[AV1_SEG_LVL_MAX] = { 255, 63, 63, 63, 63, 7, 0, 0 };
+
+/* FrameRestorationType of lr_type, as VA has it */
+static const uint8_t va_av1_remap_lr_type[4] = { 0, 3, 1, 2 };
+
+static const int8_t va_av1_default_ref_deltas[AV1_NUM_REF_FRAMES] = { 1, 0, 0, 0, -1, 0, -1, -1 };
+
+/* su(n) */
+static int32_t va_AV1ReadSU(va_bitreader *br, unsigned int n)
+{
+    int32_t v = (int32_t)va_BitReaderRead(br, n);
+    int32_t sign = 1 << (n - 1);
+
+    return (v & sign) ? v - 2 * sign : v;
+}
+
+/* ns(n) */
+static uint32_t va_AV1ReadNS(va_bitreader *br, uint32_t n)
+{
+    unsigned int w;
+    uint32_t m, v;
+
+    if (n <= 1)
+        return 0;
+    w = 32 - __builtin_clz(n);
+    m = (1U << w) - n;
+    v = va_BitReaderRead(br, w - 1);
+    if (v < m)
+        return v;
+    return (v << 1) - m + va_BitReaderReadBit(br);
+}
+
+/* uvlc() */
+static uint32_t va_AV1ReadUVLC(va_bitreader *br)
+{
+    unsigned int lz = 0;
+
+    while (!va_BitReaderReadBit(br) && !br->overrun)
+        lz++;
+    if (lz >= 32)
+        return UINT32_MAX;
+    return va_BitReaderRead(br, lz) + ((1U << lz) - 1);
+}
+
+/* leb128(), returns the number of bytes read or 0 */
+static unsigned int va_AV1ReadLEB128(const uint8_t *data, uint32_t size, uint32_t *value)
+{
+    uint64_t v = 0;
+    unsigned int i;
+
+    for (i = 0; i < 8 && i < size; i++) {
+        v |= (uint64_t)(data[i] & 0x7f) << (i * 7);
+        if (!(data[i] & 0x80)) {
+            if (v > UINT32_MAX)
+                return 0;
+            *value = (uint32_t)v;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static unsigned int va_AV1TileLog2(unsigned int blk_size, unsigned int target)
+{
+    unsigned int k;
+
+    for (k = 0; (blk_size << k) < target; k++)
+        ;
+    return k;
+}
+
+static int va_AV1RelativeDist(const va_av1_seq *seq, int a, int b)
+{
+    int diff, m;
+
+    if (!seq->enable_order_hint)
+        return 0;
+    diff = a - b;
+    m = 1 << (seq->order_hint_bits - 1);
+    return (diff & (m - 1)) - (diff & m);
+}
+
+static void va_AV1ParseColorConfig(va_bitreader *br, va_av1_seq *seq)
+{
+    unsigned int high_bitdepth = va_BitReaderReadBit(br);
+    unsigned int color_primaries = 2, transfer_characteristics = 2;
+
+    if (seq->profile == 2 && high_bitdepth)
+        seq->bit_depth = va_BitReaderReadBit(br) ? 12 : 10;
+    else
+        seq->bit_depth = high_bitdepth ? 10 : 8;
+    seq->mono_chrome = seq->profile == 1 ? 0 : va_BitReaderReadBit(br);
+
+    seq->matrix_coefficients = 2;
+    if (va_BitReaderReadBit(br)) {
+        color_primaries = va_BitReaderRead(br, 8);
+        transfer_characteristics = va_BitReaderRead(br, 8);
+        seq->matrix_coefficients = va_BitReaderRead(br, 8);
+    }
+
+    if (seq->mono_chrome) {
+        seq->color_range = va_BitReaderReadBit(br);
+        seq->subsampling_x = seq->subsampling_y = 1;
+        seq->separate_uv_delta_q = 0;
+        return;
+    }
+    /* BT.709 primaries, sRGB transfer and identity matrix */
+    if (color_primaries == 1 && transfer_characteristics == 13 && seq->matrix_coefficients == 0) {
+        seq->color_range = 1;
+        seq->subsampling_x = seq->subsampling_y = 0;
+    } else {
+        seq->color_range = va_BitReaderReadBit(br);
+        if (seq->profile == 0) {
+            seq->subsampling_x = seq->subsampling_y = 1;
+        } else if (seq->profile == 1) {
+            seq->subsampling_x = seq->subsampling_y = 0;
+        } else if (seq->bit_depth == 12) {
+            seq->subsampling_x = va_BitReaderReadBit(br);
+            seq->subsampling_y = seq->subsampling_x ? va_BitReaderReadBit(br) : 0;
+        } else {
+            seq->subsampling_x = 1;
+            seq->subsampling_y = 0;
+        }
+        if (seq->subsampling_x && seq->subsampling_y)
+            va_BitReaderRead(br, 2);        /* chroma_sample_position */
+    }
+    seq->separate_uv_delta_q = va_BitReaderReadBit(br);
+}
+
+static int va_AV1ParseSequenceHeader(va_bitreader *br, va_av1_seq *seq)
+{
+    unsigned int i, buffer_delay_length = 0, initial_display_delay_present = 0;
+
+    memset(seq, 0, sizeof(*seq));
+    seq->profile = va_BitReaderRead(br, 3);
+    if (seq->profile > 2)
+        return 0;
+    seq->still_picture = va_BitReaderReadBit(br);
+    seq->reduced_still_picture_header = va_BitReaderReadBit(br);
+
+    if (seq->reduced_still_picture_header) {
+        seq->operating_points_cnt = 1;
+        va_BitReaderRead(br, 5);            /* seq_level_idx[0] */
+    } else {
+        if (va_BitReaderReadBit(br)) {      /* timing_info_present_flag */
+            va_BitReaderRead(br, 32);       /* num_units_in_display_tick */
+            va_BitReaderRead(br, 32);       /* time_scale */
+            seq->equal_picture_interval = va_BitReaderReadBit(br);
+            if (seq->equal_picture_interval)
+                va_AV1ReadUVLC(br);
+            seq->decoder_model_info_present = va_BitReaderReadBit(br);
+            if (seq->decoder_model_info_present) {
+                buffer_delay_length = va_BitReaderRead(br, 5) + 1;
+                va_BitReaderRead(br, 32);   /* num_units_in_decoding_tick */
+                seq->buffer_removal_time_length = va_BitReaderRead(br, 5) + 1;
+                seq->frame_presentation_time_length = va_BitReaderRead(br, 5) + 1;
+            }
+        }
+        initial_display_delay_present = va_BitReaderReadBit(br);
+        seq->operating_points_cnt = va_BitReaderRead(br, 5) + 1;
+        for (i = 0; i < seq->operating_points_cnt; i++) {
+            seq->operating_point_idc[i] = va_BitReaderRead(br, 12);
+            if (va_BitReaderRead(br, 5) > 7)    /* seq_level_idx */
+                va_BitReaderReadBit(br);        /* seq_tier */
+            if (seq->decoder_model_info_present) {
+                seq->decoder_model_present_for_this_op[i] = va_BitReaderReadBit(br);
+                if (seq->decoder_model_present_for_this_op[i]) {
+                    va_BitReaderRead(br, buffer_delay_length);  /* decoder_buffer_delay */
+                    va_BitReaderRead(br, buffer_delay_length);  /* encoder_buffer_delay */
+                    va_BitReaderReadBit(br);                    /* low_delay_mode_flag */
+                }
+            }
+            if (initial_display_delay_present && va_BitReaderReadBit(br))
+                va_BitReaderRead(br, 4);
+        }
+    }
+
+    seq->frame_width_bits = va_BitReaderRead(br, 4) + 1;
+    seq->frame_height_bits = va_BitReaderRead(br, 4) + 1;
+    seq->max_frame_width = va_BitReaderRead(br, seq->frame_width_bits) + 1;
+    seq->max_frame_height = va_BitReaderRead(br, seq->frame_height_bits) + 1;
+    if (!seq->reduced_still_picture_header)
+        seq->frame_id_numbers_present = va_BitReaderReadBit(br);
+    if (seq->frame_id_numbers_present) {
+        seq->delta_frame_id_length = va_BitReaderRead(br, 4) + 2;
+        seq->frame_id_length = va_BitReaderRead(br, 3) + 1 + seq->delta_frame_id_length;
+    }
+    seq->use_128x128_superblock = va_BitReaderReadBit(br);
+    seq->enable_filter_intra = va_BitReaderReadBit(br);
+    seq->enable_intra_edge_filter = va_BitReaderReadBit(br);
+
+    seq->seq_force_screen_content_tools = AV1_SELECT;
+    seq->seq_force_integer_mv = AV1_SELECT;
+    if (!seq->reduced_still_picture_header) {
+        seq->enable_interintra_compound = va_BitReaderReadBit(br);
+        seq->enable_masked_compound = va_BitReaderReadBit(br);
+        seq->enable_warped_motion = va_BitReaderReadBit(br);
+        seq->enable_dual_filter = va_BitReaderReadBit(br);
+        seq->enable_order_hint = va_BitReaderReadBit(br);
+        if (seq->enable_order_hint) {
+            seq->enable_jnt_comp = va_BitReaderReadBit(br);
+            seq->enable_ref_frame_mvs = va_BitReaderReadBit(br);
+        }
+        if (!va_BitReaderReadBit(br))       /* seq_choose_screen_content_tools */
+            seq->seq_force_screen_content_tools = va_BitReaderReadBit(br);
+        if (seq->seq_force_screen_content_tools > 0) {
+            if (!va_BitReaderReadBit(br))   /* seq_choose_integer_mv */
+                seq->seq_force_integer_mv = va_BitReaderReadBit(br);
+        }
+        if (seq->enable_order_hint)
+            seq->order_hint_bits = va_BitReaderRead(br, 3) + 1;
+    }
+
+    seq->enable_superres = va_BitReaderReadBit(br);
+    seq->enable_cdef = va_BitReaderReadBit(br);
+    seq->enable_restoration = va_BitReaderReadBit(br);
+    va_AV1ParseColorConfig(br, seq);
+    seq->film_grain_params_present = va_BitReaderReadBit(br);
+
+    return !br->overrun;
+}
+
+VAStatus vaCreateAV1Parser(uint32_t flags, VAAV1Parser *parser)
+{
+    struct _VAAV1Parser *p;
+    unsigned int i;
+
+    if (!parser || (flags & ~VA_AV1_PARSER_BATCH_TILE_GROUPS))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    p = calloc(1, sizeof(*p));
+    if (!p)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    p->flags = flags;
+    for (i = 0; i < AV1_NUM_REF_FRAMES; i++)
+        p->ref[i].surface = VA_INVALID_SURFACE;
+    p->cur.surface = VA_INVALID_SURFACE;
+
+    *parser = p;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyAV1Parser(VAAV1Parser parser)
+{
+    struct _VAAV1Parser *p = parser;
+
+    if (!p)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    free(p->seq_data);
+    free(p->tiles);
+    free(p);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus va_AV1ParseSequenceHeaderOBU(struct _VAAV1Parser *p, const uint8_t *data, uint32_t size)
+{
+    va_bitreader br;
+
+    if (p->seq_valid && p->seq_size == size && !memcmp(p->seq_data, data, size))
+        return VA_STATUS_SUCCESS;
+
+    if (size > p->seq_capacity) {
+        uint8_t *seq_data = realloc(p->seq_data, size);
+
+        if (!seq_data)
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+        p->seq_data = seq_data;
+        p->seq_capacity = size;
+    }
+
+    p->seq_valid = 0;
+    va_BitReaderInit(&br, data, size, 0);
+    if (!va_AV1ParseSequenceHeader(&br, &p->seq))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    memcpy(p->seq_data, data, size);
+    p->seq_size = size;
+    p->seq_valid = 1;
+    return VA_STATUS_SUCCESS;
+}
+
+/* the reference update process of a decoded frame */
+static void va_AV1RefreshFrames(struct _VAAV1Parser *p)
+{
+    unsigned int i;
+
+    for (i = 0; i < AV1_NUM_REF_FRAMES; i++) {
+        if (p->refresh_frame_flags & (1 << i))
+            p->ref[i] = p->cur;
+    }
+    p->refresh_pending = 0;
+}
+
+/* superres_params() and compute_image_size() */
+static void va_AV1SuperresParams(struct _VAAV1Parser *p, va_bitreader *br)
+{
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    unsigned int denom = AV1_SUPERRES_NUM;
+
+    if (p->seq.enable_superres)
+        pp->pic_info_fields.bits.use_superres = va_BitReaderReadBit(br);
+    if (pp->pic_info_fields.bits.use_superres)
+        denom = va_BitReaderRead(br, 3) + AV1_SUPERRES_DENOM_MIN;
+    pp->superres_scale_denominator = denom;
+
+    p->cur.frame_width = (p->cur.upscaled_width * AV1_SUPERRES_NUM + denom / 2) / denom;
+    p->mi_cols = 2 * ((p->cur.frame_width + 7) >> 3);
+    p->mi_rows = 2 * ((p->cur.frame_height + 7) >> 3);
+}
+
+/* frame_size() and render_size() */
+static void va_AV1FrameSize(struct _VAAV1Parser *p, va_bitreader *br, int frame_size_override)
+{
+    if (frame_size_override) {
+        p->cur.upscaled_width = va_BitReaderRead(br, p->seq.frame_width_bits) + 1;
+        p->cur.frame_height = va_BitReaderRead(br, p->seq.frame_height_bits) + 1;
+    } else {
+        p->cur.upscaled_width = p->seq.max_frame_width;
+        p->cur.frame_height = p->seq.max_frame_height;
+    }
+    va_AV1SuperresParams(p, br);
+
+    if (va_BitReaderReadBit(br)) {          /* render_and_frame_size_different */
+        p->cur.render_width = va_BitReaderRead(br, 16) + 1;
+        p->cur.render_height = va_BitReaderRead(br, 16) + 1;
+    } else {
+        p->cur.render_width = p->cur.upscaled_width;
+        p->cur.render_height = p->cur.frame_height;
+    }
+}
+
+static void va_AV1FrameSizeWithRefs(struct _VAAV1Parser *p, va_bitreader *br, int frame_size_override)
+{
+    const VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    unsigned int i;
+
+    for (i = 0; i < AV1_REFS_PER_FRAME; i++) {
+        if (va_BitReaderReadBit(br)) {      /* found_ref */
+            const va_av1_ref *ref = &p->ref[pp->ref_frame_idx[i]];
+
+            p->cur.upscaled_width = ref->upscaled_width;
+            p->cur.frame_height = ref->frame_height;
+            p->cur.render_width = ref->render_width;
+            p->cur.render_height = ref->render_height;
+            va_AV1SuperresParams(p, br);
+            return;
+        }
+    }
+    va_AV1FrameSize(p, br, frame_size_override);
+}
+
+/* set_frame_refs(), the references of frame_refs_short_signaling */
+static void va_AV1SetFrameRefs(struct _VAAV1Parser *p, unsigned int last_frame_idx, unsigned int gold_frame_idx)
+{
+    static const uint8_t ref_frame_list[AV1_REFS_PER_FRAME - 2] = {
+        AV1_LAST2_FRAME, AV1_LAST3_FRAME, AV1_BWDREF_FRAME, AV1_ALTREF2_FRAME, AV1_ALTREF_FRAME
+    };
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    int ref_frame_idx[AV1_REFS_PER_FRAME], shifted_order_hints[AV1_NUM_REF_FRAMES];
+    uint8_t used_frame[AV1_NUM_REF_FRAMES] = { 0 };
+    int cur_frame_hint = 1 << (p->seq.order_hint_bits - 1);
+    int i, j, ref, hint = 0;
+
+    for (i = 0; i < AV1_REFS_PER_FRAME; i++)
+        ref_frame_idx[i] = -1;
+    ref_frame_idx[AV1_LAST_FRAME - AV1_LAST_FRAME] = last_frame_idx;
+    ref_frame_idx[AV1_GOLDEN_FRAME - AV1_LAST_FRAME] = gold_frame_idx;
+    used_frame[last_frame_idx] = 1;
+    used_frame[gold_frame_idx] = 1;
+    for (i = 0; i < AV1_NUM_REF_FRAMES; i++)
+        shifted_order_hints[i] = cur_frame_hint +
+                                 va_AV1RelativeDist(&p->seq, p->ref[i].order_hint, pp->order_hint);
+
+    /* ALTREF: the latest backward reference */
+    ref = -1;
+    for (i = 0; i < AV1_NUM_REF_FRAMES; i++) {
+        if (!used_frame[i] && shifted_order_hints[i] >= cur_frame_hint &&
+            (ref < 0 || shifted_order_hints[i] >= hint)) {
+            ref = i;
+            hint = shifted_order_hints[i];
+        }
+    }
+    if (ref >= 0) {
+        ref_frame_idx[AV1_ALTREF_FRAME - AV1_LAST_FRAME] = ref;
+        used_frame[ref] = 1;
+    }
+
+    /* BWDREF then ALTREF2: the earliest backward references */
+    for (j = AV1_BWDREF_FRAME; j <= AV1_ALTREF2_FRAME; j++) {
+        ref = -1;
+        for (i = 0; i < AV1_NUM_REF_FRAMES; i++) {
+            if (!used_frame[i] && shifted_order_hints[i] >= cur_frame_hint &&
+                (ref < 0 || shifted_order_hints[i] < hint)) {
+                ref = i;
+                hint = shifted_order_hints[i];
+            }
+        }
+        if (ref >= 0) {
+            ref_frame_idx[j - AV1_LAST_FRAME] = ref;
+            used_frame[ref] = 1;
+        }
+    }
+
+    /* the remaining ones: the latest forward references */
+    for (j = 0; j < AV1_REFS_PER_FRAME - 2; j++) {
+        if (ref_frame_idx[ref_frame_list[j] - AV1_LAST_FRAME] >= 0)
+            continue;
+        ref = -1;
+        for (i = 0; i < AV1_NUM_REF_FRAMES; i++) {
+            if (!used_frame[i] && shifted_order_hints[i] < cur_frame_hint &&
+                (ref < 0 || shifted_order_hints[i] >= hint)) {
+                ref = i;
+                hint = shifted_order_hints[i];
+            }
+        }
+        if (ref >= 0) {
+            ref_frame_idx[ref_frame_list[j] - AV1_LAST_FRAME] = ref;
+            used_frame[ref] = 1;
+        }
+    }
+
+    /* and the earliest reference of all for what is still missing */
+    ref = -1;
+    for (i = 0; i < AV1_NUM_REF_FRAMES; i++) {
+        if (ref < 0 || shifted_order_hints[i] < hint) {
+            ref = i;
+            hint = shifted_order_hints[i];
+        }
+    }
+    for (i = 0; i < AV1_REFS_PER_FRAME; i++)
+        pp->ref_frame_idx[i] = ref_frame_idx[i] >= 0 ? ref_frame_idx[i] : ref;
+}
+
+static int va_AV1ParseTileInfo(struct _VAAV1Parser *p, va_bitreader *br)
+{
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    unsigned int sb_shift = p->seq.use_128x128_superblock ? 5 : 4;
+    unsigned int sb_size = sb_shift + 2;
+    unsigned int sb_cols = (p->mi_cols + (1 << sb_shift) - 1) >> sb_shift;
+    unsigned int sb_rows = (p->mi_rows + (1 << sb_shift) - 1) >> sb_shift;
+    unsigned int max_tile_width_sb = AV1_MAX_TILE_WIDTH >> sb_size;
+    unsigned int max_tile_area_sb = AV1_MAX_TILE_AREA >> (2 * sb_size);
+    unsigned int min_log2_tile_cols = va_AV1TileLog2(max_tile_width_sb, sb_cols);
+    unsigned int max_log2_tile_cols = va_AV1TileLog2(1, AV1_MIN(sb_cols, AV1_MAX_TILE_COLS));
+    unsigned int max_log2_tile_rows = va_AV1TileLog2(1, AV1_MIN(sb_rows, AV1_MAX_TILE_ROWS));
+    unsigned int min_log2_tiles = AV1_MAX(min_log2_tile_cols, va_AV1TileLog2(max_tile_area_sb, sb_rows * sb_cols));
+    uint16_t col_sbs[AV1_MAX_TILE_COLS], row_sbs[AV1_MAX_TILE_ROWS];
+    unsigned int i, start_sb, size_sb;
+
+    pp->pic_info_fields.bits.uniform_tile_spacing_flag = va_BitReaderReadBit(br);
+    if (pp->pic_info_fields.bits.uniform_tile_spacing_flag) {
+        unsigned int min_log2_tile_rows;
+
+        p->tile_cols_log2 = min_log2_tile_cols;
+        while (p->tile_cols_log2 < max_log2_tile_cols && va_BitReaderReadBit(br))
+            p->tile_cols_log2++;
+        size_sb = (sb_cols + (1 << p->tile_cols_log2) - 1) >> p->tile_cols_log2;
+        for (i = 0, start_sb = 0; start_sb < sb_cols; i++, start_sb += size_sb)
+            col_sbs[i] = AV1_MIN(size_sb, sb_cols - start_sb);
+        p->tile_cols = i;
+
+        min_log2_tile_rows = min_log2_tiles > p->tile_cols_log2 ? min_log2_tiles - p->tile_cols_log2 : 0;
+        p->tile_rows_log2 = min_log2_tile_rows;
+        while (p->tile_rows_log2 < max_log2_tile_rows && va_BitReaderReadBit(br))
+            p->tile_rows_log2++;
+        size_sb = (sb_rows + (1 << p->tile_rows_log2) - 1) >> p->tile_rows_log2;
+        for (i = 0, start_sb = 0; start_sb < sb_rows; i++, start_sb += size_sb)
+            row_sbs[i] = AV1_MIN(size_sb, sb_rows - start_sb);
+        p->tile_rows = i;
+    } else {
+        unsigned int widest_tile_sb = 0, max_tile_height_sb;
+
+        for (i = 0, start_sb = 0; start_sb < sb_cols; i++, start_sb += size_sb) {
+            if (i == AV1_MAX_TILE_COLS)
+                return 0;
+            size_sb = va_AV1ReadNS(br, AV1_MIN(sb_cols - start_sb, max_tile_width_sb)) + 1;
+            col_sbs[i] = size_sb;
+            widest_tile_sb = AV1_MAX(size_sb, widest_tile_sb);
+        }
+        p->tile_cols = i;
+        p->tile_cols_log2 = va_AV1TileLog2(1, p->tile_cols);
+
+        if (min_log2_tiles > 0)
+            max_tile_area_sb = (sb_rows * sb_cols) >> (min_log2_tiles + 1);
+        else
+            max_tile_area_sb = sb_rows * sb_cols;
+        max_tile_height_sb = AV1_MAX(max_tile_area_sb / widest_tile_sb, 1);
+        for (i = 0, start_sb = 0; start_sb < sb_rows; i++, start_sb += size_sb) {
+            if (i == AV1_MAX_TILE_ROWS)
+                return 0;
+            size_sb = va_AV1ReadNS(br, AV1_MIN(sb_rows - start_sb, max_tile_height_sb)) + 1;
+            row_sbs[i] = size_sb;
+        }
+        p->tile_rows = i;
+        p->tile_rows_log2 = va_AV1TileLog2(1, p->tile_rows);
+    }
+    if (p->tile_cols > AV1_MAX_TILE_COLS || p->tile_rows > AV1_MAX_TILE_ROWS)
+        return 0;
+
+    pp->tile_cols = p->tile_cols;
+    pp->tile_rows = p->tile_rows;
+    /* VA has room for 63 sizes, the last one is implied */
+    for (i = 0; i < p->tile_cols && i < 63; i++)
+        pp->width_in_sbs_minus_1[i] = col_sbs[i] - 1;
+    for (i = 0; i < p->tile_rows && i < 63; i++)
+        pp->height_in_sbs_minus_1[i] = row_sbs[i] - 1;
+
+    p->tile_size_bytes = 4;
+    if (p->tile_cols_log2 || p->tile_rows_log2) {
+        pp->context_update_tile_id = va_BitReaderRead(br, p->tile_cols_log2 + p->tile_rows_log2);
+        p->tile_size_bytes = va_BitReaderRead(br, 2) + 1;
+    }
+    return pp->context_update_tile_id < p->tile_cols * p->tile_rows;
+}
+
+static int8_t va_AV1ReadDeltaQ(va_bitreader *br)
+{
+    return va_BitReaderReadBit(br) ? va_AV1ReadSU(br, 7) : 0;
+}
+
+static void va_AV1ParseQuantization(struct _VAAV1Parser *p, va_bitreader *br)
+{
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+
+    pp->base_qindex = va_BitReaderRead(br, 8);
+    pp->y_dc_delta_q = va_AV1ReadDeltaQ(br);
+    if (!p->seq.mono_chrome) {
+        unsigned int diff_uv_delta = p->seq.separate_uv_delta_q ? va_BitReaderReadBit(br) : 0;
+
+        pp->u_dc_delta_q = va_AV1ReadDeltaQ(br);
+        pp->u_ac_delta_q = va_AV1ReadDeltaQ(br);
+        if (diff_uv_delta) {
+            pp->v_dc_delta_q = va_AV1ReadDeltaQ(br);
+            pp->v_ac_delta_q = va_AV1ReadDeltaQ(br);
+        } else {
+            pp->v_dc_delta_q = pp->u_dc_delta_q;
+            pp->v_ac_delta_q = pp->u_ac_delta_q;
+        }
+    }
+
+    pp->qmatrix_fields.bits.using_qmatrix = va_BitReaderReadBit(br);
+    if (pp->qmatrix_fields.bits.using_qmatrix) {
+        pp->qmatrix_fields.bits.qm_y = va_BitReaderRead(br, 4);
+        pp->qmatrix_fields.bits.qm_u = va_BitReaderRead(br, 4);
+        if (!p->seq.separate_uv_delta_q)
+            pp->qmatrix_fields.bits.qm_v = pp->qmatrix_fields.bits.qm_u;
+        else
+            pp->qmatrix_fields.bits.qm_v = va_BitReaderRead(br, 4);
+    }
+}
+
+static void va_AV1ParseSegmentation(struct _VAAV1Parser *p, va_bitreader *br)
+{
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    VASegmentationStructAV1 *seg = &pp->seg_info;
+    unsigned int i, j;
+
+    seg->segment_info_fields.bits.enabled = va_BitReaderReadBit(br);
+    if (!seg->segment_info_fields.bits.enabled) {
+        memset(p->cur.feature_mask, 0, sizeof(p->cur.feature_mask));
+        memset(p->cur.feature_data, 0, sizeof(p->cur.feature_data));
+        return;
+    }
+
+    if (pp->primary_ref_frame == AV1_PRIMARY_REF_NONE) {
+        seg->segment_info_fields.bits.update_map = 1;
+        seg->segment_info_fields.bits.update_data = 1;
+    } else {
+        seg->segment_info_fields.bits.update_map = va_BitReaderReadBit(br);
+        if (seg->segment_info_fields.bits.update_map)
+            seg->segment_info_fields.bits.temporal_update = va_BitReaderReadBit(br);
+        seg->segment_info_fields.bits.update_data = va_BitReaderReadBit(br);
+    }
+    if (!seg->segment_info_fields.bits.update_data)
+        return;
+
+    for (i = 0; i < AV1_MAX_SEGMENTS; i++) {
+        p->cur.feature_mask[i] = 0;
+        for (j = 0; j < AV1_SEG_LVL_MAX; j++) {
+            int limit = va_av1_seg_feature_max[j];
+            int v = 0;
+
+            if (va_BitReaderReadBit(br)) {
+                p->cur.feature_mask[i] |= 1 << j;
+                if (va_av1_seg_feature_signed[j]) {
+                    v = va_AV1ReadSU(br, 1 + va_av1_seg_feature_bits[j]);
+                    v = v < -limit ? -limit : v;
+                } else {
+                    v = va_BitReaderRead(br, va_av1_seg_feature_bits[j]);
+                }
+                v = v > limit ? limit : v;
+            }
+            p->cur.feature_data[i][j] = v;
+        }
+    }
+}
+
+static int va_AV1CodedLossless(const struct _VAAV1Parser *p)
+{
+    const VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    unsigned int i;
+
+    if (pp->y_dc_delta_q || pp->u_dc_delta_q || pp->u_ac_delta_q || pp->v_dc_delta_q || pp->v_ac_delta_q)
+        return 0;
+    for (i = 0; i < AV1_MAX_SEGMENTS; i++) {
+        int qindex = pp->base_qindex;
+
+        if (pp->seg_info.segment_info_fields.bits.enabled &&
+            (p->cur.feature_mask[i] & (1 << AV1_SEG_LVL_ALT_Q))) {
+            qindex += p->cur.feature_data[i][AV1_SEG_LVL_ALT_Q];
+            qindex = qindex < 0 ? 0 : qindex > 255 ? 255 : qindex;
+        }
+        if (qindex)
+            return 0;
+    }
+    return 1;
+}
+
+static void va_AV1ParseLoopFilter(struct _VAAV1Parser *p, va_bitreader *br, int coded_lossless)
+{
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    unsigned int i;
+
+    if (coded_lossless || pp->pic_info_fields.bits.allow_intrabc) {
+        memcpy(p->cur.loop_filter_ref_deltas, va_av1_default_ref_deltas, sizeof(va_av1_default_ref_deltas));
+        memset(p->cur.loop_filter_mode_deltas, 0, sizeof(p->cur.loop_filter_mode_deltas));
+        return;
+    }
+
+    pp->filter_level[0] = va_BitReaderRead(br, 6);
+    pp->filter_level[1] = va_BitReaderRead(br, 6);
+    if (!p->seq.mono_chrome && (pp->filter_level[0] || pp->filter_level[1])) {
+        pp->filter_level_u = va_BitReaderRead(br, 6);
+        pp->filter_level_v = va_BitReaderRead(br, 6);
+    }
+    pp->loop_filter_info_fields.bits.sharpness_level = va_BitReaderRead(br, 3);
+    pp->loop_filter_info_fields.bits.mode_ref_delta_enabled = va_BitReaderReadBit(br);
+    if (!pp->loop_filter_info_fields.bits.mode_ref_delta_enabled)
+        return;
+    pp->loop_filter_info_fields.bits.mode_ref_delta_update = va_BitReaderReadBit(br);
+    if (!pp->loop_filter_info_fields.bits.mode_ref_delta_update)
+        return;
+    for (i = 0; i < AV1_NUM_REF_FRAMES; i++) {
+        if (va_BitReaderReadBit(br))
+            p->cur.loop_filter_ref_deltas[i] = va_AV1ReadSU(br, 7);
+    }
+    for (i = 0; i < 2; i++) {
+        if (va_BitReaderReadBit(br))
+            p->cur.loop_filter_mode_deltas[i] = va_AV1ReadSU(br, 7);
+    }
+}
+
+static void va_AV1ParseCdef(struct _VAAV1Parser *p, va_bitreader *br, int coded_lossless)
+{
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    unsigned int i;
+
+    if (coded_lossless || pp->pic_info_fields.bits.allow_intrabc || !p->seq.enable_cdef)
+        return;
+
+    pp->cdef_damping_minus_3 = va_BitReaderRead(br, 2);
+    pp->cdef_bits = va_BitReaderRead(br, 2);
+    /* primary strength in the upper 4 bits, secondary in the lower 2 */
+    for (i = 0; i < (1U << pp->cdef_bits); i++) {
+        pp->cdef_y_strengths[i] = va_BitReaderRead(br, 6);
+        if (!p->seq.mono_chrome)
+            pp->cdef_uv_strengths[i] = va_BitReaderRead(br, 6);
+    }
+}
+
+static void va_AV1ParseLoopRestoration(struct _VAAV1Parser *p, va_bitreader *br, int all_lossless)
+{
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    unsigned int i, lr_type[3] = { 0 }, uses_lr = 0, uses_chroma_lr = 0;
+    unsigned int shift;
+
+    if (all_lossless || pp->pic_info_fields.bits.allow_intrabc || !p->seq.enable_restoration)
+        return;
+
+    for (i = 0; i < (p->seq.mono_chrome ? 1U : 3U); i++) {
+        lr_type[i] = va_av1_remap_lr_type[va_BitReaderRead(br, 2)];
+        if (lr_type[i]) {
+            uses_lr = 1;
+            uses_chroma_lr |= i > 0;
+        }
+    }
+    pp->loop_restoration_fields.bits.yframe_restoration_type = lr_type[0];
+    pp->loop_restoration_fields.bits.cbframe_restoration_type = lr_type[1];
+    pp->loop_restoration_fields.bits.crframe_restoration_type = lr_type[2];
+    if (!uses_lr)
+        return;
+
+    if (p->seq.use_128x128_superblock) {
+        shift = va_BitReaderReadBit(br) + 1;
+    } else {
+        shift = va_BitReaderReadBit(br);
+        if (shift)
+            shift += va_BitReaderReadBit(br);
+    }
+    pp->loop_restoration_fields.bits.lr_unit_shift = shift;
+    if (p->seq.subsampling_x && p->seq.subsampling_y && uses_chroma_lr)
+        pp->loop_restoration_fields.bits.lr_uv_shift = va_BitReaderReadBit(br);
+}
+
+/* skip_mode_params(), whether skip_mode_present is coded */
+static int va_AV1SkipModeAllowed(const struct _VAAV1Parser *p)
+{
+    const VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    int forward_idx = -1, backward_idx = -1, second_forward_idx = -1;
+    int forward_hint = 0, backward_hint = 0, second_forward_hint = 0;
+    int i;
+
+    if (pp->pic_info_fields.bits.frame_type == AV1_KEY_FRAME ||
+        pp->pic_info_fields.bits.frame_type == AV1_INTRA_ONLY_FRAME ||
+        !pp->mode_control_fields.bits.reference_select || !p->seq.enable_order_hint)
+        return 0;
+
+    for (i = 0; i < AV1_REFS_PER_FRAME; i++) {
+        int ref_hint = p->ref[pp->ref_frame_idx[i]].order_hint;
+        int dist = va_AV1RelativeDist(&p->seq, ref_hint, pp->order_hint);
+
+        if (dist < 0) {
+            if (forward_idx < 0 || va_AV1RelativeDist(&p->seq, ref_hint, forward_hint) > 0) {
+                forward_idx = i;
+                forward_hint = ref_hint;
+            }
+        } else if (dist > 0) {
+            if (backward_idx < 0 || va_AV1RelativeDist(&p->seq, ref_hint, backward_hint) < 0) {
+                backward_idx = i;
+                backward_hint = ref_hint;
+            }
+        }
+    }
+    if (forward_idx < 0)
+        return 0;
+    if (backward_idx >= 0)
+        return 1;
+
+    for (i = 0; i < AV1_REFS_PER_FRAME; i++) {
+        int ref_hint = p->ref[pp->ref_frame_idx[i]].order_hint;
+
+        if (va_AV1RelativeDist(&p->seq, ref_hint, forward_hint) < 0) {
+            if (second_forward_idx < 0 || va_AV1RelativeDist(&p->seq, ref_hint, second_forward_hint) > 0) {
+                second_forward_idx = i;
+                second_forward_hint = ref_hint;
+            }
+        }
+    }
+    return second_forward_idx >= 0;
+}
+
+static int va_AV1InverseRecenter(int r, int v)
+{
+    if (v > 2 * r)
+        return v;
+    else if (v & 1)
+        return r - ((v + 1) >> 1);
+    return r + (v >> 1);
+}
+
+static int va_AV1DecodeSubexp(va_bitreader *br, int num_syms)
+{
+    int i = 0, mk = 0, k = 3;
+
+    for (;;) {
+        int b2 = i ? k + i - 1 : k;
+        int a = 1 << b2;
+
+        if (num_syms <= mk + 3 * a)
+            return (int)va_AV1ReadNS(br, num_syms - mk) + mk;
+        if (!va_BitReaderReadBit(br))       /* subexp_more_bits */
+            return (int)va_BitReaderRead(br, b2) + mk;
+        i++;
+        mk += a;
+    }
+}
+
+static int va_AV1DecodeSignedSubexpWithRef(va_bitreader *br, int low, int high, int r)
+{
+    int mx = high - low, v;
+
+    r -= low;
+    v = va_AV1DecodeSubexp(br, mx);
+    if ((r << 1) <= mx)
+        v = va_AV1InverseRecenter(r, v);
+    else
+        v = mx - 1 - va_AV1InverseRecenter(mx - 1 - r, v);
+    return v + low;
+}
+
+static void va_AV1ReadGlobalParam(
+    va_bitreader *br,
+    int type,
+    int32_t *params,
+    const int32_t *prev_params,
+    int idx,
+    int allow_high_precision_mv
+)
+{
+    int abs_bits = 12, prec_bits = 15, prec_diff, round, sub, mx, r;
+
+    if (idx < 2) {
+        if (type == VAAV1TransformationTranslation) {
+            abs_bits = 9 - !allow_high_precision_mv;
+            prec_bits = 3 - !allow_high_precision_mv;
+        } else {
+            abs_bits = 12;
+            prec_bits = 6;
+        }
+    }
+    prec_diff = AV1_WARPEDMODEL_PREC_BITS - prec_bits;
+    round = (idx % 3) == 2 ? (1 << AV1_WARPEDMODEL_PREC_BITS) : 0;
+    sub = (idx % 3) == 2 ? (1 << prec_bits) : 0;
+    mx = 1 << abs_bits;
+    r = (prev_params[idx] >> prec_diff) - sub;
+    params[idx] = va_AV1DecodeSignedSubexpWithRef(br, -mx, mx + 1, r) * (1 << prec_diff) + round;
+}
+
+static int64_t va_AV1Round2Signed(int64_t x, int n)
+{
+    if (!n)
+        return x;
+    if (x >= 0)
+        return (x + ((int64_t)1 << (n - 1))) >> n;
+    return -((-x + ((int64_t)1 << (n - 1))) >> n);
+}
+
+static int32_t va_AV1Clip16(int64_t x)
+{
+    return x < INT16_MIN ? INT16_MIN : x > INT16_MAX ? INT16_MAX : (int32_t)x;
+}
+
+/* setup_shear(): whether the warp of a global motion model is usable */
+static int va_AV1ShearValid(const int32_t *wm)
+{
+    int32_t alpha, beta, gamma, delta, factor;
+    uint32_t d, e, f;
+    int n, shift;
+
+    if (wm[2] <= 0)
+        return 0;
+
+    /* resolve_divisor(), Div_Lut[f] being round(2^14 * 256 / (256 + f)) */
+    d = wm[2];
+    n = 31 - __builtin_clz(d);
+    e = d - (1U << n);
+    f = n > 8 ? (uint32_t)va_AV1Round2Signed(e, n - 8) : e << (8 - n);
+    factor = ((1 << 22) + ((256 + f) >> 1)) / (256 + f);
+    shift = n + 14;
+
+    alpha = va_AV1Clip16((int64_t)wm[2] - (1 << AV1_WARPEDMODEL_PREC_BITS));
+    beta = va_AV1Clip16(wm[3]);
+    gamma = va_AV1Clip16(va_AV1Round2Signed((int64_t)wm[4] * (1 << AV1_WARPEDMODEL_PREC_BITS) * factor, shift));
+    delta = va_AV1Clip16(wm[5] - va_AV1Round2Signed((int64_t)wm[3] * wm[4] * factor, shift) -
+                         (1 << AV1_WARPEDMODEL_PREC_BITS));
+
+    alpha = (int32_t)va_AV1Round2Signed(alpha, 6) * 64;
+    beta = (int32_t)va_AV1Round2Signed(beta, 6) * 64;
+    gamma = (int32_t)va_AV1Round2Signed(gamma, 6) * 64;
+    delta = (int32_t)va_AV1Round2Signed(delta, 6) * 64;
+
+    if (4 * abs(alpha) + 7 * abs(beta) >= (1 << AV1_WARPEDMODEL_PREC_BITS))
+        return 0;
+    if (4 * abs(gamma) + 4 * abs(delta) >= (1 << AV1_WARPEDMODEL_PREC_BITS))
+        return 0;
+    return 1;
+}
+
+static void va_AV1DefaultGlobalMotion(int32_t gm_params[AV1_NUM_REF_FRAMES][6])
+{
+    unsigned int ref, i;
+
+    for (ref = 0; ref < AV1_NUM_REF_FRAMES; ref++) {
+        for (i = 0; i < 6; i++)
+            gm_params[ref][i] = (i % 3 == 2) ? 1 << AV1_WARPEDMODEL_PREC_BITS : 0;
+    }
+}
+
+static void va_AV1ParseGlobalMotion(
+    struct _VAAV1Parser *p,
+    va_bitreader *br,
+    int frame_is_intra,
+    int32_t prev_gm_params[AV1_NUM_REF_FRAMES][6]
+)
+{
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    int allow_hp = pp->pic_info_fields.bits.allow_high_precision_mv;
+    unsigned int ref;
+
+    va_AV1DefaultGlobalMotion(p->cur.gm_params);
+    for (ref = AV1_LAST_FRAME; ref <= AV1_ALTREF_FRAME; ref++) {
+        VAWarpedMotionParamsAV1 *wm = &pp->wm[ref - AV1_LAST_FRAME];
+        int32_t *params = p->cur.gm_params[ref];
+        int type = VAAV1TransformationIdentity;
+        unsigned int i;
+
+        if (!frame_is_intra && va_BitReaderReadBit(br)) {       /* is_global */
+            if (va_BitReaderReadBit(br))                        /* is_rot_zoom */
+                type = VAAV1TransformationRotzoom;
+            else if (va_BitReaderReadBit(br))                   /* is_translation */
+                type = VAAV1TransformationTranslation;
+            else
+                type = VAAV1TransformationAffine;
+        }
+
+        if (type >= VAAV1TransformationRotzoom) {
+            va_AV1ReadGlobalParam(br, type, params, prev_gm_params[ref], 2, allow_hp);
+            va_AV1ReadGlobalParam(br, type, params, prev_gm_params[ref], 3, allow_hp);
+            if (type == VAAV1TransformationAffine) {
+                va_AV1ReadGlobalParam(br, type, params, prev_gm_params[ref], 4, allow_hp);
+                va_AV1ReadGlobalParam(br, type, params, prev_gm_params[ref], 5, allow_hp);
+            } else {
+                params[4] = -params[3];
+                params[5] = params[2];
+            }
+        }
+        if (type >= VAAV1TransformationTranslation) {
+            va_AV1ReadGlobalParam(br, type, params, prev_gm_params[ref], 0, allow_hp);
+            va_AV1ReadGlobalParam(br, type, params, prev_gm_params[ref], 1, allow_hp);
+        }
+
+        wm->wmtype = type;
+        for (i = 0; i < 6; i++)
+            wm->wmmat[i] = params[i];
+        wm->invalid = !va_AV1ShearValid(params);
+    }
+}
+
+static int va_AV1ParseFilmGrain(struct _VAAV1Parser *p, va_bitreader *br)
+{
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    VAFilmGrainStructAV1 *fg = &pp->film_grain_info;
+    unsigned int i, num_pos_luma, num_pos_chroma;
+
+    if (!p->seq.film_grain_params_present ||
+        (!pp->pic_info_fields.bits.show_frame && !pp->pic_info_fields.bits.showable_frame))
+        return 1;
+
+    fg->film_grain_info_fields.bits.apply_grain = va_BitReaderReadBit(br);
+    if (!fg->film_grain_info_fields.bits.apply_grain)
+        return 1;
+
+    fg->grain_seed = va_BitReaderRead(br, 16);
+    if (pp->pic_info_fields.bits.frame_type == AV1_INTER_FRAME && !va_BitReaderReadBit(br)) {
+        /* update_grain unset: the parameters of a reference frame */
+        uint16_t grain_seed = fg->grain_seed;
+
+        *fg = p->ref[va_BitReaderRead(br, 3)].film_grain;
+        fg->grain_seed = grain_seed;
+        return 1;
+    }
+
+    fg->num_y_points = va_BitReaderRead(br, 4);
+    if (fg->num_y_points > 14)
+        return 0;
+    for (i = 0; i < fg->num_y_points; i++) {
+        fg->point_y_value[i] = va_BitReaderRead(br, 8);
+        fg->point_y_scaling[i] = va_BitReaderRead(br, 8);
+    }
+    if (!p->seq.mono_chrome)
+        fg->film_grain_info_fields.bits.chroma_scaling_from_luma = va_BitReaderReadBit(br);
+    if (!p->seq.mono_chrome && !fg->film_grain_info_fields.bits.chroma_scaling_from_luma &&
+        !(p->seq.subsampling_x && p->seq.subsampling_y && !fg->num_y_points)) {
+        fg->num_cb_points = va_BitReaderRead(br, 4);
+        if (fg->num_cb_points > 10)
+            return 0;
+        for (i = 0; i < fg->num_cb_points; i++) {
+            fg->point_cb_value[i] = va_BitReaderRead(br, 8);
+            fg->point_cb_scaling[i] = va_BitReaderRead(br, 8);
+        }
+        fg->num_cr_points = va_BitReaderRead(br, 4);
+        if (fg->num_cr_points > 10)
+            return 0;
+        for (i = 0; i < fg->num_cr_points; i++) {
+            fg->point_cr_value[i] = va_BitReaderRead(br, 8);
+            fg->point_cr_scaling[i] = va_BitReaderRead(br, 8);
+        }
+    }
+
+    fg->film_grain_info_fields.bits.grain_scaling_minus_8 = va_BitReaderRead(br, 2);
+    fg->film_grain_info_fields.bits.ar_coeff_lag = va_BitReaderRead(br, 2);
+    num_pos_luma = 2 * fg->film_grain_info_fields.bits.ar_coeff_lag *
+                   (fg->film_grain_info_fields.bits.ar_coeff_lag + 1);
+    num_pos_chroma = num_pos_luma;
+    if (fg->num_y_points) {
+        num_pos_chroma = num_pos_luma + 1;
+        for (i = 0; i < num_pos_luma; i++)
+            fg->ar_coeffs_y[i] = (int)va_BitReaderRead(br, 8) - 128;
+    }
+    if (fg->film_grain_info_fields.bits.chroma_scaling_from_luma || fg->num_cb_points) {
+        for (i = 0; i < num_pos_chroma; i++)
+            fg->ar_coeffs_cb[i] = (int)va_BitReaderRead(br, 8) - 128;
+    }
+    if (fg->film_grain_info_fields.bits.chroma_scaling_from_luma || fg->num_cr_points) {
+        for (i = 0; i < num_pos_chroma; i++)
+            fg->ar_coeffs_cr[i] = (int)va_BitReaderRead(br, 8) - 128;
+    }
+    fg->film_grain_info_fields.bits.ar_coeff_shift_minus_6 = va_BitReaderRead(br, 2);
+    fg->film_grain_info_fields.bits.grain_scale_shift = va_BitReaderRead(br, 2);
+    if (fg->num_cb_points) {
+        fg->cb_mult = va_BitReaderRead(br, 8);
+        fg->cb_luma_mult = va_BitReaderRead(br, 8);
+        fg->cb_offset = va_BitReaderRead(br, 9);
+    }
+    if (fg->num_cr_points) {
+        fg->cr_mult = va_BitReaderRead(br, 8);
+        fg->cr_luma_mult = va_BitReaderRead(br, 8);
+        fg->cr_offset = va_BitReaderRead(br, 9);
+    }
+    fg->film_grain_info_fields.bits.overlap_flag = va_BitReaderReadBit(br);
+    fg->film_grain_info_fields.bits.clip_to_restricted_range = va_BitReaderReadBit(br);
+    return 1;
+}
+
+/* the fields of the picture parameters that come from the sequence header */
+static void va_AV1FillSequenceParams(struct _VAAV1Parser *p)
+{
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    const va_av1_seq *seq = &p->seq;
+
+    p->pic.profile = seq->profile == 0 ? VAProfileAV1Profile0 :
+                     seq->profile == 1 ? VAProfileAV1Profile1 : VAProfileNone;
+    pp->profile = seq->profile;
+    pp->order_hint_bits_minus_1 = seq->order_hint_bits ? seq->order_hint_bits - 1 : 0;
+    pp->bit_depth_idx = (seq->bit_depth - 8) >> 1;
+    pp->matrix_coefficients = seq->matrix_coefficients;
+    pp->seq_info_fields.fields.still_picture = seq->still_picture;
+    pp->seq_info_fields.fields.use_128x128_superblock = seq->use_128x128_superblock;
+    pp->seq_info_fields.fields.enable_filter_intra = seq->enable_filter_intra;
+    pp->seq_info_fields.fields.enable_intra_edge_filter = seq->enable_intra_edge_filter;
+    pp->seq_info_fields.fields.enable_interintra_compound = seq->enable_interintra_compound;
+    pp->seq_info_fields.fields.enable_masked_compound = seq->enable_masked_compound;
+    pp->seq_info_fields.fields.enable_dual_filter = seq->enable_dual_filter;
+    pp->seq_info_fields.fields.enable_order_hint = seq->enable_order_hint;
+    pp->seq_info_fields.fields.enable_jnt_comp = seq->enable_jnt_comp;
+    pp->seq_info_fields.fields.enable_cdef = seq->enable_cdef;
+    pp->seq_info_fields.fields.mono_chrome = seq->mono_chrome;
+    pp->seq_info_fields.fields.color_range = seq->color_range;
+    pp->seq_info_fields.fields.subsampling_x = seq->subsampling_x;
+    pp->seq_info_fields.fields.subsampling_y = seq->subsampling_y;
+    pp->seq_info_fields.fields.film_grain_params_present = seq->film_grain_params_present;
+}
+
+/* skip temporal_point_info() */
+static void va_AV1SkipTemporalPointInfo(const va_av1_seq *seq, va_bitreader *br)
+{
+    if (seq->decoder_model_info_present && !seq->equal_picture_interval)
+        va_BitReaderRead(br, seq->frame_presentation_time_length);
+}
+
+static VAStatus va_AV1ParseShowExistingFrame(struct _VAAV1Parser *p, va_bitreader *br, uint32_t *result)
+{
+    const va_av1_seq *seq = &p->seq;
+    unsigned int i, idx = va_BitReaderRead(br, 3);
+    va_av1_ref *ref = &p->ref[idx];
+
+    va_AV1SkipTemporalPointInfo(seq, br);
+    if (seq->frame_id_numbers_present)
+        va_BitReaderRead(br, seq->frame_id_length);     /* display_frame_id */
+    if (br->overrun)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    memset(&p->pic, 0, sizeof(p->pic));
+    p->pic.show_existing_frame = 1;
+    if (!ref->valid) {
+        *result = VA_AV1_PARSE_SKIPPED;
+        return VA_STATUS_SUCCESS;
+    }
+    va_AV1FillSequenceParams(p);
+    p->pic.pic_param.current_frame = ref->surface;
+    p->pic.pic_param.current_display_picture = ref->surface;
+    if (seq->film_grain_params_present)
+        p->pic.pic_param.film_grain_info = ref->film_grain;
+
+    /* showing a key frame loads its state and refreshes all the slots */
+    if (ref->frame_type == AV1_KEY_FRAME) {
+        for (i = 0; i < AV1_NUM_REF_FRAMES; i++) {
+            if (i != idx)
+                p->ref[i] = *ref;
+        }
+    }
+    *result = VA_AV1_PARSE_SHOW_EXISTING;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus va_AV1ParseFrameHeader(
+    struct _VAAV1Parser *p,
+    va_bitreader *br,
+    unsigned int temporal_id,
+    unsigned int spatial_id,
+    uint32_t *result
+)
+{
+    const va_av1_seq *seq = &p->seq;
+    VADecPictureParameterBufferAV1 *pp = &p->pic.pic_param;
+    int32_t prev_gm_params[AV1_NUM_REF_FRAMES][6];
+    unsigned int i, frame_type, frame_is_intra, frame_size_override = 0;
+    int coded_lossless;
+
+    if (p->refresh_pending)
+        va_AV1RefreshFrames(p);
+
+    if (!seq->reduced_still_picture_header && va_BitReaderReadBit(br))
+        return va_AV1ParseShowExistingFrame(p, br, result);
+
+    memset(&p->pic, 0, sizeof(p->pic));
+    va_AV1FillSequenceParams(p);
+    p->cur.surface = VA_INVALID_SURFACE;
+    p->cur.valid = 1;
+    p->skip_frame = 0;
+
+    if (seq->reduced_still_picture_header) {
+        frame_type = AV1_KEY_FRAME;
+        pp->pic_info_fields.bits.show_frame = 1;
+    } else {
+        frame_type = va_BitReaderRead(br, 2);
+        pp->pic_info_fields.bits.show_frame = va_BitReaderReadBit(br);
+        if (pp->pic_info_fields.bits.show_frame)
+            va_AV1SkipTemporalPointInfo(seq, br);
+        if (pp->pic_info_fields.bits.show_frame)
+            pp->pic_info_fields.bits.showable_frame = frame_type != AV1_KEY_FRAME;
+        else
+            pp->pic_info_fields.bits.showable_frame = va_BitReaderReadBit(br);
+        if (frame_type == AV1_SWITCH_FRAME || (frame_type == AV1_KEY_FRAME && pp->pic_info_fields.bits.show_frame))
+            pp->pic_info_fields.bits.error_resilient_mode = 1;
+        else
+            pp->pic_info_fields.bits.error_resilient_mode = va_BitReaderReadBit(br);
+    }
+    pp->pic_info_fields.bits.frame_type = frame_type;
+    p->cur.frame_type = frame_type;
+    frame_is_intra = frame_type == AV1_KEY_FRAME || frame_type == AV1_INTRA_ONLY_FRAME;
+
+    if (frame_type == AV1_KEY_FRAME && pp->pic_info_fields.bits.show_frame) {
+        for (i = 0; i < AV1_NUM_REF_FRAMES; i++) {
+            p->ref[i].valid = 0;
+            p->ref[i].order_hint = 0;
+        }
+    }
+
+    pp->pic_info_fields.bits.disable_cdf_update = va_BitReaderReadBit(br);
+    if (seq->seq_force_screen_content_tools == AV1_SELECT)
+        pp->pic_info_fields.bits.allow_screen_content_tools = va_BitReaderReadBit(br);
+    else
+        pp->pic_info_fields.bits.allow_screen_content_tools = seq->seq_force_screen_content_tools;
+    if (pp->pic_info_fields.bits.allow_screen_content_tools) {
+        if (seq->seq_force_integer_mv == AV1_SELECT)
+            pp->pic_info_fields.bits.force_integer_mv = va_BitReaderReadBit(br);
+        else
+            pp->pic_info_fields.bits.force_integer_mv = seq->seq_force_integer_mv;
+    }
+    if (frame_is_intra)
+        pp->pic_info_fields.bits.force_integer_mv = 1;
+
+    if (seq->frame_id_numbers_present)
+        va_BitReaderRead(br, seq->frame_id_length);     /* current_frame_id */
+    if (frame_type == AV1_SWITCH_FRAME)
+        frame_size_override = 1;
+    else if (!seq->reduced_still_picture_header)
+        frame_size_override = va_BitReaderReadBit(br);
+    pp->order_hint = va_BitReaderRead(br, seq->order_hint_bits);
+    p->cur.order_hint = pp->order_hint;
+    if (frame_is_intra || pp->pic_info_fields.bits.error_resilient_mode)
+        pp->primary_ref_frame = AV1_PRIMARY_REF_NONE;
+    else
+        pp->primary_ref_frame = va_BitReaderRead(br, 3);
+
+    if (seq->decoder_model_info_present && va_BitReaderReadBit(br)) {  /* buffer_removal_time_present_flag */
+        for (i = 0; i < seq->operating_points_cnt; i++) {
+            unsigned int idc = seq->operating_point_idc[i];
+
+            if (seq->decoder_model_present_for_this_op[i] &&
+                (!idc || (((idc >> temporal_id) & 1) && ((idc >> (spatial_id + 8)) & 1))))
+                va_BitReaderRead(br, seq->buffer_removal_time_length);
+        }
+    }
+
+    if (frame_type == AV1_SWITCH_FRAME || (frame_type == AV1_KEY_FRAME && pp->pic_info_fields.bits.show_frame))
+        p->refresh_frame_flags = AV1_ALL_FRAMES;
+    else
+        p->refresh_frame_flags = va_BitReaderRead(br, 8);
+    if (frame_type == AV1_INTRA_ONLY_FRAME && p->refresh_frame_flags == AV1_ALL_FRAMES)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    if ((!frame_is_intra || p->refresh_frame_flags != AV1_ALL_FRAMES) &&
+        pp->pic_info_fields.bits.error_resilient_mode && seq->enable_order_hint) {
+        for (i = 0; i < AV1_NUM_REF_FRAMES; i++) {
+            unsigned int ref_order_hint = va_BitReaderRead(br, seq->order_hint_bits);
+
+            if (ref_order_hint != p->ref[i].order_hint) {
+                p->ref[i].valid = 0;
+                p->ref[i].order_hint = ref_order_hint;
+            }
+        }
+    }
+
+    if (frame_is_intra) {
+        va_AV1FrameSize(p, br, frame_size_override);
+        if (pp->pic_info_fields.bits.allow_screen_content_tools && p->cur.upscaled_width == p->cur.frame_width)
+            pp->pic_info_fields.bits.allow_intrabc = va_BitReaderReadBit(br);
+    } else {
+        unsigned int short_signaling = seq->enable_order_hint ? va_BitReaderReadBit(br) : 0;
+
+        if (short_signaling) {
+            unsigned int last_frame_idx = va_BitReaderRead(br, 3);
+            unsigned int gold_frame_idx = va_BitReaderRead(br, 3);
+
+            va_AV1SetFrameRefs(p, last_frame_idx, gold_frame_idx);
+        }
+        for (i = 0; i < AV1_REFS_PER_FRAME; i++) {
+            if (!short_signaling)
+                pp->ref_frame_idx[i] = va_BitReaderRead(br, 3);
+            if (seq->frame_id_numbers_present)
+                va_BitReaderRead(br, seq->delta_frame_id_length);   /* delta_frame_id_minus_1 */
+            /* the references precede the start of the stream */
+            if (!p->ref[pp->ref_frame_idx[i]].valid)
+                p->skip_frame = 1;
+        }
+        if (p->skip_frame) {
+            /* and so do the frames that would have used this one */
+            for (i = 0; i < AV1_NUM_REF_FRAMES; i++) {
+                if (p->refresh_frame_flags & (1 << i))
+                    p->ref[i].valid = 0;
+            }
+            *result = VA_AV1_PARSE_SKIPPED;
+            return VA_STATUS_SUCCESS;
+        }
+
+        if (frame_size_override && !pp->pic_info_fields.bits.error_resilient_mode)
+            va_AV1FrameSizeWithRefs(p, br, frame_size_override);
+        else
+            va_AV1FrameSize(p, br, frame_size_override);
+        if (!pp->pic_info_fields.bits.force_integer_mv)
+            pp->pic_info_fields.bits.allow_high_precision_mv = va_BitReaderReadBit(br);
+        pp->interp_filter = va_BitReaderReadBit(br) ? 4 : va_BitReaderRead(br, 2);
+        pp->pic_info_fields.bits.is_motion_mode_switchable = va_BitReaderReadBit(br);
+        if (!pp->pic_info_fields.bits.error_resilient_mode && seq->enable_ref_frame_mvs)
+            pp->pic_info_fields.bits.use_ref_frame_mvs = va_BitReaderReadBit(br);
+    }
+    pp->frame_width_minus1 = p->cur.upscaled_width - 1;
+    pp->frame_height_minus1 = p->cur.frame_height - 1;
+
+    if (seq->reduced_still_picture_header || pp->pic_info_fields.bits.disable_cdf_update)
+        pp->pic_info_fields.bits.disable_frame_end_update_cdf = 1;
+    else
+        pp->pic_info_fields.bits.disable_frame_end_update_cdf = va_BitReaderReadBit(br);
+
+    /* setup_past_independence() or load_previous() */
+    if (pp->primary_ref_frame == AV1_PRIMARY_REF_NONE) {
+        memset(p->cur.feature_mask, 0, sizeof(p->cur.feature_mask));
+        memset(p->cur.feature_data, 0, sizeof(p->cur.feature_data));
+        memcpy(p->cur.loop_filter_ref_deltas, va_av1_default_ref_deltas, sizeof(va_av1_default_ref_deltas));
+        memset(p->cur.loop_filter_mode_deltas, 0, sizeof(p->cur.loop_filter_mode_deltas));
+        va_AV1DefaultGlobalMotion(prev_gm_params);
+    } else {
+        const va_av1_ref *prev = &p->ref[pp->ref_frame_idx[pp->primary_ref_frame]];
+
+        memcpy(p->cur.feature_mask, prev->feature_mask, sizeof(p->cur.feature_mask));
+        memcpy(p->cur.feature_data, prev->feature_data, sizeof(p->cur.feature_data));
+        memcpy(p->cur.loop_filter_ref_deltas, prev->loop_filter_ref_deltas, sizeof(p->cur.loop_filter_ref_deltas));
+        memcpy(p->cur.loop_filter_mode_deltas, prev->loop_filter_mode_deltas, sizeof(p->cur.loop_filter_mode_deltas));
+        memcpy(prev_gm_params, prev->gm_params, sizeof(prev_gm_params));
+    }
+
+    if (!va_AV1ParseTileInfo(p, br))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    va_AV1ParseQuantization(p, br);
+    va_AV1ParseSegmentation(p, br);
+
+    if (pp->base_qindex)
+        pp->mode_control_fields.bits.delta_q_present_flag = va_BitReaderReadBit(br);
+    if (pp->mode_control_fields.bits.delta_q_present_flag) {
+        pp->mode_control_fields.bits.log2_delta_q_res = va_BitReaderRead(br, 2);
+        if (!pp->pic_info_fields.bits.allow_intrabc)
+            pp->mode_control_fields.bits.delta_lf_present_flag = va_BitReaderReadBit(br);
+        if (pp->mode_control_fields.bits.delta_lf_present_flag) {
+            pp->mode_control_fields.bits.log2_delta_lf_res = va_BitReaderRead(br, 2);
+            pp->mode_control_fields.bits.delta_lf_multi = va_BitReaderReadBit(br);
+        }
+    }
+
+    coded_lossless = va_AV1CodedLossless(p);
+    va_AV1ParseLoopFilter(p, br, coded_lossless);
+    va_AV1ParseCdef(p, br, coded_lossless);
+    va_AV1ParseLoopRestoration(p, br, coded_lossless && p->cur.frame_width == p->cur.upscaled_width);
+
+    /* read_tx_mode(): ONLY_4X4, TX_MODE_LARGEST or TX_MODE_SELECT */
+    if (!coded_lossless)
+        pp->mode_control_fields.bits.tx_mode = va_BitReaderReadBit(br) ? 2 : 1;
+    if (!frame_is_intra)
+        pp->mode_control_fields.bits.reference_select = va_BitReaderReadBit(br);
+    if (va_AV1SkipModeAllowed(p))
+        pp->mode_control_fields.bits.skip_mode_present = va_BitReaderReadBit(br);
+    if (!frame_is_intra && !pp->pic_info_fields.bits.error_resilient_mode && seq->enable_warped_motion)
+        pp->pic_info_fields.bits.allow_warped_motion = va_BitReaderReadBit(br);
+    pp->mode_control_fields.bits.reduced_tx_set_used = va_BitReaderReadBit(br);
+    va_AV1ParseGlobalMotion(p, br, frame_is_intra, prev_gm_params);
+    if (!va_AV1ParseFilmGrain(p, br) || br->overrun)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    /* the final state, as the reference slots save it */
+    memcpy(pp->ref_deltas, p->cur.loop_filter_ref_deltas, sizeof(pp->ref_deltas));
+    memcpy(pp->mode_deltas, p->cur.loop_filter_mode_deltas, sizeof(pp->mode_deltas));
+    memcpy(pp->seg_info.feature_mask, p->cur.feature_mask, sizeof(pp->seg_info.feature_mask));
+    memcpy(pp->seg_info.feature_data, p->cur.feature_data, sizeof(pp->seg_info.feature_data));
+    p->cur.film_grain = pp->film_grain_info;
+
+    p->num_batched = 0;
+    p->next_tile = 0;
+    if (p->tile_cols * p->tile_rows > p->tiles_capacity) {
+        VASliceParameterBufferAV1 *tiles = realloc(p->tiles, p->tile_cols * p->tile_rows * sizeof(*tiles));
+
+        if (!tiles)
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+        p->tiles = tiles;
+        p->tiles_capacity = p->tile_cols * p->tile_rows;
+    }
+
+    *result = VA_AV1_PARSE_PICTURE;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus va_AV1ParseTileGroup(
+    struct _VAAV1Parser *p,
+    va_bitreader *br,
+    const uint8_t *payload,
+    uint32_t payload_size,
+    uint32_t slice_data_offset,
+    uint32_t *result,
+    const VASliceParameterBufferAV1 **tiles,
+    uint32_t *num_tiles
+)
+{
+    unsigned int frame_tiles = p->tile_cols * p->tile_rows;
+    unsigned int tg_start = 0, tg_end = frame_tiles - 1, t, n = 0;
+    VASliceParameterBufferAV1 *out;
+    const uint8_t *data;
+    uint32_t left;
+
+    if (frame_tiles > p->tiles_capacity)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (frame_tiles > 1 && va_BitReaderReadBit(br)) {  /* tile_start_and_end_present_flag */
+        tg_start = va_BitReaderRead(br, p->tile_cols_log2 + p->tile_rows_log2);
+        tg_end = va_BitReaderRead(br, p->tile_cols_log2 + p->tile_rows_log2);
+    }
+    va_BitReaderAlign(br);
+    if (br->overrun || tg_start != p->next_tile || tg_end < tg_start || tg_end >= frame_tiles)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    data = payload + va_BitReaderPosition(br) / 8;
+    left = payload_size - (uint32_t)(data - payload);
+    out = p->tiles;
+    if (p->flags & VA_AV1_PARSER_BATCH_TILE_GROUPS)
+        out += p->num_batched;
+
+    for (t = tg_start; t <= tg_end; t++, n++) {
+        uint32_t tile_size = left;
+        unsigned int i;
+
+        if (t != tg_end) {
+            if (left < p->tile_size_bytes)
+                return VA_STATUS_ERROR_INVALID_PARAMETER;
+            /* tile_size_minus_1, le(TileSizeBytes) */
+            for (tile_size = 0, i = 0; i < p->tile_size_bytes; i++)
+                tile_size |= (uint32_t)data[i] << (8 * i);
+            tile_size++;
+            data += p->tile_size_bytes;
+            left -= p->tile_size_bytes;
+            if (!tile_size || tile_size > left)
+                return VA_STATUS_ERROR_INVALID_PARAMETER;
+        }
+
+        memset(&out[n], 0, sizeof(out[n]));
+        out[n].slice_data_size = tile_size;
+        out[n].slice_data_offset = slice_data_offset + (uint32_t)(data - payload);
+        out[n].slice_data_flag = VA_SLICE_DATA_FLAG_ALL;
+        out[n].tile_row = t / p->tile_cols;
+        out[n].tile_column = t % p->tile_cols;
+        data += tile_size;
+        left -= tile_size;
+    }
+    p->next_tile = tg_end + 1;
+
+    if (p->flags & VA_AV1_PARSER_BATCH_TILE_GROUPS) {
+        p->num_batched += n;
+        out = p->tiles;
+        n = p->num_batched;
+    }
+    if (p->next_tile == frame_tiles) {
+        *result |= VA_AV1_PARSE_TILES | VA_AV1_PARSE_FRAME_END;
+        p->seen_frame_header = 0;
+        p->refresh_pending = 1;
+    } else if (!(p->flags & VA_AV1_PARSER_BATCH_TILE_GROUPS)) {
+        *result |= VA_AV1_PARSE_TILES;
+    } else {
+        return VA_STATUS_SUCCESS;
+    }
+    *tiles = out;
+    *num_tiles = n;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaParseAV1OBU(
+    VAAV1Parser parser,
+    const uint8_t *data,
+    uint32_t size,
+    uint32_t slice_data_offset,
+    uint32_t *obu_size,
+    uint32_t *result,
+    const VASliceParameterBufferAV1 **tiles,
+    uint32_t *num_tiles
+)
+{
+    struct _VAAV1Parser *p = parser;
+    unsigned int type, temporal_id = 0, spatial_id = 0, header_size = 1;
+    uint32_t payload_size;
+    const uint8_t *payload;
+    va_bitreader br;
+    VAStatus status;
+
+    if (!p || !data || !obu_size || !result || !tiles || !num_tiles)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    *obu_size = 0;
+    *result = 0;
+    *tiles = NULL;
+    *num_tiles = 0;
+
+    /* obu_header() */
+    if (!size || (data[0] & 0x80))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    type = (data[0] >> 3) & 0xf;
+    if (data[0] & 0x04) {
+        if (size < 2)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        temporal_id = data[1] >> 5;
+        spatial_id = (data[1] >> 3) & 0x3;
+        header_size++;
+    }
+    if (data[0] & 0x02) {
+        unsigned int n = va_AV1ReadLEB128(data + header_size, size - header_size, &payload_size);
+
+        if (!n || payload_size > size - header_size - n)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        header_size += n;
+    } else {
+        payload_size = size - header_size;
+    }
+    *obu_size = header_size + payload_size;
+    payload = data + header_size;
+
+    /* drop the layers outside of the operating point */
+    if (type != AV1_OBU_SEQUENCE_HEADER && type != AV1_OBU_TEMPORAL_DELIMITER &&
+        (data[0] & 0x04) && p->seq_valid && p->seq.operating_point_idc[0]) {
+        unsigned int idc = p->seq.operating_point_idc[0];
+
+        if (!((idc >> temporal_id) & 1) || !((idc >> (spatial_id + 8)) & 1))
+            return VA_STATUS_SUCCESS;
+    }
+
+    switch (type) {
+    case AV1_OBU_SEQUENCE_HEADER:
+        *result = VA_AV1_PARSE_SEQUENCE;
+        return va_AV1ParseSequenceHeaderOBU(p, payload, payload_size);
+    case AV1_OBU_TEMPORAL_DELIMITER:
+        p->seen_frame_header = 0;
+        return VA_STATUS_SUCCESS;
+    case AV1_OBU_FRAME_HEADER:
+    case AV1_OBU_REDUNDANT_FRAME_HEADER:
+    case AV1_OBU_FRAME:
+        if (!p->seq_valid)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        /* frame_header_copy(), the tile groups of a skipped frame are not parsed */
+        if (p->seen_frame_header && !p->skip_frame) {
+            if (type == AV1_OBU_FRAME)
+                return VA_STATUS_ERROR_INVALID_PARAMETER;
+            return VA_STATUS_SUCCESS;
+        }
+        va_BitReaderInit(&br, payload, payload_size, 0);
+        status = va_AV1ParseFrameHeader(p, &br, temporal_id, spatial_id, result);
+        if (status != VA_STATUS_SUCCESS) {
+            /* the tile groups up to the next frame header have nothing to go with */
+            p->seen_frame_header = 0;
+            p->skip_frame = 0;
+            return status;
+        }
+        if (*result & VA_AV1_PARSE_SHOW_EXISTING) {
+            if (type == AV1_OBU_FRAME)
+                return VA_STATUS_ERROR_INVALID_PARAMETER;
+            return VA_STATUS_SUCCESS;
+        }
+        if (*result & VA_AV1_PARSE_SKIPPED) {
+            p->seen_frame_header = type != AV1_OBU_FRAME && !p->pic.show_existing_frame;
+            return VA_STATUS_SUCCESS;
+        }
+        p->seen_frame_header = 1;
+        if (type != AV1_OBU_FRAME)
+            return VA_STATUS_SUCCESS;
+        va_BitReaderAlign(&br);
+        return va_AV1ParseTileGroup(p, &br, payload, payload_size, slice_data_offset + header_size,
+                                    result, tiles, num_tiles);
+    case AV1_OBU_TILE_GROUP:
+        if (!p->seen_frame_header)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        if (p->skip_frame) {
+            *result = VA_AV1_PARSE_SKIPPED;
+            return VA_STATUS_SUCCESS;
+        }
+        va_BitReaderInit(&br, payload, payload_size, 0);
+        return va_AV1ParseTileGroup(p, &br, payload, payload_size, slice_data_offset + header_size,
+                                    result, tiles, num_tiles);
+    case AV1_OBU_TILE_LIST:
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+    default:
+        return VA_STATUS_SUCCESS;
+    }
+}
+
+VAStatus vaGetAV1PictureParams(
+    VAAV1Parser parser,
+    VASurfaceID surface,
+    VAAV1PictureParams *params
+)
+{
+    struct _VAAV1Parser *p = parser;
+    VADecPictureParameterBufferAV1 *pp;
+    unsigned int i;
+
+    if (!p || !params)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (!p->seq_valid)
+        return VA_STATUS_ERROR_OPERATION_FAILED;
+
+    *params = p->pic;
+    if (p->pic.show_existing_frame)
+        return VA_STATUS_SUCCESS;
+
+    p->cur.surface = surface;
+    pp = &params->pic_param;
+    pp->current_frame = surface;
+    pp->current_display_picture = surface;
+    for (i = 0; i < AV1_NUM_REF_FRAMES; i++)
+        pp->ref_frame_map[i] = p->ref[i].valid ? p->ref[i].surface : VA_INVALID_SURFACE;
+    return VA_STATUS_SUCCESS;
+}
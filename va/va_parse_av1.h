@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_parse_av1.h
+ * \brief AV1 bitstream parser for decode
+ *
+ * Parses the sequence header, frame header and tile group OBUs of an AV1
+ * stream and fills the VA decode parameter structures of va_dec_av1.h
+ * with them, so that simple clients can drive the VLD entrypoint without
+ * a parsing framework. The parser keeps the state of the eight reference
+ * frame slots (order hints, frame sizes, segmentation features, loop
+ * filter deltas, global motion and film grain parameters) which the
+ * following frame headers are predicted from.
+ *
+ * The stream is expected in the low overhead bitstream format (OBUs with
+ * obu_size fields, as stored in IVF, MP4 and Matroska); the operating
+ * point 0 is decoded. Large scale tile decoding (tile list OBUs) is not
+ * supported.
+ *
+ * Usage:
+ * - pass each OBU to vaParseAV1OBU(), which also returns its size;
+ * - copy the tile group and frame OBUs to the slice data buffer at the
+ *   \c slice_data_offset given to the parser;
+ * - when it returns VA_AV1_PARSE_PICTURE, pick the surface of the new
+ *   frame and get its parameters with vaGetAV1PictureParams();
+ * - with VA_AV1_PARSE_TILES, render the returned tile parameters as one
+ *   slice parameter buffer of \c num_tiles elements along with the slice
+ *   data;
+ * - with VA_AV1_PARSE_FRAME_END, the frame is complete: end it with
+ *   vaEndPicture().
+ */
+
+#ifndef _VA_PARSE_AV1_H_
+#define _VA_PARSE_AV1_H_
+
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_parse_av1 AV1 parser
+ *
+ * @{
+ */
+
+/** \brief Opaque AV1 parser state. */
+typedef struct _VAAV1Parser *VAAV1Parser;
+
+/** \brief Parameters of a frame. */
+typedef struct _VAAV1PictureParams {
+    /**
+     * \brief Profile of the active sequence header, VAProfileNone for the
+     * professional profile which has no VA profile.
+     */
+    VAProfile profile;
+    /** \brief Picture parameters. */
+    VADecPictureParameterBufferAV1 pic_param;
+    /**
+     * \brief The frame header is a show_existing_frame one: nothing is
+     * decoded, pic_param.current_display_picture is the surface of the
+     * reference frame to output and pic_param.film_grain_info its film
+     * grain parameters. The other fields of pic_param are not valid.
+     */
+    uint8_t show_existing_frame;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VAAV1PictureParams;
+
+/**
+ * \brief Accumulate the tiles of all the tile groups of a frame.
+ *
+ * The tile parameters are then only returned with the last tile group of
+ * the frame, so that all the tiles of the frame are rendered with one
+ * slice parameter buffer and one slice data buffer holding the tile group
+ * OBUs of the frame back to back. This keeps the number of buffers and
+ * vaRenderPicture() calls constant for streams with many tile groups,
+ * e.g. at 8K with one tile group per tile.
+ */
+#define VA_AV1_PARSER_BATCH_TILE_GROUPS 0x00000001
+
+/**
+ * \brief Creates an AV1 parser.
+ *
+ * @param[in] flags     combination of VA_AV1_PARSER_xxx
+ */
+VAStatus vaCreateAV1Parser(uint32_t flags, VAAV1Parser *parser);
+
+/** \brief Destroys an AV1 parser. */
+VAStatus vaDestroyAV1Parser(VAAV1Parser parser);
+
+/** \brief The OBU holds the header of a new frame. */
+#define VA_AV1_PARSE_PICTURE            0x00000001
+/** \brief Tiles of the current frame are returned. */
+#define VA_AV1_PARSE_TILES              0x00000002
+/**
+ * \brief The OBU belongs to a frame that cannot be decoded, because the
+ * reference frames it uses precede the start of the stream.
+ */
+#define VA_AV1_PARSE_SKIPPED            0x00000004
+/** \brief The OBU is a sequence header. */
+#define VA_AV1_PARSE_SEQUENCE           0x00000008
+/** \brief The OBU holds the last tile group of the current frame. */
+#define VA_AV1_PARSE_FRAME_END          0x00000010
+/**
+ * \brief The OBU is a show_existing_frame frame header, get the frame to
+ * output with vaGetAV1PictureParams().
+ */
+#define VA_AV1_PARSE_SHOW_EXISTING      0x00000020
+
+/**
+ * \brief Parses an OBU.
+ *
+ * \c data points to the OBU header and \c size is the number of bytes
+ * available from there; the size of the OBU, header included, is returned
+ * in \c obu_size. An OBU without obu_size field extends to the end of
+ * \c data. Sequence headers are only parsed again when their content
+ * changes; temporal delimiters, metadata, padding and the OBUs outside of
+ * the operating point are skipped.
+ *
+ * For tile groups, the OBU is assumed to be at \c slice_data_offset in the
+ * slice data buffer, and the returned tiles point into it. The tile array
+ * belongs to the parser and stays valid until the next call.
+ *
+ * The reference frame slots are updated when the next frame header is
+ * parsed, with the surface given to vaGetAV1PictureParams() until then.
+ *
+ * @param[out] result   combination of VA_AV1_PARSE_xxx
+ * @param[out] tiles    tile parameters, with VA_AV1_PARSE_TILES
+ * @param[out] num_tiles number of tiles, 0 without VA_AV1_PARSE_TILES
+ * @return VA_STATUS_ERROR_INVALID_PARAMETER if the OBU is corrupted or
+ *         comes before the sequence header,
+ *         VA_STATUS_ERROR_UNSUPPORTED_PROFILE for large scale tile streams
+ */
+VAStatus vaParseAV1OBU(
+    VAAV1Parser parser,
+    const uint8_t *data,
+    uint32_t size,
+    uint32_t slice_data_offset,
+    uint32_t *obu_size,                             /* out */
+    uint32_t *result,                               /* out */
+    const VASliceParameterBufferAV1 **tiles,        /* out */
+    uint32_t *num_tiles                             /* out */
+);
+
+/**
+ * \brief Returns the parameters of the current frame.
+ *
+ * Called after vaParseAV1OBU() returned VA_AV1_PARSE_PICTURE or
+ * VA_AV1_PARSE_SHOW_EXISTING, and before the next frame header. \c surface
+ * is the render target of the frame, which the reference frame slots
+ * refreshed by the frame will point to; it is ignored for
+ * show_existing_frame headers. pic_param.current_display_picture is set
+ * to \c surface: when film_grain_info.film_grain_info_fields.bits.apply_grain
+ * is set, the application may point it to a separate surface that will
+ * get the film grain.
+ */
+VAStatus vaGetAV1PictureParams(
+    VAAV1Parser parser,
+    VASurfaceID surface,
+    VAAV1PictureParams *params      /* out */
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_PARSE_AV1_H_ */
@@ -0,0 +1,1909 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * HEVC parameter set and slice segment header parser (ITU-T H.265).
+ *
+ * Parameter sets are kept escaped per ID next to their parsed form; a
+ * parameter set NAL unit identical to the stored one is not parsed again,
+ * and the picture parameters derived from the active SPS/PPS pair are
+ * only rebuilt when one of them changed. Headers are read in place with
+ * the emulation prevention aware bit reader.
+ *
+ * The DPB holds the reference pictures in fixed slots, which are also
+ * their indexes in ReferenceFrames[], so that a picture keeps its index
+ * for as long as it is referenced.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_parse_hevc.h"
+#include "va_bitstream.h"
+#include "va_bitreader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+enum {
+    HEVC_NAL_TRAIL_N    = 0,
+    HEVC_NAL_RADL_N     = 6,
+    HEVC_NAL_RADL_R     = 7,
+    HEVC_NAL_RASL_N     = 8,
+    HEVC_NAL_RASL_R     = 9,
+    HEVC_NAL_BLA_W_LP   = 16,
+    HEVC_NAL_IDR_W_RADL = 19,
+    HEVC_NAL_IDR_N_LP   = 20,
+    HEVC_NAL_CRA_NUT    = 21,
+    HEVC_NAL_IRAP_MAX   = 23,
+    HEVC_NAL_VPS        = 32,
+    HEVC_NAL_SPS        = 33,
+    HEVC_NAL_PPS        = 34,
+    HEVC_NAL_EOS        = 36,
+};
+
+#define HEVC_SLICE_B        0
+#define HEVC_SLICE_P        1
+#define HEVC_SLICE_I        2
+
+#define HEVC_MAX_SPS        16
+#define HEVC_MAX_PPS        64
+#define HEVC_MAX_RPS        16
+#define HEVC_MAX_REFS       15
+/* the references and the current picture */
+#define HEVC_DPB_SLOTS      (HEVC_MAX_REFS + 1)
+#define HEVC_NO_SLOT        0xff
+
+/* short-term RPS, negative pictures first */
+typedef struct va_hevc_rps {
+    uint8_t num_negative;
+    uint8_t num_positive;
+    uint8_t used[2 * HEVC_MAX_RPS];
+    int32_t delta_poc[2 * HEVC_MAX_RPS];
+} va_hevc_rps;
+
+typedef struct va_hevc_sps {
+    VAProfile profile;
+    uint8_t max_sub_layers_minus1;
+    uint8_t chroma_format_idc;
+    uint8_t separate_colour_plane_flag;
+    uint16_t width;
+    uint16_t height;
+    uint8_t bit_depth_luma_minus8;
+    uint8_t bit_depth_chroma_minus8;
+    uint8_t log2_max_poc_lsb;
+    uint8_t max_dec_pic_buffering_minus1;
+    uint8_t max_num_reorder_pics;
+    uint8_t log2_min_cb_size_minus3;
+    uint8_t log2_diff_max_min_cb_size;
+    uint8_t log2_min_tb_size_minus2;
+    uint8_t log2_diff_max_min_tb_size;
+    uint8_t max_transform_hierarchy_depth_inter;
+    uint8_t max_transform_hierarchy_depth_intra;
+    uint8_t scaling_list_enabled_flag;
+    uint8_t amp_enabled_flag;
+    uint8_t sample_adaptive_offset_enabled_flag;
+    uint8_t pcm_enabled_flag;
+    uint8_t pcm_bit_depth_luma_minus1;
+    uint8_t pcm_bit_depth_chroma_minus1;
+    uint8_t log2_min_pcm_cb_size_minus3;
+    uint8_t log2_diff_max_min_pcm_cb_size;
+    uint8_t pcm_loop_filter_disabled_flag;
+    uint8_t num_short_term_ref_pic_sets;
+    uint8_t long_term_ref_pics_present_flag;
+    uint8_t num_long_term_ref_pics_sps;
+    uint8_t temporal_mvp_enabled_flag;
+    uint8_t strong_intra_smoothing_enabled_flag;
+    /* range extension */
+    uint8_t transform_skip_rotation_enabled_flag;
+    uint8_t transform_skip_context_enabled_flag;
+    uint8_t implicit_rdpcm_enabled_flag;
+    uint8_t explicit_rdpcm_enabled_flag;
+    uint8_t extended_precision_processing_flag;
+    uint8_t intra_smoothing_disabled_flag;
+    uint8_t high_precision_offsets_enabled_flag;
+    uint8_t persistent_rice_adaptation_enabled_flag;
+    uint8_t cabac_bypass_alignment_enabled_flag;
+    /* screen content coding extension */
+    uint8_t curr_pic_ref_enabled_flag;
+    uint8_t palette_mode_enabled_flag;
+    uint8_t palette_max_size;
+    uint8_t delta_palette_max_predictor_size;
+    uint8_t num_palette_predictor_initializers;
+    uint8_t motion_vector_resolution_control_idc;
+    uint8_t intra_boundary_filtering_disabled_flag;
+    uint16_t lt_ref_pic_poc_lsb_sps[32];
+    uint8_t used_by_curr_pic_lt_sps_flag[32];
+    va_hevc_rps st_rps[64];
+    VAIQMatrixBufferHEVC scaling_list;
+    uint16_t palette_predictor_initializers[3][128];
+} va_hevc_sps;
+
+typedef struct va_hevc_pps {
+    uint8_t sps_id;
+    uint8_t dependent_slice_segments_enabled_flag;
+    uint8_t output_flag_present_flag;
+    uint8_t num_extra_slice_header_bits;
+    uint8_t sign_data_hiding_enabled_flag;
+    uint8_t cabac_init_present_flag;
+    uint8_t num_ref_idx_l0_default_active_minus1;
+    uint8_t num_ref_idx_l1_default_active_minus1;
+    int8_t init_qp_minus26;
+    uint8_t constrained_intra_pred_flag;
+    uint8_t transform_skip_enabled_flag;
+    uint8_t cu_qp_delta_enabled_flag;
+    uint8_t diff_cu_qp_delta_depth;
+    int8_t cb_qp_offset;
+    int8_t cr_qp_offset;
+    uint8_t slice_chroma_qp_offsets_present_flag;
+    uint8_t weighted_pred_flag;
+    uint8_t weighted_bipred_flag;
+    uint8_t transquant_bypass_enabled_flag;
+    uint8_t tiles_enabled_flag;
+    uint8_t entropy_coding_sync_enabled_flag;
+    uint8_t num_tile_columns_minus1;
+    uint8_t num_tile_rows_minus1;
+    uint8_t uniform_spacing_flag;
+    uint8_t loop_filter_across_tiles_enabled_flag;
+    uint8_t loop_filter_across_slices_enabled_flag;
+    uint8_t deblocking_filter_override_enabled_flag;
+    uint8_t deblocking_filter_disabled_flag;
+    int8_t beta_offset_div2;
+    int8_t tc_offset_div2;
+    uint8_t scaling_list_data_present_flag;
+    uint8_t lists_modification_present_flag;
+    uint8_t log2_parallel_merge_level_minus2;
+    uint8_t slice_segment_header_extension_present_flag;
+    /* range extension */
+    uint8_t log2_max_transform_skip_block_size_minus2;
+    uint8_t cross_component_prediction_enabled_flag;
+    uint8_t chroma_qp_offset_list_enabled_flag;
+    uint8_t diff_cu_chroma_qp_offset_depth;
+    uint8_t chroma_qp_offset_list_len_minus1;
+    uint8_t log2_sao_offset_scale_luma;
+    uint8_t log2_sao_offset_scale_chroma;
+    int8_t cb_qp_offset_list[6];
+    int8_t cr_qp_offset_list[6];
+    /* screen content coding extension */
+    uint8_t curr_pic_ref_enabled_flag;
+    uint8_t residual_adaptive_colour_transform_enabled_flag;
+    uint8_t slice_act_qp_offsets_present_flag;
+    int8_t act_y_qp_offset_plus5;
+    int8_t act_cb_qp_offset_plus5;
+    int8_t act_cr_qp_offset_plus3;
+    uint8_t palette_predictor_initializers_present_flag;
+    uint8_t num_palette_predictor_initializers;
+    uint16_t column_width_minus1[20];
+    uint16_t row_height_minus1[22];
+    VAIQMatrixBufferHEVC scaling_list;
+    uint16_t palette_predictor_initializers[3][128];
+} va_hevc_pps;
+
+/* a parameter set as last received, escaped, and its parsed form */
+typedef struct va_hevc_ps {
+    uint8_t *data;
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t generation;
+    void *parsed;
+    int valid;
+} va_hevc_ps;
+
+typedef struct va_hevc_dpb_pic {
+    VASurfaceID surface;
+    int32_t poc;
+    uint8_t used;
+    uint8_t long_term;
+} va_hevc_dpb_pic;
+
+struct _VAHEVCParser {
+    va_hevc_ps sps[HEVC_MAX_SPS];
+    va_hevc_ps pps[HEVC_MAX_PPS];
+    uint32_t generation;
+
+    /* current picture */
+    const va_hevc_sps *cur_sps;
+    const va_hevc_pps *cur_pps;
+    uint32_t cur_sps_generation;
+    uint32_t cur_pps_generation;
+    int in_picture;
+    int skipping;
+    uint8_t cur_nal_type;
+    uint8_t cur_slot;
+    VAHEVCPictureParams pic;
+
+    /* POC and RASL handling */
+    int first_picture;
+    int skip_rasl;
+    int32_t prev_tid0_poc;
+
+    /* reference picture set of the current picture, as DPB slots */
+    va_hevc_dpb_pic dpb[HEVC_DPB_SLOTS];
+    uint8_t st_curr_before[HEVC_MAX_RPS];
+    uint8_t st_curr_after[HEVC_MAX_RPS];
+    uint8_t lt_curr[HEVC_MAX_RPS];
+    uint8_t num_st_curr_before;
+    uint8_t num_st_curr_after;
+    uint8_t num_lt_curr;
+
+    /* last independent slice segment, for the dependent ones */
+    VASliceParameterBufferHEVCExtension last_slice;
+};
+
+static const uint8_t default_scaling_list_intra[64] = {
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 16, 17, 16, 17, 18,
+    17, 18, 18, 17, 18, 21, 19, 20, 21, 20, 19, 21, 24, 22, 22, 24,
+    24, 22, 22, 24, 25, 25, 27, 30, 27, 25, 25, 29, 31, 35, 35, 31,
+    29, 36, 41, 44, 41, 36, 47, 54, 54, 47, 65, 70, 65, 88, 88, 115
+};
+
+static const uint8_t default_scaling_list_inter[64] = {
+    16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 18,
+    18, 18, 18, 18, 18, 20, 20, 20, 20, 20, 20, 20, 24, 24, 24, 24,
+    24, 24, 24, 24, 25, 25, 25, 25, 25, 25, 25, 28, 28, 28, 28, 28,
+    28, 33, 33, 33, 33, 33, 41, 41, 41, 41, 54, 54, 54, 71, 71, 91
+};
+
+/* up-right diagonal scan (6.5.3) of a 4x4 and an 8x8 block, as raster positions */
+static void va_HEVCDiagScan(uint8_t *scan, unsigned int size)
+{
+    unsigned int i = 0;
+    int x = 0, y = 0;
+
+    while (i < size * size) {
+        while (y >= 0) {
+            if (x < (int)size && y < (int)size)
+                scan[i++] = y * size + x;
+            y--;
+            x++;
+        }
+        y = x;
+        x = 0;
+    }
+}
+
+static unsigned int va_CeilLog2(uint32_t v)
+{
+    unsigned int n = 0;
+
+    while (n < 32 && (1ULL << n) < v)
+        n++;
+    return n;
+}
+
+static uint8_t *va_HEVCScalingList(VAIQMatrixBufferHEVC *sl, unsigned int size_id, unsigned int matrix_id)
+{
+    switch (size_id) {
+    case 0:
+        return sl->ScalingList4x4[matrix_id];
+    case 1:
+        return sl->ScalingList8x8[matrix_id];
+    case 2:
+        return sl->ScalingList16x16[matrix_id];
+    default:
+        return sl->ScalingList32x32[matrix_id / 3];
+    }
+}
+
+static void va_HEVCDefaultScalingList(VAIQMatrixBufferHEVC *sl, unsigned int size_id, unsigned int matrix_id)
+{
+    uint8_t *list = va_HEVCScalingList(sl, size_id, matrix_id);
+    uint8_t scan[64];
+    unsigned int i;
+
+    if (size_id == 0) {
+        memset(list, 16, 16);
+        return;
+    }
+
+    va_HEVCDiagScan(scan, 8);
+    for (i = 0; i < 64; i++)
+        list[scan[i]] = matrix_id < 3 ? default_scaling_list_intra[i] : default_scaling_list_inter[i];
+    if (size_id == 2)
+        sl->ScalingListDC16x16[matrix_id] = 16;
+    else if (size_id == 3)
+        sl->ScalingListDC32x32[matrix_id / 3] = 16;
+}
+
+static void va_HEVCDefaultScalingLists(VAIQMatrixBufferHEVC *sl)
+{
+    unsigned int size_id, matrix_id;
+
+    memset(sl, 0, sizeof(*sl));
+    for (size_id = 0; size_id < 4; size_id++)
+        for (matrix_id = 0; matrix_id < 6; matrix_id += (size_id == 3) ? 3 : 1)
+            va_HEVCDefaultScalingList(sl, size_id, matrix_id);
+}
+
+/* scaling_list_data() (7.3.4), stored in raster order as VAIQMatrixBufferHEVC wants */
+static int va_HEVCParseScalingLists(va_bitreader *br, VAIQMatrixBufferHEVC *sl)
+{
+    uint8_t scan4[16], scan8[64];
+    unsigned int size_id, matrix_id, i;
+
+    va_HEVCDiagScan(scan4, 4);
+    va_HEVCDiagScan(scan8, 8);
+    memset(sl, 0, sizeof(*sl));
+
+    for (size_id = 0; size_id < 4; size_id++) {
+        unsigned int step = (size_id == 3) ? 3 : 1;
+        unsigned int num = size_id ? 64 : 16;
+
+        for (matrix_id = 0; matrix_id < 6; matrix_id += step) {
+            uint8_t *list = va_HEVCScalingList(sl, size_id, matrix_id);
+
+            if (!va_BitReaderReadBit(br)) {
+                uint32_t delta = va_BitReaderReadUE(br);
+
+                if (delta * step > matrix_id)
+                    return 0;
+                if (!delta) {
+                    va_HEVCDefaultScalingList(sl, size_id, matrix_id);
+                } else {
+                    unsigned int ref = matrix_id - delta * step;
+
+                    memcpy(list, va_HEVCScalingList(sl, size_id, ref), num);
+                    if (size_id == 2)
+                        sl->ScalingListDC16x16[matrix_id] = sl->ScalingListDC16x16[ref];
+                    else if (size_id == 3)
+                        sl->ScalingListDC32x32[matrix_id / 3] = sl->ScalingListDC32x32[ref / 3];
+                }
+            } else {
+                int next = 8;
+
+                if (size_id > 1) {
+                    int32_t dc = va_BitReaderReadSE(br);
+
+                    if (dc < -7 || dc > 247)
+                        return 0;
+                    next = dc + 8;
+                    if (size_id == 2)
+                        sl->ScalingListDC16x16[matrix_id] = next;
+                    else
+                        sl->ScalingListDC32x32[matrix_id / 3] = next;
+                }
+                for (i = 0; i < num; i++) {
+                    int32_t delta = va_BitReaderReadSE(br);
+
+                    if (delta < -128 || delta > 127)
+                        return 0;
+                    next = (next + delta + 256) & 0xff;
+                    list[size_id ? scan8[i] : scan4[i]] = next;
+                }
+            }
+        }
+    }
+    return !br->overrun;
+}
+
+/* profile_tier_level( 1, maxNumSubLayersMinus1 ), returns general_profile_idc */
+static unsigned int va_HEVCParsePTL(va_bitreader *br, unsigned int max_sub_layers_minus1)
+{
+    unsigned int profile_idc, i, sub_profile = 0, sub_level = 0;
+    uint32_t compat;
+
+    va_BitReaderRead(br, 3);
+    profile_idc = va_BitReaderRead(br, 5);
+    compat = va_BitReaderRead(br, 32);
+    /* source flags, constraint flags, general_level_idc */
+    va_BitReaderSkip(br, 4 + 43 + 1 + 8);
+
+    for (i = 0; i < max_sub_layers_minus1; i++) {
+        sub_profile |= va_BitReaderReadBit(br) << i;
+        sub_level |= va_BitReaderReadBit(br) << i;
+    }
+    if (max_sub_layers_minus1 > 0)
+        va_BitReaderSkip(br, 2 * (8 - max_sub_layers_minus1));
+    for (i = 0; i < max_sub_layers_minus1; i++) {
+        if (sub_profile & (1 << i))
+            va_BitReaderSkip(br, 88);
+        if (sub_level & (1 << i))
+            va_BitReaderSkip(br, 8);
+    }
+
+    /* fall back to the compatibility flags for unknown profiles */
+    if (profile_idc == 0 || profile_idc > 11) {
+        for (i = 1; i < 12; i++) {
+            if (compat & (1U << (31 - i))) {
+                profile_idc = i;
+                break;
+            }
+        }
+    }
+    return profile_idc;
+}
+
+static VAProfile va_HEVCProfile(unsigned int profile_idc, const va_hevc_sps *sps)
+{
+    unsigned int depth = 8 + (sps->bit_depth_luma_minus8 > sps->bit_depth_chroma_minus8 ?
+                              sps->bit_depth_luma_minus8 : sps->bit_depth_chroma_minus8);
+
+    switch (profile_idc) {
+    case 1:
+    case 3:
+        return VAProfileHEVCMain;
+    case 2:
+        return VAProfileHEVCMain10;
+    case 4:
+        if (sps->chroma_format_idc == 3)
+            return depth <= 8 ? VAProfileHEVCMain444 :
+                   depth <= 10 ? VAProfileHEVCMain444_10 : VAProfileHEVCMain444_12;
+        if (sps->chroma_format_idc == 2)
+            return depth <= 10 ? VAProfileHEVCMain422_10 : VAProfileHEVCMain422_12;
+        return depth <= 8 ? VAProfileHEVCMain :
+               depth <= 10 ? VAProfileHEVCMain10 : VAProfileHEVCMain12;
+    case 9:
+        if (sps->chroma_format_idc == 3)
+            return depth <= 8 ? VAProfileHEVCSccMain444 : VAProfileHEVCSccMain444_10;
+        return depth <= 8 ? VAProfileHEVCSccMain : VAProfileHEVCSccMain10;
+    default:
+        return VAProfileNone;
+    }
+}
+
+static void va_HEVCSkipSubLayerHRD(va_bitreader *br, unsigned int cpb_cnt, int sub_pic)
+{
+    unsigned int i;
+
+    for (i = 0; i < cpb_cnt; i++) {
+        va_BitReaderReadUE(br);
+        va_BitReaderReadUE(br);
+        if (sub_pic) {
+            va_BitReaderReadUE(br);
+            va_BitReaderReadUE(br);
+        }
+        va_BitReaderReadBit(br);
+    }
+}
+
+/* hrd_parameters( 1, maxNumSubLayersMinus1 ) */
+static void va_HEVCSkipHRD(va_bitreader *br, unsigned int max_sub_layers_minus1)
+{
+    int nal, vcl, sub_pic = 0;
+    unsigned int i;
+
+    nal = va_BitReaderReadBit(br);
+    vcl = va_BitReaderReadBit(br);
+    if (nal || vcl) {
+        sub_pic = va_BitReaderReadBit(br);
+        if (sub_pic)
+            va_BitReaderSkip(br, 8 + 5 + 1 + 5);
+        va_BitReaderSkip(br, 4 + 4);
+        if (sub_pic)
+            va_BitReaderSkip(br, 4);
+        va_BitReaderSkip(br, 5 + 5 + 5);
+    }
+
+    for (i = 0; i <= max_sub_layers_minus1 && !br->overrun; i++) {
+        int fixed_within_cvs = 1, low_delay = 0;
+        unsigned int cpb_cnt = 1;
+
+        if (!va_BitReaderReadBit(br))
+            fixed_within_cvs = va_BitReaderReadBit(br);
+        if (fixed_within_cvs)
+            va_BitReaderReadUE(br);
+        else
+            low_delay = va_BitReaderReadBit(br);
+        if (!low_delay) {
+            cpb_cnt = va_BitReaderReadUE(br) + 1;
+            if (cpb_cnt > 32) {
+                br->overrun = 1;
+                return;
+            }
+        }
+        if (nal)
+            va_HEVCSkipSubLayerHRD(br, cpb_cnt, sub_pic);
+        if (vcl)
+            va_HEVCSkipSubLayerHRD(br, cpb_cnt, sub_pic);
+    }
+}
+
+static void va_HEVCSkipVUI(va_bitreader *br, unsigned int max_sub_layers_minus1)
+{
+    if (va_BitReaderReadBit(br)) {
+        if (va_BitReaderRead(br, 8) == 255)
+            va_BitReaderSkip(br, 32);
+    }
+    if (va_BitReaderReadBit(br))
+        va_BitReaderReadBit(br);
+    if (va_BitReaderReadBit(br)) {
+        va_BitReaderSkip(br, 4);
+        if (va_BitReaderReadBit(br))
+            va_BitReaderSkip(br, 24);
+    }
+    if (va_BitReaderReadBit(br)) {
+        va_BitReaderReadUE(br);
+        va_BitReaderReadUE(br);
+    }
+    /* neutral_chroma_indication_flag, field_seq_flag, frame_field_info_present_flag */
+    va_BitReaderSkip(br, 3);
+    if (va_BitReaderReadBit(br)) {
+        va_BitReaderReadUE(br);
+        va_BitReaderReadUE(br);
+        va_BitReaderReadUE(br);
+        va_BitReaderReadUE(br);
+    }
+    if (va_BitReaderReadBit(br)) {
+        va_BitReaderSkip(br, 64);
+        if (va_BitReaderReadBit(br))
+            va_BitReaderReadUE(br);
+        if (va_BitReaderReadBit(br))
+            va_HEVCSkipHRD(br, max_sub_layers_minus1);
+    }
+    if (va_BitReaderReadBit(br)) {
+        va_BitReaderSkip(br, 3);
+        va_BitReaderReadUE(br);
+        va_BitReaderReadUE(br);
+        va_BitReaderReadUE(br);
+        va_BitReaderReadUE(br);
+        va_BitReaderReadUE(br);
+    }
+}
+
+/*
+ * st_ref_pic_set( stRpsIdx ) (7.3.7), with the derivation of the delta
+ * POCs of predicted sets (7.4.8). idx == num_sets for the slice header.
+ */
+static int va_HEVCParseRPS(va_bitreader *br, const va_hevc_rps *sets, va_hevc_rps *rps,
+                           unsigned int idx, unsigned int num_sets)
+{
+    unsigned int i, j;
+
+    memset(rps, 0, sizeof(*rps));
+
+    if (idx && va_BitReaderReadBit(br)) {
+        uint8_t used[2 * HEVC_MAX_RPS + 1], use_delta[2 * HEVC_MAX_RPS + 1];
+        const va_hevc_rps *ref;
+        unsigned int delta_idx = 1, num_ref, n = 0;
+        int32_t delta_rps, d;
+
+        if (idx == num_sets)
+            delta_idx += va_BitReaderReadUE(br);
+        if (delta_idx > idx)
+            return 0;
+        ref = &sets[idx - delta_idx];
+        num_ref = ref->num_negative + ref->num_positive;
+
+        delta_rps = va_BitReaderReadBit(br) ? -1 : 1;
+        delta_rps *= (int32_t)va_BitReaderReadUE(br) + 1;
+        for (j = 0; j <= num_ref; j++) {
+            used[j] = va_BitReaderReadBit(br);
+            use_delta[j] = used[j] ? 1 : va_BitReaderReadBit(br);
+        }
+
+        /* negative pictures, closest first */
+        for (i = ref->num_positive; i-- > 0;) {
+            d = ref->delta_poc[ref->num_negative + i] + delta_rps;
+            if (d < 0 && use_delta[ref->num_negative + i] && n < HEVC_MAX_RPS) {
+                rps->delta_poc[n] = d;
+                rps->used[n++] = used[ref->num_negative + i];
+            }
+        }
+        if (delta_rps < 0 && use_delta[num_ref] && n < HEVC_MAX_RPS) {
+            rps->delta_poc[n] = delta_rps;
+            rps->used[n++] = used[num_ref];
+        }
+        for (i = 0; i < ref->num_negative; i++) {
+            d = ref->delta_poc[i] + delta_rps;
+            if (d < 0 && use_delta[i] && n < HEVC_MAX_RPS) {
+                rps->delta_poc[n] = d;
+                rps->used[n++] = used[i];
+            }
+        }
+        rps->num_negative = n;
+
+        for (i = ref->num_negative; i-- > 0;) {
+            d = ref->delta_poc[i] + delta_rps;
+            if (d > 0 && use_delta[i] && n < 2 * HEVC_MAX_RPS) {
+                rps->delta_poc[n] = d;
+                rps->used[n++] = used[i];
+            }
+        }
+        if (delta_rps > 0 && use_delta[num_ref] && n < 2 * HEVC_MAX_RPS) {
+            rps->delta_poc[n] = delta_rps;
+            rps->used[n++] = used[num_ref];
+        }
+        for (i = 0; i < ref->num_positive; i++) {
+            d = ref->delta_poc[ref->num_negative + i] + delta_rps;
+            if (d > 0 && use_delta[ref->num_negative + i] && n < 2 * HEVC_MAX_RPS) {
+                rps->delta_poc[n] = d;
+                rps->used[n++] = used[ref->num_negative + i];
+            }
+        }
+        rps->num_positive = n - rps->num_negative;
+    } else {
+        uint32_t num_negative = va_BitReaderReadUE(br);
+        uint32_t num_positive = va_BitReaderReadUE(br);
+        int32_t poc = 0;
+
+        if (num_negative > HEVC_MAX_RPS || num_positive > HEVC_MAX_RPS)
+            return 0;
+        rps->num_negative = num_negative;
+        rps->num_positive = num_positive;
+        for (i = 0; i < num_negative; i++) {
+            poc -= (int32_t)va_BitReaderReadUE(br) + 1;
+            rps->delta_poc[i] = poc;
+            rps->used[i] = va_BitReaderReadBit(br);
+        }
+        for (poc = 0; i < num_negative + num_positive; i++) {
+            poc += (int32_t)va_BitReaderReadUE(br) + 1;
+            rps->delta_poc[i] = poc;
+            rps->used[i] = va_BitReaderReadBit(br);
+        }
+    }
+    return !br->overrun;
+}
+
+static int va_HEVCParseSPS(va_bitreader *br, va_hevc_sps *sps, unsigned int *id)
+{
+    unsigned int profile_idc, i, first;
+    uint32_t v;
+
+    memset(sps, 0, sizeof(*sps));
+
+    va_BitReaderRead(br, 4);
+    sps->max_sub_layers_minus1 = va_BitReaderRead(br, 3);
+    if (sps->max_sub_layers_minus1 > 6)
+        return 0;
+    va_BitReaderReadBit(br);
+    profile_idc = va_HEVCParsePTL(br, sps->max_sub_layers_minus1);
+
+    *id = va_BitReaderReadUE(br);
+    if (*id >= HEVC_MAX_SPS)
+        return 0;
+    sps->chroma_format_idc = va_BitReaderReadUE(br);
+    if (sps->chroma_format_idc > 3)
+        return 0;
+    if (sps->chroma_format_idc == 3)
+        sps->separate_colour_plane_flag = va_BitReaderReadBit(br);
+
+    v = va_BitReaderReadUE(br);
+    sps->width = v;
+    if (!v || v > 0xffff)
+        return 0;
+    v = va_BitReaderReadUE(br);
+    sps->height = v;
+    if (!v || v > 0xffff)
+        return 0;
+    if (va_BitReaderReadBit(br)) {
+        for (i = 0; i < 4; i++)
+            va_BitReaderReadUE(br);
+    }
+
+    sps->bit_depth_luma_minus8 = v = va_BitReaderReadUE(br);
+    if (v > 8)
+        return 0;
+    sps->bit_depth_chroma_minus8 = v = va_BitReaderReadUE(br);
+    if (v > 8)
+        return 0;
+    v = va_BitReaderReadUE(br);
+    if (v > 12)
+        return 0;
+    sps->log2_max_poc_lsb = v + 4;
+
+    first = va_BitReaderReadBit(br) ? 0 : sps->max_sub_layers_minus1;
+    for (i = first; i <= sps->max_sub_layers_minus1; i++) {
+        /* the values of the highest sub-layer apply */
+        sps->max_dec_pic_buffering_minus1 = v = va_BitReaderReadUE(br);
+        if (v >= 16)
+            return 0;
+        sps->max_num_reorder_pics = v = va_BitReaderReadUE(br);
+        if (v >= 16)
+            return 0;
+        va_BitReaderReadUE(br);
+    }
+
+    sps->log2_min_cb_size_minus3 = va_BitReaderReadUE(br);
+    sps->log2_diff_max_min_cb_size = va_BitReaderReadUE(br);
+    sps->log2_min_tb_size_minus2 = va_BitReaderReadUE(br);
+    sps->log2_diff_max_min_tb_size = va_BitReaderReadUE(br);
+    if (sps->log2_min_cb_size_minus3 + sps->log2_diff_max_min_cb_size > 3 ||
+        sps->log2_min_tb_size_minus2 + sps->log2_diff_max_min_tb_size > 3)
+        return 0;
+    sps->max_transform_hierarchy_depth_inter = va_BitReaderReadUE(br);
+    sps->max_transform_hierarchy_depth_intra = va_BitReaderReadUE(br);
+
+    sps->scaling_list_enabled_flag = va_BitReaderReadBit(br);
+    va_HEVCDefaultScalingLists(&sps->scaling_list);
+    if (sps->scaling_list_enabled_flag && va_BitReaderReadBit(br) &&
+        !va_HEVCParseScalingLists(br, &sps->scaling_list))
+        return 0;
+
+    sps->amp_enabled_flag = va_BitReaderReadBit(br);
+    sps->sample_adaptive_offset_enabled_flag = va_BitReaderReadBit(br);
+    sps->pcm_enabled_flag = va_BitReaderReadBit(br);
+    if (sps->pcm_enabled_flag) {
+        sps->pcm_bit_depth_luma_minus1 = va_BitReaderRead(br, 4);
+        sps->pcm_bit_depth_chroma_minus1 = va_BitReaderRead(br, 4);
+        sps->log2_min_pcm_cb_size_minus3 = va_BitReaderReadUE(br);
+        sps->log2_diff_max_min_pcm_cb_size = va_BitReaderReadUE(br);
+        sps->pcm_loop_filter_disabled_flag = va_BitReaderReadBit(br);
+    }
+
+    v = va_BitReaderReadUE(br);
+    if (v > 64)
+        return 0;
+    sps->num_short_term_ref_pic_sets = v;
+    for (i = 0; i < v; i++) {
+        if (!va_HEVCParseRPS(br, sps->st_rps, &sps->st_rps[i], i, v))
+            return 0;
+    }
+
+    sps->long_term_ref_pics_present_flag = va_BitReaderReadBit(br);
+    if (sps->long_term_ref_pics_present_flag) {
+        v = va_BitReaderReadUE(br);
+        if (v > 32)
+            return 0;
+        sps->num_long_term_ref_pics_sps = v;
+        for (i = 0; i < v; i++) {
+            sps->lt_ref_pic_poc_lsb_sps[i] = va_BitReaderRead(br, sps->log2_max_poc_lsb);
+            sps->used_by_curr_pic_lt_sps_flag[i] = va_BitReaderReadBit(br);
+        }
+    }
+    sps->temporal_mvp_enabled_flag = va_BitReaderReadBit(br);
+    sps->strong_intra_smoothing_enabled_flag = va_BitReaderReadBit(br);
+    if (va_BitReaderReadBit(br))
+        va_HEVCSkipVUI(br, sps->max_sub_layers_minus1);
+
+    if (va_BitReaderReadBit(br)) {
+        int range = va_BitReaderReadBit(br);
+        int multilayer = va_BitReaderReadBit(br);
+        int ext_3d = va_BitReaderReadBit(br);
+        int scc = va_BitReaderReadBit(br);
+
+        va_BitReaderRead(br, 4);
+        if (range) {
+            sps->transform_skip_rotation_enabled_flag = va_BitReaderReadBit(br);
+            sps->transform_skip_context_enabled_flag = va_BitReaderReadBit(br);
+            sps->implicit_rdpcm_enabled_flag = va_BitReaderReadBit(br);
+            sps->explicit_rdpcm_enabled_flag = va_BitReaderReadBit(br);
+            sps->extended_precision_processing_flag = va_BitReaderReadBit(br);
+            sps->intra_smoothing_disabled_flag = va_BitReaderReadBit(br);
+            sps->high_precision_offsets_enabled_flag = va_BitReaderReadBit(br);
+            sps->persistent_rice_adaptation_enabled_flag = va_BitReaderReadBit(br);
+            sps->cabac_bypass_alignment_enabled_flag = va_BitReaderReadBit(br);
+        }
+        if (multilayer)
+            va_BitReaderReadBit(br);
+        /* the 3D extension is not supported, nor is what follows it */
+        if (scc && !ext_3d) {
+            sps->curr_pic_ref_enabled_flag = va_BitReaderReadBit(br);
+            sps->palette_mode_enabled_flag = va_BitReaderReadBit(br);
+            if (sps->palette_mode_enabled_flag) {
+                sps->palette_max_size = v = va_BitReaderReadUE(br);
+                if (v > 64)
+                    return 0;
+                sps->delta_palette_max_predictor_size = v = va_BitReaderReadUE(br);
+                if (sps->palette_max_size + v > 128)
+                    return 0;
+                if (va_BitReaderReadBit(br)) {
+                    unsigned int comps = sps->chroma_format_idc ? 3 : 1, c;
+
+                    v = va_BitReaderReadUE(br) + 1;
+                    if (v > 128)
+                        return 0;
+                    sps->num_palette_predictor_initializers = v;
+                    for (c = 0; c < comps; c++)
+                        for (i = 0; i < v; i++)
+                            sps->palette_predictor_initializers[c][i] =
+                                va_BitReaderRead(br, 8 + (c ? sps->bit_depth_chroma_minus8 :
+                                                          sps->bit_depth_luma_minus8));
+                }
+            }
+            sps->motion_vector_resolution_control_idc = va_BitReaderRead(br, 2);
+            sps->intra_boundary_filtering_disabled_flag = va_BitReaderReadBit(br);
+        }
+    }
+
+    sps->profile = va_HEVCProfile(profile_idc, sps);
+    return !br->overrun;
+}
+
+static int va_HEVCParsePPS(va_bitreader *br, va_hevc_pps *pps, unsigned int *id)
+{
+    unsigned int i;
+    uint32_t v;
+    int32_t s;
+
+    memset(pps, 0, sizeof(*pps));
+
+    *id = va_BitReaderReadUE(br);
+    if (*id >= HEVC_MAX_PPS)
+        return 0;
+    v = va_BitReaderReadUE(br);
+    if (v >= HEVC_MAX_SPS)
+        return 0;
+    pps->sps_id = v;
+    pps->dependent_slice_segments_enabled_flag = va_BitReaderReadBit(br);
+    pps->output_flag_present_flag = va_BitReaderReadBit(br);
+    pps->num_extra_slice_header_bits = va_BitReaderRead(br, 3);
+    pps->sign_data_hiding_enabled_flag = va_BitReaderReadBit(br);
+    pps->cabac_init_present_flag = va_BitReaderReadBit(br);
+    pps->num_ref_idx_l0_default_active_minus1 = v = va_BitReaderReadUE(br);
+    if (v >= HEVC_MAX_REFS)
+        return 0;
+    pps->num_ref_idx_l1_default_active_minus1 = v = va_BitReaderReadUE(br);
+    if (v >= HEVC_MAX_REFS)
+        return 0;
+    pps->init_qp_minus26 = s = va_BitReaderReadSE(br);
+    if (s < -(26 + 6 * 8) || s > 25)
+        return 0;
+    pps->constrained_intra_pred_flag = va_BitReaderReadBit(br);
+    pps->transform_skip_enabled_flag = va_BitReaderReadBit(br);
+    pps->cu_qp_delta_enabled_flag = va_BitReaderReadBit(br);
+    if (pps->cu_qp_delta_enabled_flag)
+        pps->diff_cu_qp_delta_depth = va_BitReaderReadUE(br);
+    pps->cb_qp_offset = s = va_BitReaderReadSE(br);
+    if (s < -12 || s > 12)
+        return 0;
+    pps->cr_qp_offset = s = va_BitReaderReadSE(br);
+    if (s < -12 || s > 12)
+        return 0;
+    pps->slice_chroma_qp_offsets_present_flag = va_BitReaderReadBit(br);
+    pps->weighted_pred_flag = va_BitReaderReadBit(br);
+    pps->weighted_bipred_flag = va_BitReaderReadBit(br);
+    pps->transquant_bypass_enabled_flag = va_BitReaderReadBit(br);
+    pps->tiles_enabled_flag = va_BitReaderReadBit(br);
+    pps->entropy_coding_sync_enabled_flag = va_BitReaderReadBit(br);
+
+    if (pps->tiles_enabled_flag) {
+        pps->num_tile_columns_minus1 = v = va_BitReaderReadUE(br);
+        if (v >= 20)
+            return 0;
+        pps->num_tile_rows_minus1 = v = va_BitReaderReadUE(br);
+        if (v >= 22)
+            return 0;
+        pps->uniform_spacing_flag = va_BitReaderReadBit(br);
+        if (!pps->uniform_spacing_flag) {
+            for (i = 0; i < pps->num_tile_columns_minus1; i++)
+                pps->column_width_minus1[i] = va_BitReaderReadUE(br);
+            for (i = 0; i < pps->num_tile_rows_minus1; i++)
+                pps->row_height_minus1[i] = va_BitReaderReadUE(br);
+        }
+        pps->loop_filter_across_tiles_enabled_flag = va_BitReaderReadBit(br);
+    }
+    pps->loop_filter_across_slices_enabled_flag = va_BitReaderReadBit(br);
+    if (va_BitReaderReadBit(br)) {
+        pps->deblocking_filter_override_enabled_flag = va_BitReaderReadBit(br);
+        pps->deblocking_filter_disabled_flag = va_BitReaderReadBit(br);
+        if (!pps->deblocking_filter_disabled_flag) {
+            pps->beta_offset_div2 = s = va_BitReaderReadSE(br);
+            if (s < -6 || s > 6)
+                return 0;
+            pps->tc_offset_div2 = s = va_BitReaderReadSE(br);
+            if (s < -6 || s > 6)
+                return 0;
+        }
+    }
+    pps->scaling_list_data_present_flag = va_BitReaderReadBit(br);
+    if (pps->scaling_list_data_present_flag &&
+        !va_HEVCParseScalingLists(br, &pps->scaling_list))
+        return 0;
+    pps->lists_modification_present_flag = va_BitReaderReadBit(br);
+    pps->log2_parallel_merge_level_minus2 = va_BitReaderReadUE(br);
+    pps->slice_segment_header_extension_present_flag = va_BitReaderReadBit(br);
+
+    if (va_BitReaderReadBit(br)) {
+        int range = va_BitReaderReadBit(br);
+        int multilayer = va_BitReaderReadBit(br);
+        int ext_3d = va_BitReaderReadBit(br);
+        int scc = va_BitReaderReadBit(br);
+
+        va_BitReaderRead(br, 4);
+        if (range) {
+            if (pps->transform_skip_enabled_flag)
+                pps->log2_max_transform_skip_block_size_minus2 = va_BitReaderReadUE(br);
+            pps->cross_component_prediction_enabled_flag = va_BitReaderReadBit(br);
+            pps->chroma_qp_offset_list_enabled_flag = va_BitReaderReadBit(br);
+            if (pps->chroma_qp_offset_list_enabled_flag) {
+                pps->diff_cu_chroma_qp_offset_depth = va_BitReaderReadUE(br);
+                pps->chroma_qp_offset_list_len_minus1 = v = va_BitReaderReadUE(br);
+                if (v > 5)
+                    return 0;
+                for (i = 0; i <= v; i++) {
+                    pps->cb_qp_offset_list[i] = va_BitReaderReadSE(br);
+                    pps->cr_qp_offset_list[i] = va_BitReaderReadSE(br);
+                }
+            }
+            pps->log2_sao_offset_scale_luma = va_BitReaderReadUE(br);
+            pps->log2_sao_offset_scale_chroma = va_BitReaderReadUE(br);
+        }
+        /* the multilayer and 3D extensions are not supported, nor is what follows them */
+        if (scc && !multilayer && !ext_3d) {
+            pps->curr_pic_ref_enabled_flag = va_BitReaderReadBit(br);
+            pps->residual_adaptive_colour_transform_enabled_flag = va_BitReaderReadBit(br);
+            if (pps->residual_adaptive_colour_transform_enabled_flag) {
+                pps->slice_act_qp_offsets_present_flag = va_BitReaderReadBit(br);
+                pps->act_y_qp_offset_plus5 = va_BitReaderReadSE(br);
+                pps->act_cb_qp_offset_plus5 = va_BitReaderReadSE(br);
+                pps->act_cr_qp_offset_plus3 = va_BitReaderReadSE(br);
+            }
+            pps->palette_predictor_initializers_present_flag = va_BitReaderReadBit(br);
+            if (pps->palette_predictor_initializers_present_flag) {
+                v = va_BitReaderReadUE(br);
+                if (v > 128)
+                    return 0;
+                pps->num_palette_predictor_initializers = v;
+                if (v) {
+                    unsigned int mono = va_BitReaderReadBit(br), c;
+                    unsigned int depth[3];
+
+                    depth[0] = va_BitReaderReadUE(br) + 8;
+                    depth[1] = depth[2] = mono ? 0 : va_BitReaderReadUE(br) + 8;
+                    if (depth[0] > 16 || depth[1] > 16)
+                        return 0;
+                    for (c = 0; c < (mono ? 1U : 3U); c++)
+                        for (i = 0; i < v; i++)
+                            pps->palette_predictor_initializers[c][i] = va_BitReaderRead(br, depth[c]);
+                }
+            }
+        }
+    }
+    return !br->overrun;
+}
+
+/* the fields of a slice segment header that the picture level needs */
+typedef struct va_hevc_slice_info {
+    uint8_t nal_type;
+    uint8_t temporal_id;
+    uint8_t pic_output_flag;
+    uint8_t no_output_of_prior_pics_flag;
+    uint32_t poc_lsb;
+    const va_hevc_rps *rps;
+    va_hevc_rps slice_rps;
+    uint32_t st_rps_bits;
+    unsigned int num_lt;
+    int32_t lt_poc[32];
+    int32_t lt_msb_cycle[32];
+    uint8_t lt_used[32];
+    uint8_t lt_msb_present[32];
+} va_hevc_slice_info;
+
+VAStatus vaCreateHEVCParser(VAHEVCParser *parser)
+{
+    struct _VAHEVCParser *p;
+    unsigned int i;
+
+    if (!parser)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    p = calloc(1, sizeof(*p));
+    if (!p)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    p->first_picture = 1;
+    p->cur_slot = HEVC_NO_SLOT;
+    for (i = 0; i < HEVC_DPB_SLOTS; i++)
+        p->dpb[i].surface = VA_INVALID_SURFACE;
+
+    *parser = p;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyHEVCParser(VAHEVCParser parser)
+{
+    struct _VAHEVCParser *p = parser;
+    unsigned int i;
+
+    if (!p)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < HEVC_MAX_SPS; i++) {
+        free(p->sps[i].data);
+        free(p->sps[i].parsed);
+    }
+    for (i = 0; i < HEVC_MAX_PPS; i++) {
+        free(p->pps[i].data);
+        free(p->pps[i].parsed);
+    }
+    free(p);
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus va_HEVCParseParameterSet(
+    struct _VAHEVCParser *p,
+    unsigned int type,
+    va_bitreader *br,
+    const uint8_t *nal,
+    uint32_t size
+)
+{
+    va_bitreader peek = *br;
+    va_hevc_ps *ps;
+    unsigned int id;
+    size_t parsed_size;
+    int ok;
+
+    /* the VPS carries nothing the VA structures need */
+    if (type == HEVC_NAL_VPS)
+        return VA_STATUS_SUCCESS;
+
+    /* find the ID without parsing the whole set */
+    if (type == HEVC_NAL_SPS) {
+        va_BitReaderRead(&peek, 4);
+        id = va_BitReaderRead(&peek, 3);
+        va_BitReaderReadBit(&peek);
+        va_HEVCParsePTL(&peek, id);
+        id = va_BitReaderReadUE(&peek);
+        if (id >= HEVC_MAX_SPS)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        ps = &p->sps[id];
+        parsed_size = sizeof(va_hevc_sps);
+    } else {
+        id = va_BitReaderReadUE(&peek);
+        if (id >= HEVC_MAX_PPS)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        ps = &p->pps[id];
+        parsed_size = sizeof(va_hevc_pps);
+    }
+    if (peek.overrun)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    if (ps->valid && ps->size == size && !memcmp(ps->data, nal, size))
+        return VA_STATUS_SUCCESS;
+
+    if (size > ps->capacity) {
+        uint8_t *data = realloc(ps->data, size);
+
+        if (!data)
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+        ps->data = data;
+        ps->capacity = size;
+    }
+    if (!ps->parsed) {
+        ps->parsed = malloc(parsed_size);
+        if (!ps->parsed)
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    ps->valid = 0;
+    if (type == HEVC_NAL_SPS)
+        ok = va_HEVCParseSPS(br, ps->parsed, &id);
+    else
+        ok = va_HEVCParsePPS(br, ps->parsed, &id);
+    if (!ok)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    memcpy(ps->data, nal, size);
+    ps->size = size;
+    ps->generation = ++p->generation;
+    ps->valid = 1;
+    return VA_STATUS_SUCCESS;
+}
+
+/* the picture parameters that only depend on the active SPS and PPS */
+static void va_HEVCFillSequenceParams(struct _VAHEVCParser *p, const va_hevc_sps *sps, const va_hevc_pps *pps)
+{
+    VAPictureParameterBufferHEVC *pp = &p->pic.pic_param.base;
+    VAPictureParameterBufferHEVCRext *rext = &p->pic.pic_param.rext;
+    VAPictureParameterBufferHEVCScc *scc = &p->pic.pic_param.scc;
+    unsigned int ctb_log2 = sps->log2_min_cb_size_minus3 + 3 + sps->log2_diff_max_min_cb_size;
+    unsigned int width_ctb = (sps->width + (1 << ctb_log2) - 1) >> ctb_log2;
+    unsigned int height_ctb = (sps->height + (1 << ctb_log2) - 1) >> ctb_log2;
+    unsigned int i, cols = pps->num_tile_columns_minus1 + 1, rows = pps->num_tile_rows_minus1 + 1;
+
+    memset(&p->pic, 0, sizeof(p->pic));
+    p->pic.profile = sps->profile;
+
+    pp->pic_width_in_luma_samples = sps->width;
+    pp->pic_height_in_luma_samples = sps->height;
+    pp->pic_fields.bits.chroma_format_idc = sps->chroma_format_idc;
+    pp->pic_fields.bits.separate_colour_plane_flag = sps->separate_colour_plane_flag;
+    pp->pic_fields.bits.pcm_enabled_flag = sps->pcm_enabled_flag;
+    pp->pic_fields.bits.scaling_list_enabled_flag = sps->scaling_list_enabled_flag;
+    pp->pic_fields.bits.transform_skip_enabled_flag = pps->transform_skip_enabled_flag;
+    pp->pic_fields.bits.amp_enabled_flag = sps->amp_enabled_flag;
+    pp->pic_fields.bits.strong_intra_smoothing_enabled_flag = sps->strong_intra_smoothing_enabled_flag;
+    pp->pic_fields.bits.sign_data_hiding_enabled_flag = pps->sign_data_hiding_enabled_flag;
+    pp->pic_fields.bits.constrained_intra_pred_flag = pps->constrained_intra_pred_flag;
+    pp->pic_fields.bits.cu_qp_delta_enabled_flag = pps->cu_qp_delta_enabled_flag;
+    pp->pic_fields.bits.weighted_pred_flag = pps->weighted_pred_flag;
+    pp->pic_fields.bits.weighted_bipred_flag = pps->weighted_bipred_flag;
+    pp->pic_fields.bits.transquant_bypass_enabled_flag = pps->transquant_bypass_enabled_flag;
+    pp->pic_fields.bits.tiles_enabled_flag = pps->tiles_enabled_flag;
+    pp->pic_fields.bits.entropy_coding_sync_enabled_flag = pps->entropy_coding_sync_enabled_flag;
+    pp->pic_fields.bits.pps_loop_filter_across_slices_enabled_flag = pps->loop_filter_across_slices_enabled_flag;
+    pp->pic_fields.bits.loop_filter_across_tiles_enabled_flag = pps->loop_filter_across_tiles_enabled_flag;
+    pp->pic_fields.bits.pcm_loop_filter_disabled_flag = sps->pcm_loop_filter_disabled_flag;
+    pp->pic_fields.bits.NoPicReorderingFlag = sps->max_num_reorder_pics == 0;
+
+    pp->sps_max_dec_pic_buffering_minus1 = sps->max_dec_pic_buffering_minus1;
+    pp->bit_depth_luma_minus8 = sps->bit_depth_luma_minus8;
+    pp->bit_depth_chroma_minus8 = sps->bit_depth_chroma_minus8;
+    pp->pcm_sample_bit_depth_luma_minus1 = sps->pcm_bit_depth_luma_minus1;
+    pp->pcm_sample_bit_depth_chroma_minus1 = sps->pcm_bit_depth_chroma_minus1;
+    pp->log2_min_luma_coding_block_size_minus3 = sps->log2_min_cb_size_minus3;
+    pp->log2_diff_max_min_luma_coding_block_size = sps->log2_diff_max_min_cb_size;
+    pp->log2_min_transform_block_size_minus2 = sps->log2_min_tb_size_minus2;
+    pp->log2_diff_max_min_transform_block_size = sps->log2_diff_max_min_tb_size;
+    pp->log2_min_pcm_luma_coding_block_size_minus3 = sps->log2_min_pcm_cb_size_minus3;
+    pp->log2_diff_max_min_pcm_luma_coding_block_size = sps->log2_diff_max_min_pcm_cb_size;
+    pp->max_transform_hierarchy_depth_intra = sps->max_transform_hierarchy_depth_intra;
+    pp->max_transform_hierarchy_depth_inter = sps->max_transform_hierarchy_depth_inter;
+    pp->init_qp_minus26 = pps->init_qp_minus26;
+    pp->diff_cu_qp_delta_depth = pps->diff_cu_qp_delta_depth;
+    pp->pps_cb_qp_offset = pps->cb_qp_offset;
+    pp->pps_cr_qp_offset = pps->cr_qp_offset;
+    pp->log2_parallel_merge_level_minus2 = pps->log2_parallel_merge_level_minus2;
+
+    if (pps->tiles_enabled_flag) {
+        unsigned int last_col = width_ctb, last_row = height_ctb;
+
+        pp->num_tile_columns_minus1 = pps->num_tile_columns_minus1;
+        pp->num_tile_rows_minus1 = pps->num_tile_rows_minus1;
+        /* 6.5.1, the last column and row take what is left */
+        for (i = 0; i + 1 < cols && i < 19; i++) {
+            pp->column_width_minus1[i] = pps->uniform_spacing_flag ?
+                                         ((i + 1) * width_ctb) / cols - (i * width_ctb) / cols - 1 :
+                                         pps->column_width_minus1[i];
+            last_col -= pp->column_width_minus1[i] + 1;
+        }
+        if (i < 19)
+            pp->column_width_minus1[i] = last_col - 1;
+        for (i = 0; i + 1 < rows && i < 21; i++) {
+            pp->row_height_minus1[i] = pps->uniform_spacing_flag ?
+                                       ((i + 1) * height_ctb) / rows - (i * height_ctb) / rows - 1 :
+                                       pps->row_height_minus1[i];
+            last_row -= pp->row_height_minus1[i] + 1;
+        }
+        if (i < 21)
+            pp->row_height_minus1[i] = last_row - 1;
+    }
+
+    pp->slice_parsing_fields.bits.lists_modification_present_flag = pps->lists_modification_present_flag;
+    pp->slice_parsing_fields.bits.long_term_ref_pics_present_flag = sps->long_term_ref_pics_present_flag;
+    pp->slice_parsing_fields.bits.sps_temporal_mvp_enabled_flag = sps->temporal_mvp_enabled_flag;
+    pp->slice_parsing_fields.bits.cabac_init_present_flag = pps->cabac_init_present_flag;
+    pp->slice_parsing_fields.bits.output_flag_present_flag = pps->output_flag_present_flag;
+    pp->slice_parsing_fields.bits.dependent_slice_segments_enabled_flag = pps->dependent_slice_segments_enabled_flag;
+    pp->slice_parsing_fields.bits.pps_slice_chroma_qp_offsets_present_flag = pps->slice_chroma_qp_offsets_present_flag;
+    pp->slice_parsing_fields.bits.sample_adaptive_offset_enabled_flag = sps->sample_adaptive_offset_enabled_flag;
+    pp->slice_parsing_fields.bits.deblocking_filter_override_enabled_flag = pps->deblocking_filter_override_enabled_flag;
+    pp->slice_parsing_fields.bits.pps_disable_deblocking_filter_flag = pps->deblocking_filter_disabled_flag;
+    pp->slice_parsing_fields.bits.slice_segment_header_extension_present_flag = pps->slice_segment_header_extension_present_flag;
+
+    pp->log2_max_pic_order_cnt_lsb_minus4 = sps->log2_max_poc_lsb - 4;
+    pp->num_short_term_ref_pic_sets = sps->num_short_term_ref_pic_sets;
+    pp->num_long_term_ref_pic_sps = sps->num_long_term_ref_pics_sps;
+    pp->num_ref_idx_l0_default_active_minus1 = pps->num_ref_idx_l0_default_active_minus1;
+    pp->num_ref_idx_l1_default_active_minus1 = pps->num_ref_idx_l1_default_active_minus1;
+    pp->pps_beta_offset_div2 = pps->beta_offset_div2;
+    pp->pps_tc_offset_div2 = pps->tc_offset_div2;
+    pp->num_extra_slice_header_bits = pps->num_extra_slice_header_bits;
+
+    rext->range_extension_pic_fields.bits.transform_skip_rotation_enabled_flag = sps->transform_skip_rotation_enabled_flag;
+    rext->range_extension_pic_fields.bits.transform_skip_context_enabled_flag = sps->transform_skip_context_enabled_flag;
+    rext->range_extension_pic_fields.bits.implicit_rdpcm_enabled_flag = sps->implicit_rdpcm_enabled_flag;
+    rext->range_extension_pic_fields.bits.explicit_rdpcm_enabled_flag = sps->explicit_rdpcm_enabled_flag;
+    rext->range_extension_pic_fields.bits.extended_precision_processing_flag = sps->extended_precision_processing_flag;
+    rext->range_extension_pic_fields.bits.intra_smoothing_disabled_flag = sps->intra_smoothing_disabled_flag;
+    rext->range_extension_pic_fields.bits.high_precision_offsets_enabled_flag = sps->high_precision_offsets_enabled_flag;
+    rext->range_extension_pic_fields.bits.persistent_rice_adaptation_enabled_flag = sps->persistent_rice_adaptation_enabled_flag;
+    rext->range_extension_pic_fields.bits.cabac_bypass_alignment_enabled_flag = sps->cabac_bypass_alignment_enabled_flag;
+    rext->range_extension_pic_fields.bits.cross_component_prediction_enabled_flag = pps->cross_component_prediction_enabled_flag;
+    rext->range_extension_pic_fields.bits.chroma_qp_offset_list_enabled_flag = pps->chroma_qp_offset_list_enabled_flag;
+    rext->diff_cu_chroma_qp_offset_depth = pps->diff_cu_chroma_qp_offset_depth;
+    rext->chroma_qp_offset_list_len_minus1 = pps->chroma_qp_offset_list_len_minus1;
+    rext->log2_sao_offset_scale_luma = pps->log2_sao_offset_scale_luma;
+    rext->log2_sao_offset_scale_chroma = pps->log2_sao_offset_scale_chroma;
+    rext->log2_max_transform_skip_block_size_minus2 = pps->log2_max_transform_skip_block_size_minus2;
+    memcpy(rext->cb_qp_offset_list, pps->cb_qp_offset_list, sizeof(rext->cb_qp_offset_list));
+    memcpy(rext->cr_qp_offset_list, pps->cr_qp_offset_list, sizeof(rext->cr_qp_offset_list));
+
+    scc->screen_content_pic_fields.bits.pps_curr_pic_ref_enabled_flag = pps->curr_pic_ref_enabled_flag;
+    scc->screen_content_pic_fields.bits.palette_mode_enabled_flag = sps->palette_mode_enabled_flag;
+    scc->screen_content_pic_fields.bits.motion_vector_resolution_control_idc = sps->motion_vector_resolution_control_idc;
+    scc->screen_content_pic_fields.bits.intra_boundary_filtering_disabled_flag = sps->intra_boundary_filtering_disabled_flag;
+    scc->screen_content_pic_fields.bits.residual_adaptive_colour_transform_enabled_flag =
+        pps->residual_adaptive_colour_transform_enabled_flag;
+    scc->screen_content_pic_fields.bits.pps_slice_act_qp_offsets_present_flag = pps->slice_act_qp_offsets_present_flag;
+    scc->palette_max_size = sps->palette_max_size;
+    scc->delta_palette_max_predictor_size = sps->delta_palette_max_predictor_size;
+    /* the initializers of the PPS replace those of the SPS */
+    if (pps->palette_predictor_initializers_present_flag) {
+        scc->predictor_palette_size = pps->num_palette_predictor_initializers;
+        memcpy(scc->predictor_palette_entries, pps->palette_predictor_initializers,
+               sizeof(scc->predictor_palette_entries));
+    } else {
+        scc->predictor_palette_size = sps->num_palette_predictor_initializers;
+        memcpy(scc->predictor_palette_entries, sps->palette_predictor_initializers,
+               sizeof(scc->predictor_palette_entries));
+    }
+    scc->pps_act_y_qp_offset_plus5 = pps->act_y_qp_offset_plus5;
+    scc->pps_act_cb_qp_offset_plus5 = pps->act_cb_qp_offset_plus5;
+    scc->pps_act_cr_qp_offset_plus3 = pps->act_cr_qp_offset_plus3;
+
+    if (sps->scaling_list_enabled_flag)
+        p->pic.iq_matrix = pps->scaling_list_data_present_flag ? pps->scaling_list : sps->scaling_list;
+}
+
+static uint8_t va_HEVCFindRef(struct _VAHEVCParser *p, int32_t poc, int32_t mask, const uint8_t *keep, int short_term)
+{
+    unsigned int i;
+
+    for (i = 0; i < HEVC_DPB_SLOTS; i++) {
+        if (!p->dpb[i].used || (short_term && (keep[i] || p->dpb[i].long_term)))
+            continue;
+        if ((p->dpb[i].poc & mask) == poc)
+            return i;
+    }
+    return HEVC_NO_SLOT;
+}
+
+static void va_HEVCRemapSlot(struct _VAHEVCParser *p, uint8_t from, uint8_t to)
+{
+    unsigned int i;
+
+    for (i = 0; i < p->num_st_curr_before; i++)
+        if (p->st_curr_before[i] == from)
+            p->st_curr_before[i] = to;
+    for (i = 0; i < p->num_st_curr_after; i++)
+        if (p->st_curr_after[i] == from)
+            p->st_curr_after[i] = to;
+    for (i = 0; i < p->num_lt_curr; i++)
+        if (p->lt_curr[i] == from)
+            p->lt_curr[i] = to;
+}
+
+/*
+ * Decoding process for picture order count (8.3.1) and for the reference
+ * picture set (8.3.2) at the first slice segment of a picture, which
+ * then gets a DPB slot.
+ */
+static void va_HEVCStartPicture(
+    struct _VAHEVCParser *p,
+    const va_hevc_sps *sps,
+    const va_hevc_pps *pps,
+    uint32_t sps_generation,
+    uint32_t pps_generation,
+    const va_hevc_slice_info *info
+)
+{
+    VAPictureParameterBufferHEVC *pp = &p->pic.pic_param.base;
+    unsigned int type = info->nal_type;
+    int irap = type >= HEVC_NAL_BLA_W_LP && type <= HEVC_NAL_IRAP_MAX;
+    int idr = type == HEVC_NAL_IDR_W_RADL || type == HEVC_NAL_IDR_N_LP;
+    int no_rasl = irap && (type < HEVC_NAL_CRA_NUT || p->first_picture);
+    int32_t max_lsb = 1 << sps->log2_max_poc_lsb, msb = 0, poc;
+    uint8_t keep[HEVC_DPB_SLOTS] = { 0 };
+    unsigned int i;
+
+    if (!no_rasl) {
+        int32_t prev_lsb = p->prev_tid0_poc & (max_lsb - 1);
+        int32_t prev_msb = p->prev_tid0_poc - prev_lsb;
+        int32_t lsb = info->poc_lsb;
+
+        if (lsb < prev_lsb && prev_lsb - lsb >= max_lsb / 2)
+            msb = prev_msb + max_lsb;
+        else if (lsb > prev_lsb && lsb - prev_lsb > max_lsb / 2)
+            msb = prev_msb - max_lsb;
+        else
+            msb = prev_msb;
+    }
+    poc = msb + (int32_t)info->poc_lsb;
+    /* TemporalId 0 pictures other than RASL, RADL and sub-layer non-reference pictures */
+    if (info->temporal_id == 0 && (type < HEVC_NAL_RADL_N || type > HEVC_NAL_RASL_R) &&
+        (type > 14 || (type & 1)))
+        p->prev_tid0_poc = poc;
+
+    p->num_st_curr_before = p->num_st_curr_after = p->num_lt_curr = 0;
+    if (idr || no_rasl) {
+        for (i = 0; i < HEVC_DPB_SLOTS; i++)
+            p->dpb[i].used = 0;
+    }
+    if (!idr) {
+        /* long-term pictures are identified first, among all references */
+        for (i = 0; i < info->num_lt; i++) {
+            int32_t lt = info->lt_poc[i], mask = max_lsb - 1;
+            uint8_t slot;
+
+            if (info->lt_msb_present[i]) {
+                lt += poc - info->lt_msb_cycle[i] * max_lsb - (poc & (max_lsb - 1));
+                mask = -1;
+            }
+            slot = va_HEVCFindRef(p, lt, mask, keep, 0);
+            if (slot != HEVC_NO_SLOT)
+                keep[slot] = 2;
+            if (info->lt_used[i] && p->num_lt_curr < HEVC_MAX_RPS)
+                p->lt_curr[p->num_lt_curr++] = slot;
+        }
+        for (i = 0; info->rps && i < (unsigned int)info->rps->num_negative + info->rps->num_positive; i++) {
+            uint8_t slot = va_HEVCFindRef(p, poc + info->rps->delta_poc[i], -1, keep, 1);
+
+            if (slot != HEVC_NO_SLOT)
+                keep[slot] = 1;
+            if (!info->rps->used[i])
+                continue;
+            if (i < info->rps->num_negative)
+                p->st_curr_before[p->num_st_curr_before++] = slot;
+            else
+                p->st_curr_after[p->num_st_curr_after++] = slot;
+        }
+    }
+    for (i = 0; i < HEVC_DPB_SLOTS; i++) {
+        if (!keep[i])
+            p->dpb[i].used = 0;
+        else if (keep[i] == 2)
+            p->dpb[i].long_term = 1;
+    }
+
+    /* ReferenceFrames[] has one entry less than the DPB */
+    if (p->dpb[HEVC_MAX_REFS].used) {
+        uint8_t to = HEVC_NO_SLOT;
+
+        for (i = 0; i < HEVC_MAX_REFS; i++) {
+            if (!p->dpb[i].used) {
+                p->dpb[i] = p->dpb[HEVC_MAX_REFS];
+                to = i;
+                break;
+            }
+        }
+        p->dpb[HEVC_MAX_REFS].used = 0;
+        va_HEVCRemapSlot(p, HEVC_MAX_REFS, to);
+    }
+    for (i = 0; p->dpb[i].used; i++)
+        ;
+    p->cur_slot = i;
+    p->dpb[i].used = 1;
+    p->dpb[i].long_term = 0;
+    p->dpb[i].poc = poc;
+    p->dpb[i].surface = VA_INVALID_SURFACE;
+
+    if (sps != p->cur_sps || pps != p->cur_pps ||
+        sps_generation != p->cur_sps_generation || pps_generation != p->cur_pps_generation) {
+        va_HEVCFillSequenceParams(p, sps, pps);
+        p->cur_sps = sps;
+        p->cur_pps = pps;
+        p->cur_sps_generation = sps_generation;
+        p->cur_pps_generation = pps_generation;
+    }
+
+    pp->CurrPic.picture_id = VA_INVALID_SURFACE;
+    pp->CurrPic.pic_order_cnt = poc;
+    pp->CurrPic.flags = 0;
+    for (i = 0; i < HEVC_MAX_REFS; i++) {
+        VAPictureHEVC *ref = &pp->ReferenceFrames[i];
+
+        if (p->dpb[i].used && (i != p->cur_slot || pps->curr_pic_ref_enabled_flag)) {
+            ref->picture_id = p->dpb[i].surface;
+            ref->pic_order_cnt = p->dpb[i].poc;
+            ref->flags = p->dpb[i].long_term ? VA_PICTURE_HEVC_LONG_TERM_REFERENCE : 0;
+        } else {
+            ref->picture_id = VA_INVALID_SURFACE;
+            ref->pic_order_cnt = 0;
+            ref->flags = VA_PICTURE_HEVC_INVALID;
+        }
+    }
+    for (i = 0; i < p->num_st_curr_before; i++)
+        if (p->st_curr_before[i] < HEVC_MAX_REFS)
+            pp->ReferenceFrames[p->st_curr_before[i]].flags |= VA_PICTURE_HEVC_RPS_ST_CURR_BEFORE;
+    for (i = 0; i < p->num_st_curr_after; i++)
+        if (p->st_curr_after[i] < HEVC_MAX_REFS)
+            pp->ReferenceFrames[p->st_curr_after[i]].flags |= VA_PICTURE_HEVC_RPS_ST_CURR_AFTER;
+    for (i = 0; i < p->num_lt_curr; i++)
+        if (p->lt_curr[i] < HEVC_MAX_REFS)
+            pp->ReferenceFrames[p->lt_curr[i]].flags |= VA_PICTURE_HEVC_RPS_LT_CURR;
+
+    pp->slice_parsing_fields.bits.RapPicFlag = irap;
+    pp->slice_parsing_fields.bits.IdrPicFlag = idr;
+    pp->slice_parsing_fields.bits.IntraPicFlag = irap;
+    pp->st_rps_bits = info->st_rps_bits;
+
+    p->pic.poc = poc;
+    p->pic.output_flag = info->pic_output_flag;
+    p->pic.no_rasl_output = no_rasl;
+    /* C.5.2.2, inferred to 1 for a CRA picture */
+    p->pic.no_output_of_prior_pics = no_rasl && !p->first_picture &&
+                                     (type == HEVC_NAL_CRA_NUT || info->no_output_of_prior_pics_flag);
+    p->pic.max_num_reorder = sps->max_num_reorder_pics;
+    if (irap)
+        p->skip_rasl = no_rasl;
+    p->first_picture = 0;
+    p->in_picture = 1;
+    p->skipping = 0;
+}
+
+/* 8.3.4, with list_entry_lX[] when the list is modified */
+static void va_HEVCBuildRefList(
+    const struct _VAHEVCParser *p,
+    const va_hevc_pps *pps,
+    int l1,
+    unsigned int num_active,
+    const uint8_t *entries,
+    uint8_t *list
+)
+{
+    unsigned int total = p->num_st_curr_before + p->num_st_curr_after + p->num_lt_curr +
+                         pps->curr_pic_ref_enabled_flag;
+    unsigned int num_temp = num_active > total ? num_active : total;
+    const uint8_t *first = l1 ? p->st_curr_after : p->st_curr_before;
+    const uint8_t *second = l1 ? p->st_curr_before : p->st_curr_after;
+    unsigned int num_first = l1 ? p->num_st_curr_after : p->num_st_curr_before;
+    unsigned int num_second = l1 ? p->num_st_curr_before : p->num_st_curr_after;
+    uint8_t temp[4 * HEVC_MAX_RPS];
+    unsigned int n = 0, i;
+
+    memset(list, 0xff, HEVC_MAX_REFS);
+    if (!total)
+        return;
+
+    while (n < num_temp) {
+        for (i = 0; i < num_first && n < num_temp; i++)
+            temp[n++] = first[i];
+        for (i = 0; i < num_second && n < num_temp; i++)
+            temp[n++] = second[i];
+        for (i = 0; i < p->num_lt_curr && n < num_temp; i++)
+            temp[n++] = p->lt_curr[i];
+        if (pps->curr_pic_ref_enabled_flag && n < num_temp)
+            temp[n++] = p->cur_slot;
+    }
+
+    for (i = 0; i < num_active; i++) {
+        uint8_t slot = temp[entries ? (entries[i] < total ? entries[i] : 0) : i];
+
+        list[i] = slot < HEVC_MAX_REFS ? slot : 0xff;
+    }
+    if (pps->curr_pic_ref_enabled_flag && !entries && num_temp > num_active &&
+        p->cur_slot < HEVC_MAX_REFS)
+        list[num_active - 1] = p->cur_slot;
+}
+
+/* pred_weight_table() (7.3.6.3), returns 0 on out of range values */
+static int va_HEVCParsePredWeights(
+    va_bitreader *br,
+    const struct _VAHEVCParser *p,
+    const va_hevc_sps *sps,
+    const va_hevc_pps *pps,
+    VASliceParameterBufferHEVCExtension *sp,
+    unsigned int num_lists
+)
+{
+    VASliceParameterBufferHEVC *s = &sp->base;
+    VASliceParameterBufferHEVCRext *rx = &sp->rext;
+    int chroma = !sps->separate_colour_plane_flag && sps->chroma_format_idc;
+    int32_t half_y = 1 << (sps->high_precision_offsets_enabled_flag ? sps->bit_depth_luma_minus8 + 7 : 7);
+    int32_t half_c = 1 << (sps->high_precision_offsets_enabled_flag ? sps->bit_depth_chroma_minus8 + 7 : 7);
+    unsigned int chroma_log2, l, i, j;
+
+    s->luma_log2_weight_denom = va_BitReaderReadUE(br) & 7;
+    chroma_log2 = s->luma_log2_weight_denom;
+    if (chroma) {
+        s->delta_chroma_log2_weight_denom = va_BitReaderReadSE(br);
+        chroma_log2 = (s->luma_log2_weight_denom + s->delta_chroma_log2_weight_denom) & 7;
+    }
+
+    for (l = 0; l < num_lists; l++) {
+        unsigned int num = (l ? s->num_ref_idx_l1_active_minus1 : s->num_ref_idx_l0_active_minus1) + 1;
+        int8_t *luma_weight = l ? s->delta_luma_weight_l1 : s->delta_luma_weight_l0;
+        int8_t *luma_offset = l ? s->luma_offset_l1 : s->luma_offset_l0;
+        int8_t (*chroma_weight)[2] = l ? s->delta_chroma_weight_l1 : s->delta_chroma_weight_l0;
+        int8_t (*chroma_offset)[2] = l ? s->ChromaOffsetL1 : s->ChromaOffsetL0;
+        int16_t *luma_offset_ext = l ? rx->luma_offset_l1 : rx->luma_offset_l0;
+        int16_t (*chroma_offset_ext)[2] = l ? rx->ChromaOffsetL1 : rx->ChromaOffsetL0;
+        uint32_t luma_flags = 0, chroma_flags = 0;
+
+        /* no weights for the current picture used as a reference */
+        for (i = 0; i < num; i++) {
+            if (!pps->curr_pic_ref_enabled_flag || s->RefPicList[l][i] != p->cur_slot)
+                luma_flags |= va_BitReaderReadBit(br) << i;
+        }
+        for (i = 0; chroma && i < num; i++) {
+            if (!pps->curr_pic_ref_enabled_flag || s->RefPicList[l][i] != p->cur_slot)
+                chroma_flags |= va_BitReaderReadBit(br) << i;
+        }
+        for (i = 0; i < num; i++) {
+            if (luma_flags & (1 << i)) {
+                int32_t delta_weight = va_BitReaderReadSE(br);
+                int32_t offset = va_BitReaderReadSE(br);
+
+                if (delta_weight < -128 || delta_weight > 127 || offset < -half_y || offset > half_y - 1)
+                    return 0;
+                luma_weight[i] = delta_weight;
+                luma_offset_ext[i] = offset;
+                luma_offset[i] = offset;
+            }
+            if (!(chroma_flags & (1 << i)))
+                continue;
+            for (j = 0; j < 2; j++) {
+                int32_t delta_weight = va_BitReaderReadSE(br);
+                int32_t delta_offset = va_BitReaderReadSE(br);
+                int32_t weight, offset;
+
+                if (delta_weight < -128 || delta_weight > 127 ||
+                    delta_offset < -4 * half_c || delta_offset > 4 * half_c - 1)
+                    return 0;
+                weight = (1 << chroma_log2) + delta_weight;
+                offset = half_c + delta_offset - ((half_c * weight) >> chroma_log2);
+                offset = offset < -half_c ? -half_c : offset > half_c - 1 ? half_c - 1 : offset;
+                chroma_weight[i][j] = delta_weight;
+                chroma_offset_ext[i][j] = offset;
+                chroma_offset[i][j] = offset;
+            }
+        }
+    }
+    return 1;
+}
+
+static VAStatus va_HEVCParseSlice(
+    struct _VAHEVCParser *p,
+    va_hevc_slice_info *info,
+    va_bitreader *br,
+    const uint8_t *nal,
+    uint32_t size,
+    uint32_t slice_data_offset,
+    uint32_t *result,
+    VASliceParameterBufferHEVCExtension *sp
+)
+{
+    VASliceParameterBufferHEVC *s = &sp->base;
+    VASliceParameterBufferHEVCRext *rx = &sp->rext;
+    const va_hevc_sps *sps;
+    const va_hevc_pps *pps;
+    unsigned int type = info->nal_type, first, dependent = 0, address = 0, pps_id, i;
+    unsigned int ctb_log2, num_ctb, slice_type, num_total = 0, sao_luma = 0, sao_chroma = 0;
+    unsigned int temporal_mvp = 0, disabled, chroma_array_type;
+    int32_t beta, tc;
+    size_t header_bits;
+
+    first = va_BitReaderReadBit(br);
+    info->no_output_of_prior_pics_flag = 0;
+    if (type >= HEVC_NAL_BLA_W_LP && type <= HEVC_NAL_IRAP_MAX)
+        info->no_output_of_prior_pics_flag = va_BitReaderReadBit(br);
+    pps_id = va_BitReaderReadUE(br);
+    if (pps_id >= HEVC_MAX_PPS || !p->pps[pps_id].valid)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    pps = p->pps[pps_id].parsed;
+    if (!p->sps[pps->sps_id].valid)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    sps = p->sps[pps->sps_id].parsed;
+
+    if (first) {
+        if ((type == HEVC_NAL_RASL_N || type == HEVC_NAL_RASL_R) && p->skip_rasl) {
+            p->in_picture = 0;
+            p->skipping = 1;
+            *result = VA_HEVC_PARSE_SKIPPED;
+            return VA_STATUS_SUCCESS;
+        }
+    } else {
+        if (p->skipping) {
+            *result = VA_HEVC_PARSE_SKIPPED;
+            return VA_STATUS_SUCCESS;
+        }
+        if (!p->in_picture || pps != p->cur_pps)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+
+    ctb_log2 = sps->log2_min_cb_size_minus3 + 3 + sps->log2_diff_max_min_cb_size;
+    num_ctb = ((sps->width + (1 << ctb_log2) - 1) >> ctb_log2) *
+              ((sps->height + (1 << ctb_log2) - 1) >> ctb_log2);
+    chroma_array_type = sps->separate_colour_plane_flag ? 0 : sps->chroma_format_idc;
+
+    if (!first) {
+        if (pps->dependent_slice_segments_enabled_flag)
+            dependent = va_BitReaderReadBit(br);
+        address = va_BitReaderRead(br, va_CeilLog2(num_ctb));
+        if (address >= num_ctb)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+
+    if (dependent) {
+        *sp = p->last_slice;
+    } else {
+        memset(sp, 0, sizeof(*sp));
+        va_BitReaderRead(br, pps->num_extra_slice_header_bits);
+        slice_type = va_BitReaderReadUE(br);
+        if (slice_type > HEVC_SLICE_I)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        info->pic_output_flag = pps->output_flag_present_flag ? va_BitReaderReadBit(br) : 1;
+        if (sps->separate_colour_plane_flag)
+            s->LongSliceFlags.fields.color_plane_id = va_BitReaderRead(br, 2);
+
+        info->rps = NULL;
+        info->num_lt = 0;
+        info->poc_lsb = 0;
+        info->st_rps_bits = 0;
+        if (type != HEVC_NAL_IDR_W_RADL && type != HEVC_NAL_IDR_N_LP) {
+            info->poc_lsb = va_BitReaderRead(br, sps->log2_max_poc_lsb);
+            if (!va_BitReaderReadBit(br)) {
+                size_t start = va_BitReaderPosition(br);
+
+                if (!va_HEVCParseRPS(br, sps->st_rps, &info->slice_rps, sps->num_short_term_ref_pic_sets,
+                                     sps->num_short_term_ref_pic_sets))
+                    return VA_STATUS_ERROR_INVALID_PARAMETER;
+                info->st_rps_bits = va_BitReaderPosition(br) - start;
+                info->rps = &info->slice_rps;
+            } else {
+                unsigned int idx = 0;
+
+                if (!sps->num_short_term_ref_pic_sets)
+                    return VA_STATUS_ERROR_INVALID_PARAMETER;
+                idx = va_BitReaderRead(br, va_CeilLog2(sps->num_short_term_ref_pic_sets));
+                if (idx >= sps->num_short_term_ref_pic_sets)
+                    return VA_STATUS_ERROR_INVALID_PARAMETER;
+                info->rps = &sps->st_rps[idx];
+            }
+            if (sps->long_term_ref_pics_present_flag) {
+                unsigned int num_lt_sps = 0, num_lt_pics;
+                int32_t msb_cycle = 0;
+
+                if (sps->num_long_term_ref_pics_sps)
+                    num_lt_sps = va_BitReaderReadUE(br);
+                num_lt_pics = va_BitReaderReadUE(br);
+                if (num_lt_sps > sps->num_long_term_ref_pics_sps || num_lt_sps + num_lt_pics > 32)
+                    return VA_STATUS_ERROR_INVALID_PARAMETER;
+                info->num_lt = num_lt_sps + num_lt_pics;
+                for (i = 0; i < info->num_lt; i++) {
+                    if (i < num_lt_sps) {
+                        unsigned int idx = va_BitReaderRead(br, va_CeilLog2(sps->num_long_term_ref_pics_sps));
+
+                        if (idx >= sps->num_long_term_ref_pics_sps)
+                            return VA_STATUS_ERROR_INVALID_PARAMETER;
+                        info->lt_poc[i] = sps->lt_ref_pic_poc_lsb_sps[idx];
+                        info->lt_used[i] = sps->used_by_curr_pic_lt_sps_flag[idx];
+                    } else {
+                        info->lt_poc[i] = va_BitReaderRead(br, sps->log2_max_poc_lsb);
+                        info->lt_used[i] = va_BitReaderReadBit(br);
+                    }
+                    info->lt_msb_present[i] = va_BitReaderReadBit(br);
+                    /* DeltaPocMsbCycleLt accumulates within the SPS and the slice entries */
+                    if (i == 0 || i == num_lt_sps)
+                        msb_cycle = 0;
+                    if (info->lt_msb_present[i])
+                        msb_cycle += va_BitReaderReadUE(br);
+                    info->lt_msb_cycle[i] = msb_cycle;
+                }
+            }
+            if (sps->temporal_mvp_enabled_flag)
+                temporal_mvp = va_BitReaderReadBit(br);
+        }
+        if (br->overrun)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+        if (first) {
+            va_HEVCStartPicture(p, sps, pps, p->sps[pps->sps_id].generation,
+                                p->pps[pps_id].generation, info);
+            *result |= VA_HEVC_PARSE_PICTURE;
+        }
+        num_total = p->num_st_curr_before + p->num_st_curr_after + p->num_lt_curr +
+                    pps->curr_pic_ref_enabled_flag;
+
+        if (sps->sample_adaptive_offset_enabled_flag) {
+            sao_luma = va_BitReaderReadBit(br);
+            if (chroma_array_type)
+                sao_chroma = va_BitReaderReadBit(br);
+        }
+
+        memset(s->RefPicList, 0xff, sizeof(s->RefPicList));
+        s->collocated_ref_idx = 0xff;
+        if (slice_type != HEVC_SLICE_I) {
+            unsigned int num_l0 = pps->num_ref_idx_l0_default_active_minus1;
+            unsigned int num_l1 = pps->num_ref_idx_l1_default_active_minus1;
+            uint8_t entries[2][HEVC_MAX_REFS];
+            int modified[2] = { 0, 0 };
+            unsigned int collocated_from_l0 = 1;
+
+            if (va_BitReaderReadBit(br)) {
+                num_l0 = va_BitReaderReadUE(br);
+                if (slice_type == HEVC_SLICE_B)
+                    num_l1 = va_BitReaderReadUE(br);
+                if (num_l0 >= HEVC_MAX_REFS || num_l1 >= HEVC_MAX_REFS)
+                    return VA_STATUS_ERROR_INVALID_PARAMETER;
+            }
+            if (slice_type == HEVC_SLICE_P)
+                num_l1 = 0;
+            s->num_ref_idx_l0_active_minus1 = num_l0;
+            s->num_ref_idx_l1_active_minus1 = num_l1;
+
+            if (pps->lists_modification_present_flag && num_total > 1) {
+                unsigned int bits = va_CeilLog2(num_total), l;
+
+                for (l = 0; l < (slice_type == HEVC_SLICE_B ? 2U : 1U); l++) {
+                    modified[l] = va_BitReaderReadBit(br);
+                    for (i = 0; modified[l] && i <= (l ? num_l1 : num_l0); i++)
+                        entries[l][i] = va_BitReaderRead(br, bits);
+                }
+            }
+            va_HEVCBuildRefList(p, pps, 0, num_l0 + 1, modified[0] ? entries[0] : NULL, s->RefPicList[0]);
+            if (slice_type == HEVC_SLICE_B)
+                va_HEVCBuildRefList(p, pps, 1, num_l1 + 1, modified[1] ? entries[1] : NULL, s->RefPicList[1]);
+
+            if (slice_type == HEVC_SLICE_B)
+                s->LongSliceFlags.fields.mvd_l1_zero_flag = va_BitReaderReadBit(br);
+            if (pps->cabac_init_present_flag)
+                s->LongSliceFlags.fields.cabac_init_flag = va_BitReaderReadBit(br);
+            if (temporal_mvp) {
+                if (slice_type == HEVC_SLICE_B)
+                    collocated_from_l0 = va_BitReaderReadBit(br);
+                s->collocated_ref_idx = 0;
+                if ((collocated_from_l0 && num_l0 > 0) || (!collocated_from_l0 && num_l1 > 0)) {
+                    s->collocated_ref_idx = va_BitReaderReadUE(br);
+                    if (s->collocated_ref_idx > (collocated_from_l0 ? num_l0 : num_l1))
+                        return VA_STATUS_ERROR_INVALID_PARAMETER;
+                }
+            }
+            s->LongSliceFlags.fields.collocated_from_l0_flag = collocated_from_l0;
+            if ((pps->weighted_pred_flag && slice_type == HEVC_SLICE_P) ||
+                (pps->weighted_bipred_flag && slice_type == HEVC_SLICE_B)) {
+                if (!va_HEVCParsePredWeights(br, p, sps, pps, sp, slice_type == HEVC_SLICE_B ? 2 : 1))
+                    return VA_STATUS_ERROR_INVALID_PARAMETER;
+            }
+            s->five_minus_max_num_merge_cand = va_BitReaderReadUE(br);
+            if (s->five_minus_max_num_merge_cand > 4)
+                return VA_STATUS_ERROR_INVALID_PARAMETER;
+            if (sps->motion_vector_resolution_control_idc == 2)
+                rx->slice_ext_flags.bits.use_integer_mv_flag = va_BitReaderReadBit(br);
+        }
+
+        s->slice_qp_delta = va_BitReaderReadSE(br);
+        if (pps->slice_chroma_qp_offsets_present_flag) {
+            s->slice_cb_qp_offset = va_BitReaderReadSE(br);
+            s->slice_cr_qp_offset = va_BitReaderReadSE(br);
+        }
+        if (pps->slice_act_qp_offsets_present_flag) {
+            rx->slice_act_y_qp_offset = va_BitReaderReadSE(br);
+            rx->slice_act_cb_qp_offset = va_BitReaderReadSE(br);
+            rx->slice_act_cr_qp_offset = va_BitReaderReadSE(br);
+        }
+        if (pps->chroma_qp_offset_list_enabled_flag)
+            rx->slice_ext_flags.bits.cu_chroma_qp_offset_enabled_flag = va_BitReaderReadBit(br);
+
+        disabled = pps->deblocking_filter_disabled_flag;
+        beta = pps->beta_offset_div2;
+        tc = pps->tc_offset_div2;
+        if (pps->deblocking_filter_override_enabled_flag && va_BitReaderReadBit(br)) {
+            disabled = va_BitReaderReadBit(br);
+            if (!disabled) {
+                beta = va_BitReaderReadSE(br);
+                tc = va_BitReaderReadSE(br);
+            }
+        }
+        s->slice_beta_offset_div2 = beta;
+        s->slice_tc_offset_div2 = tc;
+
+        s->LongSliceFlags.fields.slice_loop_filter_across_slices_enabled_flag =
+            pps->loop_filter_across_slices_enabled_flag;
+        if (pps->loop_filter_across_slices_enabled_flag && (sao_luma || sao_chroma || !disabled))
+            s->LongSliceFlags.fields.slice_loop_filter_across_slices_enabled_flag = va_BitReaderReadBit(br);
+
+        s->LongSliceFlags.fields.slice_type = slice_type;
+        s->LongSliceFlags.fields.slice_sao_luma_flag = sao_luma;
+        s->LongSliceFlags.fields.slice_sao_chroma_flag = sao_chroma;
+        s->LongSliceFlags.fields.slice_temporal_mvp_enabled_flag = temporal_mvp;
+        s->LongSliceFlags.fields.slice_deblocking_filter_disabled_flag = disabled;
+    }
+
+    s->num_entry_point_offsets = 0;
+    if (pps->tiles_enabled_flag || pps->entropy_coding_sync_enabled_flag) {
+        uint32_t num = va_BitReaderReadUE(br);
+
+        if (num > num_ctb)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        if (num) {
+            uint32_t bits = va_BitReaderReadUE(br) + 1;
+
+            if (bits > 32)
+                return VA_STATUS_ERROR_INVALID_PARAMETER;
+            va_BitReaderSkip(br, (size_t)num * bits);
+        }
+        s->num_entry_point_offsets = num;
+    }
+    if (pps->slice_segment_header_extension_present_flag) {
+        uint32_t len = va_BitReaderReadUE(br);
+
+        if (len > 256)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        va_BitReaderSkip(br, len * 8);
+    }
+    /* byte_alignment() */
+    if (!va_BitReaderReadBit(br))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    va_BitReaderAlign(br);
+    if (br->overrun)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    header_bits = va_BitReaderPosition(br) + 16;
+    s->slice_data_size = size;
+    s->slice_data_offset = slice_data_offset;
+    s->slice_data_flag = VA_SLICE_DATA_FLAG_ALL;
+    s->slice_data_byte_offset = header_bits / 8;
+    s->slice_data_num_emu_prevn_bytes = vaNALUnitBitOffset(nal, size, header_bits) / 8 - header_bits / 8;
+    s->slice_segment_address = address;
+    s->LongSliceFlags.fields.LastSliceOfPic = 0;
+    s->LongSliceFlags.fields.dependent_slice_segment_flag = dependent;
+    if (!dependent)
+        p->last_slice = *sp;
+
+    *result |= VA_HEVC_PARSE_SLICE;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaParseHEVCNALUnit(
+    VAHEVCParser parser,
+    const uint8_t *nal,
+    uint32_t size,
+    uint32_t slice_data_offset,
+    uint32_t *result,
+    VASliceParameterBufferHEVCExtension *slice
+)
+{
+    struct _VAHEVCParser *p = parser;
+    VASliceParameterBufferHEVCExtension tmp;
+    va_hevc_slice_info info;
+    va_bitreader br;
+    unsigned int type;
+
+    if (!p || !nal || size < 2 || !result)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    *result = 0;
+
+    /* forbidden_zero_bit, nuh_temporal_id_plus1 */
+    if ((nal[0] & 0x80) || !(nal[1] & 0x7))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    /* only the base layer is decoded */
+    if (((nal[0] & 0x1) << 5) | (nal[1] >> 3))
+        return VA_STATUS_SUCCESS;
+
+    type = (nal[0] >> 1) & 0x3f;
+    va_BitReaderInit(&br, nal + 2, size - 2, 1);
+
+    switch (type) {
+    case HEVC_NAL_VPS:
+    case HEVC_NAL_SPS:
+    case HEVC_NAL_PPS:
+        *result = VA_HEVC_PARSE_PARAMETER_SET;
+        return va_HEVCParseParameterSet(p, type, &br, nal, size);
+    case HEVC_NAL_EOS:
+        /* the next picture is an IRAP picture with NoRaslOutputFlag */
+        p->first_picture = 1;
+        return VA_STATUS_SUCCESS;
+    default:
+        /* VCL NAL unit types other than the reserved ones */
+        if (type > HEVC_NAL_RASL_R && (type < HEVC_NAL_BLA_W_LP || type > HEVC_NAL_CRA_NUT))
+            return VA_STATUS_SUCCESS;
+        info.nal_type = type;
+        info.temporal_id = (nal[1] & 0x7) - 1;
+        return va_HEVCParseSlice(p, &info, &br, nal, size, slice_data_offset, result,
+                                 slice ? slice : &tmp);
+    }
+}
+
+VAStatus vaGetHEVCPictureParams(
+    VAHEVCParser parser,
+    VASurfaceID surface,
+    VAHEVCPictureParams *params
+)
+{
+    struct _VAHEVCParser *p = parser;
+
+    if (!p || !params)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (!p->in_picture)
+        return VA_STATUS_ERROR_OPERATION_FAILED;
+
+    p->dpb[p->cur_slot].surface = surface;
+    p->pic.pic_param.base.CurrPic.picture_id = surface;
+    if (p->cur_slot < HEVC_MAX_REFS && p->cur_pps->curr_pic_ref_enabled_flag)
+        p->pic.pic_param.base.ReferenceFrames[p->cur_slot].picture_id = surface;
+
+    *params = p->pic;
+    return VA_STATUS_SUCCESS;
+}
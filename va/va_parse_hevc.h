@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_parse_hevc.h
+ * \brief HEVC bitstream parser for decode
+ *
+ * Parses the parameter sets and slice segment headers of an HEVC stream
+ * and fills the VA decode parameter structures of va_dec_hevc.h with
+ * them, so that simple clients can drive the VLD entrypoint without a
+ * parsing framework. The parser caches the parameter sets per ID, keeps
+ * the reference picture set state and builds ReferenceFrames[] and the
+ * reference picture lists. It does not allocate after the first
+ * parameter sets have been seen.
+ *
+ * Usage, with NAL units e.g. from vaSplitAnnexB():
+ * - pass each NAL unit to vaParseHEVCNALUnit();
+ * - when it returns VA_HEVC_PARSE_PICTURE, the previous picture is
+ *   complete: end it with vaEndPicture(), pick the surface of the new
+ *   picture and get its parameters with vaGetHEVCPictureParams();
+ * - with VA_HEVC_PARSE_SLICE, the slice parameters have been filled,
+ *   queue them with the NAL unit for the current picture. Set
+ *   LongSliceFlags.fields.LastSliceOfPic of the last slice before
+ *   rendering.
+ */
+
+#ifndef _VA_PARSE_HEVC_H_
+#define _VA_PARSE_HEVC_H_
+
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_parse_hevc HEVC parser
+ *
+ * @{
+ */
+
+/** \brief Opaque HEVC parser state. */
+typedef struct _VAHEVCParser *VAHEVCParser;
+
+/** \brief Parameters of a picture. */
+typedef struct _VAHEVCPictureParams {
+    /** \brief Profile of the active sequence parameter set. */
+    VAProfile profile;
+    /**
+     * \brief Picture parameters. The range and screen content extensions
+     * are only used with the profiles that have them, the buffer is then
+     * sizeof(VAPictureParameterBufferHEVCExtension) rather than
+     * sizeof(VAPictureParameterBufferHEVC) bytes.
+     */
+    VAPictureParameterBufferHEVCExtension pic_param;
+    /**
+     * \brief Scaling lists, to be submitted when
+     * pic_param.base.pic_fields.bits.scaling_list_enabled_flag is set.
+     */
+    VAIQMatrixBufferHEVC iq_matrix;
+    /** \brief Value of PicOrderCntVal. */
+    int32_t poc;
+    /** \brief Value of pic_output_flag (PicOutputFlag). */
+    uint8_t output_flag;
+    /** \brief The picture is an IRAP picture with NoRaslOutputFlag set. */
+    uint8_t no_rasl_output;
+    /**
+     * \brief Value of NoOutputOfPriorPicsFlag for an IRAP picture with
+     * NoRaslOutputFlag set: the pictures decoded before it and not output
+     * yet are discarded rather than output.
+     */
+    uint8_t no_output_of_prior_pics;
+    /** \brief Value of sps_max_num_reorder_pics of the active sequence parameter set. */
+    uint8_t max_num_reorder;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VAHEVCPictureParams;
+
+/**
+ * \brief Creates an HEVC parser.
+ */
+VAStatus vaCreateHEVCParser(VAHEVCParser *parser);
+
+/** \brief Destroys an HEVC parser. */
+VAStatus vaDestroyHEVCParser(VAHEVCParser parser);
+
+/** \brief The NAL unit starts a new picture. */
+#define VA_HEVC_PARSE_PICTURE           0x00000001
+/** \brief The NAL unit is a slice segment of the current picture. */
+#define VA_HEVC_PARSE_SLICE             0x00000002
+/**
+ * \brief The NAL unit is a RASL slice segment that cannot be decoded,
+ * because its associated IRAP picture starts the stream.
+ */
+#define VA_HEVC_PARSE_SKIPPED           0x00000004
+/** \brief The NAL unit is a parameter set. */
+#define VA_HEVC_PARSE_PARAMETER_SET     0x00000008
+
+/**
+ * \brief Parses a NAL unit.
+ *
+ * \c nal points to the NAL unit header, the data is kept escaped (with
+ * its emulation prevention bytes). Parameter sets are cached per ID and
+ * only parsed again when their content changes; the other non-VCL NAL
+ * units apart from end of sequence are ignored.
+ *
+ * For slice segments, \c slice is filled as required by
+ * VASliceParameterBufferHEVC and VASliceParameterBufferHEVCRext, with the
+ * NAL unit assumed to be at \c slice_data_offset in the slice data
+ * buffer. entry_offset_to_subset_array is left to the application.
+ *
+ * @param[out] result   combination of VA_HEVC_PARSE_xxx
+ * @return VA_STATUS_ERROR_INVALID_PARAMETER if the NAL unit is corrupted
+ *         or refers to missing parameter sets
+ */
+VAStatus vaParseHEVCNALUnit(
+    VAHEVCParser parser,
+    const uint8_t *nal,
+    uint32_t size,
+    uint32_t slice_data_offset,
+    uint32_t *result,                               /* out */
+    VASliceParameterBufferHEVCExtension *slice      /* out */
+);
+
+/**
+ * \brief Returns the parameters of the current picture.
+ *
+ * Called after vaParseHEVCNALUnit() returned VA_HEVC_PARSE_PICTURE, and
+ * before the next picture starts. \c surface is the render target of the
+ * picture, the following pictures refer to it. The surfaces that are not
+ * in pic_param.base.ReferenceFrames[] are not used for reference any
+ * more.
+ */
+VAStatus vaGetHEVCPictureParams(
+    VAHEVCParser parser,
+    VASurfaceID surface,
+    VAHEVCPictureParams *params     /* out */
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_PARSE_HEVC_H_ */
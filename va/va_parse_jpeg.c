@@ -0,0 +1,594 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * JPEG marker parser (ITU-T T.81, annex B).
+ *
+ * The headers are short and parsed byte by byte; the time goes into
+ * finding the end of the entropy coded data of the scans. The kernels
+ * look for a 0xFF byte followed by anything but a stuffed zero or a
+ * restart marker, comparing 16 or 32 positions at once from two
+ * overlapping unaligned loads, so the 0xFF00 pairs that occur every few
+ * hundred bytes of entropy coded data do not leave the vector loop.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_parse_jpeg.h"
+#include "va_cpu.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define JPEG_SOF0   0xc0
+#define JPEG_SOF1   0xc1
+#define JPEG_DHT    0xc4
+#define JPEG_SOI    0xd8
+#define JPEG_EOI    0xd9
+#define JPEG_SOS    0xda
+#define JPEG_DQT    0xdb
+#define JPEG_DRI    0xdd
+#define JPEG_APP14  0xee
+#define JPEG_TEM    0x01
+
+#define JPEG_MAX_COMPONENTS 4
+
+struct _VAJPEGParser {
+    /* tables of the previous image */
+    VAIQMatrixBufferJPEGBaseline last_iq_matrix;
+    VAHuffmanTableBufferJPEGBaseline last_huffman_table;
+    uint64_t last_iq_matrix_hash;
+    uint64_t last_huffman_table_hash;
+    int have_last;
+
+    VASliceParameterBufferJPEGBaseline *scans;
+    unsigned int scans_capacity;
+};
+
+/* tables of annex K.3, index 0 for luminance and 1 for chrominance */
+static const uint8_t va_jpeg_default_dc_codes[2][16] = {
+    { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 },
+    { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 }
+};
+
+static const uint8_t va_jpeg_default_ac_codes[2][16] = {
+    { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d },
+    { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 }
+};
+
+static const uint8_t va_jpeg_default_ac_values[2][162] = {
+    {
+        0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06,
+        0x13, 0x51, 0x61, 0x07, 0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08,
+        0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0, 0x24, 0x33, 0x62, 0x72,
+        0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+        0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45,
+        0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+        0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74, 0x75,
+        0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+        0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3,
+        0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6,
+        0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9,
+        0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+        0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4,
+        0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa
+    },
+    {
+        0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41,
+        0x51, 0x07, 0x61, 0x71, 0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91,
+        0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0, 0x15, 0x62, 0x72, 0xd1,
+        0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+        0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44,
+        0x45, 0x46, 0x47, 0x48, 0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58,
+        0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a, 0x73, 0x74,
+        0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+        0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a,
+        0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4,
+        0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7,
+        0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+        0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4,
+        0xf5, 0xf6, 0xf7, 0xf8, 0xf9, 0xfa
+    }
+};
+
+typedef size_t (*va_jpeg_find_func)(const uint8_t *p, size_t n);
+
+/* index of the first marker other than RSTn in p[0..n), n if none */
+static size_t find_marker_c(const uint8_t *p, size_t n)
+{
+    const uint8_t *q = p, *end = p + n;
+
+    while (end - q >= 2 && (q = memchr(q, 0xff, end - q - 1))) {
+        if (q[1] && (q[1] & 0xf8) != 0xd0)
+            return q - p;
+        q++;
+    }
+    return n;
+}
+
+#if defined(VA_CPU_X86)
+VA_TARGET("sse2")
+static size_t find_marker_sse2(const uint8_t *p, size_t n)
+{
+    const __m128i ff = _mm_set1_epi8((char)0xff);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i f8 = _mm_set1_epi8((char)0xf8);
+    const __m128i d0 = _mm_set1_epi8((char)0xd0);
+    size_t i;
+
+    for (i = 0; i + 17 <= n; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(p + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(p + i + 1));
+        __m128i skip = _mm_or_si128(_mm_cmpeq_epi8(b, zero),
+                                    _mm_cmpeq_epi8(_mm_and_si128(b, f8), d0));
+        int mask = _mm_movemask_epi8(_mm_andnot_si128(skip, _mm_cmpeq_epi8(a, ff)));
+
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i + find_marker_c(p + i, n - i);
+}
+
+VA_TARGET("avx2")
+static size_t find_marker_avx2(const uint8_t *p, size_t n)
+{
+    const __m256i ff = _mm256_set1_epi8((char)0xff);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i f8 = _mm256_set1_epi8((char)0xf8);
+    const __m256i d0 = _mm256_set1_epi8((char)0xd0);
+    size_t i;
+
+    for (i = 0; i + 33 <= n; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(p + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(p + i + 1));
+        __m256i skip = _mm256_or_si256(_mm256_cmpeq_epi8(b, zero),
+                                       _mm256_cmpeq_epi8(_mm256_and_si256(b, f8), d0));
+        unsigned int mask = _mm256_movemask_epi8(_mm256_andnot_si256(skip, _mm256_cmpeq_epi8(a, ff)));
+
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return i + find_marker_sse2(p + i, n - i);
+}
+#endif
+
+#if defined(VA_CPU_NEON)
+static size_t find_marker_neon(const uint8_t *p, size_t n)
+{
+    const uint8x16_t ff = vdupq_n_u8(0xff);
+    const uint8x16_t zero = vdupq_n_u8(0);
+    const uint8x16_t f8 = vdupq_n_u8(0xf8);
+    const uint8x16_t d0 = vdupq_n_u8(0xd0);
+    size_t i;
+
+    for (i = 0; i + 17 <= n; i += 16) {
+        uint8x16_t a = vld1q_u8(p + i);
+        uint8x16_t b = vld1q_u8(p + i + 1);
+        uint8x16_t skip = vorrq_u8(vceqq_u8(b, zero), vceqq_u8(vandq_u8(b, f8), d0));
+        uint64x2_t m = vreinterpretq_u64_u8(vbicq_u8(vceqq_u8(a, ff), skip));
+
+        if (vgetq_lane_u64(m, 0) | vgetq_lane_u64(m, 1))
+            return i + find_marker_c(p + i, 17);
+    }
+    return i + find_marker_c(p + i, n - i);
+}
+#endif
+
+static va_jpeg_find_func va_JPEGGetFindFunc(void)
+{
+    unsigned int cpu = va_CpuFeatures();
+
+#if defined(VA_CPU_X86)
+    if (cpu & VA_CPU_FLAG_AVX2)
+        return find_marker_avx2;
+    if (cpu & VA_CPU_FLAG_SSE2)
+        return find_marker_sse2;
+#elif defined(VA_CPU_NEON)
+    if (cpu & VA_CPU_FLAG_NEON)
+        return find_marker_neon;
+#else
+    (void)cpu;
+#endif
+    return find_marker_c;
+}
+
+VAStatus vaCreateJPEGParser(VAJPEGParser *parser)
+{
+    struct _VAJPEGParser *p;
+
+    if (!parser)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    p = calloc(1, sizeof(*p));
+    if (!p)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    *parser = p;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyJPEGParser(VAJPEGParser parser)
+{
+    struct _VAJPEGParser *p = parser;
+
+    if (!p)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    free(p->scans);
+    free(p);
+    return VA_STATUS_SUCCESS;
+}
+
+static inline unsigned int va_JPEGRead16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/* FNV-1a over the 32-bit words of a table buffer */
+static uint64_t va_JPEGHash(const void *data, size_t size)
+{
+    const uint8_t *p = data;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for (i = 0; i + 4 <= size; i += 4) {
+        uint32_t word;
+
+        memcpy(&word, p + i, 4);
+        hash ^= word;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static VAStatus va_JPEGParseSOF(VAPictureParameterBufferJPEGBaseline *pp, const uint8_t *p, unsigned int len)
+{
+    unsigned int i;
+
+    if (len < 6)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (p[0] != 8)
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+    pp->picture_height = va_JPEGRead16(p + 1);
+    pp->picture_width = va_JPEGRead16(p + 3);
+    pp->num_components = p[5];
+    /* a zero height comes with a DNL marker after the first scan */
+    if (!pp->picture_height || pp->num_components > JPEG_MAX_COMPONENTS)
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+    if (!pp->picture_width || !pp->num_components || len != 6 + 3U * pp->num_components)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < pp->num_components; i++) {
+        const uint8_t *c = p + 6 + 3 * i;
+
+        pp->components[i].component_id = c[0];
+        pp->components[i].h_sampling_factor = c[1] >> 4;
+        pp->components[i].v_sampling_factor = c[1] & 0xf;
+        pp->components[i].quantiser_table_selector = c[2];
+        if (pp->components[i].h_sampling_factor < 1 || pp->components[i].h_sampling_factor > 4 ||
+            pp->components[i].v_sampling_factor < 1 || pp->components[i].v_sampling_factor > 4 ||
+            c[2] > 3)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+
+    /* RGB is told by the component identifiers, or by an Adobe segment */
+    if (pp->num_components == 3 && pp->components[0].component_id == 'R' &&
+        pp->components[1].component_id == 'G' && pp->components[2].component_id == 'B')
+        pp->color_space = 1;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus va_JPEGParseDHT(VAHuffmanTableBufferJPEGBaseline *ht, uint8_t defined[2][2],
+                                const uint8_t *p, unsigned int len)
+{
+    while (len) {
+        unsigned int tc, th, i, count = 0;
+
+        if (len < 17)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        tc = p[0] >> 4;
+        th = p[0] & 0xf;
+        if (tc > 1)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        if (th > 1)
+            return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+        for (i = 0; i < 16; i++)
+            count += p[1 + i];
+        if (count > (tc ? 162U : 12U) || len < 17 + count)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+        if (tc) {
+            memcpy(ht->huffman_table[th].num_ac_codes, p + 1, 16);
+            memset(ht->huffman_table[th].ac_values, 0, sizeof(ht->huffman_table[th].ac_values));
+            memcpy(ht->huffman_table[th].ac_values, p + 17, count);
+        } else {
+            memcpy(ht->huffman_table[th].num_dc_codes, p + 1, 16);
+            memset(ht->huffman_table[th].dc_values, 0, sizeof(ht->huffman_table[th].dc_values));
+            memcpy(ht->huffman_table[th].dc_values, p + 17, count);
+        }
+        defined[th][tc] = 1;
+        p += 17 + count;
+        len -= 17 + count;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus va_JPEGParseDQT(VAIQMatrixBufferJPEGBaseline *iq, const uint8_t *p, unsigned int len)
+{
+    while (len) {
+        unsigned int tq;
+
+        if (len < 65)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        /* 16 bit tables only go with 12 bit samples */
+        if (p[0] >> 4)
+            return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+        tq = p[0] & 0xf;
+        if (tq > 3)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        memcpy(iq->quantiser_table[tq], p + 1, 64);
+        iq->load_quantiser_table[tq] = 1;
+        p += 65;
+        len -= 65;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus va_JPEGParseSOS(
+    const VAPictureParameterBufferJPEGBaseline *pp,
+    VASliceParameterBufferJPEGBaseline *sp,
+    uint8_t used[2],
+    const uint8_t *p,
+    unsigned int len
+)
+{
+    unsigned int i, j, h_max = 1, v_max = 1;
+
+    if (len < 1)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    sp->num_components = p[0];
+    if (!sp->num_components || sp->num_components > JPEG_MAX_COMPONENTS ||
+        len != 4 + 2U * sp->num_components)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < pp->num_components; i++) {
+        h_max = pp->components[i].h_sampling_factor > h_max ? pp->components[i].h_sampling_factor : h_max;
+        v_max = pp->components[i].v_sampling_factor > v_max ? pp->components[i].v_sampling_factor : v_max;
+    }
+
+    for (i = 0; i < sp->num_components; i++) {
+        const uint8_t *c = p + 1 + 2 * i;
+
+        sp->components[i].component_selector = c[0];
+        sp->components[i].dc_table_selector = c[1] >> 4;
+        sp->components[i].ac_table_selector = c[1] & 0xf;
+        if (sp->components[i].dc_table_selector > 1 || sp->components[i].ac_table_selector > 1)
+            return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+        used[sp->components[i].dc_table_selector] = 1;
+        used[sp->components[i].ac_table_selector] = 1;
+        for (j = 0; j < pp->num_components; j++) {
+            if (pp->components[j].component_id == c[0])
+                break;
+        }
+        if (j == pp->num_components)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+        /* a non interleaved scan has one data unit per MCU (A.2.2) */
+        if (sp->num_components == 1) {
+            unsigned int w = (pp->picture_width * pp->components[j].h_sampling_factor + h_max - 1) / h_max;
+            unsigned int h = (pp->picture_height * pp->components[j].v_sampling_factor + v_max - 1) / v_max;
+
+            sp->num_mcus = ((w + 7) / 8) * ((h + 7) / 8);
+        }
+    }
+    if (sp->num_components > 1)
+        sp->num_mcus = ((pp->picture_width + 8 * h_max - 1) / (8 * h_max)) *
+                       ((pp->picture_height + 8 * v_max - 1) / (8 * v_max));
+
+    sp->slice_data_flag = VA_SLICE_DATA_FLAG_ALL;
+    return VA_STATUS_SUCCESS;
+}
+
+/* completes the tables with the annex K ones and tells whether they changed */
+static uint32_t va_JPEGFinishTables(struct _VAJPEGParser *p, VAJPEGPictureParams *params,
+                                    uint8_t defined[2][2], const uint8_t used[2])
+{
+    VAHuffmanTableBufferJPEGBaseline *ht = &params->huffman_table;
+    uint32_t result = 0;
+    unsigned int i;
+
+    for (i = 0; i < 2; i++) {
+        if (!used[i] && !defined[i][0] && !defined[i][1])
+            continue;
+        if (!defined[i][0]) {
+            memcpy(ht->huffman_table[i].num_dc_codes, va_jpeg_default_dc_codes[i], 16);
+            for (unsigned int j = 0; j < 12; j++)
+                ht->huffman_table[i].dc_values[j] = j;
+        }
+        if (!defined[i][1]) {
+            memcpy(ht->huffman_table[i].num_ac_codes, va_jpeg_default_ac_codes[i], 16);
+            memcpy(ht->huffman_table[i].ac_values, va_jpeg_default_ac_values[i], 162);
+        }
+        ht->load_huffman_table[i] = 1;
+    }
+
+    params->iq_matrix_hash = va_JPEGHash(&params->iq_matrix, sizeof(params->iq_matrix));
+    params->huffman_table_hash = va_JPEGHash(ht, sizeof(*ht));
+    if (!p->have_last || params->iq_matrix_hash != p->last_iq_matrix_hash ||
+        memcmp(&params->iq_matrix, &p->last_iq_matrix, sizeof(params->iq_matrix))) {
+        p->last_iq_matrix = params->iq_matrix;
+        p->last_iq_matrix_hash = params->iq_matrix_hash;
+        result |= VA_JPEG_PARSE_IQ_MATRIX_CHANGED;
+    }
+    if (!p->have_last || params->huffman_table_hash != p->last_huffman_table_hash ||
+        memcmp(ht, &p->last_huffman_table, sizeof(*ht))) {
+        p->last_huffman_table = *ht;
+        p->last_huffman_table_hash = params->huffman_table_hash;
+        result |= VA_JPEG_PARSE_HUFFMAN_TABLE_CHANGED;
+    }
+    p->have_last = 1;
+    return result;
+}
+
+VAStatus vaParseJPEGImage(
+    VAJPEGParser parser,
+    const uint8_t *data,
+    uint32_t size,
+    uint32_t slice_data_offset,
+    uint32_t *image_size,
+    uint32_t *result,
+    VAJPEGPictureParams *params,
+    const VASliceParameterBufferJPEGBaseline **scans,
+    uint32_t *num_scans
+)
+{
+    struct _VAJPEGParser *p = parser;
+    VAPictureParameterBufferJPEGBaseline *pp;
+    uint8_t huffman_defined[2][2] = { { 0 } }, huffman_used[2] = { 0 };
+    unsigned int n = 0, restart_interval = 0, i;
+    int have_sof = 0, adobe_transform = -1;
+    va_jpeg_find_func find = va_JPEGGetFindFunc();
+    uint32_t pos = 2;
+    VAStatus status;
+
+    if (!p || !data || !image_size || !result || !params || !scans || !num_scans)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    *image_size = 0;
+    *result = 0;
+    *scans = NULL;
+    *num_scans = 0;
+
+    if (size < 2 || data[0] != 0xff || data[1] != JPEG_SOI)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    memset(params, 0, sizeof(*params));
+    pp = &params->pic_param;
+
+    for (;;) {
+        unsigned int marker, len;
+        const uint8_t *q;
+
+        /* skip the fill bytes, and any garbage before the next marker */
+        while (pos < size && data[pos] != 0xff)
+            pos++;
+        while (pos < size && data[pos] == 0xff)
+            pos++;
+        if (pos >= size)
+            break;
+        marker = data[pos++];
+        if (marker == JPEG_EOI)
+            break;
+        if (marker == JPEG_TEM || (marker & 0xf8) == 0xd0)
+            continue;
+
+        if (size - pos < 2 || va_JPEGRead16(data + pos) < 2 || va_JPEGRead16(data + pos) > size - pos)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        len = va_JPEGRead16(data + pos) - 2;
+        q = data + pos + 2;
+        pos += 2 + len;
+
+        switch (marker) {
+        case JPEG_SOF0:
+        case JPEG_SOF1:
+            if (have_sof)
+                return VA_STATUS_ERROR_INVALID_PARAMETER;
+            status = va_JPEGParseSOF(pp, q, len);
+            if (status != VA_STATUS_SUCCESS)
+                return status;
+            have_sof = 1;
+            break;
+        case 0xc2: case 0xc3: case 0xc5: case 0xc6: case 0xc7:
+        case 0xc9: case 0xca: case 0xcb: case 0xcd: case 0xce: case 0xcf:
+            /* progressive, lossless, hierarchical and arithmetic coding */
+            return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+        case JPEG_DHT:
+            status = va_JPEGParseDHT(&params->huffman_table, huffman_defined, q, len);
+            if (status != VA_STATUS_SUCCESS)
+                return status;
+            break;
+        case JPEG_DQT:
+            status = va_JPEGParseDQT(&params->iq_matrix, q, len);
+            if (status != VA_STATUS_SUCCESS)
+                return status;
+            break;
+        case JPEG_DRI:
+            if (len != 2)
+                return VA_STATUS_ERROR_INVALID_PARAMETER;
+            restart_interval = va_JPEGRead16(q);
+            break;
+        case JPEG_APP14:
+            if (len >= 12 && !memcmp(q, "Adobe", 5))
+                adobe_transform = q[11];
+            break;
+        case JPEG_SOS: {
+            VASliceParameterBufferJPEGBaseline *sp;
+            size_t scan_size;
+
+            if (!have_sof)
+                return VA_STATUS_ERROR_INVALID_PARAMETER;
+            if (n == p->scans_capacity) {
+                unsigned int capacity = p->scans_capacity ? 2 * p->scans_capacity : 4;
+                VASliceParameterBufferJPEGBaseline *s = realloc(p->scans, capacity * sizeof(*s));
+
+                if (!s)
+                    return VA_STATUS_ERROR_ALLOCATION_FAILED;
+                p->scans = s;
+                p->scans_capacity = capacity;
+            }
+            sp = &p->scans[n];
+            memset(sp, 0, sizeof(*sp));
+            status = va_JPEGParseSOS(pp, sp, huffman_used, q, len);
+            if (status != VA_STATUS_SUCCESS)
+                return status;
+            sp->restart_interval = restart_interval;
+
+            /* the entropy coded data runs up to the next marker, or to the end of a truncated image */
+            scan_size = find(data + pos, size - pos);
+            sp->slice_data_offset = slice_data_offset + pos;
+            sp->slice_data_size = scan_size;
+            pos += scan_size;
+            n++;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    if (!n)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    for (i = 0; i < pp->num_components; i++) {
+        if (!params->iq_matrix.load_quantiser_table[pp->components[i].quantiser_table_selector])
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+    if (pp->num_components == 3 && adobe_transform == 0)
+        pp->color_space = 1;
+
+    *result = va_JPEGFinishTables(p, params, huffman_defined, huffman_used);
+    *image_size = pos;
+    *scans = p->scans;
+    *num_scans = n;
+    return VA_STATUS_SUCCESS;
+}
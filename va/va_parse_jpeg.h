@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_parse_jpeg.h
+ * \brief JPEG bitstream parser for decode
+ *
+ * Parses the markers of a baseline JPEG image and fills the VA decode
+ * parameter structures of va_dec_jpeg.h with them, so that simple clients
+ * can drive VAProfileJPEGBaseline without a parsing framework.
+ *
+ * The end of the entropy coded data of each scan is found with a vector
+ * scan for markers, which steps over the stuffed 0xFF00 bytes and the
+ * restart markers without leaving the vector loop. Images without
+ * Huffman tables, as Motion-JPEG frames usually are, get the tables of
+ * annex K of the JPEG specification.
+ *
+ * Cameras and thumbnail pipelines usually reuse the same quantization and
+ * Huffman tables for all their images. The table buffers returned by the
+ * parser come with a hash of their content, and the parser tells whether
+ * they differ from the ones of the previous image, so that the VA buffers
+ * created for them once can be rendered again instead of being created
+ * and filled for every image.
+ *
+ * Usage:
+ * - pass each image to vaParseJPEGImage(), with its offset in the slice
+ *   data buffer;
+ * - render the picture parameters, the table buffers (new ones only when
+ *   VA_JPEG_PARSE_IQ_MATRIX_CHANGED or VA_JPEG_PARSE_HUFFMAN_TABLE_CHANGED
+ *   is set, or when the hash is not known yet), then for each scan its
+ *   slice parameters and the slice data.
+ */
+
+#ifndef _VA_PARSE_JPEG_H_
+#define _VA_PARSE_JPEG_H_
+
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_parse_jpeg JPEG parser
+ *
+ * @{
+ */
+
+/** \brief Opaque JPEG parser state. */
+typedef struct _VAJPEGParser *VAJPEGParser;
+
+/** \brief Parameters of an image. */
+typedef struct _VAJPEGPictureParams {
+    /** \brief Picture parameters. */
+    VAPictureParameterBufferJPEGBaseline pic_param;
+    /** \brief Quantization tables, all the ones defined by the image are loaded. */
+    VAIQMatrixBufferJPEGBaseline iq_matrix;
+    /** \brief Huffman tables, all the ones defined by the image are loaded. */
+    VAHuffmanTableBufferJPEGBaseline huffman_table;
+    /**
+     * \brief Hash of the content of \c iq_matrix. Images with the same
+     * hash can share one VAIQMatrixBufferType buffer.
+     */
+    uint64_t iq_matrix_hash;
+    /**
+     * \brief Hash of the content of \c huffman_table. Images with the same
+     * hash can share one VAHuffmanTableBufferType buffer.
+     */
+    uint64_t huffman_table_hash;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VAJPEGPictureParams;
+
+/** \brief Creates a JPEG parser. */
+VAStatus vaCreateJPEGParser(VAJPEGParser *parser);
+
+/** \brief Destroys a JPEG parser. */
+VAStatus vaDestroyJPEGParser(VAJPEGParser parser);
+
+/** \brief The quantization tables differ from those of the previous image. */
+#define VA_JPEG_PARSE_IQ_MATRIX_CHANGED         0x00000001
+/** \brief The Huffman tables differ from those of the previous image. */
+#define VA_JPEG_PARSE_HUFFMAN_TABLE_CHANGED     0x00000002
+
+/**
+ * \brief Parses an image.
+ *
+ * \c data points to the SOI marker and \c size is the number of bytes
+ * available from there; the size of the image, up to and including the
+ * EOI marker, is returned in \c image_size, so that concatenated images
+ * can be walked through. The image is assumed to be at
+ * \c slice_data_offset in the slice data buffer, and the returned scans
+ * point into it. The scan array belongs to the parser and stays valid
+ * until the next call.
+ *
+ * Baseline and extended sequential Huffman coded images with 8 bit
+ * samples and up to four components are supported.
+ *
+ * @param[out] image_size   size of the image
+ * @param[out] result       combination of VA_JPEG_PARSE_xxx
+ * @param[out] params       parameters of the image
+ * @param[out] scans        slice parameters of each scan
+ * @param[out] num_scans    number of scans
+ * @return VA_STATUS_ERROR_INVALID_PARAMETER if the image is corrupted,
+ *         VA_STATUS_ERROR_UNSUPPORTED_PROFILE for the progressive,
+ *         lossless, arithmetic coded and 12 bit processes
+ */
+VAStatus vaParseJPEGImage(
+    VAJPEGParser parser,
+    const uint8_t *data,
+    uint32_t size,
+    uint32_t slice_data_offset,
+    uint32_t *image_size,                                   /* out */
+    uint32_t *result,                                       /* out */
+    VAJPEGPictureParams *params,                            /* out */
+    const VASliceParameterBufferJPEGBaseline **scans,       /* out */
+    uint32_t *num_scans                                     /* out */
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_PARSE_JPEG_H_ */
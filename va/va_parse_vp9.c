@@ -0,0 +1,808 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * VP9 superframe index and uncompressed header parser (VP9 bitstream and
+ * decoding process specification, sections 6.2 and 7.2, annex B).
+ *
+ * The uncompressed header is parsed straight into the VA picture
+ * parameters. The loop filter deltas and the segmentation features carry
+ * over from frame to frame until a frame resets them, and the reference
+ * slots only keep what the following headers need: the surface, the
+ * frame size and the format. As for AV1, the refresh of the slots is
+ * deferred until the next frame, so that the surface of the frame may be
+ * given after the header was parsed.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_parse_vp9.h"
+#include "va_bitreader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define VP9_FRAME_MARKER            2
+#define VP9_SYNC_CODE               0x498342
+#define VP9_KEY_FRAME               0
+#define VP9_CS_RGB                  7
+#define VP9_NUM_REF_FRAMES          8
+#define VP9_REFS_PER_FRAME          3
+#define VP9_MAX_SEGMENTS            8
+#define VP9_SEG_LVL_MAX             4
+#define VP9_SEG_LVL_ALT_Q           0
+#define VP9_SEG_LVL_ALT_L           1
+#define VP9_SEG_LVL_REF_FRAME       2
+#define VP9_SEG_LVL_SKIP            3
+#define VP9_MAX_LOOP_FILTER         63
+#define VP9_MIN_TILE_WIDTH_B64      4
+#define VP9_MAX_TILE_WIDTH_B64      64
+#define VP9_SWITCHABLE              4
+
+#define VP9_CLIP3(lo, hi, x) ((x) < (lo) ? (lo) : (x) > (hi) ? (hi) : (x))
+
+/* the state of a frame that later frames refer to */
+typedef struct va_vp9_ref {
+    VASurfaceID surface;
+    uint8_t valid;
+    uint8_t bit_depth;
+    uint8_t subsampling_x;
+    uint8_t subsampling_y;
+    uint32_t width;
+    uint32_t height;
+} va_vp9_ref;
+
+struct _VAVP9Parser {
+    va_vp9_ref ref[VP9_NUM_REF_FRAMES];
+
+    /* color config of the last key or intra-only frame */
+    uint8_t bit_depth;
+    uint8_t subsampling_x;
+    uint8_t subsampling_y;
+
+    /* state carried over from frame to frame */
+    int8_t loop_filter_ref_deltas[4];
+    int8_t loop_filter_mode_deltas[2];
+    uint8_t segmentation_abs_or_delta_update;
+    uint8_t feature_enabled[VP9_MAX_SEGMENTS][VP9_SEG_LVL_MAX];
+    int16_t feature_data[VP9_MAX_SEGMENTS][VP9_SEG_LVL_MAX];
+    uint8_t tree_probs[7];
+    uint8_t pred_probs[3];
+
+    /* current frame */
+    VAVP9PictureParams pic;
+    va_vp9_ref cur;
+    uint8_t refresh_frame_flags;
+    /* the frame is parsed, ref[] is updated with the next frame */
+    int refresh_pending;
+};
+
+static const uint8_t va_vp9_seg_feature_bits[VP9_SEG_LVL_MAX] = { 8, 6, 2, 0 };
+static const uint8_t va_vp9_seg_feature_signed[VP9_SEG_LVL_MAX] = { 1, 1, 0, 0 };
+
+/* interp_filter of raw_interpolation_filter, as VA has it */
+static const uint8_t va_vp9_literal_to_type[4] = { 1, 0, 2, 3 };
+
+static const int16_t va_vp9_dc_qlookup[3][256] = {
+    {
+        4, 8, 8, 9, 10, 11, 12, 12, 13, 14, 15, 16,
+        17, 18, 19, 19, 20, 21, 22, 23, 24, 25, 26, 26,
+        27, 28, 29, 30, 31, 32, 32, 33, 34, 35, 36, 37,
+        38, 38, 39, 40, 41, 42, 43, 43, 44, 45, 46, 47,
+        48, 48, 49, 50, 51, 52, 53, 53, 54, 55, 56, 57,
+        57, 58, 59, 60, 61, 62, 62, 63, 64, 65, 66, 66,
+        67, 68, 69, 70, 70, 71, 72, 73, 74, 74, 75, 76,
+        77, 78, 78, 79, 80, 81, 81, 82, 83, 84, 85, 85,
+        87, 88, 90, 92, 93, 95, 96, 98, 99, 101, 102, 104,
+        105, 107, 108, 110, 111, 113, 114, 116, 117, 118, 120, 121,
+        123, 125, 127, 129, 131, 134, 136, 138, 140, 142, 144, 146,
+        148, 150, 152, 154, 156, 158, 161, 164, 166, 169, 172, 174,
+        177, 180, 182, 185, 187, 190, 192, 195, 199, 202, 205, 208,
+        211, 214, 217, 220, 223, 226, 230, 233, 237, 240, 243, 247,
+        250, 253, 257, 261, 265, 269, 272, 276, 280, 284, 288, 292,
+        296, 300, 304, 309, 313, 317, 322, 326, 330, 335, 340, 344,
+        349, 354, 359, 364, 369, 374, 379, 384, 389, 395, 400, 406,
+        411, 417, 423, 429, 435, 441, 447, 454, 461, 467, 475, 482,
+        489, 497, 505, 513, 522, 530, 539, 549, 559, 569, 579, 590,
+        602, 614, 626, 640, 654, 668, 684, 700, 717, 736, 755, 775,
+        796, 819, 843, 869, 896, 925, 955, 988, 1022, 1058, 1098, 1139,
+        1184, 1232, 1282, 1336
+    },
+    {
+        4, 9, 10, 13, 15, 17, 20, 22, 25, 28, 31, 34,
+        37, 40, 43, 47, 50, 53, 57, 60, 64, 68, 71, 75,
+        78, 82, 86, 90, 93, 97, 101, 105, 109, 113, 116, 120,
+        124, 128, 132, 136, 140, 143, 147, 151, 155, 159, 163, 166,
+        170, 174, 178, 182, 185, 189, 193, 197, 200, 204, 208, 212,
+        215, 219, 223, 226, 230, 233, 237, 241, 244, 248, 251, 255,
+        259, 262, 266, 269, 273, 276, 280, 283, 287, 290, 293, 297,
+        300, 304, 307, 310, 314, 317, 321, 324, 327, 331, 334, 337,
+        343, 350, 356, 362, 369, 375, 381, 387, 394, 400, 406, 412,
+        418, 424, 430, 436, 442, 448, 454, 460, 466, 472, 478, 484,
+        490, 499, 507, 516, 525, 533, 542, 550, 559, 567, 576, 584,
+        592, 601, 609, 617, 625, 634, 644, 655, 666, 676, 687, 698,
+        708, 718, 729, 739, 749, 759, 770, 782, 795, 807, 819, 831,
+        844, 856, 868, 880, 891, 906, 920, 933, 947, 961, 975, 988,
+        1001, 1015, 1030, 1045, 1061, 1076, 1090, 1105, 1120, 1137, 1153, 1170,
+        1186, 1202, 1218, 1236, 1253, 1271, 1288, 1306, 1323, 1342, 1361, 1379,
+        1398, 1416, 1436, 1456, 1476, 1496, 1516, 1537, 1559, 1580, 1601, 1624,
+        1647, 1670, 1692, 1717, 1741, 1766, 1791, 1817, 1844, 1871, 1900, 1929,
+        1958, 1990, 2021, 2054, 2088, 2123, 2159, 2197, 2236, 2276, 2319, 2363,
+        2410, 2458, 2508, 2561, 2616, 2675, 2737, 2802, 2871, 2944, 3020, 3102,
+        3188, 3280, 3375, 3478, 3586, 3702, 3823, 3953, 4089, 4236, 4394, 4559,
+        4737, 4929, 5130, 5347
+    },
+    {
+        4, 12, 18, 25, 33, 41, 50, 60, 70, 80, 91, 103,
+        115, 127, 140, 153, 166, 180, 194, 208, 222, 237, 251, 266,
+        281, 296, 312, 327, 343, 358, 374, 390, 405, 421, 437, 453,
+        469, 484, 500, 516, 532, 548, 564, 580, 596, 611, 627, 643,
+        659, 674, 690, 706, 721, 737, 752, 768, 783, 798, 814, 829,
+        844, 859, 874, 889, 904, 919, 934, 949, 964, 978, 993, 1008,
+        1022, 1037, 1051, 1065, 1080, 1094, 1108, 1122, 1136, 1151, 1165, 1179,
+        1192, 1206, 1220, 1234, 1248, 1261, 1275, 1288, 1302, 1315, 1329, 1342,
+        1368, 1393, 1419, 1444, 1469, 1494, 1519, 1544, 1569, 1594, 1618, 1643,
+        1668, 1692, 1717, 1741, 1765, 1789, 1814, 1838, 1862, 1885, 1909, 1933,
+        1957, 1992, 2027, 2061, 2096, 2130, 2165, 2199, 2233, 2267, 2300, 2334,
+        2367, 2400, 2434, 2467, 2499, 2532, 2575, 2618, 2661, 2704, 2746, 2788,
+        2830, 2872, 2913, 2954, 2995, 3036, 3076, 3127, 3177, 3226, 3275, 3324,
+        3373, 3421, 3469, 3517, 3565, 3621, 3677, 3733, 3788, 3843, 3897, 3951,
+        4005, 4058, 4119, 4181, 4241, 4301, 4361, 4420, 4479, 4546, 4612, 4677,
+        4742, 4807, 4871, 4942, 5013, 5083, 5153, 5222, 5291, 5367, 5442, 5517,
+        5591, 5665, 5745, 5825, 5905, 5984, 6063, 6149, 6234, 6319, 6404, 6495,
+        6587, 6678, 6769, 6867, 6966, 7064, 7163, 7269, 7376, 7483, 7599, 7715,
+        7832, 7958, 8085, 8214, 8352, 8492, 8635, 8788, 8945, 9104, 9275, 9450,
+        9639, 9832, 10031, 10245, 10465, 10702, 10946, 11210, 11482, 11776, 12081, 12409,
+        12750, 13118, 13501, 13913, 14343, 14807, 15290, 15812, 16356, 16943, 17575, 18237,
+        18949, 19718, 20521, 21387
+    }
+};
+
+static const int16_t va_vp9_ac_qlookup[3][256] = {
+    {
+        4, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+        19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30,
+        31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42,
+        43, 44, 45, 46, 47, 48, 49, 50, 51, 52, 53, 54,
+        55, 56, 57, 58, 59, 60, 61, 62, 63, 64, 65, 66,
+        67, 68, 69, 70, 71, 72, 73, 74, 75, 76, 77, 78,
+        79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90,
+        91, 92, 93, 94, 95, 96, 97, 98, 99, 100, 101, 102,
+        104, 106, 108, 110, 112, 114, 116, 118, 120, 122, 124, 126,
+        128, 130, 132, 134, 136, 138, 140, 142, 144, 146, 148, 150,
+        152, 155, 158, 161, 164, 167, 170, 173, 176, 179, 182, 185,
+        188, 191, 194, 197, 200, 203, 207, 211, 215, 219, 223, 227,
+        231, 235, 239, 243, 247, 251, 255, 260, 265, 270, 275, 280,
+        285, 290, 295, 300, 305, 311, 317, 323, 329, 335, 341, 347,
+        353, 359, 366, 373, 380, 387, 394, 401, 408, 416, 424, 432,
+        440, 448, 456, 465, 474, 483, 492, 501, 510, 520, 530, 540,
+        550, 560, 571, 582, 593, 604, 615, 627, 639, 651, 663, 676,
+        689, 702, 715, 729, 743, 757, 771, 786, 801, 816, 832, 848,
+        864, 881, 898, 915, 933, 951, 969, 988, 1007, 1026, 1046, 1066,
+        1087, 1108, 1129, 1151, 1173, 1196, 1219, 1243, 1267, 1292, 1317, 1343,
+        1369, 1396, 1423, 1451, 1479, 1508, 1537, 1567, 1597, 1628, 1660, 1692,
+        1725, 1759, 1793, 1828
+    },
+    {
+        4, 9, 11, 13, 16, 18, 21, 24, 27, 30, 33, 37,
+        40, 44, 48, 51, 55, 59, 63, 67, 71, 75, 79, 83,
+        88, 92, 96, 100, 105, 109, 114, 118, 122, 127, 131, 136,
+        140, 145, 149, 154, 158, 163, 168, 172, 177, 181, 186, 190,
+        195, 199, 204, 208, 213, 217, 222, 226, 231, 235, 240, 244,
+        249, 253, 258, 262, 267, 271, 275, 280, 284, 289, 293, 297,
+        302, 306, 311, 315, 319, 324, 328, 332, 337, 341, 345, 349,
+        354, 358, 362, 367, 371, 375, 379, 384, 388, 392, 396, 401,
+        409, 417, 425, 433, 441, 449, 458, 466, 474, 482, 490, 498,
+        506, 514, 523, 531, 539, 547, 555, 563, 571, 579, 588, 596,
+        604, 616, 628, 640, 652, 664, 676, 688, 700, 713, 725, 737,
+        749, 761, 773, 785, 797, 809, 825, 841, 857, 873, 889, 905,
+        922, 938, 954, 970, 986, 1002, 1018, 1038, 1058, 1078, 1098, 1118,
+        1138, 1158, 1178, 1198, 1218, 1242, 1266, 1290, 1314, 1338, 1362, 1386,
+        1411, 1435, 1463, 1491, 1519, 1547, 1575, 1603, 1631, 1663, 1695, 1727,
+        1759, 1791, 1823, 1859, 1895, 1931, 1967, 2003, 2039, 2079, 2119, 2159,
+        2199, 2239, 2283, 2327, 2371, 2415, 2459, 2507, 2555, 2603, 2651, 2703,
+        2755, 2807, 2859, 2915, 2971, 3027, 3083, 3143, 3203, 3263, 3327, 3391,
+        3455, 3523, 3591, 3659, 3731, 3803, 3876, 3952, 4028, 4104, 4184, 4264,
+        4348, 4432, 4516, 4604, 4692, 4784, 4876, 4972, 5068, 5168, 5268, 5372,
+        5476, 5584, 5692, 5804, 5916, 6032, 6148, 6268, 6388, 6512, 6640, 6768,
+        6900, 7036, 7172, 7312
+    },
+    {
+        4, 13, 19, 27, 35, 44, 54, 64, 75, 87, 99, 112,
+        126, 139, 154, 168, 183, 199, 214, 230, 247, 263, 280, 297,
+        314, 331, 349, 366, 384, 402, 420, 438, 456, 475, 493, 511,
+        530, 548, 567, 586, 604, 623, 642, 660, 679, 698, 716, 735,
+        753, 772, 791, 809, 828, 846, 865, 884, 902, 920, 939, 957,
+        976, 994, 1012, 1030, 1049, 1067, 1085, 1103, 1121, 1139, 1157, 1175,
+        1193, 1211, 1229, 1246, 1264, 1282, 1299, 1317, 1335, 1352, 1370, 1387,
+        1405, 1422, 1440, 1457, 1474, 1491, 1509, 1526, 1543, 1560, 1577, 1595,
+        1627, 1660, 1693, 1725, 1758, 1791, 1824, 1856, 1889, 1922, 1954, 1987,
+        2020, 2052, 2085, 2118, 2150, 2183, 2216, 2248, 2281, 2313, 2346, 2378,
+        2411, 2459, 2508, 2556, 2605, 2653, 2701, 2750, 2798, 2847, 2895, 2943,
+        2992, 3040, 3088, 3137, 3185, 3234, 3298, 3362, 3426, 3491, 3555, 3619,
+        3684, 3748, 3812, 3876, 3941, 4005, 4069, 4149, 4230, 4310, 4390, 4470,
+        4550, 4631, 4711, 4791, 4871, 4967, 5064, 5160, 5256, 5352, 5448, 5544,
+        5641, 5737, 5849, 5961, 6073, 6185, 6297, 6410, 6522, 6650, 6778, 6906,
+        7034, 7162, 7290, 7435, 7579, 7723, 7867, 8011, 8155, 8315, 8475, 8635,
+        8795, 8956, 9132, 9308, 9484, 9660, 9836, 10028, 10220, 10412, 10604, 10812,
+        11020, 11228, 11437, 11661, 11885, 12109, 12333, 12573, 12813, 13053, 13309, 13565,
+        13821, 14093, 14365, 14637, 14925, 15213, 15502, 15806, 16110, 16414, 16734, 17054,
+        17390, 17726, 18062, 18414, 18766, 19134, 19502, 19886, 20270, 20670, 21070, 21486,
+        21902, 22334, 22766, 23214, 23662, 24126, 24590, 25070, 25551, 26047, 26559, 27071,
+        27599, 28143, 28687, 29247
+    }
+};
+VAStatus vaSplitVP9Superframe(
+    const uint8_t *data,
+    uint32_t size,
+    uint32_t frame_offsets[VA_VP9_MAX_SUPERFRAME_FRAMES],
+    uint32_t frame_sizes[VA_VP9_MAX_SUPERFRAME_FRAMES],
+    uint32_t *num_frames
+)
+{
+    unsigned int marker, frames, mag, index_size, i, j;
+    uint32_t offset = 0;
+    const uint8_t *index;
+
+    if (!data || !size || !frame_offsets || !frame_sizes || !num_frames)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    /* superframe_index(): the marker byte ends and starts the index */
+    marker = data[size - 1];
+    frames = (marker & 0x7) + 1;
+    mag = ((marker >> 3) & 0x3) + 1;
+    index_size = 2 + mag * frames;
+    if ((marker & 0xe0) != 0xc0 || size < index_size || data[size - index_size] != marker) {
+        frame_offsets[0] = 0;
+        frame_sizes[0] = size;
+        *num_frames = 1;
+        return VA_STATUS_SUCCESS;
+    }
+
+    index = data + size - index_size + 1;
+    for (i = 0; i < frames; i++) {
+        uint32_t frame_size = 0;
+
+        for (j = 0; j < mag; j++)
+            frame_size |= (uint32_t) * index++ << (j * 8);
+        if (frame_size > size - index_size - offset)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        frame_offsets[i] = offset;
+        frame_sizes[i] = frame_size;
+        offset += frame_size;
+    }
+    *num_frames = frames;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaCreateVP9Parser(VAVP9Parser *parser)
+{
+    struct _VAVP9Parser *p;
+    unsigned int i;
+
+    if (!parser)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    p = calloc(1, sizeof(*p));
+    if (!p)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    for (i = 0; i < VP9_NUM_REF_FRAMES; i++)
+        p->ref[i].surface = VA_INVALID_SURFACE;
+    p->cur.surface = VA_INVALID_SURFACE;
+
+    *parser = p;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroyVP9Parser(VAVP9Parser parser)
+{
+    if (!parser)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    free(parser);
+    return VA_STATUS_SUCCESS;
+}
+
+/* su(n) of the VP9 specification: magnitude then sign */
+static int va_VP9ReadSU(va_bitreader *br, unsigned int n)
+{
+    int value = va_BitReaderRead(br, n);
+
+    return va_BitReaderReadBit(br) ? -value : value;
+}
+
+static uint8_t va_VP9ReadProb(va_bitreader *br)
+{
+    return va_BitReaderReadBit(br) ? va_BitReaderRead(br, 8) : 255;
+}
+
+/* the reference update process of a decoded frame */
+static void va_VP9RefreshFrames(struct _VAVP9Parser *p)
+{
+    unsigned int i;
+
+    for (i = 0; i < VP9_NUM_REF_FRAMES; i++) {
+        if (p->refresh_frame_flags & (1 << i))
+            p->ref[i] = p->cur;
+    }
+    p->refresh_pending = 0;
+}
+
+static int va_VP9ParseColorConfig(struct _VAVP9Parser *p, va_bitreader *br, unsigned int profile)
+{
+    unsigned int color_space;
+
+    p->bit_depth = 8;
+    if (profile >= 2)
+        p->bit_depth = va_BitReaderReadBit(br) ? 12 : 10;
+    color_space = va_BitReaderRead(br, 3);
+    if (color_space != VP9_CS_RGB) {
+        va_BitReaderReadBit(br);                    /* color_range */
+        p->subsampling_x = p->subsampling_y = 1;
+        if (profile == 1 || profile == 3) {
+            p->subsampling_x = va_BitReaderReadBit(br);
+            p->subsampling_y = va_BitReaderReadBit(br);
+            if (va_BitReaderReadBit(br))            /* reserved_zero */
+                return 0;
+        }
+    } else {
+        /* 4:4:4 only, which profiles 0 and 2 cannot carry */
+        if (profile != 1 && profile != 3)
+            return 0;
+        p->subsampling_x = p->subsampling_y = 0;
+        if (va_BitReaderReadBit(br))                /* reserved_zero */
+            return 0;
+    }
+    return 1;
+}
+
+/* frame_size() and render_size() */
+static void va_VP9FrameSize(struct _VAVP9Parser *p, va_bitreader *br, int read_size)
+{
+    if (read_size) {
+        p->cur.width = va_BitReaderRead(br, 16) + 1;
+        p->cur.height = va_BitReaderRead(br, 16) + 1;
+    }
+    if (va_BitReaderReadBit(br))                    /* render_and_frame_size_different */
+        va_BitReaderSkip(br, 32);                   /* render_width/height_minus_1 */
+}
+
+/* returns loop_filter_delta_enabled */
+static int va_VP9ParseLoopFilter(struct _VAVP9Parser *p, va_bitreader *br)
+{
+    VADecPictureParameterBufferVP9 *pp = &p->pic.pic_param;
+    unsigned int i;
+    int delta_enabled;
+
+    pp->filter_level = va_BitReaderRead(br, 6);
+    pp->sharpness_level = va_BitReaderRead(br, 3);
+    delta_enabled = va_BitReaderReadBit(br);
+    /* loop_filter_delta_update */
+    if (delta_enabled && va_BitReaderReadBit(br)) {
+        for (i = 0; i < 4; i++) {
+            if (va_BitReaderReadBit(br))
+                p->loop_filter_ref_deltas[i] = va_VP9ReadSU(br, 6);
+        }
+        for (i = 0; i < 2; i++) {
+            if (va_BitReaderReadBit(br))
+                p->loop_filter_mode_deltas[i] = va_VP9ReadSU(br, 6);
+        }
+    }
+    return delta_enabled;
+}
+
+static void va_VP9ParseSegmentation(struct _VAVP9Parser *p, va_bitreader *br)
+{
+    VADecPictureParameterBufferVP9 *pp = &p->pic.pic_param;
+    unsigned int i, j;
+
+    pp->pic_fields.bits.segmentation_enabled = va_BitReaderReadBit(br);
+    if (!pp->pic_fields.bits.segmentation_enabled)
+        return;
+
+    pp->pic_fields.bits.segmentation_update_map = va_BitReaderReadBit(br);
+    if (pp->pic_fields.bits.segmentation_update_map) {
+        for (i = 0; i < 7; i++)
+            p->tree_probs[i] = va_VP9ReadProb(br);
+        pp->pic_fields.bits.segmentation_temporal_update = va_BitReaderReadBit(br);
+        for (i = 0; i < 3; i++)
+            p->pred_probs[i] = pp->pic_fields.bits.segmentation_temporal_update ?
+                               va_VP9ReadProb(br) : 255;
+    }
+
+    /* segmentation_update_data */
+    if (va_BitReaderReadBit(br)) {
+        p->segmentation_abs_or_delta_update = va_BitReaderReadBit(br);
+        for (i = 0; i < VP9_MAX_SEGMENTS; i++) {
+            for (j = 0; j < VP9_SEG_LVL_MAX; j++) {
+                int value = 0;
+
+                p->feature_enabled[i][j] = va_BitReaderReadBit(br);
+                if (p->feature_enabled[i][j]) {
+                    value = va_BitReaderRead(br, va_vp9_seg_feature_bits[j]);
+                    if (va_vp9_seg_feature_signed[j] && va_BitReaderReadBit(br))
+                        value = -value;
+                }
+                p->feature_data[i][j] = value;
+            }
+        }
+    }
+}
+
+static int va_VP9ParseTileInfo(struct _VAVP9Parser *p, va_bitreader *br)
+{
+    VADecPictureParameterBufferVP9 *pp = &p->pic.pic_param;
+    unsigned int sb64_cols = (((p->cur.width + 7) >> 3) + 7) >> 3;
+    unsigned int min_log2 = 0, max_log2 = 1;
+
+    while ((VP9_MAX_TILE_WIDTH_B64 << min_log2) < (int)sb64_cols)
+        min_log2++;
+    while ((sb64_cols >> max_log2) >= VP9_MIN_TILE_WIDTH_B64)
+        max_log2++;
+    max_log2--;
+
+    pp->log2_tile_columns = min_log2;
+    while (pp->log2_tile_columns < max_log2 && va_BitReaderReadBit(br))
+        pp->log2_tile_columns++;
+    pp->log2_tile_rows = va_BitReaderReadBit(br);
+    if (pp->log2_tile_rows)
+        pp->log2_tile_rows += va_BitReaderReadBit(br);
+
+    return !br->overrun;
+}
+
+/* setup_past_independence(), as far as the header is concerned */
+static void va_VP9SetupPastIndependence(struct _VAVP9Parser *p)
+{
+    memset(p->feature_enabled, 0, sizeof(p->feature_enabled));
+    memset(p->feature_data, 0, sizeof(p->feature_data));
+    p->segmentation_abs_or_delta_update = 0;
+    p->loop_filter_ref_deltas[0] = 1;
+    p->loop_filter_ref_deltas[1] = 0;
+    p->loop_filter_ref_deltas[2] = -1;
+    p->loop_filter_ref_deltas[3] = -1;
+    p->loop_filter_mode_deltas[0] = 0;
+    p->loop_filter_mode_deltas[1] = 0;
+}
+
+/* the quantizer scales and loop filter levels of each segment, as libvpx derives them */
+static void va_VP9FillSegmentParams(
+    struct _VAVP9Parser *p,
+    unsigned int base_q_idx,
+    int delta_q_y_dc,
+    int delta_q_uv_dc,
+    int delta_q_uv_ac,
+    int loop_filter_delta_enabled
+)
+{
+    const VADecPictureParameterBufferVP9 *pp = &p->pic.pic_param;
+    unsigned int bd = (p->bit_depth - 8) >> 1;
+    int shift = pp->filter_level >> 5;
+    unsigned int i, ref, mode;
+
+    for (i = 0; i < VP9_MAX_SEGMENTS; i++) {
+        VASegmentParameterVP9 *seg = &p->pic.slice_param.seg_param[i];
+        int active = pp->pic_fields.bits.segmentation_enabled;
+        int qindex = base_q_idx, level = pp->filter_level;
+
+        if (active && p->feature_enabled[i][VP9_SEG_LVL_ALT_Q]) {
+            qindex = p->feature_data[i][VP9_SEG_LVL_ALT_Q];
+            if (!p->segmentation_abs_or_delta_update)
+                qindex += base_q_idx;
+            qindex = VP9_CLIP3(0, 255, qindex);
+        }
+        seg->luma_ac_quant_scale = va_vp9_ac_qlookup[bd][qindex];
+        seg->luma_dc_quant_scale = va_vp9_dc_qlookup[bd][VP9_CLIP3(0, 255, qindex + delta_q_y_dc)];
+        seg->chroma_ac_quant_scale = va_vp9_ac_qlookup[bd][VP9_CLIP3(0, 255, qindex + delta_q_uv_ac)];
+        seg->chroma_dc_quant_scale = va_vp9_dc_qlookup[bd][VP9_CLIP3(0, 255, qindex + delta_q_uv_dc)];
+
+        if (active && p->feature_enabled[i][VP9_SEG_LVL_ALT_L]) {
+            level = p->feature_data[i][VP9_SEG_LVL_ALT_L];
+            if (!p->segmentation_abs_or_delta_update)
+                level += pp->filter_level;
+            level = VP9_CLIP3(0, VP9_MAX_LOOP_FILTER, level);
+        }
+        for (ref = 0; ref < 4; ref++) {
+            for (mode = 0; mode < 2; mode++) {
+                int l = level;
+
+                if (loop_filter_delta_enabled) {
+                    l += p->loop_filter_ref_deltas[ref] * (1 << shift);
+                    if (ref)
+                        l += p->loop_filter_mode_deltas[mode] * (1 << shift);
+                }
+                seg->filter_level[ref][mode] = VP9_CLIP3(0, VP9_MAX_LOOP_FILTER, l);
+            }
+        }
+
+        if (active) {
+            seg->segment_flags.fields.segment_reference_enabled =
+                p->feature_enabled[i][VP9_SEG_LVL_REF_FRAME];
+            seg->segment_flags.fields.segment_reference =
+                p->feature_data[i][VP9_SEG_LVL_REF_FRAME];
+            seg->segment_flags.fields.segment_reference_skipped =
+                p->feature_enabled[i][VP9_SEG_LVL_SKIP];
+        }
+    }
+}
+
+/* checks that the references exist and can be scaled from */
+static VAStatus va_VP9CheckRefs(struct _VAVP9Parser *p, const unsigned int *ref_frame_idx, int *skip)
+{
+    unsigned int i;
+
+    for (i = 0; i < VP9_REFS_PER_FRAME; i++) {
+        const va_vp9_ref *ref = &p->ref[ref_frame_idx[i]];
+
+        if (!ref->valid) {
+            *skip = 1;
+            continue;
+        }
+        if (2 * p->cur.width < ref->width || 2 * p->cur.height < ref->height ||
+            p->cur.width > 16 * ref->width || p->cur.height > 16 * ref->height ||
+            ref->bit_depth != p->bit_depth || ref->subsampling_x != p->subsampling_x ||
+            ref->subsampling_y != p->subsampling_y)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+    return VA_STATUS_SUCCESS;
+}
+
+/* uncompressed_header() */
+static VAStatus va_VP9ParseUncompressedHeader(
+    struct _VAVP9Parser *p,
+    va_bitreader *br,
+    uint32_t *result
+)
+{
+    VADecPictureParameterBufferVP9 *pp = &p->pic.pic_param;
+    unsigned int profile, i, base_q_idx, ref_frame_idx[VP9_REFS_PER_FRAME] = { 0 };
+    int delta_q_y_dc, delta_q_uv_dc, delta_q_uv_ac, loop_filter_delta_enabled;
+    int frame_is_intra, skip = 0;
+    VAStatus status;
+
+    if (va_BitReaderRead(br, 2) != VP9_FRAME_MARKER)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    profile = va_BitReaderReadBit(br);
+    profile |= va_BitReaderReadBit(br) << 1;
+    if (profile == 3 && va_BitReaderReadBit(br))    /* reserved_zero */
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    memset(&p->pic, 0, sizeof(p->pic));
+    p->pic.profile = VAProfileVP9Profile0 + profile;
+    p->cur.surface = VA_INVALID_SURFACE;
+    p->cur.valid = 1;
+    p->refresh_frame_flags = 0;
+
+    if (va_BitReaderReadBit(br)) {
+        /* show_existing_frame */
+        const va_vp9_ref *ref = &p->ref[va_BitReaderRead(br, 3)];
+
+        if (br->overrun)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        p->pic.show_existing_frame = 1;
+        p->pic.frame_to_show = ref->surface;
+        *result = ref->valid ? VA_VP9_PARSE_SHOW_EXISTING : VA_VP9_PARSE_SKIPPED;
+        return VA_STATUS_SUCCESS;
+    }
+
+    pp->pic_fields.bits.frame_type = va_BitReaderReadBit(br);
+    pp->pic_fields.bits.show_frame = va_BitReaderReadBit(br);
+    pp->pic_fields.bits.error_resilient_mode = va_BitReaderReadBit(br);
+    if (pp->pic_fields.bits.frame_type == VP9_KEY_FRAME) {
+        if (va_BitReaderRead(br, 24) != VP9_SYNC_CODE ||
+            !va_VP9ParseColorConfig(p, br, profile))
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+        va_VP9FrameSize(p, br, 1);
+        p->refresh_frame_flags = 0xff;
+        frame_is_intra = 1;
+    } else {
+        if (!pp->pic_fields.bits.show_frame)
+            pp->pic_fields.bits.intra_only = va_BitReaderReadBit(br);
+        frame_is_intra = pp->pic_fields.bits.intra_only;
+        if (!pp->pic_fields.bits.error_resilient_mode)
+            pp->pic_fields.bits.reset_frame_context = va_BitReaderRead(br, 2);
+        if (frame_is_intra) {
+            if (va_BitReaderRead(br, 24) != VP9_SYNC_CODE)
+                return VA_STATUS_ERROR_INVALID_PARAMETER;
+            if (profile > 0) {
+                if (!va_VP9ParseColorConfig(p, br, profile))
+                    return VA_STATUS_ERROR_INVALID_PARAMETER;
+            } else {
+                p->bit_depth = 8;
+                p->subsampling_x = p->subsampling_y = 1;
+            }
+            p->refresh_frame_flags = va_BitReaderRead(br, 8);
+            va_VP9FrameSize(p, br, 1);
+        } else {
+            int found_ref = 0;
+
+            p->refresh_frame_flags = va_BitReaderRead(br, 8);
+            for (i = 0; i < VP9_REFS_PER_FRAME; i++) {
+                ref_frame_idx[i] = va_BitReaderRead(br, 3);
+                /* ref_frame_sign_bias[] */
+                switch (i) {
+                case 0:
+                    pp->pic_fields.bits.last_ref_frame = ref_frame_idx[i];
+                    pp->pic_fields.bits.last_ref_frame_sign_bias = va_BitReaderReadBit(br);
+                    break;
+                case 1:
+                    pp->pic_fields.bits.golden_ref_frame = ref_frame_idx[i];
+                    pp->pic_fields.bits.golden_ref_frame_sign_bias = va_BitReaderReadBit(br);
+                    break;
+                default:
+                    pp->pic_fields.bits.alt_ref_frame = ref_frame_idx[i];
+                    pp->pic_fields.bits.alt_ref_frame_sign_bias = va_BitReaderReadBit(br);
+                    break;
+                }
+            }
+            /* frame_size_with_refs() */
+            for (i = 0; i < VP9_REFS_PER_FRAME && !found_ref; i++) {
+                found_ref = va_BitReaderReadBit(br);
+                if (found_ref) {
+                    const va_vp9_ref *ref = &p->ref[ref_frame_idx[i]];
+
+                    if (!ref->valid)
+                        skip = 1;
+                    p->cur.width = ref->width;
+                    p->cur.height = ref->height;
+                }
+            }
+            va_VP9FrameSize(p, br, !found_ref);
+            pp->pic_fields.bits.allow_high_precision_mv = va_BitReaderReadBit(br);
+            /* read_interpolation_filter() */
+            if (va_BitReaderReadBit(br))
+                pp->pic_fields.bits.mcomp_filter_type = VP9_SWITCHABLE;
+            else
+                pp->pic_fields.bits.mcomp_filter_type = va_vp9_literal_to_type[va_BitReaderRead(br, 2)];
+        }
+    }
+
+    if (!pp->pic_fields.bits.error_resilient_mode) {
+        pp->pic_fields.bits.refresh_frame_context = va_BitReaderReadBit(br);
+        pp->pic_fields.bits.frame_parallel_decoding_mode = va_BitReaderReadBit(br);
+    } else {
+        pp->pic_fields.bits.frame_parallel_decoding_mode = 1;
+    }
+    pp->pic_fields.bits.frame_context_idx = va_BitReaderRead(br, 2);
+    if (frame_is_intra || pp->pic_fields.bits.error_resilient_mode) {
+        va_VP9SetupPastIndependence(p);
+        pp->pic_fields.bits.frame_context_idx = 0;
+    }
+
+    loop_filter_delta_enabled = va_VP9ParseLoopFilter(p, br);
+
+    /* quantization_params() */
+    base_q_idx = va_BitReaderRead(br, 8);
+    delta_q_y_dc = va_BitReaderReadBit(br) ? va_VP9ReadSU(br, 4) : 0;
+    delta_q_uv_dc = va_BitReaderReadBit(br) ? va_VP9ReadSU(br, 4) : 0;
+    delta_q_uv_ac = va_BitReaderReadBit(br) ? va_VP9ReadSU(br, 4) : 0;
+    pp->pic_fields.bits.lossless_flag = !base_q_idx && !delta_q_y_dc && !delta_q_uv_dc && !delta_q_uv_ac;
+
+    va_VP9ParseSegmentation(p, br);
+    if (!va_VP9ParseTileInfo(p, br))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    pp->first_partition_size = va_BitReaderRead(br, 16);
+    va_BitReaderAlign(br);
+    if (br->overrun || !pp->first_partition_size)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    if (!frame_is_intra && !skip) {
+        status = va_VP9CheckRefs(p, ref_frame_idx, &skip);
+        if (status != VA_STATUS_SUCCESS)
+            return status;
+    }
+
+    p->cur.bit_depth = p->bit_depth;
+    p->cur.subsampling_x = p->subsampling_x;
+    p->cur.subsampling_y = p->subsampling_y;
+    p->refresh_pending = 1;
+    if (skip) {
+        /* the slots the frame refreshes are lost as well */
+        p->cur.valid = 0;
+        *result = VA_VP9_PARSE_SKIPPED;
+        return VA_STATUS_SUCCESS;
+    }
+
+    pp->frame_width = p->cur.width;
+    pp->frame_height = p->cur.height;
+    pp->pic_fields.bits.subsampling_x = p->subsampling_x;
+    pp->pic_fields.bits.subsampling_y = p->subsampling_y;
+    memcpy(pp->mb_segment_tree_probs, p->tree_probs, sizeof(pp->mb_segment_tree_probs));
+    memcpy(pp->segment_pred_probs, p->pred_probs, sizeof(pp->segment_pred_probs));
+    pp->profile = profile;
+    pp->bit_depth = p->bit_depth;
+    va_VP9FillSegmentParams(p, base_q_idx, delta_q_y_dc, delta_q_uv_dc, delta_q_uv_ac,
+                            loop_filter_delta_enabled);
+
+    *result = VA_VP9_PARSE_PICTURE;
+    if (!pp->pic_fields.bits.show_frame)
+        *result |= VA_VP9_PARSE_HIDDEN;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaParseVP9Frame(
+    VAVP9Parser parser,
+    const uint8_t *data,
+    uint32_t size,
+    uint32_t slice_data_offset,
+    uint32_t *result
+)
+{
+    struct _VAVP9Parser *p = parser;
+    VASliceParameterBufferVP9 *sp;
+    unsigned int header_size;
+    va_bitreader br;
+    VAStatus status;
+
+    if (!p || !data || !size || !result)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    *result = 0;
+
+    if (p->refresh_pending)
+        va_VP9RefreshFrames(p);
+
+    va_BitReaderInit(&br, data, size, 0);
+    status = va_VP9ParseUncompressedHeader(p, &br, result);
+    if (status != VA_STATUS_SUCCESS) {
+        p->refresh_pending = 0;
+        return status;
+    }
+    if (!(*result & VA_VP9_PARSE_PICTURE))
+        return VA_STATUS_SUCCESS;
+
+    header_size = va_BitReaderPosition(&br) / 8;
+    if (p->pic.pic_param.first_partition_size > size - header_size) {
+        p->refresh_pending = 0;
+        *result = 0;
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+    p->pic.pic_param.frame_header_length_in_bytes = header_size;
+    sp = &p->pic.slice_param;
+    sp->slice_data_size = size;
+    sp->slice_data_offset = slice_data_offset;
+    sp->slice_data_flag = VA_SLICE_DATA_FLAG_ALL;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaGetVP9PictureParams(
+    VAVP9Parser parser,
+    VASurfaceID surface,
+    VAVP9PictureParams *params
+)
+{
+    struct _VAVP9Parser *p = parser;
+    unsigned int i;
+
+    if (!p || !params)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    *params = p->pic;
+    if (p->pic.show_existing_frame)
+        return VA_STATUS_SUCCESS;
+
+    p->cur.surface = surface;
+    for (i = 0; i < VP9_NUM_REF_FRAMES; i++)
+        params->pic_param.reference_frames[i] = p->ref[i].valid ? p->ref[i].surface : VA_INVALID_SURFACE;
+    return VA_STATUS_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_parse_vp9.h
+ * \brief VP9 bitstream parser for decode
+ *
+ * Splits VP9 superframes and parses the uncompressed header of each frame
+ * into the VA decode parameter structures of va_dec_vp9.h, so that simple
+ * clients can drive the VLD entrypoint without a parsing framework. The
+ * compressed header is left to the hardware. The parser keeps the state
+ * that frame headers are predicted from: the eight reference frame slots
+ * with their sizes and formats, the loop filter deltas and the
+ * segmentation features, and derives the per segment quantizer scales and
+ * loop filter levels of VASegmentParameterVP9 from it.
+ *
+ * The input is the frame payload as stored in IVF, WebM or MP4 and is
+ * read in place: the frames of a superframe are located with
+ * vaSplitVP9Superframe() and the payload can be turned into the slice
+ * data buffer without a copy, e.g. with vaCreateBufferFromMemory().
+ *
+ * Usage:
+ * - split each payload with vaSplitVP9Superframe();
+ * - pass each frame to vaParseVP9Frame(), with its offset in the slice
+ *   data buffer;
+ * - when it returns VA_VP9_PARSE_PICTURE, pick the surface of the new
+ *   frame, get its parameters with vaGetVP9PictureParams() and decode it
+ *   with one picture parameter buffer, one slice parameter buffer and the
+ *   slice data; VA_VP9_PARSE_HIDDEN tells that the frame is not output;
+ * - with VA_VP9_PARSE_SHOW_EXISTING, nothing is decoded, the surface
+ *   returned by vaGetVP9PictureParams() is output again.
+ */
+
+#ifndef _VA_PARSE_VP9_H_
+#define _VA_PARSE_VP9_H_
+
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_parse_vp9 VP9 parser
+ *
+ * @{
+ */
+
+/** \brief Opaque VP9 parser state. */
+typedef struct _VAVP9Parser *VAVP9Parser;
+
+/** \brief Maximum number of frames in a superframe. */
+#define VA_VP9_MAX_SUPERFRAME_FRAMES    8
+
+/**
+ * \brief Locates the frames of a superframe.
+ *
+ * A payload without superframe index holds a single frame, which is
+ * returned as such. The frames are returned in decoding order; they are
+ * contiguous, starting at the beginning of \c data.
+ *
+ * @param[out] frame_offsets    offset of each frame in \c data
+ * @param[out] frame_sizes      size of each frame
+ * @param[out] num_frames       number of frames
+ * @return VA_STATUS_ERROR_INVALID_PARAMETER if the frame sizes of the
+ *         index exceed the payload
+ */
+VAStatus vaSplitVP9Superframe(
+    const uint8_t *data,
+    uint32_t size,
+    uint32_t frame_offsets[VA_VP9_MAX_SUPERFRAME_FRAMES],   /* out */
+    uint32_t frame_sizes[VA_VP9_MAX_SUPERFRAME_FRAMES],     /* out */
+    uint32_t *num_frames                                    /* out */
+);
+
+/** \brief Parameters of a frame. */
+typedef struct _VAVP9PictureParams {
+    /** \brief Profile of the frame, VAProfileVP9Profile0 to 3. */
+    VAProfile profile;
+    /** \brief Picture parameters. */
+    VADecPictureParameterBufferVP9 pic_param;
+    /**
+     * \brief Slice parameters, covering the whole frame with the quantizer
+     * scales and loop filter levels of the eight segments.
+     */
+    VASliceParameterBufferVP9 slice_param;
+    /**
+     * \brief The frame is a show_existing_frame one: nothing is decoded,
+     * \c frame_to_show is the surface to output. pic_param and
+     * slice_param are not valid.
+     */
+    uint8_t show_existing_frame;
+    /** \brief Surface to output for a show_existing_frame frame. */
+    VASurfaceID frame_to_show;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_LOW];
+} VAVP9PictureParams;
+
+/** \brief Creates a VP9 parser. */
+VAStatus vaCreateVP9Parser(VAVP9Parser *parser);
+
+/** \brief Destroys a VP9 parser. */
+VAStatus vaDestroyVP9Parser(VAVP9Parser parser);
+
+/** \brief The frame is to be decoded. */
+#define VA_VP9_PARSE_PICTURE            0x00000001
+/** \brief The decoded frame is not shown (show_frame is 0). */
+#define VA_VP9_PARSE_HIDDEN             0x00000002
+/**
+ * \brief The frame is a show_existing_frame one, get the surface to
+ * output with vaGetVP9PictureParams().
+ */
+#define VA_VP9_PARSE_SHOW_EXISTING      0x00000004
+/**
+ * \brief The frame cannot be decoded, because the reference frames it
+ * uses precede the start of the stream.
+ */
+#define VA_VP9_PARSE_SKIPPED            0x00000008
+
+/**
+ * \brief Parses a frame.
+ *
+ * \c data points to a single frame, as returned by vaSplitVP9Superframe(),
+ * which is assumed to be at \c slice_data_offset in the slice data
+ * buffer. Only the uncompressed header is read.
+ *
+ * The reference frame slots are updated when the next frame is parsed,
+ * with the surface given to vaGetVP9PictureParams() until then.
+ *
+ * @param[out] result   combination of VA_VP9_PARSE_xxx
+ * @return VA_STATUS_ERROR_INVALID_PARAMETER if the frame is corrupted
+ */
+VAStatus vaParseVP9Frame(
+    VAVP9Parser parser,
+    const uint8_t *data,
+    uint32_t size,
+    uint32_t slice_data_offset,
+    uint32_t *result            /* out */
+);
+
+/**
+ * \brief Returns the parameters of the current frame.
+ *
+ * Called after vaParseVP9Frame() returned VA_VP9_PARSE_PICTURE or
+ * VA_VP9_PARSE_SHOW_EXISTING, and before the next frame is parsed.
+ * \c surface is the render target of the frame, which the reference
+ * frame slots refreshed by the frame will point to; it is ignored for
+ * show_existing_frame frames.
+ */
+VAStatus vaGetVP9PictureParams(
+    VAVP9Parser parser,
+    VASurfaceID surface,
+    VAVP9PictureParams *params      /* out */
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_PARSE_VP9_H_ */
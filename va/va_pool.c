@@ -0,0 +1,942 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define VA_POOL_HASH_SIZE       256
+#define VA_POOL_MIN_DATA_SIZE   4096
+
+struct va_pool_buffer {
+    VABufferID id;
+    VAContextID context;
+    VABufferType type;
+    unsigned int size;
+    unsigned int num_elements;
+    size_t bytes;
+    int idle;
+    int recycle;                        /* vaDestroyBuffer() returns it to the pool */
+    struct va_pool_buffer *id_next;     /* all the buffers, hashed by id */
+    struct va_pool_buffer *key_next;    /* idle buffers, hashed by key */
+    struct va_pool_buffer *lru_prev;    /* idle buffers, most recently released first */
+    struct va_pool_buffer *lru_next;
+};
+
+struct va_buffer_pool {
+    pthread_mutex_t lock;
+    struct va_pool_buffer *by_id[VA_POOL_HASH_SIZE];
+    struct va_pool_buffer *idle[VA_POOL_HASH_SIZE];
+    struct va_pool_buffer *lru_head;
+    struct va_pool_buffer *lru_tail;
+    size_t idle_bytes;
+    size_t max_idle_bytes;
+};
+
+static pthread_mutex_t va_pool_init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define DPY2POOL(dpy) \
+    ((struct va_buffer_pool *)__atomic_load_n(&((VADisplayContextP)dpy)->vapool, __ATOMIC_ACQUIRE))
+
+static struct va_buffer_pool *va_BufferPoolGet(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_buffer_pool *pool = DPY2POOL(dpy);
+    char env_value[1024];
+
+    if (pool)
+        return pool;
+
+    pthread_mutex_lock(&va_pool_init_lock);
+    pool = pDisplayContext->vapool;
+    if (!pool) {
+        pool = calloc(1, sizeof(*pool));
+        if (pool) {
+            pthread_mutex_init(&pool->lock, NULL);
+            pool->max_idle_bytes = (size_t)64 << 20;
+            if (va_parseConfig("LIBVA_BUFFER_POOL_SIZE", &env_value[0]) == 0)
+                pool->max_idle_bytes = (size_t)strtoul(env_value, NULL, 10) << 20;
+            __atomic_store_n(&pDisplayContext->vapool, pool, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&va_pool_init_lock);
+
+    return pool;
+}
+
+static inline unsigned int va_PoolHashId(VABufferID id)
+{
+    return (id * 2654435761U) >> 24;
+}
+
+static inline unsigned int va_PoolHashKey(VAContextID context, VABufferType type,
+        unsigned int size, unsigned int num_elements)
+{
+    uint32_t h = context * 2654435761U;
+
+    h = (h ^ type) * 2654435761U;
+    h = (h ^ size) * 2654435761U;
+    h = (h ^ num_elements) * 2654435761U;
+    return h >> 24;
+}
+
+/* buffers whose payload size is given by other parameters can be larger */
+static int va_PoolIsDataBuffer(VABufferType type)
+{
+    return type == VASliceDataBufferType ||
+           type == VAProtectedSliceDataBufferType ||
+           type == VAEncPackedHeaderDataBufferType;
+}
+
+static unsigned int va_PoolSizeClass(size_t bytes)
+{
+    unsigned int size = VA_POOL_MIN_DATA_SIZE;
+
+    while (size < bytes && size < 0x80000000U)
+        size <<= 1;
+    return size < bytes ? (unsigned int)bytes : size;
+}
+
+/* the following helpers must be called with pool->lock held */
+
+static void va_PoolLruRemove(struct va_buffer_pool *pool, struct va_pool_buffer *b)
+{
+    if (b->lru_prev)
+        b->lru_prev->lru_next = b->lru_next;
+    else
+        pool->lru_head = b->lru_next;
+    if (b->lru_next)
+        b->lru_next->lru_prev = b->lru_prev;
+    else
+        pool->lru_tail = b->lru_prev;
+    b->lru_prev = b->lru_next = NULL;
+}
+
+static void va_PoolRemoveIdle(struct va_buffer_pool *pool, struct va_pool_buffer *b)
+{
+    struct va_pool_buffer **p;
+
+    p = &pool->idle[va_PoolHashKey(b->context, b->type, b->size, b->num_elements)];
+    for (; *p; p = &(*p)->key_next) {
+        if (*p == b) {
+            *p = b->key_next;
+            break;
+        }
+    }
+    b->key_next = NULL;
+    va_PoolLruRemove(pool, b);
+    pool->idle_bytes -= b->bytes;
+    b->idle = 0;
+}
+
+static void va_PoolRemoveId(struct va_buffer_pool *pool, struct va_pool_buffer *b)
+{
+    struct va_pool_buffer **p;
+
+    for (p = &pool->by_id[va_PoolHashId(b->id)]; *p; p = &(*p)->id_next) {
+        if (*p == b) {
+            *p = b->id_next;
+            break;
+        }
+    }
+    b->id_next = NULL;
+}
+
+static struct va_pool_buffer *va_PoolFindId(struct va_buffer_pool *pool, VABufferID id)
+{
+    struct va_pool_buffer *b;
+
+    for (b = pool->by_id[va_PoolHashId(id)]; b; b = b->id_next) {
+        if (b->id == id)
+            return b;
+    }
+    return NULL;
+}
+
+/* unlink the least recently released buffers above max_bytes, returns them chained by id_next */
+static struct va_pool_buffer *va_PoolEvict(struct va_buffer_pool *pool, size_t max_bytes)
+{
+    struct va_pool_buffer *list = NULL, *b;
+
+    while (pool->idle_bytes > max_bytes && pool->lru_tail) {
+        b = pool->lru_tail;
+        va_PoolRemoveIdle(pool, b);
+        va_PoolRemoveId(pool, b);
+        b->id_next = list;
+        list = b;
+    }
+    return list;
+}
+
+/* destroy buffers already unlinked from the pool, without the lock held */
+static void va_PoolDestroyList(VADisplay dpy, struct va_pool_buffer *list)
+{
+    struct va_pool_buffer *next;
+
+    for (; list; list = next) {
+        next = list->id_next;
+        vaDestroyBuffer(dpy, list->id);
+        free(list);
+    }
+}
+
+VAStatus va_BufferPoolCreate(
+    VADisplay dpy,
+    VAContextID context,
+    VABufferType type,
+    unsigned int size,
+    unsigned int num_elements,
+    const void *data,
+    int recycle,
+    VABufferID *buf_id
+)
+{
+    struct va_buffer_pool *pool;
+    struct va_pool_buffer *b;
+    VAStatus va_status;
+    size_t data_size;
+    void *ptr;
+
+    if (!buf_id || size == 0 || num_elements == 0)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    pool = va_BufferPoolGet(dpy);
+    if (!pool)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    data_size = (size_t)size * num_elements;
+    if (va_PoolIsDataBuffer(type)) {
+        size = va_PoolSizeClass(data_size);
+        num_elements = 1;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    for (b = pool->idle[va_PoolHashKey(context, type, size, num_elements)]; b; b = b->key_next) {
+        if (b->context == context && b->type == type &&
+            b->size == size && b->num_elements == num_elements)
+            break;
+    }
+    if (b) {
+        va_PoolRemoveIdle(pool, b);
+        b->recycle = recycle;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (b) {
+        *buf_id = b->id;
+        if (!data)
+            return VA_STATUS_SUCCESS;
+
+        va_status = vaMapBuffer(dpy, b->id, &ptr);
+        if (va_status == VA_STATUS_SUCCESS) {
+            memcpy(ptr, data, data_size);
+            va_status = vaUnmapBuffer(dpy, b->id);
+        }
+        if (va_status != VA_STATUS_SUCCESS)
+            vaReleasePooledBuffer(dpy, b->id);
+        return va_status;
+    }
+
+    b = calloc(1, sizeof(*b));
+    if (!b)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    /* a data buffer of a larger class than data: create empty and fill the payload only */
+    va_status = vaCreateBuffer(dpy, context, type, size, num_elements,
+                               va_PoolIsDataBuffer(type) ? NULL : (void *)data, &b->id);
+    if (va_status != VA_STATUS_SUCCESS) {
+        free(b);
+        return va_status;
+    }
+    b->context = context;
+    b->type = type;
+    b->size = size;
+    b->num_elements = num_elements;
+    b->bytes = (size_t)size * num_elements;
+    b->recycle = recycle;
+
+    if (data && va_PoolIsDataBuffer(type)) {
+        va_status = vaMapBuffer(dpy, b->id, &ptr);
+        if (va_status == VA_STATUS_SUCCESS) {
+            memcpy(ptr, data, data_size);
+            va_status = vaUnmapBuffer(dpy, b->id);
+        }
+        if (va_status != VA_STATUS_SUCCESS) {
+            vaDestroyBuffer(dpy, b->id);
+            free(b);
+            return va_status;
+        }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    b->id_next = pool->by_id[va_PoolHashId(b->id)];
+    pool->by_id[va_PoolHashId(b->id)] = b;
+    pthread_mutex_unlock(&pool->lock);
+
+    *buf_id = b->id;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaCreatePooledBuffer(
+    VADisplay dpy,
+    VAContextID context,
+    VABufferType type,
+    unsigned int size,
+    unsigned int num_elements,
+    const void *data,
+    VABufferID *buf_id     /* out */
+)
+{
+    CHECK_DISPLAY(dpy);
+
+    return va_BufferPoolCreate(dpy, context, type, size, num_elements, data, 0, buf_id);
+}
+
+VAStatus vaReleasePooledBuffer(
+    VADisplay dpy,
+    VABufferID buf_id
+)
+{
+    struct va_buffer_pool *pool;
+    struct va_pool_buffer *b, *evicted;
+    unsigned int key;
+
+    CHECK_DISPLAY(dpy);
+
+    pool = DPY2POOL(dpy);
+    if (!pool)
+        return VA_STATUS_ERROR_INVALID_BUFFER;
+
+    pthread_mutex_lock(&pool->lock);
+    b = va_PoolFindId(pool, buf_id);
+    if (!b || b->idle) {
+        pthread_mutex_unlock(&pool->lock);
+        return VA_STATUS_ERROR_INVALID_BUFFER;
+    }
+
+    key = va_PoolHashKey(b->context, b->type, b->size, b->num_elements);
+    b->key_next = pool->idle[key];
+    pool->idle[key] = b;
+    b->lru_prev = NULL;
+    b->lru_next = pool->lru_head;
+    if (pool->lru_head)
+        pool->lru_head->lru_prev = b;
+    else
+        pool->lru_tail = b;
+    pool->lru_head = b;
+    pool->idle_bytes += b->bytes;
+    b->idle = 1;
+
+    evicted = va_PoolEvict(pool, pool->max_idle_bytes);
+    pthread_mutex_unlock(&pool->lock);
+
+    va_PoolDestroyList(dpy, evicted);
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaTrimBufferPool(
+    VADisplay dpy,
+    size_t max_bytes
+)
+{
+    struct va_buffer_pool *pool;
+    struct va_pool_buffer *evicted;
+
+    CHECK_DISPLAY(dpy);
+
+    pool = DPY2POOL(dpy);
+    if (!pool)
+        return VA_STATUS_SUCCESS;
+
+    pthread_mutex_lock(&pool->lock);
+    evicted = va_PoolEvict(pool, max_bytes);
+    pthread_mutex_unlock(&pool->lock);
+
+    va_PoolDestroyList(dpy, evicted);
+    return VA_STATUS_SUCCESS;
+}
+
+int va_BufferPoolRecycle(VADisplay dpy, VABufferID buf_id)
+{
+    struct va_buffer_pool *pool = DPY2POOL(dpy);
+    struct va_pool_buffer *b;
+    int recycle;
+
+    if (!pool)
+        return 0;
+
+    pthread_mutex_lock(&pool->lock);
+    b = va_PoolFindId(pool, buf_id);
+    recycle = b && b->recycle && !b->idle;
+    pthread_mutex_unlock(&pool->lock);
+
+    return recycle && vaReleasePooledBuffer(dpy, buf_id) == VA_STATUS_SUCCESS;
+}
+
+void va_BufferPoolForget(VADisplay dpy, VABufferID buf_id)
+{
+    struct va_buffer_pool *pool = DPY2POOL(dpy);
+    struct va_pool_buffer *b;
+
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    b = va_PoolFindId(pool, buf_id);
+    if (b) {
+        if (b->idle)
+            va_PoolRemoveIdle(pool, b);
+        va_PoolRemoveId(pool, b);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    free(b);
+}
+
+void va_BufferPoolDestroyContext(VADisplay dpy, VAContextID context)
+{
+    struct va_buffer_pool *pool = DPY2POOL(dpy);
+    struct va_pool_buffer *list = NULL, *b, *next;
+    unsigned int i;
+
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    for (i = 0; i < VA_POOL_HASH_SIZE; i++) {
+        for (b = pool->by_id[i]; b; b = next) {
+            next = b->id_next;
+            if (b->context != context)
+                continue;
+            if (b->idle)
+                va_PoolRemoveIdle(pool, b);
+            va_PoolRemoveId(pool, b);
+            b->id_next = list;
+            list = b;
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    va_PoolDestroyList(dpy, list);
+}
+
+void va_BufferPoolEnd(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_buffer_pool *pool = DPY2POOL(dpy);
+    struct va_pool_buffer *b, *next;
+    unsigned int i;
+
+    if (!pool)
+        return;
+
+    /* detach first, vaDestroyBuffer() must not find the pool anymore */
+    __atomic_store_n(&pDisplayContext->vapool, NULL, __ATOMIC_RELEASE);
+
+    /* in use buffers are left to the driver, it releases them on termination */
+    for (i = 0; i < VA_POOL_HASH_SIZE; i++) {
+        for (b = pool->by_id[i]; b; b = next) {
+            next = b->id_next;
+            if (b->idle)
+                vaDestroyBuffer(dpy, b->id);
+            free(b);
+        }
+        pool->by_id[i] = NULL;
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+struct va_surface_bucket;
+
+struct va_pool_surface {
+    VASurfaceID id;
+    unsigned int refcount;
+    struct va_surface_bucket *bucket;
+    struct va_pool_surface *id_next;    /* all the surfaces, hashed by id */
+    struct va_pool_surface *idle_next;  /* idle surfaces of the bucket */
+    struct va_pool_surface *lru_prev;   /* idle surfaces of the pool, most recently released first */
+    struct va_pool_surface *lru_next;
+};
+
+struct va_surface_bucket {
+    unsigned int format;
+    unsigned int width;
+    unsigned int height;
+    unsigned int num_attribs;
+    VASurfaceAttrib *attribs;
+    size_t surface_bytes;
+    unsigned int num_surfaces;
+    struct va_pool_surface *idle;
+    struct va_surface_bucket *next;
+};
+
+struct _VASurfacePool {
+    VADisplay dpy;
+    pthread_mutex_t lock;
+    struct va_surface_bucket *buckets;
+    struct va_pool_surface *by_id[VA_POOL_HASH_SIZE];
+    struct va_pool_surface *lru_head;
+    struct va_pool_surface *lru_tail;
+    VASurfacePoolStats stats;
+};
+
+/* rough memory footprint of a surface, used for the budget only */
+static size_t va_PoolSurfaceBytes(unsigned int format, unsigned int width, unsigned int height)
+{
+    size_t pixels = (size_t)width * height;
+
+    if (format & (VA_RT_FORMAT_RGB32 | VA_RT_FORMAT_RGB32_10 | VA_RT_FORMAT_YUV444_10 |
+                  VA_RT_FORMAT_YUV422_10 | VA_RT_FORMAT_YUV422_12))
+        return pixels * 4;
+    if (format & (VA_RT_FORMAT_YUV444_12 | VA_RT_FORMAT_RGB32_10BPP))
+        return pixels * 8;
+    if (format & (VA_RT_FORMAT_YUV444 | VA_RT_FORMAT_RGBP | VA_RT_FORMAT_YUV420_10 |
+                  VA_RT_FORMAT_YUV420_12))
+        return pixels * 3;
+    if (format & (VA_RT_FORMAT_YUV422 | VA_RT_FORMAT_RGB16))
+        return pixels * 2;
+    if (format & VA_RT_FORMAT_YUV400)
+        return pixels;
+    return pixels * 3 / 2;
+}
+
+static int va_PoolAttribsEqual(const VASurfaceAttrib *a, const VASurfaceAttrib *b, unsigned int num)
+{
+    unsigned int i;
+
+    for (i = 0; i < num; i++) {
+        if (a[i].type != b[i].type || a[i].flags != b[i].flags ||
+            a[i].value.type != b[i].value.type)
+            return 0;
+        switch (a[i].value.type) {
+        case VAGenericValueTypeInteger:
+            if (a[i].value.value.i != b[i].value.value.i)
+                return 0;
+            break;
+        case VAGenericValueTypeFloat:
+            if (a[i].value.value.f != b[i].value.value.f)
+                return 0;
+            break;
+        default:
+            if (a[i].value.value.p != b[i].value.value.p)
+                return 0;
+            break;
+        }
+    }
+    return 1;
+}
+
+/* the following helpers must be called with pool->lock held */
+
+static struct va_surface_bucket *va_PoolGetBucket(VASurfacePool pool, unsigned int format,
+        unsigned int width, unsigned int height,
+        const VASurfaceAttrib *attribs, unsigned int num_attribs)
+{
+    struct va_surface_bucket *b;
+
+    for (b = pool->buckets; b; b = b->next) {
+        if (b->format == format && b->width == width && b->height == height &&
+            b->num_attribs == num_attribs && va_PoolAttribsEqual(b->attribs, attribs, num_attribs))
+            return b;
+    }
+
+    b = calloc(1, sizeof(*b));
+    if (!b)
+        return NULL;
+    if (num_attribs) {
+        b->attribs = malloc(num_attribs * sizeof(*attribs));
+        if (!b->attribs) {
+            free(b);
+            return NULL;
+        }
+        memcpy(b->attribs, attribs, num_attribs * sizeof(*attribs));
+    }
+    b->format = format;
+    b->width = width;
+    b->height = height;
+    b->num_attribs = num_attribs;
+    b->surface_bytes = va_PoolSurfaceBytes(format, width, height);
+    b->next = pool->buckets;
+    pool->buckets = b;
+    pool->stats.num_buckets++;
+
+    return b;
+}
+
+static void va_PoolFreeBucketIfEmpty(VASurfacePool pool, struct va_surface_bucket *bucket)
+{
+    struct va_surface_bucket **p;
+
+    if (bucket->num_surfaces)
+        return;
+
+    for (p = &pool->buckets; *p; p = &(*p)->next) {
+        if (*p == bucket) {
+            *p = bucket->next;
+            break;
+        }
+    }
+    free(bucket->attribs);
+    free(bucket);
+    pool->stats.num_buckets--;
+}
+
+static struct va_pool_surface *va_PoolFindSurface(VASurfacePool pool, VASurfaceID id)
+{
+    struct va_pool_surface *s;
+
+    for (s = pool->by_id[va_PoolHashId(id)]; s; s = s->id_next) {
+        if (s->id == id)
+            return s;
+    }
+    return NULL;
+}
+
+static void va_PoolUnlinkIdleSurface(VASurfacePool pool, struct va_pool_surface *s)
+{
+    struct va_pool_surface **p;
+
+    for (p = &s->bucket->idle; *p; p = &(*p)->idle_next) {
+        if (*p == s) {
+            *p = s->idle_next;
+            break;
+        }
+    }
+    s->idle_next = NULL;
+
+    if (s->lru_prev)
+        s->lru_prev->lru_next = s->lru_next;
+    else
+        pool->lru_head = s->lru_next;
+    if (s->lru_next)
+        s->lru_next->lru_prev = s->lru_prev;
+    else
+        pool->lru_tail = s->lru_prev;
+    s->lru_prev = s->lru_next = NULL;
+
+    pool->stats.num_idle--;
+    pool->stats.bytes_idle -= s->bucket->surface_bytes;
+}
+
+/* makes an unreferenced surface idle, most recently released first */
+static void va_PoolLinkIdleSurface(VASurfacePool pool, struct va_pool_surface *s)
+{
+    s->idle_next = s->bucket->idle;
+    s->bucket->idle = s;
+    s->lru_prev = NULL;
+    s->lru_next = pool->lru_head;
+    if (pool->lru_head)
+        pool->lru_head->lru_prev = s;
+    else
+        pool->lru_tail = s;
+    pool->lru_head = s;
+    pool->stats.num_idle++;
+    pool->stats.bytes_idle += s->bucket->surface_bytes;
+}
+
+/* destroys an idle or in use surface */
+static void va_PoolDestroySurface(VASurfacePool pool, struct va_pool_surface *s)
+{
+    struct va_surface_bucket *bucket = s->bucket;
+    struct va_pool_surface **p;
+
+    if (s->refcount) {
+        pool->stats.num_in_use--;
+        pool->stats.bytes_in_use -= bucket->surface_bytes;
+    } else {
+        va_PoolUnlinkIdleSurface(pool, s);
+    }
+
+    for (p = &pool->by_id[va_PoolHashId(s->id)]; *p; p = &(*p)->id_next) {
+        if (*p == s) {
+            *p = s->id_next;
+            break;
+        }
+    }
+
+    vaDestroySurfaces(pool->dpy, &s->id, 1);
+    free(s);
+
+    bucket->num_surfaces--;
+    va_PoolFreeBucketIfEmpty(pool, bucket);
+}
+
+/* evict idle surfaces, least recently released first, while over the limit */
+static void va_PoolEvictSurfaces(VASurfacePool pool, uint64_t max_bytes, int idle_only)
+{
+    while (pool->lru_tail) {
+        uint64_t bytes = pool->stats.bytes_idle + (idle_only ? 0 : pool->stats.bytes_in_use);
+
+        if (bytes <= max_bytes)
+            break;
+        va_PoolDestroySurface(pool, pool->lru_tail);
+        pool->stats.num_evicted++;
+    }
+}
+
+VAStatus vaCreateSurfacePool(
+    VADisplay dpy,
+    size_t memory_budget,
+    VASurfacePool *pool        /* out */
+)
+{
+    VASurfacePool p;
+
+    CHECK_DISPLAY(dpy);
+    if (!pool)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    p = calloc(1, sizeof(*p));
+    if (!p)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    p->dpy = dpy;
+    p->stats.memory_budget = memory_budget;
+    pthread_mutex_init(&p->lock, NULL);
+
+    *pool = p;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaDestroySurfacePool(
+    VADisplay dpy,
+    VASurfacePool pool
+)
+{
+    struct va_pool_surface *s, *next;
+    unsigned int i;
+
+    CHECK_DISPLAY(dpy);
+    if (!pool || pool->dpy != dpy)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < VA_POOL_HASH_SIZE; i++) {
+        for (s = pool->by_id[i]; s; s = next) {
+            next = s->id_next;
+            va_PoolDestroySurface(pool, s);
+        }
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaAcquirePoolSurfaces(
+    VADisplay dpy,
+    VASurfacePool pool,
+    unsigned int format,
+    unsigned int width,
+    unsigned int height,
+    VASurfaceID *surfaces,          /* out */
+    unsigned int num_surfaces,
+    VASurfaceAttrib *attrib_list,
+    unsigned int num_attribs
+)
+{
+    struct va_surface_bucket *bucket;
+    struct va_pool_surface *s;
+    VAStatus va_status = VA_STATUS_SUCCESS;
+    unsigned int i, n = 0, num_reused;
+
+    CHECK_DISPLAY(dpy);
+    if (!pool || pool->dpy != dpy || !surfaces || (num_attribs && !attrib_list))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < num_attribs; i++) {
+        if (attrib_list[i].type == VASurfaceAttribExternalBufferDescriptor)
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    bucket = va_PoolGetBucket(pool, format, width, height, attrib_list, num_attribs);
+    if (!bucket) {
+        pthread_mutex_unlock(&pool->lock);
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    /* most recently released first, it is the most likely to still be cached */
+    for (; n < num_surfaces && bucket->idle; n++) {
+        s = bucket->idle;
+        va_PoolUnlinkIdleSurface(pool, s);
+        s->refcount = 1;
+        surfaces[n] = s->id;
+        pool->stats.num_in_use++;
+        pool->stats.bytes_in_use += bucket->surface_bytes;
+        pool->stats.num_reused++;
+    }
+    num_reused = n;
+
+    if (n < num_surfaces) {
+        /* make room for the new surfaces first */
+        if (pool->stats.memory_budget) {
+            uint64_t needed = (uint64_t)(num_surfaces - n) * bucket->surface_bytes;
+
+            va_PoolEvictSurfaces(pool, pool->stats.memory_budget > needed ?
+                                 pool->stats.memory_budget - needed : 0, 0);
+        }
+
+        va_status = vaCreateSurfaces(dpy, format, width, height, surfaces + n,
+                                     num_surfaces - n, attrib_list, num_attribs);
+        for (i = n; va_status == VA_STATUS_SUCCESS && i < num_surfaces; i++) {
+            s = calloc(1, sizeof(*s));
+            if (!s) {
+                vaDestroySurfaces(dpy, surfaces + i, num_surfaces - i);
+                va_status = VA_STATUS_ERROR_ALLOCATION_FAILED;
+                break;
+            }
+            s->id = surfaces[i];
+            s->refcount = 1;
+            s->bucket = bucket;
+            s->id_next = pool->by_id[va_PoolHashId(s->id)];
+            pool->by_id[va_PoolHashId(s->id)] = s;
+            bucket->num_surfaces++;
+            pool->stats.num_in_use++;
+            pool->stats.bytes_in_use += bucket->surface_bytes;
+            pool->stats.num_created++;
+            n++;
+        }
+    }
+
+    if (va_status != VA_STATUS_SUCCESS) {
+        /* destroy what was created, the reused surfaces go back idle in their former order */
+        for (i = num_reused; i < n; i++) {
+            va_PoolDestroySurface(pool, va_PoolFindSurface(pool, surfaces[i]));
+            pool->stats.num_created--;
+        }
+        for (i = num_reused; i-- > 0;) {
+            s = va_PoolFindSurface(pool, surfaces[i]);
+            s->refcount = 0;
+            pool->stats.num_in_use--;
+            pool->stats.bytes_in_use -= bucket->surface_bytes;
+            pool->stats.num_reused--;
+            va_PoolLinkIdleSurface(pool, s);
+        }
+        if (n == 0)
+            va_PoolFreeBucketIfEmpty(pool, bucket);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return va_status;
+}
+
+VAStatus vaAddRefPoolSurface(
+    VADisplay dpy,
+    VASurfacePool pool,
+    VASurfaceID surface
+)
+{
+    struct va_pool_surface *s;
+
+    CHECK_DISPLAY(dpy);
+    if (!pool || pool->dpy != dpy)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    pthread_mutex_lock(&pool->lock);
+    s = va_PoolFindSurface(pool, surface);
+    if (s && s->refcount)
+        s->refcount++;
+    pthread_mutex_unlock(&pool->lock);
+
+    return s && s->refcount ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_INVALID_SURFACE;
+}
+
+VAStatus vaReleasePoolSurfaces(
+    VADisplay dpy,
+    VASurfacePool pool,
+    VASurfaceID *surfaces,
+    unsigned int num_surfaces
+)
+{
+    struct va_pool_surface *s;
+    VAStatus va_status = VA_STATUS_SUCCESS;
+    unsigned int i;
+
+    CHECK_DISPLAY(dpy);
+    if (!pool || pool->dpy != dpy || (num_surfaces && !surfaces))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    pthread_mutex_lock(&pool->lock);
+    for (i = 0; i < num_surfaces; i++) {
+        s = va_PoolFindSurface(pool, surfaces[i]);
+        if (!s || !s->refcount) {
+            va_status = VA_STATUS_ERROR_INVALID_SURFACE;
+            continue;
+        }
+        if (--s->refcount)
+            continue;
+
+        pool->stats.num_in_use--;
+        pool->stats.bytes_in_use -= s->bucket->surface_bytes;
+        va_PoolLinkIdleSurface(pool, s);
+    }
+
+    if (pool->stats.memory_budget)
+        va_PoolEvictSurfaces(pool, pool->stats.memory_budget, 0);
+    pthread_mutex_unlock(&pool->lock);
+
+    return va_status;
+}
+
+VAStatus vaTrimSurfacePool(
+    VADisplay dpy,
+    VASurfacePool pool,
+    size_t max_idle_bytes
+)
+{
+    CHECK_DISPLAY(dpy);
+    if (!pool || pool->dpy != dpy)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    pthread_mutex_lock(&pool->lock);
+    va_PoolEvictSurfaces(pool, max_idle_bytes, 1);
+    pthread_mutex_unlock(&pool->lock);
+
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaQuerySurfacePoolStats(
+    VADisplay dpy,
+    VASurfacePool pool,
+    VASurfacePoolStats *stats      /* out */
+)
+{
+    CHECK_DISPLAY(dpy);
+    if (!pool || pool->dpy != dpy || !stats)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    pthread_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->lock);
+
+    return VA_STATUS_SUCCESS;
+}
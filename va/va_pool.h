@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_pool.h
+ * \brief Recycling of VA buffers and surfaces
+ *
+ * Creating parameter buffers and surfaces is a driver allocation, often
+ * with a kernel call behind it. The pools in this file keep the objects
+ * released by the application and hand them out again to the next
+ * request with the same characteristics, so that the steady state of a
+ * decode or encode loop does not allocate anything.
+ */
+
+#ifndef _VA_POOL_H_
+#define _VA_POOL_H_
+
+#include <stddef.h>
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_pool Buffer and surface pools
+ *
+ * @{
+ */
+
+/**
+ * \brief Creates a buffer, reusing an idle pooled one if possible.
+ *
+ * Same as vaCreateBuffer(), but the buffer is taken from the pool of the
+ * display when a buffer created for the same \c context and \c type with
+ * the same \c size and \c num_elements was released with
+ * vaReleasePooledBuffer(). Slice data buffers (VASliceDataBufferType and
+ * VAProtectedSliceDataBufferType) and packed header data buffers, whose
+ * payload size is described by other parameters, are rounded up to a
+ * power of two size class so that they can be reused for any payload of
+ * the same class.
+ *
+ * If \c data is not NULL, it is copied into the recycled buffer through
+ * vaMapBuffer().
+ *
+ * All the buffers of a context, idle or in use, are destroyed by
+ * vaDestroyContext(). Pooled buffers can also be destroyed individually
+ * with vaDestroyBuffer().
+ *
+ * The amount of memory kept by idle buffers is bounded by
+ * LIBVA_BUFFER_POOL_SIZE (in MiB, 64 by default); the least recently
+ * released buffers are destroyed first.
+ */
+VAStatus vaCreatePooledBuffer(
+    VADisplay dpy,
+    VAContextID context,
+    VABufferType type,
+    unsigned int size,
+    unsigned int num_elements,
+    const void *data,
+    VABufferID *buf_id     /* out */
+);
+
+/**
+ * \brief Returns a buffer obtained with vaCreatePooledBuffer() to the pool.
+ *
+ * The buffer must not be used by the application anymore, but it is
+ * not destroyed: the next vaCreatePooledBuffer() call with the same
+ * parameters returns it.
+ */
+VAStatus vaReleasePooledBuffer(
+    VADisplay dpy,
+    VABufferID buf_id
+);
+
+/**
+ * \brief Destroys idle pooled buffers until at most \c max_bytes remain.
+ *
+ * Intended for memory pressure notifications; \c max_bytes == 0 releases
+ * every idle buffer. Buffers in use are not affected.
+ */
+VAStatus vaTrimBufferPool(
+    VADisplay dpy,
+    size_t max_bytes
+);
+
+/** \brief Opaque handle of a surface pool. */
+typedef struct _VASurfacePool *VASurfacePool;
+
+/** \brief Usage statistics of a surface pool. */
+typedef struct _VASurfacePoolStats {
+    /** \brief Number of distinct (format, size, attributes) buckets. */
+    uint32_t num_buckets;
+    /** \brief Surfaces handed out and not released yet. */
+    uint32_t num_in_use;
+    /** \brief Surfaces kept for reuse. */
+    uint32_t num_idle;
+    /** \brief Estimated memory of the surfaces in use, in bytes. */
+    uint64_t bytes_in_use;
+    /** \brief Estimated memory of the idle surfaces, in bytes. */
+    uint64_t bytes_idle;
+    /** \brief Memory budget of the pool, 0 if unlimited. */
+    uint64_t memory_budget;
+    /** \brief Surfaces created with vaCreateSurfaces(). */
+    uint64_t num_created;
+    /** \brief Requests served with an idle surface. */
+    uint64_t num_reused;
+    /** \brief Idle surfaces destroyed to stay within the budget. */
+    uint64_t num_evicted;
+
+    /** \brief Reserved bytes for future use, must be zero */
+    uint32_t va_reserved[VA_PADDING_MEDIUM];
+} VASurfacePoolStats;
+
+/**
+ * \brief Creates a surface pool.
+ *
+ * A surface pool sits on top of vaCreateSurfaces(). Surfaces are grouped
+ * in buckets by render target format, size and surface attributes. They
+ * are reference counted while in use and kept on a least recently used
+ * list once released, so that going back to a recently used resolution
+ * does not allocate anything. Idle surfaces are destroyed when the
+ * estimated memory of the pool goes over \c memory_budget bytes
+ * (0 means no limit).
+ *
+ * Pooled surfaces must be released with vaReleasePoolSurfaces(), not
+ * destroyed with vaDestroySurfaces(). Surfaces importing external memory
+ * (VASurfaceAttribExternalBufferDescriptor) cannot be pooled.
+ */
+VAStatus vaCreateSurfacePool(
+    VADisplay dpy,
+    size_t memory_budget,
+    VASurfacePool *pool        /* out */
+);
+
+/**
+ * \brief Destroys a surface pool and all its surfaces, in use or not.
+ */
+VAStatus vaDestroySurfacePool(
+    VADisplay dpy,
+    VASurfacePool pool
+);
+
+/**
+ * \brief Gets surfaces from the pool.
+ *
+ * Takes the arguments of vaCreateSurfaces(). Idle surfaces of the
+ * matching bucket are returned first, the missing ones are created. Each
+ * returned surface has a reference count of 1.
+ */
+VAStatus vaAcquirePoolSurfaces(
+    VADisplay dpy,
+    VASurfacePool pool,
+    unsigned int format,
+    unsigned int width,
+    unsigned int height,
+    VASurfaceID *surfaces,          /* out */
+    unsigned int num_surfaces,
+    VASurfaceAttrib *attrib_list,
+    unsigned int num_attribs
+);
+
+/**
+ * \brief Takes an additional reference on a pooled surface.
+ *
+ * For instance when a decoded picture is both displayed and kept as a
+ * reference frame.
+ */
+VAStatus vaAddRefPoolSurface(
+    VADisplay dpy,
+    VASurfacePool pool,
+    VASurfaceID surface
+);
+
+/**
+ * \brief Drops a reference on pooled surfaces.
+ *
+ * Surfaces whose reference count reaches 0 become idle and may be
+ * returned by a later vaAcquirePoolSurfaces() call or destroyed to
+ * honour the memory budget.
+ */
+VAStatus vaReleasePoolSurfaces(
+    VADisplay dpy,
+    VASurfacePool pool,
+    VASurfaceID *surfaces,
+    unsigned int num_surfaces
+);
+
+/**
+ * \brief Destroys idle surfaces until at most \c max_idle_bytes remain.
+ */
+VAStatus vaTrimSurfacePool(
+    VADisplay dpy,
+    VASurfacePool pool,
+    size_t max_idle_bytes
+);
+
+/**
+ * \brief Returns the usage statistics of the pool.
+ */
+VAStatus vaQuerySurfacePoolStats(
+    VADisplay dpy,
+    VASurfacePool pool,
+    VASurfacePoolStats *stats      /* out */
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_POOL_H_ */
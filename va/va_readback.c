@@ -0,0 +1,628 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE 1
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_drmcommon.h"
+#include "va_convert.h"
+#include "va_readback.h"
+#include "va_cpu.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * Streaming loads only bypass the cache for write-combined memory, so the
+ * data is first gathered into a small bounce buffer that stays in L1, and
+ * then copied into the destination with regular stores. Mixing the
+ * uncached loads with stores to the destination would otherwise evict
+ * the WC fill buffers on every access.
+ */
+#define VA_BOUNCE_SIZE          4096
+/* Y-tiled surfaces exposed through a linear mapping have 32-line tiles */
+#define VA_TILE_ROWS            32
+
+typedef void (*va_stream_func)(uint8_t *dst, const uint8_t *src, size_t size);
+
+static void stream_copy_c(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    memcpy(dst, src, size);
+}
+
+#if defined(VA_CPU_X86)
+VA_TARGET("sse4.1")
+static void stream_copy_sse41(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    __m128i bounce[VA_BOUNCE_SIZE / sizeof(__m128i)];
+    size_t head = (16 - ((uintptr_t)src & 15)) & 15;
+
+    if (head > size)
+        head = size;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    _mm_mfence();
+    while (size >= 64) {
+        size_t chunk = size < VA_BOUNCE_SIZE ? size & ~(size_t)63 : VA_BOUNCE_SIZE;
+        size_t i;
+
+        for (i = 0; i < chunk / 16; i += 4) {
+            __m128i *s = (__m128i *)(src + 16 * i);
+            __m128i x0 = _mm_stream_load_si128(s + 0);
+            __m128i x1 = _mm_stream_load_si128(s + 1);
+            __m128i x2 = _mm_stream_load_si128(s + 2);
+            __m128i x3 = _mm_stream_load_si128(s + 3);
+            _mm_store_si128(&bounce[i + 0], x0);
+            _mm_store_si128(&bounce[i + 1], x1);
+            _mm_store_si128(&bounce[i + 2], x2);
+            _mm_store_si128(&bounce[i + 3], x3);
+        }
+        memcpy(dst, bounce, chunk);
+        dst += chunk;
+        src += chunk;
+        size -= chunk;
+    }
+    memcpy(dst, src, size);
+}
+
+VA_TARGET("avx2")
+static void stream_copy_avx2(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    __m256i bounce[VA_BOUNCE_SIZE / sizeof(__m256i)];
+    size_t head = (32 - ((uintptr_t)src & 31)) & 31;
+
+    if (head > size)
+        head = size;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    _mm_mfence();
+    while (size >= 128) {
+        size_t chunk = size < VA_BOUNCE_SIZE ? size & ~(size_t)127 : VA_BOUNCE_SIZE;
+        size_t i;
+
+        for (i = 0; i < chunk / 32; i += 4) {
+            __m256i *s = (__m256i *)(src + 32 * i);
+            __m256i y0 = _mm256_stream_load_si256(s + 0);
+            __m256i y1 = _mm256_stream_load_si256(s + 1);
+            __m256i y2 = _mm256_stream_load_si256(s + 2);
+            __m256i y3 = _mm256_stream_load_si256(s + 3);
+            _mm256_store_si256(&bounce[i + 0], y0);
+            _mm256_store_si256(&bounce[i + 1], y1);
+            _mm256_store_si256(&bounce[i + 2], y2);
+            _mm256_store_si256(&bounce[i + 3], y3);
+        }
+        memcpy(dst, bounce, chunk);
+        dst += chunk;
+        src += chunk;
+        size -= chunk;
+    }
+    memcpy(dst, src, size);
+}
+#endif
+
+static va_stream_func va_GetStreamCopy(void)
+{
+#if defined(VA_CPU_X86)
+    unsigned int cpu = va_CpuFeatures();
+
+    if (cpu & VA_CPU_FLAG_AVX2)
+        return stream_copy_avx2;
+    if (cpu & VA_CPU_FLAG_SSE41)
+        return stream_copy_sse41;
+#endif
+    return stream_copy_c;
+}
+
+void vaStreamCopy(void *dst, const void *src, size_t size)
+{
+    va_GetStreamCopy()((uint8_t *)dst, (const uint8_t *)src, size);
+}
+
+void vaStreamCopy2D(
+    void *dst,
+    size_t dst_pitch,
+    const void *src,
+    size_t src_pitch,
+    size_t row_bytes,
+    unsigned int rows
+)
+{
+    va_stream_func stream_copy = va_GetStreamCopy();
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+    unsigned int batch, y, i;
+
+    if (rows == 0 || row_bytes == 0)
+        return;
+
+    /* contiguous planes are a single sequential read */
+    if (src_pitch == row_bytes && dst_pitch == row_bytes) {
+        stream_copy(d, s, row_bytes * rows);
+        return;
+    }
+
+    /*
+     * When the rows are narrow compared to the pitch, read whole batches of
+     * rows (including the padding) in one sequential stream, so that the
+     * loads walk the mapping linearly, and scatter them afterwards.
+     */
+    batch = src_pitch <= VA_BOUNCE_SIZE ? VA_BOUNCE_SIZE / src_pitch : 0;
+    if (batch >= VA_TILE_ROWS)
+        batch -= batch % VA_TILE_ROWS;
+
+    if (batch > 1 && stream_copy != stream_copy_c) {
+        uint8_t bounce[VA_BOUNCE_SIZE];
+
+        for (y = 0; y < rows; y += batch) {
+            unsigned int n = rows - y < batch ? rows - y : batch;
+
+            stream_copy(bounce, s + y * src_pitch, (n - 1) * src_pitch + row_bytes);
+            for (i = 0; i < n; i++)
+                memcpy(d + (y + i) * dst_pitch, bounce + i * src_pitch, row_bytes);
+        }
+        return;
+    }
+
+    for (y = 0; y < rows; y++)
+        stream_copy(d + y * dst_pitch, s + y * src_pitch, row_bytes);
+}
+
+VAStatus vaDownloadSurface(
+    VADisplay dpy,
+    VASurfaceID surface,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+)
+{
+    VAStatus va_status;
+    VAImage image;
+
+    CHECK_DISPLAY(dpy);
+    if (!dst_image || !dst_data)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    va_status = vaSyncSurface(dpy, surface);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    va_status = vaDeriveImage(dpy, surface, &image);
+    if (va_status != VA_STATUS_SUCCESS) {
+        /* indirect path: let the driver copy into an image of the wanted format */
+        VAImageFormat format;
+
+        memset(&format, 0, sizeof(format));
+        format.fourcc = dst_image->format.fourcc;
+        format.byte_order = VA_LSB_FIRST;
+        format.bits_per_pixel = dst_image->format.bits_per_pixel;
+
+        va_status = vaCreateImage(dpy, &format, dst_image->width, dst_image->height, &image);
+        if (va_status != VA_STATUS_SUCCESS)
+            return va_status;
+
+        va_status = vaGetImage(dpy, surface, 0, 0, dst_image->width, dst_image->height,
+                               image.image_id);
+        if (va_status != VA_STATUS_SUCCESS) {
+            vaDestroyImage(dpy, image.image_id);
+            return va_status;
+        }
+    }
+
+    va_status = vaGetImageData(dpy, &image, dst_image, dst_data, flags);
+    vaDestroyImage(dpy, image.image_id);
+
+    return va_status;
+}
+
+VAStatus vaUploadSurface(
+    VADisplay dpy,
+    VASurfaceID surface,
+    const VAImage *src_image,
+    const void *src_data,
+    uint32_t flags
+)
+{
+    VAStatus va_status;
+    VAImage image;
+    VAImageFormat format;
+
+    CHECK_DISPLAY(dpy);
+    if (!src_image || !src_data)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    va_status = vaSyncSurface(dpy, surface);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    va_status = vaDeriveImage(dpy, surface, &image);
+    if (va_status == VA_STATUS_SUCCESS) {
+        va_status = vaPutImageData(dpy, src_image, src_data, &image, flags);
+        vaDestroyImage(dpy, image.image_id);
+        return va_status;
+    }
+
+    /* indirect path: fill an image of the source format and let the driver copy it */
+    memset(&format, 0, sizeof(format));
+    format.fourcc = src_image->format.fourcc;
+    format.byte_order = VA_LSB_FIRST;
+    format.bits_per_pixel = src_image->format.bits_per_pixel;
+
+    va_status = vaCreateImage(dpy, &format, src_image->width, src_image->height, &image);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    va_status = vaPutImageData(dpy, src_image, src_data, &image, flags);
+    if (va_status == VA_STATUS_SUCCESS)
+        va_status = vaPutImage(dpy, surface, image.image_id,
+                               0, 0, src_image->width, src_image->height,
+                               0, 0, src_image->width, src_image->height);
+    vaDestroyImage(dpy, image.image_id);
+
+    return va_status;
+}
+
+/* small VPP surfaces kept per display for the scaled downloads */
+#define VA_READBACK_NUM_SURFACES 4
+
+struct va_readback_surface {
+    VASurfaceID surface;
+    unsigned int width;
+    unsigned int height;
+    uint32_t fourcc;
+    unsigned int last_use;
+    int busy;                   /* reserved by a download in progress */
+};
+
+struct va_readback_context {
+    pthread_mutex_t lock;
+    int vpp_state;              /* 0: not tried yet, 1: available, -1: unavailable */
+    VAConfigID config;
+    VAContextID context;
+    unsigned int tick;
+    struct va_readback_surface surfaces[VA_READBACK_NUM_SURFACES];
+};
+
+static pthread_mutex_t va_readback_init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static struct va_readback_context *va_ReadbackGetContext(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_readback_context *rc;
+    unsigned int i;
+
+    pthread_mutex_lock(&va_readback_init_lock);
+    rc = pDisplayContext->vareadback;
+    if (!rc) {
+        rc = calloc(1, sizeof(*rc));
+        if (rc) {
+            pthread_mutex_init(&rc->lock, NULL);
+            rc->config = VA_INVALID_ID;
+            rc->context = VA_INVALID_ID;
+            for (i = 0; i < VA_READBACK_NUM_SURFACES; i++)
+                rc->surfaces[i].surface = VA_INVALID_SURFACE;
+            pDisplayContext->vareadback = rc;
+        }
+    }
+    pthread_mutex_unlock(&va_readback_init_lock);
+
+    return rc;
+}
+
+void va_ReadbackEnd(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_readback_context *rc = pDisplayContext->vareadback;
+    unsigned int i;
+
+    if (!rc)
+        return;
+
+    for (i = 0; i < VA_READBACK_NUM_SURFACES; i++) {
+        if (rc->surfaces[i].surface != VA_INVALID_SURFACE)
+            vaDestroySurfaces(dpy, &rc->surfaces[i].surface, 1);
+    }
+    if (rc->context != VA_INVALID_ID)
+        vaDestroyContext(dpy, rc->context);
+    if (rc->config != VA_INVALID_ID)
+        vaDestroyConfig(dpy, rc->config);
+
+    pthread_mutex_destroy(&rc->lock);
+    free(rc);
+    pDisplayContext->vareadback = NULL;
+}
+
+/* reserve a surface of the given size, must be called with rc->lock held */
+static struct va_readback_surface *va_ReadbackGetSurface(VADisplay dpy, struct va_readback_context *rc,
+                                                         unsigned int width, unsigned int height,
+                                                         uint32_t fourcc)
+{
+    struct va_readback_surface *slot = NULL;
+    VASurfaceAttrib attrib;
+    unsigned int i;
+
+    rc->tick++;
+    for (i = 0; i < VA_READBACK_NUM_SURFACES; i++) {
+        struct va_readback_surface *s = &rc->surfaces[i];
+
+        if (s->busy)
+            continue;
+        if (s->surface != VA_INVALID_SURFACE && s->width == width &&
+            s->height == height && s->fourcc == fourcc) {
+            s->last_use = rc->tick;
+            s->busy = 1;
+            return s;
+        }
+        if (!slot || s->surface == VA_INVALID_SURFACE ||
+            (slot->surface != VA_INVALID_SURFACE && s->last_use < slot->last_use))
+            slot = s;
+    }
+    /* all of them in use by concurrent downloads */
+    if (!slot)
+        return NULL;
+
+    /* replace the least recently used surface */
+    if (slot->surface != VA_INVALID_SURFACE) {
+        vaDestroySurfaces(dpy, &slot->surface, 1);
+        slot->surface = VA_INVALID_SURFACE;
+    }
+
+    memset(&attrib, 0, sizeof(attrib));
+    attrib.type = VASurfaceAttribPixelFormat;
+    attrib.flags = VA_SURFACE_ATTRIB_SETTABLE;
+    attrib.value.type = VAGenericValueTypeInteger;
+    attrib.value.value.i = fourcc;
+    if (vaCreateSurfaces(dpy, va_ConvertRTFormat(fourcc), width, height,
+                         &slot->surface, 1, &attrib, 1) != VA_STATUS_SUCCESS) {
+        /* any format is fine, vaDownloadSurface() converts */
+        if (vaCreateSurfaces(dpy, VA_RT_FORMAT_YUV420, width, height,
+                             &slot->surface, 1, NULL, 0) != VA_STATUS_SUCCESS) {
+            slot->surface = VA_INVALID_SURFACE;
+            return NULL;
+        }
+    }
+    slot->width = width;
+    slot->height = height;
+    slot->fourcc = fourcc;
+    slot->last_use = rc->tick;
+    slot->busy = 1;
+
+    return slot;
+}
+
+/* must be called with rc->lock held */
+static int va_ReadbackInitVpp(VADisplay dpy, struct va_readback_context *rc)
+{
+    if (rc->vpp_state)
+        return rc->vpp_state > 0;
+
+    rc->vpp_state = -1;
+    if (vaCreateConfig(dpy, VAProfileNone, VAEntrypointVideoProc, NULL, 0,
+                       &rc->config) != VA_STATUS_SUCCESS) {
+        rc->config = VA_INVALID_ID;
+        return 0;
+    }
+    if (vaCreateContext(dpy, rc->config, 0, 0, VA_PROGRESSIVE, NULL, 0,
+                        &rc->context) != VA_STATUS_SUCCESS) {
+        rc->context = VA_INVALID_ID;
+        vaDestroyConfig(dpy, rc->config);
+        rc->config = VA_INVALID_ID;
+        return 0;
+    }
+
+    rc->vpp_state = 1;
+    return 1;
+}
+
+static VAStatus va_DownloadSurfaceVpp(
+    VADisplay dpy,
+    VASurfaceID surface,
+    const VARectangle *src_rect,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+)
+{
+    struct va_readback_context *rc = va_ReadbackGetContext(dpy);
+    struct va_readback_surface *slot;
+    VAProcPipelineParameterBuffer pipeline;
+    VARectangle output_region;
+    VABufferID buffer;
+    VAStatus va_status;
+
+    if (!rc)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    /*
+     * the lock covers the reservation of the scaled surface and the
+     * submission on the shared VPP context, not the wait for the result
+     */
+    pthread_mutex_lock(&rc->lock);
+    if (!va_ReadbackInitVpp(dpy, rc)) {
+        pthread_mutex_unlock(&rc->lock);
+        return VA_STATUS_ERROR_UNSUPPORTED_ENTRYPOINT;
+    }
+
+    slot = va_ReadbackGetSurface(dpy, rc, dst_image->width, dst_image->height,
+                                 dst_image->format.fourcc);
+    if (!slot) {
+        pthread_mutex_unlock(&rc->lock);
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    }
+
+    output_region.x = 0;
+    output_region.y = 0;
+    output_region.width = dst_image->width;
+    output_region.height = dst_image->height;
+
+    memset(&pipeline, 0, sizeof(pipeline));
+    pipeline.surface = surface;
+    pipeline.surface_region = src_rect;
+    pipeline.output_region = &output_region;
+    pipeline.output_background_color = 0xff000000;
+    pipeline.filter_flags = (flags & VA_CONVERT_FLAG_SCALE_BILINEAR) ?
+                            VA_FILTER_SCALING_FAST : VA_FILTER_SCALING_HQ;
+
+    va_status = vaCreateBuffer(dpy, rc->context, VAProcPipelineParameterBufferType,
+                               sizeof(pipeline), 1, &pipeline, &buffer);
+    if (va_status == VA_STATUS_SUCCESS) {
+        va_status = vaBeginPicture(dpy, rc->context, slot->surface);
+        if (va_status == VA_STATUS_SUCCESS) {
+            va_status = vaRenderPicture(dpy, rc->context, &buffer, 1);
+            if (va_status == VA_STATUS_SUCCESS)
+                va_status = vaEndPicture(dpy, rc->context);
+            else
+                vaEndPicture(dpy, rc->context);
+        }
+        vaDestroyBuffer(dpy, buffer);
+    }
+    pthread_mutex_unlock(&rc->lock);
+
+    /* the scaled surface is small, a plain download of it is enough */
+    if (va_status == VA_STATUS_SUCCESS)
+        va_status = vaDownloadSurface(dpy, slot->surface, dst_image, dst_data,
+                                      flags & ~VA_CONVERT_FLAG_MULTITHREADED);
+
+    pthread_mutex_lock(&rc->lock);
+    slot->busy = 0;
+    pthread_mutex_unlock(&rc->lock);
+
+    return va_status;
+}
+
+/* size of a surface that cannot be derived, from its DRM PRIME export */
+static VAStatus va_ReadbackSurfaceSize(VADisplay dpy, VASurfaceID surface, VARectangle *rect)
+{
+    VADRMPRIMESurfaceDescriptor desc;
+    VAStatus va_status;
+    uint32_t i;
+
+    va_status = vaExportSurfaceHandle(dpy, surface, VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
+                                      VA_EXPORT_SURFACE_READ_ONLY | VA_EXPORT_SURFACE_SEPARATE_LAYERS,
+                                      &desc);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+    for (i = 0; i < desc.num_objects; i++)
+        close(desc.objects[i].fd);
+
+    rect->x = 0;
+    rect->y = 0;
+    rect->width = desc.width;
+    rect->height = desc.height;
+    return VA_STATUS_SUCCESS;
+}
+
+static VAStatus va_DownloadSurfaceCpu(
+    VADisplay dpy,
+    VASurfaceID surface,
+    const VARectangle *src_rect,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+)
+{
+    VAStatus va_status, unmap_status;
+    VARectangle rect;
+    VAImage image;
+    void *data = NULL;
+
+    va_status = vaSyncSurface(dpy, surface);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    va_status = vaDeriveImage(dpy, surface, &image);
+    if (va_status != VA_STATUS_SUCCESS) {
+        /* let the driver copy the region of interest only, or the whole surface */
+        VAImageFormat format;
+
+        if (!src_rect) {
+            if (va_ReadbackSurfaceSize(dpy, surface, &rect) != VA_STATUS_SUCCESS)
+                return va_status;
+            src_rect = &rect;
+        }
+
+        memset(&format, 0, sizeof(format));
+        format.fourcc = dst_image->format.fourcc;
+        format.byte_order = VA_LSB_FIRST;
+        format.bits_per_pixel = dst_image->format.bits_per_pixel;
+
+        va_status = vaCreateImage(dpy, &format, src_rect->width, src_rect->height, &image);
+        if (va_status != VA_STATUS_SUCCESS)
+            return va_status;
+
+        va_status = vaGetImage(dpy, surface, src_rect->x, src_rect->y,
+                               src_rect->width, src_rect->height, image.image_id);
+        if (va_status != VA_STATUS_SUCCESS) {
+            vaDestroyImage(dpy, image.image_id);
+            return va_status;
+        }
+
+        rect.x = 0;
+        rect.y = 0;
+        rect.width = src_rect->width;
+        rect.height = src_rect->height;
+        src_rect = &rect;
+    }
+
+    va_status = vaMapBuffer(dpy, image.buf, &data);
+    if (va_status == VA_STATUS_SUCCESS) {
+        va_status = vaScaleImageData(&image, data, src_rect, dst_image, dst_data,
+                                     flags | VA_CONVERT_FLAG_UNCACHED_SOURCE);
+        unmap_status = vaUnmapBuffer(dpy, image.buf);
+        if (va_status == VA_STATUS_SUCCESS)
+            va_status = unmap_status;
+    }
+    vaDestroyImage(dpy, image.image_id);
+
+    return va_status;
+}
+
+VAStatus vaDownloadSurfaceScaled(
+    VADisplay dpy,
+    VASurfaceID surface,
+    const VARectangle *src_rect,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+)
+{
+    CHECK_DISPLAY(dpy);
+    if (!dst_image || !dst_data)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    if (!(flags & VA_CONVERT_FLAG_SCALE_CPU) &&
+        va_DownloadSurfaceVpp(dpy, surface, src_rect, dst_image, dst_data, flags) == VA_STATUS_SUCCESS)
+        return VA_STATUS_SUCCESS;
+
+    return va_DownloadSurfaceCpu(dpy, surface, src_rect, dst_image, dst_data, flags);
+}
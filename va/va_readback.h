@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_readback.h
+ * \brief Fast CPU readback of mapped surfaces and images
+ *
+ * Buffers returned by vaMapBuffer() for images derived from surfaces, and
+ * the memory returned by vaLockSurface(), are usually uncached or
+ * write-combined mappings of video memory. Plain memcpy() from such a
+ * mapping is an order of magnitude slower than from normal memory.
+ *
+ * The helpers in this file use SSE4.1/AVX2 streaming loads (MOVNTDQA)
+ * through a small cache-resident bounce buffer to read from such
+ * mappings, and batch rows so that the loads stay sequential.  On CPUs
+ * without streaming loads they fall back to memcpy().
+ */
+
+#ifndef _VA_READBACK_H_
+#define _VA_READBACK_H_
+
+#include <stddef.h>
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_readback Fast readback helpers
+ *
+ * @{
+ */
+
+/**
+ * \brief Copies \c size bytes from an uncached/write-combined mapping.
+ *
+ * \c dst is expected to be normal (cached) memory. The buffers must not
+ * overlap.
+ */
+void vaStreamCopy(void *dst, const void *src, size_t size);
+
+/**
+ * \brief Copies \c rows rows of \c row_bytes bytes from a mapping.
+ *
+ * Same as vaStreamCopy() for pitched 2D data such as the planes of a
+ * VAImage. Rows are read in batches sized to the internal bounce buffer.
+ */
+void vaStreamCopy2D(
+    void *dst,
+    size_t dst_pitch,
+    const void *src,
+    size_t src_pitch,
+    size_t row_bytes,
+    unsigned int rows
+);
+
+/**
+ * \brief Downloads the content of a surface into application memory.
+ *
+ * Derives an image from \c surface (or, if the driver cannot derive one,
+ * creates an image and fills it with vaGetImage()), maps it and copies or
+ * converts its content into \c dst_data laid out as described by
+ * \c dst_image (see vaInitImageLayout()), using streaming loads for the
+ * plane copies. The surface is synchronized first.
+ *
+ * @param[in] dpy           the VA display
+ * @param[in] surface       the surface to read
+ * @param[in] dst_image     layout of the destination data
+ * @param[out] dst_data     base address of the destination data
+ * @param[in] flags         combination of VA_CONVERT_FLAG_xxx
+ */
+VAStatus vaDownloadSurface(
+    VADisplay dpy,
+    VASurfaceID surface,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+);
+
+/**
+ * \brief Downloads a cropped and scaled copy of a surface.
+ *
+ * Scales the \c src_rect region of \c surface (the whole surface if
+ * \c src_rect is NULL) to the size of \c dst_image. The scaling is first
+ * attempted with video processing (VAEntrypointVideoProc) into a small
+ * surface kept by libva for the display, which is then downloaded, so
+ * only the scaled pixels cross the bus. If video processing is not
+ * available or fails, the surface is mapped and scaled on the CPU with
+ * vaScaleImageData() while it is read. Surfaces that cannot be mapped
+ * are first copied with vaGetImage(), whose size for a NULL \c src_rect
+ * comes from a DRM PRIME export of the surface.
+ *
+ * @param[in] dpy           the VA display
+ * @param[in] surface       the surface to read
+ * @param[in] src_rect      region of the surface to scale, or NULL
+ * @param[in] dst_image     layout and size of the destination data
+ * @param[out] dst_data     base address of the destination data
+ * @param[in] flags         combination of VA_CONVERT_FLAG_xxx, notably
+ *                          VA_CONVERT_FLAG_SCALE_BILINEAR and
+ *                          VA_CONVERT_FLAG_SCALE_CPU
+ */
+VAStatus vaDownloadSurfaceScaled(
+    VADisplay dpy,
+    VASurfaceID surface,
+    const VARectangle *src_rect,
+    const VAImage *dst_image,
+    void *dst_data,
+    uint32_t flags
+);
+
+/**
+ * \brief Uploads application memory into a surface.
+ *
+ * The reverse of vaDownloadSurface(): derives an image from \c surface,
+ * maps it and copies or converts \c src_data, laid out as described by
+ * \c src_image, into it. If the driver cannot derive an image, an image
+ * of the source format is filled and copied with vaPutImage().
+ *
+ * With VA_CONVERT_FLAG_MULTITHREADED, both calls spread the planes in
+ * bands of lines over the libva worker threads.
+ *
+ * @param[in] dpy           the VA display
+ * @param[in] surface       the surface to write
+ * @param[in] src_image     layout of the source data
+ * @param[in] src_data      base address of the source data
+ * @param[in] flags         combination of VA_CONVERT_FLAG_xxx
+ */
+VAStatus vaUploadSurface(
+    VADisplay dpy,
+    VASurfaceID surface,
+    const VAImage *src_image,
+    const void *src_data,
+    uint32_t flags
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_READBACK_H_ */
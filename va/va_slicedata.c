@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_slicedata.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define VA_SLICEDATA_MIN_CAPACITY   4096
+
+struct _VASliceDataPacker {
+    VADisplay dpy;
+    VAContextID context;
+    size_t param_size;
+
+    /* slice parameters of the picture */
+    uint8_t *params;
+    unsigned int num_params;
+    unsigned int params_capacity;
+
+    /* mapped data buffer of the picture, VA_INVALID_ID if none yet */
+    VABufferID data_buf;
+    uint8_t *data;
+    uint32_t data_size;
+    size_t data_capacity;
+    /* capacity the previous picture ended with, to start with */
+    size_t capacity_hint;
+};
+
+static size_t va_SliceParamSize(VAProfile profile)
+{
+    switch (profile) {
+    case VAProfileMPEG2Simple:
+    case VAProfileMPEG2Main:
+        return sizeof(VASliceParameterBufferMPEG2);
+    case VAProfileMPEG4Simple:
+    case VAProfileMPEG4AdvancedSimple:
+    case VAProfileMPEG4Main:
+        return sizeof(VASliceParameterBufferMPEG4);
+    case VAProfileH264ConstrainedBaseline:
+    case VAProfileH264Main:
+    case VAProfileH264High:
+    case VAProfileH264MultiviewHigh:
+    case VAProfileH264StereoHigh:
+        return sizeof(VASliceParameterBufferH264);
+    case VAProfileVC1Simple:
+    case VAProfileVC1Main:
+    case VAProfileVC1Advanced:
+        return sizeof(VASliceParameterBufferVC1);
+    case VAProfileJPEGBaseline:
+        return sizeof(VASliceParameterBufferJPEGBaseline);
+    case VAProfileVP8Version0_3:
+        return sizeof(VASliceParameterBufferVP8);
+    case VAProfileHEVCMain:
+    case VAProfileHEVCMain10:
+        return sizeof(VASliceParameterBufferHEVC);
+    case VAProfileHEVCMain12:
+    case VAProfileHEVCMain422_10:
+    case VAProfileHEVCMain422_12:
+    case VAProfileHEVCMain444:
+    case VAProfileHEVCMain444_10:
+    case VAProfileHEVCMain444_12:
+    case VAProfileHEVCSccMain:
+    case VAProfileHEVCSccMain10:
+    case VAProfileHEVCSccMain444:
+    case VAProfileHEVCSccMain444_10:
+        return sizeof(VASliceParameterBufferHEVCExtension);
+    case VAProfileVP9Profile0:
+    case VAProfileVP9Profile1:
+    case VAProfileVP9Profile2:
+    case VAProfileVP9Profile3:
+        return sizeof(VASliceParameterBufferVP9);
+    case VAProfileAV1Profile0:
+    case VAProfileAV1Profile1:
+        return sizeof(VASliceParameterBufferAV1);
+    default:
+        return 0;
+    }
+}
+
+VAStatus vaCreateSliceDataPacker(
+    VADisplay dpy,
+    VAContextID context,
+    VAProfile profile,
+    VASliceDataPacker *packer
+)
+{
+    struct _VASliceDataPacker *p;
+    size_t param_size;
+
+    CHECK_DISPLAY(dpy);
+    if (!packer)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    param_size = va_SliceParamSize(profile);
+    if (!param_size)
+        return VA_STATUS_ERROR_UNSUPPORTED_PROFILE;
+
+    p = calloc(1, sizeof(*p));
+    if (!p)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    p->dpy = dpy;
+    p->context = context;
+    p->param_size = param_size;
+    p->data_buf = VA_INVALID_ID;
+
+    *packer = p;
+    return VA_STATUS_SUCCESS;
+}
+
+static void va_SliceDataDrop(struct _VASliceDataPacker *p)
+{
+    if (p->data_buf != VA_INVALID_ID) {
+        vaUnmapBuffer(p->dpy, p->data_buf);
+        vaDestroyBuffer(p->dpy, p->data_buf);
+    }
+    p->data_buf = VA_INVALID_ID;
+    p->data = NULL;
+    p->data_size = 0;
+    p->data_capacity = 0;
+    p->num_params = 0;
+}
+
+VAStatus vaDestroySliceDataPacker(VASliceDataPacker packer)
+{
+    struct _VASliceDataPacker *p = packer;
+
+    if (!p)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    va_SliceDataDrop(p);
+    free(p->params);
+    free(p);
+    return VA_STATUS_SUCCESS;
+}
+
+/* makes room for size more bytes, moving to a larger buffer if needed */
+static VAStatus va_SliceDataReserve(struct _VASliceDataPacker *p, uint32_t size)
+{
+    size_t needed = (size_t)p->data_size + size;
+    size_t capacity = VA_SLICEDATA_MIN_CAPACITY;
+    VABufferID buf;
+    VAStatus va_status;
+    void *ptr;
+
+    if (p->data_buf != VA_INVALID_ID && needed <= p->data_capacity)
+        return VA_STATUS_SUCCESS;
+
+    /* powers of two, the size classes of the pool */
+    while (capacity < 0x80000000U &&
+           (capacity < needed || capacity < p->capacity_hint || capacity < 2 * p->data_capacity))
+        capacity <<= 1;
+    if (capacity < needed)
+        capacity = needed;
+
+    va_status = va_BufferPoolCreate(p->dpy, p->context, VASliceDataBufferType,
+                                    (unsigned int)capacity, 1, NULL, 1, &buf);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+    va_status = vaMapBuffer(p->dpy, buf, &ptr);
+    if (va_status != VA_STATUS_SUCCESS) {
+        vaDestroyBuffer(p->dpy, buf);
+        return va_status;
+    }
+
+    if (p->data_buf != VA_INVALID_ID) {
+        memcpy(ptr, p->data, p->data_size);
+        vaUnmapBuffer(p->dpy, p->data_buf);
+        vaDestroyBuffer(p->dpy, p->data_buf);
+    }
+    p->data_buf = buf;
+    p->data = ptr;
+    p->data_capacity = capacity;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaAppendSliceData(
+    VASliceDataPacker packer,
+    const void *data,
+    uint32_t size,
+    const void *slice_params,
+    unsigned int num_params
+)
+{
+    struct _VASliceDataPacker *p = packer;
+    const uint8_t *src = slice_params;
+    VAStatus va_status;
+    unsigned int i;
+
+    if (!p || (size && !data) || (num_params && !slice_params))
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (size > UINT32_MAX - p->data_size || num_params > UINT32_MAX / p->param_size - p->num_params)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    for (i = 0; i < num_params; i++) {
+        const VASliceParameterBufferBase *base = (const VASliceParameterBufferBase *)(src + i * p->param_size);
+
+        if (base->slice_data_size &&
+            (base->slice_data_offset > size || base->slice_data_size > size - base->slice_data_offset))
+            return VA_STATUS_ERROR_INVALID_PARAMETER;
+    }
+
+    if (p->num_params + num_params > p->params_capacity) {
+        unsigned int capacity = p->params_capacity ? p->params_capacity : 16;
+        uint8_t *params;
+
+        while (capacity < p->num_params + num_params)
+            capacity *= 2;
+        params = realloc(p->params, (size_t)capacity * p->param_size);
+        if (!params)
+            return VA_STATUS_ERROR_ALLOCATION_FAILED;
+        p->params = params;
+        p->params_capacity = capacity;
+    }
+
+    va_status = va_SliceDataReserve(p, size);
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+
+    memcpy(p->data + p->data_size, data, size);
+    for (i = 0; i < num_params; i++) {
+        uint8_t *dst = p->params + (size_t)(p->num_params + i) * p->param_size;
+        VASliceParameterBufferBase *base = (VASliceParameterBufferBase *)dst;
+
+        memcpy(dst, src + i * p->param_size, p->param_size);
+        if (!base->slice_data_size) {
+            base->slice_data_offset = 0;
+            base->slice_data_size = size;
+        }
+        base->slice_data_offset += p->data_size;
+        base->slice_data_flag = VA_SLICE_DATA_FLAG_ALL;
+    }
+    p->num_params += num_params;
+    p->data_size += size;
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus vaFinishSliceData(
+    VASliceDataPacker packer,
+    VABufferID *slice_param_buf,
+    VABufferID *slice_data_buf,
+    unsigned int *num_slices
+)
+{
+    struct _VASliceDataPacker *p = packer;
+    VAStatus va_status;
+    VABufferID buf;
+
+    if (!p || !slice_param_buf || !slice_data_buf || !num_slices)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+    if (!p->num_params || p->data_buf == VA_INVALID_ID)
+        return VA_STATUS_ERROR_INVALID_PARAMETER;
+
+    va_status = vaUnmapBuffer(p->dpy, p->data_buf);
+    if (va_status == VA_STATUS_SUCCESS)
+        va_status = va_BufferPoolCreate(p->dpy, p->context, VASliceParameterBufferType,
+                                        (unsigned int)p->param_size, p->num_params,
+                                        p->params, 1, &buf);
+    if (va_status != VA_STATUS_SUCCESS) {
+        /* the buffer is unmapped even if vaUnmapBuffer() failed */
+        vaDestroyBuffer(p->dpy, p->data_buf);
+        p->data_buf = VA_INVALID_ID;
+        va_SliceDataDrop(p);
+        return va_status;
+    }
+
+    *slice_param_buf = buf;
+    *slice_data_buf = p->data_buf;
+    *num_slices = p->num_params;
+
+    p->capacity_hint = p->data_capacity;
+    p->data_buf = VA_INVALID_ID;
+    va_SliceDataDrop(p);
+    return VA_STATUS_SUCCESS;
+}
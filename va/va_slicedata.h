@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file va_slicedata.h
+ * \brief Packing of the slices of a picture into one buffer
+ *
+ * Streams cut into many slices, such as low latency broadcast streams or
+ * JPEG images split at restart markers, lead to a slice data buffer and
+ * a slice parameter buffer per slice when done naively, and buffer
+ * creation and vaRenderPicture() then cost more than decoding. The
+ * packer in this file appends the payloads of all the slices of a picture
+ * to a single pooled VASliceDataBufferType buffer, which it maps once
+ * and writes to directly, and gathers their parameters in a single
+ * VASliceParameterBufferType buffer of as many elements, with
+ * slice_data_offset and slice_data_size pointing into the data buffer.
+ *
+ * Usage, for each picture:
+ * - vaAppendSliceData() for each slice, or each chunk of slices such as
+ *   an AV1 tile group;
+ * - vaFinishSliceData(), then vaRenderPicture() with the two buffers it
+ *   returns;
+ * - after vaEndPicture(), vaDestroyBuffer() on both, which returns them
+ *   to the buffer pool (see vaCreatePooledBuffer()) for the next
+ *   pictures.
+ */
+
+#ifndef _VA_SLICEDATA_H_
+#define _VA_SLICEDATA_H_
+
+#include <stddef.h>
+#include <va/va.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * \defgroup api_slicedata Slice data packing
+ *
+ * @{
+ */
+
+/** \brief Opaque slice data packer state. */
+typedef struct _VASliceDataPacker *VASliceDataPacker;
+
+/**
+ * \brief Creates a slice data packer for a decode context.
+ *
+ * The profile selects the slice parameter structure: VASliceParameterBufferH264,
+ * VASliceParameterBufferHEVC (VASliceParameterBufferHEVCExtension for the
+ * range extension and screen content profiles), VASliceParameterBufferMPEG2,
+ * VASliceParameterBufferMPEG4, VASliceParameterBufferVC1,
+ * VASliceParameterBufferJPEGBaseline, VASliceParameterBufferVP8,
+ * VASliceParameterBufferVP9 or VASliceParameterBufferAV1 (one per tile).
+ *
+ * @param[in] dpy       the VA display
+ * @param[in] context   the decode context the buffers are created for
+ * @param[in] profile   the profile of the context
+ * @param[out] packer   the packer
+ */
+VAStatus vaCreateSliceDataPacker(
+    VADisplay dpy,
+    VAContextID context,
+    VAProfile profile,
+    VASliceDataPacker *packer               /* out */
+);
+
+/**
+ * \brief Destroys a packer, with the buffer of a picture in progress if
+ * any. Buffers returned by vaFinishSliceData() are not affected.
+ */
+VAStatus vaDestroySliceDataPacker(VASliceDataPacker packer);
+
+/**
+ * \brief Appends slice data and the parameters of its slices.
+ *
+ * Copies the \c size bytes at \c data to the data buffer of the picture,
+ * and the \c num_params slice parameters at \c slice_params (an array of
+ * the structure of the profile) to its parameter buffer. On input, the
+ * slice_data_offset and slice_data_size of each element locate its slice
+ * within \c data; a slice_data_size of 0 stands for all of \c data. They
+ * are rebased on the data buffer, and slice_data_flag is set to
+ * VA_SLICE_DATA_FLAG_ALL. The other fields, bit offsets in the slice
+ * included, are copied as they are.
+ *
+ * @return VA_STATUS_ERROR_INVALID_PARAMETER if a slice does not lie
+ *         within \c data or the picture data goes over 4GB
+ */
+VAStatus vaAppendSliceData(
+    VASliceDataPacker packer,
+    const void *data,
+    uint32_t size,
+    const void *slice_params,
+    unsigned int num_params
+);
+
+/**
+ * \brief Completes the slices of a picture.
+ *
+ * Returns the slice parameter buffer, of \c num_slices elements, and the
+ * slice data buffer holding all the slices appended since the previous
+ * call. The application renders them, and destroys them with
+ * vaDestroyBuffer() once vaEndPicture() has been called; the data buffer
+ * may be larger than the slices. The packer is then ready for the next
+ * picture.
+ *
+ * @return VA_STATUS_ERROR_INVALID_PARAMETER if no slice was appended
+ */
+VAStatus vaFinishSliceData(
+    VASliceDataPacker packer,
+    VABufferID *slice_param_buf,            /* out */
+    VABufferID *slice_data_buf,             /* out */
+    unsigned int *num_slices                /* out */
+);
+
+/**@}*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _VA_SLICEDATA_H_ */
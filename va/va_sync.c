@@ -0,0 +1,652 @@
+/*
+ * Copyright (c) 2024 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Generic fallback of vaSyncObjects() for drivers without a native
+ * multi-object wait: the objects are polled one at a time through the
+ * driver's single-object synchronization with short, growing timeouts.
+ *
+ * The same emulation backs the completion fds of vaGetCompletionFd() and
+ * the callbacks of vaRegisterCompletionCallback(): one thread per display
+ * waits for any of the registered objects, signals an eventfd (a pipe
+ * where eventfd is not available) for each completion or queues its
+ * callback to a second thread, which runs them in completion order.
+ */
+
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_fool.h"
+#include "va_copy.h"
+#include "va_thread.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+/* bounds of the per-object timeout while waiting for any object */
+#define VA_SYNC_MIN_SLICE_NS    50000ULL
+#define VA_SYNC_MAX_SLICE_NS    2000000ULL
+/* sleep between vaQuerySurfaceStatus() polls */
+#define VA_SYNC_POLL_NS         500000ULL
+/* the completion thread rescans the registered objects at least this often */
+#define VA_SYNC_RESCAN_NS       5000000ULL
+
+struct va_sync_wait {
+    VASyncObject object;
+    VADisplay dpy;
+    int signal_fd;                  /* written once the object completed, or -1 */
+    VACompletionCallback callback;  /* called once the object completed, or NULL */
+    void *user_data;
+    int forgotten;                  /* the object is being destroyed, see va_SyncForget() */
+    struct va_sync_wait *next;
+};
+
+struct va_sync_context {
+    VADisplay dpy;
+    struct va_thread_pool *thread;      /* single worker running va_SyncThread() */
+    struct va_thread_pool *dispatch;    /* single worker running the callbacks in order */
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct va_sync_wait *waits;
+    unsigned int num_waits;
+    int scanning;                       /* the thread waits on a snapshot of the waits */
+    unsigned int scan_serial;           /* incremented at the end of every scan */
+    int quit;
+};
+
+static pthread_mutex_t va_sync_init_lock = PTHREAD_MUTEX_INITIALIZER;
+
+#define DPY2SYNCCTX(dpy) \
+    ((struct va_sync_context *)__atomic_load_n(&((VADisplayContextP)dpy)->vasync, __ATOMIC_ACQUIRE))
+
+static uint64_t va_SyncNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t va_SyncRemaining(uint64_t deadline)
+{
+    uint64_t now = va_SyncNow();
+
+    return now < deadline ? deadline - now : 0;
+}
+
+static void va_SyncSleep(uint64_t ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    nanosleep(&ts, NULL);
+}
+
+/* vaSyncSurface2() emulation for drivers only providing vaQuerySurfaceStatus() */
+static VAStatus va_SyncSurfacePoll(VADriverContextP ctx, VASurfaceID surface, uint64_t timeout_ns)
+{
+    uint64_t deadline = va_SyncNow() + timeout_ns;
+    VASurfaceStatus status;
+    VAStatus va_status;
+
+    if (timeout_ns == VA_TIMEOUT_INFINITE)
+        return ctx->vtable->vaSyncSurface(ctx, surface);
+
+    for (;;) {
+        uint64_t remaining;
+
+        va_status = ctx->vtable->vaQuerySurfaceStatus(ctx, surface, &status);
+        if (va_status != VA_STATUS_SUCCESS)
+            return va_status;
+        if (!(status & VASurfaceRendering))
+            return VA_STATUS_SUCCESS;
+
+        remaining = va_SyncRemaining(deadline);
+        if (remaining == 0)
+            return VA_STATUS_ERROR_TIMEDOUT;
+        va_SyncSleep(remaining < VA_SYNC_POLL_NS ? remaining : VA_SYNC_POLL_NS);
+    }
+}
+
+/* same as vaSyncSurface2()/vaSyncBuffer() without the per-call tracing */
+static VAStatus va_SyncObject(VADisplay dpy, const VASyncObject *object, uint64_t timeout_ns)
+{
+    VADriverContextP ctx = CTX(dpy);
+    VAStatus va_status;
+
+    if (object->obj_type == VASyncObjectSurface) {
+        va_status = va_CopySync(dpy, VACopyObjectSurface, object->object.surface_id, timeout_ns, NULL);
+        if (va_status != VA_STATUS_SUCCESS)
+            return va_status;
+        if (ctx->vtable->vaSyncSurface2) {
+            va_status = ctx->vtable->vaSyncSurface2(ctx, object->object.surface_id, timeout_ns);
+            if (va_status != VA_STATUS_ERROR_UNIMPLEMENTED)
+                return va_status;
+        }
+        return va_SyncSurfacePoll(ctx, object->object.surface_id, timeout_ns);
+    }
+
+    if (object->obj_type == VASyncObjectBuffer) {
+        int copied;
+
+        va_status = va_CopySync(dpy, VACopyObjectBuffer, object->object.buffer_id, timeout_ns, &copied);
+        if (va_status != VA_STATUS_SUCCESS)
+            return va_status;
+        if (ctx->vtable->vaSyncBuffer)
+            return ctx->vtable->vaSyncBuffer(ctx, object->object.buffer_id, timeout_ns);
+        return copied ? VA_STATUS_SUCCESS : VA_STATUS_ERROR_UNIMPLEMENTED;
+    }
+
+    return VA_STATUS_ERROR_INVALID_PARAMETER;
+}
+
+/* whether a software copy of one of the objects is in flight, the driver cannot wait for it */
+int va_SyncCopyPending(VADisplay dpy, const VASyncObject *objects, uint32_t num_objects)
+{
+    uint32_t i;
+
+    for (i = 0; i < num_objects; i++) {
+        if (objects[i].obj_type == VASyncObjectSurface ?
+            va_CopyIsPending(dpy, VACopyObjectSurface, objects[i].object.surface_id) :
+            va_CopyIsPending(dpy, VACopyObjectBuffer, objects[i].object.buffer_id))
+            return 1;
+    }
+
+    return 0;
+}
+
+/* wait for the object with the given timeout, return 1 once it is no longer pending */
+static int va_SyncUpdate(VADisplay dpy, VASyncObject *object, uint64_t timeout_ns)
+{
+    object->status = va_SyncObject(dpy, object, timeout_ns);
+    return object->status != VA_STATUS_ERROR_TIMEDOUT;
+}
+
+/* the synchronization failed, e.g. unimplemented for the object, which did not complete */
+static int va_SyncFailed(const VASyncObject *object)
+{
+    return object->status != VA_STATUS_SUCCESS && object->status != VA_STATUS_ERROR_TIMEDOUT;
+}
+
+VAStatus va_SyncObjects(
+    VADisplay dpy,
+    VASyncObject *objects,
+    uint32_t num_objects,
+    uint32_t flags,
+    uint64_t timeout_ns,
+    uint32_t *num_completed
+)
+{
+    uint64_t deadline, slice = VA_SYNC_MIN_SLICE_NS;
+    uint32_t i, settled = 0, completed = 0;
+    int wait_any = !!(flags & VA_SYNC_WAIT_ANY), failed = 0;
+    VAStatus va_status = VA_STATUS_SUCCESS;
+
+    deadline = va_SyncNow();
+    deadline = timeout_ns > UINT64_MAX - deadline ? UINT64_MAX : deadline + timeout_ns;
+
+    /* first pass only polls, any object already done satisfies VA_SYNC_WAIT_ANY */
+    for (i = 0; i < num_objects; i++) {
+        settled += va_SyncUpdate(dpy, &objects[i], 0);
+        failed |= va_SyncFailed(&objects[i]);
+    }
+
+    if (!wait_any) {
+        /*
+         * every object has to complete anyway, so wait for them in turn
+         * with whatever is left of the timeout
+         */
+        for (i = 0; i < num_objects && settled < num_objects && !failed; i++) {
+            uint64_t remaining;
+
+            if (objects[i].status != VA_STATUS_ERROR_TIMEDOUT)
+                continue;
+            remaining = timeout_ns == VA_TIMEOUT_INFINITE ?
+                        VA_TIMEOUT_INFINITE : va_SyncRemaining(deadline);
+            if (remaining == 0)
+                break;
+            settled += va_SyncUpdate(dpy, &objects[i], remaining);
+            failed = va_SyncFailed(&objects[i]);
+        }
+    } else {
+        /*
+         * round-robin over the pending objects with short timeouts, growing
+         * them so that long waits do not turn into busy loops
+         */
+        while (settled == 0 && num_objects > 0) {
+            for (i = 0; i < num_objects && settled == 0; i++) {
+                uint64_t remaining = va_SyncRemaining(deadline);
+
+                if (remaining == 0)
+                    break;
+                if (objects[i].status != VA_STATUS_ERROR_TIMEDOUT)
+                    continue;
+                settled += va_SyncUpdate(dpy, &objects[i], remaining < slice ? remaining : slice);
+            }
+            if (va_SyncRemaining(deadline) == 0)
+                break;
+            if (slice < VA_SYNC_MAX_SLICE_NS)
+                slice *= 2;
+        }
+    }
+
+    /* a failed object ends the wait, it cannot complete */
+    for (i = 0; i < num_objects; i++) {
+        if (objects[i].status == VA_STATUS_SUCCESS)
+            completed++;
+        else if (va_SyncFailed(&objects[i]) && va_status == VA_STATUS_SUCCESS)
+            va_status = objects[i].status;
+    }
+
+    if (num_completed)
+        *num_completed = completed;
+
+    if (va_status != VA_STATUS_SUCCESS)
+        return va_status;
+    if (wait_any ? completed > 0 : completed == num_objects)
+        return VA_STATUS_SUCCESS;
+    return VA_STATUS_ERROR_TIMEDOUT;
+}
+
+/* create the descriptor pair: *user_fd goes to the application, *signal_fd stays with libva */
+static int va_SyncCreateFd(int *user_fd, int *signal_fd)
+{
+#if defined(__linux__)
+    int fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+
+    if (fd < 0)
+        return -1;
+    /* separate descriptors on the same eventfd, the caller may close its own any time */
+    *user_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (*user_fd < 0) {
+        close(fd);
+        return -1;
+    }
+    *signal_fd = fd;
+#else
+    int fds[2];
+
+    if (pipe(fds) < 0)
+        return -1;
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    *user_fd = fds[0];
+    *signal_fd = fds[1];
+#endif
+    return 0;
+}
+
+static void va_SyncSignalFd(int signal_fd)
+{
+    uint64_t one = 1;
+    ssize_t ret;
+
+    do {
+        ret = write(signal_fd, &one, sizeof(one));
+    } while (ret < 0 && errno == EINTR);
+    close(signal_fd);
+}
+
+static void va_SyncDispatch(void *arg)
+{
+    struct va_sync_wait *wait = arg;
+
+    wait->callback(wait->dpy, wait->object.obj_type,
+                   wait->object.obj_type == VASyncObjectSurface ?
+                   wait->object.object.surface_id : wait->object.object.buffer_id,
+                   wait->object.status, wait->user_data);
+    free(wait);
+}
+
+/* signal the fd or queue the callback of a completed wait, takes ownership of it */
+static void va_SyncComplete(struct va_sync_context *sc, struct va_sync_wait *wait, VAStatus status)
+{
+    wait->object.status = status;
+    if (!wait->callback) {
+        va_SyncSignalFd(wait->signal_fd);
+        free(wait);
+    } else if (va_ThreadPoolSubmit(sc->dispatch, va_SyncDispatch, wait) != 0) {
+        va_SyncDispatch(wait);
+    }
+}
+
+static void va_SyncThread(void *arg)
+{
+    struct va_sync_context *sc = arg;
+    struct va_sync_wait **snapshot = NULL;
+    VASyncObject *objects = NULL;
+    unsigned int capacity = 0;
+
+    pthread_mutex_lock(&sc->lock);
+    while (!sc->quit) {
+        struct va_sync_wait *wait, **prev, *done = NULL, **done_tail = &done;
+        unsigned int i, n = 0;
+        VAStatus va_status;
+
+        if (!sc->waits) {
+            pthread_cond_wait(&sc->cond, &sc->lock);
+            continue;
+        }
+
+        if (sc->num_waits > capacity) {
+            unsigned int new_capacity = sc->num_waits * 2;
+            void *p;
+
+            p = realloc(snapshot, new_capacity * sizeof(*snapshot));
+            if (p)
+                snapshot = p;
+            p = p ? realloc(objects, new_capacity * sizeof(*objects)) : NULL;
+            if (!p) {
+                /* retry later rather than dropping registrations */
+                struct timespec deadline;
+
+                va_DeadlineFromTimeout(&deadline, VA_SYNC_RESCAN_NS);
+                pthread_cond_timedwait(&sc->cond, &sc->lock, &deadline);
+                continue;
+            }
+            objects = p;
+            capacity = new_capacity;
+        }
+        for (wait = sc->waits; wait; wait = wait->next) {
+            if (wait->forgotten)
+                continue;
+            snapshot[n] = wait;
+            objects[n++] = wait->object;
+        }
+        if (n == 0) {
+            pthread_cond_wait(&sc->cond, &sc->lock);
+            continue;
+        }
+        sc->scanning = 1;
+        pthread_mutex_unlock(&sc->lock);
+
+        /* bounded, so that registrations made meanwhile get picked up */
+        va_status = va_SyncObjects(sc->dpy, objects, n, VA_SYNC_WAIT_ANY, VA_SYNC_RESCAN_NS, NULL);
+
+        pthread_mutex_lock(&sc->lock);
+        sc->scanning = 0;
+        sc->scan_serial++;
+        pthread_cond_broadcast(&sc->cond);
+        if (va_status == VA_STATUS_ERROR_TIMEDOUT)
+            continue;
+        /*
+         * completed and failed objects alike, the failure is reported.
+         * va_SyncForget() waits for the end of the scan before removing
+         * entries, the snapshotted ones are all still listed.
+         */
+        for (i = 0; i < n; i++) {
+            if (objects[i].status == VA_STATUS_ERROR_TIMEDOUT)
+                continue;
+            for (prev = &sc->waits; *prev != snapshot[i]; prev = &(*prev)->next)
+                ;
+            *prev = snapshot[i]->next;
+            __atomic_store_n(&sc->num_waits, sc->num_waits - 1, __ATOMIC_RELAXED);
+            snapshot[i]->object.status = objects[i].status;
+            snapshot[i]->next = NULL;
+            *done_tail = snapshot[i];
+            done_tail = &snapshot[i]->next;
+        }
+
+        /*
+         * complete them unlocked: a callback run inline when the dispatch
+         * queue is full may register another wait
+         */
+        pthread_mutex_unlock(&sc->lock);
+        while ((wait = done)) {
+            done = wait->next;
+            va_SyncComplete(sc, wait, wait->object.status);
+        }
+        pthread_mutex_lock(&sc->lock);
+    }
+    pthread_mutex_unlock(&sc->lock);
+
+    free(snapshot);
+    free(objects);
+}
+
+static struct va_sync_context *va_SyncGetContext(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_sync_context *sc = DPY2SYNCCTX(dpy);
+
+    if (sc)
+        return sc;
+
+    pthread_mutex_lock(&va_sync_init_lock);
+    sc = pDisplayContext->vasync;
+    if (!sc) {
+        sc = calloc(1, sizeof(*sc));
+        if (sc) {
+            sc->dpy = dpy;
+            pthread_mutex_init(&sc->lock, NULL);
+            pthread_cond_init(&sc->cond, NULL);
+            sc->thread = va_ThreadPoolCreate(1);
+            sc->dispatch = va_ThreadPoolCreate(1);
+            if (!sc->thread || !sc->dispatch ||
+                va_ThreadPoolSubmit(sc->thread, va_SyncThread, sc) != 0) {
+                if (sc->thread)
+                    va_ThreadPoolDestroy(sc->thread);
+                if (sc->dispatch)
+                    va_ThreadPoolDestroy(sc->dispatch);
+                pthread_cond_destroy(&sc->cond);
+                pthread_mutex_destroy(&sc->lock);
+                free(sc);
+                sc = NULL;
+            } else {
+                __atomic_store_n(&pDisplayContext->vasync, sc, __ATOMIC_RELEASE);
+            }
+        }
+    }
+    pthread_mutex_unlock(&va_sync_init_lock);
+
+    return sc;
+}
+
+/*
+ * register a wait for the object, completing it right away if possible.
+ * The driver waits cannot be bound to the operations pending at this
+ * point, the wait ends once the object is idle when polled, see va.h.
+ */
+static VAStatus va_SyncRegister(VADisplay dpy, VASyncObjectType obj_type, VAGenericID id,
+                                struct va_sync_wait *wait)
+{
+    struct va_sync_context *sc = va_SyncGetContext(dpy);
+
+    if (!sc)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+
+    wait->dpy = dpy;
+    wait->object.obj_type = obj_type;
+    if (obj_type == VASyncObjectSurface)
+        wait->object.object.surface_id = id;
+    else
+        wait->object.object.buffer_id = id;
+
+    /*
+     * nothing is submitted to the driver in fool mode, and objects already
+     * done do not need to go through the wait thread
+     */
+    if (va_fool_codec && va_FoolCheckContinuity(dpy)) {
+        va_SyncComplete(sc, wait, VA_STATUS_SUCCESS);
+        return VA_STATUS_SUCCESS;
+    }
+    if (va_SyncUpdate(dpy, &wait->object, 0)) {
+        /* the object cannot be waited for, e.g. a buffer the driver cannot sync */
+        if (va_SyncFailed(&wait->object))
+            return wait->object.status;
+        va_SyncComplete(sc, wait, wait->object.status);
+        return VA_STATUS_SUCCESS;
+    }
+
+    pthread_mutex_lock(&sc->lock);
+    wait->next = sc->waits;
+    sc->waits = wait;
+    __atomic_store_n(&sc->num_waits, sc->num_waits + 1, __ATOMIC_RELAXED);
+    /* va_SyncForget() may wait on the condition as well */
+    pthread_cond_broadcast(&sc->cond);
+    pthread_mutex_unlock(&sc->lock);
+
+    return VA_STATUS_SUCCESS;
+}
+
+VAStatus va_SyncGetCompletionFd(
+    VADisplay dpy,
+    VASyncObjectType obj_type,
+    VAGenericID id,
+    int *fd
+)
+{
+    struct va_sync_wait *wait = calloc(1, sizeof(*wait));
+    VAStatus va_status;
+
+    if (!wait)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    if (va_SyncCreateFd(fd, &wait->signal_fd) != 0) {
+        free(wait);
+        return VA_STATUS_ERROR_OPERATION_FAILED;
+    }
+
+    va_status = va_SyncRegister(dpy, obj_type, id, wait);
+    if (va_status != VA_STATUS_SUCCESS) {
+        close(wait->signal_fd);
+        close(*fd);
+        *fd = -1;
+        free(wait);
+    }
+    return va_status;
+}
+
+VAStatus va_SyncRegisterCallback(
+    VADisplay dpy,
+    VASyncObjectType obj_type,
+    VAGenericID id,
+    VACompletionCallback callback,
+    void *user_data
+)
+{
+    struct va_sync_wait *wait = calloc(1, sizeof(*wait));
+    VAStatus va_status;
+
+    if (!wait)
+        return VA_STATUS_ERROR_ALLOCATION_FAILED;
+    wait->signal_fd = -1;
+    wait->callback = callback;
+    wait->user_data = user_data;
+
+    va_status = va_SyncRegister(dpy, obj_type, id, wait);
+    if (va_status != VA_STATUS_SUCCESS)
+        free(wait);
+    return va_status;
+}
+
+/*
+ * complete the waits on an object being destroyed with an error, so that
+ * the driver is not asked about its ID any more, which may get reused
+ */
+void va_SyncForget(VADisplay dpy, VASyncObjectType obj_type, VAGenericID id)
+{
+    struct va_sync_context *sc = DPY2SYNCCTX(dpy);
+    struct va_sync_wait *wait, **prev, *done = NULL;
+    unsigned int serial, n = 0;
+
+    if (!sc || !__atomic_load_n(&sc->num_waits, __ATOMIC_RELAXED))
+        return;
+
+    pthread_mutex_lock(&sc->lock);
+    for (wait = sc->waits; wait; wait = wait->next) {
+        if (wait->object.obj_type == obj_type &&
+            (obj_type == VASyncObjectSurface ? wait->object.object.surface_id :
+             wait->object.object.buffer_id) == id) {
+            wait->forgotten = 1;
+            n++;
+        }
+    }
+    if (n == 0) {
+        pthread_mutex_unlock(&sc->lock);
+        return;
+    }
+
+    /* the thread may be waiting on the object, the next scans leave it out */
+    serial = sc->scan_serial;
+    while (sc->scanning && sc->scan_serial == serial)
+        pthread_cond_wait(&sc->cond, &sc->lock);
+
+    /* the ones the scan completed are gone already */
+    for (prev = &sc->waits; (wait = *prev);) {
+        if (wait->forgotten) {
+            *prev = wait->next;
+            __atomic_store_n(&sc->num_waits, sc->num_waits - 1, __ATOMIC_RELAXED);
+            wait->next = done;
+            done = wait;
+        } else {
+            prev = &wait->next;
+        }
+    }
+    pthread_mutex_unlock(&sc->lock);
+
+    while ((wait = done)) {
+        done = wait->next;
+        va_SyncComplete(sc, wait, obj_type == VASyncObjectSurface ?
+                        VA_STATUS_ERROR_INVALID_SURFACE : VA_STATUS_ERROR_INVALID_BUFFER);
+    }
+}
+
+void va_SyncEnd(VADisplay dpy)
+{
+    VADisplayContextP pDisplayContext = (VADisplayContextP)dpy;
+    struct va_sync_context *sc = DPY2SYNCCTX(dpy);
+    struct va_sync_wait *wait;
+
+    if (!sc)
+        return;
+
+    pthread_mutex_lock(&sc->lock);
+    sc->quit = 1;
+    pthread_cond_broadcast(&sc->cond);
+    pthread_mutex_unlock(&sc->lock);
+    va_ThreadPoolDestroy(sc->thread);
+
+    /* wake up the waiters of whatever did not complete before the display went away */
+    while ((wait = sc->waits)) {
+        sc->waits = wait->next;
+        va_SyncComplete(sc, wait, VA_STATUS_ERROR_OPERATION_FAILED);
+    }
+    va_ThreadPoolDestroy(sc->dispatch);
+
+    pthread_cond_destroy(&sc->cond);
+    pthread_mutex_destroy(&sc->lock);
+    free(sc);
+    __atomic_store_n(&pDisplayContext->vasync, NULL, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,391 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#define _GNU_SOURCE 1
+#include "sysdeps.h"
+#include "va.h"
+#include "va_backend.h"
+#include "va_internal.h"
+#include "va_thread.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+#define VA_THREAD_POOL_MAX_THREADS  64
+#define VA_THREAD_POOL_DEF_THREADS  8
+
+struct va_task {
+    va_task_func func;
+    void *arg;
+    struct va_task *next;
+};
+
+struct va_thread_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct va_task *head;
+    struct va_task *tail;
+    int quit;
+#ifdef __linux__
+    int bind_node;
+    cpu_set_t node_cpus;
+#endif
+    unsigned int num_threads;
+    pthread_t threads[VA_THREAD_POOL_MAX_THREADS];
+};
+
+/* shared state of a va_ThreadPoolRun() call */
+struct va_job_set {
+    va_task_func func;
+    uint8_t *jobs;
+    size_t job_size;
+    unsigned int num_jobs;
+    unsigned int next;          /* next job to take, atomic */
+    unsigned int done;          /* completed jobs, protected by lock */
+    unsigned int helpers;       /* helper tasks still referencing the set */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+};
+
+#ifdef __linux__
+/* parse a sysfs cpulist such as "0-7,16-23" */
+static int va_ParseCpuList(const char *path, cpu_set_t *set)
+{
+    char buf[1024], *p, *end;
+    FILE *f = fopen(path, "r");
+    int n;
+
+    if (!f)
+        return -1;
+    n = fread(buf, 1, sizeof(buf) - 1, f);
+    fclose(f);
+    if (n <= 0)
+        return -1;
+    buf[n] = '\0';
+
+    CPU_ZERO(set);
+    for (p = buf; *p >= '0' && *p <= '9'; p = end + 1) {
+        long first = strtol(p, &end, 10), last = first;
+
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+        for (; first <= last && first < CPU_SETSIZE; first++)
+            CPU_SET(first, set);
+        if (*end != ',')
+            break;
+    }
+
+    return 0;
+}
+
+/*
+ * Find the CPUs of the NUMA node the calling thread runs on. The workers
+ * are kept on that node so that they stay close to the memory the caller
+ * allocates and touches. Nothing is done on single node machines.
+ */
+static int va_ThreadGetNodeCpus(cpu_set_t *set)
+{
+    char path[64], env_value[1024];
+    cpu_set_t node;
+    int cpu = sched_getcpu(), i, found = -1;
+
+    if (va_parseConfig("LIBVA_THREADS_NUMA", &env_value[0]) == 0 && atoi(env_value) == 0)
+        return 0;
+    if (cpu < 0)
+        return 0;
+
+    for (i = 0; ; i++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", i);
+        if (va_ParseCpuList(path, &node) != 0)
+            break;
+        if (found < 0 && CPU_ISSET(cpu, &node)) {
+            *set = node;
+            found = i;
+        }
+    }
+
+    return i > 1 && found >= 0 && CPU_COUNT(set) > 0;
+}
+#endif
+
+static void *va_ThreadPoolWorker(void *data)
+{
+    struct va_thread_pool *pool = data;
+    struct va_task *task;
+
+#ifdef __linux__
+    if (pool->bind_node)
+        sched_setaffinity(0, sizeof(pool->node_cpus), &pool->node_cpus);
+#endif
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->head && !pool->quit)
+            pthread_cond_wait(&pool->cond, &pool->lock);
+        if (!pool->head)
+            break;
+
+        task = pool->head;
+        pool->head = task->next;
+        if (!pool->head)
+            pool->tail = NULL;
+        pthread_mutex_unlock(&pool->lock);
+
+        task->func(task->arg);
+        free(task);
+
+        pthread_mutex_lock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+struct va_thread_pool *va_ThreadPoolCreate(unsigned int num_threads)
+{
+    struct va_thread_pool *pool;
+    char env_value[1024];
+    unsigned int i;
+
+    pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+#ifdef __linux__
+    pool->bind_node = va_ThreadGetNodeCpus(&pool->node_cpus);
+#endif
+
+    if (num_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+#ifdef __linux__
+        if (pool->bind_node)
+            cpus = CPU_COUNT(&pool->node_cpus);
+#endif
+        num_threads = cpus > 0 ? (unsigned int)cpus : 1;
+        if (num_threads > VA_THREAD_POOL_DEF_THREADS)
+            num_threads = VA_THREAD_POOL_DEF_THREADS;
+        if (va_parseConfig("LIBVA_THREADS", &env_value[0]) == 0 && atoi(env_value) > 0)
+            num_threads = atoi(env_value);
+    }
+    if (num_threads > VA_THREAD_POOL_MAX_THREADS)
+        num_threads = VA_THREAD_POOL_MAX_THREADS;
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+
+    for (i = 0; i < num_threads; i++) {
+        if (pthread_create(&pool->threads[i], NULL, va_ThreadPoolWorker, pool) != 0)
+            break;
+    }
+    pool->num_threads = i;
+
+    if (pool->num_threads == 0) {
+        pthread_cond_destroy(&pool->cond);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void va_ThreadPoolDestroy(struct va_thread_pool *pool)
+{
+    unsigned int i;
+
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->quit = 1;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->num_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+unsigned int va_ThreadPoolSize(struct va_thread_pool *pool)
+{
+    return pool ? pool->num_threads : 0;
+}
+
+int va_ThreadPoolSubmit(struct va_thread_pool *pool, va_task_func func, void *arg)
+{
+    struct va_task *task = malloc(sizeof(*task));
+
+    if (!task)
+        return -1;
+
+    task->func = func;
+    task->arg = arg;
+    task->next = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail)
+        pool->tail->next = task;
+    else
+        pool->head = task;
+    pool->tail = task;
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
+/* take and run jobs of the set until none is left */
+static void va_JobSetDrain(struct va_job_set *set)
+{
+    unsigned int index, count = 0;
+
+    while ((index = __atomic_fetch_add(&set->next, 1, __ATOMIC_RELAXED)) < set->num_jobs) {
+        set->func(set->jobs + index * set->job_size);
+        count++;
+    }
+
+    if (count) {
+        pthread_mutex_lock(&set->lock);
+        set->done += count;
+        if (set->done == set->num_jobs)
+            pthread_cond_broadcast(&set->cond);
+        pthread_mutex_unlock(&set->lock);
+    }
+}
+
+static void va_JobSetHelper(void *arg)
+{
+    struct va_job_set *set = arg;
+
+    va_JobSetDrain(set);
+
+    pthread_mutex_lock(&set->lock);
+    set->helpers--;
+    pthread_cond_broadcast(&set->cond);
+    pthread_mutex_unlock(&set->lock);
+}
+
+/*
+ * Remove the helpers of set still waiting in the queue. Called once the
+ * caller drained the set: they would find nothing left to do, and if all
+ * the workers are themselves blocked in va_ThreadPoolRun() nobody would
+ * ever pick them up.
+ */
+static void va_JobSetReclaim(struct va_thread_pool *pool, struct va_job_set *set)
+{
+    struct va_task **link, *task, *prev = NULL;
+    unsigned int count = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (link = &pool->head; (task = *link) != NULL;) {
+        if (task->func == va_JobSetHelper && task->arg == set) {
+            *link = task->next;
+            free(task);
+            count++;
+        } else {
+            prev = task;
+            link = &task->next;
+        }
+    }
+    pool->tail = prev;
+    pthread_mutex_unlock(&pool->lock);
+
+    if (count) {
+        pthread_mutex_lock(&set->lock);
+        set->helpers -= count;
+        pthread_mutex_unlock(&set->lock);
+    }
+}
+
+void va_ThreadPoolRun(struct va_thread_pool *pool, va_task_func func,
+                      void *jobs, size_t job_size, unsigned int num_jobs)
+{
+    struct va_job_set set;
+    unsigned int i, helpers;
+
+    if (num_jobs == 0)
+        return;
+
+    memset(&set, 0, sizeof(set));
+    set.func = func;
+    set.jobs = jobs;
+    set.job_size = job_size;
+    set.num_jobs = num_jobs;
+    pthread_mutex_init(&set.lock, NULL);
+    pthread_cond_init(&set.cond, NULL);
+
+    helpers = num_jobs - 1;
+    if (helpers > va_ThreadPoolSize(pool))
+        helpers = va_ThreadPoolSize(pool);
+    for (i = 0; i < helpers; i++) {
+        pthread_mutex_lock(&set.lock);
+        set.helpers++;
+        pthread_mutex_unlock(&set.lock);
+        if (va_ThreadPoolSubmit(pool, va_JobSetHelper, &set) != 0) {
+            pthread_mutex_lock(&set.lock);
+            set.helpers--;
+            pthread_mutex_unlock(&set.lock);
+            break;
+        }
+    }
+
+    va_JobSetDrain(&set);
+    va_JobSetReclaim(pool, &set);
+
+    /* the set lives on our stack: wait for the helpers to let go of it */
+    pthread_mutex_lock(&set.lock);
+    while (set.done < set.num_jobs || set.helpers > 0)
+        pthread_cond_wait(&set.cond, &set.lock);
+    pthread_mutex_unlock(&set.lock);
+
+    pthread_cond_destroy(&set.cond);
+    pthread_mutex_destroy(&set.lock);
+}
+
+void va_DeadlineFromTimeout(struct timespec *deadline, uint64_t timeout_ns)
+{
+    clock_gettime(CLOCK_REALTIME, deadline);
+
+    /* clamp VA_TIMEOUT_INFINITE and other huge values to ~100 years */
+    if (timeout_ns > 100ULL * 365 * 24 * 3600 * 1000000000ULL)
+        timeout_ns = 100ULL * 365 * 24 * 3600 * 1000000000ULL;
+
+    deadline->tv_sec += timeout_ns / 1000000000ULL;
+    deadline->tv_nsec += timeout_ns % 1000000000ULL;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
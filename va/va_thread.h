@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2021 Intel Corporation. All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL PRECISION INSIGHT AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VA_THREAD_H
+#define VA_THREAD_H
+
+#include <pthread.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Small worker pool used by the libva side helpers (software copy,
+ * parallel image transfers, completion dispatching).
+ */
+
+typedef void (*va_task_func)(void *arg);
+
+struct va_thread_pool;
+
+/*
+ * Create a pool with num_threads workers. num_threads == 0 selects the
+ * default: the number of online CPUs, capped to 8, unless overridden by
+ * LIBVA_THREADS=<n>.
+ * On NUMA machines the workers are bound to the node of the calling
+ * thread and the default only counts the CPUs of that node, unless
+ * LIBVA_THREADS_NUMA=0.
+ */
+DLL_HIDDEN
+struct va_thread_pool *va_ThreadPoolCreate(unsigned int num_threads);
+
+/* Waits for the queued tasks to complete, then joins the workers */
+DLL_HIDDEN
+void va_ThreadPoolDestroy(struct va_thread_pool *pool);
+
+DLL_HIDDEN
+unsigned int va_ThreadPoolSize(struct va_thread_pool *pool);
+
+/* Queue func(arg) for execution on a worker. Returns 0 on success */
+DLL_HIDDEN
+int va_ThreadPoolSubmit(struct va_thread_pool *pool, va_task_func func, void *arg);
+
+/*
+ * Run func on each of the num_jobs elements of jobs (job_size bytes each)
+ * and wait for all of them. The calling thread takes jobs as well, so this
+ * makes progress even if all the workers are busy, and may be called from
+ * a task running on the pool itself: once it ran out of jobs, it takes its
+ * helpers no worker started yet back out of the queue instead of waiting
+ * for them.
+ */
+DLL_HIDDEN
+void va_ThreadPoolRun(struct va_thread_pool *pool, va_task_func func,
+                      void *jobs, size_t job_size, unsigned int num_jobs);
+
+/* Absolute CLOCK_REALTIME deadline timeout_ns from now, for pthread_cond_timedwait() */
+DLL_HIDDEN
+void va_DeadlineFromTimeout(struct timespec *deadline, uint64_t timeout_ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* VA_THREAD_H */
@@ -39,6 +39,7 @@
 #include "va_dec_hevc.h"
 #include "va_str.h"
 #include "va_vpp.h"
+#include "va_readback.h"
 #include <assert.h>
 #include <stdarg.h>
 #include <stdlib.h>
@@ -962,7 +963,6 @@ static void va_TraceMsg(struct trace_context *trace_ctx, const char *msg, ...)
 
 static void va_TraceSurface(VADisplay dpy, VAContextID context)
 {
-    unsigned int i;
     unsigned int fourcc; /* following are output argument */
     unsigned int luma_stride;
     unsigned int chroma_u_stride;
@@ -972,8 +972,8 @@ static void va_TraceSurface(VADisplay dpy, VAContextID context)
     unsigned int chroma_v_offset;
     unsigned int buffer_name;
     void *buffer = NULL;
-    unsigned char *Y_data, *UV_data, *tmp;
-    unsigned int pixel_byte;
+    unsigned char *Y_data, *UV_data, *tmp, *staging;
+    unsigned int pixel_byte, row_bytes, luma_rows, chroma_rows;
     VAStatus va_status;
     DPY2TRACECTX(dpy, context, VA_INVALID_ID);
 
@@ -1025,26 +1025,35 @@ static void va_TraceSurface(VADisplay dpy, VAContextID context)
     else
         pixel_byte = 1;
 
-    tmp = Y_data + luma_stride * trace_ctx->trace_surface_yoff;
-
-    for (i = 0; i < trace_ctx->trace_surface_height; i++) {
-        fwrite(tmp + trace_ctx->trace_surface_xoff,
-               trace_ctx->trace_surface_width,
-               pixel_byte, trace_ctx->trace_fp_surface);
-
-        tmp += luma_stride;
+    /*
+     * The locked surface is usually an uncached mapping: read it with
+     * streaming loads into a staging buffer and write it out at once
+     * instead of issuing one fwrite() per row.
+     */
+    row_bytes = trace_ctx->trace_surface_width * pixel_byte;
+    luma_rows = trace_ctx->trace_surface_height;
+    chroma_rows = 0;
+    if (fourcc == VA_FOURCC_NV12 || fourcc == VA_FOURCC_P010)
+        chroma_rows = trace_ctx->trace_surface_height / 2;
+
+    staging = malloc(row_bytes * (luma_rows + chroma_rows));
+    if (staging == NULL) {
+        va_TraceMsg(trace_ctx, "Error:failed to allocate the surface staging buffer\n");
+        vaUnlockSurface(dpy, trace_ctx->trace_rendertarget);
+        return;
     }
 
+    tmp = Y_data + luma_stride * trace_ctx->trace_surface_yoff;
+    vaStreamCopy2D(staging, row_bytes, tmp + trace_ctx->trace_surface_xoff, luma_stride,
+                   row_bytes, luma_rows);
+
     tmp = UV_data + chroma_u_stride * trace_ctx->trace_surface_yoff / 2;
-    if (fourcc == VA_FOURCC_NV12 || fourcc == VA_FOURCC_P010) {
-        for (i = 0; i < trace_ctx->trace_surface_height / 2; i++) {
-            fwrite(tmp + trace_ctx->trace_surface_xoff,
-                   trace_ctx->trace_surface_width,
-                   pixel_byte, trace_ctx->trace_fp_surface);
+    vaStreamCopy2D(staging + row_bytes * luma_rows, row_bytes,
+                   tmp + trace_ctx->trace_surface_xoff, chroma_u_stride,
+                   row_bytes, chroma_rows);
 
-            tmp += chroma_u_stride;
-        }
-    }
+    fwrite(staging, row_bytes, luma_rows + chroma_rows, trace_ctx->trace_fp_surface);
+    free(staging);
 
     fflush(trace_ctx->trace_fp_surface);
 